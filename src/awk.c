@@ -32,6 +32,8 @@
 // awk_new_program
 // awk_load_program_file
 // awk_load_program_array
+// awk_compile_program (match data)
+// awk_select_rules
 //
 // These functions free memory:
 // ----------------------------
@@ -66,6 +68,7 @@
 
 #ifdef HAVE_LIBSHP
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <ctype.h>
@@ -93,7 +96,7 @@
  * XXX YES THEY ARE!
  */
 
-#define MAXSUBS 10              /* $0 thru $9 should be plenty */
+#define MAXSUBS AWK_MAXSUBS     /* $0 thru $9 should be plenty */
 
 
 
@@ -401,6 +404,167 @@ int awk_get_sym(awk_symbol *s,          /* symbol */
  * It's a trivial grammar so no need for yacc/bison.
  */
 
+/*
+ * awk_add_operand: append a piece of a compiled expression.  Adjacent
+ *  pieces of literal text are merged.
+ */
+static int awk_add_operand(awk_action *p,
+                           awk_symbol *sym,
+                           const char *text,
+                           int len,
+                           int *size)
+{
+  awk_operand *o;
+
+  if (!sym && p->noperands > 0)
+  {
+    o = &p->operand[p->noperands-1];
+    if (!o->sym && o->text + o->len == text)
+    {
+      o->len += len;
+      return 0;
+    }
+  }
+  if (p->noperands == *size)
+  {
+    int n = (*size) ? (*size)*2 : 4;
+    awk_operand *a = realloc(p->operand,n*sizeof(awk_operand));
+
+    if (!a)
+    {
+      fprintf(stderr,"Couldn't allocate memory in awk_add_operand()\n");
+      return -1;
+    }
+    p->operand = a;
+    *size = n;
+  }
+  o = &p->operand[p->noperands++];
+  o->sym = sym;
+  o->text = text;
+  o->len = len;
+  return 0;
+}
+
+
+
+
+
+/*
+ * awk_compile_expr: Split an assignment's expression into literal text
+ *  and the symbols to expand, scanning it the way awk_eval_expr() does.
+ *  Symbols are then looked up once here rather than for every record.
+ *  An expression with no symbols assigned to an INT or FLOAT is
+ *  converted here too.
+ */
+static int awk_compile_expr(awk_symtab *this, awk_action *p)
+{
+  const char *expr = p->expr;
+  int exprlen = p->exprlen;
+  const char *symname;
+  awk_symbol *src;
+  char c,delim;
+  int size = 0;
+  int has_sym = 0;
+  int i;
+
+  while (exprlen > 0)
+  {
+    switch (c = *expr)
+    {
+      case '"':
+      case '\'':              /* trim off string delims */
+        ++expr;
+        --exprlen;
+        if (exprlen > 0 && expr[exprlen-1] == c) /* matching close delim */
+        {
+          --exprlen;
+        }
+        break;
+      case '$':               /* $var, $(var) or ${var} */
+        ++expr;
+        if (--exprlen <= 0)
+        {
+          break;
+        }
+        c = *expr;
+        delim = (c == '{') ? '}' : (c == '(') ? ')' : '\0';
+        if (delim)
+        {
+          ++expr;             /* skip the open delim */
+          --exprlen;
+        }
+        symname = expr;
+        if (delim == '\0')
+        {
+          while (exprlen > 0 && !isspace((int)*expr) && !ispunct((int)*expr))
+          {
+            ++expr;
+            --exprlen;
+          }
+        }
+        else
+        {
+          while (exprlen > 0 && *expr != delim)
+          {
+            ++expr;
+            --exprlen;
+          }
+        }
+        src = awk_find_sym(this,symname,(expr-symname));
+        if (delim)
+        {
+          /* skip over the close delim */
+          ++expr;
+          --exprlen;
+        }
+        if (src)
+        {
+          if (awk_add_operand(p,src,NULL,0,&size) < 0)
+          {
+            return -1;
+          }
+          has_sym = 1;
+          if (src == p->dest)
+          {
+            p->self_ref = 1;
+          }
+        }
+        break;
+      default:                /* \ quotes nothing yet, copy it too */
+        if (awk_add_operand(p,NULL,expr,1,&size) < 0)
+        {
+          return -1;
+        }
+        ++expr;
+        --exprlen;
+        break;
+    }
+  }
+
+  if (!has_sym && p->dest->type != STRING)
+  {
+    char tbuf[128];
+    int dl = 0;
+
+    for (i = 0; i < p->noperands; i++)
+    {
+      int n = min(p->operand[i].len,(int)sizeof(tbuf)-1-dl);
+
+      memcpy(&tbuf[dl],p->operand[i].text,n);
+      dl += n;
+    }
+    tbuf[dl] = '\0';
+    p->ival = atoi(tbuf);
+    p->dval = atof(tbuf);
+    p->opcode = ASSIGN_CONST;
+  }
+  return 0;
+}
+
+
+
+
+
 /*
  * awk_compile_stmt: "Compiles" a single action statement.
  */
@@ -441,6 +605,10 @@ int awk_compile_stmt(awk_symtab *this,
     }
     p->expr = val;
     p->exprlen = (ep-val);
+    if (awk_compile_expr(this,p) < 0)
+    {
+      return -1;
+    }
   }
   else
   {
@@ -474,15 +642,24 @@ int awk_compile_stmt(awk_symtab *this,
 
 /*
  * awk_compile_action: Break the action up into stmts and compile them
- *  and link them together.
+ *  into one array, linked together and ending with a NOOP.
  */
 awk_action *awk_compile_action(awk_symtab *this, const char *act)
 {
-  awk_action *p, *first = calloc(1,sizeof(awk_action));
+  awk_action *p, *first;
   const char *cs,*ns;         /* current, next stmt */
+  int nstmts = 1;
 
 
-  p = first;
+  for (cs = act; cs && *cs; cs++)
+  {
+    if (*cs == ';')
+    {
+      nstmts++;
+    }
+  }
+
+  p = first = calloc(nstmts+1,sizeof(awk_action));
 
   if (!p)
   {
@@ -499,13 +676,14 @@ awk_action *awk_compile_action(awk_symtab *this, const char *act)
     }
     if (awk_compile_stmt(this,p,cs,(ns-cs)) >= 0)
     {
-      p->next_act = calloc(1,sizeof(awk_action));
-      if (!p->next_act)
-      {
-        fprintf(stderr,"Couldn't allocate memoryin awk_compile_action (2)\n");
-      }
+      p->next_act = p+1;
       p = p->next_act;
     }
+    else
+    {
+      free(p->operand);
+      memset(p,0,sizeof(awk_action));
+    }
   }
   return first;
 }
@@ -519,13 +697,13 @@ awk_action *awk_compile_action(awk_symtab *this, const char *act)
  */
 void awk_free_action(awk_action *a)
 {
+  awk_action *p;
 
-  while (a)
+  for (p = a; p; p = p->next_act)
   {
-    awk_action *p = a;
-    a = p->next_act;
-    free(p);
+    free(p->operand);
   }
+  free(a);
 }
 
 
@@ -727,6 +905,122 @@ void awk_eval_expr(awk_symtab *this,
 
 
 
+/*
+ * awk_exec_assign: run a compiled assignment.  Strings are expanded
+ *  directly into dest unless the expression refers to dest itself.
+ */
+static void awk_exec_assign(const awk_action *p)
+{
+  awk_symbol *dest = p->dest;
+  const awk_operand *o;
+  char tbuf[1024];
+  char cbuf[128];             /* conversion buffer for int/float */
+  char *dp;
+  int dmax,dl = 0;
+  int i;
+
+  if (p->opcode == ASSIGN_CONST)
+  {
+    if (dest->type == INT && dest->size >= (int)sizeof(int))
+    {
+      *((int *)dest->val) = p->ival;
+      dest->len = sizeof(int);
+    }
+    else if (dest->type == FLOAT && dest->size >= (int)sizeof(double))
+    {
+      *((double *)dest->val) = p->dval;
+      dest->len = sizeof(double);
+    }
+    return;
+  }
+
+  if (dest->type == STRING && !p->self_ref)
+  {
+    dp = dest->val;
+    dmax = dest->size;
+  }
+  else
+  {
+    dp = tbuf;
+    dmax = (dest->type == STRING) ? min(dest->size,(int)sizeof(tbuf)) : (int)sizeof(tbuf);
+  }
+  if (dmax <= 0)
+  {
+    return;
+  }
+
+  for (i = 0, o = p->operand; i < p->noperands; i++, o++)
+  {
+    const char *sp = o->text;
+    int n = o->len;
+
+    if (o->sym)
+    {
+      awk_symbol *s = o->sym;
+
+      n = 0;
+      if (s->len > 0)
+      {
+        switch (s->type)
+        {
+          case STRING:
+            sp = s->val;
+            n = s->len;
+            break;
+          case INT:
+            xastir_snprintf(cbuf,sizeof(cbuf),"%d",*((int *)s->val));
+            sp = cbuf;
+            n = strlen(cbuf);
+            break;
+          case FLOAT:
+            xastir_snprintf(cbuf,sizeof(cbuf),"%f",*((double *)s->val));
+            sp = cbuf;
+            n = strlen(cbuf);
+            break;
+        }
+      }
+    }
+    n = min(n,dmax-1-dl);
+    if (n > 0)
+    {
+      memcpy(&dp[dl],sp,n);
+      dl += n;
+    }
+  }
+  dp[dl] = '\0';
+
+  switch(dest->type)
+  {
+    case INT:
+      if (dest->size >= (int)sizeof(int))
+      {
+        *((int *)dest->val) = atoi(dp);
+        dest->len = sizeof(int);
+      }
+      break;
+    case FLOAT:
+      if (dest->size >= (int)sizeof(double))
+      {
+        *((double *)dest->val) = atof(dp);
+        dest->len = sizeof(double);
+      }
+      break;
+    case STRING:
+      if (dp != dest->val)
+      {
+        memcpy(dest->val,dp,dl+1);
+      }
+      dest->len = dl;
+      break;
+    default:
+      break;
+  }
+}
+
+
+
+
+
 /*
  * awk_exec_action: interpret the compiled action.
  */
@@ -746,7 +1040,8 @@ int awk_exec_action(awk_symtab *this, const awk_action *code)
         done = 2;
         break;
       case ASSIGN:
-        awk_eval_expr(this,p->dest,p->expr,p->exprlen);
+      case ASSIGN_CONST:
+        awk_exec_assign(p);
         break;
       case NOOP:
         break;
@@ -816,12 +1111,14 @@ void awk_free_rule(awk_rule *r)
         pcre2_code_free(r->re);
 #endif
       }
-#ifdef XASTIR_LEGACY_PCRE
       if (r->pe)
       {
+#ifdef XASTIR_LEGACY_PCRE
         pcre_free(r->pe);
-      }
+#else
+        pcre2_match_data_free(r->pe);
 #endif
+      }
     }
     if (r->code)
     {
@@ -1135,12 +1432,48 @@ loop:
 
 
 
+/*
+ * awk_pattern_prefix: The literal text an anchored pattern has to start
+ *  with, e.g. "CFCC=A1" for "^CFCC=A1", so that buffers which can't
+ *  match are rejected without running the regexp.  Returns its length,
+ *  or 0 if there isn't one.
+ */
+static int awk_pattern_prefix(const char *pattern)
+{
+  const char *p;
+  int len;
+
+  if (!pattern || *pattern != '^' || strchr(pattern,'|'))
+  {
+    return 0;                   /* unanchored, or alternatives */
+  }
+  for (p = pattern+1; *p && !strchr("\\^$.[]|()?*+{}",*p); p++)
+  {
+    /* find the first metacharacter */
+  }
+  len = p - (pattern+1);
+  if (len > 0 && (*p == '?' || *p == '*' || *p == '{'))
+  {
+    len--;                      /* the last char is optional */
+  }
+  return len;
+}
+
+
+
+
+
 /*
  * awk_compile_program: Once loaded (from array or file), the program is compiled.  Check for already compiled program.
+ *
+ * Regexps, their match data and the actions are compiled only once and
+ * kept until awk_uncompile_program(), as are the $0-$9 symbols.
  */
 int awk_compile_program(awk_symtab *symtab, awk_program *rs)
 {
+  static const char subnames[] = "0123456789";
   awk_rule *r;
+  int i;
 #ifdef XASTIR_LEGACY_PCRE
   const char *error;
   int erroffset;
@@ -1156,50 +1489,50 @@ int awk_compile_program(awk_symtab *symtab, awk_program *rs)
   }
 
   rs->symtbl = symtab;
+  for (i = 0; i < MAXSUBS; i++)
+  {
+    rs->subs[i] = awk_find_sym(rs->symtbl,&subnames[i],1);
+  }
   for (r = rs->head; r; r = r->next_rule)
   {
     if (r->ruletype == REGEXP)
     {
-      if (r->tables)
+      if (!r->re)
       {
+        if (r->tables)
+        {
 #ifdef XASTIR_LEGACY_PCRE
-        pcre_free((void *)r->tables);
-#else
-        pcre2_maketables_free(NULL,r->tables);
-#endif
-      }
-#ifdef XASTIR_LEGACY_PCRE
-      r->tables = pcre_maketables(); /* NLS locale parse tables */
+          pcre_free((void *)r->tables);
 #else
-      theCompileContext=pcre2_compile_context_create(NULL);
-      r->tables = pcre2_maketables(NULL); /* NLS locale parse tables */
-      /* this always returns zero, so can ignore errornumber */
-      errornumber=pcre2_set_character_tables(theCompileContext,r->tables);
+          pcre2_maketables_free(NULL,r->tables);
 #endif
-      if (!r->re)
-      {
+        }
 #ifdef XASTIR_LEGACY_PCRE
+        r->tables = pcre_maketables(); /* NLS locale parse tables */
         r->re = pcre_compile(r->pattern, /* the pattern */
                              0, /* default options */
                              &error, /* for error message */
                              &erroffset, /* for error offset */
                              r->tables); /* NLS locale character tables */
 #else
+        theCompileContext=pcre2_compile_context_create(NULL);
+        r->tables = pcre2_maketables(NULL); /* NLS locale parse tables */
+        /* this always returns zero, so can ignore errornumber */
+        errornumber=pcre2_set_character_tables(theCompileContext,r->tables);
         r->re = pcre2_compile((PCRE2_SPTR8)r->pattern, /* the pattern */
                               PCRE2_ZERO_TERMINATED, /* no length needed */
                               0,     /* default options */
                               &errornumber, /* for error message */
                               &erroffset, /* for error offset */
                               theCompileContext);
+        pcre2_compile_context_free(theCompileContext);
 #endif
       }
       if (!r->re)
       {
-        int i;
-
         fprintf(stderr,"parse error: %s\n",r->pattern);
         fprintf(stderr,"             ");
-        for (i = 0; i < erroffset; i++)
+        for (i = 0; i < (int)erroffset; i++)
         {
           fputc(' ',stderr);
         }
@@ -1212,8 +1545,20 @@ int awk_compile_program(awk_symtab *symtab, awk_program *rs)
         r->pe = pcre_study(r->re, 0, &error); /* optimize the regexp */
       }
 #else
-      pcre2_compile_context_free(theCompileContext);
+      if (!r->pe)
+      {
+        /* use the JIT if pcre2 has one, else the interpreter */
+        (void)pcre2_jit_compile(r->re,PCRE2_JIT_COMPLETE);
+        r->pe = pcre2_match_data_create_from_pattern(r->re,NULL);
+        if (!r->pe)
+        {
+          fprintf(stderr,"Couldn't allocate memory in awk_compile_program()\n");
+          return -1;
+        }
+      }
 #endif
+      r->prefix = r->pattern+1;
+      r->prefixlen = awk_pattern_prefix(r->pattern);
     }
     else if (r->ruletype == BEGIN)
     {
@@ -1279,13 +1624,15 @@ void awk_uncompile_program(awk_program *p)
 #endif
       }
       r->re = NULL;
-#ifdef XASTIR_LEGACY_PCRE
       if (r->pe)
       {
+#ifdef XASTIR_LEGACY_PCRE
         pcre_free(r->pe);
+#else
+        pcre2_match_data_free(r->pe);
+#endif
       }
       r->pe = NULL;
-#endif
     }
     if (r->code)
     {
@@ -1300,18 +1647,71 @@ void awk_uncompile_program(awk_program *p)
 
 
 /*
- * awk_exec_program: apply the program to the given buffer
+ * awk_exec_rule: apply one REGEXP rule to the given buffer.  Returns -1
+ *  if it didn't match, else the result of its action.
  */
-int awk_exec_program(awk_program *this, char *buf, int len)
+static int awk_exec_rule(awk_program *this, awk_rule *r, char *buf, int len)
 {
-  int i,rc,done = 0;
-  awk_rule *r;
+  int i,rc;
 #ifdef XASTIR_LEGACY_PCRE
   int ovector[3*MAXSUBS];
   #define OVECLEN (sizeof(ovector)/sizeof(ovector[0]))
 #else
-  PCRE2_SIZE *ovector;
+  PCRE2_SIZE *ovector = NULL;
+#endif
+
+  if (r->prefixlen > 0
+      && (len < r->prefixlen || memcmp(buf,r->prefix,r->prefixlen) != 0))
+  {
+    return -1;                  /* can't match */
+  }
+
+#ifdef XASTIR_LEGACY_PCRE
+  rc = pcre_exec(r->re,r->pe,buf,len,0,0,ovector,OVECLEN);
+#else
+  rc = pcre2_match(r->re,(PCRE2_SPTR8)buf,len,0,0,r->pe,NULL);
+  if (rc > 0)
+  {
+    ovector = pcre2_get_ovector_pointer(r->pe);
+  }
 #endif
+  /* assign values to as many of $0 thru $9 as were set */
+  for (i = 0; rc > 0 && i < rc && i < MAXSUBS ; i++)
+  {
+    awk_symbol *s = this->subs[i];
+
+    if (s)
+    {
+      s->val = &buf[ovector[2*i]];
+      s->len = ovector[2*i+1]-ovector[2*i];
+    }
+  }
+  /* clobber the remaining $n thru $9 */
+  for (; i < MAXSUBS; i++)
+  {
+    if (this->subs[i])
+    {
+      this->subs[i]->len = 0;
+    }
+  }
+  if (rc > 0)
+  {
+    return awk_exec_action(this->symtbl,r->code);
+  }
+  return -1;
+}
+
+
+
+
+
+/*
+ * awk_exec_program: apply the program to the given buffer
+ */
+int awk_exec_program(awk_program *this, char *buf, int len)
+{
+  int rc,done = 0;
+  awk_rule *r;
 
   if (!this || !buf || len <= 0)
   {
@@ -1320,48 +1720,87 @@ int awk_exec_program(awk_program *this, char *buf, int len)
 
   for (r = this->head; r && !done ; r = r->next_rule)
   {
-    if (r->ruletype == REGEXP)
+    if (r->ruletype == REGEXP && (rc = awk_exec_rule(this,r,buf,len)) > 0)
     {
-#ifdef XASTIR_LEGACY_PCRE
-      rc = pcre_exec(r->re,r->pe,buf,len,0,0,ovector,OVECLEN);
-#else
-      pcre2_match_data *match_data;
-      match_data=pcre2_match_data_create_from_pattern(r->re,NULL);
-      rc=pcre2_match(r->re,(PCRE2_SPTR8)buf,len,0,0,match_data,NULL);
-      if (rc >0 )
-        ovector=pcre2_get_ovector_pointer(match_data);
-#endif
-      /* assign values to as many of $0 thru $9 as were set */
-      /* XXX - avoid calling awk_find_sym for these known values */
-      for (i = 0; rc > 0 && i < rc && i < MAXSUBS ; i++)
-      {
-        char symname[2];
-        awk_symbol *s;
-
-        symname[0] = i + '0';
-        symname[1] = '\0';
-        s = awk_find_sym(this->symtbl,symname,1);
-        s->val = &buf[ovector[2*i]];
-        s->len = ovector[2*i+1]-ovector[2*i];
-      }
-      /* clobber the remaining $n thru $9 */
-      for (; i < MAXSUBS; i++)
-      {
-        char symname[10];
-        awk_symbol *s;
+      done = rc;
+    }
+  }
+  return done;
+}
 
-        symname[0] = i + '0';
-        symname[1] = '\0';
-        s = awk_find_sym(this->symtbl,symname,1);
-        s->len = 0;
-      }
-      if (rc > 0)
-      {
-        done = awk_exec_action(this->symtbl,r->code);
-      }
-#ifndef XASTIR_LEGACY_PCRE
-      pcre2_match_data_free(match_data);
-#endif
+
+
+
+
+/*
+ * awk_select_rules: list the REGEXP rules of a compiled program that
+ *  could match a buffer starting with "start", e.g. "CFCC=" for one DBF
+ *  field, for use with awk_exec_rules().  The list is malloc'd and
+ *  keeps the program's order.  Returns its length, -1 on failure.
+ */
+int awk_select_rules(awk_program *this,
+                     const char *start,
+                     int len,
+                     awk_rule ***rules)
+{
+  awk_rule *r;
+  int n = 0;
+
+  *rules = NULL;
+  if (!this)
+  {
+    return 0;
+  }
+  for (r = this->head; r; r = r->next_rule)
+  {
+    n++;
+  }
+  *rules = malloc((n+1)*sizeof(awk_rule *));
+  if (!*rules)
+  {
+    fprintf(stderr,"Couldn't allocate memory in awk_select_rules()\n");
+    return -1;
+  }
+
+  n = 0;
+  for (r = this->head; r; r = r->next_rule)
+  {
+    if (r->ruletype == REGEXP
+        && (r->prefixlen == 0
+            || memcmp(start,r->prefix,min(len,r->prefixlen)) == 0))
+    {
+      (*rules)[n++] = r;
+    }
+  }
+  return n;
+}
+
+
+
+
+
+/*
+ * awk_exec_rules: apply a list of rules from awk_select_rules() to the
+ *  given buffer, as awk_exec_program() would.
+ */
+int awk_exec_rules(awk_program *this,
+                   awk_rule **rules,
+                   int nrules,
+                   char *buf,
+                   int len)
+{
+  int i,rc,done = 0;
+
+  if (!this || !buf || len <= 0)
+  {
+    return 0;
+  }
+
+  for (i = 0; i < nrules && !done; i++)
+  {
+    if ((rc = awk_exec_rule(this,rules[i],buf,len)) > 0)
+    {
+      done = rc;
     }
   }
   return done;
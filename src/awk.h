@@ -63,14 +63,29 @@ typedef struct awk_symtab_
 #define AWK_SYM_HASH(n,l) ((*n)&AWK_SYMTAB_HASH_SIZE)
 //#define AWK_SYM_HASH(n,l) ((n[0]+((l>1)?n[1]:0))&AWK_SYMTAB_HASH_SIZE)
 
+#define AWK_MAXSUBS 10          /* $0 thru $9 */
+
+typedef struct awk_operand_
+{
+  /* a piece of a compiled expression */
+  awk_symbol *sym;            /* symbol to expand, or NULL for text */
+  const char *text;           /* literal text (points into expr) */
+  int len;                    /* length of text */
+} awk_operand;
+
 typedef struct awk_action_
 {
   /* a program statement */
   struct awk_action_ *next_act;
-  enum {NOOP=0, NEXT, SKIP, ASSIGN} opcode;
+  enum {NOOP=0, NEXT, SKIP, ASSIGN, ASSIGN_CONST} opcode;
   awk_symbol *dest;   /* destination of assignment */
   const char *expr;           /* value setting expression */
   int exprlen;                /* length of expression */
+  awk_operand *operand;       /* expr split into text and symbols */
+  int noperands;
+  int self_ref;               /* expr expands dest itself */
+  int ival;                   /* ASSIGN_CONST value of an INT dest */
+  double dval;                /* ASSIGN_CONST value of a FLOAT dest */
 } awk_action;
 
 typedef struct awk_rule_
@@ -85,12 +100,14 @@ typedef struct awk_rule_
   #else
     const uint8_t *tables;       /* pcre2 NLS tables */
     pcre2_code *re;             /* pcre2 compiled pattern */
-    void *pe;                   /* pcre2 doesn't use separate optimization */
+    pcre2_match_data *pe;       /* pcre2 match data, reused for each match */
   #endif
   const char *act;            /* the program string */
   awk_action *code;           /* compiled program */
   int flags;                  /* some flags */
 #define AR_MALLOC 0x01        /* pattern, act were malloc'd by me */
+  const char *prefix;         /* literal text an anchored pattern */
+  int prefixlen;              /*  starts with, to skip the regexp */
 } awk_rule;
 
 typedef struct awk_program_
@@ -103,6 +120,7 @@ typedef struct awk_program_
   awk_rule *begin_rec;  /* optional BEGIN_RECORD rule */
   awk_rule *end_rec;    /* optional END_RECORD rule */
   awk_rule *end;        /* optional END rule */
+  awk_symbol *subs[AWK_MAXSUBS]; /* $0 thru $9 in symtbl */
 } awk_program;
 
 extern awk_symtab *awk_new_symtab(void);
@@ -143,6 +161,15 @@ extern awk_program *awk_load_program_file(const char *file);
 extern int awk_compile_program(awk_symtab *symtbl,awk_program *rs);
 extern void awk_uncompile_program(awk_program *rs);
 extern int awk_exec_program(awk_program *this, char *buf, int len);
+extern int awk_select_rules(awk_program *this,
+                            const char *start,
+                            int len,
+                            awk_rule ***rules);
+extern int awk_exec_rules(awk_program *this,
+                          awk_rule **rules,
+                          int nrules,
+                          char *buf,
+                          int len);
 extern int awk_exec_begin_record(awk_program *this);
 extern int awk_exec_end_record(awk_program *this);
 extern int awk_exec_begin(awk_program *this);
@@ -0,0 +1,117 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 2000-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+
+#ifdef HAVE_CONFIG_H
+  #include "config.h"
+#endif  // HAVE_CONFIG_H
+
+#include "cache_utils.h"
+
+// Must be last include file
+#include "leak_detection.h"
+
+
+
+
+
+// FNV-1a over "data", continuing from "hash" (FNV1A_INIT to start a
+// new one).
+//
+uint32_t fnv1a_hash(uint32_t hash, const void *data, size_t length)
+{
+  const unsigned char *p = data;
+  size_t i;
+
+
+  for (i = 0; i < length; i++)
+  {
+    hash = (hash ^ p[i]) * 16777619U;
+  }
+  return(hash);
+}
+
+
+
+
+
+// FNV-1a over a '\0' terminated string, not counting the '\0'.
+//
+uint32_t fnv1a_string(uint32_t hash, const char *str)
+{
+  const unsigned char *p;
+
+
+  for (p = (const unsigned char *)str; *p; p++)
+  {
+    hash = (hash ^ *p) * 16777619U;
+  }
+  return(hash);
+}
+
+
+
+
+
+// Take "link" off the list.
+//
+void lru_unlink(lru_list *list, lru_link *link)
+{
+  if (link->prev)
+  {
+    link->prev->next = link->next;
+  }
+  else
+  {
+    list->head = link->next;
+  }
+  if (link->next)
+  {
+    link->next->prev = link->prev;
+  }
+  else
+  {
+    list->tail = link->prev;
+  }
+  link->prev = NULL;
+  link->next = NULL;
+}
+
+
+
+
+
+// Put "link" at the head of the list, as the most recently used.
+//
+void lru_push(lru_list *list, lru_link *link)
+{
+  link->prev = NULL;
+  link->next = list->head;
+  if (list->head)
+  {
+    list->head->prev = link;
+  }
+  list->head = link;
+  if (!list->tail)
+  {
+    list->tail = link;
+  }
+}
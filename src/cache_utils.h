@@ -0,0 +1,53 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 2000-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+#ifndef __XASTIR_CACHE_UTILS_H
+#define __XASTIR_CACHE_UTILS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Helpers shared by the in-memory caches and indexes: an FNV-1a hash
+// for their keys and an intrusive LRU list.
+
+#define FNV1A_INIT 2166136261U    // Starting value for fnv1a_hash()
+
+extern uint32_t fnv1a_hash(uint32_t hash, const void *data, size_t length);
+extern uint32_t fnv1a_string(uint32_t hash, const char *str);
+
+// An entry on an LRU list embeds an lru_link as its first member, so
+// that the head or tail of the list can be cast back to the entry.
+typedef struct _lru_link
+{
+  struct _lru_link *prev;       // Towards the most recently used
+  struct _lru_link *next;
+} lru_link;
+
+typedef struct
+{
+  lru_link *head;               // Most recently used
+  lru_link *tail;               // Least recently used
+} lru_list;
+
+extern void lru_unlink(lru_list *list, lru_link *link);
+extern void lru_push(lru_list *list, lru_link *link);
+
+#endif
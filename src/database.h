@@ -287,29 +287,9 @@ typedef struct                  //                      strlen
 
 
 
-// Struct for holding track data.  Keeps a dynamically allocated
-// doubly-linked list of track points.  The first record should have its
-// "prev" pointer set to NULL and the last record should have its "next"
-// pointer set to NULL.  If no track storage exists then the pointers to
-// these structs in the DataRow struct should be NULL.
-typedef struct _TrackRow
-{
-  long    trail_long_pos;     // coordinate of trail point
-  long    trail_lat_pos;      // coordinate of trail point
-  time_t  sec;                // date/time of position
-  long    speed;              // in 0.1 km/h   undefined: -1
-  int     course;             // in degrees    undefined: -1
-  long    altitude;           // in 0.1 m      undefined: -99999
-  char    flag;               // several flags, see below
-  struct  _TrackRow *prev;    // pointer to previous record in list
-  struct  _TrackRow *next;    // pointer to next record in list
-} TrackRow;
-
-
-
-// trail flag definitions
-#define TR_LOCAL        0x01    // heard direct (not via digis)
-#define TR_NEWTRK       0x02    // start new track
+// Track data is kept in a delta-encoded TrailStore per station, see
+// trail_store.h for TrackRow and the trail flag definitions.
+#include "trail_store.h"
 
 
 
@@ -352,6 +332,48 @@ typedef struct _MultipointRow
 //
 // todo: check the string length!
 //
+// Optional stuff for Objects/Items only.  Allocated by
+// get_object_data() when a station first gets one of these, read
+// with OBJECT_DATA().
+typedef struct _ObjectRow
+{
+  char origin[MAX_CALLSIGN+1]; // call sign originating an object
+  short object_retransmit;     // Number of times to retransmit object.
+  // -1 = forever
+  // Used currently to stop sending killed
+  // objects.
+  time_t last_transmit_time;   // Time we last transmitted an object/item.
+  // Used to implement decaying transmit time
+  // algorithm
+  short transmit_time_increment; // Seconds to add to transmit next time
+  // around.  Used to implement decaying
+  // transmit time algorithm
+//    time_t last_modified_time;   // Seconds since the object/item
+  // was last modified.  We'll
+  // eventually use this for
+  // dead-reckoning.
+  char signpost[5+1];          // Holds signpost data
+  char probability_min[10+1];  // Holds prob_min (miles)
+  char probability_max[10+1];  // Holds prob_max (miles)
+} ObjectRow;
+
+
+
+// Data extensions only some stations send.  Allocated by
+// get_extra_data() when a station first sends one, read with
+// EXTRA_DATA().
+typedef struct _ExtraRow
+{
+  char bearing[MAX_COURSE+1];
+  char NRQ[MAX_COURSE+1];
+  char power_gain[MAX_POWERGAIN+1];   // Holds the phgd values
+  char signal_gain[MAX_POWERGAIN+1];  // Holds the shgd values (for DF'ing)
+  int  df_color;
+  char sats_visible[MAX_SAT];
+} ExtraRow;
+
+
+
 typedef struct _DataRow
 {
 
@@ -362,6 +384,11 @@ typedef struct _DataRow
   // list (newer)
   struct _DataRow *t_older;   // pointer to previous element in time ordered
   // list (older)
+  struct _DataRow *grid_next; // pointer to next element in spatial index
+  // bucket
+  struct _DataRow *grid_prev; // pointer to previous element in spatial index
+  // bucket
+  int grid_bucket;            // spatial index bucket, -1 if not indexed
 
   char call_sign[MAX_CALLSIGN+1]; // call sign or name index or object/item
   // name
@@ -375,9 +402,8 @@ typedef struct _DataRow
   time_t heard_via_tnc_last_time;
   time_t direct_heard;        // KC2ELS - time last heard direct
 
-// Change into time_t structs?  It'd save us a bunch of space.
-  char packet_time[MAX_TIME];
-  char pos_time[MAX_TIME];
+  time_t packet_time;         // time last packet received
+  time_t pos_time;            // time last position received
 
 //    char altitude_time[MAX_TIME];
 //    char speed_time[MAX_TIME];
@@ -412,21 +438,13 @@ typedef struct _DataRow
   char altitude[MAX_ALTITUDE]; // in meters (feet gives better resolution ??)
   char speed[MAX_SPEED+1];    // in knots (same as nautical miles/hour)
   char course[MAX_COURSE+1];
-  char bearing[MAX_COURSE+1];
-  char NRQ[MAX_COURSE+1];
-  char power_gain[MAX_POWERGAIN+1];   // Holds the phgd values
-  char signal_gain[MAX_POWERGAIN+1];  // Holds the shgd values (for DF'ing)
 
   WeatherRow *weather_data;   // Pointer to weather data or NULL
 
   CommentRow *status_data;    // Ptr to status records or NULL
   CommentRow *comment_data;   // Ptr to comment records or NULL
 
-  // Below two pointers are NULL if only one position has been received
-  TrackRow *oldest_trackpoint; // Pointer to oldest track point in
-  // doubly-linked list
-  TrackRow *newest_trackpoint; // Pointer to newest track point in
-  // doubly-linked list
+  TrailStore *trail;          // Track points or NULL
 
   // When the station is an object, it can include coordinates
   // of related points. Currently these are being used to draw
@@ -444,37 +462,25 @@ typedef struct _DataRow
   MultipointRow *multipoint_data;
 
 
-///////////////////////////////////////////////////////////////////////
-// Optional stuff for Objects/Items only (I think, needs to be
-// checked).  These could be moved into an ObjectRow structure, with
-// only a NULL pointer here if not an object/item.
-///////////////////////////////////////////////////////////////////////
-
-  char origin[MAX_CALLSIGN+1]; // call sign originating an object
-  short object_retransmit;     // Number of times to retransmit object.
-  // -1 = forever
-  // Used currently to stop sending killed
-  // objects.
-  time_t last_transmit_time;   // Time we last transmitted an object/item.
-  // Used to implement decaying transmit time
-  // algorithm
-  short transmit_time_increment; // Seconds to add to transmit next time
-  // around.  Used to implement decaying
-  // transmit time algorithm
-//    time_t last_modified_time;   // Seconds since the object/item
-  // was last modified.  We'll
-  // eventually use this for
-  // dead-reckoning.
-  char signpost[5+1];          // Holds signpost data
-  int  df_color;
-  char sats_visible[MAX_SAT];
-  char probability_min[10+1];  // Holds prob_min (miles)
-  char probability_max[10+1];  // Holds prob_max (miles)
+  ObjectRow *object_data;     // Object/item data or NULL
+  ExtraRow *extra_data;       // PHG/DF/GPS extension data or NULL
 
 } DataRow;
 
 
 
+// Read-only view of a station's object/item or extension data.
+// Stations without any get the defaults: empty strings, "transmit
+// forever" and no DF color.  The defaults are const, so never write
+// through these, use get_object_data() and get_extra_data() instead.
+extern const ObjectRow object_data_defaults;
+extern const ExtraRow extra_data_defaults;
+
+#define OBJECT_DATA(p) ((p)->object_data != NULL ? (p)->object_data : (ObjectRow *)&object_data_defaults)
+#define EXTRA_DATA(p)  ((p)->extra_data != NULL ? (p)->extra_data : (ExtraRow *)&extra_data_defaults)
+
+
+
 // Used to store one vertice in CADRow object
 typedef struct _VerticeRow
 {
@@ -553,6 +559,63 @@ typedef struct
 } aloha_stats;
 
 
+// An AX.25 line split into its parts by predecode_ax25_line(), ready
+// for decode_ax25_packet() to add to the database.  Self-contained
+// (no pointers) so it can be copied from the decode thread to the
+// main thread.
+#define MAX_AX25_LINE 512       // Same as MAX_LINE_SIZE in xastir.h
+
+// What predecode_ax25_line() could parse out of the info field
+// without the station record:  the position and weather, and the
+// expanded text of a Mic-E packet.  data_add() takes these instead of
+// parsing again if it is handed the same text.
+typedef struct
+{
+  int mic_e;                            // -1 not Mic-E, 0 invalid, 1 expanded
+  int mic_e_msg;                        // Mic-E message number
+  char mic_e_info[MAX_AX25_LINE+1];     // Mic-E packet as data_add() takes it
+  int position;                         // -1 not parsed, else extract_position() result
+  int grid;                             // Parsed as a grid locator
+  int compressed;                       // extract_position() failed, compressed tried
+  int skip;                             // Bytes of text the position took
+  char pos_data[MAX_AX25_LINE+1];       // Text the position was parsed from
+  char pos_after[MAX_AX25_LINE+1];      // ... and as the extractors left it
+  long coord_lat;
+  long coord_lon;
+  char pos_amb;
+  char aprs_type;
+  char aprs_symbol;
+  char special_overlay;
+  char altitude[MAX_ALTITUDE];
+  char speed[MAX_SPEED+1];
+  char course[MAX_COURSE+1];
+  char power_gain[MAX_POWERGAIN+1];
+  int weather;                          // -1 not parsed, else parse_weather() result
+  int wx_compr;                         // Parsed as a compressed report
+  int wx_snow;                          // wx_snow was parsed
+  WeatherRow wx;
+  char wx_data[MAX_AX25_LINE+1];        // Text the weather was parsed from
+  char wx_after[MAX_AX25_LINE+1];       // ... with the weather items taken out
+} ax25_parsed;
+
+typedef struct
+{
+  int path_ok;                          // Split into call/path/info and the path is valid
+  int call_ok;                          // ... and so is the source callsign
+  int ok;                               // ... and any third-party/object header too
+  int third_party;                      // Info field was third-party traffic
+  char backup[MAX_AX25_LINE+1];         // The line as received
+  char call_sign[MAX_AX25_LINE+1];      // Source callsign as received
+  char path[100+1];                     // Path, converted to TAPR format
+  char info_copy[MAX_AX25_LINE+1];      // Info field as received
+  char call[MAX_CALLSIGN+1];            // Station, object or item name to decode
+  char decode_path[100+1];              // Path to decode, from third-party header if any
+  char origin[MAX_CALLSIGN+1];          // Originator of object/item, "INET", etc.
+  char info[MAX_AX25_LINE+1];           // Info field to decode
+  ax25_parsed parsed;                   // Info field parsed ahead, if ok
+} ax25_packet;
+
+
 #ifdef HAVE_DB
   extern int add_simple_station(DataRow *p_new_station,char *station, char *origin, char *symbol, char *overlay, char *aprs_type, char *latitude, char *longitude, char *record_type, char *node_path, char *transmit_time, char *timeformat);
 
@@ -49,6 +49,13 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <sys/stat.h>
+
+#ifdef HAVE_MMAP
+  #include <sys/mman.h>
+#endif  // HAVE_MMAP
 
 #include <math.h>
 
@@ -76,11 +83,13 @@
 #include "xa_config.h"
 #include "x_spider.h"
 #include "encoding.h"
+#include "cache_utils.h"
 #include "db_gis.h"
 #include "db_gui.h"
 #include "db_funcs.h"
 #include "sound.h"
 #include "log_utils.h"
+#include "row_pool.h"
 
 // Must be last include file
 #include "leak_detection.h"
@@ -105,6 +114,12 @@ char GUARD_BAND_THREE[GUARD_SIZE];
 int station_data_auto_update = 0;
 
 
+// Pools for the records hung off each station.  They are only used
+// from the main thread.
+static row_pool comment_pool = ROW_POOL_INIT("CommentRow", sizeof(CommentRow));
+static row_pool multipoint_pool = ROW_POOL_INIT("MultipointRow", sizeof(MultipointRow));
+
+
 // Used to store all the calls we might "relay" digipeat by.
 // Separated by commas.  Up to 50 callsigns of 9 chars each plus
 // comma delimiters.
@@ -113,12 +128,18 @@ char relay_digipeater_calls[10*MAX_RELAY_DIGIPEATER_CALLS];
 
 void my_station_gps_change(char *pos_long, char *pos_lat, char *course, char *speed, char speedu, char *alt, char *sats);
 void station_shortcuts_update_function(int hash_key, DataRow *p_rem);
+static void station_index_add(DataRow *p_station);
+static void station_index_remove(DataRow *p_station);
+static DataRow *station_index_lookup(char *call);
+static void station_index_clear(void);
+static void station_grid_clear(void);
 int position_on_extd_screen(long lat, long lon);
 
 int  extract_speed_course(char *info, char *speed, char *course);
 int  extract_bearing_NRQ(char *info, char *bearing, char *nrq);
 
 int skip_dupe_checking;
+int defer_station_drawing = 0;  // Batch load:  don't draw or announce each station
 int  tracked_stations = 0;       // A count variable used in debug code only
 void track_station(Widget w, char *call_tracked, DataRow *p_station);
 
@@ -3259,16 +3280,24 @@ int test_extract_weather_item(char *data, char type, int datalen)
 // By the time we call this function we've already extracted any
 // time/position info at the beginning of the string.
 //
-int extract_weather(DataRow *p_station, char *data, int compr)
+// Parses into "weather" and takes the items out of "data".  Only the
+// wx_* items of a report are written, so "weather" may be a scratch
+// record for store_weather() to copy from.  "stn_speed" and
+// "stn_course" are the station's, for compressed reports which carry
+// the wind there.  *snow is set if wx_snow was written.  Touches
+// nothing else, so predecode_ax25_line() uses it on the decode thread.
+//
+static int parse_weather(WeatherRow *weather, int *snow, char *data, int compr,
+                         const char *stn_speed, const char *stn_course)
 {
-  char time_data[MAX_TIME];
   char temp[5];
   int  ok = 1;
-  WeatherRow *weather;
   char course[4];
   char speed[4];
   int in_knots = 0;
 
+  *snow = 0;
+
   //WE7U
   // Try copying the string to a temporary string, then do some
   // extractions to see if a few weather items are present?  This
@@ -3292,9 +3321,9 @@ int extract_weather(DataRow *p_station, char *data, int compr)
       // already extracted speed/course from the compressed
       // packet.  extract_comp_position() extracts
       // course/speed as well.
-      memcpy(speed, p_station->speed, sizeof(speed));
+      memcpy(speed, stn_speed, sizeof(speed));
       speed[sizeof(speed)-1] = '\0';  // Terminate string
-      memcpy(course, p_station->course, sizeof(course));
+      memcpy(course, stn_course, sizeof(course));
       course[sizeof(course)-1] = '\0';  // Terminate string
       in_knots = 1;
 
@@ -3312,9 +3341,9 @@ int extract_weather(DataRow *p_station, char *data, int compr)
       // already extracted speed/course from the compressed
       // packet.  extract_comp_position() extracts
       // course/speed as well.
-      memcpy(speed, p_station->speed, sizeof(speed));
+      memcpy(speed, stn_speed, sizeof(speed));
       speed[sizeof(speed)-1] = '\0';  // Terminate string
-      memcpy(course, p_station->course, sizeof(course));
+      memcpy(course, stn_course, sizeof(course));
       course[sizeof(course)-1] = '\0';  // Terminate string
       in_knots = 1;
 
@@ -3418,12 +3447,6 @@ int extract_weather(DataRow *p_station, char *data, int compr)
 
   if (ok)
   {
-    ok = get_weather_record(p_station);     // get existing or create new weather record
-  }
-
-  if (ok)
-  {
-    weather = p_station->weather_data;
 
     // Copy into weather speed variable.  Convert knots to mph
     // if necessary.
@@ -3448,15 +3471,6 @@ int extract_weather(DataRow *p_station, char *data, int compr)
                     "%s",
                     course);
 
-    if (compr)          // course/speed was taken from normal data, delete that
-    {
-      // fix me: we delete a potential real speed/course now
-      // we should differentiate between normal and weather data in compressed position decoding...
-      //            p_station->speed_time[0]     = '\0';
-      p_station->speed[0]          = '\0';
-      p_station->course[0]         = '\0';
-    }
-
     (void)extract_weather_item(data,'g',3,weather->wx_gust);      // gust (peak wind speed in mph in the last 5 minutes)
 
     (void)extract_weather_item(data,'t',3,weather->wx_temp);      // temperature (in deg Fahrenheit), could be negative
@@ -3484,6 +3498,7 @@ int extract_weather(DataRow *p_station, char *data, int compr)
     if ( (speed[0] != '\0') && (course[0] != '\0') )
     {
       (void)extract_weather_item(data,'s',3,weather->wx_snow);      // snowfall, inches in the last 24 hours
+      *snow = 1;
     }
 
     (void)extract_weather_item(data,'L',3,temp);                  // luminosity (in watts per square meter) 999 and below
@@ -3503,31 +3518,79 @@ int extract_weather(DataRow *p_station, char *data, int compr)
     //    extract_weather_item(data,'w',3,temp);                          // ?? text wUII
 
     // now there should be the name of the weather station...
+  }
+  return(ok);
+}
 
-    // Create a timestamp from the current time
-    xastir_snprintf(weather->wx_time,
-                    sizeof(weather->wx_time),
-                    "%s",
-                    get_time(time_data));
 
-    // Set the timestamp in the weather record so that we can
-    // decide whether or not to "ghost" the weather data later.
-    weather->wx_sec_time=sec_now();
-//        weather->wx_data=1;  // we don't need this
-
-//        case ('.'):/* skip */
-//            wx_strpos+=4;
-//            break;
-
-//        default:
-//            wx_done=1;
-//            weather->wx_type=data[wx_strpos];
-//            if(strlen(data)>wx_strpos+1)
-//                xastir_snprintf(weather->wx_station,
-//                    sizeof(weather->wx_station),
-//                    "%s",
-//                    data+wx_strpos+1);
-//            break;
+
+
+
+
+// Copy the items parse_weather() found into the station's weather
+// record, which must exist.
+//
+static void store_weather(DataRow *p_station, const WeatherRow *parsed, int snow, int compr)
+{
+  char time_data[MAX_TIME];
+  WeatherRow *weather = p_station->weather_data;
+
+
+  memcpy(weather->wx_speed, parsed->wx_speed, sizeof(weather->wx_speed));
+  memcpy(weather->wx_course, parsed->wx_course, sizeof(weather->wx_course));
+  memcpy(weather->wx_gust, parsed->wx_gust, sizeof(weather->wx_gust));
+  memcpy(weather->wx_temp, parsed->wx_temp, sizeof(weather->wx_temp));
+  memcpy(weather->wx_rain, parsed->wx_rain, sizeof(weather->wx_rain));
+  memcpy(weather->wx_prec_24, parsed->wx_prec_24, sizeof(weather->wx_prec_24));
+  memcpy(weather->wx_prec_00, parsed->wx_prec_00, sizeof(weather->wx_prec_00));
+  memcpy(weather->wx_hum, parsed->wx_hum, sizeof(weather->wx_hum));
+  memcpy(weather->wx_baro, parsed->wx_baro, sizeof(weather->wx_baro));
+  if (snow)
+  {
+    memcpy(weather->wx_snow, parsed->wx_snow, sizeof(weather->wx_snow));
+  }
+  memcpy(weather->wx_fuel_temp, parsed->wx_fuel_temp, sizeof(weather->wx_fuel_temp));
+  memcpy(weather->wx_fuel_moisture, parsed->wx_fuel_moisture, sizeof(weather->wx_fuel_moisture));
+
+  if (compr)          // course/speed was taken from normal data, delete that
+  {
+    // fix me: we delete a potential real speed/course now
+    // we should differentiate between normal and weather data in compressed position decoding...
+    //            p_station->speed_time[0]     = '\0';
+    p_station->speed[0]          = '\0';
+    p_station->course[0]         = '\0';
+  }
+
+  // Create a timestamp from the current time
+  xastir_snprintf(weather->wx_time,
+                  sizeof(weather->wx_time),
+                  "%s",
+                  get_time(time_data));
+
+  // Set the timestamp in the weather record so that we can
+  // decide whether or not to "ghost" the weather data later.
+  weather->wx_sec_time=sec_now();
+}
+
+
+
+
+
+int extract_weather(DataRow *p_station, char *data, int compr)
+{
+  WeatherRow parsed;
+  int snow;
+  int ok;
+
+
+  ok = parse_weather(&parsed, &snow, data, compr, p_station->speed, p_station->course);
+  if (ok)
+  {
+    ok = get_weather_record(p_station);     // get existing or create new weather record
+  }
+  if (ok)
+  {
+    store_weather(p_station, &parsed, snow, compr);
   }
   return(ok);
 }
@@ -3939,7 +4002,7 @@ static void extract_multipoints(DataRow *p_station,
         if (p_station->multipoint_data == NULL)
         {
           //fprintf(stderr, "Malloc'ing MultipointRow record, %s\n", p_station->call_sign);
-          p_station->multipoint_data = malloc(sizeof(MultipointRow));
+          p_station->multipoint_data = row_pool_alloc(&multipoint_pool);
           if (p_station->multipoint_data == NULL)
           {
             p_station->num_multipoints = 0;
@@ -4100,13 +4163,98 @@ int delete_weather(DataRow *fill)      // delete weather storage, if allocated
 
 
 
+// Defaults seen through OBJECT_DATA() and EXTRA_DATA() by stations
+// that have no object/item or extension data.
+const ObjectRow object_data_defaults =
+{
+  "",         // origin
+  -1,         // object_retransmit: transmit forever
+  0,          // last_transmit_time
+  0,          // transmit_time_increment
+  "",         // signpost
+  "",         // probability_min
+  ""          // probability_max
+};
+
+const ExtraRow extra_data_defaults =
+{
+  "",         // bearing
+  "",         // NRQ
+  "",         // power_gain
+  "",         // signal_gain
+  -1,         // df_color
+  ""          // sats_visible
+};
+
+
+
+
+
+ObjectRow *get_object_data(DataRow *fill)   // get or create object/item storage
+{
+
+  if (fill->object_data == NULL)
+  {
+    fill->object_data = malloc(sizeof(ObjectRow));
+    CHECKMALLOC(fill->object_data);
+
+    *fill->object_data = object_data_defaults;
+    fill->object_data->last_transmit_time = sec_now();  // Used for object/item decaying algorithm
+  }
+  return(fill->object_data);
+}
+
+
+
+
+
+ExtraRow *get_extra_data(DataRow *fill)     // get or create extension storage
+{
+
+  if (fill->extra_data == NULL)
+  {
+    fill->extra_data = malloc(sizeof(ExtraRow));
+    CHECKMALLOC(fill->extra_data);
+
+    *fill->extra_data = extra_data_defaults;
+  }
+  return(fill->extra_data);
+}
+
+
+
+
+
+int delete_extensions(DataRow *fill)    // delete object/item and extension storage, if allocated
+{
+  int deleted = 0;
+
+  if (fill->object_data != NULL)
+  {
+    free(fill->object_data);
+    fill->object_data = NULL;
+    deleted = 1;
+  }
+  if (fill->extra_data != NULL)
+  {
+    free(fill->extra_data);
+    fill->extra_data = NULL;
+    deleted = 1;
+  }
+  return(deleted);
+}
+
+
+
+
+
 int delete_multipoints(DataRow *fill)   // delete multipoint storage, if allocated
 {
 
   if (fill->multipoint_data != NULL)
   {
     //fprintf(stderr,"Removing multipoint data, %s\n", fill->call_sign);
-    free(fill->multipoint_data);
+    row_pool_free(&multipoint_pool, fill->multipoint_data);
     fill->multipoint_data = NULL;
     fill->num_multipoints = 0;
     return(1);
@@ -4185,12 +4333,12 @@ int new_trail_color(char *call)
 
 
 //
-// Store one trail point.  Allocate storage for the new data.
+// Store one trail point.
 //
-// We now store track data in a doubly-linked list.  Each record has a
-// pointer to the previous and the next record in the list.  The main
-// station record has a pointer to the oldest and the newest end of the
-// chain, and the chain can be traversed in either order.
+// Track data is kept in a TrailStore per station, a growable buffer
+// of delta-encoded points.  New points go on the newest end and
+// expired points come off the oldest end, and the trail can be
+// walked in either order with a TrailCursor.
 //
 int store_trail_point(DataRow *p_station,
                       long lon,
@@ -4203,7 +4351,8 @@ int store_trail_point(DataRow *p_station,
 {
 
   char flag;
-  TrackRow *ptr;
+  TrackRow point;
+  int new_trail;
 
   //fprintf(stderr,"store_trail_point: %s\n",p_station->call_sign);
 
@@ -4212,83 +4361,42 @@ int store_trail_point(DataRow *p_station,
     fprintf(stderr,"store_trail_point: for %s\n", p_station->call_sign);
   }
 
-  // Allocate storage for the new track point
-  ptr = malloc(sizeof(TrackRow));
-  if (ptr == NULL)
-  {
-    if (debug_level & 256)
-    {
-      fprintf(stderr,"store_trail_point: MALLOC failed for trail.\n");
-    }
-    return(0); // Failed due to malloc
-  }
-
-  // Check whether we have any track data saved
-  if (p_station->newest_trackpoint == NULL)
-  {
-    // new trail, do initialization
-
-    if (debug_level & 256)
-    {
-      fprintf(stderr,"Creating new trail.\n");
-    }
-    tracked_stations++;
-
-    // Assign a new trail color 'cuz it's a new trail
-    p_station->trail_color = new_trail_color(p_station->call_sign);
-  }
-
-  // Start linking the record to the new end of the chain
-  ptr->prev = p_station->newest_trackpoint;   // Link to record or NULL
-  ptr->next = NULL;   // Newest end of chain
-
-  // Have an older record already?
-  if (p_station->newest_trackpoint != NULL)   // Yes
-  {
-    p_station->newest_trackpoint->next = ptr;
-  }
-  else    // No, this is our first record
-  {
-    p_station->oldest_trackpoint = ptr;
-  }
-
-  // Link it in as our newest record
-  p_station->newest_trackpoint = ptr;
+  new_trail = (p_station->trail == NULL);
 
   if (debug_level & 256)
   {
     fprintf(stderr,"store_trail_point: Storing data for %s\n", p_station->call_sign);
   }
 
-  ptr->trail_long_pos = lon;
-  ptr->trail_lat_pos  = lat;
-  ptr->sec            = sec;
+  point.trail_long_pos = lon;
+  point.trail_lat_pos  = lat;
+  point.sec            = sec;
 
   if (alt[0] != '\0')
   {
-    ptr->altitude = atoi(alt)*10;
+    point.altitude = atoi(alt)*10;
   }
   else
   {
-    ptr->altitude = -99999l;
+    point.altitude = -99999l;
   }
 
   if (speed[0] != '\0')
   {
-    ptr->speed  = (long)(atof(speed)*18.52);
+    point.speed  = (long)(atof(speed)*18.52);
   }
   else
   {
-    ptr->speed  = -1;
+    point.speed  = -1;
   }
 
   if (course[0] != '\0')
   {
-    ptr->course = (int)(atof(course) + 0.5);  // Poor man's rounding
+    point.course = (int)(atof(course) + 0.5);  // Poor man's rounding
   }
   else
   {
-    ptr->course = -1;
+    point.course = -1;
   }
 
   flag = '\0';                    // init flags
@@ -4298,13 +4406,15 @@ int store_trail_point(DataRow *p_station,
     flag |= TR_LOCAL;  // set "local" flag
   }
 
-  if (ptr->prev != NULL)      // we have at least two points...
+  if (!new_trail)      // we have at least two points...
   {
+    TrackRow *prev = &p_station->trail->newest;
+
     // Check whether distance between points is too far.  We
     // must convert from degrees to the Xastir coordinate system
     // units, which are 100th of a second.
-    if (    labs(lon - ptr->prev->trail_long_pos) > (trail_segment_distance * 60*60*100) ||
-            labs(lat - ptr->prev->trail_lat_pos)  > (trail_segment_distance * 60*60*100) )
+    if (    labs(lon - prev->trail_long_pos) > (trail_segment_distance * 60*60*100) ||
+            labs(lat - prev->trail_lat_pos)  > (trail_segment_distance * 60*60*100) )
     {
 
       // Set "new track" flag if there's
@@ -4317,7 +4427,7 @@ int store_trail_point(DataRow *p_station,
     {
       // Check whether trail went above our maximum time
       // between points.  If so, don't draw segment.
-      if (labs(sec - ptr->prev->sec) > (trail_segment_time *60))
+      if (labs(sec - prev->sec) > (trail_segment_time *60))
       {
 
         // Set "new track" flag if long delay between
@@ -4332,7 +4442,30 @@ int store_trail_point(DataRow *p_station,
     // Set "new track" flag for first point received.
     flag |= TR_NEWTRK;
   }
-  ptr->flag = flag;
+  point.flag = flag;
+
+  if (!trail_store_append(&p_station->trail, &point))
+  {
+    if (debug_level & 256)
+    {
+      fprintf(stderr,"store_trail_point: MALLOC failed for trail.\n");
+    }
+    return(0); // Failed due to malloc
+  }
+
+  if (new_trail)
+  {
+    // new trail, do initialization
+
+    if (debug_level & 256)
+    {
+      fprintf(stderr,"Creating new trail.\n");
+    }
+    tracked_stations++;
+
+    // Assign a new trail color 'cuz it's a new trail
+    p_station->trail_color = new_trail_color(p_station->call_sign);
+  }
 
   return(1);  // We succeeded
 }
@@ -4349,7 +4482,8 @@ int is_trailpoint_echo(DataRow *p_station)
   int packets = 1;
   time_t checktime;
   char temp[50];
-  TrackRow *ptr;
+  TrailCursor cursor;
+  TrackRow *ptr = &cursor.point;
 
 
   // Check whether we're to skip checking for dupes (reading in
@@ -4360,18 +4494,16 @@ int is_trailpoint_echo(DataRow *p_station)
     return(0);  // Say that it isn't an echo
   }
 
-  // Start at newest end of linked list and compare.  Return if we're
+  // Start at newest end of the trail and compare.  Return if we're
   // beyond the checktime.
-  ptr = p_station->newest_trackpoint;
-
-  if (ptr == NULL)
+  if (!trail_last(p_station->trail, &cursor))
   {
     return(0);  // first point couldn't be an echo
   }
 
   checktime = p_station->sec_heard - TRAIL_ECHO_TIME*60;
 
-  while (ptr != NULL)
+  do
   {
 
     if (ptr->sec < checktime)
@@ -4401,9 +4533,9 @@ int is_trailpoint_echo(DataRow *p_station)
       }
       return(1);              // we found a delayed echo
     }
-    ptr = ptr->prev;
     packets++;
   }
+  while (trail_prev(&cursor));
   return(0);                      // no echo found
 }
 
@@ -4414,18 +4546,12 @@ int is_trailpoint_echo(DataRow *p_station)
 //
 //  Expire trail points.
 //
-// We now store track data in a doubly-linked list.  Each record has a
-// pointer to the previous and the next record in the list.  The main
-// station record has a pointer to the oldest and the newest end of the
-// chain, and the chain can be traversed in either order.  We use
-// this to advantage by adding records at one end of the list and
-// expiring them at the other.
+// Points are added at the newest end of the trail and expired from
+// the oldest end.
 //
 void expire_trail_points(DataRow *p_station, time_t sec)
 {
   int ii = 0;
-  int done = 0;
-  TrackRow *ptr;
 
 
   //fprintf(stderr,"expire_trail_points: %s\n",p_station->call_sign);
@@ -4435,52 +4561,21 @@ void expire_trail_points(DataRow *p_station, time_t sec)
     fprintf(stderr,"expire_trail_points: %s\n",p_station->call_sign);
   }
 
-  // Check whether we have any track data saved
-  if (p_station->oldest_trackpoint == NULL)
-  {
-    return;     // Nothing to expire
-  }
-
-  // Iterate from oldest->newest trackpoints
-  while (!done && p_station->oldest_trackpoint != NULL)
+  // Iterate from oldest->newest trackpoints until we find one
+  // within the expire time.
+  while (p_station->trail != NULL
+         && (p_station->trail->oldest.sec + sec) < sec_now())
   {
-    ptr = p_station->oldest_trackpoint;
-    if ( (ptr->sec + sec) >= sec_now() )
-    {
-      // New trackpoint, within expire time.  Quit checking
-      // the rest of the trackpoints for this station.
-      done++;
-    }
-    else
-    {
-      //fprintf(stderr,"Found old trackpoint\n");
-
-      // Track too old.  Unlink this trackpoint and free it.
-      p_station->oldest_trackpoint = ptr->next;
-
-      // End of chain in this direction
-      if (p_station->oldest_trackpoint != NULL)
-      {
-        p_station->oldest_trackpoint->prev = NULL;
-      }
-      else
-      {
-        p_station->newest_trackpoint = NULL;
-      }
-
-      // Free up the space used by the expired trackpoint
-      free(ptr);
+    //fprintf(stderr,"Found old trackpoint\n");
 
-      //fprintf(stderr,"Free'ing a trackpoint\n");
-
-      ii++;
+    // Track too old.  Drop it.
+    ii++;
 
-      // Reduce our count of mobile stations if the size of
-      // the track just went to zero.
-      if (p_station->oldest_trackpoint == NULL)
-      {
-        tracked_stations--;
-      }
+    // Reduce our count of mobile stations if the size of
+    // the track just went to zero.
+    if (trail_store_drop_oldest(&p_station->trail) == 0)
+    {
+      tracked_stations--;
     }
   }
 
@@ -4523,7 +4618,7 @@ int delete_comments_and_status(DataRow *fill)
       {
         free(ptr->text_ptr);
       }
-      free(ptr);
+      row_pool_free(&comment_pool, ptr);
       ptr = ptr_next; // Advance to next record
       if (ptr != NULL)
       {
@@ -4549,7 +4644,7 @@ int delete_comments_and_status(DataRow *fill)
       {
         free(ptr->text_ptr);
       }
-      free(ptr);
+      row_pool_free(&comment_pool, ptr);
       ptr = ptr_next; // Advance to next record
       if (ptr != NULL)
       {
@@ -4574,22 +4669,9 @@ int delete_comments_and_status(DataRow *fill)
 int delete_trail(DataRow *fill)
 {
 
-  if (fill->newest_trackpoint != NULL)
+  if (fill->trail != NULL)
   {
-    TrackRow *current;
-    TrackRow *next;
-
-    // Free the TrackRow records
-    current = fill->oldest_trackpoint;
-    while (current != NULL)
-    {
-      next = current->next;
-      free(current);
-      current = next;
-    }
-
-    fill->oldest_trackpoint = NULL;
-    fill->newest_trackpoint = NULL;
+    trail_store_free(&fill->trail);
     tracked_stations--;
     return(1);
   }
@@ -4800,11 +4882,13 @@ void exp_trailstation(FILE *f, DataRow *p_station, int export_format)
   long speed;         // 0.1km/h
   int  course;        // degrees
   long alt;           // 0.1m
-  TrackRow *current;
+  TrailCursor cursor;
+  TrackRow *current = &cursor.point;
+  int have_points;
 
   newtrk = 1;
 
-  current = p_station->oldest_trackpoint;
+  have_points = trail_first(p_station->trail, &cursor);
 
   switch (export_format)
   {
@@ -4817,14 +4901,14 @@ void exp_trailstation(FILE *f, DataRow *p_station, int export_format)
       fprintf(f,"<Placemark>");
       get_iso_datetime(p_station->sec_heard,timestring,True,True);
 
-      if (p_station->origin[0] == '\0')
+      if (OBJECT_DATA(p_station)->origin[0] == '\0')
       {
         fprintf(f,"<name>%s</name>\n",p_station->call_sign);
         fprintf(f,"<description>");
       }
       else
       {
-        fprintf(f,"<name>%s</name>\n<description>Object from %s. \n",p_station->call_sign,p_station->origin);
+        fprintf(f,"<name>%s</name>\n<description>Object from %s. \n",p_station->call_sign,OBJECT_DATA(p_station)->origin);
       }
       // packets received %d last heard %s
       fprintf(f,langcode("WPUPSTI005"),p_station->num_packets, timestring);
@@ -4842,7 +4926,7 @@ void exp_trailstation(FILE *f, DataRow *p_station, int export_format)
           fprintf(f,"<TimeStamp><when>%s</when></TimeStamp>",timestring);
         }
 
-      if (current != NULL)
+      if (have_points)
       {
         // We have trail points, create both a set of time stamp labled point placemarks
         // and a linestring placemark to draw the trail.
@@ -4877,7 +4961,7 @@ void exp_trailstation(FILE *f, DataRow *p_station, int export_format)
         fprintf(f,"</Placemark>\n");
 
         // follow with a set of timestamped placemarks for each point on trail
-        while (current != NULL)
+        do
         {
           lon0   = current->trail_long_pos;                   // Trail segment start
           lat0   = current->trail_lat_pos;
@@ -4898,30 +4982,30 @@ void exp_trailstation(FILE *f, DataRow *p_station, int export_format)
             fprintf(f,"</Placemark>\n");
           }
           // Advance to the next point
-          current = current->next;
         }
+        while (trail_next(&cursor));
         // Prepare to follow with  a trail (as a <LineString/>).
         fprintf(f,"<Placemark>");
-        if (p_station->origin[0] == '\0')
+        if (OBJECT_DATA(p_station)->origin[0] == '\0')
         {
           fprintf(f,"<name>%s (trail)</name>\n",p_station->call_sign);
         }
         else
         {
-          fprintf(f,"<name>%s (trail)</name>\n<description>Object from %s</description>\n",p_station->call_sign,p_station->origin);
+          fprintf(f,"<name>%s (trail)</name>\n<description>Object from %s</description>\n",p_station->call_sign,OBJECT_DATA(p_station)->origin);
         }
       }
       break;
 
     case EXPORT_XASTIR_TRACK:
     default:
-      if (p_station->origin[0] == '\0')
+      if (OBJECT_DATA(p_station)->origin[0] == '\0')
       {
         fprintf(f,"\n#C %s\n",p_station->call_sign);
       }
       else
       {
-        fprintf(f,"\n#O %s %s\n",p_station->call_sign,p_station->origin);
+        fprintf(f,"\n#O %s %s\n",p_station->call_sign,OBJECT_DATA(p_station)->origin);
       }
   }
 
@@ -4930,11 +5014,11 @@ void exp_trailstation(FILE *f, DataRow *p_station, int export_format)
   // there won't be a tracklog.  If the station has moved, then
   // it'll have both.
 
-  // reset current, as we may have moved it past the last trackpoint
-  // while generating kml above.
-  current = p_station->oldest_trackpoint;
+  // reset the cursor, as we may have moved it past the last
+  // trackpoint while generating kml above.
+  have_points = trail_first(p_station->trail, &cursor);
 
-  if (current != NULL)    // We have trail points, loop through
+  if (have_points)    // We have trail points, loop through
   {
     // them.  Skip the most current position
     // because it is included in the
@@ -4948,7 +5032,7 @@ void exp_trailstation(FILE *f, DataRow *p_station, int export_format)
         //default:
         // no heading for set of points
     }
-    while (current != NULL)
+    do
     {
       lon0   = current->trail_long_pos;                   // Trail segment start
       lat0   = current->trail_lat_pos;
@@ -4975,8 +5059,8 @@ void exp_trailstation(FILE *f, DataRow *p_station, int export_format)
       newtrk = 0;
 
       // Advance to the next point
-      current = current->next;
     }
+    while (trail_next(&cursor));
     switch (export_format)
     {
       case EXPORT_KML_TRACK:
@@ -5274,12 +5358,14 @@ void init_station_data(void)
 void init_station(DataRow *p_station)
 {
   // the list pointers should already be set
-  p_station->oldest_trackpoint  = NULL;         // no trail
-  p_station->newest_trackpoint  = NULL;         // no trail
+  p_station->trail              = NULL;         // no trail
   p_station->trail_color        = 0;
   p_station->weather_data       = NULL;         // no weather
   p_station->coord_lat          = 0l;           //  90°N  \ undefined
   p_station->coord_lon          = 0l;           // 180°W  / position
+  p_station->grid_next          = NULL;         // not in spatial index
+  p_station->grid_prev          = NULL;
+  p_station->grid_bucket        = -1;
   p_station->pos_amb            = 0;            // No ambiguity
   p_station->error_ellipse_radius = 600;        // In cm, default 6 meters
   p_station->lat_precision      = 60;           // In 100ths of seconds latitude (60 = 0.01 minutes)
@@ -5289,10 +5375,6 @@ void init_station(DataRow *p_station)
   p_station->sec_heard          = 0;
   p_station->time_sn            = 0;
   p_station->flag               = 0;            // set all flags to inactive
-  p_station->object_retransmit  = -1;           // transmit forever
-  p_station->last_transmit_time = sec_now();    // Used for object/item decaying algorithm
-  p_station->transmit_time_increment = 0;       // Used in data_add()
-  //    p_station->last_modified_time = 0;            // Used for object/item dead-reckoning
   p_station->record_type        = '\0';
   p_station->data_via           = '\0';         // L local, T TNC, I internet, F file
   p_station->heard_via_tnc_port = 0;
@@ -5308,27 +5390,19 @@ void init_station(DataRow *p_station)
   p_station->aprs_symbol.area_object.sqrt_lon_off   = 0;
   p_station->aprs_symbol.area_object.corridor_width = 0;
   //    p_station->station_time_type  = '\0';
-  p_station->origin[0]          = '\0';        // no object
-  p_station->packet_time[0]     = '\0';
+  p_station->object_data        = NULL;         // no object
+  p_station->extra_data         = NULL;
+  p_station->packet_time        = 0;
   p_station->node_path_ptr      = NULL;
-  p_station->pos_time[0]        = '\0';
+  p_station->pos_time           = 0;
   //    p_station->altitude_time[0]   = '\0';
   p_station->altitude[0]        = '\0';
   //    p_station->speed_time[0]      = '\0';
   p_station->speed[0]           = '\0';
   p_station->course[0]          = '\0';
-  p_station->bearing[0]         = '\0';
-  p_station->NRQ[0]             = '\0';
-  p_station->power_gain[0]      = '\0';
-  p_station->signal_gain[0]     = '\0';
-  p_station->signpost[0]        = '\0';
-  p_station->probability_min[0] = '\0';
-  p_station->probability_max[0] = '\0';
   //    p_station->station_time[0]    = '\0';
-  p_station->sats_visible[0]    = '\0';
   p_station->status_data        = NULL;
   p_station->comment_data       = NULL;
-  p_station->df_color           = -1;
 
   // Show that there are no other points associated with this
   // station. We could also zero all the entries of the
@@ -5443,17 +5517,26 @@ void remove_name(DataRow *p_rem)        // todo: return pointer to next element
 
 
   // Update our pointer shortcuts.  Pass the removed hash_key to
-  // the function so that we can try to redo just that hash_key
-  // pointer.
+  // the function so that we can redo just that hash_key pointer.
   if (update_shortcuts)
   {
     //fprintf(stderr,"\t\t\t\t\t\tRemoval of hash key: %i\n", hash_key);
 
-    // The -1 tells the function to redo all of the hash table
-    // pointers because we deleted one of them.  Later we could
-    // optimize this so that only the specific pointer is fixed
-    // up.
-    station_shortcuts_update_function(-1, NULL);
+    // The removed record was the first one in its hash_key
+    // segment, so the next record in the list is the new start
+    // of the segment if it shares the same first two characters.
+    // Otherwise the segment is now empty.  This used to rebuild
+    // all 16384 pointers by walking the entire station list.
+    if (p_rem->n_next != NULL
+        && (p_rem->n_next->call_sign[0] & 0x7f) == (p_rem->call_sign[0] & 0x7f)
+        && (p_rem->n_next->call_sign[1] & 0x7f) == (p_rem->call_sign[1] & 0x7f))
+    {
+      station_shortcuts_update_function(hash_key, p_rem->n_next);
+    }
+    else
+    {
+      station_shortcuts_update_function(hash_key, NULL);
+    }
   }
 }
 
@@ -5650,6 +5733,8 @@ void delete_station_memory(DataRow *p_del)
   {
     return;
   }
+  station_index_remove(p_del);
+  station_grid_remove(p_del);
   remove_name(p_del);
   remove_time(p_del);
   free(p_del);
@@ -5723,6 +5808,7 @@ void delete_station_memory(DataRow *p_del)
                   sizeof(p_new->call_sign),
                   "%s",
                   call);
+  station_index_add(p_new);
   station_count++;
 
   // Do some quick checks to see if we just inserted a new hash
@@ -5907,7 +5993,10 @@ int add_simple_station(DataRow *p_new_station,char *station, char *origin, char
     if (!(p_new_station==NULL))
     {
       // set values for new station based on the database row
-      xastir_snprintf(p_new_station->origin,58,"%s",origin);
+      xastir_snprintf(get_object_data(p_new_station)->origin,
+                      sizeof(p_new_station->object_data->origin),
+                      "%s",
+                      origin);
       p_new_station->aprs_symbol.aprs_symbol = symbol[0];
       p_new_station->aprs_symbol.special_overlay = overlay[0];
       p_new_station->aprs_symbol.aprs_type = aprs_type[0];
@@ -5930,6 +6019,7 @@ int add_simple_station(DataRow *p_new_station,char *station, char *origin, char
 
       // also set flags for the station
       p_new_station->flag |= ST_ACTIVE;
+      station_grid_update(p_new_station);
       if (position_on_extd_screen(p_new_station->coord_lat,p_new_station->coord_lon))
       {
         p_new_station->flag |= (ST_INVIEW);   // set   "In View" flag
@@ -5953,11 +6043,7 @@ int add_simple_station(DataRow *p_new_station,char *station, char *origin, char
         {
           p_new_station->sec_heard = sec_now();
         }
-        (void)strftime(timestring,MAX_TIME,"%m%d%Y%H%M%S",&time);
-        xastir_snprintf(p_new_station->pos_time,
-                        sizeof(p_new_station->pos_time),
-                        "%s",
-                        timestring);
+        p_new_station->pos_time = p_new_station->sec_heard;
       }
       returnvalue = 1;
     }
@@ -6004,291 +6090,1619 @@ void move_station_name(DataRow *p_curr, DataRow *p_name)
 
 
 
-// Update all of the pointers so that they accurately reflect the
-// current state of the station database.
+// Full-callsign index into the station list.
 //
-// NOTE:  This part of the code could be made smarter so that the
-// pointers are updated whenever they are found to be out of whack,
-// instead of zeroing all of them and starting from scratch each
-// time.  Alternate:  Follow the current pointer if non-NULL then go
-// up/down the list to find the current switchover point between
-// letters.
+// station_shortcuts[] only gets us to the start of the run of
+// stations sharing the first two characters of a callsign.  With a
+// full APRS-IS feed some of those runs ("KD", "KC", "N0") hold
+// thousands of records, and every exact lookup walks them.  This is
+// an open-addressing (linear probing) hash table of DataRow
+// pointers keyed on the complete call_sign, which turns exact
+// lookups into a couple of probes.  The keys live in the DataRow
+// records themselves, so the index doesn't own any strings.
 //
-// Better:  Tie into the station insert function.  If a new letter
-// is inserted, or a new station at the beginning of a letter group,
-// run this function to keep things up to date.  That way we won't
-// have to traverse in both directions to find a callsign in the
-// search_station_name() function.
+// Records are added in add_new_station() once the call_sign has been
+// filled in and removed in delete_station_memory().  Moving a record
+// within the name-ordered list (remove_name()/insert_name()) doesn't
+// change its call_sign, so the index doesn't need to know about it.
 //
-// If hash_key_in is -1, we need to redo all of the hash keys.  If
-// it is between 0 and 16383, then we need to redo just that one
-// hash key.  The 2nd parameter is either NULL for a removed record,
-// or a pointer to a new station record in the case of an addition.
+#define STATION_INDEX_MIN_SIZE 4096     // Must be a power of two
+
+static DataRow **station_index = NULL;
+static unsigned int station_index_size = 0;
+static unsigned int station_index_count = 0;
+
+
+
+// FNV-1a hash of the callsign.
 //
-void station_shortcuts_update_function(int hash_key_in, DataRow *p_rem)
+static unsigned int station_index_hash(const char *call)
 {
-  int ii;
-  DataRow *ptr;
-  int prev_hash_key = 0x0000;
-  int hash_key;
+  return(fnv1a_string(FNV1A_INIT, call));
+}
 
 
-  // I just changed the function so that we can pass in the hash_key
-  // that we wish to update:  We should be able to speed things up by
-  // updating one hash key instead of all 16384 pointers.
 
-  if ( (hash_key_in != -1)
-       && (hash_key_in >= 0)
-       && (hash_key_in < 16384) )
-  {
+// Allocate a new table of new_size slots and re-insert all of the
+// current entries.  Returns 0 if we couldn't get the memory, in
+// which case the old table is left alone.
+//
+static int station_index_resize(unsigned int new_size)
+{
+  DataRow **new_index;
+  unsigned int ii, slot;
 
-    // We're adding/changing a hash key entry
-    station_shortcuts[hash_key_in] = p_rem;
-    //fprintf(stderr,"%i ",hash_key_in);
-  }
-  else    // We're removing a hash key entry.
-  {
 
-    // Clear and rebuild the entire hash table.
+  new_index = (DataRow **)calloc(new_size, sizeof(DataRow *));
+  if (new_index == NULL)
+  {
+    fprintf(stderr,"ERROR: we got no memory for the station index\n");
+    return(0);
+  }
 
-    //??????????????????????????????????????????????????
-    // Clear all of the pointers before we begin????
-    //??????????????????????????????????????????????????
-    for (ii = 0; ii < 16384; ii++)
+  for (ii = 0; ii < station_index_size; ii++)
+  {
+    if (station_index[ii] != NULL)
     {
-      station_shortcuts[ii] = NULL;
+      slot = station_index_hash(station_index[ii]->call_sign) & (new_size - 1);
+      while (new_index[slot] != NULL)
+      {
+        slot = (slot + 1) & (new_size - 1);
+      }
+      new_index[slot] = station_index[ii];
     }
+  }
 
-    ptr = n_first;  // Start of list
+  free(station_index);
+  station_index = new_index;
+  station_index_size = new_size;
+  return(1);
+}
 
 
-    // Loop through entire list, writing the pointer into the
-    // station_shortcuts array whenever a new character is
-    // encountered.  Do this until the end of the array or the end
-    // of the list.
-    //
-    while ( (ptr != NULL) && (prev_hash_key < 16384) )
-    {
 
-      // We create the hash key out of the lower 7 bits of the
-      // first two characters, creating a 14-bit key (1 of 16384)
-      //
-      hash_key = (int)((ptr->call_sign[0] & 0x7f) << 7);
-      hash_key = hash_key | (int)(ptr->call_sign[1] & 0x7f);
+// Add a station record to the index.  The call_sign must already be
+// filled in.
+//
+static void station_index_add(DataRow *p_station)
+{
+  unsigned int slot;
 
-      if (hash_key > prev_hash_key)
-      {
 
-        // We found the next hash_key.  Store the pointer at the
-        // correct location.
-        if (hash_key < 16384)
-        {
-          station_shortcuts[hash_key] = ptr;
-          //fprintf(stderr,"%i ", hash_key);
-        }
-        prev_hash_key = hash_key;
+  // Keep the load factor at or below 1/2 so that probe sequences
+  // stay short.
+  if ( (station_index_count + 1) * 2 > station_index_size)
+  {
+    if (!station_index_resize(station_index_size ? station_index_size * 2
+                              : STATION_INDEX_MIN_SIZE))
+    {
+      // No memory.  As long as there's still a free slot we can
+      // keep going, just with longer probe sequences.
+      if (station_index_count + 1 >= station_index_size)
+      {
+        return;
       }
-      ptr = ptr->n_next;
     }
-    //fprintf(stderr,"\n");
+  }
+
+  slot = station_index_hash(p_station->call_sign) & (station_index_size - 1);
+  while (station_index[slot] != NULL)
+  {
+    slot = (slot + 1) & (station_index_size - 1);
+  }
+  station_index[slot] = p_station;
+  station_index_count++;
+}
+
+
+
+// Remove a station record from the index.  Uses backward-shift
+// deletion so that we never need tombstones: entries following the
+// hole in the same probe cluster are moved up if their home slot
+// allows it.
+//
+static void station_index_remove(DataRow *p_station)
+{
+  unsigned int mask, hole, slot, home;
+
+
+  if (station_index_count == 0)
+  {
+    return;
+  }
 
+  mask = station_index_size - 1;
+  hole = station_index_hash(p_station->call_sign) & mask;
+  while (station_index[hole] != p_station)
+  {
+    if (station_index[hole] == NULL)
+    {
+      return;   // Not in the index
+    }
+    hole = (hole + 1) & mask;
   }
+  station_index[hole] = NULL;
+  station_index_count--;
+
+  slot = (hole + 1) & mask;
+  while (station_index[slot] != NULL)
+  {
+    home = station_index_hash(station_index[slot]->call_sign) & mask;
 
+    // Move the entry into the hole unless its home slot lies
+    // cyclically within (hole, slot].
+    if ( ((slot - home) & mask) >= ((slot - hole) & mask) )
+    {
+      station_index[hole] = station_index[slot];
+      station_index[slot] = NULL;
+      hole = slot;
+    }
+    slot = (slot + 1) & mask;
+  }
 }
 
 
 
+// Exact-match lookup of a callsign.  Returns NULL if not found.
+//
+static DataRow *station_index_lookup(char *call)
+{
+  unsigned int slot;
+
+
+  if (station_index_count == 0)
+  {
+    return(NULL);
+  }
+
+  slot = station_index_hash(call) & (station_index_size - 1);
+  while (station_index[slot] != NULL)
+  {
+    if (strcmp(call, station_index[slot]->call_sign) == 0)
+    {
+      return(station_index[slot]);
+    }
+    slot = (slot + 1) & (station_index_size - 1);
+  }
+  return(NULL);
+}
+
 
 
+// Drop all entries from the index, releasing the table.
 //
-// Search station record by callsign
-// Returns a station with a call equal or after the searched one
+static void station_index_clear(void)
+{
+  free(station_index);
+  station_index = NULL;
+  station_index_size = 0;
+  station_index_count = 0;
+}
+
+
+
+
+
+// Spatial index of station positions.
 //
-// We use a doubly-linked list for the stations, so we can traverse
-// in either direction.  We also use a 14-bit hash table created
-// from the first two letters of the call to dump us into the
-// beginning of the correct area that may hold the callsign, which
-// reduces search time quite a bit.  We end up doing a linear search
-// only through a small area of the linked list.
+// display_file() and Station_info() used to walk every station in
+// the database and throw away the ones outside the area they care
+// about, which with a full APRS-IS feed is nearly all of them.  This
+// is a uniform grid over Xastir coordinates.  Each station sits in
+// the cell holding its coord_lon/coord_lat, and cells are hashed
+// into a fixed table of bucket lists, so memory doesn't depend on
+// how much of the world we've heard from.  Stations at the undefined
+// position (0/0) aren't indexed.
 //
-// DK7IN:  I don't look at case, objects and internet names could
-// have lower case.
+// station_grid_update() must be called after a station's position
+// changes.  Records are removed in delete_station_memory().
 //
-int search_station_name(DataRow **p_name, char *call, int exact)
-{
-  int kk;
-  int hash_key;
-  int result;
-  int ok = 1;
+#define STATION_GRID_SHIFT   15         // Cell size 2^15 1/100 sec, ~0.09 deg
+#define STATION_GRID_BUCKETS 65536      // Must be a power of two
 
+static DataRow **station_grid = NULL;
+static unsigned int *station_grid_stamp = NULL;
+static unsigned int station_grid_query_stamp = 0;
+static DataRow **station_grid_result = NULL;
+static int station_grid_result_size = 0;
 
-  (*p_name) = n_first;                                // start of alphabet
 
-  if (call[0] == '\0')
+
+// Cell number for a coordinate, rounding down for negative values.
+//
+static long station_grid_cell(long coord)
+{
+  if (coord >= 0)
   {
-    // If call we're searching for is empty, return n_first as
-    // the pointer.
-    return(0);
+    return(coord >> STATION_GRID_SHIFT);
   }
+  return(-((-coord - 1) >> STATION_GRID_SHIFT) - 1);
+}
 
-  // We create the hash key out of the lower 7 bits of the first
-  // two characters, creating a 14-bit key (1 of 16384)
-  //
-  hash_key = (int)((call[0] & 0x7f) << 7);
-  hash_key = hash_key | (int)(call[1] & 0x7f);
 
-  // Look for a match using hash table lookup
-  //
-  (*p_name) = station_shortcuts[hash_key];
 
-  if ((*p_name) == NULL)      // No hash-table entry found.
-  {
-    int mm;
+static int station_grid_hash(long cell_x, long cell_y)
+{
+  unsigned long hash;
 
-    //fprintf(stderr,"No hash-table entry found: call:%s\n",call);
 
+  hash = ((unsigned long)cell_x * 73856093ul) ^ ((unsigned long)cell_y * 19349663ul);
+  return((int)(hash & (STATION_GRID_BUCKETS - 1)));
+}
 
-    // No index found for that letter.  Walk the array until
-    // we find an entry that is filled.  That'll be our
-    // potential insertion point (insertion into the list will
-    // occur just ahead of the hash entry).
-    for (mm = hash_key; mm < 16384; mm++)
-    {
-      if (station_shortcuts[mm] != NULL)
-      {
-        (*p_name) = station_shortcuts[mm];
-        break;
-      }
-    }
+
+
+// Unlink a station from its bucket.
+//
+void station_grid_remove(DataRow *p_station)
+{
+  if (station_grid == NULL || p_station->grid_bucket < 0)
+  {
+    return;
   }
-//    else {
-//fprintf(stderr,"Hash key %d=%s, searching for call: %s\n",
-//    hash_key,
-//    (*p_name)->call_sign,
-//    call);
-//    }
 
-  // If we got to this point, we either have a NULL pointer or a
-  // real hash-table pointer entry.  A non-NULL pointer means that
-  // we have a match for the lower seven bits of the first two
-  // characters of the callsign.  Check the rest of the callsign,
-  // and jump out of the loop if we get outside the linear search
-  // area (if first two chars are different).
+  if (p_station->grid_prev == NULL)
+  {
+    station_grid[p_station->grid_bucket] = p_station->grid_next;
+  }
+  else
+  {
+    p_station->grid_prev->grid_next = p_station->grid_next;
+  }
+  if (p_station->grid_next != NULL)
+  {
+    p_station->grid_next->grid_prev = p_station->grid_prev;
+  }
 
-  kk = (int)strlen(call);
+  p_station->grid_next = NULL;
+  p_station->grid_prev = NULL;
+  p_station->grid_bucket = -1;
+}
 
-  // Search linearly through list.  Stop at end of list or break.
-  while ( (*p_name) != NULL)
+
+
+// Put a station in the bucket matching its current position.  Cheap
+// if the position hasn't moved it out of its bucket, so it's fine to
+// call this whenever a position might have changed.
+//
+void station_grid_update(DataRow *p_station)
+{
+  int bucket;
+
+
+  if (p_station->coord_lat == 0 && p_station->coord_lon == 0)
   {
+    station_grid_remove(p_station);
+    return;
+  }
 
-    if (exact)
-    {
-      // Check entire string for exact match
-      result = strcmp( call, (*p_name)->call_sign );
-    }
-    else
-    {
-      // Check first part of string for match
-      result = strncmp( call, (*p_name)->call_sign, kk );
-    }
+  if (station_grid == NULL)
+  {
+    station_grid = (DataRow **)calloc(STATION_GRID_BUCKETS, sizeof(DataRow *));
+    CHECKMALLOC(station_grid);
+    station_grid_stamp = (unsigned int *)calloc(STATION_GRID_BUCKETS, sizeof(unsigned int));
+    CHECKMALLOC(station_grid_stamp);
+  }
 
-    if (result < 0)     // We went past the right location.
-    {
-      // We're done.
-      ok = 0;
-      //fprintf(stderr,"Went past possible entry point, searching for call: %s\n",call);
-      break;
-    }
-    else if (result == 0)   // Found a possible match
-    {
-      //fprintf(stderr,"Found possible match: list:%s call:%s\n",
-      //    (*p_name)->call_sign,
-      //    call);
-      break;
-    }
-    else    // Result > 0.  We haven't found it yet.
-    {
-      (*p_name) = (*p_name)->n_next;  // Next element in list
-    }
+  bucket = station_grid_hash(station_grid_cell(p_station->coord_lon),
+                             station_grid_cell(p_station->coord_lat));
+  if (bucket == p_station->grid_bucket)
+  {
+    return;
   }
 
-  // Did we find anything?
-  if ( (*p_name) == NULL)
+  station_grid_remove(p_station);
+
+  p_station->grid_prev = NULL;
+  p_station->grid_next = station_grid[bucket];
+  if (station_grid[bucket] != NULL)
   {
-    ok = 0;
-    //fprintf(stderr,"End of list reached, call: %s\n",call);
-    return(ok); // Nope.  No match found.
+    station_grid[bucket]->grid_prev = p_station;
   }
+  station_grid[bucket] = p_station;
+  p_station->grid_bucket = bucket;
+}
 
-  // If "exact" is set, check that the string lengths match as
-  // well.  If not, we didn't find it.
-  if (exact && ok && strlen((*p_name)->call_sign) != strlen(call))
+
+
+// Drop all entries from the index, releasing the table.  Stations
+// still in the database must be re-added with station_grid_update().
+//
+static void station_grid_clear(void)
+{
+  free(station_grid);
+  station_grid = NULL;
+  free(station_grid_stamp);
+  station_grid_stamp = NULL;
+  station_grid_query_stamp = 0;
+}
+
+
+
+static int station_grid_add_result(DataRow *p_station, int count)
+{
+  if (count >= station_grid_result_size)
   {
-    ok = 0;
+    DataRow **new_result;
+    int new_size;
+
+    new_size = station_grid_result_size ? station_grid_result_size * 2 : 256;
+    new_result = (DataRow **)realloc(station_grid_result, new_size * sizeof(DataRow *));
+    CHECKMALLOC(new_result);
+    station_grid_result = new_result;
+    station_grid_result_size = new_size;
   }
+  station_grid_result[count] = p_station;
+  return(count + 1);
+}
 
-  return(ok);         // if not ok: p_name points to correct insert position in name list
+
+
+// qsort() comparators giving time list and name list order
+//
+static int station_grid_comp_time(const void *a, const void *b)
+{
+  DataRow *p_a = *(DataRow * const *)a;
+  DataRow *p_b = *(DataRow * const *)b;
+
+
+  if (p_a->sec_heard != p_b->sec_heard)
+  {
+    return((p_a->sec_heard < p_b->sec_heard) ? -1 : 1);
+  }
+  return((p_a->time_sn < p_b->time_sn) ? -1 : (p_a->time_sn > p_b->time_sn));
 }
 
 
 
+static int station_grid_comp_name(const void *a, const void *b)
+{
+  return(strcmp((*(DataRow * const *)a)->call_sign,
+                (*(DataRow * const *)b)->call_sign));
+}
 
 
-/*
- *  Search station record by time and time serial number, serial ignored if -1
- *  Returns a station that is equal or older than the search criterium
- */
-int search_station_time(DataRow **p_time, time_t heard, int serial)
+
+// Find all stations with min_lon <= coord_lon <= max_lon and
+// min_lat <= coord_lat <= max_lat.  "*list" is set to an array of
+// them which stays valid until the next call, and the count is
+// returned.  "order" is STATION_GRID_TIME_ORDER (oldest first, like
+// walking t_oldest->t_newer), STATION_GRID_NAME_ORDER (like walking
+// n_first->n_next) or STATION_GRID_ANY_ORDER.
+//
+// Deleted (not ST_ACTIVE) stations are included, as they are in the
+// station lists.  If the area covers more cells than there are
+// stations we just walk the list instead.
+//
+int station_grid_query(long min_lon, long max_lon, long min_lat, long max_lat,
+                       int order, DataRow ***list)
 {
-  int ok = 1;
+  DataRow *p_station;
+  long cell_x, cell_y;
+  long min_x, max_x, min_y, max_y;
+  double cells;
+  int bucket;
+  int count = 0;
 
-  (*p_time) = t_newest;                                 // newest station
-  if (heard == 0)                                     // we want the newest station
+
+  *list = station_grid_result;
+
+  if (min_lon > max_lon || min_lat > max_lat)
   {
-    if (t_newest == NULL)
-    {
-      ok = 0;  // empty list
-    }
+    return(0);
   }
-  else
+
+  min_x = station_grid_cell(min_lon);
+  max_x = station_grid_cell(max_lon);
+  min_y = station_grid_cell(min_lat);
+  max_y = station_grid_cell(max_lat);
+  cells = (double)(max_x - min_x + 1) * (double)(max_y - min_y + 1);
+
+  if (station_grid == NULL || cells > station_count)
   {
-    while((*p_time) != NULL)                        // check time
+    // Cheaper to look at every station, and the list gives us the
+    // order for free
+    p_station = (order == STATION_GRID_TIME_ORDER) ? t_oldest : n_first;
+    while (p_station != NULL)
     {
-      if ((*p_time)->sec_heard <= heard)          // compare
+      if (p_station->coord_lon >= min_lon && p_station->coord_lon <= max_lon
+          && p_station->coord_lat >= min_lat && p_station->coord_lat <= max_lat
+          && !(p_station->coord_lat == 0 && p_station->coord_lon == 0))
       {
-        break;  // found time or earlier
+        count = station_grid_add_result(p_station, count);
       }
-      (*p_time) = (*p_time)->t_older;              // next element
+      p_station = (order == STATION_GRID_TIME_ORDER) ? p_station->t_newer : p_station->n_next;
     }
-    // we now probably have found the entry
-    if ((*p_time) != NULL && (*p_time)->sec_heard == heard)
+    *list = station_grid_result;
+    return(count);
+  }
+
+  // Several cells can hash to one bucket.  Stamp each bucket as we
+  // go so that its stations are only looked at once.
+  if (++station_grid_query_stamp == 0)
+  {
+    memset(station_grid_stamp, 0, STATION_GRID_BUCKETS * sizeof(unsigned int));
+    station_grid_query_stamp = 1;
+  }
+
+  for (cell_y = min_y; cell_y <= max_y; cell_y++)
+  {
+    for (cell_x = min_x; cell_x <= max_x; cell_x++)
     {
-      // we got a match, but there may be more of them
-      if (serial >= 0)                            // check serial number, ignored if -1
+      bucket = station_grid_hash(cell_x, cell_y);
+      if (station_grid_stamp[bucket] == station_grid_query_stamp)
       {
-        while((*p_time) != NULL)                // for unique time index
+        continue;
+      }
+      station_grid_stamp[bucket] = station_grid_query_stamp;
+
+      for (p_station = station_grid[bucket]; p_station != NULL; p_station = p_station->grid_next)
+      {
+        if (p_station->coord_lon >= min_lon && p_station->coord_lon <= max_lon
+            && p_station->coord_lat >= min_lat && p_station->coord_lat <= max_lat)
         {
-          if ((*p_time)->sec_heard == heard && (*p_time)->time_sn <= serial)  // compare
+          count = station_grid_add_result(p_station, count);
+        }
+      }
+    }
+  }
+
+  if (order == STATION_GRID_TIME_ORDER && count > 1)
+  {
+    qsort(station_grid_result, count, sizeof(DataRow *), station_grid_comp_time);
+  }
+  else if (order == STATION_GRID_NAME_ORDER && count > 1)
+  {
+    qsort(station_grid_result, count, sizeof(DataRow *), station_grid_comp_name);
+  }
+
+  *list = station_grid_result;
+  return(count);
+}
+
+
+
+
+
+// Insert a candidate into the k best so far, kept nearest first.
+//
+static void station_grid_nearest_add(DataRow *p_station, double dist, int k,
+                                     DataRow **result, double *best, int *found)
+{
+  int ii;
+
+
+  if (*found == k)
+  {
+    if (dist >= best[k-1])
+    {
+      return;
+    }
+    (*found)--;     // drop the farthest
+  }
+
+  ii = *found;
+  while (ii > 0 && best[ii-1] > dist)
+  {
+    best[ii] = best[ii-1];
+    result[ii] = result[ii-1];
+    ii--;
+  }
+  best[ii] = dist;
+  result[ii] = p_station;
+  (*found)++;
+}
+
+
+
+// Check a station against the filter and the undefined position,
+// then add it to the k best.
+//
+static void station_grid_nearest_test(DataRow *p_station, long lon, long lat,
+                                      double lon_scale, int (*filter)(DataRow *),
+                                      int k, DataRow **result, double *best, int *found)
+{
+  double dx, dy;
+
+
+  if (p_station->coord_lat == 0 && p_station->coord_lon == 0)
+  {
+    return;
+  }
+  if (filter != NULL && !filter(p_station))
+  {
+    return;
+  }
+
+  dx = (double)(p_station->coord_lon - lon) * lon_scale;
+  dy = (double)(p_station->coord_lat - lat);
+  station_grid_nearest_add(p_station, sqrt(dx*dx + dy*dy), k, result, best, found);
+}
+
+
+
+// Find the "k" stations closest to lon/lat (Xastir coordinates) that
+// "filter" accepts (all of them if filter is NULL).  They go into
+// result[], nearest first, and the count is returned, which is less
+// than k only if there aren't that many.  If "dist" isn't NULL it gets
+// the distances in Xastir latitude units (1/100 sec, i.e. about 0.3m).
+// Longitude differences are scaled by the cosine of "lat", which is
+// plenty accurate at the distances where the ordering matters.
+//
+// Searches outward through the spatial index ring by ring, stopping
+// once no unsearched cell can hold anything closer than what we have.
+// If that means looking at more cells than there are stations we walk
+// the station list instead.
+//
+int station_grid_nearest(long lon, long lat, int k, int (*filter)(DataRow *p_station),
+                         DataRow **result, double *dist)
+{
+  DataRow *p_station;
+  double *best;
+  double lon_scale;
+  long cell_x, cell_y;
+  long x, y, ring, step;
+  long cells = 0;
+  int bucket;
+  int found = 0;
+
+
+  if (k <= 0)
+  {
+    return(0);
+  }
+
+  best = (double *)malloc(k * sizeof(double));
+  CHECKMALLOC(best);
+
+  // Xastir latitude runs from 0 at 90N to 64800000 at 90S
+  lon_scale = cos((90.0 - lat / 360000.0) * M_PI / 180.0);
+  if (lon_scale < 0.01)
+  {
+    lon_scale = 0.01;
+  }
+
+  if (station_grid != NULL)
+  {
+    if (++station_grid_query_stamp == 0)
+    {
+      memset(station_grid_stamp, 0, STATION_GRID_BUCKETS * sizeof(unsigned int));
+      station_grid_query_stamp = 1;
+    }
+
+    cell_x = station_grid_cell(lon);
+    cell_y = station_grid_cell(lat);
+
+    for (ring = 0; ; ring++)
+    {
+      // Anything in a cell outside this ring is at least "ring"
+      // whole cells away in both directions
+      if (found == k
+          && best[k-1] <= (double)(ring - 1) * (1l << STATION_GRID_SHIFT) * lon_scale)
+      {
+        break;
+      }
+
+      cells += (ring == 0) ? 1 : 8 * ring;
+      if (cells > station_count
+          || ring > (129600000l >> STATION_GRID_SHIFT))
+      {
+        // Cheaper to look at every station
+        cells = -1;
+        break;
+      }
+
+      for (y = cell_y - ring; y <= cell_y + ring; y++)
+      {
+        // Only the edge of the square on the top and bottom rows
+        step = (y == cell_y - ring || y == cell_y + ring || ring == 0) ? 1 : 2 * ring;
+        for (x = cell_x - ring; x <= cell_x + ring; x += step)
+        {
+          bucket = station_grid_hash(x, y);
+          if (station_grid_stamp[bucket] == station_grid_query_stamp)
           {
-            break;  // found it (same time, maybe earlier SN)
+            continue;
           }
-          if ((*p_time)->sec_heard < heard)   // compare
+          station_grid_stamp[bucket] = station_grid_query_stamp;
+
+          for (p_station = station_grid[bucket]; p_station != NULL; p_station = p_station->grid_next)
           {
-            break;  // found it (earlier time)
+            station_grid_nearest_test(p_station, lon, lat, lon_scale, filter,
+                                      k, result, best, &found);
           }
-          (*p_time) = (*p_time)->t_older;      // consider next element
         }
-        if ((*p_time) == NULL || (*p_time)->sec_heard != heard || (*p_time)->time_sn != serial)
+      }
+    }
+  }
+
+  if (station_grid == NULL || cells < 0)
+  {
+    found = 0;
+    for (p_station = n_first; p_station != NULL; p_station = p_station->n_next)
+    {
+      station_grid_nearest_test(p_station, lon, lat, lon_scale, filter,
+                                k, result, best, &found);
+    }
+  }
+
+  if (dist != NULL)
+  {
+    memcpy(dist, best, found * sizeof(double));
+  }
+  free(best);
+  return(found);
+}
+
+
+
+
+
+// Update all of the pointers so that they accurately reflect the
+// current state of the station database.
+//
+// NOTE:  This part of the code could be made smarter so that the
+// pointers are updated whenever they are found to be out of whack,
+// instead of zeroing all of them and starting from scratch each
+// time.  Alternate:  Follow the current pointer if non-NULL then go
+// up/down the list to find the current switchover point between
+// letters.
+//
+// Better:  Tie into the station insert function.  If a new letter
+// is inserted, or a new station at the beginning of a letter group,
+// run this function to keep things up to date.  That way we won't
+// have to traverse in both directions to find a callsign in the
+// search_station_name() function.
+//
+// If hash_key_in is -1, we need to redo all of the hash keys.  If
+// it is between 0 and 16383, then we need to redo just that one
+// hash key.  The 2nd parameter is either NULL for a removed record,
+// or a pointer to a new station record in the case of an addition.
+//
+void station_shortcuts_update_function(int hash_key_in, DataRow *p_rem)
+{
+  int ii;
+  DataRow *ptr;
+  int prev_hash_key = 0x0000;
+  int hash_key;
+
+
+  // I just changed the function so that we can pass in the hash_key
+  // that we wish to update:  We should be able to speed things up by
+  // updating one hash key instead of all 16384 pointers.
+
+  if ( (hash_key_in != -1)
+       && (hash_key_in >= 0)
+       && (hash_key_in < 16384) )
+  {
+
+    // We're adding/changing a hash key entry
+    station_shortcuts[hash_key_in] = p_rem;
+    //fprintf(stderr,"%i ",hash_key_in);
+  }
+  else    // We're removing a hash key entry.
+  {
+
+    // Clear and rebuild the entire hash table.
+
+    //??????????????????????????????????????????????????
+    // Clear all of the pointers before we begin????
+    //??????????????????????????????????????????????????
+    for (ii = 0; ii < 16384; ii++)
+    {
+      station_shortcuts[ii] = NULL;
+    }
+
+    ptr = n_first;  // Start of list
+
+
+    // Loop through entire list, writing the pointer into the
+    // station_shortcuts array whenever a new character is
+    // encountered.  Do this until the end of the array or the end
+    // of the list.
+    //
+    while ( (ptr != NULL) && (prev_hash_key < 16384) )
+    {
+
+      // We create the hash key out of the lower 7 bits of the
+      // first two characters, creating a 14-bit key (1 of 16384)
+      //
+      hash_key = (int)((ptr->call_sign[0] & 0x7f) << 7);
+      hash_key = hash_key | (int)(ptr->call_sign[1] & 0x7f);
+
+      if (hash_key > prev_hash_key)
+      {
+
+        // We found the next hash_key.  Store the pointer at the
+        // correct location.
+        if (hash_key < 16384)
         {
-          ok = 0;  // no perfect match
+          station_shortcuts[hash_key] = ptr;
+          //fprintf(stderr,"%i ", hash_key);
         }
+        prev_hash_key = hash_key;
       }
+      ptr = ptr->n_next;
     }
-    else
+    //fprintf(stderr,"\n");
+
+  }
+
+}
+
+
+
+
+
+//
+// Search station record by callsign
+// Returns a station with a call equal or after the searched one
+//
+// We use a doubly-linked list for the stations, so we can traverse
+// in either direction.  We also use a 14-bit hash table created
+// from the first two letters of the call to dump us into the
+// beginning of the correct area that may hold the callsign, which
+// reduces search time quite a bit.  We end up doing a linear search
+// only through a small area of the linked list.
+//
+// DK7IN:  I don't look at case, objects and internet names could
+// have lower case.
+//
+int search_station_name(DataRow **p_name, char *call, int exact)
+{
+  int kk;
+  int hash_key;
+  int result;
+  int ok = 1;
+
+
+  (*p_name) = n_first;                                // start of alphabet
+
+  if (call[0] == '\0')
+  {
+    // If call we're searching for is empty, return n_first as
+    // the pointer.
+    return(0);
+  }
+
+  // Exact matches come straight out of the full-callsign index.
+  // On a miss we still walk the name-ordered list below, as the
+  // caller needs the insertion point in *p_name.
+  //
+  if (exact)
+  {
+    (*p_name) = station_index_lookup(call);
+    if ((*p_name) != NULL)
+    {
+      return(1);
+    }
+  }
+
+  // We create the hash key out of the lower 7 bits of the first
+  // two characters, creating a 14-bit key (1 of 16384)
+  //
+  hash_key = (int)((call[0] & 0x7f) << 7);
+  hash_key = hash_key | (int)(call[1] & 0x7f);
+
+  // Look for a match using hash table lookup
+  //
+  (*p_name) = station_shortcuts[hash_key];
+
+  if ((*p_name) == NULL)      // No hash-table entry found.
+  {
+    int mm;
+
+    //fprintf(stderr,"No hash-table entry found: call:%s\n",call);
+
+
+    // No index found for that letter.  Walk the array until
+    // we find an entry that is filled.  That'll be our
+    // potential insertion point (insertion into the list will
+    // occur just ahead of the hash entry).
+    for (mm = hash_key; mm < 16384; mm++)
+    {
+      if (station_shortcuts[mm] != NULL)
+      {
+        (*p_name) = station_shortcuts[mm];
+        break;
+      }
+    }
+  }
+//    else {
+//fprintf(stderr,"Hash key %d=%s, searching for call: %s\n",
+//    hash_key,
+//    (*p_name)->call_sign,
+//    call);
+//    }
+
+  // If we got to this point, we either have a NULL pointer or a
+  // real hash-table pointer entry.  A non-NULL pointer means that
+  // we have a match for the lower seven bits of the first two
+  // characters of the callsign.  Check the rest of the callsign,
+  // and jump out of the loop if we get outside the linear search
+  // area (if first two chars are different).
+
+  kk = (int)strlen(call);
+
+  // Search linearly through list.  Stop at end of list or break.
+  while ( (*p_name) != NULL)
+  {
+
+    if (exact)
+    {
+      // Check entire string for exact match
+      result = strcmp( call, (*p_name)->call_sign );
+    }
+    else
+    {
+      // Check first part of string for match
+      result = strncmp( call, (*p_name)->call_sign, kk );
+    }
+
+    if (result < 0)     // We went past the right location.
+    {
+      // We're done.
+      ok = 0;
+      //fprintf(stderr,"Went past possible entry point, searching for call: %s\n",call);
+      break;
+    }
+    else if (result == 0)   // Found a possible match
+    {
+      //fprintf(stderr,"Found possible match: list:%s call:%s\n",
+      //    (*p_name)->call_sign,
+      //    call);
+      break;
+    }
+    else    // Result > 0.  We haven't found it yet.
+    {
+      (*p_name) = (*p_name)->n_next;  // Next element in list
+    }
+  }
+
+  // Did we find anything?
+  if ( (*p_name) == NULL)
+  {
+    ok = 0;
+    //fprintf(stderr,"End of list reached, call: %s\n",call);
+    return(ok); // Nope.  No match found.
+  }
+
+  // If "exact" is set, check that the string lengths match as
+  // well.  If not, we didn't find it.
+  if (exact && ok && strlen((*p_name)->call_sign) != strlen(call))
+  {
+    ok = 0;
+  }
+
+  return(ok);         // if not ok: p_name points to correct insert position in name list
+}
+
+
+
+
+
+/*
+ *  Search station record by time and time serial number, serial ignored if -1
+ *  Returns a station that is equal or older than the search criterium
+ */
+int search_station_time(DataRow **p_time, time_t heard, int serial)
+{
+  int ok = 1;
+
+  (*p_time) = t_newest;                                 // newest station
+  if (heard == 0)                                     // we want the newest station
+  {
+    if (t_newest == NULL)
+    {
+      ok = 0;  // empty list
+    }
+  }
+  else
+  {
+    while((*p_time) != NULL)                        // check time
+    {
+      if ((*p_time)->sec_heard <= heard)          // compare
+      {
+        break;  // found time or earlier
+      }
+      (*p_time) = (*p_time)->t_older;              // next element
+    }
+    // we now probably have found the entry
+    if ((*p_time) != NULL && (*p_time)->sec_heard == heard)
+    {
+      // we got a match, but there may be more of them
+      if (serial >= 0)                            // check serial number, ignored if -1
+      {
+        while((*p_time) != NULL)                // for unique time index
+        {
+          if ((*p_time)->sec_heard == heard && (*p_time)->time_sn <= serial)  // compare
+          {
+            break;  // found it (same time, maybe earlier SN)
+          }
+          if ((*p_time)->sec_heard < heard)   // compare
+          {
+            break;  // found it (earlier time)
+          }
+          (*p_time) = (*p_time)->t_older;      // consider next element
+        }
+        if ((*p_time) == NULL || (*p_time)->sec_heard != heard || (*p_time)->time_sn != serial)
+        {
+          ok = 0;  // no perfect match
+        }
+      }
+    }
+    else
+    {
+      ok = 0;  // no perfect match
+    }
+  }
+  return(ok);
+}
+
+
+
+
+
+/*
+ *  Get pointer to next station in name sorted list
+ */
+int next_station_name(DataRow **p_curr)
+{
+
+  if ((*p_curr) == NULL)
+  {
+    (*p_curr) = n_first;
+  }
+  else
+  {
+    (*p_curr) = (*p_curr)->n_next;
+  }
+  if ((*p_curr) != NULL)
+  {
+    return(1);
+  }
+  else
+  {
+    return(0);
+  }
+}
+
+
+
+
+
+/*
+ *  Get pointer to previous station in name sorted list
+ */
+int prev_station_name(DataRow **p_curr)
+{
+
+  if ((*p_curr) == NULL)
+  {
+    (*p_curr) = n_last;
+  }
+  else
+  {
+    (*p_curr) = (*p_curr)->n_prev;
+  }
+  if ((*p_curr) != NULL)
+  {
+    return(1);
+  }
+  else
+  {
+    return(0);
+  }
+}
+
+
+
+
+
+/*
+ *  Get pointer to newer station in time sorted list
+ */
+int next_station_time(DataRow **p_curr)
+{
+
+  if ((*p_curr) == NULL)
+  {
+    (*p_curr) = t_oldest;  // Grab oldest station if NULL passed to us???
+  }
+  else
+  {
+    (*p_curr) = (*p_curr)->t_newer;  // Else grab newer station
+  }
+  if ((*p_curr) != NULL)
+  {
+    return(1);
+  }
+  else
+  {
+    return(0);
+  }
+}
+
+
+
+
+
+/*
+ *  Get pointer to older station in time sorted list
+ */
+int prev_station_time(DataRow **p_curr)
+{
+
+  if ((*p_curr) == NULL)
+  {
+    (*p_curr) = t_newest;  // Grab newest station if NULL passed to us???
+  }
+  else
+  {
+    (*p_curr) = (*p_curr)->t_older;
+  }
+  if ((*p_curr) != NULL)
+  {
+    return(1);
+  }
+  else
+  {
+    return(0);
+  }
+}
+
+
+
+
+
+/*
+ *  Area we look at if we want to draw symbols or trails: the
+ *  current view plus a margin around it
+ */
+static void in_view_area(long *min_lon, long *max_lon, long *min_lat, long *max_lat)
+{
+  long marg_lat, marg_lon;                    // margin around screen
+
+  marg_lat = (long)(3 * screen_height * scale_y/2);
+  marg_lon = (long)(3 * screen_width  * scale_x/2);
+  if (marg_lat < IN_VIEW_MIN*60*100)          // allow a minimum area,
+  {
+    marg_lat = IN_VIEW_MIN*60*100;  // there could be outside stations
+  }
+  if (marg_lon < IN_VIEW_MIN*60*100)          // with trail parts on screen
+  {
+    marg_lon = IN_VIEW_MIN*60*100;
+  }
+
+  // Only screen view
+  // min_lat = SE_corner_latitude
+  // max_lat = NW_corner_latitude;
+  // min_lon = NW_corner_longitude;
+  // max_lon = SE_corner_longitude;
+
+  // Screen view plus one screen wide margin
+  // There could be stations off screen with on screen trails
+  // See also the use of position_on_extd_screen()
+  *min_lat = center_latitude  - marg_lat;
+  *max_lat = center_latitude  + marg_lat;
+  *min_lon = center_longitude - marg_lon;
+  *max_lon = center_longitude + marg_lon;
+}
+
+
+
+
+
+// Area used by the last setup_in_view() call, valid if last_in_view_set
+static int last_in_view_set = 0;
+static long last_in_view_min_lon, last_in_view_max_lon;
+static long last_in_view_min_lat, last_in_view_max_lat;
+
+
+
+/*
+ *  Set flag for all stations in current view area or a margin area around it
+ *  That are the stations we look at if we want to draw symbols or trails
+ */
+void setup_in_view(void)
+{
+  DataRow *p_station;
+  DataRow **list;
+  long min_lat, max_lat;                      // screen borders plus space
+  long min_lon, max_lon;                      // for trails from off-screen stations
+  int count, ii;
+
+  in_view_area(&min_lon, &max_lon, &min_lat, &max_lat);
+
+  if (last_in_view_set)
+  {
+    // Stations only get the flag when they're inside the view
+    // area, so clearing the old area and setting the new one is
+    // enough.  Both come from the spatial index.
+    count = station_grid_query(last_in_view_min_lon, last_in_view_max_lon,
+                               last_in_view_min_lat, last_in_view_max_lat,
+                               STATION_GRID_ANY_ORDER, &list);
+    for (ii = 0; ii < count; ii++)
+    {
+      list[ii]->flag &= (~ST_INVIEW);         // clear "In View" flag
+    }
+
+    count = station_grid_query(min_lon, max_lon, min_lat, max_lat,
+                               STATION_GRID_ANY_ORDER, &list);
+    for (ii = 0; ii < count; ii++)
+    {
+      if (list[ii]->flag & ST_ACTIVE)         // ignore deleted objects
+      {
+        list[ii]->flag |= ST_INVIEW;          // set "In View" flag
+      }
+    }
+  }
+  else
+  {
+    p_station = n_first;
+    while (p_station != NULL)
+    {
+      if ((p_station->flag & ST_ACTIVE) == 0        // ignore deleted objects
+          || p_station->coord_lon < min_lon || p_station->coord_lon > max_lon
+          || p_station->coord_lat < min_lat || p_station->coord_lat > max_lat
+          || (p_station->coord_lat == 0 && p_station->coord_lon == 0))
+      {
+        // outside view and undefined stations:
+        p_station->flag &= (~ST_INVIEW);        // clear "In View" flag
+      }
+      else
+      {
+        p_station->flag |= ST_INVIEW;  // set "In View" flag
+      }
+      p_station = p_station->n_next;
+    }
+  }
+
+  last_in_view_min_lon = min_lon;
+  last_in_view_max_lon = max_lon;
+  last_in_view_min_lat = min_lat;
+  last_in_view_max_lat = max_lat;
+  last_in_view_set = 1;
+}
+
+
+
+
+
+/*
+ *  Get the stations in the view area (see setup_in_view()), oldest
+ *  first so that the newest end up on top when drawn in that order.
+ *  The list stays valid until the next station_grid_query() call.
+ */
+int stations_in_view(DataRow ***list)
+{
+  long min_lat, max_lat;
+  long min_lon, max_lon;
+
+  in_view_area(&min_lon, &max_lon, &min_lat, &max_lat);
+  return(station_grid_query(min_lon, max_lon, min_lat, max_lat,
+                            STATION_GRID_TIME_ORDER, list));
+}
+
+
+
+
+
+/*
+ *  Check if position is inside screen borders
+ */
+int position_on_screen(long lat, long lon)
+{
+
+  if (   lon > NW_corner_longitude && lon < SE_corner_longitude
+         && lat > NW_corner_latitude && lat < SE_corner_latitude
+         && !(lat == 0 && lon == 0))     // discard undef positions from screen
+  {
+    return(1);  // position is inside the screen
+  }
+  else
+  {
+    return(0);
+  }
+}
+
+
+
+
+
+/*
+ *  Check if position is inside extended screen borders
+ *  (real screen + one screen margin for trails)
+ *  used for station "In View" flag
+ */
+int position_on_extd_screen(long lat, long lon)
+{
+  long marg_lat, marg_lon;                    // margin around screen
+
+  marg_lat = (long)(3 * screen_height * scale_y/2);
+  marg_lon = (long)(3 * screen_width  * scale_x/2);
+  if (marg_lat < IN_VIEW_MIN*60*100)          // allow a minimum area,
+  {
+    marg_lat = IN_VIEW_MIN*60*100;  // there could be outside stations
+  }
+  if (marg_lon < IN_VIEW_MIN*60*100)          // with trail parts on screen
+  {
+    marg_lon = IN_VIEW_MIN*60*100;
+  }
+
+  if (    labs(lon - center_longitude) < marg_lon
+          && labs(lat - center_latitude)  < marg_lat
+          && !(lat == 0 && lon == 0))    // discard undef positions from screen
+  {
+    return(1);  // position is inside the area
+  }
+  else
+  {
+    return(0);
+  }
+}
+
+
+
+
+
+/*
+ *  Delete single station with all its data    ?? delete messages ??
+ *  This function is called with a callsign parameter.  Only used for
+ *  my callsign, not for any other.
+ */
+void station_del(char *call)
+{
+  DataRow *p_name;                      // DK7IN: do it with move... ?
+
+  if (search_station_name(&p_name, call, 1))
+  {
+    (void)delete_trail(p_name);       // Free track storage if it exists.
+    (void)delete_weather(p_name);     // Free weather memory, if allocated
+    (void)delete_multipoints(p_name); // Free multipoint memory, if allocated
+    (void)delete_comments_and_status(p_name);  // Free comment storage if it exists
+    (void)delete_extensions(p_name);  // Free object/item and extension data
+    if (p_name->node_path_ptr != NULL)// Free malloc'ed path
+    {
+      free(p_name->node_path_ptr);
+    }
+    if (p_name->tactical_call_sign != NULL)
+    {
+      free(p_name->tactical_call_sign);
+    }
+    delete_station_memory(p_name);    // Free memory
+  }
+}
+
+
+
+
+
+/*
+ *  Delete single station with all its data    ?? delete messages ??
+ *  This function is called with a pointer instead of a callsign.
+ */
+void station_del_ptr(DataRow *p_name)
+{
+
+  //fprintf(stderr,"db.c:station_del_ptr(): %s\n",p_name->call_sign);
+
+  if (p_name != NULL)
+  {
+
+    // A bit of debug code:  Attempting to find out if we're
+    // deleting our own objects from time to time.  Leave this
+    // in until we're sure the problem has been fixed.
+    ////        if (is_my_call(p_name->origin,1)) { // Check SSID as well
+    //        if ( is_my_object_item(p_name) ) { // Check SSID as well
+    //            fprintf(stderr,"station_del_ptr: Removing my own object: %s\n",
+    //                p_name->call_sign);
+    //        }
+
+#ifdef EXPIRE_DEBUG
+    fprintf(stderr,"Removing: %s heard %d seconds ago\n",p_name->call_sign, (int)(sec_now() - p_name->sec_heard));
+#endif
+
+    (void)delete_trail(p_name);     // Free track storage if it exists.
+    (void)delete_weather(p_name);   // free weather memory, if allocated
+    (void)delete_multipoints(p_name); // Free multipoint memory, if allocated
+    (void)delete_comments_and_status(p_name);  // Free comment storage if it exists
+    (void)delete_extensions(p_name);  // Free object/item and extension data
+    if (p_name->node_path_ptr != NULL)  // Free malloc'ed path
+    {
+      free(p_name->node_path_ptr);
+    }
+    if (p_name->tactical_call_sign != NULL)
+    {
+      free(p_name->tactical_call_sign);
+    }
+    delete_station_memory(p_name);  // free memory, update
+    // linked lists, update
+    // station_count
+
+    //fprintf(stderr,"db.c:station_del_ptr(): Deleted station\n");
+
+  }
+}
+
+
+
+
+
+/*
+ *  Delete all stations             ?? delete messages ??
+ */
+void delete_all_stations(void)
+{
+  DataRow *p_name;
+  DataRow *p_curr;
+  int ii;
+
+
+  // Clear all of the pointers before we begin
+  for (ii = 0; ii < 16384; ii++)
+  {
+    station_shortcuts[ii] = NULL;
+  }
+  station_index_clear();
+  station_grid_clear();
+
+  p_name = n_first;
+  while (p_name != NULL)
+  {
+    p_curr = p_name;
+    p_name = p_name->n_next;
+
+    // Multipoints all go back to their pool in one go below, so
+    // don't free them one at a time.
+    p_curr->multipoint_data = NULL;
+    p_curr->num_multipoints = 0;
+
+    station_del_ptr(p_curr);
+    //(void)delete_trail(p_curr);     // free trail memory, if allocated
+    //(void)delete_weather(p_curr);   // free weather memory, if allocated
+    //(void)delete_multipoints(p_curr);// Free multipoint memory, if allocated
+    //delete_station_memory(p_curr);  // free station memory
+  }
+  tracked_stations = 0;
+  row_pool_reset(&multipoint_pool);
+  row_pool_reset(&comment_pool);
+  if (station_count != 0)
+  {
+    fprintf(stderr,
+            "ERROR: station_count should be 0 after stations delete, is %d\n",
+            station_count);
+    station_count = 0;
+  }
+}
+
+
+
+
+
+// Pools behind the per-station records, for the statistics display.
+// Returns NULL past the last one.
+//
+row_pool *get_station_row_pool(int index)
+{
+  switch (index)
+  {
+    case 0:
+      return(&comment_pool);
+    case 1:
+      return(&multipoint_pool);
+    default:
+      return(NULL);
+  }
+}
+
+
+
+
+
+/////////////////////////////////////// Station snapshot ///////////////////////////////////////
+
+// The station database is written to a snapshot file now and then and
+// at shutdown, and read back at startup so the stations, their trails
+// and the messages survive a restart.  The file holds the stations in
+// name order, each a DataRow as it is in memory followed by what its
+// pointers point to.  The pointers themselves are meaningless on
+// disk and are fixed up on load.  After the stations comes the time
+// order as indices into the name order, then the messages.
+//
+// The records are written in the native layout, so the header carries
+// the sizes of the structs and the load is refused if any differ.
+// Bump STATION_SNAPSHOT_VERSION on any other change to these structs.
+#define STATION_SNAPSHOT_MAGIC   0x50534e58 // "XNSP"
+#define STATION_SNAPSHOT_VERSION 1
+
+typedef struct
+{
+  uint32_t magic;             // Also catches files from the other byte order
+  uint32_t version;
+  uint32_t layout[8];         // Struct sizes, see station_snapshot_layout()
+  int64_t saved;              // When it was written
+  uint32_t stations;
+  uint32_t messages;
+  int32_t trail_color;        // current_trail_color
+  uint32_t reserved;
+} station_snapshot_header;
+
+#define SNAPSHOT_WEATHER     0x01
+#define SNAPSHOT_OBJECT      0x02
+#define SNAPSHOT_EXTRA       0x04
+#define SNAPSHOT_MULTIPOINTS 0x08
+
+// Precedes each DataRow.  String lengths include the '\0', 0 means a
+// NULL pointer.
+typedef struct
+{
+  uint32_t present;           // SNAPSHOT_* for the optional records
+  uint32_t path_length;
+  uint32_t tactical_length;
+  uint32_t comments;
+  uint32_t statuses;
+  uint32_t trail_count;       // Track points, 0 if no trail
+  uint64_t trail_bytes;       // Delta records between oldest and newest
+} station_snapshot_row;
+
+// Precedes the text of each comment and status line
+typedef struct
+{
+  int64_t sec_heard;
+  uint32_t length;            // Without the '\0'
+  uint32_t reserved;
+} station_snapshot_comment;
+
+// Read position in a loaded snapshot
+typedef struct
+{
+  const char *data;
+  size_t length;
+  size_t offset;
+} station_snapshot_reader;
+
+time_t last_station_snapshot = 0;
+int station_snapshot_interval;  // Minutes between snapshots, 0 for only at shutdown
+
+
+
+
+
+static void station_snapshot_layout(uint32_t *layout)
+{
+  layout[0] = sizeof(DataRow);
+  layout[1] = sizeof(WeatherRow);
+  layout[2] = sizeof(ObjectRow);
+  layout[3] = sizeof(ExtraRow);
+  layout[4] = sizeof(TrackRow);
+  layout[5] = sizeof(Message);
+  layout[6] = sizeof(long);
+  layout[7] = sizeof(time_t);
+}
+
+
+
+
+
+static int station_snapshot_count_comments(CommentRow *ptr)
+{
+  int count = 0;
+
+
+  for ( ; ptr != NULL; ptr = ptr->next)
+  {
+    count++;
+  }
+  return(count);
+}
+
+
+
+
+
+static int station_snapshot_put_comments(FILE *f, CommentRow *ptr)
+{
+  station_snapshot_comment comment;
+  int ok = 1;
+
+
+  for ( ; ptr != NULL; ptr = ptr->next)
+  {
+    memset(&comment, 0, sizeof(comment));
+    comment.sec_heard = ptr->sec_heard;
+    comment.length = (ptr->text_ptr != NULL) ? strlen(ptr->text_ptr) : 0;
+    ok &= (fwrite(&comment, sizeof(comment), 1, f) == 1);
+    if (comment.length > 0)
+    {
+      ok &= (fwrite(ptr->text_ptr, comment.length, 1, f) == 1);
+    }
+  }
+  return(ok);
+}
+
+
+
+
+
+static int station_snapshot_put_station(FILE *f, DataRow *p_station)
+{
+  station_snapshot_row row;
+  int ok = 1;
+
+
+  memset(&row, 0, sizeof(row));
+  if (p_station->weather_data != NULL)
+  {
+    row.present |= SNAPSHOT_WEATHER;
+  }
+  if (p_station->object_data != NULL)
+  {
+    row.present |= SNAPSHOT_OBJECT;
+  }
+  if (p_station->extra_data != NULL)
+  {
+    row.present |= SNAPSHOT_EXTRA;
+  }
+  if (p_station->multipoint_data != NULL && p_station->num_multipoints > 0)
+  {
+    row.present |= SNAPSHOT_MULTIPOINTS;
+  }
+  if (p_station->node_path_ptr != NULL)
+  {
+    row.path_length = strlen(p_station->node_path_ptr) + 1;
+  }
+  if (p_station->tactical_call_sign != NULL)
+  {
+    row.tactical_length = strlen(p_station->tactical_call_sign) + 1;
+  }
+  row.comments = station_snapshot_count_comments(p_station->comment_data);
+  row.statuses = station_snapshot_count_comments(p_station->status_data);
+  if (p_station->trail != NULL)
+  {
+    row.trail_count = p_station->trail->count;
+    row.trail_bytes = p_station->trail->length - p_station->trail->start;
+  }
+
+  ok &= (fwrite(&row, sizeof(row), 1, f) == 1);
+  ok &= (fwrite(p_station, sizeof(DataRow), 1, f) == 1);
+  if (row.path_length > 0)
+  {
+    ok &= (fwrite(p_station->node_path_ptr, row.path_length, 1, f) == 1);
+  }
+  if (row.tactical_length > 0)
+  {
+    ok &= (fwrite(p_station->tactical_call_sign, row.tactical_length, 1, f) == 1);
+  }
+  if (row.present & SNAPSHOT_WEATHER)
+  {
+    ok &= (fwrite(p_station->weather_data, sizeof(WeatherRow), 1, f) == 1);
+  }
+  if (row.present & SNAPSHOT_OBJECT)
+  {
+    ok &= (fwrite(p_station->object_data, sizeof(ObjectRow), 1, f) == 1);
+  }
+  if (row.present & SNAPSHOT_EXTRA)
+  {
+    ok &= (fwrite(p_station->extra_data, sizeof(ExtraRow), 1, f) == 1);
+  }
+  if (row.present & SNAPSHOT_MULTIPOINTS)
+  {
+    ok &= (fwrite(p_station->multipoint_data->multipoints,
+                  sizeof(long) * 2 * p_station->num_multipoints, 1, f) == 1);
+  }
+  if (row.trail_count > 0)
+  {
+    ok &= (fwrite(&p_station->trail->oldest, sizeof(TrackRow), 1, f) == 1);
+    ok &= (fwrite(&p_station->trail->newest, sizeof(TrackRow), 1, f) == 1);
+    if (row.trail_bytes > 0)
     {
-      ok = 0;  // no perfect match
+      ok &= (fwrite(p_station->trail->data + p_station->trail->start,
+                    row.trail_bytes, 1, f) == 1);
     }
   }
+  ok &= station_snapshot_put_comments(f, p_station->comment_data);
+  ok &= station_snapshot_put_comments(f, p_station->status_data);
+
   return(ok);
 }
 
@@ -6296,309 +7710,666 @@ int search_station_time(DataRow **p_time, time_t heard, int serial)
 
 
 
-/*
- *  Get pointer to next station in name sorted list
- */
-int next_station_name(DataRow **p_curr)
+static int station_snapshot_comp_ptr(const void *a, const void *b)
 {
+  const DataRow *pa = **(DataRow * const * const *)a;
+  const DataRow *pb = **(DataRow * const * const *)b;
 
-  if ((*p_curr) == NULL)
+
+  return((pa > pb) - (pa < pb));
+}
+
+
+
+
+
+// Write the station and message database to "filename", by way of a
+// temporary file so a crash halfway leaves the old snapshot alone.
+// Returns 1 if written.
+//
+int write_station_snapshot(char *filename)
+{
+  char temp_file[MAX_VALUE];
+  station_snapshot_header header;
+  DataRow **by_name = NULL;
+  DataRow ***by_address = NULL;
+  DataRow *p_station;
+  DataRow **found;
+  DataRow *key;
+  DataRow **key_ptr;
+  uint32_t index;
+  long stations = 0;
+  long messages = 0;
+  long ii;
+  FILE *f;
+  int ok = 1;
+
+
+  xastir_snprintf(temp_file, sizeof(temp_file), "%s-temp", filename);
+
+  for (p_station = n_first; p_station != NULL; p_station = p_station->n_next)
   {
-    (*p_curr) = n_first;
+    stations++;
   }
-  else
+  for (ii = 0; msg_index && ii < msg_index_end; ii++)
   {
-    (*p_curr) = (*p_curr)->n_next;
+    if (msg_data[msg_index[ii]].active != RECORD_NOTACTIVE)
+    {
+      messages++;
+    }
   }
-  if ((*p_curr) != NULL)
+
+  // To write the time order as name order indices, look stations up
+  // by address in a sorted list of pointers into the name order.
+  if (stations > 0)
   {
-    return(1);
+    by_name = (DataRow **)malloc(stations * sizeof(DataRow *));
+    by_address = (DataRow ***)malloc(stations * sizeof(DataRow **));
+    if (by_name == NULL || by_address == NULL)
+    {
+      free(by_name);
+      free(by_address);
+      return(0);
+    }
+    ii = 0;
+    for (p_station = n_first; p_station != NULL; p_station = p_station->n_next)
+    {
+      by_name[ii] = p_station;
+      by_address[ii] = &by_name[ii];
+      ii++;
+    }
+    qsort(by_address, stations, sizeof(DataRow **), station_snapshot_comp_ptr);
   }
-  else
+
+  f = fopen(temp_file, "w");
+  if (f == NULL)
   {
+    fprintf(stderr, "Couldn't create station snapshot %s\n", temp_file);
+    free(by_name);
+    free(by_address);
     return(0);
   }
-}
-
 
+  memset(&header, 0, sizeof(header));
+  header.magic = STATION_SNAPSHOT_MAGIC;
+  header.version = STATION_SNAPSHOT_VERSION;
+  station_snapshot_layout(header.layout);
+  header.saved = sec_now();
+  header.stations = stations;
+  header.messages = messages;
+  header.trail_color = current_trail_color;
+  ok &= (fwrite(&header, sizeof(header), 1, f) == 1);
 
+  for (ii = 0; ok && ii < stations; ii++)
+  {
+    ok &= station_snapshot_put_station(f, by_name[ii]);
+  }
 
-
-/*
- *  Get pointer to previous station in name sorted list
- */
-int prev_station_name(DataRow **p_curr)
-{
-
-  if ((*p_curr) == NULL)
+  ii = 0;
+  for (p_station = t_oldest; ok && p_station != NULL; p_station = p_station->t_newer)
   {
-    (*p_curr) = n_last;
+    key = p_station;
+    key_ptr = &key;
+    found = bsearch(&key_ptr, by_address, stations, sizeof(DataRow **), station_snapshot_comp_ptr);
+    if (found == NULL)
+    {
+      ok = 0;     // Time list has a station the name list doesn't
+      break;
+    }
+    index = (uint32_t)(*(DataRow ***)found - by_name);
+    ok &= (fwrite(&index, sizeof(index), 1, f) == 1);
+    ii++;
   }
-  else
+  if (ii != stations)
   {
-    (*p_curr) = (*p_curr)->n_prev;
+    ok = 0;
   }
-  if ((*p_curr) != NULL)
+
+  for (ii = 0; ok && msg_index && ii < msg_index_end; ii++)
   {
-    return(1);
+    if (msg_data[msg_index[ii]].active != RECORD_NOTACTIVE)
+    {
+      ok &= (fwrite(&msg_data[msg_index[ii]], sizeof(Message), 1, f) == 1);
+    }
   }
-  else
+
+  free(by_name);
+  free(by_address);
+
+  if (fclose(f) != 0)
+  {
+    ok = 0;
+  }
+  if (!ok || rename(temp_file, filename) != 0)
   {
+    fprintf(stderr, "Couldn't write station snapshot %s\n", filename);
+    unlink(temp_file);
     return(0);
   }
+  return(1);
 }
 
 
 
 
 
-/*
- *  Get pointer to newer station in time sorted list
- */
-int next_station_time(DataRow **p_curr)
+static const void *station_snapshot_get(station_snapshot_reader *reader, size_t size)
 {
+  const void *ptr;
 
-  if ((*p_curr) == NULL)
+
+  if (size > reader->length - reader->offset)
   {
-    (*p_curr) = t_oldest;  // Grab oldest station if NULL passed to us???
+    return(NULL);
   }
-  else
+  ptr = reader->data + reader->offset;
+  reader->offset += size;
+  return(ptr);
+}
+
+
+
+
+
+static char *station_snapshot_get_string(station_snapshot_reader *reader, uint32_t length, size_t size)
+{
+  const char *text;
+  char *string;
+
+
+  text = station_snapshot_get(reader, length);
+  if (text == NULL || length == 0)
   {
-    (*p_curr) = (*p_curr)->t_newer;  // Else grab newer station
+    return(NULL);
   }
-  if ((*p_curr) != NULL)
+  string = (char *)malloc(size > length ? size : length);
+  if (string != NULL)
   {
-    return(1);
+    memcpy(string, text, length);
+    string[length - 1] = '\0';
   }
-  else
+  return(string);
+}
+
+
+
+
+
+static int station_snapshot_get_comments(station_snapshot_reader *reader, uint32_t count, CommentRow **list)
+{
+  station_snapshot_comment comment;
+  const void *ptr;
+  CommentRow **tail = list;
+  CommentRow *row;
+  uint32_t ii;
+
+
+  for (ii = 0; ii < count; ii++)
   {
-    return(0);
+    ptr = station_snapshot_get(reader, sizeof(comment));
+    if (ptr == NULL)
+    {
+      return(0);
+    }
+    memcpy(&comment, ptr, sizeof(comment));
+    ptr = station_snapshot_get(reader, comment.length);
+    if (ptr == NULL)
+    {
+      return(0);
+    }
+
+    row = (CommentRow *)row_pool_alloc(&comment_pool);
+    if (row == NULL)
+    {
+      return(0);
+    }
+    row->sec_heard = (time_t)comment.sec_heard;
+    row->next = NULL;
+    row->text_ptr = (char *)malloc(comment.length + 1);
+    if (row->text_ptr == NULL)
+    {
+      row_pool_free(&comment_pool, row);
+      return(0);
+    }
+    memcpy(row->text_ptr, ptr, comment.length);
+    row->text_ptr[comment.length] = '\0';
+
+    *tail = row;
+    tail = &row->next;
   }
+  return(1);
 }
 
 
 
 
 
-/*
- *  Get pointer to older station in time sorted list
- */
-int prev_station_time(DataRow **p_curr)
+// Fill in the station just read from the snapshot:  reset its links,
+// then read what its pointers pointed to.  Returns 0 if the snapshot
+// ends early or memory runs out, leaving the station safe to delete.
+//
+static int station_snapshot_get_station(station_snapshot_reader *reader, const station_snapshot_row *row,
+                                        DataRow *p_station)
 {
+  const void *ptr;
+  TrackRow oldest;
+  TrackRow newest;
+  int num_multipoints;
 
-  if ((*p_curr) == NULL)
+
+  num_multipoints = p_station->num_multipoints;
+
+  p_station->n_next = NULL;
+  p_station->n_prev = NULL;
+  p_station->t_newer = NULL;
+  p_station->t_older = NULL;
+  p_station->grid_next = NULL;
+  p_station->grid_prev = NULL;
+  p_station->grid_bucket = -1;
+  p_station->tactical_call_sign = NULL;
+  p_station->node_path_ptr = NULL;
+  p_station->weather_data = NULL;
+  p_station->status_data = NULL;
+  p_station->comment_data = NULL;
+  p_station->trail = NULL;
+  p_station->num_multipoints = 0;
+  p_station->multipoint_data = NULL;
+  p_station->object_data = NULL;
+  p_station->extra_data = NULL;
+  p_station->call_sign[MAX_CALLSIGN] = '\0';
+
+  if (row->path_length > 0)
   {
-    (*p_curr) = t_newest;  // Grab newest station if NULL passed to us???
+    p_station->node_path_ptr = station_snapshot_get_string(reader, row->path_length, 0);
+    if (p_station->node_path_ptr == NULL)
+    {
+      return(0);
+    }
   }
-  else
+  if (row->tactical_length > 0)
   {
-    (*p_curr) = (*p_curr)->t_older;
+    // Other code writes up to MAX_TACTICAL_CALL chars into it
+    if (row->tactical_length > MAX_TACTICAL_CALL + 1)
+    {
+      return(0);
+    }
+    p_station->tactical_call_sign = station_snapshot_get_string(reader, row->tactical_length,
+                                    MAX_TACTICAL_CALL + 1);
+    if (p_station->tactical_call_sign == NULL)
+    {
+      return(0);
+    }
   }
-  if ((*p_curr) != NULL)
+  if (row->present & SNAPSHOT_WEATHER)
   {
-    return(1);
+    ptr = station_snapshot_get(reader, sizeof(WeatherRow));
+    if (ptr == NULL || !get_weather_record(p_station))
+    {
+      return(0);
+    }
+    memcpy(p_station->weather_data, ptr, sizeof(WeatherRow));
   }
-  else
+  if (row->present & SNAPSHOT_OBJECT)
+  {
+    ptr = station_snapshot_get(reader, sizeof(ObjectRow));
+    if (ptr == NULL)
+    {
+      return(0);
+    }
+    memcpy(get_object_data(p_station), ptr, sizeof(ObjectRow));
+  }
+  if (row->present & SNAPSHOT_EXTRA)
+  {
+    ptr = station_snapshot_get(reader, sizeof(ExtraRow));
+    if (ptr == NULL)
+    {
+      return(0);
+    }
+    memcpy(get_extra_data(p_station), ptr, sizeof(ExtraRow));
+  }
+  if (row->present & SNAPSHOT_MULTIPOINTS)
+  {
+    if (num_multipoints < 1 || num_multipoints > MAX_MULTIPOINTS)
+    {
+      return(0);
+    }
+    ptr = station_snapshot_get(reader, sizeof(long) * 2 * num_multipoints);
+    if (ptr == NULL)
+    {
+      return(0);
+    }
+    p_station->multipoint_data = row_pool_alloc(&multipoint_pool);
+    if (p_station->multipoint_data == NULL)
+    {
+      return(0);
+    }
+    memcpy(p_station->multipoint_data->multipoints, ptr, sizeof(long) * 2 * num_multipoints);
+    p_station->num_multipoints = num_multipoints;
+  }
+  if (row->trail_count > 0)
+  {
+    ptr = station_snapshot_get(reader, sizeof(TrackRow));
+    if (ptr == NULL)
+    {
+      return(0);
+    }
+    memcpy(&oldest, ptr, sizeof(TrackRow));
+    ptr = station_snapshot_get(reader, sizeof(TrackRow));
+    if (ptr == NULL)
+    {
+      return(0);
+    }
+    memcpy(&newest, ptr, sizeof(TrackRow));
+    if (row->trail_count > INT_MAX || row->trail_bytes > reader->length - reader->offset)
+    {
+      return(0);
+    }
+    ptr = station_snapshot_get(reader, row->trail_bytes);
+    if (!trail_store_restore(&p_station->trail, &oldest, &newest, (int)row->trail_count,
+                             ptr, row->trail_bytes))
+    {
+      return(0);
+    }
+    tracked_stations++;
+  }
+  if (!station_snapshot_get_comments(reader, row->comments, &p_station->comment_data)
+      || !station_snapshot_get_comments(reader, row->statuses, &p_station->status_data))
   {
     return(0);
   }
+  return(1);
 }
 
 
 
 
 
-/*
- *  Set flag for all stations in current view area or a margin area around it
- *  That are the stations we look at if we want to draw symbols or trails
- */
-void setup_in_view(void)
+// Replace the message database with the "count" messages at "reader",
+// unless it already has active messages.  Returns the number of
+// messages restored, or -1 if the snapshot ends early.
+//
+static long station_snapshot_get_messages(station_snapshot_reader *reader, uint32_t count)
 {
-  DataRow *p_station;
-  long min_lat, max_lat;                      // screen borders plus space
-  long min_lon, max_lon;                      // for trails from off-screen stations
-  long marg_lat, marg_lon;                    // margin around screen
+  void *m_ptr;
+  long size;
+  long ii;
 
-  marg_lat = (long)(3 * screen_height * scale_y/2);
-  marg_lon = (long)(3 * screen_width  * scale_x/2);
-  if (marg_lat < IN_VIEW_MIN*60*100)          // allow a minimum area,
+
+  if (count > (reader->length - reader->offset) / sizeof(Message))
   {
-    marg_lat = IN_VIEW_MIN*60*100;  // there could be outside stations
+    return(-1);
   }
-  if (marg_lon < IN_VIEW_MIN*60*100)          // with trail parts on screen
+  for (ii = 0; msg_index && ii < msg_index_end; ii++)
   {
-    marg_lon = IN_VIEW_MIN*60*100;
+    if (msg_data[ii].active != RECORD_NOTACTIVE)
+    {
+      return(0);
+    }
+  }
+  if (count == 0)
+  {
+    return(0);
   }
 
-  // Only screen view
-  // min_lat = SE_corner_latitude
-  // max_lat = NW_corner_latitude;
-  // min_lon = NW_corner_longitude;
-  // max_lon = SE_corner_longitude;
-
-  // Screen view plus one screen wide margin
-  // There could be stations off screen with on screen trails
-  // See also the use of position_on_extd_screen()
-  min_lat = center_latitude  - marg_lat;
-  max_lat = center_latitude  + marg_lat;
-  min_lon = center_longitude - marg_lon;
-  max_lon = center_longitude + marg_lon;
-
-  p_station = n_first;
-  while (p_station != NULL)
+  size = ((count + MSG_INCREMENT - 1) / MSG_INCREMENT) * MSG_INCREMENT;
+  if (size > msg_index_max)
   {
-    if ((p_station->flag & ST_ACTIVE) == 0        // ignore deleted objects
-        || p_station->coord_lon < min_lon || p_station->coord_lon > max_lon
-        || p_station->coord_lat < min_lat || p_station->coord_lat > max_lat
-        || (p_station->coord_lat == 0 && p_station->coord_lon == 0))
+    m_ptr = realloc(msg_data, size * sizeof(Message));
+    if (m_ptr == NULL)
     {
-      // outside view and undefined stations:
-      p_station->flag &= (~ST_INVIEW);        // clear "In View" flag
+      return(0);
     }
-    else
+    msg_data = m_ptr;
+    m_ptr = realloc(msg_index, size * sizeof(long));
+    if (m_ptr == NULL)
     {
-      p_station->flag |= ST_INVIEW;  // set "In View" flag
+      return(0);
     }
-    p_station = p_station->n_next;
+    msg_index = m_ptr;
+    msg_index_max = size;
+  }
+
+  for (ii = 0; ii < (long)count; ii++)
+  {
+    memcpy(&msg_data[ii], station_snapshot_get(reader, sizeof(Message)), sizeof(Message));
+    msg_index[ii] = ii;
   }
+  msg_index_end = count;
+  qsort(msg_index, (size_t)msg_index_end, sizeof(long *), msg_comp_data);
+  return(count);
 }
 
 
 
 
 
-/*
- *  Check if position is inside screen borders
- */
-int position_on_screen(long lat, long lon)
+// Read the stations, their time order and the messages that follow
+// the header.  Returns 0 if the snapshot ends early, doesn't add up or
+// memory runs out, leaving any stations read so far in the lists for
+// the caller to delete.
+//
+static int station_snapshot_load(station_snapshot_reader *reader, const station_snapshot_header *header,
+                                 DataRow **by_name, char *seen, long *messages)
 {
+  station_snapshot_row row;
+  DataRow *p_station;
+  const void *ptr;
+  uint32_t index;
+  uint32_t ii;
+  int ok;
+
+
+  // Stations come in name order, so each one goes at the end of the
+  // name list.  They also go at the end of the time list for now, so
+  // that delete_all_stations() can clean up if the snapshot turns out
+  // to be bad.
+  for (ii = 0; ii < header->stations; ii++)
+  {
+    ptr = station_snapshot_get(reader, sizeof(row));
+    if (ptr == NULL)
+    {
+      return(0);
+    }
+    memcpy(&row, ptr, sizeof(row));
+    ptr = station_snapshot_get(reader, sizeof(DataRow));
+    if (ptr == NULL)
+    {
+      return(0);
+    }
+
+    p_station = (DataRow *)malloc(sizeof(DataRow));
+    if (p_station == NULL)
+    {
+      return(0);
+    }
+    memcpy(p_station, ptr, sizeof(DataRow));
+    ok = station_snapshot_get_station(reader, &row, p_station);
+
+    insert_name(p_station, NULL);
+    insert_time(p_station, NULL);
+    station_index_add(p_station);
+    station_grid_update(p_station);
+    station_count++;
+    by_name[ii] = p_station;
+    if (!ok)
+    {
+      return(0);
+    }
+  }
 
-  if (   lon > NW_corner_longitude && lon < SE_corner_longitude
-         && lat > NW_corner_latitude && lat < SE_corner_latitude
-         && !(lat == 0 && lon == 0))     // discard undef positions from screen
+  // Check the time order before relinking anything
+  ptr = station_snapshot_get(reader, header->stations * sizeof(uint32_t));
+  if (ptr == NULL)
   {
-    return(1);  // position is inside the screen
+    return(0);
   }
-  else
+  for (ii = 0; ii < header->stations; ii++)
   {
-    return(0);
+    memcpy(&index, (const char *)ptr + ii * sizeof(uint32_t), sizeof(index));
+    if (index >= header->stations || seen[index])
+    {
+      return(0);
+    }
+    seen[index] = 1;
+  }
+  t_oldest = NULL;
+  t_newest = NULL;
+  for (ii = 0; ii < header->stations; ii++)
+  {
+    memcpy(&index, (const char *)ptr + ii * sizeof(uint32_t), sizeof(index));
+    insert_time(by_name[index], NULL);
   }
+
+  *messages = station_snapshot_get_messages(reader, header->messages);
+  return(*messages >= 0);
 }
 
 
 
 
 
-/*
- *  Check if position is inside extended screen borders
- *  (real screen + one screen margin for trails)
- *  used for station "In View" flag
- */
-int position_on_extd_screen(long lat, long lon)
+// Load the station and message database from a snapshot written by
+// write_station_snapshot().  Only done into an empty station list.
+// Returns the number of stations restored, 0 if there's no snapshot
+// or it can't be used.
+//
+int read_station_snapshot(char *filename)
 {
-  long marg_lat, marg_lon;                    // margin around screen
+  station_snapshot_reader reader;
+  station_snapshot_header header;
+  uint32_t layout[8];
+  DataRow **by_name = NULL;
+  char *seen = NULL;
+  struct stat sb;
+  char *data;
+  long messages = 0;
+  int ok = 0;
+  int fd;
 
-  marg_lat = (long)(3 * screen_height * scale_y/2);
-  marg_lon = (long)(3 * screen_width  * scale_x/2);
-  if (marg_lat < IN_VIEW_MIN*60*100)          // allow a minimum area,
+
+  if (n_first != NULL)
   {
-    marg_lat = IN_VIEW_MIN*60*100;  // there could be outside stations
+    return(0);
   }
-  if (marg_lon < IN_VIEW_MIN*60*100)          // with trail parts on screen
+
+  fd = open(filename, O_RDONLY);
+  if (fd < 0)
   {
-    marg_lon = IN_VIEW_MIN*60*100;
+    return(0);
+  }
+  if (fstat(fd, &sb) != 0 || sb.st_size < (off_t)sizeof(header))
+  {
+    close(fd);
+    return(0);
   }
 
-  if (    labs(lon - center_longitude) < marg_lon
-          && labs(lat - center_latitude)  < marg_lat
-          && !(lat == 0 && lon == 0))    // discard undef positions from screen
+#ifdef HAVE_MMAP
+  data = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (data == MAP_FAILED)
   {
-    return(1);  // position is inside the area
+    close(fd);
+    return(0);
   }
-  else
+#ifdef MADV_SEQUENTIAL
+  (void)madvise(data, sb.st_size, MADV_SEQUENTIAL);
+#endif  // MADV_SEQUENTIAL
+#else   // HAVE_MMAP
+  data = malloc(sb.st_size);
+  if (data == NULL || read(fd, data, sb.st_size) != (ssize_t)sb.st_size)
   {
+    free(data);
+    close(fd);
     return(0);
   }
-}
-
-
-
+#endif  // HAVE_MMAP
+  close(fd);
 
+  reader.data = data;
+  reader.length = sb.st_size;
+  reader.offset = 0;
 
-/*
- *  Delete single station with all its data    ?? delete messages ??
- *  This function is called with a callsign parameter.  Only used for
- *  my callsign, not for any other.
- */
-void station_del(char *call)
-{
-  DataRow *p_name;                      // DK7IN: do it with move... ?
-
-  if (search_station_name(&p_name, call, 1))
+  memcpy(&header, station_snapshot_get(&reader, sizeof(header)), sizeof(header));
+  station_snapshot_layout(layout);
+  if (header.magic != STATION_SNAPSHOT_MAGIC
+      || header.version != STATION_SNAPSHOT_VERSION
+      || memcmp(header.layout, layout, sizeof(layout)) != 0)
   {
-    (void)delete_trail(p_name);       // Free track storage if it exists.
-    (void)delete_weather(p_name);     // Free weather memory, if allocated
-    (void)delete_multipoints(p_name); // Free multipoint memory, if allocated
-    (void)delete_comments_and_status(p_name);  // Free comment storage if it exists
-    if (p_name->node_path_ptr != NULL)// Free malloc'ed path
+    fprintf(stderr, "Station snapshot %s is from another version, not loaded\n", filename);
+  }
+  else if (header.stations > (reader.length - reader.offset) / sizeof(DataRow))
+  {
+    fprintf(stderr, "Station snapshot %s is damaged, not loaded\n", filename);
+  }
+  else
+  {
+    if (header.stations > 0)
     {
-      free(p_name->node_path_ptr);
+      by_name = (DataRow **)calloc(header.stations, sizeof(DataRow *));
+      seen = (char *)calloc(header.stations, 1);
     }
-    if (p_name->tactical_call_sign != NULL)
+    if (header.stations == 0 || (by_name != NULL && seen != NULL))
     {
-      free(p_name->tactical_call_sign);
+      ok = station_snapshot_load(&reader, &header, by_name, seen, &messages);
     }
-    delete_station_memory(p_name);    // Free memory
+    if (ok)
+    {
+      station_shortcuts_update_function(-1, NULL);
+      current_trail_color = header.trail_color;
+    }
+    else
+    {
+      fprintf(stderr, "Station snapshot %s is damaged, not loaded\n", filename);
+      delete_all_stations();
+    }
+    free(by_name);
+    free(seen);
+  }
+
+#ifdef HAVE_MMAP
+  (void)munmap(data, sb.st_size);
+#else   // HAVE_MMAP
+  free(data);
+#endif  // HAVE_MMAP
+
+  if (ok && header.stations > 0)
+  {
+    fprintf(stderr, "Restored %u stations and %ld messages from %s\n",
+            header.stations, messages, filename);
   }
+  return(ok ? (int)header.stations : 0);
 }
 
 
 
 
 
-/*
- *  Delete single station with all its data    ?? delete messages ??
- *  This function is called with a pointer instead of a callsign.
- */
-void station_del_ptr(DataRow *p_name)
+static char *station_snapshot_file(char *file, int file_size)
 {
+  return(get_user_base_dir("config/stations.snapshot", file, file_size));
+}
 
-  //fprintf(stderr,"db.c:station_del_ptr(): %s\n",p_name->call_sign);
 
-  if (p_name != NULL)
-  {
 
-    // A bit of debug code:  Attempting to find out if we're
-    // deleting our own objects from time to time.  Leave this
-    // in until we're sure the problem has been fixed.
-    ////        if (is_my_call(p_name->origin,1)) { // Check SSID as well
-    //        if ( is_my_object_item(p_name) ) { // Check SSID as well
-    //            fprintf(stderr,"station_del_ptr: Removing my own object: %s\n",
-    //                p_name->call_sign);
-    //        }
 
-#ifdef EXPIRE_DEBUG
-    fprintf(stderr,"Removing: %s heard %d seconds ago\n",p_name->call_sign, (int)(sec_now() - p_name->sec_heard));
-#endif
 
-    (void)delete_trail(p_name);     // Free track storage if it exists.
-    (void)delete_weather(p_name);   // free weather memory, if allocated
-    (void)delete_multipoints(p_name); // Free multipoint memory, if allocated
-    (void)delete_comments_and_status(p_name);  // Free comment storage if it exists
-    if (p_name->node_path_ptr != NULL)  // Free malloc'ed path
-    {
-      free(p_name->node_path_ptr);
-    }
-    if (p_name->tactical_call_sign != NULL)
-    {
-      free(p_name->tactical_call_sign);
-    }
-    delete_station_memory(p_name);  // free memory, update
-    // linked lists, update
-    // station_count
+// Write the snapshot every station_snapshot_interval minutes.
+//
+// Called from main.c:UpdateTime() on a periodic basis.
+//
+void check_station_snapshot(time_t curr_sec)
+{
+  char file[MAX_VALUE];
 
-    //fprintf(stderr,"db.c:station_del_ptr(): Deleted station\n");
 
+  if (last_station_snapshot == 0)
+  {
+    last_station_snapshot = curr_sec;
+  }
+  if (station_snapshot_interval > 0
+      && curr_sec >= last_station_snapshot + station_snapshot_interval * 60)
+  {
+    (void)write_station_snapshot(station_snapshot_file(file, sizeof(file)));
+    last_station_snapshot = curr_sec;
   }
 }
 
@@ -6606,40 +8377,29 @@ void station_del_ptr(DataRow *p_name)
 
 
 
-/*
- *  Delete all stations             ?? delete messages ??
- */
-void delete_all_stations(void)
+// Write the snapshot now, at shutdown.
+//
+void save_station_snapshot(void)
 {
-  DataRow *p_name;
-  DataRow *p_curr;
-  int ii;
+  char file[MAX_VALUE];
 
 
-  // Clear all of the pointers before we begin
-  for (ii = 0; ii < 16384; ii++)
-  {
-    station_shortcuts[ii] = NULL;
-  }
+  (void)write_station_snapshot(station_snapshot_file(file, sizeof(file)));
+}
 
-  p_name = n_first;
-  while (p_name != NULL)
-  {
-    p_curr = p_name;
-    p_name = p_name->n_next;
-    station_del_ptr(p_curr);
-    //(void)delete_trail(p_curr);     // free trail memory, if allocated
-    //(void)delete_weather(p_curr);   // free weather memory, if allocated
-    //(void)delete_multipoints(p_curr);// Free multipoint memory, if allocated
-    //delete_station_memory(p_curr);  // free station memory
-  }
-  if (station_count != 0)
-  {
-    fprintf(stderr,
-            "ERROR: station_count should be 0 after stations delete, is %d\n",
-            station_count);
-    station_count = 0;
-  }
+
+
+
+
+// Load the snapshot, at startup.
+//
+void load_station_snapshot(void)
+{
+  char file[MAX_VALUE];
+
+
+  (void)read_station_snapshot(station_snapshot_file(file, sizeof(file)));
+  last_station_snapshot = sec_now();
 }
 
 
@@ -7335,23 +9095,23 @@ int extract_comp_position(DataRow *p_station, char **info, int UNUSED(type) )
           // DK7IN: dirty hack...  but better than nothing
           if (s <= 5)                         // 2.9387 mi
           {
-            xastir_snprintf(p_station->power_gain, sizeof(p_station->power_gain), "PHG%s0", "000");
+            xastir_snprintf(get_extra_data(p_station)->power_gain, sizeof(p_station->extra_data->power_gain), "PHG%s0", "000");
           }
           else if (s <= 17)                   // 7.40 mi
           {
-            xastir_snprintf(p_station->power_gain, sizeof(p_station->power_gain), "PHG%s0", "111");
+            xastir_snprintf(get_extra_data(p_station)->power_gain, sizeof(p_station->extra_data->power_gain), "PHG%s0", "111");
           }
           else if (s <= 36)                   // 31.936 mi
           {
-            xastir_snprintf(p_station->power_gain, sizeof(p_station->power_gain), "PHG%s0", "222");
+            xastir_snprintf(get_extra_data(p_station)->power_gain, sizeof(p_station->extra_data->power_gain), "PHG%s0", "222");
           }
           else if (s <= 75)                   // 642.41 mi
           {
-            xastir_snprintf(p_station->power_gain, sizeof(p_station->power_gain), "PHG%s0", "333");
+            xastir_snprintf(get_extra_data(p_station)->power_gain, sizeof(p_station->extra_data->power_gain), "PHG%s0", "333");
           }
           else                       // max 90:  2037.8 mi
           {
-            xastir_snprintf(p_station->power_gain, sizeof(p_station->power_gain), "PHG%s0", "444");
+            xastir_snprintf(get_extra_data(p_station)->power_gain, sizeof(p_station->extra_data->power_gain), "PHG%s0", "444");
           }
         }
       }
@@ -8182,15 +9942,15 @@ void process_data_extension(DataRow *p_station, char *data, int UNUSED(type) )
       if (extract_bearing_NRQ(data, bearing, nrq))    // Beam headings from DF'ing
       {
         //fprintf(stderr,"extracted bearing and NRQ\n");
-        xastir_snprintf(p_station->bearing,
-                        sizeof(p_station->bearing),
+        xastir_snprintf(get_extra_data(p_station)->bearing,
+                        sizeof(p_station->extra_data->bearing),
                         "%s",
                         bearing);
-        xastir_snprintf(p_station->NRQ,
-                        sizeof(p_station->NRQ),
+        xastir_snprintf(get_extra_data(p_station)->NRQ,
+                        sizeof(p_station->extra_data->NRQ),
                         "%s",
                         nrq);
-        p_station->signal_gain[0] = '\0';   // And blank out the shgd values
+        p_station->extra_data->signal_gain[0] = '\0';   // And blank out the shgd values
       }
     }
     // Don't try to extract speed & course if a compressed
@@ -8200,15 +9960,15 @@ void process_data_extension(DataRow *p_station, char *data, int UNUSED(type) )
     {
 
       //fprintf(stderr,"extracted bearing and NRQ\n");
-      xastir_snprintf(p_station->bearing,
-                      sizeof(p_station->bearing),
+      xastir_snprintf(get_extra_data(p_station)->bearing,
+                      sizeof(p_station->extra_data->bearing),
                       "%s",
                       bearing);
-      xastir_snprintf(p_station->NRQ,
-                      sizeof(p_station->NRQ),
+      xastir_snprintf(get_extra_data(p_station)->NRQ,
+                      sizeof(p_station->extra_data->NRQ),
                       "%s",
                       nrq);
-      p_station->signal_gain[0] = '\0';   // And blank out the shgd values
+      p_station->extra_data->signal_gain[0] = '\0';   // And blank out the shgd values
     }
     else
     {
@@ -8217,35 +9977,35 @@ void process_data_extension(DataRow *p_station, char *data, int UNUSED(type) )
 
         //fprintf(stderr,"Found power_gain: %s\n", temp1);
 
-        xastir_snprintf(p_station->power_gain,
-                        sizeof(p_station->power_gain),
+        xastir_snprintf(get_extra_data(p_station)->power_gain,
+                        sizeof(p_station->extra_data->power_gain),
                         "%s",
                         temp1);
 
         if (extract_bearing_NRQ(data, bearing, nrq))    // Beam headings from DF'ing
         {
           //fprintf(stderr,"extracted bearing and NRQ\n");
-          xastir_snprintf(p_station->bearing,
-                          sizeof(p_station->bearing),
+          xastir_snprintf(get_extra_data(p_station)->bearing,
+                          sizeof(p_station->extra_data->bearing),
                           "%s",
                           bearing);
-          xastir_snprintf(p_station->NRQ,
-                          sizeof(p_station->NRQ),
+          xastir_snprintf(get_extra_data(p_station)->NRQ,
+                          sizeof(p_station->extra_data->NRQ),
                           "%s",
                           nrq);
-          p_station->signal_gain[0] = '\0';   // And blank out the shgd values
+          p_station->extra_data->signal_gain[0] = '\0';   // And blank out the shgd values
         }
       }
       else
       {
         if (extract_omnidf(data,temp1))
         {
-          xastir_snprintf(p_station->signal_gain,
-                          sizeof(p_station->signal_gain),
+          xastir_snprintf(get_extra_data(p_station)->signal_gain,
+                          sizeof(p_station->extra_data->signal_gain),
                           "%s",
                           temp1);   // Grab the SHGD values
-          p_station->bearing[0] = '\0';   // And blank out the bearing/NRQ values
-          p_station->NRQ[0] = '\0';
+          p_station->extra_data->bearing[0] = '\0';   // And blank out the bearing/NRQ values
+          p_station->extra_data->NRQ[0] = '\0';
 
           // The spec shows speed/course before DFS, but example packets that
           // come with DOSaprs show DFSxxxx/speed/course.  We'll take care of
@@ -8273,12 +10033,12 @@ void process_data_extension(DataRow *p_station, char *data, int UNUSED(type) )
           if (extract_bearing_NRQ(data, bearing, nrq))    // Beam headings from DF'ing
           {
             //fprintf(stderr,"extracted bearing and NRQ\n");
-            xastir_snprintf(p_station->bearing,
-                            sizeof(p_station->bearing),
+            xastir_snprintf(get_extra_data(p_station)->bearing,
+                            sizeof(p_station->extra_data->bearing),
                             "%s",
                             bearing);
-            xastir_snprintf(p_station->NRQ,
-                            sizeof(p_station->NRQ),
+            xastir_snprintf(get_extra_data(p_station)->NRQ,
+                            sizeof(p_station->extra_data->NRQ),
                             "%s",
                             nrq);
             //p_station->signal_gain[0] = '\0';   // And blank out the shgd values
@@ -8291,48 +10051,66 @@ void process_data_extension(DataRow *p_station, char *data, int UNUSED(type) )
     {
       if (strncasecmp(temp3, "0.0", sizeof(temp3)) == 0)
       {
-        p_station->probability_min[0] = '\0';   // Clear it out
+        if (p_station->object_data != NULL)
+        {
+          p_station->object_data->probability_min[0] = '\0';   // Clear it out
+        }
       }
       else if (strncasecmp(temp3, "0", sizeof(temp3)) == 0)
       {
-        p_station->probability_min[0] = '\0';   // Clear it out
+        if (p_station->object_data != NULL)
+        {
+          p_station->object_data->probability_min[0] = '\0';   // Clear it out
+        }
       }
       else
       {
         //fprintf(stderr,"extracted probability_min data: %s\n",temp3);
-        xastir_snprintf(p_station->probability_min,
-                        sizeof(p_station->probability_min),
+        xastir_snprintf(get_object_data(p_station)->probability_min,
+                        sizeof(p_station->object_data->probability_min),
                         "%s",
                         temp3);
       }
     }
     else
     {
-      p_station->probability_min[0] = '\0';   // Clear it out
+      if (p_station->object_data != NULL)
+      {
+        p_station->object_data->probability_min[0] = '\0';   // Clear it out
+      }
     }
 
     if (extract_probability_max(data, temp3, sizeof(temp3)))
     {
       if (strncasecmp(temp3, "0.0", sizeof(temp3)) == 0)
       {
-        p_station->probability_max[0] = '\0';   // Clear it out
+        if (p_station->object_data != NULL)
+        {
+          p_station->object_data->probability_max[0] = '\0';   // Clear it out
+        }
       }
       else if (strncasecmp(temp3, "0", sizeof(temp3)) == 0)
       {
-        p_station->probability_max[0] = '\0';   // Clear it out
+        if (p_station->object_data != NULL)
+        {
+          p_station->object_data->probability_max[0] = '\0';   // Clear it out
+        }
       }
       else
       {
         //fprintf(stderr,"extracted probability_max data: %s\n",temp3);
-        xastir_snprintf(p_station->probability_max,
-                        sizeof(p_station->probability_max),
+        xastir_snprintf(get_object_data(p_station)->probability_max,
+                        sizeof(p_station->object_data->probability_max),
                         "%s",
                         temp3);
       }
     }
     else
     {
-      p_station->probability_max[0] = '\0';   // Clear it out
+      if (p_station->object_data != NULL)
+      {
+        p_station->object_data->probability_max[0] = '\0';   // Clear it out
+      }
     }
   }
 }
@@ -8365,8 +10143,8 @@ void process_info_field(DataRow *p_station, char *info, int UNUSED(type) )
     char temp_signpost[3+1];
     if (extract_signpost(info, temp_signpost))
     {
-      xastir_snprintf(p_station->signpost,
-                      sizeof(p_station->signpost),
+      xastir_snprintf(get_object_data(p_station)->signpost,
+                      sizeof(p_station->object_data->signpost),
                       "%s",
                       temp_signpost);
     }
@@ -8419,7 +10197,6 @@ void process_info_field(DataRow *p_station, char *info, int UNUSED(type) )
 //
 int extract_RMC(DataRow *p_station, char *data, char *call_sign, char *path, int *num_digits)
 {
-  char temp_data[40]; // short term string storage, MAX_CALLSIGN, ...  ???
   char lat_s[20];
   char long_s[20];
   int ok;
@@ -8448,10 +10225,7 @@ int extract_RMC(DataRow *p_station, char *data, char *call_sign, char *path, int
   p_station->record_type = NORMAL_GPS_RMC;
   // Create a timestamp from the current time
   // get_time saves the time in temp_data
-  xastir_snprintf(p_station->pos_time,
-                  sizeof(p_station->pos_time),
-                  "%s",
-                  get_time(temp_data));
+  p_station->pos_time = sec_now();
   p_station->flag &= (~ST_MSGCAP);    // clear "message capable" flag
 
   /* check aprs type on call sign */
@@ -8642,7 +10416,6 @@ int extract_RMC(DataRow *p_station, char *data, char *call_sign, char *path, int
 //
 int extract_GGA(DataRow *p_station,char *data,char *call_sign, char *path, int *num_digits)
 {
-  char temp_data[40]; // short term string storage, MAX_CALLSIGN, ...  ???
   char lat_s[20];
   char long_s[20];
   int  ok;
@@ -8667,10 +10440,7 @@ int extract_GGA(DataRow *p_station,char *data,char *call_sign, char *path, int *
   p_station->record_type = NORMAL_GPS_GGA;
   // Create a timestamp from the current time
   // get_time saves the time in temp_data
-  xastir_snprintf(p_station->pos_time,
-                  sizeof(p_station->pos_time),
-                  "%s",
-                  get_time(temp_data));
+  p_station->pos_time = sec_now();
   p_station->flag &= (~ST_MSGCAP);    // clear "message capable" flag
 
   /* check aprs type on call sign */
@@ -8783,7 +10553,10 @@ int extract_GGA(DataRow *p_station,char *data,char *call_sign, char *path, int *
       || Substring[8] == NULL        // hdop
       || Substring[9] == NULL)       // Altitude in meters
   {
-    p_station->sats_visible[0] = '\0'; // Store empty sats visible
+    if (p_station->extra_data != NULL)
+    {
+      p_station->extra_data->sats_visible[0] = '\0'; // Store empty sats visible
+    }
     p_station->altitude[0] = '\0';;    // Store empty altitude
     return(ok); // A field between fix quality and altitude is missing
   }
@@ -8797,8 +10570,8 @@ int extract_GGA(DataRow *p_station,char *data,char *call_sign, char *path, int *
   else
   {
     // Store
-    xastir_snprintf(p_station->sats_visible,
-                    sizeof(p_station->sats_visible),
+    xastir_snprintf(get_extra_data(p_station)->sats_visible,
+                    sizeof(p_station->extra_data->sats_visible),
                     "%d",
                     temp_num);
   }
@@ -8858,7 +10631,6 @@ int extract_GGA(DataRow *p_station,char *data,char *call_sign, char *path, int *
 //
 int extract_GLL(DataRow *p_station,char *data,char *call_sign, char *path, int *num_digits)
 {
-  char temp_data[40]; // short term string storage, MAX_CALLSIGN, ...  ???
   char lat_s[20];
   char long_s[20];
   int ok;
@@ -8882,10 +10654,7 @@ int extract_GLL(DataRow *p_station,char *data,char *call_sign, char *path, int *
   p_station->record_type = NORMAL_GPS_GLL;
   // Create a timestamp from the current time
   // get_time saves the time in temp_data
-  xastir_snprintf(p_station->pos_time,
-                  sizeof(p_station->pos_time),
-                  "%s",
-                  get_time(temp_data));
+  p_station->pos_time = sec_now();
   p_station->flag &= (~ST_MSGCAP);    // clear "message capable" flag
 
   /* check aprs type on call sign */
@@ -9090,7 +10859,7 @@ void add_status(DataRow *p_station, char *status_string)
 
             // Free the record
             free(ptr3->text_ptr);
-            free(ptr3);
+            row_pool_free(&comment_pool, ptr3);
 
             // Muck with the counter 'cuz we just
             // deleted one record
@@ -9134,7 +10903,7 @@ void add_status(DataRow *p_station, char *status_string)
         // record in ptr2->next.  Free it and the text
         // string in it.
         free(ptr2->next->text_ptr);
-        free(ptr2->next);
+        row_pool_free(&comment_pool, ptr2->next);
         ptr2->next = NULL;
       }
     }
@@ -9146,7 +10915,7 @@ void add_status(DataRow *p_station, char *status_string)
       // list to keep them in sorted order.
 
       ptr = p_station->status_data;  // Save old pointer to records
-      p_station->status_data = (CommentRow *)malloc(sizeof(CommentRow));
+      p_station->status_data = (CommentRow *)row_pool_alloc(&comment_pool);
       CHECKMALLOC(p_station->status_data);
 
       p_station->status_data->next = ptr;    // Link in old records or NULL
@@ -9274,7 +11043,7 @@ void add_comment(DataRow *p_station, char *comment_string)
 
             // Free the record
             free(ptr3->text_ptr);
-            free(ptr3);
+            row_pool_free(&comment_pool, ptr3);
 
             // Muck with the counter 'cuz we just
             // deleted one record
@@ -9319,7 +11088,7 @@ void add_comment(DataRow *p_station, char *comment_string)
         // record in ptr2->next.  Free it and the text
         // string in it.
         free(ptr2->next->text_ptr);
-        free(ptr2->next);
+        row_pool_free(&comment_pool, ptr2->next);
         ptr2->next = NULL;
       }
     }
@@ -9331,7 +11100,7 @@ void add_comment(DataRow *p_station, char *comment_string)
       // list to keep them in sorted order.
 
       ptr = p_station->comment_data;  // Save old pointer to records
-      p_station->comment_data = (CommentRow *)malloc(sizeof(CommentRow));
+      p_station->comment_data = (CommentRow *)row_pool_alloc(&comment_pool);
       CHECKMALLOC(p_station->comment_data);
 
       p_station->comment_data->next = ptr;    // Link in old records or NULL
@@ -9357,6 +11126,144 @@ void add_comment(DataRow *p_station, char *comment_string)
 
 
 
+// The packet decode_ax25_packet() is handing to decode_info_field(),
+// with its info field already parsed by predecode_ax25_line().  NULL
+// at other times.
+static ax25_packet *predecoded = NULL;
+
+
+
+
+
+// Position extraction for data_add():  extract_position(), then
+// extract_comp_position() if that fails, setting *compr_pos.  If
+// predecode_ax25_line() parsed the same text, its results are copied
+// in instead, so only the station update is left for the main
+// thread.
+//
+static int data_add_position(DataRow *p_station, char **data, int type, int *compr_pos)
+{
+  ax25_parsed *parsed;
+  int ok;
+
+
+  if (predecoded != NULL
+      && predecoded->parsed.position >= 0
+      && predecoded->parsed.grid == (type == APRS_GRID)
+      && strcmp(*data, predecoded->parsed.pos_data) == 0)
+  {
+    parsed = &predecoded->parsed;
+    ok = parsed->position;
+    if (parsed->compressed)
+    {
+      *compr_pos = 1;
+    }
+    if (ok)
+    {
+      p_station->aprs_symbol.aprs_type = parsed->aprs_type;
+      p_station->aprs_symbol.aprs_symbol = parsed->aprs_symbol;
+      if (!parsed->grid)
+      {
+        p_station->aprs_symbol.special_overlay = parsed->special_overlay;
+      }
+      p_station->pos_amb = parsed->pos_amb;
+
+      // Grids always move the station, extract_position()
+      // doesn't check for my station there.
+      if (parsed->grid || !is_my_station(p_station))    // don't change my position, I know it better...
+      {
+        p_station->coord_lat = parsed->coord_lat;
+        p_station->coord_lon = parsed->coord_lon;
+      }
+
+      // From the csT bytes of a compressed position
+      if (parsed->altitude[0] != '\0')
+      {
+        memcpy(p_station->altitude, parsed->altitude, sizeof(p_station->altitude));
+      }
+      if (parsed->speed[0] != '\0')
+      {
+        memcpy(p_station->speed, parsed->speed, sizeof(p_station->speed));
+      }
+      if (parsed->course[0] != '\0')
+      {
+        memcpy(p_station->course, parsed->course, sizeof(p_station->course));
+      }
+      if (parsed->power_gain[0] != '\0')
+      {
+        memcpy(get_extra_data(p_station)->power_gain,
+               parsed->power_gain,
+               sizeof(p_station->extra_data->power_gain));
+      }
+
+      // Leave the text as the extractors would have
+      memcpy(*data, parsed->pos_after, strlen(parsed->pos_after) + 1);
+      (*data) += parsed->skip;
+    }
+    return(ok);
+  }
+
+  if (type == APRS_GRID)
+  {
+    return(extract_position(p_station, data, type));
+  }
+
+  ok = extract_position(p_station, data, type);             // uncompressed lat/lon
+  if (!ok)
+  {
+    *compr_pos = 1;
+    ok = extract_comp_position(p_station, data, type);    // compressed lat/lon
+    if (ok)
+    {
+      p_station->pos_amb = 0;  // No ambiguity in compressed posits
+    }
+  }
+  return(ok);
+}
+
+
+
+
+
+// extract_weather() for data_add().  If predecode_ax25_line() parsed
+// the same text, with the same station speed/course for a compressed
+// report, only the copy into the weather record is done here.
+//
+static int data_add_weather(DataRow *p_station, char *data, int compr)
+{
+  ax25_parsed *parsed;
+  int ok;
+
+
+  if (predecoded != NULL
+      && predecoded->parsed.weather >= 0
+      && predecoded->parsed.wx_compr == compr
+      && strcmp(data, predecoded->parsed.wx_data) == 0
+      && (!compr
+          || (strcmp(p_station->speed, predecoded->parsed.speed) == 0
+              && strcmp(p_station->course, predecoded->parsed.course) == 0)))
+  {
+    parsed = &predecoded->parsed;
+    ok = parsed->weather;
+    if (ok)
+    {
+      ok = get_weather_record(p_station);     // get existing or create new weather record
+    }
+    if (ok)
+    {
+      store_weather(p_station, &parsed->wx, parsed->wx_snow, compr);
+    }
+    memcpy(data, parsed->wx_after, strlen(parsed->wx_after) + 1);
+    return(ok);
+  }
+
+  return(extract_weather(p_station, data, compr));
+}
+
+
+
+
+
 /*
  *  Add data from APRS information field to station database
  *  Returns a 1 if successful
@@ -9527,29 +11434,18 @@ int data_add(int type,
       case (APRS_FIXED):          // '!'
       case (APRS_MSGCAP):         // '='
 
-        if (!extract_position(p_station,&data,type))            // uncompressed lat/lon
+        if (!data_add_position(p_station,&data,type,&compr_pos))   // uncompressed or compressed lat/lon
         {
-          compr_pos = 1;
-          if (!extract_comp_position(p_station,&data,type))   // compressed lat/lon
-          {
-            ok = 0;
-          }
-          else
-          {
-            p_station->pos_amb = 0;  // No ambiguity in compressed posits
-          }
+          ok = 0;
         }
 
         if (ok)
         {
 
           // Create a timestamp from the current time
-          xastir_snprintf(p_station->pos_time,
-                          sizeof(p_station->pos_time),
-                          "%s",
-                          get_time(temp_data));
+          p_station->pos_time = sec_now();
           (void)extract_storm(p_station,data,compr_pos);
-          (void)extract_weather(p_station,data,compr_pos);    // look for weather data first
+          (void)data_add_weather(p_station,data,compr_pos);    // look for weather data first
           process_data_extension(p_station,data,type);        // PHG, speed, etc.
           process_info_field(p_station,data,type);            // altitude
 
@@ -9604,10 +11500,7 @@ int data_add(int type,
         if (ok) {
 
         // Create a timestamp from the current time
-        xastir_snprintf(p_station->pos_time,
-        sizeof(p_station->pos_time),
-        "%s",
-        get_time(temp_data));
+        p_station->pos_time = sec_now();
         process_data_extension(p_station,data,type);        // PHG, speed, etc.
         process_info_field(p_station,data,type);            // altitude
 
@@ -9639,20 +11532,9 @@ int data_add(int type,
       case (APRS_MOBILE):         // '@'
 
         ok = extract_time(p_station, data, type);               // we need a time
-        if (ok)
+        if (ok && !data_add_position(p_station,&data,type,&compr_pos))  // uncompressed or compressed lat/lon
         {
-          if (!extract_position(p_station,&data,type))        // uncompressed lat/lon
-          {
-            compr_pos = 1;
-            if (!extract_comp_position(p_station,&data,type)) // compressed lat/lon
-            {
-              ok = 0;
-            }
-            else
-            {
-              p_station->pos_amb = 0;  // No ambiguity in compressed posits
-            }
-          }
+          ok = 0;
         }
         if (ok)
         {
@@ -9697,7 +11579,7 @@ int data_add(int type,
 
       case (APRS_GRID):
 
-        ok = extract_position(p_station, &data, type);
+        ok = data_add_position(p_station, &data, type, &compr_pos);
         if (ok)
         {
 
@@ -9808,20 +11690,9 @@ int data_add(int type,
         }
 
         ok = extract_time(p_station, data, type);               // we need a time
-        if (ok)
+        if (ok && !data_add_position(p_station,&data,type,&compr_pos))  // uncompressed or compressed lat/lon
         {
-          if (!extract_position(p_station,&data,type))        // uncompressed lat/lon
-          {
-            compr_pos = 1;
-            if (!extract_comp_position(p_station,&data,type)) // compressed lat/lon
-            {
-              ok = 0;
-            }
-            else
-            {
-              p_station->pos_amb = 0;  // No ambiguity in compressed posits
-            }
-          }
+          ok = 0;
         }
         p_station->flag |= ST_OBJECT;                           // Set "Object" flag
         if (ok)
@@ -9844,24 +11715,21 @@ int data_add(int type,
           // but it's a new object/item
           //                    if ( (is_my_call(p_station->origin,1))
           if (new_origin_is_mine
-              && (p_station->transmit_time_increment == 0) )
+              && (OBJECT_DATA(p_station)->transmit_time_increment == 0) )
           {
             // This will get us transmitting this object
             // on the decaying algorithm schedule.
             // We've transmitted it once if we've just
             // gotten to this code.
-            p_station->transmit_time_increment = OBJECT_CHECK_RATE;
+            get_object_data(p_station)->transmit_time_increment = OBJECT_CHECK_RATE;
             //fprintf(stderr,"data_add(): Setting transmit_time_increment to %d\n", OBJECT_CHECK_RATE);
           }
 
           // Create a timestamp from the current time
-          xastir_snprintf(p_station->pos_time,
-                          sizeof(p_station->pos_time),
-                          "%s",
-                          get_time(temp_data));
+          p_station->pos_time = sec_now();
 
-          xastir_snprintf(p_station->origin,
-                          sizeof(p_station->origin),
+          xastir_snprintf(get_object_data(p_station)->origin,
+                          sizeof(p_station->object_data->origin),
                           "%s",
                           origin);                   // define it as object
           if (debug_level & 2048)
@@ -9869,7 +11737,7 @@ int data_add(int type,
             fprintf (stderr,"  Object: before any extractions, data is \"%s\"\n",data);
           }
           (void)extract_storm(p_station,data,compr_pos);
-          (void)extract_weather(p_station,data,compr_pos);    // look for wx info
+          (void)data_add_weather(p_station,data,compr_pos);    // look for wx info
           process_data_extension(p_station,data,type);        // PHG, speed, etc.
           process_info_field(p_station,data,type);            // altitude
 
@@ -9937,17 +11805,9 @@ int data_add(int type,
           return( data_add(type, call_sign, path, data, from, port, origin, third_party, 0, 1) );
         }
 
-        if (!extract_position(p_station,&data,type))            // uncompressed lat/lon
+        if (!data_add_position(p_station,&data,type,&compr_pos))   // uncompressed or compressed lat/lon
         {
-          compr_pos = 1;
-          if (!extract_comp_position(p_station,&data,type))   // compressed lat/lon
-          {
-            ok = 0;
-          }
-          else
-          {
-            p_station->pos_amb = 0;  // No ambiguity in compressed posits
-          }
+          ok = 0;
         }
         p_station->flag |= ST_ITEM;                             // Set "Item" flag
         if (ok)
@@ -9970,27 +11830,24 @@ int data_add(int type,
           // but it's a new object/item
           //                    if ( (is_my_call(p_station->origin,1))
           if (is_my_object_item(p_station)
-              && (p_station->transmit_time_increment == 0) )
+              && (OBJECT_DATA(p_station)->transmit_time_increment == 0) )
           {
             // This will get us transmitting this object
             // on the decaying algorithm schedule.
             // We've transmitted it once if we've just
             // gotten to this code.
-            p_station->transmit_time_increment = OBJECT_CHECK_RATE;
+            get_object_data(p_station)->transmit_time_increment = OBJECT_CHECK_RATE;
             //fprintf(stderr,"data_add(): Setting transmit_time_increment to %d\n", OBJECT_CHECK_RATE);
           }
 
           // Create a timestamp from the current time
-          xastir_snprintf(p_station->pos_time,
-                          sizeof(p_station->pos_time),
-                          "%s",
-                          get_time(temp_data));
-          xastir_snprintf(p_station->origin,
-                          sizeof(p_station->origin),
+          p_station->pos_time = sec_now();
+          xastir_snprintf(get_object_data(p_station)->origin,
+                          sizeof(p_station->object_data->origin),
                           "%s",
                           origin);                   // define it as item
           (void)extract_storm(p_station,data,compr_pos);
-          (void)extract_weather(p_station,data,compr_pos);    // look for wx info
+          (void)data_add_weather(p_station,data,compr_pos);    // look for wx info
           process_data_extension(p_station,data,type);        // PHG, speed, etc.
           process_info_field(p_station,data,type);            // altitude
 
@@ -10028,26 +11885,15 @@ int data_add(int type,
       case (APRS_WX1):    // weather in '@' or '/' packet
 
         ok = extract_time(p_station, data, type);               // we need a time
-        if (ok)
+        if (ok && !data_add_position(p_station,&data,type,&compr_pos))  // uncompressed or compressed lat/lon
         {
-          if (!extract_position(p_station,&data,type))        // uncompressed lat/lon
-          {
-            compr_pos = 1;
-            if (!extract_comp_position(p_station,&data,type)) // compressed lat/lon
-            {
-              ok = 0;
-            }
-            else
-            {
-              p_station->pos_amb = 0;  // No ambiguity in compressed posits
-            }
-          }
+          ok = 0;
         }
         if (ok)
         {
 
           (void)extract_storm(p_station,data,compr_pos);
-          (void)extract_weather(p_station,data,compr_pos);
+          (void)data_add_weather(p_station,data,compr_pos);
           p_station->record_type = (char)APRS_WX1;
 
           process_info_field(p_station,data,type);            // altitude
@@ -10082,7 +11928,7 @@ int data_add(int type,
         if (ok)
         {
           (void)extract_storm(p_station,data,compr_pos);
-          (void)extract_weather(p_station,data,0);            // look for weather data first
+          (void)data_add_weather(p_station,data,0);            // look for weather data first
           p_station->record_type = (char)APRS_WX2;
           found_pos = 0;
 
@@ -10399,6 +12245,9 @@ int data_add(int type,
   if (ok)
   {
 
+    // The extract_*() functions above may have moved it
+    station_grid_update(p_station);
+
     // data packet is valid
     // announce own echo, we soon discard that packet...
     //        if (!new_station && is_my_call(p_station->call_sign,1) // Check SSID as well
@@ -10512,10 +12361,7 @@ int data_add(int type,
     p_station->last_port_heard = port;
     p_station->data_via = from;
     // Create a timestamp from the current time
-    xastir_snprintf(p_station->packet_time,
-                    sizeof(p_station->packet_time),
-                    "%s",
-                    get_time(temp_data)); // get_time returns value in temp_data
+    p_station->packet_time = sec_now();
 
     p_station->flag |= ST_ACTIVE;
     if (third_party)
@@ -10527,25 +12373,28 @@ int data_add(int type,
       p_station->flag &= (~ST_3RD_PT);  // clear "third party" flag
     }
     if (origin != NULL && strcmp(origin,"INET") == 0)  // special treatment for inet names
-      xastir_snprintf(p_station->origin,
-                      sizeof(p_station->origin),
+      xastir_snprintf(get_object_data(p_station)->origin,
+                      sizeof(p_station->object_data->origin),
                       "%s",
                       origin);           // to keep them separated from calls
     if (origin != NULL && strcmp(origin,"INET-NWS") == 0)  // special treatment for NWS
-      xastir_snprintf(p_station->origin,
-                      sizeof(p_station->origin),
+      xastir_snprintf(get_object_data(p_station)->origin,
+                      sizeof(p_station->object_data->origin),
                       "%s",
                       origin);           // to keep them separated from calls
 
     if (origin != NULL && strcmp(origin,"INET-BOM") == 0)  // special treatment for BOM (AU)
-      xastir_snprintf(p_station->origin,
-                      sizeof(p_station->origin),
+      xastir_snprintf(get_object_data(p_station)->origin,
+                      sizeof(p_station->object_data->origin),
                       "%s",
                       origin);           // to keep them separated from calls
 
     if (origin == NULL || origin[0] == '\0')        // normal call
     {
-      p_station->origin[0] = '\0';  // undefine possible former object with same name
+      if (p_station->object_data != NULL)
+      {
+        p_station->object_data->origin[0] = '\0';  // undefine possible former object with same name
+      }
     }
 
 
@@ -10855,7 +12704,7 @@ int data_add(int type,
 
         if (p_station->coord_lat != 0 && p_station->coord_lon != 0)     // discard undef positions from screen
         {
-          if (!altnet || is_altnet(p_station) )
+          if ((!altnet || is_altnet(p_station)) && !defer_station_drawing)
           {
             display_station(da,p_station,1);
             screen_update = 1;  // ???
@@ -10877,7 +12726,7 @@ int data_add(int type,
           fprintf(stderr,"  Valid position for %s\n",
                   p_station->call_sign);
         }
-        if (p_station->newest_trackpoint != NULL)
+        if (p_station->trail != NULL)
         {
           if (debug_level & 256)
           {
@@ -10947,7 +12796,7 @@ int data_add(int type,
               fprintf(stderr,"Station %s valid speed %s\n",
                       p_station->call_sign, p_station->speed);
             }
-            if (p_station->newest_trackpoint == NULL)
+            if (p_station->trail == NULL)
             {
               if (debug_level & 256)
               {
@@ -11030,7 +12879,8 @@ int data_add(int type,
         } // moving...
 
         // now do the drawing to the screen
-        ok_to_display = !altnet || is_altnet(p_station); // Optimization step, needed twice below.
+        ok_to_display = (!altnet || is_altnet(p_station)) // Optimization step, needed twice below.
+                        && !defer_station_drawing;
         screen_update = 0;
         if (changed_pos == 1 && Display_.trail && ((p_station->flag & ST_INVIEW) != 0))
         {
@@ -11088,11 +12938,12 @@ int data_add(int type,
     //                && !is_my_call(p_station->origin,1) // Check SSID as well
     if (!is_my_station(p_station)
         && !is_my_object_item(p_station) // Check SSID as well
-        && !wait_to_redraw)
+        && !wait_to_redraw
+        && !defer_station_drawing)
     {
       if (new_station)
       {
-        if (p_station->origin[0] == '\0')   // new station
+        if (OBJECT_DATA(p_station)->origin[0] == '\0')   // new station
         {
           xastir_snprintf(station_id, sizeof(station_id), langcode("BBARSTA001"),p_station->call_sign);
         }
@@ -11110,7 +12961,7 @@ int data_add(int type,
     }
 
     // announce new station with sound file or speech synthesis
-    if (new_station && !wait_to_redraw)     // && !is_my_call(p_station->call_sign,1) // ???
+    if (new_station && !wait_to_redraw && !defer_station_drawing)     // && !is_my_call(p_station->call_sign,1) // ???
     {
       if (sound_play_new_station)
       {
@@ -11618,15 +13469,9 @@ void my_station_gps_change(char *pos_long, char *pos_lat, char *course, char *sp
   substr(p_station->node_path_ptr,"local",strlen("local"));
 
   // Create a timestamp from the current time
-  xastir_snprintf(p_station->packet_time,
-                  sizeof(p_station->packet_time),
-                  "%s",
-                  get_time(temp_data));
+  p_station->packet_time = sec_now();
   // Create a timestamp from the current time
-  xastir_snprintf(p_station->pos_time,
-                  sizeof(p_station->pos_time),
-                  "%s",
-                  get_time(temp_data));
+  p_station->pos_time = sec_now();
   p_station->flag |= ST_MSGCAP;               // set "message capable" flag
 
   /* convert to long and weed out any odd data */
@@ -11687,6 +13532,7 @@ void my_station_gps_change(char *pos_long, char *pos_lat, char *course, char *sp
 
   p_station->coord_lat = pos_lat_temp;    // DK7IN: we have it already !??
   p_station->coord_lon = pos_long_temp;
+  station_grid_update(p_station);
 
   curr_sec = sec_now();
   my_last_altitude_time = curr_sec;
@@ -11717,8 +13563,8 @@ void my_station_gps_change(char *pos_long, char *pos_lat, char *course, char *sp
 
   /* get my last speed in knots */
   my_last_speed = atoi(speed);
-  xastir_snprintf(p_station->sats_visible,
-                  sizeof(p_station->sats_visible),
+  xastir_snprintf(get_extra_data(p_station)->sats_visible,
+                  sizeof(p_station->extra_data->sats_visible),
                   "%s",
                   sats);
 
@@ -11817,15 +13663,9 @@ void my_station_add(char *my_callsign, char my_group, char my_symbol, char *my_l
   substr(p_station->node_path_ptr,"local",strlen("local"));
 
   // Create a timestamp from the current time
-  xastir_snprintf(p_station->packet_time,
-                  sizeof(p_station->packet_time),
-                  "%s",
-                  get_time(temp_data));
+  p_station->packet_time = sec_now();
   // Create a timestamp from the current time
-  xastir_snprintf(p_station->pos_time,
-                  sizeof(p_station->pos_time),
-                  "%s",
-                  get_time(temp_data));
+  p_station->pos_time = sec_now();
   p_station->flag |= ST_MSGCAP;               // set "message capable" flag
 
   /* Symbol overlay */
@@ -11900,6 +13740,7 @@ void my_station_add(char *my_callsign, char my_group, char my_symbol, char *my_l
   }
   p_station->coord_lat = convert_lat_s2l(temp_data);
   p_station->coord_lon = convert_lon_s2l(strp);
+  station_grid_update(p_station);
 
   if (position_on_extd_screen(p_station->coord_lat,p_station->coord_lon))
   {
@@ -11910,7 +13751,7 @@ void my_station_add(char *my_callsign, char my_group, char my_symbol, char *my_l
     p_station->flag &= (~ST_INVIEW);  // clear "In View" flag
   }
 
-  substr(p_station->power_gain,my_phg,7);
+  substr(get_extra_data(p_station)->power_gain,my_phg,7);
 
   add_comment(p_station,my_comment);
 
@@ -12058,266 +13899,104 @@ void packet_data_add(char *from, char *line, int data_port)
 // always have it filled with the most current data out of the
 // string.
 //
-void display_packet_data(void)
-{
-
-  if( (Display_data_dialog != NULL)
-      && (redraw_on_new_packet_data !=0))
-  {
-    int pos;
-    int last_char;
-    int i;
-
-    // Find out the last character position in the dialog text
-    // area.
-    last_char = XmTextGetLastPosition(Display_data_text);
-
-    //fprintf(stderr,"In display_packet_data: first_line=%d,next_line=%d,ncharsdel=%d,nlinesadd=%d\n",first_line,next_line,ncharsdel,nlinesadd);
-
-    if (first_line != -1)   // there is data in the array
-    {
-      if (last_char == 0 || ncharsdel>=last_char)
-      {
-        //fprintf(stderr,"  Starting from clean slate...\n");
-        // but there is no text in the dialog or more chars to delete than
-        // there actually are in the dialog
-        // Clear the dialog just in case:
-        XmTextReplace(Display_data_text,0,last_char,"");
-
-        // display all the data in the ring
-        for (i=first_line; i != next_line;
-             i=(i+1)%MAX_PACKET_DATA_DISPLAY)
-        {
-          XmTextReplace(Display_data_text,last_char,last_char,
-                        packet_data_string[i]);
-          last_char=XmTextGetLastPosition(Display_data_text);
-          pos=last_char;
-          XtVaSetValues(Display_data_text,XmNcursorPosition,
-                        pos,NULL);
-        }
-        // Now clear counters so they're always the number of lines to
-        // add or characters to delete *since last display*
-        nlinesadd=0;
-        ncharsdel=0;
-      }
-      else     // there is stuff left over after we delete old stuff
-      {
-        if (ncharsdel)   // we have something to delete off the top
-        {
-          //fprintf(stderr,"  Must delete %d characters\n",ncharsdel);
-          XmTextReplace(Display_data_text,0,ncharsdel,"");
-          ncharsdel=0;
-        }
-        if (nlinesadd)   // and there's new stuff to add at end
-        {
-          //fprintf(stderr,"  Must add %d lines\n",nlinesadd);
-          last_char=XmTextGetLastPosition(Display_data_text);
-          for (i=(next_line+MAX_PACKET_DATA_DISPLAY
-                  -nlinesadd)%MAX_PACKET_DATA_DISPLAY;
-               i != next_line;
-               i=(i+1)%MAX_PACKET_DATA_DISPLAY)
-          {
-            //fprintf(stderr,"     Adding data from line %d\n",i);
-            XmTextReplace(Display_data_text,last_char,last_char,
-                          packet_data_string[i]);
-            last_char=XmTextGetLastPosition(Display_data_text);
-            pos=last_char;
-            XtVaSetValues(Display_data_text,XmNcursorPosition,
-                          pos,NULL);
-          }
-          nlinesadd=0;
-        }
-      }
-    }
-  }
-  redraw_on_new_packet_data=0;
-}
-
-
-
-
-
-/*
- *  Decode Mic-E encoded data
- */
-int decode_Mic_E(char *call_sign,char *path,char *info,char from,int port,int third_party)
-{
-  int  ii;
-  int  offset;
-  unsigned char s_b1;
-  unsigned char s_b2;
-  unsigned char s_b3;
-  unsigned char s_b4;
-  unsigned char s_b5;
-  unsigned char s_b6;
-  // unsigned char s_b7;
-  int  north,west,long_offset;
-  int  d,m,h;
-  char temp[MAX_LINE_SIZE+1];     // Note: Must be big in case we get long concatenated packets
-  char new_info[MAX_LINE_SIZE+1]; // Note: Must be big in case we get long concatenated packets
-  int  course;
-  int  speed;
-  int  msg1,msg2,msg3,msg;
-  int  info_size;
-  long alt;
-  int  msgtyp;
-  char rig_type[10];
-  int ok;
-
-  // MIC-E Data Format   [APRS Reference, chapter 10]
-
-  // todo:  error check
-  //        drop wrong positions from receive errors...
-  //        drop 0N/0E position (p.25)
-
-  /* First 7 bytes of info[] contains the APRS data type ID,    */
-  /* longitude, speed, course.                    */
-  /* The 6-byte destination field of path[] contains latitude,    */
-  /* N/S bit, E/W bit, longitude offset, message code.        */
-  /*
-
-    MIC-E Destination Field Format:
-    -------------------------------
-    Ar1DDDD0 Br1DDDD0 Cr1MMMM0 Nr1MMMM0 Lr1HHHH0 Wr1HHHH0 CrrSSID0
-    D = Latitude Degrees.
-    M = Latitude Minutes.
-    H = Latitude Hundredths of Minutes.
-    ABC = Message bits, complemented.
-    N = N/S latitude bit (N=1).
-    W = E/W longitude bit (W=1).
-    L = 100's of longitude degrees (L=1 means add 100 degrees to longitude
-    in the Info field).
-    C = Command/Response flag (see AX.25 specification).
-    r = reserved for future use (currently 0).
-
-  */
-  /****************************************************************************
-   * I still don't handle:                                                     *
-   *    Custom message bits                                                    *
-   *    SSID special routing                                                   *
-   *    Beta versions of the MIC-E (which use a slightly different format).    *
-   *                                                                           *
-   * DK7IN : lat/long with custom msg works, altitude/course/speed works       *
-   *****************************************************************************/
-
-  if (debug_level & 1)
-  {
-    fprintf(stderr,"decode_Mic_E:  FOUND MIC-E\n");
-  }
-
-  // Note that the first MIC-E character was not passed to us, so we're
-  // starting just past it.
-  // Check for valid symbol table character.  Should be '/' or '\'
-  // or 0-9, A-Z.
-  //
-  if (        info[7] == '/'                          // Primary table
-              ||  info[7] == '\\'                         // Alternate table
-              || (info[7] >= '0' && info[7] <= '9')       // Overlay char
-              || (info[7] >= 'A' && info[7] <= 'Z') )     // Overlay char
-  {
-
-    // We're good, keep going
-
-  }
-  else   // Symbol table or overlay char incorrect
-  {
-
-    if (info[6] == '/' || info[6] == '\\')      // Found it back one char in string
-    {
-      // Don't print out the full info string here because it
-      // can contain unprintable characters.  In fact, we
-      // should check the chars we do print out to make sure
-      // they're printable, else print a space char.
-      if (debug_level & 1)
-      {
-        fprintf(stderr,"decode_Mic_E: Symbol table (%c), symbol (%c) swapped or corrupted packet?  Call=%s, Path=%s\n",
-                ((info[7] > 0x1f) && (info[7] < 0x7f)) ? info[7] : ' ',
-                ((info[6] > 0x1f) && (info[6] < 0x7f)) ? info[6] : ' ',
-                call_sign,
-                path);
-        fprintf(stderr,"Returned from data_add, invalid symbol table character: %c\n",info[7]);
-      }
-    }
-
-    return(1);  // No good, not MIC-E format or corrupted packet.  Return 1
-    // so that it won't get added to the database at all.
-  }
-
-  // Check for valid symbol.  Should be between '!' and '~' only.
-  if (info[6] < '!' || info[6] > '~')
-  {
-    if (debug_level & 1)
-    {
-      fprintf(stderr,"Returned from data_add, invalid symbol\n");
-    }
-
-    return(1);  // No good, not MIC-E format or corrupted packet.  Return 1
-    // so that it won't get added to the database at all.
-  }
-
-  // Check for minimum MIC-E size.
-  if (strlen(info) < 8)
-  {
-    if (debug_level & 1)
-    {
-      fprintf(stderr,"Returned from data_add, packet too short\n");
-    }
-
-    return(1);  // No good, not MIC-E format or corrupted packet.  Return 1
-    // so that it won't get added to the database at all.
-  }
+void display_packet_data(void)
+{
 
-  // Check for 8-bit characters in the first eight slots.  Not
-  // allowed per Mic-E chapter of the spec.
-  for (ii = 0; ii < 8; ii++)
+  if( (Display_data_dialog != NULL)
+      && (redraw_on_new_packet_data !=0))
   {
-    if ((unsigned char)info[ii] > 0x7f)
-    {
-      // 8-bit data was found in the lat/long/course/speed
-      // portion.  Bad packet.  Drop it.
-      //fprintf(stderr, "%s: 8-bits found in Mic-E packet initial portion. Dropping it.\n", call_sign);
-      return(1);
-    }
-  }
+    int pos;
+    int last_char;
+    int i;
 
-  // Check whether we have more data.  If flag character is 0x1d
-  // (8-bit telemetry flag) then don't do the 8-bit check below.
-  if (strlen(info) > 8)
-  {
+    // Find out the last character position in the dialog text
+    // area.
+    last_char = XmTextGetLastPosition(Display_data_text);
 
-    // Check for the 8-bit telemetry flag
-    if ((unsigned char)info[8] == 0x1d)
-    {
-      // 8-bit telemetry found, skip the check loop below
-    }
-    else    // 8-bit telemetry flag was not found.  Check that
-    {
-      // we only have 7-bit characters through the rest of
-      // the packet.
+    //fprintf(stderr,"In display_packet_data: first_line=%d,next_line=%d,ncharsdel=%d,nlinesadd=%d\n",first_line,next_line,ncharsdel,nlinesadd);
 
-      for (ii = 8; ii < (int)strlen(info); ii++)
+    if (first_line != -1)   // there is data in the array
+    {
+      if (last_char == 0 || ncharsdel>=last_char)
       {
+        //fprintf(stderr,"  Starting from clean slate...\n");
+        // but there is no text in the dialog or more chars to delete than
+        // there actually are in the dialog
+        // Clear the dialog just in case:
+        XmTextReplace(Display_data_text,0,last_char,"");
 
-        if ((unsigned char)info[ii] > 0x7f)
+        // display all the data in the ring
+        for (i=first_line; i != next_line;
+             i=(i+1)%MAX_PACKET_DATA_DISPLAY)
         {
-          // 8-bit data was found.  Bad packet.  Drop it.
-          //fprintf(stderr, "%s: 8-bits found in Mic-E packet final portion (not 8-bit telemetry). Dropping it.\n", call_sign);
-          return(1);
+          XmTextReplace(Display_data_text,last_char,last_char,
+                        packet_data_string[i]);
+          last_char=XmTextGetLastPosition(Display_data_text);
+          pos=last_char;
+          XtVaSetValues(Display_data_text,XmNcursorPosition,
+                        pos,NULL);
+        }
+        // Now clear counters so they're always the number of lines to
+        // add or characters to delete *since last display*
+        nlinesadd=0;
+        ncharsdel=0;
+      }
+      else     // there is stuff left over after we delete old stuff
+      {
+        if (ncharsdel)   // we have something to delete off the top
+        {
+          //fprintf(stderr,"  Must delete %d characters\n",ncharsdel);
+          XmTextReplace(Display_data_text,0,ncharsdel,"");
+          ncharsdel=0;
+        }
+        if (nlinesadd)   // and there's new stuff to add at end
+        {
+          //fprintf(stderr,"  Must add %d lines\n",nlinesadd);
+          last_char=XmTextGetLastPosition(Display_data_text);
+          for (i=(next_line+MAX_PACKET_DATA_DISPLAY
+                  -nlinesadd)%MAX_PACKET_DATA_DISPLAY;
+               i != next_line;
+               i=(i+1)%MAX_PACKET_DATA_DISPLAY)
+          {
+            //fprintf(stderr,"     Adding data from line %d\n",i);
+            XmTextReplace(Display_data_text,last_char,last_char,
+                          packet_data_string[i]);
+            last_char=XmTextGetLastPosition(Display_data_text);
+            pos=last_char;
+            XtVaSetValues(Display_data_text,XmNcursorPosition,
+                          pos,NULL);
+          }
+          nlinesadd=0;
         }
       }
     }
   }
+  redraw_on_new_packet_data=0;
+}
 
-  //fprintf(stderr,"Path1:%s\n",path);
 
-  msg1 = (int)( ((unsigned char)path[0] & 0x40) >>4 );
-  msg2 = (int)( ((unsigned char)path[1] & 0x40) >>5 );
-  msg3 = (int)( ((unsigned char)path[2] & 0x40) >>6 );
-  msg = msg1 | msg2 | msg3;   // We now have the complemented message number in one variable
-  msg = msg ^ 0x07;           // And this is now the normal message number
-  msgtyp = 0;                 // DK7IN: Std message, I have to add custom msg decoding
 
-  //fprintf(stderr,"Msg: %d\n",msg);
+
+
+/*
+ *  Build the uncompressed lat/long of a Mic-E packet from its
+ *  destination field ("path") and the first bytes of its info field,
+ *  in the form extract_position() takes:  "DDMM.mmN/DDDMM.mmW>",
+ *  symbol table and symbol included.
+ */
+static void mic_e_position(char *path, char *info, char *position, int size)
+{
+  unsigned char s_b1;
+  unsigned char s_b2;
+  unsigned char s_b3;
+  unsigned char s_b4;
+  unsigned char s_b5;
+  unsigned char s_b6;
+  // unsigned char s_b7;
+  int  north,west,long_offset;
+  int  d,m,h;
+  char temp[32];
+
 
   /* Snag the latitude from the destination field, Assume TAPR-2 */
   /* DK7IN: latitude now works with custom message */
@@ -12405,66 +14084,245 @@ int decode_Mic_E(char *call_sign,char *path,char *info,char from,int port,int th
     north = (int)((path[3] & 0x40) == (char)0x40);  // N/S Lat Indicator
   }
 
-  if (path[4] == 'L')
-  {
-    long_offset = 0;
+  if (path[4] == 'L')
+  {
+    long_offset = 0;
+  }
+  else
+  {
+    long_offset = (int)((path[4] & 0x40) == (char)0x40);  // Longitude Offset
+  }
+
+  if (path[5] == 'L')
+  {
+    west = 0;
+  }
+  else
+  {
+    west = (int)((path[5] & 0x40) == (char)0x40);  // W/E Long Indicator
+  }
+
+  //fprintf(stderr,"north:%c->%d\tlat:%c->%d\twest:%c->%d\n",path[3],north,path[4],long_offset,path[5],west);
+
+  /* Put the latitude string into the temp variable */
+  xastir_snprintf(temp, sizeof(temp), "%c%c%c%c.%c%c%c%c",s_b1,s_b2,s_b3,s_b4,s_b5,s_b6,
+                  (north ? 'N': 'S'), info[7]);   // info[7] = symbol table
+
+  /* Compute degrees longitude */
+  xastir_snprintf(position,
+                  size,
+                  "%s",
+                  temp);
+  d = (int) info[0]-28;
+
+  if (long_offset)
+  {
+    d += 100;
+  }
+
+  if ((180<=d)&&(d<=189))  // ??
+  {
+    d -= 80;
+  }
+
+  if ((190<=d)&&(d<=199))  // ??
+  {
+    d -= 190;
+  }
+
+  /* Compute minutes longitude */
+  m = (int) info[1]-28;
+  if (m>=60)
+  {
+    m -= 60;
+  }
+
+  /* Compute hundredths of minutes longitude */
+  h = (int) info[2]-28;
+  /* Add the longitude string into the temp variable */
+  xastir_snprintf(temp, sizeof(temp), "%03d%02d.%02d%c%c",d,m,h,(west ? 'W': 'E'), info[6]);
+  strncat(position,
+          temp,
+          size - 1 - strlen(position));
+}
+
+
+
+
+
+/*
+ *  Expand a Mic-E packet into the uncompressed position report that
+ *  data_add() takes.  "info" starts just past the data type ID.
+ *  *msg_num is set to the standard message number (7 = Emergency).
+ *
+ *  Returns 0 for a corrupted or non-Mic-E packet.  Doesn't touch the
+ *  database, so predecode_ax25_line() uses it on the decode thread.
+ */
+static int mic_e_expand(char *call_sign, char *path, char *info, char *new_info, int size, int *msg_num)
+{
+  int  ii;
+  int  offset;
+  char temp[MAX_LINE_SIZE+1];     // Note: Must be big in case we get long concatenated packets
+  int  course;
+  int  speed;
+  int  msg1,msg2,msg3,msg;
+  int  info_size;
+  long alt;
+  int  msgtyp;
+  char rig_type[10];
+
+
+  // MIC-E Data Format   [APRS Reference, chapter 10]
+
+  // todo:  error check
+  //        drop wrong positions from receive errors...
+  //        drop 0N/0E position (p.25)
+
+  /* First 7 bytes of info[] contains the APRS data type ID,    */
+  /* longitude, speed, course.                    */
+  /* The 6-byte destination field of path[] contains latitude,    */
+  /* N/S bit, E/W bit, longitude offset, message code.        */
+  /*
+
+    MIC-E Destination Field Format:
+    -------------------------------
+    Ar1DDDD0 Br1DDDD0 Cr1MMMM0 Nr1MMMM0 Lr1HHHH0 Wr1HHHH0 CrrSSID0
+    D = Latitude Degrees.
+    M = Latitude Minutes.
+    H = Latitude Hundredths of Minutes.
+    ABC = Message bits, complemented.
+    N = N/S latitude bit (N=1).
+    W = E/W longitude bit (W=1).
+    L = 100's of longitude degrees (L=1 means add 100 degrees to longitude
+    in the Info field).
+    C = Command/Response flag (see AX.25 specification).
+    r = reserved for future use (currently 0).
+
+  */
+  /****************************************************************************
+   * I still don't handle:                                                     *
+   *    Custom message bits                                                    *
+   *    SSID special routing                                                   *
+   *    Beta versions of the MIC-E (which use a slightly different format).    *
+   *                                                                           *
+   * DK7IN : lat/long with custom msg works, altitude/course/speed works       *
+   *****************************************************************************/
+
+
+  // Note that the first MIC-E character was not passed to us, so we're
+  // starting just past it.
+  // Check for valid symbol table character.  Should be '/' or '\'
+  // or 0-9, A-Z.
+  //
+  if (        info[7] == '/'                          // Primary table
+              ||  info[7] == '\\'                         // Alternate table
+              || (info[7] >= '0' && info[7] <= '9')       // Overlay char
+              || (info[7] >= 'A' && info[7] <= 'Z') )     // Overlay char
+  {
+
+    // We're good, keep going
+
+  }
+  else   // Symbol table or overlay char incorrect
+  {
+
+    if (info[6] == '/' || info[6] == '\\')      // Found it back one char in string
+    {
+      // Don't print out the full info string here because it
+      // can contain unprintable characters.  In fact, we
+      // should check the chars we do print out to make sure
+      // they're printable, else print a space char.
+      if (debug_level & 1)
+      {
+        fprintf(stderr,"decode_Mic_E: Symbol table (%c), symbol (%c) swapped or corrupted packet?  Call=%s, Path=%s\n",
+                ((info[7] > 0x1f) && (info[7] < 0x7f)) ? info[7] : ' ',
+                ((info[6] > 0x1f) && (info[6] < 0x7f)) ? info[6] : ' ',
+                call_sign,
+                path);
+        fprintf(stderr,"Returned from data_add, invalid symbol table character: %c\n",info[7]);
+      }
+    }
+
+    return(0);  // No good, not MIC-E format or corrupted packet
   }
-  else
+
+  // Check for valid symbol.  Should be between '!' and '~' only.
+  if (info[6] < '!' || info[6] > '~')
   {
-    long_offset = (int)((path[4] & 0x40) == (char)0x40);  // Longitude Offset
+    if (debug_level & 1)
+    {
+      fprintf(stderr,"Returned from data_add, invalid symbol\n");
+    }
+
+    return(0);  // No good, not MIC-E format or corrupted packet
   }
 
-  if (path[5] == 'L')
+  // Check for minimum MIC-E size.
+  if (strlen(info) < 8)
   {
-    west = 0;
+    if (debug_level & 1)
+    {
+      fprintf(stderr,"Returned from data_add, packet too short\n");
+    }
+
+    return(0);  // No good, not MIC-E format or corrupted packet
   }
-  else
+
+  // Check for 8-bit characters in the first eight slots.  Not
+  // allowed per Mic-E chapter of the spec.
+  for (ii = 0; ii < 8; ii++)
   {
-    west = (int)((path[5] & 0x40) == (char)0x40);  // W/E Long Indicator
+    if ((unsigned char)info[ii] > 0x7f)
+    {
+      // 8-bit data was found in the lat/long/course/speed
+      // portion.  Bad packet.  Drop it.
+      //fprintf(stderr, "%s: 8-bits found in Mic-E packet initial portion. Dropping it.\n", call_sign);
+      return(0);
+    }
   }
 
-  //fprintf(stderr,"north:%c->%d\tlat:%c->%d\twest:%c->%d\n",path[3],north,path[4],long_offset,path[5],west);
+  // Check whether we have more data.  If flag character is 0x1d
+  // (8-bit telemetry flag) then don't do the 8-bit check below.
+  if (strlen(info) > 8)
+  {
 
-  /* Put the latitude string into the temp variable */
-  xastir_snprintf(temp, sizeof(temp), "%c%c%c%c.%c%c%c%c",s_b1,s_b2,s_b3,s_b4,s_b5,s_b6,
-                  (north ? 'N': 'S'), info[7]);   // info[7] = symbol table
+    // Check for the 8-bit telemetry flag
+    if ((unsigned char)info[8] == 0x1d)
+    {
+      // 8-bit telemetry found, skip the check loop below
+    }
+    else    // 8-bit telemetry flag was not found.  Check that
+    {
+      // we only have 7-bit characters through the rest of
+      // the packet.
 
-  /* Compute degrees longitude */
-  xastir_snprintf(new_info,
-                  sizeof(new_info),
-                  "%s",
-                  temp);
-  d = (int) info[0]-28;
+      for (ii = 8; ii < (int)strlen(info); ii++)
+      {
 
-  if (long_offset)
-  {
-    d += 100;
+        if ((unsigned char)info[ii] > 0x7f)
+        {
+          // 8-bit data was found.  Bad packet.  Drop it.
+          //fprintf(stderr, "%s: 8-bits found in Mic-E packet final portion (not 8-bit telemetry). Dropping it.\n", call_sign);
+          return(0);
+        }
+      }
+    }
   }
 
-  if ((180<=d)&&(d<=189))  // ??
-  {
-    d -= 80;
-  }
+  //fprintf(stderr,"Path1:%s\n",path);
 
-  if ((190<=d)&&(d<=199))  // ??
-  {
-    d -= 190;
-  }
+  msg1 = (int)( ((unsigned char)path[0] & 0x40) >>4 );
+  msg2 = (int)( ((unsigned char)path[1] & 0x40) >>5 );
+  msg3 = (int)( ((unsigned char)path[2] & 0x40) >>6 );
+  msg = msg1 | msg2 | msg3;   // We now have the complemented message number in one variable
+  msg = msg ^ 0x07;           // And this is now the normal message number
+  msgtyp = 0;                 // DK7IN: Std message, I have to add custom msg decoding
+  *msg_num = (msgtyp == 0) ? msg : -1;
 
-  /* Compute minutes longitude */
-  m = (int) info[1]-28;
-  if (m>=60)
-  {
-    m -= 60;
-  }
+  //fprintf(stderr,"Msg: %d\n",msg);
 
-  /* Compute hundredths of minutes longitude */
-  h = (int) info[2]-28;
-  /* Add the longitude string into the temp variable */
-  xastir_snprintf(temp, sizeof(temp), "%03d%02d.%02d%c%c",d,m,h,(west ? 'W': 'E'), info[6]);
-  strncat(new_info,
-          temp,
-          sizeof(new_info) - 1 - strlen(new_info));
+  /* Lat/long in uncompressed format, with the symbol */
+  mic_e_position(path, info, new_info, size);
 
   /* Compute speed in knots */
   speed = (int)( ( info[3] - (char)28 ) * (char)10 );
@@ -12488,7 +14346,7 @@ int decode_Mic_E(char *call_sign,char *path,char *info,char from,int port,int th
   xastir_snprintf(temp, sizeof(temp), "%03d/%03d",course,speed);
   strncat(new_info,
           temp,
-          sizeof(new_info) - 1 - strlen(new_info));
+          size - 1 - strlen(new_info));
   offset = 8;   // start of rest of info
 
   /* search for rig type in Mic-E data */
@@ -12533,7 +14391,7 @@ int decode_Mic_E(char *call_sign,char *path,char *info,char from,int port,int th
       offset += 4;
       strncat(new_info,
               temp,
-              sizeof(new_info) - 1 - strlen(new_info));
+              size - 1 - strlen(new_info));
     }
   }
 
@@ -12543,12 +14401,12 @@ int decode_Mic_E(char *call_sign,char *path,char *info,char from,int port,int th
     xastir_snprintf(temp, sizeof(temp), "%s",rig_type);
     strncat(new_info,
             temp,
-            sizeof(new_info) - 1 - strlen(new_info));
+            size - 1 - strlen(new_info));
   }
 
   strncat(new_info,
           " Mic-E ",
-          sizeof(new_info) - 1 - strlen(new_info));
+          size - 1 - strlen(new_info));
   if (msgtyp == 0)
   {
     switch (msg)
@@ -12556,143 +14414,49 @@ int decode_Mic_E(char *call_sign,char *path,char *info,char from,int port,int th
       case 1:
         strncat(new_info,
                 "Enroute",
-                sizeof(new_info) - 1 - strlen(new_info));
+                size - 1 - strlen(new_info));
         break;
 
       case 2:
         strncat(new_info,
                 "In Service",
-                sizeof(new_info) - 1 - strlen(new_info));
+                size - 1 - strlen(new_info));
         break;
 
       case 3:
         strncat(new_info,
                 "Returning",
-                sizeof(new_info) - 1 - strlen(new_info));
+                size - 1 - strlen(new_info));
         break;
 
       case 4:
         strncat(new_info,
                 "Committed",
-                sizeof(new_info) - 1 - strlen(new_info));
+                size - 1 - strlen(new_info));
         break;
 
       case 5:
         strncat(new_info,
                 "Special",
-                sizeof(new_info) - 1 - strlen(new_info));
+                size - 1 - strlen(new_info));
         break;
 
       case 6:
         strncat(new_info,
                 "Priority",
-                sizeof(new_info) - 1 - strlen(new_info));
+                size - 1 - strlen(new_info));
         break;
 
       case 7:
         strncat(new_info,
                 "Emergency",
-                sizeof(new_info) - 1 - strlen(new_info));
-
-        // Do a popup to alert the operator to this
-        // condition.  Make sure we haven't popped up an
-        // emergency message for this station within the
-        // last 30 minutes.  If we pop these up constantly
-        // it gets quite annoying.
-        // EMERGENCY
-
-        if (emergency_distance_check)
-        {
-          double distance;
-          char course_deg[5];
-
-
-          distance = distance_from_my_station(call_sign, course_deg,
-                                              english_units);
-
-          // Because of the distance check we have to receive a valid position
-          // from the station BEFORE we process the EMERGENCY portion and
-          // check distance, doing the popups.  We need to figure out a way to
-          // throw the packet back into the queue if it was an emergency
-          // packet so that we process these packets twice each.  That way
-          // only one packet from the emergency station is required to
-          // generate the popups.
-
-          if (distance == 0.0)
-          {
-            process_emergency_packet_again++;
-          }
-
-          // Check whether the station is near enough to
-          // us to require that we alert on the packet.
-          //
-          // This may be slightly controversial, but if we
-          // don't know WHERE a station is, we can't help
-          // much in an emergency, can we?  The
-          // zero-distance check helps in the case where
-          // we haven't yet or never get a position packet
-          // for a station.  As soon as we have a position
-          // and it is within a reasonable range, we do
-          // our emergency popups.
-          //
-          if ( distance != 0.0 && (float)distance <= emergency_range )
-          {
-
-            if ( (strncmp(call_sign, last_emergency_callsign, strlen(call_sign)) != 0)
-                 || ((last_emergency_time + 60*30) < sec_now()) )
-            {
-
-              char temp[50];
-              char temp2[150];
-              char temp3[300];
-              char timestring[101];
-
-              // Callsign is different or enough time has
-              // passed
-
-              last_emergency_time = sec_now();
-              xastir_snprintf(last_emergency_callsign,
-                              sizeof(last_emergency_callsign),
-                              "%s",
-                              call_sign);
-
-              // Bring up the Find Station dialog so that the
-              // operator can go to the location quickly
-              xastir_snprintf(locate_station_call,
-                              sizeof(locate_station_call),
-                              "%s",
-                              call_sign);
-
-              Locate_station( (Widget)NULL, (XtPointer)NULL, (XtPointer)1 );
-
-              // Bring up another dialog with the
-              // callsign plus distance/bearing to the
-              // station.
-              xastir_snprintf(temp,
-                              sizeof(temp),
-                              "%0.1f",
-                              distance);
-              xastir_snprintf(temp2,
-                              sizeof(temp2),
-                              langcode("WPUPSTI022"),
-                              temp,
-                              course_deg);
-              get_timestamp(timestring);
-              xastir_snprintf(temp3,
-                              sizeof(temp3),
-                              "%s  %s",
-                              timestring,
-                              temp2);
-              popup_message_always(call_sign, temp3);
-            }
-          }
-        }
+                size - 1 - strlen(new_info));
         break;
 
       default:
         strncat(new_info,
                 "Off Duty",
-                sizeof(new_info) - 1 - strlen(new_info));
+                size - 1 - strlen(new_info));
     }
   }
   else
@@ -12700,7 +14464,7 @@ int decode_Mic_E(char *call_sign,char *path,char *info,char from,int port,int th
     xastir_snprintf(temp, sizeof(temp), "Custom%d",msg);
     strncat(new_info,
             temp,
-            sizeof(new_info) - 1 - strlen(new_info));
+            size - 1 - strlen(new_info));
   }
 
   if (info[offset] != '\0')
@@ -12714,10 +14478,165 @@ int decode_Mic_E(char *call_sign,char *path,char *info,char from,int port,int th
     temp[info_size-offset] = '\0';
     strncat(new_info,
             " ",
-            sizeof(new_info) - 1 - strlen(new_info));
+            size - 1 - strlen(new_info));
     strncat(new_info,
             temp,
-            sizeof(new_info) - 1 - strlen(new_info));
+            size - 1 - strlen(new_info));
+  }
+
+  return(1);
+}
+
+
+
+
+
+/*
+ *  Pop up an alert for a Mic-E "Emergency" packet from a station near
+ *  enough to us.
+ */
+static void mic_e_emergency(char *call_sign)
+{
+  // Do a popup to alert the operator to this
+  // condition.  Make sure we haven't popped up an
+  // emergency message for this station within the
+  // last 30 minutes.  If we pop these up constantly
+  // it gets quite annoying.
+  // EMERGENCY
+
+  if (emergency_distance_check)
+  {
+    double distance;
+    char course_deg[5];
+
+
+    distance = distance_from_my_station(call_sign, course_deg,
+                                        english_units);
+
+    // Because of the distance check we have to receive a valid position
+    // from the station BEFORE we process the EMERGENCY portion and
+    // check distance, doing the popups.  We need to figure out a way to
+    // throw the packet back into the queue if it was an emergency
+    // packet so that we process these packets twice each.  That way
+    // only one packet from the emergency station is required to
+    // generate the popups.
+
+    if (distance == 0.0)
+    {
+      process_emergency_packet_again++;
+    }
+
+    // Check whether the station is near enough to
+    // us to require that we alert on the packet.
+    //
+    // This may be slightly controversial, but if we
+    // don't know WHERE a station is, we can't help
+    // much in an emergency, can we?  The
+    // zero-distance check helps in the case where
+    // we haven't yet or never get a position packet
+    // for a station.  As soon as we have a position
+    // and it is within a reasonable range, we do
+    // our emergency popups.
+    //
+    if ( distance != 0.0 && (float)distance <= emergency_range )
+    {
+
+      if ( (strncmp(call_sign, last_emergency_callsign, strlen(call_sign)) != 0)
+           || ((last_emergency_time + 60*30) < sec_now()) )
+      {
+
+        char temp[50];
+        char temp2[150];
+        char temp3[300];
+        char timestring[101];
+
+        // Callsign is different or enough time has
+        // passed
+
+        last_emergency_time = sec_now();
+        xastir_snprintf(last_emergency_callsign,
+                        sizeof(last_emergency_callsign),
+                        "%s",
+                        call_sign);
+
+        // Bring up the Find Station dialog so that the
+        // operator can go to the location quickly
+        xastir_snprintf(locate_station_call,
+                        sizeof(locate_station_call),
+                        "%s",
+                        call_sign);
+
+        Locate_station( (Widget)NULL, (XtPointer)NULL, (XtPointer)1 );
+
+        // Bring up another dialog with the
+        // callsign plus distance/bearing to the
+        // station.
+        xastir_snprintf(temp,
+                        sizeof(temp),
+                        "%0.1f",
+                        distance);
+        xastir_snprintf(temp2,
+                        sizeof(temp2),
+                        langcode("WPUPSTI022"),
+                        temp,
+                        course_deg);
+        get_timestamp(timestring);
+        xastir_snprintf(temp3,
+                        sizeof(temp3),
+                        "%s  %s",
+                        timestring,
+                        temp2);
+        popup_message_always(call_sign, temp3);
+      }
+    }
+  }
+}
+
+
+
+
+
+/*
+ *  Decode Mic-E encoded data
+ */
+int decode_Mic_E(char *call_sign,char *path,char *info,char from,int port,int third_party)
+{
+  char new_info[MAX_LINE_SIZE+1]; // Note: Must be big in case we get long concatenated packets
+  int  msg;
+  int  ok;
+
+
+  if (debug_level & 1)
+  {
+    fprintf(stderr,"decode_Mic_E:  FOUND MIC-E\n");
+  }
+
+  // The decode thread may have expanded it already
+  if (predecoded != NULL
+      && info == predecoded->info + 1
+      && predecoded->parsed.mic_e >= 0)
+  {
+    ok = predecoded->parsed.mic_e;
+    msg = predecoded->parsed.mic_e_msg;
+    xastir_snprintf(new_info,
+                    sizeof(new_info),
+                    "%s",
+                    predecoded->parsed.mic_e_info);
+  }
+  else
+  {
+    ok = mic_e_expand(call_sign, path, info, new_info, sizeof(new_info), &msg);
+  }
+
+  if (!ok)
+  {
+    return(1);  // No good, not MIC-E format or corrupted packet.  Return 1
+    // so that it won't get added to the database at all.
+  }
+
+  if (msg == 7)
+  {
+    mic_e_emergency(call_sign);
   }
 
   if (debug_level & 1)
@@ -15622,6 +17541,7 @@ int extract_third_party(char *call,
   int ok;
   char *p_call;
   char *p_path;
+  char *saveptr;
 
   p_call = NULL;                              // to make the compiler happy...
   p_path = NULL;                              // to make the compiler happy...
@@ -15631,13 +17551,13 @@ int extract_third_party(char *call,
     // todo: add reporting station call to database ??
     //       but only if not identical to reported call
     (*info) = (*info) +1;                   // strip '}' character
-    p_call = strtok((*info),">");           // extract call
+    p_call = strtok_r((*info),">",&saveptr);           // extract call
     if (p_call != NULL)
     {
-      p_path = strtok(NULL,":");          // extract path
+      p_path = strtok_r(NULL,":",&saveptr);          // extract path
       if (p_path != NULL)
       {
-        (*info) = strtok(NULL,"");      // rest is information field
+        (*info) = strtok_r(NULL,"",&saveptr);      // rest is information field
         if ((*info) != NULL)            // the above looks dangerous, but works on same string
           if (strlen(p_path) < 100)
           {
@@ -16387,17 +18307,488 @@ void relay_digipeat(char *call, char *path, char *info, int port)
       port_write_string(port, info);
     }
   }
-  else if (devices[port].device_type == DEVICE_NET_AGWPE)
+  else if (devices[port].device_type == DEVICE_NET_AGWPE)
+  {
+    send_agwpe_packet(port, // Xastir interface port
+                      atoi(devices[port].device_host_filter_string), // AGWPE RadioPort
+                      '\0',                         // Type of frame (data)
+                      (unsigned char *)call,        // source
+                      (unsigned char *)destination, // destination
+                      (unsigned char *)new_path,    // Path,
+                      (unsigned char *)info,
+                      strlen(info));
+  }
+}
+
+
+
+
+
+/*
+ *  The position part of predecode_info_field():  extract_position()
+ *  and extract_comp_position() as data_add_position() runs them, on
+ *  a scratch record.  "data" is advanced past the position.
+ */
+static void predecode_position(ax25_parsed *parsed, DataRow *scratch, char **data, int grid)
+{
+  char *start = *data;
+  int ok;
+
+
+  xastir_snprintf(parsed->pos_data,
+                  sizeof(parsed->pos_data),
+                  "%s",
+                  *data);
+  parsed->grid = grid;
+
+  ok = extract_position(scratch, data, grid ? APRS_GRID : APRS_FIXED);
+  if (!ok && !grid)
+  {
+    parsed->compressed = 1;
+    ok = extract_comp_position(scratch, data, APRS_FIXED);
+    if (ok)
+    {
+      scratch->pos_amb = 0;  // No ambiguity in compressed posits
+    }
+  }
+  parsed->position = ok;
+
+  if (ok)
+  {
+    parsed->skip = (int)(*data - start);
+    xastir_snprintf(parsed->pos_after,
+                    sizeof(parsed->pos_after),
+                    "%s",
+                    start);
+    parsed->coord_lat = scratch->coord_lat;
+    parsed->coord_lon = scratch->coord_lon;
+    parsed->pos_amb = scratch->pos_amb;
+    parsed->aprs_type = scratch->aprs_symbol.aprs_type;
+    parsed->aprs_symbol = scratch->aprs_symbol.aprs_symbol;
+    parsed->special_overlay = scratch->aprs_symbol.special_overlay;
+    memcpy(parsed->altitude, scratch->altitude, sizeof(parsed->altitude));
+    memcpy(parsed->speed, scratch->speed, sizeof(parsed->speed));
+    memcpy(parsed->course, scratch->course, sizeof(parsed->course));
+    memcpy(parsed->power_gain, scratch->extra_data->power_gain, sizeof(parsed->power_gain));
+  }
+}
+
+
+
+
+
+/*
+ *  Parse what data_add() will need from the info field of a packet
+ *  that predecode_ax25_line() has split up, following the dispatch
+ *  in decode_info_field():  the Mic-E expansion, the position and
+ *  the weather report.  data_add() then only has to copy the results
+ *  into the station record.
+ *
+ *  Works on a scratch record and touches no globals other than
+ *  debug_level, so it is safe on the decode thread.
+ */
+static void predecode_info_field(ax25_packet *packet)
+{
+  ax25_parsed *parsed = &packet->parsed;
+  DataRow scratch;
+  ExtraRow extra;
+  char data[MAX_AX25_LINE+1];
+  char *my_data;
+  int position = 0;   // 1 = position, 2 = time and position, 3 = grid
+  int weather = 0;    // 1 = after the position, 2 = positionless
+
+
+  if (packet->info[0] == '\0')
+  {
+    return;
+  }
+
+  xastir_snprintf(data, sizeof(data), "%s", packet->info);
+  my_data = data + 1;
+
+  if (packet->origin[0] != '\0'
+      && (data[0] == '*' || data[0] == '!' || data[0] == '_'))
+  {
+    // Object, item or a delete
+    if (data[0] == '*')
+    {
+      position = 2;
+    }
+    else if (data[0] == '!')
+    {
+      position = 1;
+    }
+  }
+  else
+  {
+    switch (data[0])
+    {
+      case '=':
+        position = 1;
+        break;
+
+      case '!':   // Unless it's an Ultimeter 2000
+        if ( !(my_data[0] == '!' && is_xnum_or_dash(my_data+1,40)) )
+        {
+          position = 1;
+        }
+        break;
+
+      case '/':
+      case '@':
+        position = 2;
+        break;
+
+      case '[':
+        position = 3;
+        break;
+
+      case 0x27:
+      case 0x60:
+        parsed->mic_e = mic_e_expand(packet->call,
+                                     packet->decode_path,
+                                     my_data,
+                                     parsed->mic_e_info,
+                                     sizeof(parsed->mic_e_info),
+                                     &parsed->mic_e_msg);
+        if (parsed->mic_e)
+        {
+          xastir_snprintf(data, sizeof(data), "%s", parsed->mic_e_info);
+          my_data = data;
+          position = 1;
+        }
+        break;
+
+      case '_':
+        weather = 2;
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  if (position == 0 && weather == 0)
+  {
+    return;
+  }
+
+  memset(&scratch, 0, sizeof(scratch));
+  extra = extra_data_defaults;
+  scratch.extra_data = &extra;      // So get_extra_data() doesn't allocate
+
+  if (position == 2 && !extract_time(&scratch, my_data, APRS_MOBILE))
+  {
+    return;
+  }
+  if (weather == 2 && !extract_time(&scratch, my_data, APRS_WX2))
+  {
+    return;
+  }
+
+  if (position)
+  {
+    predecode_position(parsed, &scratch, &my_data, position == 3);
+    if (parsed->position && position != 3)
+    {
+      weather = 1;
+    }
+  }
+
+  if (weather)
+  {
+    parsed->wx_compr = (weather == 1) ? parsed->compressed : 0;
+    xastir_snprintf(parsed->wx_data,
+                    sizeof(parsed->wx_data),
+                    "%s",
+                    my_data);
+    memset(&parsed->wx, 0, sizeof(parsed->wx));
+    parsed->weather = parse_weather(&parsed->wx,
+                                    &parsed->wx_snow,
+                                    my_data,
+                                    parsed->wx_compr,
+                                    scratch.speed,
+                                    scratch.course);
+    xastir_snprintf(parsed->wx_after,
+                    sizeof(parsed->wx_after),
+                    "%s",
+                    my_data);
+  }
+}
+
+
+
+
+
+/*
+ *  Split an AX.25 line into its components and do all of the checks
+ *  that don't need the station database:  path and callsign
+ *  validation, TNC text removal, third-party unwrapping and object
+ *  or item name extraction, then the position, weather and Mic-E
+ *  parsing of the info field (predecode_info_field()).  The results
+ *  go into "packet", which decode_ax25_packet() then hands to the
+ *  database.
+ *
+ *  This only reads my_callsign and debug_level, so it may be called
+ *  from the decode thread.  "line" is not modified.
+ */
+void predecode_ax25_line(char *line, ax25_packet *packet)
+{
+  char tmp_line[MAX_LINE_SIZE+1];
+  char *call_sign;
+  char *path0;
+  char *info;
+  char *saveptr;
+  int len;
+  int ok;
+
+
+  packet->path_ok        = 0;
+  packet->call_ok        = 0;
+  packet->ok             = 0;
+  packet->third_party    = 0;
+  packet->backup[0]      = '\0';
+  packet->call_sign[0]   = '\0';
+  packet->path[0]        = '\0';
+  packet->info_copy[0]   = '\0';
+  packet->call[0]        = '\0';
+  packet->decode_path[0] = '\0';
+  packet->origin[0]      = '\0';
+  packet->info[0]        = '\0';
+  packet->parsed.mic_e      = -1;
+  packet->parsed.position   = -1;
+  packet->parsed.compressed = 0;
+  packet->parsed.weather    = -1;
+
+  if (strlen(line) > MAX_LINE_SIZE)   // Overly long message, throw it away.  We're done.
+  {
+    if (debug_level & 1)
+    {
+      fprintf(stderr,"\ndecode_ax25_line: LONG packet.  Dumping it:\n%s\n",line);
+    }
+    return;
+  }
+
+  xastir_snprintf(packet->backup,
+                  sizeof(packet->backup),
+                  "%s",
+                  line);
+
+  xastir_snprintf(tmp_line,
+                  sizeof(tmp_line),
+                  "%s",
+                  line);
+
+  len = strlen(tmp_line);
+  if (len > 0 && tmp_line[len-1] == '\n')     // better: look at other places,
+    // so that we don't get it here...
+  {
+    tmp_line[--len] = '\0';   // Wipe out '\n', to be sure
+  }
+  if (len > 0 && tmp_line[len-1] == '\r')
+  {
+    tmp_line[--len] = '\0';   // Wipe out '\r'
+  }
+
+  // CALL>PATH:APRS-INFO-FIELD                // split line into components
+  //     ^    ^
+  // Use strtok_r(), the main thread may be using strtok() at the
+  // same time.
+  ok = 0;
+  path0 = NULL;
+  info = NULL;
+  call_sign = strtok_r(tmp_line,">",&saveptr);    // extract call from AX.25 line
+  if (call_sign != NULL)
+  {
+    path0 = strtok_r(NULL,":",&saveptr);        // extract path from AX.25 line
+    if (path0 != NULL)
+    {
+      info = strtok_r(NULL,"",&saveptr);      // rest is info_field
+      if (info != NULL)
+      {
+        if ((info - path0) < 100)       // check if path could be copied
+        {
+          ok = 1;                     // we have found all three components
+        }
+      }
+    }
+  }
+
+  if (!ok)
+  {
+    return;
+  }
+
+  xastir_snprintf(packet->call_sign,
+                  sizeof(packet->call_sign),
+                  "%s",
+                  call_sign);
+
+  xastir_snprintf(packet->path,
+                  sizeof(packet->path),
+                  "%s",
+                  path0);
+
+  xastir_snprintf(packet->info_copy,
+                  sizeof(packet->info_copy),
+                  "%s",
+                  info);
+
+  packet->path_ok = valid_path(packet->path);     // check the path and convert it to TAPR format
+  // Note that valid_path() also removes igate injection identifiers
+
+  if (!packet->path_ok)
+  {
+    if (debug_level & 1)
+    {
+      char filtered_data[MAX_LINE_SIZE + 1];
+
+      xastir_snprintf(filtered_data,
+                      sizeof(filtered_data),
+                      "%s",
+                      packet->path);
+      makePrintable(filtered_data);
+      fprintf(stderr,"decode_ax25_line: invalid path: %s\n",filtered_data);
+    }
+    return;
+  }
+
+  xastir_snprintf(packet->info,
+                  sizeof(packet->info),
+                  "%s",
+                  info);
+  extract_TNC_text(packet->info);             // extract leading text from TNC X-1J4
+  if (strlen(packet->info) > 256)             // first check if information field conforms to APRS specs
+  {
+    // drop packets too long
+    if (debug_level & 1)
+    {
+      char filtered_data[MAX_LINE_SIZE + 1];
+
+      xastir_snprintf(filtered_data,
+                      sizeof(filtered_data),
+                      "%s",
+                      packet->info);
+      makePrintable(filtered_data);
+      fprintf(stderr,"decode_ax25_line: info field too long: %s\n",filtered_data);
+    }
+    return;
+  }
+
+  // check callsign
+  (void)remove_trailing_asterisk(call_sign);          // is an asterisk valid here ???
+  if (valid_inet_name(call_sign,packet->info,packet->origin,sizeof(packet->origin)))   // accept some of the names used in internet
+  {
+    xastir_snprintf(packet->call,
+                    sizeof(packet->call),
+                    "%s",
+                    call_sign);
+  }
+  else if (valid_call(call_sign))                   // accept real AX.25 calls
+  {
+    xastir_snprintf(packet->call,
+                    sizeof(packet->call),
+                    "%s",
+                    call_sign);
+  }
+  else
+  {
+    if (debug_level & 1)
+    {
+      char filtered_data[MAX_LINE_SIZE + 1];
+
+      xastir_snprintf(filtered_data,
+                      sizeof(filtered_data),
+                      "%s",
+                      call_sign);
+      makePrintable(filtered_data);
+      fprintf(stderr,"decode_ax25_line: invalid call: %s\n",filtered_data);
+    }
+    return;
+  }
+  packet->call_ok = 1;
+
+  xastir_snprintf(packet->decode_path,
+                  sizeof(packet->decode_path),
+                  "%s",
+                  packet->path);
+
+  ok = 1;
+  info = packet->info;
+
+  if (info[0] == '}')                                         // look for third-party traffic
+  {
+    ok = extract_third_party(packet->call,
+                             packet->decode_path,
+                             sizeof(packet->decode_path),
+                             &info,
+                             packet->origin,
+                             sizeof(packet->origin));       // extract third-party data
+    packet->third_party = 1;
+  }
+
+  if (ok && (info[0] == ';' || info[0] == ')'))               // look for objects or items
+  {
+    xastir_snprintf(packet->origin,
+                    sizeof(packet->origin),
+                    "%s",
+                    packet->call);
+    ok = extract_object(packet->call,&info,packet->origin); // extract object data
+  }
+
+  // Both of the above advance "info" within packet->info.  Move
+  // what's left to the start of the buffer so that the record can
+  // be copied around.
+  if (info == NULL)
+  {
+    packet->info[0] = '\0';
+  }
+  else if (info != packet->info)
+  {
+    memmove(packet->info, info, strlen(info) + 1);
+  }
+
+  packet->ok = ok;
+
+  if (ok)
+  {
+    predecode_info_field(packet);
+  }
+}
+
+
+
+
+
+/*
+ *  For the x_spider server's per-client filters:  find the info field
+ *  of a packet split up by predecode_ax25_line(), from its data type
+ *  byte on (third-party header skipped, object or item name still
+ *  there), and the position predecode_ax25_line() parsed out of it.
+ *
+ *  Returns 1 and fills in lat/lon if the packet has a position.
+ */
+int extract_packet_position(ax25_packet *packet, char **info_field, long *lat, long *lon)
+{
+  char *info;
+
+
+  info = packet->info_copy;
+  if (packet->third_party && info[0] == '}')
+  {
+    info = strchr(info, ':');
+    info = (info != NULL) ? info + 1 : packet->info_copy;
+  }
+  *info_field = info;
+
+  if (!packet->ok || packet->parsed.position <= 0)
   {
-    send_agwpe_packet(port, // Xastir interface port
-                      atoi(devices[port].device_host_filter_string), // AGWPE RadioPort
-                      '\0',                         // Type of frame (data)
-                      (unsigned char *)call,        // source
-                      (unsigned char *)destination, // destination
-                      (unsigned char *)new_path,    // Path,
-                      (unsigned char *)info,
-                      strlen(info));
+    return(0);
   }
+
+  *lat = packet->parsed.coord_lat;
+  *lon = packet->parsed.coord_lon;
+  return(1);
 }
 
 
@@ -16405,33 +18796,23 @@ void relay_digipeat(char *call, char *path, char *info, int port)
 
 
 /*
- *  Decode AX.25 line
- *  \r and \n should already be stripped from end of line
- *  line should not be NULL
+ *  Hand a packet split up by predecode_ax25_line() to the station
+ *  database, popping up emergency alerts, digipeating and passing it
+ *  on to x_spider clients as needed.  Main thread only.
  *
- * If dbadd is set, add to database.  Otherwise, just return true/false
- * to indicate whether input is valid AX25 line.
+ *  If dbadd is set, add to database.  Otherwise, just return true/false
+ *  to indicate whether input is valid AX25 line.
  */
-//
-// Note that the length of "line" can be up to MAX_DEVICE_BUFFER,
-// which is currently set to 4096.
-//
-int decode_ax25_line(char *line, char from, int port, int dbadd)
+int decode_ax25_packet(ax25_packet *packet, char from, int port, int dbadd)
 {
-  char *call_sign;
-  char *path0;
-  char path[100+1];           // new one, we may add an '*'
-  char *info;
-  char info_copy[MAX_LINE_SIZE+1];
-  char call[MAX_CALLSIGN+1];
-  char origin[MAX_CALLSIGN+1];
-  int ok;
-  int third_party;
-  char backup[MAX_LINE_SIZE+1];
+  char *call_sign = packet->call_sign;
+  char *path = packet->path;
+  char *backup = packet->backup;
+  char *ViaCalls[10];
   char tmp_line[MAX_LINE_SIZE+1];
-  char tmp_line2[630];
   char tmp_path[100+1];
-  char *ViaCalls[10];
+  char src_call[MAX_LINE_SIZE+1];
+  char tmp_line2[sizeof(src_call) + sizeof(packet->decode_path) + sizeof(my_callsign) + sizeof(packet->info_copy) + 5];
 
 
   // Check guard band around pointers.  Make sure it's pristine.
@@ -16440,11 +18821,6 @@ int decode_ax25_line(char *line, char from, int port, int dbadd)
     fprintf(stderr, "WARNING:  Guard band around global pointers was corrupted!\n");
   }
 
-  xastir_snprintf(backup,
-                  sizeof(backup),
-                  "%s",
-                  line);
-
   // This is a good one to enable for debugging without getting too
   // many other types of messages to the xterm.  It will enable the
   // block below.
@@ -16459,101 +18835,16 @@ int decode_ax25_line(char *line, char from, int port, int dbadd)
     xastir_snprintf(filtered_data,
                     sizeof(filtered_data),
                     "%s",
-                    line);
+                    backup);
     filtered_data[MAX_LINE_SIZE] = '\0';    // Terminate it
 
     makePrintable(filtered_data);
     fprintf(stderr,"decode_ax25_line: start parsing %s\n", filtered_data);
   }
 
-  if (line == NULL)
-  {
-    fprintf(stderr,"decode_ax25_line: line == NULL.\n");
-    return(FALSE);
-  }
-
-  if ( (line != NULL) && (strlen(line) > MAX_LINE_SIZE) )   // Overly long message, throw it away.  We're done.
-  {
-    if (debug_level & 1)
-    {
-      fprintf(stderr,"\ndecode_ax25_line: LONG packet.  Dumping it:\n%s\n",line);
-    }
-    return(FALSE);
-  }
-
-  if (line[strlen(line)-1] == '\n')           // better: look at other places,
-    // so that we don't get it here...
-  {
-    line[strlen(line)-1] = '\0';  // Wipe out '\n', to be sure
-  }
-  if (line[strlen(line)-1] == '\r')
-  {
-    line[strlen(line)-1] = '\0';  // Wipe out '\r'
-  }
-
-  call_sign   = NULL;
-  path0       = NULL;
-  info        = NULL;
-  origin[0]   = '\0';
-  call[0]     = '\0';
-  path[0]     = '\0';
-  third_party = 0;
-
-  // CALL>PATH:APRS-INFO-FIELD                // split line into components
-  //     ^    ^
-  ok = 0;
-  call_sign = strtok(line,">");               // extract call from AX.25 line
-  if (call_sign != NULL)
-  {
-    path0 = strtok(NULL,":");               // extract path from AX.25 line
-    if (path0 != NULL)
-    {
-      info = strtok(NULL,"");             // rest is info_field
-      if (info != NULL)
-      {
-        if ((info - path0) < 100)       // check if path could be copied
-        {
-          ok = 1;                     // we have found all three components
-        }
-      }
-    }
-  }
-
-  if (ok)
-  {
-
-    xastir_snprintf(path,
-                    sizeof(path),
-                    "%s",
-                    path0);
-
-    memset(info_copy, '\0', sizeof(info_copy));
-    xastir_snprintf(info_copy,
-                    sizeof(info_copy),
-                    "%s",
-                    info);
-
-    ok = valid_path(path);                  // check the path and convert it to TAPR format
-    // Note that valid_path() also removes igate injection identifiers
-
-    if ((debug_level & 1) && !ok)
-    {
-      char filtered_data[MAX_LINE_SIZE + 1];
-
-      xastir_snprintf(filtered_data,
-                      sizeof(filtered_data),
-                      "%s",
-                      path);
-      makePrintable(filtered_data);
-      fprintf(stderr,"decode_ax25_line: invalid path: %s\n",filtered_data);
-    }
-  }
-
-  if (ok)
+  // If it's not me transmitting it:
+  if (packet->path_ok && strcmp(my_callsign,call_sign) != 0)
   {
-    // If it's not me transmitting it:
-    if (strcmp(my_callsign,call_sign) != 0)
-    {
 
       // Check for "EMERGENCY" anywhere in the line.
       // APRS+SA also supports any of these in the TO: field:
@@ -16693,71 +18984,15 @@ int decode_ax25_line(char *line, char from, int port, int dbadd)
           }
         }
       }
-    }
-  }
-
-  if (ok)
-  {
-
-    // Attempt to digipeat this packet if we should.  If port=-2,
-    // we received this packet from the x_spider server and we
-    // should not attempt to digipeat it.  If port=-1, it's from
-    // a log file.  Again, don't digipeat it.
-    if (port >= 0)
-    {
-      relay_digipeat(call_sign, path, info, port);
-    }
-
-    extract_TNC_text(info);                 // extract leading text from TNC X-1J4
-    if (strlen(info) > 256)                 // first check if information field conforms to APRS specs
-    {
-      ok = 0;  // drop packets too long
-    }
-    if ((debug_level & 1) && !ok)
-    {
-      char filtered_data[MAX_LINE_SIZE + 1];
-
-      xastir_snprintf(filtered_data,
-                      sizeof(filtered_data),
-                      "%s",
-                      info);
-      makePrintable(filtered_data);
-      fprintf(stderr,"decode_ax25_line: info field too long: %s\n",filtered_data);
-    }
   }
 
-  if (ok)                                                     // check callsign
+  // Attempt to digipeat this packet if we should.  If port=-2,
+  // we received this packet from the x_spider server and we
+  // should not attempt to digipeat it.  If port=-1, it's from
+  // a log file.  Again, don't digipeat it.
+  if (packet->path_ok && port >= 0)
   {
-    (void)remove_trailing_asterisk(call_sign);              // is an asterisk valid here ???
-    if (valid_inet_name(call_sign,info,origin,sizeof(origin)))   // accept some of the names used in internet
-    {
-      xastir_snprintf(call,
-                      sizeof(call),
-                      "%s",
-                      call_sign);
-    }
-    else if (valid_call(call_sign))                       // accept real AX.25 calls
-    {
-      xastir_snprintf(call,
-                      sizeof(call),
-                      "%s",
-                      call_sign);
-    }
-    else
-    {
-      ok = 0;
-      if (debug_level & 1)
-      {
-        char filtered_data[MAX_LINE_SIZE + 1];
-
-        xastir_snprintf(filtered_data,
-                        sizeof(filtered_data),
-                        "%s",
-                        call_sign);
-        makePrintable(filtered_data);
-        fprintf(stderr,"decode_ax25_line: invalid call: %s\n",filtered_data);
-      }
-    }
+    relay_digipeat(call_sign, path, packet->info_copy, port);
   }
 
   if (!dbadd)
@@ -16767,58 +19002,47 @@ int decode_ax25_line(char *line, char from, int port, int dbadd)
       fprintf(stderr,"decode_ax25_line: exiting\n");
     }
 
-    return(ok);
-  }
-
-  if (ok && info[0] == '}')                                   // look for third-party traffic
-  {
-    ok = extract_third_party(call,path,sizeof(path),&info,origin,sizeof(origin)); // extract third-party data
-    third_party = 1;
-
-    // Add it to the HEARD queue for this interface.  We use this
-    // for igating purposes.  If some other igate beat us to this
-    // packet, we don't want to duplicate it over the air.  If
-    // port=-2, we received it from the x_spider server and we
-    // should not save it in the queue.  If port=-1, the packet
-    // came from a log file and again we shouldn't save it to
-    // the queue.
-    if (port >= 0)
-    {
-      insert_into_heard_queue(port, backup);
-    }
+    return(packet->call_ok);
   }
 
-  if (ok && (info[0] == ';' || info[0] == ')'))               // look for objects or items
+  // Add third-party traffic to the HEARD queue for this interface.
+  // We use this for igating purposes.  If some other igate beat us
+  // to this packet, we don't want to duplicate it over the air.  If
+  // port=-2, we received it from the x_spider server and we should
+  // not save it in the queue.  If port=-1, the packet came from a
+  // log file and again we shouldn't save it to the queue.
+  if (packet->call_ok && packet->third_party && port >= 0)
   {
-    xastir_snprintf(origin,
-                    sizeof(origin),
-                    "%s",
-                    call);
-    ok = extract_object(call,&info,origin);                 // extract object data
+    insert_into_heard_queue(port, backup);
   }
 
-  if (ok)
+  if (packet->ok)
   {
     // decode APRS information field, always called with valid call and path
     // info is a string with 0 - 256 bytes
     // fprintf(stderr,"dec: %s (%s) %s\n",call,origin,info);
     if (debug_level & 1)
     {
-      char filtered_data[MAX_LINE_SIZE+80];
-      sprintf(filtered_data,
-              "Registering data %s %s %s %s %c %d %d",
-              call, path, info, origin, from, port, third_party);
+      char filtered_data[sizeof(packet->call) + sizeof(packet->decode_path)
+                         + sizeof(packet->info) + sizeof(packet->origin) + 50];
+      xastir_snprintf(filtered_data,
+                      sizeof(filtered_data),
+                      "Registering data %s %s %s %s %c %d %d",
+                      packet->call, packet->decode_path, packet->info,
+                      packet->origin, from, port, packet->third_party);
       makePrintable(filtered_data);
       fprintf(stderr,"c/p/i/o fr pt tp: %s\n", filtered_data);
     }
-    decode_info_field(call,
-                      path,
-                      info,
-                      origin,
+    predecoded = packet;
+    decode_info_field(packet->call,
+                      packet->decode_path,
+                      packet->info,
+                      packet->origin,
                       from,
                       port,
-                      third_party,
-                      info_copy);
+                      packet->third_party,
+                      packet->info_copy);
+    predecoded = NULL;
   }
 
 
@@ -16833,11 +19057,11 @@ int decode_ax25_line(char *line, char from, int port, int dbadd)
     // server and can send/receive packets/messages.  We also
     // dump it to our console so that we can see who logged in
     // to us.
-    if (strncasecmp(line,"user",4) == 0
-        || strncasecmp(line,"pass",4) == 0
-        || strncasecmp(line,"filter",6) == 0)
+    if (strncasecmp(backup,"user",4) == 0
+        || strncasecmp(backup,"pass",4) == 0
+        || strncasecmp(backup,"filter",6) == 0)
     {
-      fprintf(stderr,"\tLogged on: %s\n", line);
+      fprintf(stderr,"\tLogged on: %s\n", backup);
 
       // If the line has a "filter" parameter in it, we need to remove it,
       // else a client may change our filtering parameters.  Perhaps we
@@ -16846,7 +19070,7 @@ int decode_ax25_line(char *line, char from, int port, int dbadd)
       // the same socket?
 
     }
-    else if (strlen(line) > 0)      // Not empty
+    else if (strlen(backup) > 0)      // Not empty
     {
       // Send the packet unchanged out all of our
       // transmit-enabled ports.  We should send it as
@@ -16855,16 +19079,22 @@ int decode_ax25_line(char *line, char from, int port, int dbadd)
 
       //fprintf(stderr,"Retransmitting x_spider packet: %s\n", line);
 
+      xastir_snprintf(src_call,
+                      sizeof(src_call),
+                      "%s",
+                      call_sign);
+      (void)remove_trailing_asterisk(src_call);
+
       // Here's where we inject our own callsign like this:
       // "WE7U-15,I" in order to provide injection ID for our
       // igate.
       xastir_snprintf(tmp_line2,
                       sizeof(tmp_line2),
                       "%s>%s,%s,I:%s",
-                      call_sign,
-                      path,
+                      src_call,
+                      packet->decode_path,
                       my_callsign,
-                      info_copy);
+                      packet->info_copy);
       memcpy(tmp_line, tmp_line2, sizeof(tmp_line));
       tmp_line[sizeof(tmp_line)-1] = '\0';  // Terminate line
 
@@ -16893,7 +19123,39 @@ int decode_ax25_line(char *line, char from, int port, int dbadd)
     fprintf(stderr,"decode_ax25_line: exiting\n");
   }
 
-  return(ok);
+  return(packet->ok);
+}
+
+
+
+
+
+/*
+ *  Decode AX.25 line
+ *  \r and \n should already be stripped from end of line
+ *  line should not be NULL
+ *
+ * If dbadd is set, add to database.  Otherwise, just return true/false
+ * to indicate whether input is valid AX25 line.
+ */
+//
+// Note that the length of "line" can be up to MAX_DEVICE_BUFFER,
+// which is currently set to 4096.
+//
+int decode_ax25_line(char *line, char from, int port, int dbadd)
+{
+  ax25_packet packet;
+
+
+  if (line == NULL)
+  {
+    fprintf(stderr,"decode_ax25_line: line == NULL.\n");
+    return(FALSE);
+  }
+
+  predecode_ax25_line(line, &packet);
+
+  return(decode_ax25_packet(&packet, from, port, dbadd));
 }
 
 
@@ -17099,124 +19361,136 @@ void search_tracked_station(DataRow **p_tracked)
 // Bob Bruninga at http://web.usna.navy.mil/~bruninga/aprs/ALOHAcir.txt
 // with some clarification provided py private email.
 //
-// The gist of it is that we grab a list of all stations heard via TNC
-// and sort it b distance from our station.  We then accumulate a
+// The gist of it is that we grab a list of the stations heard via TNC
+// closest to our station, sorted by distance.  We then accumulate a
 // count of how many theoretical packets would be introduced into the local
 // area in 30 minutes from these stations, and stop when we hit 1800
 // (the supposed limit of the channel capacity).  The distance to the last
 // station we counted is our ALOHA limit.  Per Bob B., this should be plotted
 // on the  map as a circle with no user-selectable way of turning it off.
 //
+#define ALOHA_MAX_STATIONS (1800/2 + 1)
+
+// Stations that count towards the ALOHA circle: active ones heard
+// via TNC with a position.
+static int aloha_station_filter(DataRow *p_station)
+{
+  return( (p_station->flag & ST_VIATNC) != 0
+          && (p_station->flag & ST_ACTIVE) != 0
+          && position_defined(p_station->coord_lat,p_station->coord_lon,1) );
+}
+
+
+
+
+
+// Fill in the distance and station type of one ALOHA entry
+static void fill_aloha_entry(DataRow *p_station, aloha_entry *entry)
+{
+  char temp[10]; // needed for course_deg argument of
+  // distance_from_my_station
+
+  xastir_snprintf(entry->call_sign,
+                  MAX_CALLSIGN+1,
+                  "%s",
+                  p_station->call_sign);
+  entry->is_digi =
+    entry->is_mobile =
+      entry->is_other_mobile =
+        entry->is_home =
+          entry->is_wx = (char) FALSE;
+  entry->distance =
+    distance_from_my_station(p_station->call_sign,temp, english_units);
+
+  if ( p_station->trail != NULL
+       && strlen(p_station->speed) > 0)
+  {
+    // If the station has a track and a speed of any value
+    // (even zero), it's a mobile.
+    entry->is_mobile = (char) TRUE;
+  }
+  else if  ( (p_station->aprs_symbol.aprs_type=='/'
+              && (strchr("'<=>()*0COPRSUXY[^abefgjkpsuv",
+                         p_station->aprs_symbol.aprs_symbol)
+                  != NULL))
+             || (p_station->aprs_symbol.aprs_type=='\\'
+                 && (strchr("/0>AKOS^knsuv",
+                            p_station->aprs_symbol.aprs_symbol)
+                     != NULL)))
+  {
+    //
+    // Per private email exchange with Bob Bruninga:
+    // If the station has one of these symbols,
+    //  it's "other mobile"
+    // these are also listed on
+    // web.usna.navy.mil/~bruninga/aprs/aprs11.html
+    //
+    entry->is_other_mobile =(char)TRUE;
+  }
+  else if ( p_station-> record_type == APRS_WX1 ||
+            p_station-> record_type == APRS_WX2 ||
+            p_station-> record_type == APRS_WX3 ||
+            p_station-> record_type == APRS_WX4 ||
+            p_station-> record_type == APRS_WX5 ||
+            p_station-> record_type == APRS_WX6 ||
+            p_station-> aprs_symbol.aprs_symbol=='_')
+  {
+    // Bob B. uses the station symbol "_" to select this, but
+    // agrees that if we do it this way it's probably better
+    // -- this says if we've gotten any WX data, it's a WX
+    // station
+    entry->is_wx = (char) TRUE;
+  }
+  else if (p_station->aprs_symbol.aprs_symbol=='#')
+  {
+    // Per Bob B., if it has "#" as its symbol, it's
+    // assumed to be a digi.
+    entry->is_digi = (char) TRUE;
+  }
+  else
+  {
+    // Anything that hasn't gotten selected yet is just a home
+    entry->is_home = (char) TRUE;
+  }
+}
+
+
+
+
+
 double calc_aloha_distance(void)
 {
-  DataRow *p_station = n_first;  // walk in alphabetical order
+  DataRow **near_list;
   aloha_entry *aloha_array;
-  aloha_entry *temp_aloha_array;
 
-  int num_aloha_alloc=1000;
   int num_aloha_entries=0;
   int digi_copies=1;
-  char temp[10]; // needed for course_deg argument of
-  // distance_from_my_station
 
   int sum;
   double distance;
   int ii;
 
-  // This should be enough, though we'll realloc if necessary
-  aloha_array = (aloha_entry *)malloc (num_aloha_alloc*sizeof(aloha_entry));
+
+  // We need the stations heard via tnc, closest first.  Every
+  // station adds at least 2 to the sum below, so we never need
+  // more than the closest 1800/2 (plus one, to tell whether
+  // there were more).
+  near_list = (DataRow **)malloc(ALOHA_MAX_STATIONS*sizeof(DataRow *));
+  CHECKMALLOC(near_list);
+  aloha_array = (aloha_entry *)malloc(ALOHA_MAX_STATIONS*sizeof(aloha_entry));
   CHECKMALLOC(aloha_array);
 
-  // We need a list of all stations that were heard via tnc:
-  while (p_station != NULL)
+  num_aloha_entries = station_grid_nearest(convert_lon_s2l(my_long),
+                      convert_lat_s2l(my_lat),
+                      ALOHA_MAX_STATIONS,
+                      aloha_station_filter,
+                      near_list,
+                      NULL);
+  for (ii = 0; ii < num_aloha_entries; ii++)
   {
-    if (num_aloha_entries == num_aloha_alloc)
-    {
-      num_aloha_alloc *= 2;
-      temp_aloha_array=realloc(aloha_array,num_aloha_alloc);
-      if (temp_aloha_array)
-      {
-        aloha_array=temp_aloha_array;
-      }
-      else
-      {
-        fprintf(stderr,"***** Realloc failed *****\n");
-        exit(1);
-      }
-    }
-    if ( (p_station->flag & ST_VIATNC) != 0 &&
-         (p_station->flag & ST_ACTIVE) != 0 )
-    {
-      if (position_defined(p_station->coord_lat,p_station->coord_lon,1))
-      {
-        xastir_snprintf(aloha_array[num_aloha_entries].call_sign,
-                        MAX_CALLSIGN+1,
-                        "%s",
-                        p_station->call_sign);
-        aloha_array[num_aloha_entries].is_digi =
-          aloha_array[num_aloha_entries].is_mobile =
-            aloha_array[num_aloha_entries].is_other_mobile =
-              aloha_array[num_aloha_entries].is_home =
-                aloha_array[num_aloha_entries].is_wx = (char) FALSE;
-        aloha_array[num_aloha_entries].distance =
-          distance_from_my_station(p_station->call_sign,temp, english_units);
-
-        if ( p_station->newest_trackpoint != NULL
-             && strlen(p_station->speed) > 0)
-        {
-          // If the station has a track and a speed of any value
-          // (even zero), it's a mobile.
-          aloha_array[num_aloha_entries].is_mobile = (char) TRUE;
-        }
-        else if  ( (p_station->aprs_symbol.aprs_type=='/'
-                    && (strchr("'<=>()*0COPRSUXY[^abefgjkpsuv",
-                               p_station->aprs_symbol.aprs_symbol)
-                        != NULL))
-                   || (p_station->aprs_symbol.aprs_type=='\\'
-                       && (strchr("/0>AKOS^knsuv",
-                                  p_station->aprs_symbol.aprs_symbol)
-                           != NULL)))
-        {
-          //
-          // Per private email exchange with Bob Bruninga:
-          // If the station has one of these symbols,
-          //  it's "other mobile"
-          // these are also listed on
-          // web.usna.navy.mil/~bruninga/aprs/aprs11.html
-          //
-          aloha_array[num_aloha_entries].is_other_mobile =(char)TRUE;
-        }
-        else if ( p_station-> record_type == APRS_WX1 ||
-                  p_station-> record_type == APRS_WX2 ||
-                  p_station-> record_type == APRS_WX3 ||
-                  p_station-> record_type == APRS_WX4 ||
-                  p_station-> record_type == APRS_WX5 ||
-                  p_station-> record_type == APRS_WX6 ||
-                  p_station-> aprs_symbol.aprs_symbol=='_')
-        {
-          // Bob B. uses the station symbol "_" to select this, but
-          // agrees that if we do it this way it's probably better
-          // -- this says if we've gotten any WX data, it's a WX
-          // station
-          aloha_array[num_aloha_entries].is_wx = (char) TRUE;
-        }
-        else if (p_station->aprs_symbol.aprs_symbol=='#')
-        {
-          // Per Bob B., if it has "#" as its symbol, it's
-          // assumed to be a digi.
-          aloha_array[num_aloha_entries].is_digi = (char) TRUE;
-        }
-        else
-        {
-          // Anything that hasn't gotten selected yet is just a home
-          aloha_array[num_aloha_entries].is_home = (char) TRUE;
-        }
-
-        num_aloha_entries++;
-      }
-    }
-    p_station = p_station-> n_next;
+    fill_aloha_entry(near_list[ii], &aloha_array[ii]);
   }
+  free(near_list);
 
   if (debug_level & 2048)
   {
@@ -17224,7 +19498,8 @@ double calc_aloha_distance(void)
              num_aloha_entries);
   }
 
-  // we now have all the stations heard via TNC.  Now sort it by distance
+  // The nearest-neighbour search orders them on a flat-earth
+  // distance.  Sort on the real distance.
   qsort((void *) aloha_array,num_aloha_entries,sizeof(aloha_entry),
         comp_by_dist);
 
@@ -30,6 +30,7 @@
 #include <stdio.h>
 
 #include "database.h"
+#include "row_pool.h"
 
 // These don't seem to be used
 // extern void clean_data_file(void);
@@ -64,6 +65,9 @@ int is_altnet(DataRow *p_station);
 int ok_to_draw_station(DataRow *p_station);
 extern int  heard_via_tnc_in_past_hour(char *call);
 extern int  get_weather_record(DataRow *fill);
+extern ObjectRow *get_object_data(DataRow *fill);
+extern ExtraRow *get_extra_data(DataRow *fill);
+extern int delete_extensions(DataRow *fill);
 extern int store_trail_point(DataRow *p_station, long lon, long lat, time_t sec, char *alt, char *speed, char *course, short stn_flag);
 void expire_trail_points(DataRow *p_station, time_t sec);
 extern int  delete_trail(DataRow *fill);
@@ -77,9 +81,23 @@ extern int  prev_station_name(DataRow **p_curr);
 extern int  next_station_time(DataRow **p_curr);
 extern int  prev_station_time(DataRow **p_curr);
 extern void setup_in_view(void);
+extern void station_grid_update(DataRow *p_station);
+extern void station_grid_remove(DataRow *p_station);
+#define STATION_GRID_ANY_ORDER  0
+#define STATION_GRID_TIME_ORDER 1
+#define STATION_GRID_NAME_ORDER 2
+extern int  station_grid_query(long min_lon, long max_lon, long min_lat, long max_lat, int order, DataRow ***list);
+extern int  station_grid_nearest(long lon, long lat, int k, int (*filter)(DataRow *p_station), DataRow **result, double *dist);
+extern int  stations_in_view(DataRow ***list);
+extern row_pool *get_station_row_pool(int index);
 extern void station_del(char *callsign);
 extern void delete_all_stations(void);
 extern void check_station_remove(time_t curr_sec);
+extern int write_station_snapshot(char *filename);
+extern int read_station_snapshot(char *filename);
+extern void check_station_snapshot(time_t curr_sec);
+extern void save_station_snapshot(void);
+extern void load_station_snapshot(void);
 extern void my_station_add(char *my_call_sign, char my_group, char my_symbol,
                            char *my_long, char *my_lat, char *my_phg,
                            char *my_comment, char my_amb);
@@ -89,6 +107,9 @@ extern void my_station_gps_change(char *pos_long, char *pos_lat, char *course,
 extern void packet_data_add(char *from, char *line, int data_port);
 extern void display_packet_data(void);
 extern int decode_ax25_header(unsigned char *data_string, int *length);
+extern void predecode_ax25_line(char *line, ax25_packet *packet);
+extern int extract_packet_position(ax25_packet *packet, char **info_field, long *lat, long *lon);
+extern int decode_ax25_packet(ax25_packet *packet, char from, int port, int dbadd);
 extern int decode_ax25_line(char *line, char from, int port, int dbadd);
 extern void read_file_line(FILE *f);
 extern void search_tracked_station(DataRow **p_tracked);
@@ -113,6 +134,8 @@ extern int  redraw_on_new_packet_data;
 extern int  new_message_data;
 extern CADRow *CAD_list_head;
 extern int station_data_auto_update;
+extern int defer_station_drawing;
+extern int station_snapshot_interval;
 extern int fcc_lookup_pushed;
 extern int rac_lookup_pushed;
 
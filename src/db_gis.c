@@ -61,6 +61,7 @@
 #include "util.h"
 #include "xastir.h"
 #include "db_gis.h"
+#include "db_funcs.h"
 
 #ifdef HAVE_DB
 /* db_gis.c
@@ -1520,9 +1521,9 @@ int storeStationSimplePointToGisDbPostgis(Connection *aDbConnection, DataRow *aS
       // If used, form would be:
       // PQescapeStringConn(conn,call_sign,aStation->call_sign,(MAX_CALLSIGN*2)+1,escape_error);
       xastir_snprintf(call_sign,MAX_CALLSIGN+1,"%s",aStation->call_sign);
-      if (strlen(aStation->origin) > 0)
+      if (strlen(OBJECT_DATA(aStation)->origin) > 0)
       {
-        xastir_snprintf(origin,sizeof(origin),"%s",aStation->origin);
+        xastir_snprintf(origin,sizeof(origin),"%s",OBJECT_DATA(aStation)->origin);
       }
       else
       {
@@ -1838,6 +1839,7 @@ int getAllSimplePositionsPostgis(Connection *aDbConnection)
                   {
                     p_new_station->coord_lat = u_lat;
                     p_new_station->coord_lon = u_long;
+                    station_grid_update(p_new_station);
                     p_new_station->sec_heard = sec;
                   }
                 }
@@ -2181,9 +2183,9 @@ int storeStationSimplePointToGisDbMysql(Connection *aDbConnection, DataRow *aSta
             }
             special_overlay_length = strlen(special_overlay);
 
-            if (aStation->origin)
+            if (OBJECT_DATA(aStation)->origin)
             {
-              xastir_snprintf(origin,MAX_CALLSIGN+1,"%s",aStation->origin);
+              xastir_snprintf(origin,MAX_CALLSIGN+1,"%s",OBJECT_DATA(aStation)->origin);
             }
             else
             {
@@ -2385,6 +2387,7 @@ int getAllSimplePositionsMysqlSpatial(Connection *aDbConnection)
                   {
                     p_new_station->coord_lat = u_lat;
                     p_new_station->coord_lon = u_long;
+                    station_grid_update(p_new_station);
                     p_new_station->sec_heard = sec;
                   }
                 }
@@ -2645,9 +2648,9 @@ int storeStationSimplePointToDbMysql(Connection *aDbConnection, DataRow *aStatio
         xastir_snprintf(record_type,2,"%c",NORMAL_APRS);
       }
 
-      if (strlen(aStation->origin) > 0)
+      if (strlen(OBJECT_DATA(aStation)->origin) > 0)
       {
-        mysql_real_escape_string(&aDbConnection->mhandle,origin,(aStation->origin),strlen(aStation->origin));
+        mysql_real_escape_string(&aDbConnection->mhandle,origin,(OBJECT_DATA(aStation)->origin),strlen(OBJECT_DATA(aStation)->origin));
       }
       else
       {
@@ -20,6 +20,7 @@
 #include "rac_data.h"
 #include "interface.h"
 #include "maps.h"
+#include "map_OSM.h"
 #include "wx.h"
 #include "igate.h"
 #include "list_gui.h"
@@ -179,6 +180,10 @@ void track_station(Widget w, char * UNUSED(call_tracked), DataRow *p_station)
 
   if ( is_tracked_station(p_station->call_sign) )     // We want to track this station
   {
+    // Let the tiled maps fetch ahead of it
+    set_OSM_prefetch_track(p_station->coord_lat, p_station->coord_lon,
+                           atoi(p_station->course), atoi(p_station->speed));
+
     new_lat = p_station->coord_lat;                 // center map to station position as default
     new_lon = p_station->coord_lon;
     x_ofs = new_lon - center_longitude;            // current offset from screen center
@@ -250,7 +255,8 @@ void draw_trail(Widget w, DataRow *fill, int solid)
   XColor rgb;
   long brightness;
   char flag1;
-  TrackRow *ptr;
+  TrailCursor cursor;
+  TrackRow *ptr = &cursor.point;
 
 
   if (!ok_to_draw_station(fill))
@@ -264,10 +270,8 @@ void draw_trail(Widget w, DataRow *fill, int solid)
   // dialog.
   expire_trail_points(fill, sec_clear);
 
-  ptr = fill->newest_trackpoint;
-
   // Trail should have at least two points
-  if ( (ptr != NULL) && (ptr->prev != NULL) )
+  if (trail_last(fill->trail, &cursor) && fill->trail->count > 1)
   {
     int skip_dupes = 0; // Don't skip points first time through
 
@@ -305,16 +309,20 @@ void draw_trail(Widget w, DataRow *fill, int solid)
       (void)XSetDashes(XtDisplay(w), gc, 0, short_dashed, 2);
     }
 
-    // Traverse linked list of trail points from newest to
-    // oldest
-    while ( (ptr != NULL) && (ptr->prev != NULL) )
+    // Traverse the trail points from newest to oldest
+    while (1)
     {
       lon0 = ptr->trail_long_pos;         // Trail segment start
       lat0 = ptr->trail_lat_pos;
-      lon1 = ptr->prev->trail_long_pos;   // Trail segment end
-      lat1 = ptr->prev->trail_lat_pos;
       flag1 = ptr->flag; // Are we at the start of a new trail?
 
+      if (!trail_prev(&cursor))
+      {
+        break;
+      }
+      lon1 = ptr->trail_long_pos;         // Trail segment end
+      lat1 = ptr->trail_lat_pos;
+
       if ((flag1 & TR_NEWTRK) == '\0')
       {
         int lon0_screen, lat0_screen, lon1_screen, lat1_screen;
@@ -363,7 +371,7 @@ void draw_trail(Widget w, DataRow *fill, int solid)
           // times, but they overlay on top of each other
           // so no big deal.
           //
-          if (ptr != fill->newest_trackpoint)
+          if (skip_dupes)   // Not the newest segment
           {
 
             draw_nice_string(da,
@@ -394,7 +402,6 @@ void draw_trail(Widget w, DataRow *fill, int solid)
           }
         }
       }
-      ptr = ptr->prev;
       skip_dupes = 1;
     }
     (void)XSetDashes(XtDisplay(w), gc, 0, medium_dashed, 2);
@@ -445,6 +452,8 @@ void display_station(Widget w, DataRow *p_station, int single)
   int ambiguity_flag;
   long ambiguity_coord_lon, ambiguity_coord_lat;
   size_t temp_len;
+  TrackRow prev_point;
+  int have_prev_point;
 
 
   if (debug_level & 128)
@@ -457,6 +466,10 @@ void display_station(Widget w, DataRow *p_station, int single)
     return;
   }
 
+  // The trail point before the newest one, used below if the
+  // current data lacks altitude, speed or course.
+  have_prev_point = trail_store_previous(p_station->trail, &prev_point);
+
   // Set up call string for display
   if (Display_.callsign)
   {
@@ -498,17 +511,16 @@ void display_station(Widget w, DataRow *p_station, int single)
     }
 
     // Else check whether the previous position had altitude.
-    // Note that newest_trackpoint if it exists should be the
-    // same as the current data, so we have to go back one
+    // Note that the newest trackpoint if it exists should be
+    // the same as the current data, so we have to go back one
     // further trackpoint.
-    else if ( (p_station->newest_trackpoint != NULL)
-              && (p_station->newest_trackpoint->prev != NULL) )
+    else if (have_prev_point)
     {
-      if ( p_station->newest_trackpoint->prev->altitude > -99999l)
+      if ( prev_point.altitude > -99999l)
       {
         // Found it in the tracklog
         xastir_snprintf(temp_altitude, sizeof(temp_altitude), "%.0f%s",
-                        (float)(p_station->newest_trackpoint->prev->altitude * cvt_dm2len),
+                        (float)(prev_point.altitude * cvt_dm2len),
                         un_alt);
 
 //                fprintf(stderr,"Trail data              with altitude: %s : %s\n",
@@ -549,11 +561,10 @@ void display_station(Widget w, DataRow *p_station, int single)
                       atof(p_station->speed)*cvt_kn2len,tmp);
     }
     // Else check whether the previous position had speed
-    // Note that newest_trackpoint if it exists should be the
-    // same as the current data, so we have to go back one
+    // Note that the newest trackpoint if it exists should be
+    // the same as the current data, so we have to go back one
     // further trackpoint.
-    else if ( (p_station->newest_trackpoint != NULL)
-              && (p_station->newest_trackpoint->prev != NULL) )
+    else if (have_prev_point)
     {
 
       xastir_snprintf(tmp,
@@ -566,12 +577,12 @@ void display_station(Widget w, DataRow *p_station, int single)
         tmp[0] = '\0';  // without unit
       }
 
-      if ( p_station->newest_trackpoint->prev->speed > 0)
+      if ( prev_point.speed > 0)
       {
         speed_ok++;
 
         xastir_snprintf(temp_speed, sizeof(temp_speed), "%.0f%s",
-                        p_station->newest_trackpoint->prev->speed * cvt_hm2len,
+                        prev_point.speed * cvt_hm2len,
                         tmp);
       }
     }
@@ -587,17 +598,16 @@ void display_station(Widget w, DataRow *p_station, int single)
                       atof(p_station->course));
     }
     // Else check whether the previous position had a course
-    // Note that newest_trackpoint if it exists should be the
-    // same as the current data, so we have to go back one
+    // Note that the newest trackpoint if it exists should be
+    // the same as the current data, so we have to go back one
     // further trackpoint.
-    else if ( (p_station->newest_trackpoint != NULL)
-              && (p_station->newest_trackpoint->prev != NULL) )
+    else if (have_prev_point)
     {
-      if( p_station->newest_trackpoint->prev->course > 0 )
+      if( prev_point.course > 0 )
       {
         course_ok++;
         xastir_snprintf(temp_course, sizeof(temp_course), "%.0f\xB0",
-                        (float)p_station->newest_trackpoint->prev->course);
+                        (float)prev_point.course);
       }
     }
   }
@@ -797,31 +807,31 @@ void display_station(Widget w, DataRow *p_station, int single)
   }
 
   // Check for DF'ing data, draw DF circles if present and enabled
-  if (Display_.df_data && strlen(p_station->signal_gain) == 7)    // There's an SHGD defined
+  if (Display_.df_data && strlen(EXTRA_DATA(p_station)->signal_gain) == 7)    // There's an SHGD defined
   {
     //fprintf(stderr,"SHGD:%s\n",p_station->signal_gain);
     draw_DF_circle( (ambiguity_flag) ? ambiguity_coord_lon : p_station->coord_lon,
                     (ambiguity_flag) ? ambiguity_coord_lat : p_station->coord_lat,
-                    p_station->signal_gain,
+                    EXTRA_DATA(p_station)->signal_gain,
                     temp_sec_heard,
                     drawing_target);
   }
 
   // Check for DF'ing beam heading/NRQ data
-  if (Display_.df_data && (strlen(p_station->bearing) == 3) && (strlen(p_station->NRQ) == 3))
+  if (Display_.df_data && (strlen(EXTRA_DATA(p_station)->bearing) == 3) && (strlen(EXTRA_DATA(p_station)->NRQ) == 3))
   {
     //fprintf(stderr,"Bearing: %s\n",p_station->signal_gain,NRQ);
-    if (p_station->df_color == -1)
+    if (EXTRA_DATA(p_station)->df_color == -1)
     {
-      p_station->df_color = rand() % MAX_TRAIL_COLORS;
+      get_extra_data(p_station)->df_color = rand() % MAX_TRAIL_COLORS;
     }
 
     draw_bearing( (ambiguity_flag) ? ambiguity_coord_lon : p_station->coord_lon,
                   (ambiguity_flag) ? ambiguity_coord_lat : p_station->coord_lat,
                   p_station->course,
-                  p_station->bearing,
-                  p_station->NRQ,
-                  trail_colors[p_station->df_color],
+                  EXTRA_DATA(p_station)->bearing,
+                  EXTRA_DATA(p_station)->NRQ,
+                  trail_colors[EXTRA_DATA(p_station)->df_color],
                   Display_.df_beamwidth_data, Display_.df_bearing_data,
                   temp_sec_heard,
                   drawing_target);
@@ -830,7 +840,7 @@ void display_station(Widget w, DataRow *p_station, int single)
   // Check whether to draw dead-reckoning data by KJ5O
   if (Display_.dr_data
       && ( (p_station->flag & ST_MOVING)
-           //        && (p_station->newest_trackpoint!=0
+           //        && (p_station->trail!=0
            && course_ok
            && speed_ok
            && scale_y < 8000
@@ -1173,7 +1183,7 @@ void display_station(Widget w, DataRow *p_station, int single)
               drawing_target,
               orient,
               p_station->aprs_symbol.area_object.type,
-              p_station->signpost,
+              OBJECT_DATA(p_station)->signpost,
               temp2_my_gauge_data,
               1); // Increment "currently_selected_stations"
 
@@ -1215,20 +1225,20 @@ void display_station(Widget w, DataRow *p_station, int single)
   {
 
     // Check for Map View "eyeball" symbol
-    if ( strncmp(p_station->power_gain,"RNG",3) == 0
+    if ( strncmp(EXTRA_DATA(p_station)->power_gain,"RNG",3) == 0
          && p_station->aprs_symbol.aprs_type == '/'
          && p_station->aprs_symbol.aprs_symbol == 'E' )
     {
       // Map View "eyeball" symbol.  Don't draw the RNG ring
       // for it.
     }
-    else if (strlen(p_station->power_gain) == 7)
+    else if (strlen(EXTRA_DATA(p_station)->power_gain) == 7)
     {
       // Station has PHG or RNG defined
       //
       draw_phg_rng( (ambiguity_flag) ? ambiguity_coord_lon : p_station->coord_lon,
                     (ambiguity_flag) ? ambiguity_coord_lat : p_station->coord_lat,
-                    p_station->power_gain,
+                    EXTRA_DATA(p_station)->power_gain,
                     temp_sec_heard,
                     drawing_target);
     }
@@ -1248,9 +1258,9 @@ void display_station(Widget w, DataRow *p_station, int single)
 
 
   // Draw minimum proximity circle?
-  if (p_station->probability_min[0] != '\0')
+  if (OBJECT_DATA(p_station)->probability_min[0] != '\0')
   {
-    double range = atof(p_station->probability_min);
+    double range = atof(OBJECT_DATA(p_station)->probability_min);
 
     // Draw red circle
     draw_pod_circle(p_station->coord_lon,
@@ -1262,9 +1272,9 @@ void display_station(Widget w, DataRow *p_station, int single)
   }
 
   // Draw maximum proximity circle?
-  if (p_station->probability_max[0] != '\0')
+  if (OBJECT_DATA(p_station)->probability_max[0] != '\0')
   {
-    double range = atof(p_station->probability_max);
+    double range = atof(OBJECT_DATA(p_station)->probability_max);
 
     // Draw red circle
     draw_pod_circle(p_station->coord_lon,
@@ -1709,6 +1719,8 @@ void draw_ruler(Widget w)
 void display_file(Widget w)
 {
   DataRow *p_station;         // pointer to station data
+  DataRow **view_list;        // stations in view area, oldest first
+  int view_count, ii;
   time_t temp_sec_heard;      // time last heard
   time_t t_clr, t_old, now;
 
@@ -1731,10 +1743,14 @@ void display_file(Widget w)
   t_old = now - sec_old;        // precalc compare times
   t_clr = now - sec_clear;
   temp_sec_heard = 0l;
-  p_station = t_oldest;                // start with oldest station, have newest on top at t_newest
 
-  while (p_station != NULL)
+  // Only look at stations in the view area.  They come back oldest
+  // first, so we have newest on top like walking from t_oldest.
+  view_count = stations_in_view(&view_list);
+
+  for (ii = 0; ii < view_count; ii++)
   {
+    p_station = view_list[ii];
 
     if (debug_level & 64)
     {
@@ -1751,7 +1767,6 @@ void display_file(Widget w)
       }
 
       // Skip to the next station in the list
-      p_station = p_station->t_newer;  // next station
       continue;
     }
 
@@ -1782,7 +1797,6 @@ void display_file(Widget w)
       }
 
       // Skip to the next station in the list
-      p_station = p_station->t_newer;  // next station
       continue;
     }
 
@@ -1798,7 +1812,6 @@ void display_file(Widget w)
       }
 
       // Skip to the next station in the list
-      p_station = p_station->t_newer;  // next station
       continue;
     }
 
@@ -1808,7 +1821,7 @@ void display_file(Widget w)
     }
 
     // Display trail if we should
-    if (Display_.trail && p_station->newest_trackpoint != NULL)
+    if (Display_.trail && p_station->trail != NULL)
     {
       // ????????????   what is the difference? :
 
@@ -1859,7 +1872,7 @@ void display_file(Widget w)
       if (debug_level & 256)
       {
         fprintf(stderr,"Station trails %d, track data %lx\n",
-                Display_.trail, (long int)p_station->newest_trackpoint);
+                Display_.trail, (long int)p_station->trail);
       }
     }
 
@@ -1872,8 +1885,6 @@ void display_file(Widget w)
     // currently_selected_stations variable, if we're
     // updating all of the stations at once.
     display_station(w,p_station,0);
-
-    p_station = p_station->t_newer;  // next station
   }
 
   draw_ruler(w);
@@ -2174,11 +2185,11 @@ void Clear_DF_from_Station_data(Widget UNUSED(w), XtPointer clientData, XtPointe
 {
   DataRow *p_station = clientData;
 
-  if (strlen(p_station->bearing) == 3)
+  if (strlen(EXTRA_DATA(p_station)->bearing) == 3)
   {
     // we have DF data to clear
-    p_station->bearing[0]='\0';
-    p_station->NRQ[0]='\0';
+    p_station->extra_data->bearing[0]='\0';
+    p_station->extra_data->NRQ[0]='\0';
   }
 }
 
@@ -2369,6 +2380,52 @@ void Show_Aloha_Stats(Widget UNUSED(w), XtPointer UNUSED(clientData), XtPointer
 }
 
 
+
+// popup window on menu request: memory used by the per-station
+// record pools, and how the igate dupe checks are doing
+void Show_Memory_Stats(Widget UNUSED(w), XtPointer UNUSED(clientData), XtPointer UNUSED(callData) )
+{
+  char temp[1000];
+  char line[200];
+  row_pool *pool;
+  unsigned long points, peak, bytes;
+  unsigned long hits, misses;
+  int ii;
+
+
+  // "%s: %lu in use, %lu peak, %lu kB"
+  trail_store_stats(&points, &peak, &bytes);
+  xastir_snprintf(temp,sizeof(temp),langcode("WPUPMEM001"),
+                  "TrackRow",
+                  points,
+                  peak,
+                  (bytes + 1023) / 1024);
+  strncat(temp,"\n",sizeof(temp) - 1 - strlen(temp));
+
+  for (ii = 0; (pool = get_station_row_pool(ii)) != NULL; ii++)
+  {
+    // "%s: %lu in use, %lu peak, %lu kB"
+    xastir_snprintf(line,sizeof(line),langcode("WPUPMEM001"),
+                    pool->name,
+                    pool->live,
+                    pool->peak,
+                    (row_pool_bytes(pool) + 1023) / 1024);
+    strncat(temp,line,sizeof(temp) - 1 - strlen(temp));
+    strncat(temp,"\n",sizeof(temp) - 1 - strlen(temp));
+  }
+
+  // "Igate dupe checks: %lu dupes, %lu passed"
+  get_igate_dupe_stats(&hits, &misses);
+  xastir_snprintf(line,sizeof(line),langcode("WPUPMEM002"),
+                  hits,
+                  misses);
+  strncat(temp,line,sizeof(temp) - 1 - strlen(temp));
+  strncat(temp,"\n",sizeof(temp) - 1 - strlen(temp));
+
+  popup_message_always(langcode("PULDNFI017"),temp);
+}
+
+
 // ========================================================================
 // STATION DATA FILL-IN AND DISPLAY
 // ========================================================================
@@ -2671,64 +2728,22 @@ void station_data_fill_in ( Widget w, XtPointer clientData, XtPointer calldata )
   XmTextInsert(si_text,pos,temp);
   pos += strlen(temp);
 
-  xastir_snprintf(temp,
-                  sizeof(temp),
-                  "%s",
-                  p_station->packet_time);
-  temp[2]='/';
-  temp[3]='\0';
-  XmTextInsert(si_text,pos,temp);
-  pos += strlen(temp);
-
-  xastir_snprintf(temp,
-                  sizeof(temp),
-                  "%s",
-                  p_station->packet_time+2);
-  temp[2]='/';
-  temp[3]='\0';
-  XmTextInsert(si_text,pos,temp);
-  pos += strlen(temp);
-
-  xastir_snprintf(temp,
-                  sizeof(temp),
-                  "%s",
-                  p_station->packet_time+4);
-  temp[4]=' ';
-  temp[5]='\0';
-  XmTextInsert(si_text,pos,temp);
-  pos += strlen(temp);
-
-  xastir_snprintf(temp,
-                  sizeof(temp),
-                  "%s",
-                  p_station->packet_time+8);
-  temp[2]=':';
-  temp[3]='\0';
-  XmTextInsert(si_text,pos,temp);
-  pos += strlen(temp);
-
-  xastir_snprintf(temp,
-                  sizeof(temp),
-                  "%s",
-                  p_station->packet_time+10);
-  temp[2]=':';
-  temp[3]='\0';
-  XmTextInsert(si_text,pos,temp);
-  pos += strlen(temp);
-
-  xastir_snprintf(temp,
-                  sizeof(temp),
-                  "%s",
-                  p_station->packet_time+12);
-  temp[2]='\n';
-  temp[3]='\0';
+  if (p_station->packet_time != 0)
+  {
+    sec = p_station->packet_time;
+    (void)strftime(temp, sizeof(temp), "%m/%d/%Y %H:%M:%S\n", localtime(&sec));
+  }
+  else
+  {
+    xastir_snprintf(temp, sizeof(temp), "\n");
+  }
   XmTextInsert(si_text,pos,temp);
   pos += strlen(temp);
 
   // Object
-  if (strlen(p_station->origin) > 0)
+  if (strlen(OBJECT_DATA(p_station)->origin) > 0)
   {
-    xastir_snprintf(temp, sizeof(temp), langcode("WPUPSTI000"),p_station->origin);
+    xastir_snprintf(temp, sizeof(temp), langcode("WPUPSTI000"),OBJECT_DATA(p_station)->origin);
     XmTextInsert(si_text,pos,temp);
     pos += strlen(temp);
     xastir_snprintf(temp, sizeof(temp), "\n");
@@ -2791,7 +2806,7 @@ void station_data_fill_in ( Widget w, XtPointer clientData, XtPointer calldata )
   XmTextInsert(si_text,pos,temp);
   pos += strlen(temp);
 
-  if (p_station->newest_trackpoint != NULL)
+  if (p_station->trail != NULL)
   {
     xastir_snprintf(temp, sizeof(temp), "%s", langcode("WPUPSTI013"));
     XmTextInsert(si_text,pos,temp);
@@ -2929,29 +2944,29 @@ void station_data_fill_in ( Widget w, XtPointer clientData, XtPointer calldata )
   }
 
   // Current Power Gain ...
-  if (strlen(p_station->power_gain) == 7)
+  if (strlen(EXTRA_DATA(p_station)->power_gain) == 7)
   {
     // Check for RNG instead of PHG
-    if (p_station->power_gain[0] == 'R')
+    if (EXTRA_DATA(p_station)->power_gain[0] == 'R')
     {
       // Found a Range
       xastir_snprintf(temp,
                       sizeof(temp),
                       langcode("WPUPSTI067"),
-                      atoi(&p_station->power_gain[3]));
+                      atoi(&EXTRA_DATA(p_station)->power_gain[3]));
     }
     else
     {
       // Found PHG
       phg_decode(langcode("WPUPSTI014"), // "Current Power Gain"
-                 p_station->power_gain,
+                 EXTRA_DATA(p_station)->power_gain,
                  temp,
                  sizeof(temp), english_units );
     }
 
     // Check for Map View symbol:  Eyeball symbol with // RNG
     // extension.
-    if ( strncmp(p_station->power_gain,"RNG",3) == 0
+    if ( strncmp(EXTRA_DATA(p_station)->power_gain,"RNG",3) == 0
          && p_station->aprs_symbol.aprs_type == '/'
          && p_station->aprs_symbol.aprs_symbol == 'E' )
     {
@@ -3007,18 +3022,18 @@ void station_data_fill_in ( Widget w, XtPointer clientData, XtPointer calldata )
   pos += strlen(temp);
 
   // Current DF Info ...
-  if (strlen(p_station->signal_gain) == 7)
+  if (strlen(EXTRA_DATA(p_station)->signal_gain) == 7)
   {
-    shg_decode(langcode("WPUPSTI057"), p_station->signal_gain, temp, sizeof(temp) , english_units);
+    shg_decode(langcode("WPUPSTI057"), EXTRA_DATA(p_station)->signal_gain, temp, sizeof(temp) , english_units);
     XmTextInsert(si_text,pos,temp);
     pos += strlen(temp);
     xastir_snprintf(temp, sizeof(temp), "\n");
     XmTextInsert(si_text,pos,temp);
     pos += strlen(temp);
   }
-  if (strlen(p_station->bearing) == 3)
+  if (strlen(EXTRA_DATA(p_station)->bearing) == 3)
   {
-    bearing_decode(langcode("WPUPSTI058"), p_station->bearing, p_station->NRQ, temp, sizeof(temp), english_units );
+    bearing_decode(langcode("WPUPSTI058"), EXTRA_DATA(p_station)->bearing, EXTRA_DATA(p_station)->NRQ, temp, sizeof(temp), english_units );
     XmTextInsert(si_text,pos,temp);
     pos += strlen(temp);
     xastir_snprintf(temp, sizeof(temp), "\n");
@@ -3027,9 +3042,9 @@ void station_data_fill_in ( Widget w, XtPointer clientData, XtPointer calldata )
   }
 
   // Signpost Data
-  if (strlen(p_station->signpost) > 0)
+  if (strlen(OBJECT_DATA(p_station)->signpost) > 0)
   {
-    xastir_snprintf(temp, sizeof(temp), "%s: %s",langcode("POPUPOB029"), p_station->signpost);
+    xastir_snprintf(temp, sizeof(temp), "%s: %s",langcode("POPUPOB029"), OBJECT_DATA(p_station)->signpost);
     XmTextInsert(si_text,pos,temp);
     pos += strlen(temp);
     xastir_snprintf(temp, sizeof(temp), "\n");
@@ -3269,21 +3284,19 @@ void station_data_fill_in ( Widget w, XtPointer clientData, XtPointer calldata )
   pos += strlen(temp);
 
   // list rest of trail data
-  if (p_station->newest_trackpoint != NULL)
+  if (p_station->trail != NULL)
   {
-    TrackRow *ptr;
+    TrailCursor cursor;
+    TrackRow *ptr = &cursor.point;
 
-    ptr = p_station->newest_trackpoint;
+    (void)trail_last(p_station->trail, &cursor);
 
     // Skip the first (latest) trackpoint as if it exists, it'll
     // be the same as the data in the station record, which we
     // just printed out.
-    if (ptr->prev != NULL)
-    {
-      ptr = ptr->prev;
-    }
+    (void)trail_prev(&cursor);
 
-    while ( (ptr != NULL) && (track_count <= MAX_TRACK_LIST) )
+    do
     {
 
       track_count++;
@@ -3429,8 +3442,8 @@ void station_data_fill_in ( Widget w, XtPointer clientData, XtPointer calldata )
       pos += strlen(temp);
 
       // Go back in time one trackpoint
-      ptr = ptr->prev;
     }
+    while (track_count <= MAX_TRACK_LIST && trail_prev(&cursor));
   }
 
 
@@ -3870,7 +3883,7 @@ void Station_data(Widget w, XtPointer clientData, XtPointer calldata)
 
 
     button_clear_track = NULL;  // Need this later, don't delete!
-    if (p_station->newest_trackpoint != NULL)
+    if (p_station->trail != NULL)
     {
       // [ Clear Track ]
       button_clear_track = XtVaCreateManagedWidget(langcode("WPUPSTI045"),xmPushButtonGadgetClass, form,
@@ -4035,9 +4048,9 @@ void Station_data(Widget w, XtPointer clientData, XtPointer calldata)
       // If match on "WINLINK":  Don't copy origin callsign
       // into local_station.  Use the object name instead
       // which should be a callsign.
-      if (strncmp(p_station->origin,"WINLINK",7))
+      if (strncmp(OBJECT_DATA(p_station)->origin,"WINLINK",7))
       {
-        xastir_snprintf(local_station,sizeof(local_station),"%s",p_station->origin);
+        xastir_snprintf(local_station,sizeof(local_station),"%s",OBJECT_DATA(p_station)->origin);
       }
     }
 
@@ -4093,7 +4106,7 @@ void Station_data(Widget w, XtPointer clientData, XtPointer calldata)
       xastir_snprintf(temp,
                       sizeof(temp),
                       "%s",
-                      p_station->origin);
+                      OBJECT_DATA(p_station)->origin);
       temp[6] = '\0';
       ptr3 = strstr(p_station->comment_data->text_ptr,"{");
       ptr3++; // Skip over the '{' character
@@ -4200,7 +4213,7 @@ void Station_data(Widget w, XtPointer clientData, XtPointer calldata)
     XtAddCallback(button_cancel, XmNactivateCallback, Station_data_destroy_shell, db_station_info);
 
     // Button to clear DF bearing data if we actually have some.
-    if (strlen(p_station->bearing) == 3)
+    if (strlen(EXTRA_DATA(p_station)->bearing) == 3)
     {
       button_clear_df = XtVaCreateManagedWidget(langcode("WPUPSTI092"),xmPushButtonGadgetClass, form,
                         XmNtopAttachment, XmATTACH_NONE,
@@ -4607,6 +4620,9 @@ void Station_info(Widget w, XtPointer clientData, XtPointer UNUSED(calldata) )
 {
   DataRow *p_station;
   DataRow *p_found;
+  DataRow **near_list;
+  int near_count, ii;
+  long click_lat, click_lon;
   int num_found = 0;
   unsigned long min_diff_x, diff_x, min_diff_y, diff_y;
   XmString str_ptr;
@@ -4622,13 +4638,20 @@ void Station_info(Widget w, XtPointer clientData, XtPointer UNUSED(calldata) )
 
   min_diff_y = scale_y * 20;  // Pixels each way in y-direction.
   min_diff_x = scale_x * 20;  // Pixels each way in x-direction.
+  click_lat = NW_corner_latitude + (menu_y*scale_y);
+  click_lon = NW_corner_longitude + (menu_x*scale_x);
   p_found = NULL;
-  p_station = n_first;
 
   // Here we just count them.  We go through the same type of code
-  // again later if we find more than one station.
-  while (p_station != NULL)      // search through database for nearby stations
+  // again later if we find more than one station.  The spatial
+  // index hands us only the stations around the pointer, in the
+  // same order as the name list.
+  near_count = station_grid_query(click_lon - min_diff_x, click_lon + min_diff_x,
+                                  click_lat - min_diff_y, click_lat + min_diff_y,
+                                  STATION_GRID_NAME_ORDER, &near_list);
+  for (ii = 0; ii < near_count; ii++)      // search through nearby stations
   {
+    p_station = near_list[ii];
 
     if ( ( (p_station->flag & ST_INVIEW) != 0)
          && ok_to_draw_station(p_station) )   // only test stations in view
@@ -4647,11 +4670,9 @@ void Station_info(Widget w, XtPointer clientData, XtPointer UNUSED(calldata) )
         // and (10 * scale_x) if we want to make a very
         // accurate square.
 
-        diff_y = (unsigned long)( labs((NW_corner_latitude+(menu_y*scale_y))
-                                       - p_station->coord_lat));
+        diff_y = (unsigned long)( labs(click_lat - p_station->coord_lat));
 
-        diff_x = (unsigned long)( labs((NW_corner_longitude+(menu_x*scale_x))
-                                       - p_station->coord_lon));
+        diff_x = (unsigned long)( labs(click_lon - p_station->coord_lon));
 
         // If the station fits within our bounding box,
         // count it
@@ -4662,7 +4683,6 @@ void Station_info(Widget w, XtPointer clientData, XtPointer UNUSED(calldata) )
         }
       }
     }
-    p_station = p_station->n_next;
   }
 
   if (p_found != NULL)    // We found at least one station
@@ -4802,9 +4822,12 @@ void Station_info(Widget w, XtPointer clientData, XtPointer UNUSED(calldata) )
 
         /*fprintf(stderr,"What station\n");*/
         n = 1;
-        p_station = n_first;
-        while (p_station != NULL)      // search through database for nearby stations
+        near_count = station_grid_query(click_lon - min_diff_x, click_lon + min_diff_x,
+                                        click_lat - min_diff_y, click_lat + min_diff_y,
+                                        STATION_GRID_NAME_ORDER, &near_list);
+        for (ii = 0; ii < near_count; ii++)      // search through nearby stations
         {
+          p_station = near_list[ii];
 
           if ( ( (p_station->flag & ST_INVIEW) != 0)
                && ok_to_draw_station(p_station) )   // only test stations in view
@@ -4813,11 +4836,9 @@ void Station_info(Widget w, XtPointer clientData, XtPointer UNUSED(calldata) )
             if (!altnet || is_altnet(p_station))
             {
 
-              diff_y = (unsigned long)( labs((NW_corner_latitude+(menu_y*scale_y))
-                                             - p_station->coord_lat));
+              diff_y = (unsigned long)( labs(click_lat - p_station->coord_lat));
 
-              diff_x = (unsigned long)( labs((NW_corner_longitude+(menu_x*scale_x))
-                                             - p_station->coord_lon));
+              diff_x = (unsigned long)( labs(click_lon - p_station->coord_lon));
 
               // If the station fits within our
               // bounding box, count it.
@@ -4840,7 +4861,6 @@ void Station_info(Widget w, XtPointer clientData, XtPointer UNUSED(calldata) )
               }
             }
           }
-          p_station = p_station->n_next;
         }
 
 
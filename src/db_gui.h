@@ -48,6 +48,7 @@ extern void General_query(Widget w, XtPointer clientData, XtPointer calldata);
 extern void IGate_query(Widget w, XtPointer clientData, XtPointer calldata);
 extern void WX_query(Widget w, XtPointer clientData, XtPointer calldata);
 void Show_Aloha_Stats(Widget w, XtPointer clientData, XtPointer callData);
+void Show_Memory_Stats(Widget w, XtPointer clientData, XtPointer callData);
 
 
 // ------------------------------------------------------------------------
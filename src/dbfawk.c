@@ -36,6 +36,8 @@
 // dbfawk_load_sigs
 // dbfawk_find_sig
 // dbfawk_parse_record (indirectly)
+// dbfawk_memo_new
+// dbfawk_memo_parse_record (indirectly)
 //
 // Functions which free memory:
 // ----------------------------
@@ -44,6 +46,8 @@
 // dbfawk_free_sig
 // dbfawk_free_sigs
 // dbfawk_find_sig
+// dbfawk_memo_free
+// dbfawk_memo_bind
 //
 
 
@@ -59,6 +63,7 @@
 #include <dirent.h>
 #include "awk.h"
 #include "dbfawk.h"
+#include "cache_utils.h"
 #include "snprintf.h"
 #include "globals.h"
 
@@ -69,6 +74,39 @@
 
 
 
+// The memo of a layer keeps up to DBFAWK_MEMO_BUDGET bytes of results.
+// If fewer than a quarter of its first DBFAWK_MEMO_TRIAL records repeat
+// ones seen before (e.g. the program reads a unique ID field), it
+// gives up on the layer.
+#define DBFAWK_MEMO_BUCKETS 4096    // Must be a power of two
+#define DBFAWK_MEMO_BUDGET  (4 * 1024 * 1024)
+#define DBFAWK_MEMO_TRIAL   2048
+#define DBFAWK_MEMO_KEY_MAX 4096
+
+typedef struct dbfawk_memo_entry_
+{
+  struct dbfawk_memo_entry_ *next;
+  unsigned int hash;
+  int keylen;
+  char data[];                /* key, then the symbol values */
+} dbfawk_memo_entry;
+
+struct dbfawk_memo_
+{
+  char *file;                 /* .dbfawk the results came from */
+  time_t mtime;
+  off_t size;
+  awk_symtab *symtbl;
+  awk_symbol **outputs;       /* symbols set for each record */
+  int noutputs;
+  int enabled;
+  unsigned long lookups;
+  unsigned long hits;
+  size_t bytes;
+  dbfawk_memo_entry *bucket[DBFAWK_MEMO_BUCKETS];
+};
+
+
 
 
 /*
@@ -113,6 +151,7 @@ void dbfawk_free_info ( dbfawk_field_info *list)
   {
     x = p;
     p = p->next;
+    free(x->rules);
     free(x);
   }
 }
@@ -314,6 +353,7 @@ dbfawk_sig_info *dbfawk_load_sigs(const char *dir, /* directory path */
                       e->d_name);
 
       i->prog = awk_load_program_file(path);
+      i->file = strdup(path);
 
       if (awk_compile_program(symtbl,i->prog) < 0)
       {
@@ -362,6 +402,11 @@ void dbfawk_free_sig(dbfawk_sig_info *ptr)
     {
       free(ptr->sig);
     }
+
+    if (ptr->file)
+    {
+      free(ptr->file);
+    }
     free(ptr);
   }
 }
@@ -437,7 +482,7 @@ dbfawk_sig_info *dbfawk_find_sig(dbfawk_sig_info *Dbf_sigs,
        to flag that it's safe to free this memory when we're done with
        it */
     info->sig = NULL;
-    free(perfile);
+    info->file = perfile;
     if (info->prog)
     {
 
@@ -464,9 +509,89 @@ dbfawk_sig_info *dbfawk_find_sig(dbfawk_sig_info *Dbf_sigs,
 
 
 
+/*
+ * dbfawk_field_string: Format field 'finfo' of record 'i' as
+ *  "NAME=value" into buf, which should hold 1024 bytes.  The first
+ *  time through each field gets the list of rules whose pattern can
+ *  match its name, so the others are never tried.  Returns the length,
+ *  or 0 if no rule can match the field so it wasn't even read.
+ */
+static int dbfawk_field_string(awk_program *rs,
+                               DBFHandle dbf,
+                               dbfawk_field_info *finfo,
+                               int i,
+                               char *buf,
+                               int size)
+{
+  int namelen;
+
+  namelen = strlen(finfo->name);
+  memcpy(buf,finfo->name,namelen);
+  buf[namelen++] = '=';
+
+  if (finfo->prog != rs)
+  {
+    free(finfo->rules);
+    finfo->nrules = awk_select_rules(rs,buf,namelen,&finfo->rules);
+    finfo->prog = rs;
+  }
+  if (finfo->nrules == 0)
+  {
+    return 0;
+  }
+
+  switch (finfo->type)
+  {
+    case FTString:
+      xastir_snprintf(&buf[namelen],size-namelen,"%s",DBFReadStringAttribute(dbf,i,finfo->num));
+      break;
+    case FTInteger:
+      xastir_snprintf(&buf[namelen],size-namelen,"%d",DBFReadIntegerAttribute(dbf,i,finfo->num));
+      break;
+    case FTDouble:
+      xastir_snprintf(&buf[namelen],size-namelen,"%f",DBFReadDoubleAttribute(dbf,i,finfo->num));
+      break;
+    case FTInvalid:
+    default:
+      xastir_snprintf(&buf[namelen],size-namelen,"??");
+      break;
+  }
+  return strlen(buf);
+}
+
+
+
+
+
+/*
+ * dbfawk_exec_field: Run the rules selected for a field on its
+ *  "NAME=value" string.
+ */
+static int dbfawk_exec_field(awk_program *rs,
+                             dbfawk_field_info *finfo,
+                             char *buf,
+                             int len)
+{
+  if (finfo->nrules > 0)
+  {
+    return awk_exec_rules(rs,finfo->rules,finfo->nrules,buf,len);
+  }
+  else    /* couldn't select, try them all */
+  {
+    return awk_exec_program(rs,buf,len);
+  }
+}
+
+
+
+
+
 /*
  * dbfawk_parse_record:  Read a dbf record and parse only the fields
  *  listed in 'fi' using the program, 'rs'.
+ *
+ *  The rules are matched against "NAME=value".  Fields no rule can
+ *  match aren't read.
  */
 void dbfawk_parse_record(awk_program *rs,
                          DBFHandle dbf,
@@ -474,35 +599,530 @@ void dbfawk_parse_record(awk_program *rs,
                          int i)
 {
   dbfawk_field_info *finfo;
+  char qbuf[1024];
+  int len;
 
   awk_exec_begin_record(rs); /* execute a BEGIN_RECORD rule if any */
 
   for (finfo = fi; finfo ; finfo = finfo->next)
   {
-    char qbuf[1024];
+    len = dbfawk_field_string(rs,dbf,finfo,i,qbuf,sizeof(qbuf));
+    if (len > 0 && dbfawk_exec_field(rs,finfo,qbuf,len) == 2)
+    {
+      break;
+    }
+  }
+  awk_exec_end_record(rs); /* execute an END_RECORD rule if any */
+}
+
+
+
+
+
+/*
+ * The memo remembers what dbfawk_parse_record() left in the symbols
+ *  for each distinct set of field values in a layer, so records that
+ *  repeat one (most of them, in road and landuse layers) are a hash
+ *  lookup instead of a run of the program.  That only holds if the
+ *  results depend on nothing but the fields, i.e. BEGIN_RECORD resets
+ *  every symbol the program sets per record to a constant.
+ */
+
+
+
+/*
+ * dbfawk_memo_new: alloc an empty, unbound memo
+ */
+dbfawk_memo *dbfawk_memo_new(void)
+{
+  dbfawk_memo *memo = calloc(1,sizeof(dbfawk_memo));
+
+  if (!memo)
+  {
+    fprintf(stderr,"Couldn't allocate memory in dbfawk_memo_new()\n");
+  }
+  return memo;
+}
+
+
+
 
-    switch (finfo->type)
+
+/*
+ * dbfawk_memo_clear: forget all results
+ */
+static void dbfawk_memo_clear(dbfawk_memo *memo)
+{
+  dbfawk_memo_entry *e, *n;
+  int b;
+
+  for (b = 0; b < DBFAWK_MEMO_BUCKETS; b++)
+  {
+    for (e = memo->bucket[b]; e; e = n)
     {
-      case FTString:
-        sprintf(qbuf,"%s=%s",finfo->name,DBFReadStringAttribute(dbf,i,finfo->num));
-        break;
-      case FTInteger:
-        sprintf(qbuf,"%s=%d",finfo->name,DBFReadIntegerAttribute(dbf,i,finfo->num));
-        break;
-      case FTDouble:
-        sprintf(qbuf,"%s=%f",finfo->name,DBFReadDoubleAttribute(dbf,i,finfo->num));
-        break;
-      case FTInvalid:
-      default:
-        sprintf(qbuf,"%s=??",finfo->name);
+      n = e->next;
+      free(e);
+    }
+    memo->bucket[b] = NULL;
+  }
+  memo->bytes = 0;
+}
+
+
+
+
+
+/*
+ * dbfawk_memo_free: free the memo and everything in it
+ */
+void dbfawk_memo_free(dbfawk_memo *memo)
+{
+  if (memo)
+  {
+    dbfawk_memo_clear(memo);
+    free(memo->outputs);
+    free(memo->file);
+    free(memo);
+  }
+}
+
+
+
+
+
+/*
+ * dbfawk_memo_add_output: add the dest of each assignment in 'code'
+ *  to the list of symbols set per record.  Returns -1 if one of them
+ *  is $0 thru $9, whose values point into the record.
+ */
+static int dbfawk_memo_add_output(awk_program *rs,
+                                  awk_symbol **outputs,
+                                  int *noutputs,
+                                  int max,
+                                  const awk_action *code)
+{
+  const awk_action *p;
+  int i;
+
+  for (p = code; p; p = p->next_act)
+  {
+    if (p->opcode != ASSIGN && p->opcode != ASSIGN_CONST)
+    {
+      continue;
+    }
+    for (i = 0; i < AWK_MAXSUBS; i++)
+    {
+      if (p->dest == rs->subs[i])
+      {
+        return -1;
+      }
+    }
+    for (i = 0; i < *noutputs && outputs[i] != p->dest; i++)
+      ;
+    if (i == *noutputs)
+    {
+      if (*noutputs == max)
+      {
+        return -1;
+      }
+      outputs[(*noutputs)++] = p->dest;
+    }
+  }
+  return 0;
+}
+
+
+
+
+
+/*
+ * dbfawk_memo_refs_subs: does 'code' expand any of $0 thru $9?
+ */
+static int dbfawk_memo_refs_subs(awk_program *rs, const awk_action *code)
+{
+  const awk_action *p;
+  int i,j;
+
+  for (p = code; p; p = p->next_act)
+  {
+    for (i = 0; i < p->noperands; i++)
+    {
+      for (j = 0; p->operand[i].sym && j < AWK_MAXSUBS; j++)
+      {
+        if (p->operand[i].sym == rs->subs[j])
+        {
+          return 1;
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+
+
+
+
+/*
+ * dbfawk_memo_const_expr: is the assignment's value free of symbols?
+ */
+static int dbfawk_memo_const_expr(const awk_action *p)
+{
+  int i;
+
+  for (i = 0; i < p->noperands; i++)
+  {
+    if (p->operand[i].sym)
+    {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+
+
+
+
+/*
+ * dbfawk_memo_pure: does BEGIN_RECORD set each output to a constant
+ *  before it can stop?
+ */
+static int dbfawk_memo_pure(awk_program *rs,
+                            awk_symbol **outputs,
+                            int noutputs)
+{
+  const awk_action *p;
+  int i, reset;
+
+  if (!rs->begin_rec)
+  {
+    return noutputs == 0;
+  }
+  for (i = 0; i < noutputs; i++)
+  {
+    reset = 0;
+    for (p = rs->begin_rec->code; p && !reset; p = p->next_act)
+    {
+      if (p->opcode == NEXT || p->opcode == SKIP)
+      {
         break;
+      }
+      if (p->dest == outputs[i]
+          && (p->opcode == ASSIGN_CONST
+              || (p->opcode == ASSIGN && dbfawk_memo_const_expr(p))))
+      {
+        reset = 1;
+      }
+    }
+    if (!reset)
+    {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+
+
+
+
+/*
+ * dbfawk_memo_bind: Use the memo with compiled program 'rs', loaded
+ *  from 'file'.  The results are kept as long as the program comes from
+ *  the same, unchanged file and sets the same symbols, and are thrown
+ *  away otherwise.  Returns 1 if the memo will be used, 0 if the program
+ *  isn't suitable or the memo gave up on this layer.
+ */
+int dbfawk_memo_bind(dbfawk_memo *memo, awk_program *rs, const char *file)
+{
+  struct stat sb;
+  awk_symbol **outputs = NULL;
+  awk_rule *r;
+  const awk_action *p;
+  int n = 0, max = 0;
+  int usable = 1;
+
+  if (!memo || !rs)
+  {
+    return 0;
+  }
+
+  memset(&sb,0,sizeof(sb));
+  if (file)
+  {
+    (void)stat(file,&sb);
+  }
+
+  for (r = rs->head; r; r = r->next_rule)
+  {
+    for (p = r->code; p; p = p->next_act)
+    {
+      max++;
+    }
+  }
+  if (max > 0)
+  {
+    outputs = malloc(max*sizeof(awk_symbol *));
+    if (!outputs)
+    {
+      fprintf(stderr,"Couldn't allocate memory in dbfawk_memo_bind()\n");
+      return 0;
+    }
+  }
+
+  for (r = rs->head; r && usable; r = r->next_rule)
+  {
+    if (r->ruletype == BEGIN_REC || r->ruletype == END_REC
+        || r->ruletype == REGEXP)
+    {
+      if (dbfawk_memo_add_output(rs,outputs,&n,max,r->code) < 0)
+      {
+        usable = 0;
+      }
+    }
+  }
+  if (usable
+      && ((rs->begin_rec && dbfawk_memo_refs_subs(rs,rs->begin_rec->code))
+          || (rs->end_rec && dbfawk_memo_refs_subs(rs,rs->end_rec->code))
+          || !dbfawk_memo_pure(rs,outputs,n)))
+  {
+    usable = 0;
+  }
+
+  if ((!memo->file) != (!file)
+      || (file && strcmp(memo->file,file) != 0)
+      || memo->mtime != sb.st_mtime || memo->size != sb.st_size
+      || memo->symtbl != rs->symtbl || memo->noutputs != n
+      || (n > 0 && memcmp(memo->outputs,outputs,n*sizeof(awk_symbol *)) != 0))
+  {
+    /* different or edited program: start over */
+    dbfawk_memo_clear(memo);
+    free(memo->outputs);
+    free(memo->file);
+    memo->lookups = 0;
+    memo->hits = 0;
+    memo->file = file ? strdup(file) : NULL;
+    memo->mtime = sb.st_mtime;
+    memo->size = sb.st_size;
+    memo->symtbl = rs->symtbl;
+    memo->outputs = outputs;
+    memo->noutputs = n;
+    memo->enabled = usable;
+    outputs = NULL;
+  }
+  else if (!usable)
+  {
+    memo->enabled = 0;
+  }
+  free(outputs);
+
+  return memo->enabled;
+}
+
+
+
+
+
+/*
+ * dbfawk_memo_value: where symbol s keeps its value and how many bytes
+ *  of it to save
+ */
+static int dbfawk_memo_value(awk_symbol *s)
+{
+  switch (s->type)
+  {
+    case STRING:
+      if (s->len <= 0)
+      {
+        return 0;
+      }
+      return (s->len < s->size) ? s->len : s->size-1;
+    case INT:
+      return (s->size >= (int)sizeof(int)) ? (int)sizeof(int) : 0;
+    case FLOAT:
+      return (s->size >= (int)sizeof(double)) ? (int)sizeof(double) : 0;
+    default:
+      return 0;
+  }
+}
+
+
+
+
+
+/*
+ * dbfawk_memo_store: remember the current output values for 'key'
+ */
+static void dbfawk_memo_store(dbfawk_memo *memo,
+                              unsigned int hash,
+                              const char *key,
+                              int keylen)
+{
+  dbfawk_memo_entry *e;
+  size_t bytes = sizeof(dbfawk_memo_entry) + keylen;
+  char *dp;
+  int i, n;
+
+  for (i = 0; i < memo->noutputs; i++)
+  {
+    bytes += 2*sizeof(int) + dbfawk_memo_value(memo->outputs[i]);
+  }
+  if (memo->bytes + bytes > DBFAWK_MEMO_BUDGET)
+  {
+    return;
+  }
+  e = malloc(bytes);
+  if (!e)
+  {
+    return;
+  }
+
+  e->hash = hash;
+  e->keylen = keylen;
+  memcpy(e->data,key,keylen);
+  dp = &e->data[keylen];
+  for (i = 0; i < memo->noutputs; i++)
+  {
+    awk_symbol *s = memo->outputs[i];
+
+    n = dbfawk_memo_value(s);
+    memcpy(dp,&s->len,sizeof(int));
+    memcpy(dp+sizeof(int),&n,sizeof(int));
+    dp += 2*sizeof(int);
+    memcpy(dp,s->val,n);
+    dp += n;
+  }
+  e->next = memo->bucket[hash & (DBFAWK_MEMO_BUCKETS-1)];
+  memo->bucket[hash & (DBFAWK_MEMO_BUCKETS-1)] = e;
+  memo->bytes += bytes;
+}
+
+
+
+
+
+/*
+ * dbfawk_memo_replay: put the output values saved in 'e' back
+ */
+static void dbfawk_memo_replay(dbfawk_memo *memo, dbfawk_memo_entry *e)
+{
+  const char *dp = &e->data[e->keylen];
+  int i, n;
+
+  for (i = 0; i < memo->noutputs; i++)
+  {
+    awk_symbol *s = memo->outputs[i];
+
+    memcpy(&s->len,dp,sizeof(int));
+    memcpy(&n,dp+sizeof(int),sizeof(int));
+    dp += 2*sizeof(int);
+    memcpy(s->val,dp,n);
+    if (s->type == STRING)
+    {
+      ((char *)s->val)[n] = '\0';
     }
-    if (awk_exec_program(rs,qbuf,strlen(qbuf)) == 2)
+    dp += n;
+  }
+}
+
+
+
+
+
+/*
+ * dbfawk_memo_parse_record: Same as dbfawk_parse_record(), but look
+ *  the values of the fields up in the memo first.
+ */
+void dbfawk_memo_parse_record(dbfawk_memo *memo,
+                              awk_program *rs,
+                              DBFHandle dbf,
+                              dbfawk_field_info *fi,
+                              int i)
+{
+  dbfawk_field_info *finfo;
+  dbfawk_memo_entry *e;
+  char key[DBFAWK_MEMO_KEY_MAX];
+  char qbuf[1024];
+  unsigned int hash;
+  int keylen = 0, len, k;
+
+  if (!memo || !memo->enabled)
+  {
+    dbfawk_parse_record(rs,dbf,fi,i);
+    return;
+  }
+
+  /* the key is each "NAME=value" the rules will see, '\0' terminated */
+  for (finfo = fi; finfo ; finfo = finfo->next)
+  {
+    len = dbfawk_field_string(rs,dbf,finfo,i,qbuf,sizeof(qbuf));
+    if (len == 0)
+    {
+      continue;
+    }
+    if (keylen + len + 1 > (int)sizeof(key))
+    {
+      dbfawk_parse_record(rs,dbf,fi,i);
+      return;
+    }
+    memcpy(&key[keylen],qbuf,len+1);
+    keylen += len + 1;
+  }
+  hash = fnv1a_hash(FNV1A_INIT,key,keylen);
+
+  memo->lookups++;
+  for (e = memo->bucket[hash & (DBFAWK_MEMO_BUCKETS-1)]; e; e = e->next)
+  {
+    if (e->hash == hash && e->keylen == keylen
+        && memcmp(e->data,key,keylen) == 0)
+    {
+      memo->hits++;
+      dbfawk_memo_replay(memo,e);
+      return;
+    }
+  }
+
+  /* not seen yet: run the program on the key's pieces and save the result */
+  awk_exec_begin_record(rs);
+  for (finfo = fi, k = 0; finfo && k < keylen; finfo = finfo->next)
+  {
+    if (finfo->nrules == 0)
+    {
+      continue;
+    }
+    len = strlen(&key[k]);
+    if (dbfawk_exec_field(rs,finfo,&key[k],len) == 2)
     {
       break;
     }
+    k += len + 1;
   }
-  awk_exec_end_record(rs); /* execute an END_RECORD rule if any */
+  awk_exec_end_record(rs);
+
+  if (memo->lookups == DBFAWK_MEMO_TRIAL && memo->hits < memo->lookups/4)
+  {
+    /* mostly unique records, not worth it */
+    dbfawk_memo_clear(memo);
+    memo->enabled = 0;
+    return;
+  }
+  dbfawk_memo_store(memo,hash,key,keylen);
+}
+
+
+
+
+
+/*
+ * dbfawk_memo_stats: how many records were looked up and found
+ */
+void dbfawk_memo_stats(dbfawk_memo *memo,
+                       unsigned long *lookups,
+                       unsigned long *hits)
+{
+  *lookups = memo ? memo->lookups : 0;
+  *hits = memo ? memo->hits : 0;
 }
 #endif /* HAVE_LIBSHP */
 
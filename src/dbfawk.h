@@ -41,6 +41,9 @@ typedef struct dbfawk_field_info_
   char name[XBASE_FLDHDR_SZ];   /* name of the field */
   int num;                      /* column number */
   DBFFieldType type;            /* data type */
+  awk_program *prog;            /* program "rules" were selected from */
+  awk_rule **rules;             /* the rules that can match this field */
+  int nrules;
 } dbfawk_field_info;
 
 typedef struct dbfawk_sig_info_
@@ -48,8 +51,12 @@ typedef struct dbfawk_sig_info_
   struct dbfawk_sig_info_ *next;
   char *sig;                  /* dbfinfo signature */
   awk_program *prog;          /* the program for this signature */
+  char *file;                 /* the .dbfawk it was loaded from */
 } dbfawk_sig_info;
 
+/* Results of dbfawk_parse_record() remembered by field values */
+typedef struct dbfawk_memo_ dbfawk_memo;
+
 extern int dbfawk_sig(DBFHandle dbf, char *sig, int size);
 extern dbfawk_field_info *dbfawk_field_list(DBFHandle dbf, char *dbffields);
 extern dbfawk_sig_info *dbfawk_load_sigs(const char *dir, const char *ftype);
@@ -63,4 +70,17 @@ extern void dbfawk_parse_record(awk_program *rs,
                                 DBFHandle dbf,
                                 dbfawk_field_info *fi,
                                 int i);
+extern dbfawk_memo *dbfawk_memo_new(void);
+extern void dbfawk_memo_free(dbfawk_memo *memo);
+extern int dbfawk_memo_bind(dbfawk_memo *memo,
+                            awk_program *rs,
+                            const char *file);
+extern void dbfawk_memo_parse_record(dbfawk_memo *memo,
+                                     awk_program *rs,
+                                     DBFHandle dbf,
+                                     dbfawk_field_info *fi,
+                                     int i);
+extern void dbfawk_memo_stats(dbfawk_memo *memo,
+                              unsigned long *lookups,
+                              unsigned long *hits);
 #endif /* !DBFAWK_H*/
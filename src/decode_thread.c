@@ -0,0 +1,288 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 2000-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+
+//
+// Optional packet decode thread.
+//
+// Without it UpdateTime() pops raw lines off the incoming queues and
+// parses them on the main thread.  With it, this thread pops the raw
+// lines instead, cleans up TNC/KISS framing, and splits AX.25 lines
+// into an ax25_packet with predecode_ax25_line(), which also parses
+// positions, weather reports and Mic-E packets.  The results go onto
+// a single-producer/single-consumer queue that UpdateTime() drains
+// with pop_decoded_data(), leaving only the database update
+// (decode_ax25_packet()) on the main thread.
+//
+// Anything that isn't plain AX.25 text (GPS, WX, the HSP and AUX GPS
+// TNC types which need the port's DTR state) is passed through
+// untouched and handled by UpdateTime() as before.
+//
+
+
+#ifdef HAVE_CONFIG_H
+  #include "config.h"
+#endif  // HAVE_CONFIG_H
+
+#include "snprintf.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+#if TIME_WITH_SYS_TIME
+  #include <sys/time.h>
+  #include <time.h>
+#else   // TIME_WITH_SYS_TIME
+  #if HAVE_SYS_TIME_H
+    #include <sys/time.h>
+  #else  // HAVE_SYS_TIME_H
+    #include <time.h>
+  #endif // HAVE_SYS_TIME_H
+#endif  // TIME_WITH_SYS_TIME
+
+#include "xastir.h"
+#include "interface.h"
+#include "db_funcs.h"
+#include "decode_thread.h"
+
+// Must be last include file
+#include "leak_detection.h"
+
+
+
+int enable_decode_thread = 0;   // Set from the config file, used at startup
+
+static int decode_thread_running = 0;
+
+typedef struct _decoded_data_record
+{
+  int length;
+  int port;
+  int predecoded;               // "packet" is valid
+  unsigned char data[MAX_LINE_SIZE+1];
+  ax25_packet packet;
+} decoded_data_record;
+
+#define MAX_DECODED_QUEUE 256   // Must be a power of two
+
+typedef struct _decoded_data_queue
+{
+  unsigned int write_ptr;       // Written by the decode thread only
+  unsigned int read_ptr;        // Written by the main thread only
+  decoded_data_record record[MAX_DECODED_QUEUE];
+} decoded_data_queue;
+
+static decoded_data_queue decoded_queue;
+
+// The main thread's copy of the last packet popped
+static ax25_packet decoded_packet;
+
+
+
+
+
+// Sleep for "usec" microseconds.
+//
+static void decode_thread_sleep(long usec)
+{
+  struct timeval tmv;
+
+  tmv.tv_sec = 0;
+  tmv.tv_usec = usec;
+  (void)select(0,NULL,NULL,NULL,&tmv);
+}
+
+
+
+
+
+// Do the per-device cleanup that UpdateTime() would otherwise do and
+// split AX.25 lines up.  Returns 0 if the record should be dropped.
+//
+static int prepare_decoded_record(decoded_data_record *record)
+{
+  record->predecoded = 0;
+
+  switch (port_data[record->port].device_type)
+  {
+    case DEVICE_SERIAL_KISS_TNC:
+    case DEVICE_SERIAL_MKISS_TNC:
+      // Note that the length of data can increase within
+      // decode_ax25_header().
+      if ( !decode_ax25_header(record->data, &record->length) )
+      {
+        // Had a problem decoding it.  Drop it on the floor.
+        return(0);
+      }
+    /* Falls through. */
+
+    case DEVICE_SERIAL_TNC:
+      tnc_data_clean((char *)record->data);
+    /* Falls through. */
+
+    case DEVICE_NET_STREAM:
+    case DEVICE_AX25_TNC:
+    case DEVICE_NET_AGWPE:
+      predecode_ax25_line((char *)record->data, &record->packet);
+      record->predecoded = 1;
+      break;
+
+    default:
+      break;
+  }
+
+  return(1);
+}
+
+
+
+
+
+static void *decode_thread(void * UNUSED(arg) )
+{
+  decoded_data_record *record;
+  unsigned int write_ptr;
+
+
+  (void)pthread_detach(pthread_self());
+
+  while (1)
+  {
+    write_ptr = decoded_queue.write_ptr;
+
+    // Wait for the main thread if our queue is full.  The incoming
+    // queues absorb the backlog meanwhile.
+    if (write_ptr - QUEUE_LOAD(&decoded_queue.read_ptr) >= MAX_DECODED_QUEUE)
+    {
+      decode_thread_sleep(1000);
+      continue;
+    }
+
+    record = &decoded_queue.record[write_ptr & (MAX_DECODED_QUEUE - 1)];
+
+    record->length = pop_incoming_data(record->data, &record->port);
+    if (record->length == 0)
+    {
+      // Nothing to do.  The port threads don't wake us, so poll.
+      decode_thread_sleep(2000);
+      continue;
+    }
+    record->data[record->length] = '\0';
+
+    if (!prepare_decoded_record(record))
+    {
+      continue;
+    }
+
+    // Publish the record to the main thread
+    QUEUE_STORE(&decoded_queue.write_ptr, write_ptr + 1);
+  }
+
+  return(NULL);
+}
+
+
+
+
+
+// Start the decode thread.  From then on it's the only consumer of
+// the incoming queues, so call this before the interfaces start and
+// get packets only through pop_decoded_data().
+//
+void start_decode_thread(void)
+{
+  pthread_t thread;
+
+
+  if (decode_thread_running)
+  {
+    return;
+  }
+
+  if (pthread_create(&thread, NULL, decode_thread, NULL))
+  {
+    fprintf(stderr,"Error creating decode thread, decoding on main thread\n");
+    return;
+  }
+
+  decode_thread_running = 1;
+}
+
+
+
+
+
+// Fetch the next record, from the decode thread if it is running or
+// straight from the incoming queues if not.  Returns 0 if there's
+// nothing available, else the length of data_string (which should be
+// of size MAX_LINE_SIZE) and the port.  *packet is set to the split
+// AX.25 line to hand to decode_ax25_packet() if the decode thread did
+// that already, else NULL.  It stays valid until the next call.
+//
+int pop_decoded_data(unsigned char *data_string, int *port, ax25_packet **packet)
+{
+  decoded_data_record *record;
+  unsigned int read_ptr;
+  int length;
+
+
+  *packet = NULL;
+
+  if (!decode_thread_running)
+  {
+    return(pop_incoming_data(data_string, port));
+  }
+
+  // Only we write read_ptr, so no need for an atomic load of it
+  read_ptr = decoded_queue.read_ptr;
+
+  if (read_ptr == QUEUE_LOAD(&decoded_queue.write_ptr))
+  {
+    return(0);  // Queue empty
+  }
+
+  record = &decoded_queue.record[read_ptr & (MAX_DECODED_QUEUE - 1)];
+
+  *port = record->port;
+  length = record->length;
+  if (length > MAX_LINE_SIZE - 1)
+  {
+    length = MAX_LINE_SIZE - 1;
+  }
+
+  // May have embedded zeros, e.g. WX station data
+  memcpy(data_string, record->data, length);
+  data_string[length] = '\0';
+
+  if (record->predecoded)
+  {
+    memcpy(&decoded_packet, &record->packet, sizeof(decoded_packet));
+    *packet = &decoded_packet;
+  }
+
+  // Hand the slot back to the decode thread
+  QUEUE_STORE(&decoded_queue.read_ptr, read_ptr + 1);
+
+  return(length);
+}
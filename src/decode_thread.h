@@ -0,0 +1,33 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 2000-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+
+#ifndef XASTIR_DECODE_THREAD_H
+#define XASTIR_DECODE_THREAD_H
+
+#include "database.h"
+
+extern int enable_decode_thread;
+
+extern void start_decode_thread(void);
+extern int pop_decoded_data(unsigned char *data_string, int *port, ax25_packet **packet);
+
+#endif /* XASTIR_DECODE_THREAD_H */
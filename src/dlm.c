@@ -72,6 +72,13 @@
    but we will always start downloading tiles in the current view (ie most
    recently added) first - without cancelling any tiles already started.
 
+   Tiles queued with DLM_queue_prefetch_tile() are ones we guess will be
+   wanted soon.  They are only started when no other item is waiting, and
+   no more than DLM_PREFETCH_TRANSFERS of them at a time, so they never hold
+   up the current view.  They don't trigger a redraw when they arrive, and
+   DLM_queue_abort_prefetch() drops those not started yet.  Queueing a
+   prefetch tile again with DLM_queue_tile() makes it an ordinary one.
+
 
    Mini HowTo:
 
@@ -107,6 +114,9 @@
 // when the user scrolls around a bit
 #define USE_CURL_MULTI 8
 
+// Most prefetch transfers running at once
+#define DLM_PREFETCH_TRANSFERS 2
+
 
 #define DLM_Q_STOP    0
 #define DLM_Q_STARTING    1
@@ -128,6 +138,7 @@ struct DLM_queue_entry
   unsigned long      y;
   int              osm_zl;
 
+  int              prefetch;    // Low priority, see DLM_queue_prefetch_tile()
   int              state;
   xastir_mutex      lock;
   char          fileName[MAX_FILENAME];
@@ -397,6 +408,25 @@ void DLM_queue_abort_files(void)
   }
 }
 
+/**********************************************************
+ * DLM_queue_abort_prefetch() - free all prefetch tiles not started yet
+ **********************************************************/
+void DLM_queue_abort_prefetch(void)
+{
+  struct DLM_queue_entry *next, *q;
+
+  q = DLM_queue;
+  while (q)
+  {
+    next=q->next;
+    if ((q->state==DLM_Q_IDLE) && q->prefetch)
+    {
+      DLM_queue_entry_free(q);
+    }
+    q=next;
+  }
+}
+
 /**********************************************************
  * DLM_store_file() - move the temp file into place if we used one
  **********************************************************/
@@ -424,17 +454,36 @@ static int DLM_store_file(struct DLM_queue_entry *q)
 
 /**********************************************************
  * DLM_get_next_tile() - find the next idle tile ready for download
- * also locks that tile
+ * also locks that tile.  Prefetch tiles are only returned if no
+ * other tile is waiting and fewer than DLM_PREFETCH_TRANSFERS of
+ * them are running.
  **********************************************************/
 static struct DLM_queue_entry *DLM_get_next_tile(int state)
 {
-  struct DLM_queue_entry *q;
+  struct DLM_queue_entry *q, *prefetch = NULL;
+  int prefetch_running = 0;
+
   begin_critical_section(&DLM_queue_lock, "DLM_transfer_thread: queue lock");
   q = DLM_queue;
-  while (q && (q->state!=state))
+  while (q && ((q->state!=state) || q->prefetch))
   {
+    if (q->prefetch)
+    {
+      if (q->state == DLM_Q_RUN)
+      {
+        prefetch_running++;
+      }
+      else if (q->state == state && !prefetch)
+      {
+        prefetch = q;
+      }
+    }
     q=q->next;
   }
+  if (!q && prefetch_running < DLM_PREFETCH_TRANSFERS)
+  {
+    q = prefetch;
+  }
   if (q)
   {
     begin_critical_section(&(q->lock), "DLM_transfer_thread: tile lock");
@@ -648,7 +697,7 @@ static void *DLM_transfer_thread(void * UNUSED(arg) )
 
           if ((msg->data.result==0) && (!DLM_store_file(t)))
           {
-            DLM_queue_progress(1);
+            DLM_queue_progress(!t->prefetch);
           }
           else
           {
@@ -729,7 +778,7 @@ static void *DLM_transfer_thread(void * UNUSED(arg) )
         {
           if (!DLM_store_file(tile))
           {
-            DLM_queue_progress(1);
+            DLM_queue_progress(!tile->prefetch);
           }
         }
 #endif // USE_CURL_MULTI
@@ -752,7 +801,7 @@ static void *DLM_transfer_thread(void * UNUSED(arg) )
           {
             if (!DLM_store_file(tile))
             {
-              DLM_queue_progress(1);
+              DLM_queue_progress(!tile->prefetch);
             }
           }
         }
@@ -893,16 +942,17 @@ static void DLM_queue_add(struct DLM_queue_entry *ent)
 
 
 /**********************************************************
- * DLM_queue_tile() - queue map tiles for download
- * Written for OpenStreetMap but generic enough to live here.
+ * DLM_queue_tile_entry() - queue a map tile for download,
+ * as a prefetch tile or not
  **********************************************************/
-void DLM_queue_tile(
+static void DLM_queue_tile_entry(
   char          *serverURL,
   unsigned long      x,
   unsigned long      y,
   int              osm_zl,
   char          *baseDir,
-  char          *ext )
+  char          *ext,
+  int              prefetch )
 {
 
   struct DLM_queue_entry *tile, *q;
@@ -916,6 +966,11 @@ void DLM_queue_tile(
   {
     q=q->next;
   }
+  if (q && !prefetch)
+  {
+    // Wanted now after all
+    q->prefetch = 0;
+  }
   end_critical_section(&DLM_queue_lock, "DLM_queue_tile:check queue");
   if (q)
   {
@@ -937,6 +992,7 @@ void DLM_queue_tile(
   tile->x         = x;
   tile->y         = y;
   tile->osm_zl    = osm_zl;
+  tile->prefetch  = prefetch;
   tile->state     = DLM_Q_IDLE;
 
   tile->url       = NULL;
@@ -989,6 +1045,41 @@ void DLM_queue_tile(
 }
 
 
+/**********************************************************
+ * DLM_queue_tile() - queue map tiles for download
+ * Written for OpenStreetMap but generic enough to live here.
+ **********************************************************/
+void DLM_queue_tile(
+  char          *serverURL,
+  unsigned long      x,
+  unsigned long      y,
+  int              osm_zl,
+  char          *baseDir,
+  char          *ext )
+{
+  DLM_queue_tile_entry(serverURL, x, y, osm_zl, baseDir, ext, 0);
+}
+
+
+/**********************************************************
+ * DLM_queue_prefetch_tile() - queue a map tile that isn't
+ * needed yet, at low priority.  Does nothing unless the
+ * downloads run in the background.
+ **********************************************************/
+void DLM_queue_prefetch_tile(
+  char          *serverURL,
+  unsigned long      x,
+  unsigned long      y,
+  int              osm_zl,
+  char          *baseDir,
+  char          *ext )
+{
+#ifdef DLM_QUEUE_THREADED
+  DLM_queue_tile_entry(serverURL, x, y, osm_zl, baseDir, ext, 1);
+#endif
+}
+
+
 
 /**********************************************************
  * DLM_queue_file() - Queue a file for download.
@@ -1031,6 +1122,7 @@ void DLM_queue_file(
   tile->x         = 0;
   tile->y         = 0;
   tile->osm_zl    = -1;
+  tile->prefetch  = 0;
   tile->state     = DLM_Q_IDLE;
 
   tile->url       = strdup(url);
@@ -31,6 +31,7 @@ int DLM_queue_len(void);
 void DLM_queue_abort(void);
 void DLM_queue_abort_tiles(void);
 void DLM_queue_abort_files(void);
+void DLM_queue_abort_prefetch(void);
 void DLM_do_transfers(void);
 
 void DLM_queue_tile(
@@ -42,6 +43,15 @@ void DLM_queue_tile(
   char            *ext
 );
 
+void DLM_queue_prefetch_tile(
+  char            *serverURL,
+  unsigned long   x,
+  unsigned long   y,
+  int             osm_zl,
+  char            *baseDir,
+  char            *ext
+);
+
 void DLM_queue_file(
   char      *url,
   char      *filename,
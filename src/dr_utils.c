@@ -213,10 +213,14 @@ void compute_current_DR_position(DataRow *p_station, long *x_long, long *y_lat)
   int ret;
   unsigned long x_u_long, y_u_lat;
   time_t secs_now;
+  TrackRow prev_point;
+  int have_prev_point;
 
 
   secs_now=sec_now();
 
+  have_prev_point = trail_store_previous(p_station->trail, &prev_point);
+
 
   // Check whether we have course in the current data
   //
@@ -227,20 +231,19 @@ void compute_current_DR_position(DataRow *p_station, long *x_long, long *y_lat)
   }
   //
   // Else check whether the previous position had a course.  Note
-  // that newest_trackpoint if it exists should be the same as the
+  // that the newest trackpoint if it exists should be the same as the
   // current data, so we have to go back one further trackpoint.
   // Make sure in this case that this trackpoint has occurred
   // within the dead-reckoning timeout period though, else ignore
   // it.
   //
-  else if ( (p_station->newest_trackpoint != NULL)
-            && (p_station->newest_trackpoint->prev != NULL)
-            && (p_station->newest_trackpoint->prev->course != -1)   // Undefined
-            && ( (secs_now-p_station->newest_trackpoint->prev->sec) < dead_reckoning_timeout) )
+  else if ( have_prev_point
+            && (prev_point.course != -1)   // Undefined
+            && ( (secs_now-prev_point.sec) < dead_reckoning_timeout) )
   {
 
     // In ° true
-    my_course = p_station->newest_trackpoint->prev->course;
+    my_course = prev_point.course;
   }
 
 
@@ -255,18 +258,17 @@ void compute_current_DR_position(DataRow *p_station, long *x_long, long *y_lat)
   }
   //
   // Else check whether the previous position had speed.  Note
-  // that newest_trackpoint if it exists should be the same as the
+  // that the newest trackpoint if it exists should be the same as the
   // current data, so we have to go back one further trackpoint.
   //
-  else if ( (p_station->newest_trackpoint != NULL)
-            && (p_station->newest_trackpoint->prev != NULL)
-            && (p_station->newest_trackpoint->prev->speed != -1) // Undefined
-            && ( (secs_now-p_station->newest_trackpoint->prev->sec) < dead_reckoning_timeout) )
+  else if ( have_prev_point
+            && (prev_point.speed != -1) // Undefined
+            && ( (secs_now-prev_point.sec) < dead_reckoning_timeout) )
   {
 
     // Speed is in units of 0.1km/hour.  Different than above!
     range = (double)( (sec_now() - p_station->sec_heard)
-                      * ( p_station->newest_trackpoint->prev->speed / 10 * 0.5399568 / 3600.0 ) );
+                      * ( prev_point.speed / 10 * 0.5399568 / 3600.0 ) );
   }
 
 
@@ -324,7 +324,7 @@ void draw_WP_line(DataRow *p_station,
   // station.  Do a lookup on that callsign through our database
   // to get the position of that station.
 
-  if (!search_station_name(&transmitting_station,p_station->origin,1))
+  if (!search_station_name(&transmitting_station,OBJECT_DATA(p_station)->origin,1))
   {
     // Can't find call,
     return;
@@ -4033,7 +4033,7 @@ void draw_deadreckoning_features(DataRow *p_station,
                 where,
                 symbol_orient(p_station->course),
                 p_station->aprs_symbol.area_object.type,
-                p_station->signpost,
+                OBJECT_DATA(p_station)->signpost,
                 NULL,
                 0);  // Don't bump the station count
   }
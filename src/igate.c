@@ -47,6 +47,7 @@
 #include "xa_config.h"
 #include "util.h"
 #include "log_utils.h"
+#include "igate_utils.h"
 
 // Must be last include file
 #include "leak_detection.h"
@@ -64,31 +65,18 @@ int check_NWS_stations(char *call);
 
 
 
-// Struct for holding packet data.  We use dynamically-allocated
-// singly-linked lists.  The last record should have its "next"
-// pointer set to NULL.
+// Sent and Heard dupe sets.  These are used for the dupe-checking we
+// do in the below routines.  We have one Sent and one Heard set for
+// each interface device, holding digests of the packets seen in the
+// last DUPE_WINDOW seconds.  We really only need these for each TNC
+// interface, but the user might destroy a NET interface and create a
+// TNC interface during a single runtime, so we keep them for all
+// ports.  If people switch types, the old entries expire within
+// DUPE_WINDOW seconds, so we don't have to worry about cleaning them
+// out in this case.
 //
-typedef struct _DupeRecord
-{
-  char    data[MAX_LINE_SIZE+15]; // Packet data
-  time_t  time;                       // The time the record was inserted
-  struct  _DupeRecord *next;          // pointer to next record in list
-} DupeRecord;
-
-
-
-// Sent and Heard queue pointers.  These are used for the dupe-checking
-// we do in the below routines.  We have one Sent and one Heard queue
-// for each interface device.  These pointers will point to the head of
-// each queue.  We really only need these queues for each TNC interface,
-// but the user might destroy a NET interface and create a TNC interface
-// during a single runtime, so we need to populate all of the pointers
-// just in case.  If people switch types, the old queue will empty out
-// (effectively anyway) within XX seconds, so we don't have to worry
-// about cleaning out the queues in this case.
-//
-DupeRecord *heard_queue[MAX_IFACE_DEVICES];
-DupeRecord  *sent_queue[MAX_IFACE_DEVICES];
+static dupe_set heard_queue[MAX_IFACE_DEVICES];
+static dupe_set  sent_queue[MAX_IFACE_DEVICES];
 
 
 
@@ -106,8 +94,8 @@ DupeRecord  *sent_queue[MAX_IFACE_DEVICES];
 
 
 
-// Initialization routine for this module which sets up the queue
-// pointers when Xastir first starts.  Called from main.c:main()
+// Initialization routine for this module which sets up the dupe
+// sets when Xastir first starts.  Called from main.c:main()
 //
 void igate_init(void)
 {
@@ -115,8 +103,28 @@ void igate_init(void)
 
   for (i = 0; i < MAX_IFACE_DEVICES; i++)
   {
-    heard_queue[i] = NULL;
-    sent_queue[i] = NULL;
+    memset(&heard_queue[i], 0, sizeof(dupe_set));
+    memset(&sent_queue[i], 0, sizeof(dupe_set));
+  }
+}
+
+
+
+
+
+// Total dupe check hits (dupes found) and misses over all of the
+// Heard and Sent sets.
+//
+void get_igate_dupe_stats(unsigned long *hits, unsigned long *misses)
+{
+  int i;
+
+  *hits = 0;
+  *misses = 0;
+  for (i = 0; i < MAX_IFACE_DEVICES; i++)
+  {
+    *hits += heard_queue[i].hits + sent_queue[i].hits;
+    *misses += heard_queue[i].misses + sent_queue[i].misses;
   }
 }
 
@@ -130,29 +138,18 @@ void igate_init(void)
 // Returns: 1 if it's _not_ a duplicate record or we have an error
 //          0 if it _is_ a duplicate record
 //
-// Since we need to run through every record checking for dupes anyway,
-// we check the timestamp on each one as we go through.  If too old, we
-// delete it from the head of the chain.  We add new records to the end.
-// This makes it easy to keep it as a singly-linked list, and only have
-// to deal with one record at a time.
-//
-// The way this is set up we keep a thirty second queue for each
-// interface.  Any records older than this are at the head of the chain
-// and are deleted one by one whenever this routine is called again due
-// to a new packet coming through.  It's ok if these records sit around
-// on the queue for a long time due to no igate activity.  It doesn't
-// take long to delete them!
+// Packets are compared by the digest of their source, destination
+// and info field (see dupe_digest()), so the same packet heard via
+// different paths is a dupe.  Each lookup is a hash probe, and
+// records older than DUPE_WINDOW seconds are ignored and reused as
+// we go, so the cost doesn't depend on how busy the interface is.
 //
 int not_a_dupe(int queue_type, int port, char *line, int insert_mode)
 {
-  DupeRecord *ptr;
-  DupeRecord *ptr_last;
+  dupe_set *set;
   int insert_new;
-  time_t time_cutoff;
-  int found_dupe = 0;
-  char match_line[MAX_LINE_SIZE*2];
-  char line2[MAX_LINE_SIZE+1];
-  char *c0, *c1, *c2;
+  char *c0;
+  char *line2;
 
 
   if ( (line == NULL) || (line[0] == '\0') )
@@ -161,21 +158,11 @@ int not_a_dupe(int queue_type, int port, char *line, int insert_mode)
   }
 
 
-  // Figure out what's "old"
-  time_cutoff = sec_now() - (time_t)29;   // 29 seconds ago
-
-
-  // Fill the destination string with zeroes.  This is a nice
-  // segfault-prevention technique.  Whatever strings we throw in here
-  // will be automatically terminated.
-  memset(match_line, 0, MAX_LINE_SIZE*2);
-
-
   switch (queue_type)
   {
 
     case HEARD:
-      ptr_last = ptr = heard_queue[port]; // May be NULL!
+      set = &heard_queue[port];
 
       // The insert_into_heard_queue() function below (called by
       // db.c decode routines in turn) will call this function
@@ -200,14 +187,10 @@ int not_a_dupe(int queue_type, int port, char *line, int insert_mode)
       // so that we can try to find duplicates before transmitting
       // them again.
 
-// NOTE:  Below is the parsing code for an internet packet for the Sent
-// queue.  Modify it to parse 3rd party packets for the Heard queue.
-
 // VE7VFM-12>APD214,VE7VAN-3*,WIDE3*:}WA7JAK>APK002,TCPIP*,VE7VFM-12*::N7WGR-7  :does{2
 
-      // Changes needed before parsing code:  Get rid of first
-      // part of packet up to the '}' symbol.  After this the
-      // generic parsing code will work.
+      // Get rid of first part of packet up to the '}' symbol.
+      // After this it looks like a Sent queue packet.
 // Note that the REPLY-ACK algorithm also uses the '}' symbol.
 
       c0 = strstr(line, ":}"); // Find start of 3rd party packet
@@ -220,34 +203,26 @@ int not_a_dupe(int queue_type, int port, char *line, int insert_mode)
         return(1);
       }
 
-      // Copy original packet into line2 for later parsing.  We
-      // want to keep the '}' character because our own
+      // We want to keep the '}' character because our own
       // transmissions out RF have that character as well.
-// Note that the REPLY-ACK algorithm also uses the '}' symbol.
       if (debug_level & 1024)
       {
         fprintf(stderr,"3rd party HeardQ: %s\n",line);
       }
 
-      xastir_snprintf(line2,
-                      sizeof(line2),
-                      "%s",
-                      c0+1);
+      line2 = c0+1;
 
       break;
 
     case SENT:
       // For this queue we always want to insert records.  Only
       // igate.c functions call this.
-      ptr_last = ptr = sent_queue[port];  // May be NULL!
+      set = &sent_queue[port];
       insert_new = 1; // Insert new records
 
-      // No extra changes needed before parsing code, Example:
+      // No extra changes needed, Example:
       // }VE7VFM-11>APW251,TCPIP,WE7U-14*::VE7VFM-9 :OK GOT EMAIL OK{058
-      xastir_snprintf(line2,
-                      sizeof(line2),
-                      "%s",
-                      line);
+      line2 = line;
 
       if (debug_level & 1024)
       {
@@ -264,120 +239,7 @@ int not_a_dupe(int queue_type, int port, char *line, int insert_mode)
   }
 
 
-  // Create the string we're going to compare against and that we
-  // might store in the queue.  Knock off the path info and just check
-  // source/destination/info portions of the packet for a match.
-
-  c1 = strstr(line2, ","); // Find comma after destination
-  c2 = strstr(line2, ":"); // Find end of path
-
-  if ( (c1 != NULL) && (c2 != NULL) )             // Found both separators
-  {
-
-    // Copy source/destination portion
-    xastir_snprintf(match_line,
-                    sizeof(match_line),
-                    "%s",
-                    line2);
-    match_line[(int)(c1-line2)] = '\0';         // Terminate the substring
-
-    strncat(match_line,                         // Copy info portion
-            c2+1,
-            sizeof(match_line) - 1 - strlen(match_line));
-  }
-  else    // At least one separator was not found, copy entire string
-  {
-    xastir_snprintf(match_line,
-                    sizeof(match_line),
-                    "%s",
-                    line2);
-  }
-
-
-  // Run through the selected queue from beginning to end.  If the
-  // pointer is NULL, the queue is empty and we're already done.
-  while (ptr != NULL && !found_dupe)
-  {
-
-    // Check the timestamp to determine whether to delete this
-    // record
-    if (ptr->time < time_cutoff)    // Old record, delete it
-    {
-      DupeRecord *temp;
-
-      if (debug_level & 1024)
-      {
-        switch (queue_type)
-        {
-          case HEARD:
-            fprintf(stderr,"HEARD Deleting record: %s\n",ptr->data);
-            break;
-          case SENT:
-            fprintf(stderr," SENT Deleting record: %s\n",ptr->data);
-            break;
-          default:
-            break;
-        }
-      }
-
-      // Delete record and free up the space
-      temp = ptr;
-      ptr = ptr->next;    // May be NULL!
-      free(temp);
-
-      // Point master queue pointer to new head of queue.
-      // Make sure to carry along ptr_last as well, as this is
-      // our possible insertion point later.
-      switch (queue_type)
-      {
-        case HEARD:
-          heard_queue[port] = ptr_last = ptr; // May be NULL!
-          break;
-        case SENT:
-          sent_queue[port] = ptr_last = ptr;  // May be NULL!
-        default:
-          break;
-      }
-    }
-
-    else    // Record is current.  Check for a match.
-    {
-
-      //fprintf(stderr,"\n\t\t%s\n\t\t%s\n",ptr->data,match_line);
-
-      if (strcmp(ptr->data,match_line) == 0)
-      {
-        // We found a dupe!  We're done with the loop.
-        found_dupe++;
-
-        if (debug_level & 1024)
-        {
-          switch (queue_type)
-          {
-            case HEARD:
-              fprintf(stderr,"HEARD*     Found dupe: %s\n",match_line);
-              break;
-            case SENT:
-              fprintf(stderr,"SENT*      Found dupe: %s\n",match_line);
-            default:
-              break;
-          }
-        }
-      }
-      else    // Not a dupe, skip to the next record in the
-      {
-        // queue.  Keep a pointer to the last record
-        // compared so that we have a possible insertion
-        // point later.  Once we hit the end (NULL), we
-        // can't back up one.
-        ptr_last = ptr;     // Save pointer to last record
-        ptr = ptr->next;    // Advance one.  May be NULL!
-      }
-    }
-  }   // End of while loop
-
-
-  if (found_dupe)
+  if (dupe_set_check(set, dupe_digest(line2), sec_now(), insert_new))
   {
 
     if (debug_level & 1024)
@@ -391,11 +253,11 @@ int not_a_dupe(int queue_type, int port, char *line, int insert_mode)
         case DEVICE_SERIAL_KISS_TNC:
         case DEVICE_SERIAL_MKISS_TNC:
         case DEVICE_NET_AGWPE:
-          fprintf(stderr,"        Found RF dupe: %s\n",match_line);
+          fprintf(stderr,"        Found RF dupe: %s\n",line2);
           break;
 
         default:
-          fprintf(stderr,"       Found NET dupe: %s\n",match_line);
+          fprintf(stderr,"       Found NET dupe: %s\n",line2);
           break;
       }
     }
@@ -403,71 +265,21 @@ int not_a_dupe(int queue_type, int port, char *line, int insert_mode)
     return(0);  // Found a dupe, return
   }
 
-  else
+  if (insert_new && (debug_level & 1024))
   {
-
-    // If insert_new == 1, insert each non-dupe record into the
-    // queue and give it a timestamp.  ptr_next is currently
-    // either NULL or points to the last record in the chain.
-    if (insert_new)
+    switch (queue_type)
     {
-      DupeRecord *temp;
-
-      if (debug_level & 1024)
-      {
-        switch (queue_type)
-        {
-          case HEARD:
-            fprintf(stderr,"HEARD   Adding record: %s\n",match_line);
-            break;
-          case SENT:
-            fprintf(stderr," SENT   Adding record: %s\n",match_line);
-            break;
-          default:
-            break;
-        }
-      }
-
-      // Allocate a new storage space for the record and fill
-      // it in.
-      temp = (DupeRecord *)malloc(sizeof(DupeRecord));
-
-      if (!temp)
-      {
-        fprintf(stderr,"Couldn't allocate memory in not_a_dupe()\n");
-        return(1);  // Send back "not a dupe"
-      }
-
-      temp->time = (time_t)sec_now();
-
-      memcpy(temp->data, match_line, sizeof(temp->data));
-      temp->data[sizeof(temp->data)-1] = '\0';  // Terminate string
-
-      temp->next = NULL;  // Will be the end of the linked list
-
-      if (ptr_last == NULL)   // Queue is currently empty
-      {
-
-        // Add record to empty list.  Point master queue pointer
-        // to new head of queue.
-        switch (queue_type)
-        {
-          case HEARD:
-            heard_queue[port] = temp;
-            break;
-          case SENT:
-            sent_queue[port] = temp;
-          default:
-            break;
-        }
-      }
-      else    // Queue is not empty, add the record to the end of
-      {
-        // the list.
-        ptr_last->next = temp;
-      }
+      case HEARD:
+        fprintf(stderr,"HEARD   Adding record: %s\n",line2);
+        break;
+      case SENT:
+        fprintf(stderr," SENT   Adding record: %s\n",line2);
+        break;
+      default:
+        break;
     }
   }
+
   return(1);  // Nope, not a dupe
 }
 
@@ -32,6 +32,7 @@ typedef struct
 
 extern void igate_init(void);
 extern void insert_into_heard_queue(int port, char *line);
+extern void get_igate_dupe_stats(unsigned long *hits, unsigned long *misses);
 extern void output_igate_net(char *line, int port, int third_party);
 extern void output_igate_rf(char *from, char *call, char *path, char *line, int port, int third_party, char *object_name);
 extern void output_nws_igate_rf(char *from, char *path, char *line, int port, int third_party);
@@ -0,0 +1,233 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 1999,2000  Frank Giannandrea
+ * Copyright (C) 2000-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+#ifdef HAVE_CONFIG_H
+  #include "config.h"
+#endif  // HAVE_CONFIG_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "igate_utils.h"
+
+// Must be last include file
+#include "leak_detection.h"
+
+
+
+#define DUPE_SET_MIN_SIZE 64
+
+
+
+
+
+static void dupe_digest_add(uint64_t *hash, const char *start, const char *end)
+{
+  while (start < end)
+  {
+    *hash ^= (unsigned char)*start++;
+    *hash *= 1099511628211ULL;
+  }
+}
+
+
+
+
+
+// Digest of the parts of a packet that identify it for dupe checking:
+// source and destination (everything up to the first comma) plus the
+// info field (everything after the first colon).  The digipeater path
+// is left out, as the same packet arrives via different paths.  If
+// either separator is missing the whole line is used.  FNV-1a, 64
+// bits, never returns 0.
+//
+uint64_t dupe_digest(char *line)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  char *c1, *c2;
+
+
+  c1 = strchr(line, ',');     // Comma after destination
+  c2 = strchr(line, ':');     // End of path
+
+  if (c1 != NULL && c2 != NULL)
+  {
+    dupe_digest_add(&hash, line, c1);
+    dupe_digest_add(&hash, c2 + 1, c2 + 1 + strlen(c2 + 1));
+  }
+  else
+  {
+    dupe_digest_add(&hash, line, line + strlen(line));
+  }
+
+  return(hash ? hash : 1);
+}
+
+
+
+
+
+// Build a new table holding only the entries newer than "cutoff".
+// Sized for four times as many entries as that so we don't rebuild
+// again right away.  Returns 0 if we couldn't get the memory, in
+// which case the old table is left alone.
+//
+static int dupe_set_rebuild(dupe_set *set, time_t cutoff)
+{
+  dupe_entry *new_table;
+  unsigned int new_size = DUPE_SET_MIN_SIZE;
+  unsigned int live = 0;
+  unsigned int ii, slot;
+
+
+  for (ii = 0; ii < set->size; ii++)
+  {
+    if (set->table[ii].digest != 0 && set->table[ii].time >= cutoff)
+    {
+      live++;
+    }
+  }
+
+  while (new_size < live * 4)
+  {
+    new_size *= 2;
+  }
+
+  new_table = (dupe_entry *)calloc(new_size, sizeof(dupe_entry));
+  if (new_table == NULL)
+  {
+    return(0);
+  }
+
+  for (ii = 0; ii < set->size; ii++)
+  {
+    if (set->table[ii].digest != 0 && set->table[ii].time >= cutoff)
+    {
+      slot = (unsigned int)set->table[ii].digest & (new_size - 1);
+      while (new_table[slot].digest != 0)
+      {
+        slot = (slot + 1) & (new_size - 1);
+      }
+      new_table[slot] = set->table[ii];
+    }
+  }
+
+  free(set->table);
+  set->table = new_table;
+  set->size = new_size;
+  set->used = live;
+  return(1);
+}
+
+
+
+
+
+// Check whether "digest" was inserted within the last DUPE_WINDOW
+// seconds.  Returns 1 if so (a dupe), else 0, in which case the
+// digest is inserted if "insert" is set.
+//
+int dupe_set_check(dupe_set *set, uint64_t digest, time_t now, int insert)
+{
+  time_t cutoff = now - (time_t)DUPE_WINDOW;
+  unsigned int slot;
+  int reuse = -1;
+
+
+  if (set->size == 0)
+  {
+    set->misses++;
+    if (!insert || !dupe_set_rebuild(set, cutoff))
+    {
+      return(0);
+    }
+  }
+  else
+  {
+    slot = (unsigned int)digest & (set->size - 1);
+    while (set->table[slot].digest != 0)
+    {
+      if (set->table[slot].time < cutoff)
+      {
+        // Expired.  Keep looking, it may sit in front of a live
+        // copy, but remember the slot in case we need one.
+        if (reuse < 0)
+        {
+          reuse = (int)slot;
+        }
+      }
+      else if (set->table[slot].digest == digest)
+      {
+        set->hits++;
+        return(1);
+      }
+      slot = (slot + 1) & (set->size - 1);
+    }
+    set->misses++;
+
+    if (!insert)
+    {
+      return(0);
+    }
+
+    if (reuse >= 0)
+    {
+      set->table[reuse].digest = digest;
+      set->table[reuse].time = now;
+      return(0);
+    }
+  }
+
+  // Keep at least half of the slots empty so probe runs stay short,
+  // dropping the expired entries when we rebuild.
+  if ((set->used + 1) * 2 > set->size && !dupe_set_rebuild(set, cutoff))
+  {
+    return(0);  // Out of memory.  Can't remember it, but not a dupe.
+  }
+
+  slot = (unsigned int)digest & (set->size - 1);
+  while (set->table[slot].digest != 0)
+  {
+    slot = (slot + 1) & (set->size - 1);
+  }
+  set->table[slot].digest = digest;
+  set->table[slot].time = now;
+  set->used++;
+
+  return(0);
+}
+
+
+
+
+
+// Free the table.  The counters are kept.
+//
+void dupe_set_clear(dupe_set *set)
+{
+  free(set->table);
+  set->table = NULL;
+  set->size = 0;
+  set->used = 0;
+}
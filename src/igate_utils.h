@@ -0,0 +1,54 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 1999,2000  Frank Giannandrea
+ * Copyright (C) 2000-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+#ifndef __XASTIR_IGATE_UTILS_H
+#define __XASTIR_IGATE_UTILS_H
+
+#include <stdint.h>
+#include <time.h>
+
+// Packets seen within this many seconds of each other are dupes
+#define DUPE_WINDOW 29
+
+typedef struct
+{
+  uint64_t digest;            // dupe_digest() of the packet, 0 = empty slot
+  time_t time;                // When it was inserted
+} dupe_entry;
+
+// Set of recently seen packet digests, one per igate queue.  Open
+// addressing with linear probing.  Expired entries are reused or
+// dropped when the table is rebuilt, so no list walk is needed.
+typedef struct
+{
+  dupe_entry *table;
+  unsigned int size;          // Slots, power of two.  0 until first insert.
+  unsigned int used;          // Filled slots, live or expired
+  unsigned long hits;         // Lookups that found a dupe
+  unsigned long misses;       // Lookups that didn't
+} dupe_set;
+
+extern uint64_t dupe_digest(char *line);
+extern int dupe_set_check(dupe_set *set, uint64_t digest, time_t now, int insert);
+extern void dupe_set_clear(dupe_set *set);
+
+#endif
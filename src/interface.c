@@ -120,7 +120,7 @@ iface port_data[MAX_IFACE_DEVICES];     // shared port data
 int port_id[MAX_IFACE_DEVICES];         // shared port id data
 
 xastir_mutex port_data_lock;            // Protects the port_data[] array of structs
-xastir_mutex data_lock;                 // Protects incoming_data_queue
+xastir_mutex data_lock;                 // Protects incoming_queue[] pointers if no atomic builtins
 xastir_mutex output_data_lock;          // Protects interface.c:channel_data() function only
 xastir_mutex connect_lock;              // Protects port_data[].thread_status and port_data[].connect_status
 
@@ -130,30 +130,74 @@ int ax25_ports_loaded = 0;
 
 
 // Incoming data queue
+//
+// Each port has its own circular queue.  A port's read thread is the
+// only thread that pushes onto that port's queue, and UpdateTime() in
+// the main thread (or the decode thread in decode_thread.c, if that's
+// running) is the only one that pops from any of them, so each
+// queue is single-producer/single-consumer and can be run without a
+// lock:  The producer owns write_ptr, the consumer owns read_ptr, and
+// each side publishes its pointer with a release store only after
+// it's done with the slot.  Port threads therefore never contend with
+// each other or with the UI thread on a mutex for every packet.
+//
+// If the compiler doesn't have the __atomic builtins we fall back to
+// protecting the pointers with data_lock.
+//
 typedef struct _incoming_data_record
 {
   int length;   // Used for binary strings such as KISS
   int port;
   unsigned char data[MAX_LINE_SIZE];
 } incoming_data_record;
-#define MAX_INPUT_QUEUE 1000
-static incoming_data_record incoming_data_queue[MAX_INPUT_QUEUE];
+
+#define MAX_INPUT_QUEUE 512     // Records per port, must be a power of two
+
+typedef struct _incoming_port_queue
+{
+  unsigned int write_ptr;       // Next slot to fill, written by producer only
+  unsigned int read_ptr;        // Next slot to empty, written by consumer only
+
+  // Statistics.  Written by the producer only, so the consumer may
+  // read slightly stale values.
+  unsigned long pushed;         // Records queued
+  unsigned long dropped;        // Records thrown away because queue stayed full
+  unsigned long full_waits;     // Times the producer found the queue full
+  unsigned int high_water;      // Maximum queue depth seen
+
+  incoming_data_record record[MAX_INPUT_QUEUE];
+} incoming_port_queue;
+
+static incoming_port_queue incoming_queue[MAX_IFACE_DEVICES];
+static int incoming_next_port = 0;    // Round-robin start for pop_incoming_data()
+static unsigned long incoming_popped = 0;
+
 unsigned char incoming_data_copy[MAX_LINE_SIZE];            // Used for debug
 unsigned char incoming_data_copy_previous[MAX_LINE_SIZE];   // Used for debug
 
-// interface wait time out
-int NETWORK_WAITTIME;
-
+#ifndef HAVE_ATOMIC_BUILTINS
+  // Fallbacks for QUEUE_LOAD()/QUEUE_STORE() in interface.h
+  unsigned int queue_load(unsigned int *ptr)
+  {
+    unsigned int val;
 
+    begin_critical_section(&data_lock, "interface.c:queue_load" );
+    val = *ptr;
+    end_critical_section(&data_lock, "interface.c:queue_load" );
+    return(val);
+  }
+  void queue_store(unsigned int *ptr, unsigned int val)
+  {
+    begin_critical_section(&data_lock, "interface.c:queue_store" );
+    *ptr = val;
+    end_critical_section(&data_lock, "interface.c:queue_store" );
+  }
+#endif  // HAVE_ATOMIC_BUILTINS
 
+// interface wait time out
+int NETWORK_WAITTIME;
 
 
-// Read/write pointers for the circular input queue
-static int incoming_read_ptr = 0;
-static int incoming_write_ptr = 0;
-static int queue_depth = 0;
-static int push_count = 0;
-static int pop_count = 0;
 
 
 
@@ -166,116 +210,186 @@ void output_fixed_position(char *data_txt_save, size_t data_txt_save_size,
                            char *data_txt, size_t data_txt_size,
                            char *output_net);
 
-// Fetch a record from the circular queue.
+// Fetch a record from the circular queues.  Ports are visited
+// round-robin so that a busy internet feed can't starve an RF port.
 // Returns 0 if no records available
 // Else returns length of string, data_string and port
 // data_string variable should be of size MAX_LINE_SIZE
 //
 int pop_incoming_data(unsigned char *data_string, int *port)
 {
+  incoming_port_queue *queue;
+  incoming_data_record *record;
+  unsigned int read_ptr;
   int length;
-  int jj;
+  int ii, jj;
 
-  if (begin_critical_section(&data_lock, "interface.c:pop_incoming_data" ) > 0)
-  {
-    fprintf(stderr,"data_lock\n");
-  }
 
-  // Check for queue empty
-  if (incoming_read_ptr == incoming_write_ptr)
+  for (ii = 0; ii < MAX_IFACE_DEVICES; ii++)
   {
-    // Yep, it's empty
+    jj = (incoming_next_port + ii) % MAX_IFACE_DEVICES;
+    queue = &incoming_queue[jj];
 
-    queue_depth = 0;
+    // Only we write read_ptr, so no need for an atomic load of it
+    read_ptr = queue->read_ptr;
 
-    if (end_critical_section(&data_lock, "interface.c:pop_incoming_data" ) > 0)
+    // Check for queue empty
+    if (read_ptr == QUEUE_LOAD(&queue->write_ptr))
     {
-      fprintf(stderr,"data_lock\n");
+      continue;
     }
-    return(0);
-  }
 
-  // Bump the read pointer
-  incoming_read_ptr = (incoming_read_ptr + 1) % MAX_INPUT_QUEUE;
+    record = &queue->record[read_ptr & (MAX_INPUT_QUEUE - 1)];
 
-  *port = incoming_data_queue[incoming_read_ptr].port;
+    *port = record->port;
+    length = record->length;
 
-  length = incoming_data_queue[incoming_read_ptr].length;
+    // Yes, this is a string, but it may have zeros embedded.  We
+    // can't use string manipulation functions because of that.
+    memcpy(data_string, record->data, length);
 
-  // Yes, this is a string, but it may have zeros embedded.  We can't
-  // use string manipulation functions because of that:
-  for (jj = 0; jj < length; jj++)
-  {
-    data_string[jj] = incoming_data_queue[incoming_read_ptr].data[jj];
-  }
-
-  // Add terminator, just in case
-  data_string[length+1] = '\0';
+    // Add terminator, just in case
+    if (length < MAX_LINE_SIZE)
+    {
+      data_string[length] = '\0';
+    }
 
-  queue_depth--;
-  pop_count++;
+    // Hand the slot back to the producer
+    QUEUE_STORE(&queue->read_ptr, read_ptr + 1);
 
-  if (end_critical_section(&data_lock, "interface.c:pop_incoming_data" ) > 0)
-  {
-    fprintf(stderr,"data_lock\n");
+    incoming_popped++;
+    incoming_next_port = (jj + 1) % MAX_IFACE_DEVICES;
+    return(length);
   }
 
-  return(length);
+  return(0);
 }
 
 
 
 
 
-// Add one record to the circular queue.  Returns 1 if queue is
-// full, 0 if successful.
+// Add one record to the circular queue for the port.  Returns 1 if
+// queue is full, 0 if successful.
 //
 int push_incoming_data(unsigned char *data_string, int length, int port)
 {
-  int next_write_ptr = (incoming_write_ptr + 1) % MAX_INPUT_QUEUE;
-  int jj;
+  incoming_port_queue *queue;
+  incoming_data_record *record;
+  unsigned int write_ptr;
+  unsigned int depth;
 
 
-  if (begin_critical_section(&data_lock, "interface.c:push_incoming_data" ) > 0)
+  if (port < 0 || port >= MAX_IFACE_DEVICES
+      || length < 0 || length > MAX_LINE_SIZE)
   {
-    fprintf(stderr,"data_lock\n");
+    fprintf(stderr,"push_incoming_data: Bad port %d or length %d\n",
+            port,
+            length);
+    return(0);  // Drop it, retrying won't help
   }
 
+  queue = &incoming_queue[port];
+
+  // Only we write write_ptr, so no need for an atomic load of it
+  write_ptr = queue->write_ptr;
+  depth = write_ptr - QUEUE_LOAD(&queue->read_ptr);
+
   // Check whether queue is full
-  if (incoming_read_ptr == next_write_ptr)
+  if (depth >= MAX_INPUT_QUEUE)
   {
     // Yep, it's full!
-
-    if (end_critical_section(&data_lock, "interface.c:push_incoming_data" ) > 0)
-    {
-      fprintf(stderr,"data_lock\n");
-    }
+    queue->full_waits++;
     return(1);
   }
 
+  record = &queue->record[write_ptr & (MAX_INPUT_QUEUE - 1)];
+  record->length = length;
+  record->port = port;
 
-  // Advance the write pointer
-  incoming_write_ptr = next_write_ptr;
+  // Binary safe copy in case there are embedded zeros
+  memcpy(record->data, data_string, length);
 
-  incoming_data_queue[incoming_write_ptr].length = length;
+  // Publish the record to the consumer
+  QUEUE_STORE(&queue->write_ptr, write_ptr + 1);
 
-  incoming_data_queue[incoming_write_ptr].port = port;
+  queue->pushed++;
+  if (depth + 1 > queue->high_water)
+  {
+    queue->high_water = depth + 1;
+  }
 
-  // Binary safe copy in case there are embedded zeros
-  for (jj = 0; jj < length; jj++)
+  return(0);
+}
+
+
+
+
+
+// Record that a packet for the port was thrown away because its
+// queue stayed full.  Called by the producer for that port.
+//
+static void incoming_data_dropped(int port)
+{
+  if (port >= 0 && port < MAX_IFACE_DEVICES)
   {
-    incoming_data_queue[incoming_write_ptr].data[jj] = data_string[jj];
+    incoming_queue[port].dropped++;
   }
+}
+
+
+
+
+
+// Fill in statistics for the incoming data queues, summed over all
+// ports.  Any of the pointers may be NULL.  Should be called from the
+// consumer (main) thread; producer-side counters may lag slightly.
+//
+void get_incoming_data_stats(int *depth,
+                             int *high_water,
+                             unsigned long *pushed,
+                             unsigned long *popped,
+                             unsigned long *dropped)
+{
+  int ii;
+  int total_depth = 0;
+  int max_high_water = 0;
+  unsigned long total_pushed = 0;
+  unsigned long total_dropped = 0;
 
-  queue_depth++;
-  push_count++;
 
-  if (end_critical_section(&data_lock, "interface.c:push_incoming_data" ) > 0)
+  for (ii = 0; ii < MAX_IFACE_DEVICES; ii++)
   {
-    fprintf(stderr,"data_lock\n");
+    total_depth += (int)(QUEUE_LOAD(&incoming_queue[ii].write_ptr)
+                         - incoming_queue[ii].read_ptr);
+    if ((int)incoming_queue[ii].high_water > max_high_water)
+    {
+      max_high_water = (int)incoming_queue[ii].high_water;
+    }
+    total_pushed += incoming_queue[ii].pushed;
+    total_dropped += incoming_queue[ii].dropped;
   }
 
-  return(0);
+  if (depth)
+  {
+    *depth = total_depth;
+  }
+  if (high_water)
+  {
+    *high_water = max_high_water;
+  }
+  if (pushed)
+  {
+    *pushed = total_pushed;
+  }
+  if (popped)
+  {
+    *popped = incoming_popped;
+  }
+  if (dropped)
+  {
+    *dropped = total_dropped;
+  }
 }
 
 
@@ -1349,9 +1463,9 @@ int get_device_status(int port)
 //***********************************************************
 // channel_data()
 //
-// Takes data read in from a port and adds it to the
-// incoming_data_queue.  If queue is full, waits for queue to have
-// space before continuing.
+// Takes data read in from a port and adds it to that port's
+// incoming_queue.  If queue is full, waits for queue to have space
+// before continuing, and drops the packet if it doesn't get any.
 //
 // port #
 // string is the string of data
@@ -1446,7 +1560,9 @@ void channel_data(int port, unsigned char *string, volatile int length)
 
 
   // This protects channel_data from being run by more than one
-  // thread at the same time.
+  // thread at the same time while it's saving GPS strings.  Adding
+  // to the incoming queue is done after we let go of the lock, as
+  // each port has its own queue.
   if (begin_critical_section(&output_data_lock, "interface.c:channel_data(1)" ) > 0)
   {
     fprintf(stderr,"output_data_lock, Port = %d\n", port);
@@ -1549,20 +1665,6 @@ void channel_data(int port, unsigned char *string, volatile int length)
     {
       fprintf(stderr,"Channel data on Port %d [%s]\n",port,(char *)string);
     }
-
-    if (process_it)
-    {
-
-      // Wait for empty space in queue
-      while (push_incoming_data(string, length, port) && max < 5400)
-      {
-        sched_yield();  // Yield to other threads
-        tmv.tv_sec = 0;
-        tmv.tv_usec = 2;  // 2 usec
-        (void)select(0,NULL,NULL,NULL,&tmv);
-        max++;
-      }
-    }
   }
 
 
@@ -1578,6 +1680,30 @@ void channel_data(int port, unsigned char *string, volatile int length)
   // properly.
   //
   pthread_cleanup_pop(0);
+
+
+  if (process_it)
+  {
+
+    // Wait for empty space in queue
+    while (push_incoming_data(string, length, port) && max < 5400)
+    {
+      sched_yield();  // Yield to other threads
+      tmv.tv_sec = 0;
+      tmv.tv_usec = 2;  // 2 usec
+      (void)select(0,NULL,NULL,NULL,&tmv);
+      max++;
+    }
+
+    if (max >= 5400)
+    {
+      incoming_data_dropped(port);
+      if (debug_level & 1)
+      {
+        fprintf(stderr,"channel_data: Queue full on Port %d, dropped packet\n", port);
+      }
+    }
+  }
 }
 
 
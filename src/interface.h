@@ -228,7 +228,19 @@ extern int add_device(int port_avail,int dev_type,
                       int reconnect,
                       char *filter_string);
 
-extern xastir_mutex data_lock;          // Protects incoming_data_queue
+extern xastir_mutex data_lock;          // Protects incoming_queue[] pointers if no atomic builtins
+
+// Acquire/release access to the read/write indexes of the lock-free
+// single-producer/single-consumer queues.
+#ifdef HAVE_ATOMIC_BUILTINS
+  #define QUEUE_LOAD(ptr)         __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+  #define QUEUE_STORE(ptr, val)   __atomic_store_n((ptr), (val), __ATOMIC_RELEASE)
+#else   // HAVE_ATOMIC_BUILTINS
+  extern unsigned int queue_load(unsigned int *ptr);
+  extern void queue_store(unsigned int *ptr, unsigned int val);
+  #define QUEUE_LOAD(ptr)         queue_load(ptr)
+  #define QUEUE_STORE(ptr, val)   queue_store((ptr), (val))
+#endif  // HAVE_ATOMIC_BUILTINS
 extern xastir_mutex output_data_lock;   // Protects interface.c:channel_data() function only
 extern xastir_mutex connect_lock;       // Protects port_data[].thread_status and port_data[].connect_status
 
@@ -263,6 +275,7 @@ extern void send_agwpe_packet(int xastir_interface, int RadioPort, unsigned char
 
 extern int pop_incoming_data(unsigned char *data_string, int *port);
 extern int push_incoming_data(unsigned char *data_string, int length, int port);
+extern void get_incoming_data_stats(int *depth, int *high_water, unsigned long *pushed, unsigned long *popped, unsigned long *dropped);
 
 extern unsigned char incoming_data_copy[MAX_LINE_SIZE];
 extern unsigned char incoming_data_copy_previous[MAX_LINE_SIZE];
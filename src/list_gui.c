@@ -208,7 +208,7 @@ void get_list_member(int type, DataRow **p_station, int skip, int forward)
       if (forward == 1)
         while (!found && (*p_station) != NULL)
         {
-          if (((*p_station)->flag & ST_ACTIVE) != 0 && (*p_station)->newest_trackpoint != NULL)
+          if (((*p_station)->flag & ST_ACTIVE) != 0 && (*p_station)->trail != NULL)
           {
             found = (char)TRUE;
           }
@@ -220,7 +220,7 @@ void get_list_member(int type, DataRow **p_station, int skip, int forward)
       else
         while (!found && (*p_station) != NULL)
         {
-          if (((*p_station)->flag & ST_ACTIVE) != 0 && (*p_station)->newest_trackpoint != NULL)
+          if (((*p_station)->flag & ST_ACTIVE) != 0 && (*p_station)->trail != NULL)
           {
             found = (char)TRUE;
           }
@@ -437,7 +437,7 @@ int stations_types(int type)
           st++;
           break;
         case 1:         // mobile stations list
-          if (p_station->newest_trackpoint != NULL)
+          if (p_station->trail != NULL)
           {
             st++;
           }
@@ -831,22 +831,11 @@ void Station_List_fill(int type, int new_offset)
             XmTextFieldSetString(SL_packets[type][row],stemp);
             XtManageChild(SL_packets[type][row]);
 
-            if (strlen(p_station->pos_time) > 13)
+            if (p_station->pos_time != 0)
             {
-              xastir_snprintf(stemp, sizeof(stemp), "%c%c/%c%c %c%c:%c%c",
-                              //sprintf(stemp,"%c%c/%c%c/%c%c%c%c %c%c:%c%c",
-                              p_station->pos_time[0],
-                              p_station->pos_time[1],
-                              p_station->pos_time[2],
-                              p_station->pos_time[3],
-                              //p_station->pos_time[4],
-                              //p_station->pos_time[5],
-                              //p_station->pos_time[6],
-                              //p_station->pos_time[7],
-                              p_station->pos_time[8],
-                              p_station->pos_time[9],
-                              p_station->pos_time[10],
-                              p_station->pos_time[11]);
+              time_t pos_time = p_station->pos_time;
+
+              (void)strftime(stemp, sizeof(stemp), "%m/%d %H:%M", localtime(&pos_time));
             }
             else
             {
@@ -860,7 +849,7 @@ void Station_List_fill(int type, int new_offset)
             XmTextFieldSetString(SL_node_path[type][row],stemp);
             XtManageChild(SL_node_path[type][row]);
 
-            xastir_snprintf(stemp, sizeof(stemp), "%s", p_station->power_gain);
+            xastir_snprintf(stemp, sizeof(stemp), "%s", EXTRA_DATA(p_station)->power_gain);
             XmTextFieldSetString(SL_power_gain[type][row],stemp);
             XtManageChild(SL_power_gain[type][row]);
 
@@ -982,9 +971,9 @@ void Station_List_fill(int type, int new_offset)
             XmTextFieldSetString(SL_packets[type][row],stemp);
             XtManageChild(SL_packets[type][row]);
 
-            if (strlen(p_station->sats_visible)>0)
+            if (strlen(EXTRA_DATA(p_station)->sats_visible)>0)
             {
-              xastir_snprintf(stemp, sizeof(stemp), "%d", atoi(p_station->sats_visible));
+              xastir_snprintf(stemp, sizeof(stemp), "%d", atoi(EXTRA_DATA(p_station)->sats_visible));
               XmTextFieldSetString(SL_sats[type][row],stemp);
             }
             else
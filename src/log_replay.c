@@ -0,0 +1,240 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 2000-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+
+#ifdef HAVE_CONFIG_H
+  #include "config.h"
+#endif  // HAVE_CONFIG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#ifdef HAVE_MMAP
+  #include <sys/mman.h>
+#endif  // HAVE_MMAP
+
+#include "log_replay.h"
+
+// Must be last include file
+#include "leak_detection.h"
+
+
+
+
+
+// Wall clock time in seconds, for pacing
+//
+double log_replay_clock(void)
+{
+  struct timeval tv;
+
+
+  gettimeofday(&tv, NULL);
+  return(tv.tv_sec + tv.tv_usec / 1000000.0);
+}
+
+
+
+
+
+log_replay *log_replay_open(const char *path, double speed)
+{
+  log_replay *replay;
+  struct stat sb;
+  int fd;
+
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0)
+  {
+    return(NULL);
+  }
+  if (fstat(fd, &sb) != 0)
+  {
+    close(fd);
+    return(NULL);
+  }
+
+  replay = calloc(1, sizeof(log_replay));
+  if (replay == NULL)
+  {
+    close(fd);
+    return(NULL);
+  }
+  replay->length = sb.st_size;
+  replay->speed = speed;
+
+  if (replay->length > 0)
+  {
+#ifdef HAVE_MMAP
+    replay->data = mmap(NULL, replay->length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (replay->data == MAP_FAILED)
+    {
+      replay->data = NULL;
+    }
+    else
+    {
+      replay->mapped = 1;
+#ifdef MADV_SEQUENTIAL
+      (void)madvise(replay->data, replay->length, MADV_SEQUENTIAL);
+#endif  // MADV_SEQUENTIAL
+    }
+#else   // HAVE_MMAP
+    replay->data = malloc(replay->length);
+    if (replay->data != NULL
+        && read(fd, replay->data, replay->length) != (ssize_t)replay->length)
+    {
+      free(replay->data);
+      replay->data = NULL;
+    }
+#endif  // HAVE_MMAP
+
+    if (replay->data == NULL)
+    {
+      close(fd);
+      free(replay);
+      return(NULL);
+    }
+  }
+  close(fd);
+  return(replay);
+}
+
+
+
+
+
+void log_replay_close(log_replay *replay)
+{
+  if (replay == NULL)
+  {
+    return;
+  }
+#ifdef HAVE_MMAP
+  if (replay->mapped)
+  {
+    (void)munmap(replay->data, replay->length);
+  }
+  else
+#endif  // HAVE_MMAP
+  {
+    free(replay->data);
+  }
+  free(replay);
+}
+
+
+
+
+
+// Get the next packet line into "line", without its line end and any
+// trailing "<br>" (findu).  "now" is log_replay_clock(), only used
+// when pacing.  Returns 1 if a line is ready, 0 if the next one isn't
+// due yet, -1 at the end of the log.
+//
+int log_replay_next(log_replay *replay, double now, char *line, int size)
+{
+  const char *start;
+  const char *end;
+  size_t length;
+  char *br;
+  long stamp;
+  size_t i;
+
+
+  while (replay->offset < replay->length)
+  {
+    start = replay->data + replay->offset;
+    end = memchr(start, '\n', replay->length - replay->offset);
+    if (end == NULL)
+    {
+      end = replay->data + replay->length;
+    }
+    length = end - start;
+    if (length > 0 && start[length - 1] == '\r')
+    {
+      length--;
+    }
+
+    if (length == 0)
+    {
+      replay->offset = end - replay->data + 1;
+      continue;
+    }
+
+    if (start[0] == '#')
+    {
+      // "# 1157027319  Thu Aug 31 05:28:39 PDT 2006".  The map
+      // isn't NUL-terminated, so no sscanf().
+      stamp = 0;
+      for (i = 2; i < length && i < 14 && start[1] == ' ' && isdigit((unsigned char)start[i]); i++)
+      {
+        stamp = stamp * 10 + (start[i] - '0');
+      }
+      if (stamp > 0)
+      {
+        replay->stamp = (time_t)stamp;
+      }
+      replay->offset = end - replay->data + 1;
+      continue;
+    }
+
+    if (replay->speed > 0 && replay->stamp != 0)
+    {
+      if (replay->first_stamp == 0)
+      {
+        replay->first_stamp = replay->stamp;
+        replay->started = now;
+      }
+      if ((replay->stamp - replay->first_stamp) / replay->speed > now - replay->started)
+      {
+        return(0);
+      }
+    }
+
+    if (length > (size_t)size - 1)
+    {
+      length = size - 1;
+    }
+    memcpy(line, start, length);
+    line[length] = '\0';
+
+    // Findu track files have "<br>" at the end of the lines
+    br = strstr(line, "<br>");
+    if (br != NULL)
+    {
+      *br = '\0';
+    }
+
+    replay->offset = end - replay->data + 1;
+    replay->packets++;
+    return(1);
+  }
+
+  replay->offset = replay->length;
+  return(-1);
+}
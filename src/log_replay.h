@@ -0,0 +1,55 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 2000-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+#ifndef __XASTIR_LOG_REPLAY_H
+#define __XASTIR_LOG_REPLAY_H
+
+#include <stddef.h>
+#include <time.h>
+
+// Plays back a log file as written by log_data():  a "# <epoch>  <date>"
+// line before each packet line.  The file is mmap()ed and handed out a
+// packet line at a time, either as fast as the caller takes them or
+// paced by the timestamps, at "speed" times real time.  Lines without
+// a timestamp before them (older logs, findu track files) are due
+// right away.
+typedef struct
+{
+  char *data;
+  size_t length;
+  size_t offset;              // Of the next line
+  int mapped;                 // data is mmap()ed rather than malloc()ed
+  double speed;               // 0 for as fast as possible
+  time_t stamp;               // Log time of the next packet, 0 if unknown
+  time_t first_stamp;         // Log time playback started at
+  double started;             // Wall clock time playback started at
+  long packets;               // Handed out so far
+} log_replay;
+
+extern log_replay *log_replay_open(const char *path, double speed);
+extern void log_replay_close(log_replay *replay);
+extern int log_replay_next(log_replay *replay, double now, char *line, int size);
+extern double log_replay_clock(void);
+
+#define log_replay_percent(replay) \
+  ((replay)->length ? (int)((replay)->offset * 100.0 / (replay)->length) : 100)
+
+#endif
@@ -33,8 +33,11 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <errno.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <sys/stat.h>
 
 #include "xastir.h"
@@ -44,11 +47,50 @@
 #include "db_funcs.h"
 #include "xa_config.h"
 #include "snprintf.h"
+#include "log_utils.h"
 
 #include "maps.h" // for fill_in_new_alert_entries prototype
 
 #define MAX_LOGFILE_SIZE 2048000
 
+// log_data() only appends to an in-memory buffer per log file.  A
+// background thread writes the buffers out, at the latest
+// LOG_FLUSH_SECONDS after a line was logged or as soon as
+// LOG_FLUSH_BYTES are waiting, so that's about all a crash can lose.
+// It keeps the log files open and does the rotation too.  Should the
+// disk fall further behind than LOG_BUFFER_MAX, lines are dropped.
+#define LOG_FLUSH_SECONDS 2
+#define LOG_FLUSH_BYTES   (32 * 1024)
+#define LOG_BUFFER_MAX    (1024 * 1024)
+
+typedef struct _log_file
+{
+  struct _log_file *next;
+  char path[MAX_FILENAME];
+  int fd;                     // -1 while closed
+  char *buffer;               // Lines waiting to be written
+  size_t length;
+  size_t size;
+  char *spare;                // The other buffer, written by the writer
+  size_t spare_size;
+  off_t file_size;            // Once everything buffered is written
+  int rotate;                 // Rotate after writing rotate_at bytes
+  size_t rotate_at;
+  int close;                  // Close after writing, for log_close_file()
+  int busy;                   // Writer is working on it
+  long dropped;
+} log_file;
+
+static log_file *log_files = NULL;
+static pthread_mutex_t log_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t log_wake = PTHREAD_COND_INITIALIZER;     // For the writer
+static pthread_cond_t log_written = PTHREAD_COND_INITIALIZER;  // From the writer
+static int log_wake_now = 0;
+static unsigned long log_passes = 0;
+static int log_thread = 0;    // 1 running, -1 couldn't start one
+static time_t log_stamp_secs = 0;
+static char log_stamp[200];
+
 
 char *fetch_file_line(FILE *f, char *line)
 {
@@ -184,6 +226,10 @@ void load_wx_alerts_from_log_working_sub(time_t time_now, char *filename)
   expire_limit = 60 * 60 * 24 * 15;   // 15 days
 //    expire_limit = 60 * 60 * 24 * 1;   // 1 day
 
+  // Get any alerts still buffered into the file, and have the next
+  // one reopen it, as it may be replaced by a pruned copy below.
+  log_close_file(filename);
+
   file_timestamp = file_time(filename);
 
   if (file_timestamp == -1)
@@ -371,106 +417,477 @@ void load_wx_alerts_from_log(void)
 
 
 
-// Note that the length of "line" can be up to MAX_DEVICE_BUFFER,
-// which is currently set to 4096.
+// Write all of "data" to "fd".
 //
-void log_data(char *file, char *line)
+static int log_write(int fd, const char *data, size_t length)
 {
-  FILE *f;
-  struct stat file_status;
-  int reset_setuid = 0 ;
+  ssize_t n;
 
 
-  // Check for "# Tickle" first, don't log it if found.
-  // It's an idle string designed to keep the socket active.
-  if ( (strncasecmp(line, "#Tickle", 7)==0)
-       || (strncasecmp(line, "# Tickle", 8) == 0) )
+  while (length > 0)
   {
-    return;
+    n = write(fd, data, length);
+    if (n < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      return(-1);
+    }
+    data += n;
+    length -= n;
   }
-  else
+  return(0);
+}
+
+
+
+
+
+// Open a log file for appending, unless it's open already and still
+// the file at its path (it may have been renamed or deleted behind
+// our back).
+//
+static void log_open(log_file *log)
+{
+  struct stat path_status;
+  struct stat fd_status;
+  int reset_setuid = 0;
+
+
+  if (log->fd >= 0)
   {
-    char temp[200];
-    char timestring[100+1];
-    struct tm *time_now;
-    time_t secs_now;
+    if (stat(log->path, &path_status) == 0
+        && fstat(log->fd, &fd_status) == 0
+        && path_status.st_ino == fd_status.st_ino
+        && path_status.st_dev == fd_status.st_dev)
+    {
+      return;
+    }
+    (void)close(log->fd);
+    log->fd = -1;
+  }
 
-    // Fetch the current date/time string
-//        get_timestamp(timestring);
-    secs_now=sec_now();
+  if (getuid() != geteuid())
+  {
+    reset_setuid=1;
+    DISABLE_SETUID_PRIVILEGE;
+  }
 
-    time_now = localtime(&secs_now);
+#ifdef O_CLOEXEC
+  log->fd = open(log->path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0666);
+#else   // O_CLOEXEC
+  log->fd = open(log->path, O_WRONLY | O_APPEND | O_CREAT, 0666);
+#endif  // O_CLOEXEC
+  if (log->fd < 0)
+  {
+    fprintf(stderr,"Couldn't open file for appending: %s\n", log->path);
+  }
 
-    (void)strftime(timestring,100,"%a %b %d %H:%M:%S %Z %Y",time_now);
+  if(reset_setuid)
+  {
+    ENABLE_SETUID_PRIVILEGE;
+  }
+}
 
-    xastir_snprintf(temp,
-                    sizeof(temp),
-                    "# %ld  %s",
-                    (unsigned long)secs_now,
-                    timestring);
 
-    // Change back to the base directory
 
-// This call corrupts the "file" variable.  Commented it out as we
-// don't appear to need it anyway.  The complete root-anchored
-// path/filename are passed to us in the "file" parameter.
+
+
+// Write out what's buffered for every log file, rotating and closing
+// them as asked.  Called with log_lock held, which is released while
+// the files are written so that log_data() callers never wait on the
+// disk.
 //
-//        chdir(get_user_base_dir(""));
+static void log_write_all(void)
+{
+  log_file *log;
+  char *data;
+  size_t data_size;
+  size_t length;
+  size_t rotate_at;
+  int rotate;
+  int close_it;
 
-    // check size and rotate if too big
 
-    if (stat(file, &file_status)==0)
+  for (log = log_files; log != NULL; log = log->next)
+  {
+    if (log->busy || (log->length == 0 && !log->rotate && !log->close))
     {
+      continue;
+    }
 
-//            if (debug_level & 1) {
-//                fprintf(stderr, "log_data(): logfile size: %ld \n",(long) file_status.st_size);
-//            }
-
-      if ((file_status.st_size + strlen(temp) + strlen(line) )> MAX_LOGFILE_SIZE)
+    // Take the buffer, leaving the spare for log_data()
+    data = log->buffer;
+    data_size = log->size;
+    length = log->length;
+    log->buffer = log->spare;
+    log->size = log->spare_size;
+    log->length = 0;
+    log->spare = NULL;
+    log->spare_size = 0;
+    rotate = log->rotate;
+    rotate_at = log->rotate_at;
+    close_it = log->close;
+    log->rotate = 0;
+    log->close = 0;
+    log->busy = 1;
+    pthread_mutex_unlock(&log_lock);
+
+    if (rotate)
+    {
+      log_open(log);
+      if (log->fd >= 0 && rotate_at > 0)
       {
-        if (debug_level & 1)
-        {
-          fprintf(stderr, "log_data(): calling rotate_file()\n");
-        }
-
-        rotate_file(file,3);
+        (void)log_write(log->fd, data, rotate_at);
+      }
+      if (log->fd >= 0)
+      {
+        (void)close(log->fd);
+        log->fd = -1;
       }
 
+      if (debug_level & 1)
+      {
+        fprintf(stderr, "log_data(): calling rotate_file()\n");
+      }
+      rotate_file(log->path, 3);
     }
     else
     {
-      // ENOENT is ok -- we make the file below
-      if (errno != ENOENT )
+      rotate_at = 0;
+    }
+
+    if (length > rotate_at)
+    {
+      log_open(log);
+      if (log->fd >= 0 && log_write(log->fd, data + rotate_at, length - rotate_at) < 0)
       {
-        fprintf(stderr,"Couldn't stat log file '%s': %s\n",
-                file,strerror(errno));
-        return;
+        fprintf(stderr,"Couldn't write log file '%s': %s\n",
+                log->path, strerror(errno));
       }
+    }
 
+    if (close_it && log->fd >= 0)
+    {
+      (void)close(log->fd);
+      log->fd = -1;
     }
 
-    if (getuid() != geteuid())
+    pthread_mutex_lock(&log_lock);
+    log->busy = 0;
+
+    // Hand the written buffer back as the spare
+    log->spare = data;
+    log->spare_size = data_size;
+    if (log->dropped)
     {
-      reset_setuid=1;
-      DISABLE_SETUID_PRIVILEGE;
+      fprintf(stderr,"Log file '%s' can't keep up, %ld lines dropped\n",
+              log->path, log->dropped);
+      log->dropped = 0;
     }
+  }
+}
+
+
+
+
 
-    f=fopen(file,"a");
-    if (f!=NULL)
+static void *log_writer_thread(void * UNUSED(arg) )
+{
+  struct timespec until;
+
+
+  (void)pthread_detach(pthread_self());
+
+  pthread_mutex_lock(&log_lock);
+  while (1)
+  {
+    if (!log_wake_now)
     {
-      fprintf(f,"%s\n", temp); // Write the timestamp line
-      fprintf(f,"%s\n",line);  // Write the data line
-      (void)fclose(f);
+      until.tv_sec = time(NULL) + LOG_FLUSH_SECONDS;
+      until.tv_nsec = 0;
+      (void)pthread_cond_timedwait(&log_wake, &log_lock, &until);
     }
-    else
+    log_wake_now = 0;
+
+    log_write_all();
+
+    log_passes++;
+    pthread_cond_broadcast(&log_written);
+  }
+
+  return(NULL);
+}
+
+
+
+
+
+// Get log_lock, but don't hang if it can't be had:  log_flush() is
+// also called from signal handlers, which may have interrupted a
+// log_data() holding it.
+//
+static int log_try_lock(void)
+{
+  int i;
+
+
+  for (i = 0; i < 200; i++)
+  {
+    if (pthread_mutex_trylock(&log_lock) == 0)
     {
-      fprintf(stderr,"Couldn't open file for appending: %s\n", file);
+      return(1);
     }
+    usleep(10000);
+  }
+  return(0);
+}
+
+
+
+
 
-    if(reset_setuid)
+// Have everything logged so far written out, and wait (a little
+// while at most) until it is.  Called with log_lock held.
+//
+static void log_write_now(void)
+{
+  struct timespec until;
+  unsigned long pass;
+
+
+  if (log_thread != 1)
+  {
+    log_write_all();
+    return;
+  }
+
+  // A pass already under way may have missed the latest lines, the
+  // one after it won't
+  pass = log_passes + 2;
+  until.tv_sec = time(NULL) + 5;
+  until.tv_nsec = 0;
+  while (log_passes < pass)
+  {
+    log_wake_now = 1;
+    pthread_cond_signal(&log_wake);
+    if (pthread_cond_timedwait(&log_written, &log_lock, &until) != 0
+        && log_passes < pass)
     {
-      ENABLE_SETUID_PRIVILEGE;
+      fprintf(stderr,"Timed out writing the log files\n");
+      return;
     }
   }
 }
 
+
+
+
+
+// Write out every buffered log line now, e.g. before exiting.
+//
+void log_flush(void)
+{
+  if (!log_try_lock())
+  {
+    return;
+  }
+  log_write_now();
+  pthread_mutex_unlock(&log_lock);
+}
+
+
+
+
+
+// Write out what's buffered for "file" and close it, so that it can
+// be renamed or replaced.  The next log_data() for it reopens it.
+//
+void log_close_file(char *file)
+{
+  log_file *log;
+
+
+  if (!log_try_lock())
+  {
+    return;
+  }
+  for (log = log_files; log != NULL; log = log->next)
+  {
+    if (strcmp(log->path, file) == 0)
+    {
+      log->close = 1;
+      log_write_now();
+      break;
+    }
+  }
+  pthread_mutex_unlock(&log_lock);
+}
+
+
+
+
+
+// Find the buffer of a log file, adding it if it's new.  Called with
+// log_lock held.
+//
+static log_file *log_find(char *file)
+{
+  log_file *log;
+  struct stat file_status;
+
+
+  for (log = log_files; log != NULL; log = log->next)
+  {
+    if (strcmp(log->path, file) == 0)
+    {
+      return(log);
+    }
+  }
+
+  // The size once, to know when to rotate.  ENOENT is ok, the
+  // writer creates the file.
+  if (stat(file, &file_status) != 0)
+  {
+    if (errno != ENOENT)
+    {
+      fprintf(stderr,"Couldn't stat log file '%s': %s\n",
+              file,strerror(errno));
+      return(NULL);
+    }
+    file_status.st_size = 0;
+  }
+
+  log = (log_file *)calloc(1, sizeof(log_file));
+  if (log == NULL)
+  {
+    fprintf(stderr,"Couldn't allocate log buffer for '%s'\n", file);
+    return(NULL);
+  }
+  xastir_snprintf(log->path, sizeof(log->path), "%s", file);
+  log->fd = -1;
+  log->file_size = file_status.st_size;
+  log->next = log_files;
+  log_files = log;
+  return(log);
+}
+
+
+
+
+
+// Note that the length of "line" can be up to MAX_DEVICE_BUFFER,
+// which is currently set to 4096.
+//
+// The line is only buffered here, see log_write_all() for the rest.
+//
+void log_data(char *file, char *line)
+{
+  log_file *log;
+  pthread_t thread;
+  struct tm time_now;
+  time_t secs_now;
+  size_t stamp_length;
+  size_t line_length;
+  size_t needed;
+  char *bigger;
+
+
+  // Check for "# Tickle" first, don't log it if found.
+  // It's an idle string designed to keep the socket active.
+  if ( (strncasecmp(line, "#Tickle", 7)==0)
+       || (strncasecmp(line, "# Tickle", 8) == 0) )
+  {
+    return;
+  }
+
+  pthread_mutex_lock(&log_lock);
+
+  if (log_thread == 0)
+  {
+    if (pthread_create(&thread, NULL, log_writer_thread, NULL) == 0)
+    {
+      log_thread = 1;
+    }
+    else
+    {
+      fprintf(stderr,"Error creating log writer thread, logging directly\n");
+      log_thread = -1;
+    }
+  }
+
+  log = log_find(file);
+  if (log == NULL)
+  {
+    pthread_mutex_unlock(&log_lock);
+    return;
+  }
+
+  // The timestamp line only changes once a second
+  secs_now = sec_now();
+  if (secs_now != log_stamp_secs)
+  {
+    char timestring[100+1];
+
+    (void)localtime_r(&secs_now, &time_now);
+    (void)strftime(timestring,100,"%a %b %d %H:%M:%S %Z %Y",&time_now);
+
+    xastir_snprintf(log_stamp,
+                    sizeof(log_stamp),
+                    "# %ld  %s\n",
+                    (unsigned long)secs_now,
+                    timestring);
+    log_stamp_secs = secs_now;
+  }
+  stamp_length = strlen(log_stamp);
+  line_length = strlen(line);
+  needed = stamp_length + line_length + 1;
+
+  // Rotate if too big.  The writer rotates once it has written what
+  // came before this line.
+  if (!log->rotate && log->file_size + (off_t)needed > MAX_LOGFILE_SIZE)
+  {
+    log->rotate = 1;
+    log->rotate_at = log->length;
+    log->file_size = 0;
+  }
+
+  if (log->length + needed > LOG_BUFFER_MAX)
+  {
+    log->dropped++;
+  }
+  else
+  {
+    if (log->length + needed > log->size)
+    {
+      bigger = realloc(log->buffer, (log->length + needed) * 2);
+      if (bigger == NULL)
+      {
+        log->dropped++;
+        pthread_mutex_unlock(&log_lock);
+        return;
+      }
+      log->buffer = bigger;
+      log->size = (log->length + needed) * 2;
+    }
+    memcpy(log->buffer + log->length, log_stamp, stamp_length);     // The timestamp line
+    memcpy(log->buffer + log->length + stamp_length, line, line_length); // The data line
+    log->buffer[log->length + needed - 1] = '\n';
+    log->length += needed;
+    log->file_size += needed;
+  }
+
+  if (log_thread != 1)
+  {
+    log_write_all();
+  }
+  else if (log->length >= LOG_FLUSH_BYTES || log->rotate)
+  {
+    log_wake_now = 1;
+    pthread_cond_signal(&log_wake);
+  }
+
+  pthread_mutex_unlock(&log_lock);
+}
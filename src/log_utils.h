@@ -25,5 +25,7 @@
 
 extern void load_wx_alerts_from_log(void);
 extern void log_data(char *file, char *line);
+extern void log_flush(void);
+extern void log_close_file(char *file);
 
 #endif
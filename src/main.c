@@ -120,6 +120,7 @@ char *xastir_version=VERSION;
 #include "maps.h"
 #include "alert.h"
 #include "interface.h"
+#include "decode_thread.h"
 #include "wx.h"
 #include "popup.h"
 #include "track_gui.h"
@@ -141,6 +142,7 @@ char *xastir_version=VERSION;
 #include "ambiguity_utils.h"
 #include "mgrs_utils.h"
 #include "log_utils.h"
+#include "log_replay.h"
 #include "cad_objects.h"
 
 #include "map_OSM.h"
@@ -297,8 +299,7 @@ char dangerous_operation[200];
 
 FILE *file_wx_test;
 
-int tcp_server_pid = 0;
-int udp_server_pid = 0;
+int spider_server_pid = 0;
 
 int serial_char_pacing;  // Inter-char delay in ms for serial ports.
 int dtr_on = 1;
@@ -990,6 +991,7 @@ Colormap cmap;                  /* current colormap */
 
 int redo_list;                  // Station List update request
 int redraw_on_new_data;         // Station redraw request
+int packet_drain_time;          // Max msec per UpdateTime() tick spent decoding packets
 int wait_to_redraw;             /* wait to redraw until system is up */
 int display_up = 0;             /* display up? */
 int display_up_first = 0;       /* display up first */
@@ -5720,7 +5722,7 @@ void create_appshell( Display *display, char * UNUSED(app_name), int UNUSED(app_
          tnc_logging, transmit_disable_toggle, net_logging,
          igate_logging, wx_logging, message_logging,
          wx_alert_logging, enable_snapshots, print_button,
-         test_button, debug_level_button, aa_button, speech_button,
+         test_button, debug_level_button, memory_stats_button, aa_button, speech_button,
          smart_beacon_button, map_indexer_button,
          map_all_indexer_button, geocoder_config_button, auto_msg_set_button,
          send_message_to_button,
@@ -6588,6 +6590,14 @@ void create_appshell( Display *display, char * UNUSED(app_name), int UNUSED(app_
                        MY_BACKGROUND_COLOR,
                        NULL);
 
+  memory_stats_button = XtVaCreateManagedWidget(langcode("PULDNFI017"),
+                        xmPushButtonWidgetClass,
+                        configpane,
+                        XmNfontList, fontlist1,
+                        MY_FOREGROUND_COLOR,
+                        MY_BACKGROUND_COLOR,
+                        NULL);
+
   units_choice_button = XtVaCreateManagedWidget(langcode("PULDNUT001"),
                         xmToggleButtonGadgetClass,
                         configpane,
@@ -9386,6 +9396,7 @@ void create_appshell( Display *display, char * UNUSED(app_name), int UNUSED(app_
   }
 
   XtAddCallback(debug_level_button,   XmNactivateCallback, Change_Debug_Level,NULL);
+  XtAddCallback(memory_stats_button,  XmNactivateCallback, Show_Memory_Stats,NULL);
 //    XtSetSensitive(debug_level_button, False);
 
   XtAddCallback(uptime_button,   XmNactivateCallback, Compute_Uptime,NULL);
@@ -12555,6 +12566,161 @@ void clear_application_context(void)
 time_t stations_status_time = 0;
 static int last_alert_on_screen = -1;
 
+// Incoming packet statistics for the status line, updated once per
+// second by report_packet_queue_status().
+static time_t packet_status_time = 0;
+static unsigned long packet_status_popped = 0;
+static unsigned long packet_status_dropped = 0;
+
+
+
+// Milliseconds elapsed since *start.
+//
+static long elapsed_msec(struct timeval *start)
+{
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+  return( (now.tv_sec - start->tv_sec) * 1000L
+          + (now.tv_usec - start->tv_usec) / 1000L );
+}
+
+
+
+// Once per second, show incoming queue depth, how many packets per
+// second we've been decoding and how many were dropped because the
+// queue was full.  Only shown while packets are backing up or being
+// dropped so we don't clobber other status messages on a quiet feed.
+//
+static void report_packet_queue_status(time_t current_time)
+{
+  int depth;
+  unsigned long popped, dropped;
+  char temp[100];
+
+
+  if (current_time == packet_status_time)
+  {
+    return;
+  }
+
+  get_incoming_data_stats(&depth, NULL, NULL, &popped, &dropped);
+
+  if (current_time > packet_status_time
+      && (depth > 0 || dropped != packet_status_dropped))
+  {
+    xastir_snprintf(temp,
+                    sizeof(temp),
+                    langcode("BBARSTA052"),
+                    depth,
+                    (popped - packet_status_popped)
+                    / (unsigned long)(current_time - packet_status_time),
+                    dropped);
+    statusline(temp, 0);
+  }
+
+  packet_status_time = current_time;
+  packet_status_popped = popped;
+  packet_status_dropped = dropped;
+}
+
+
+
+// Log file being played back from the "Open Log File" dialog, and the
+// playback speed picked there:  0 for as fast as possible, else a
+// multiple of real time.
+static log_replay *replay_log = NULL;
+static double replay_log_speed = 0.0;
+static double replay_log_started;
+static time_t replay_status_time;
+static long replay_status_packets;
+
+#define REPLAY_BATCH_TIME 200   // Max msec per UpdateTime() tick spent replaying at full speed
+
+
+
+// Feed the next batch of lines from the log being played back to
+// decode_ax25_line().  At full speed the per-station drawing in
+// data_add() is skipped and the map is redrawn once at the end, which
+// is where most of the time used to go.  Once a second the status
+// line shows how far along we are.
+//
+static void replay_log_step(time_t current_time)
+{
+  char line[MAX_LINE_SIZE+1];
+  struct timeval batch_start;
+  long batch_time;
+  double now;
+  int result = 1;
+  long elapsed;
+  char temp[100];
+
+
+  if (replay_log == NULL)
+  {
+    return;
+  }
+
+  gettimeofday(&batch_start, NULL);
+  now = log_replay_clock();
+  batch_time = (replay_log->speed > 0) ? packet_drain_time : REPLAY_BATCH_TIME;
+  defer_station_drawing = (replay_log->speed <= 0);
+
+  do
+  {
+    result = log_replay_next(replay_log, now, line, sizeof(line));
+    if (result != 1)
+    {
+      break;
+    }
+
+    // Save backup copies of this string and the previous string.
+    // Used for debugging purposes.  If we get a segfault, we can
+    // print out the last two messages received.
+    memcpy(incoming_data_copy_previous, incoming_data_copy, MAX_LINE_SIZE);
+    incoming_data_copy_previous[MAX_LINE_SIZE-1] = '\0';
+    memcpy(incoming_data_copy, line, MAX_LINE_SIZE);
+    incoming_data_copy[MAX_LINE_SIZE-1] = '\0'; // Terminate string
+
+    decode_ax25_line(line, 'F', -1, 1);
+  }
+  while (!XtAppPending(app_context)
+         && elapsed_msec(&batch_start) < batch_time);
+
+  defer_station_drawing = 0;
+
+  if (result == -1)
+  {
+    elapsed = (long)(log_replay_clock() - replay_log_started + 0.5);
+    xastir_snprintf(temp,
+                    sizeof(temp),
+                    langcode("BBARSTA054"),
+                    replay_log->packets,
+                    elapsed,
+                    replay_log->packets / (elapsed > 0 ? elapsed : 1));
+    statusline(temp, 0);    // Replay done: n pkts in n s, n pkts/s
+    log_replay_close(replay_log);
+    replay_log = NULL;
+    redraw_on_new_data = 2; // Redraw immediately after finish
+    return;
+  }
+
+  if (current_time > replay_status_time)
+  {
+    xastir_snprintf(temp,
+                    sizeof(temp),
+                    langcode("BBARSTA053"),
+                    replay_log->packets,
+                    (replay_log->packets - replay_status_packets)
+                    / (long)(current_time - replay_status_time),
+                    log_replay_percent(replay_log));
+    statusline(temp, 0);    // Replay: n pkts, n pkts/s, n% done
+    replay_status_time = current_time;
+    replay_status_packets = replay_log->packets;
+  }
+}
+
+
 
 // This is the periodic process that updates the maps/symbols/tracks.
 // At the end of the function it schedules itself to be run again.
@@ -12573,6 +12739,10 @@ void UpdateTime( XtPointer clientData, XtIntervalId UNUSED(id) )
   int data_length;
   int data_port;
   unsigned char data_string[MAX_LINE_SIZE];
+  struct timeval drain_start;
+  int packets_before;
+  ax25_packet *packet;
+  int redraw_request;
 #ifdef HAVE_DB
   int got_conn;   // holds result from openConnection()
 #endif // HAVE_DB
@@ -12695,6 +12865,13 @@ void UpdateTime( XtPointer clientData, XtIntervalId UNUSED(id) )
       // start the interfaces.
       load_wx_alerts_from_log();
 
+      // The decode thread has to be the only reader of the
+      // incoming queues before any interface can fill them.
+      if (enable_decode_thread)
+      {
+        start_decode_thread();
+      }
+
       statusline(langcode("BBARSTA048"), 1); // Start interfaces...
       startup_all_or_defined_port(-1);    // start interfaces
     }
@@ -12713,6 +12890,7 @@ void UpdateTime( XtPointer clientData, XtIntervalId UNUSED(id) )
       check_statusline_timeout(current_time);     // clear statusline after timeout
       check_station_remove(current_time);         // remove old stations
       check_message_remove(current_time);         // remove old messages
+      check_station_snapshot(current_time);       // save stations for a restart
 
 #ifdef HAVE_LIBSHP
       purge_shp_hash(current_time);               // purge stale rtrees
@@ -13396,19 +13574,33 @@ void UpdateTime( XtPointer clientData, XtIntervalId UNUSED(id) )
 
       // get data from interfaces
       max=0;
-      // Allow multiple packets to be processed inside this
-      // loop.  Well, it was a nice idea anyway.  See the
-      // below note.
+
+      // Decode as many packets as fit into packet_drain_time
+      // milliseconds, stopping early if the queues run dry or
+      // there are X events waiting.  Decoding one packet per
+      // tick let the queues back up under a full internet feed.
+      //
+      // Each decoded packet may set redraw_on_new_data, and a
+      // later packet can lower a request an earlier one made
+      // (net data sets it to 0, TNC data to 2).  Keep the
+      // highest request seen during the batch so that the batch
+      // results in a single redraw of the right urgency.
+      gettimeofday(&drain_start, NULL);
+      redraw_request = redraw_on_new_data;
 
 // CAREFUL HERE:  If we try to send to the Spider pipes faster than
 // it's reading from the pipes we corrupt the data out our server
-// ports.  Having too high of a number here or putting too small of
-// a delay down lower causes our server port to server up junk!
+// ports.  The 2ms delay at the bottom of the loop when the server
+// port is enabled keeps that from happening, at the cost of fewer
+// packets per tick.
 
-      while (max < 1 && !XtAppPending(app_context))
+      while (!XtAppPending(app_context)
+             && elapsed_msec(&drain_start) < packet_drain_time)
       {
         struct timeval tmv;
 
+        packets_before = max;
+
 
 // Check the x_spider server for incoming data
         if (enable_server_port)
@@ -13494,6 +13686,7 @@ void UpdateTime( XtPointer clientData, XtIntervalId UNUSED(id) )
 
             // Knock off the linefeed at the end
             line[n-1] = '\0';
+            line_offset = 0;
 
             // Check for "TO_INET," prefix, then check
             // for "TO_RF," prefix. Set appropriate
@@ -13666,7 +13859,7 @@ void UpdateTime( XtPointer clientData, XtIntervalId UNUSED(id) )
 // Check the rest of the ports for incoming data.  Process up to
 // 1000 packets here in a loop.
 
-        data_length = pop_incoming_data(data_string, &data_port);
+        data_length = pop_decoded_data(data_string, &data_port, &packet);
 
         if (data_length != 0)
         {
@@ -13723,10 +13916,20 @@ void UpdateTime( XtPointer clientData, XtIntervalId UNUSED(id) )
               }
               // End of x_spider server send code
 
-              decode_ax25_line((char *)data_string,
-                               'I',
-                               data_port,
-                               1);
+              if (packet)   // Already split up by the decode thread
+              {
+                decode_ax25_packet(packet,
+                                   'I',
+                                   data_port,
+                                   1);
+              }
+              else
+              {
+                decode_ax25_line((char *)data_string,
+                                 'I',
+                                 data_port,
+                                 1);
+              }
               break;
 
             // TNC Devices
@@ -13738,8 +13941,11 @@ void UpdateTime( XtPointer clientData, XtIntervalId UNUSED(id) )
               // ASCII logging & decode routines.
               // Note that the length of data_string
               // can increase within decode_ax25_header().
-              if ( !decode_ax25_header( (unsigned char *)data_string,
-                                        &data_length ) )
+              // The decode thread has done this already
+              // if "packet" is set.
+              if ( !packet
+                   && !decode_ax25_header( (unsigned char *)data_string,
+                                           &data_length ) )
               {
                 // Had a problem decoding it.  Drop
                 // it on the floor.
@@ -13754,7 +13960,10 @@ void UpdateTime( XtPointer clientData, XtIntervalId UNUSED(id) )
             /* Falls through. */
 
             case DEVICE_SERIAL_TNC:
-              tnc_data_clean((char *)data_string);
+              if (!packet)
+              {
+                tnc_data_clean((char *)data_string);
+              }
             /* Falls through. */
 
             case DEVICE_AX25_TNC:
@@ -13791,10 +14000,20 @@ void UpdateTime( XtPointer clientData, XtIntervalId UNUSED(id) )
               }
               // End of x_spider server send code
 
-              decode_ax25_line((char *)data_string,
-                               'T',
-                               data_port,
-                               1);
+              if (packet)   // Already split up by the decode thread
+              {
+                decode_ax25_packet(packet,
+                                   'T',
+                                   data_port,
+                                   1);
+              }
+              else
+              {
+                decode_ax25_line((char *)data_string,
+                                 'T',
+                                 data_port,
+                                 1);
+              }
               break;
 
             case DEVICE_SERIAL_TNC_HSP_GPS:
@@ -13957,10 +14176,6 @@ void UpdateTime( XtPointer clientData, XtIntervalId UNUSED(id) )
           }
           max++;  // Count the number of packets processed
         }
-        else
-        {
-          max=1000;   // Go straight to "max": Exit loop
-        }
 
 //if (end_critical_section(&data_lock, "main.c:UpdateTime(2)" ) > 0)
 //    fprintf(stderr,"data_lock\n");
@@ -13977,6 +14192,16 @@ void UpdateTime( XtPointer clientData, XtIntervalId UNUSED(id) )
 // them, we end up with blank lines and corrupted lines going to the
 // connected clients.
 
+        if (redraw_on_new_data > redraw_request)
+        {
+          redraw_request = redraw_on_new_data;
+        }
+
+        if (max == packets_before)
+        {
+          break;  // Nothing left in any of the queues
+        }
+
         sched_yield();  // Yield to the other threads
 
         if (enable_server_port)
@@ -13988,7 +14213,14 @@ void UpdateTime( XtPointer clientData, XtIntervalId UNUSED(id) )
 
       }   // End of packet processing loop
 
+      redraw_on_new_data = redraw_request;
+
+      report_packet_queue_status(current_time);
+
       // END- get data from interface
+      // REPLAY LOG FILE IF OPENED
+      replay_log_step(current_time);
+
       // READ FILE IF OPENED
       if (read_file)
       {
@@ -14038,19 +14270,11 @@ void shut_down_server(void)
 {
 
   // Shut down the server if it was enabled
-  if (tcp_server_pid || udp_server_pid)
+  if (spider_server_pid)
   {
 
-    // Send a kill to the main server process
-    if (tcp_server_pid)
-    {
-      kill(tcp_server_pid, SIGHUP);
-    }
-
-    if (udp_server_pid)
-    {
-      kill(udp_server_pid, SIGHUP);
-    }
+    // Send a kill to the server process
+    kill(spider_server_pid, SIGHUP);
 
     wait(NULL); // Reap the status of the process
 
@@ -14063,15 +14287,8 @@ void shut_down_server(void)
 
     // Send a more forceful kill signal in case the "nice" kill
     // signal didn't work.
-    if (tcp_server_pid)
-    {
-      kill(tcp_server_pid, SIGKILL);
-    }
-
-    if (udp_server_pid)
-    {
-      kill(udp_server_pid, SIGKILL);
-    }
+    kill(spider_server_pid, SIGKILL);
+    spider_server_pid = 0;
   }
 }
 
@@ -14113,6 +14330,12 @@ static void restart(int UNUSED(sig) )
 
   shut_down_server();
 
+  // Write out the log lines still buffered
+  log_flush();
+
+  // Save the stations for the restarted Xastir to pick up
+  save_station_snapshot();
+
 #ifdef USE_PID_FILE_CHECK
   // remove the PID file
   unlink(get_user_base_dir("xastir.pid", temp_file_name,
@@ -14157,6 +14380,16 @@ static void quit(int sig)
 
   shut_down_server();
 
+  // Write out the log lines still buffered
+  log_flush();
+
+  // Save the stations for the next start, unless we got here
+  // from segfault() and they may be what's broken
+  if (sig != -1)
+  {
+    save_station_snapshot();
+  }
+
 
 #ifdef USE_PID_FILE_CHECK
   // remove the PID file
@@ -15725,7 +15958,7 @@ void Center_Zoom( Widget UNUSED(w), XtPointer UNUSED(clientData), XtPointer call
 
       // Compute the approximate zoom level we need from the
       // range value in the object.  Range is in miles.
-      range = atoi(&p_station->power_gain[3]);
+      range = atoi(&EXTRA_DATA(p_station)->power_gain[3]);
 
       // We should be able to compute the distance across the
       // screen that we currently have, then compute an
@@ -15960,6 +16193,8 @@ void save_state( Widget UNUSED(w), XtPointer UNUSED(client), XtPointer calldata)
     shutdown_all_active_or_defined_port(-1);
 
     shut_down_server();
+
+    save_station_snapshot();
   }
 
 }
@@ -19766,8 +20001,7 @@ void  Server_port_toggle( Widget UNUSED(widget), XtPointer clientData, XtPointer
     // rules should apply from there.
     //
     enable_server_port = atoi(which);
-    tcp_server_pid = Fork_TCP_server(my_argc, my_argv, my_envp);
-    udp_server_pid = Fork_UDP_server(my_argc, my_argv, my_envp);
+    spider_server_pid = Fork_spider_server(my_argc, my_argv, my_envp);
   }
   else
   {
@@ -24392,14 +24626,16 @@ void read_file_selection_now(Widget w, XtPointer clientData, XtPointer callData)
 
     // Make sure we're not already reading a file and the user actually
     // selected a file (if not, the last character will be a '/').
-    if ( (!read_file) && (file[strlen(file) - 1] != '/') )
+    if ( (!read_file) && (replay_log == NULL) && (file[strlen(file) - 1] != '/') )
     {
 
       /* do read file start */
-      read_file_ptr = fopen(file,"r");
-      if (read_file_ptr != NULL)
+      replay_log = log_replay_open(file, replay_log_speed);
+      if (replay_log != NULL)
       {
-        read_file = 1;
+        replay_log_started = log_replay_clock();
+        replay_status_time = sec_now();
+        replay_status_packets = 0;
       }
       else
       {
@@ -24412,7 +24648,22 @@ void read_file_selection_now(Widget w, XtPointer clientData, XtPointer callData)
   read_file_selection_destroy_shell(w, clientData, callData);
 
   // Note that we leave the file in the "open" state.  UpdateTime
-  // comes along shortly and reads the file.
+  // comes along shortly and plays it back.
+}
+
+
+
+
+
+static void replay_speed_toggle( Widget UNUSED(widget), XtPointer clientData, XtPointer callData)
+{
+  char *which = (char *)clientData;
+
+  XmToggleButtonCallbackStruct *state = (XmToggleButtonCallbackStruct *)callData;
+  if (state->set)
+  {
+    replay_log_speed = atof(which);
+  }
 }
 
 
@@ -24425,6 +24676,7 @@ void Read_File_Selection( Widget UNUSED(w), XtPointer UNUSED(clientData), XtPoin
   register unsigned int ac = 0;           /* Arg Count */
   Widget fs;
   Widget child;
+  Widget frame, speed_box, speed_max, speed_1, speed_10, speed_60;
   char temp_base_dir[MAX_VALUE];
 
   if (read_selection_dialog!=NULL)
@@ -24513,6 +24765,73 @@ void Read_File_Selection( Widget UNUSED(w), XtPointer UNUSED(clientData), XtPoin
     child = XmFileSelectionBoxGetChild(read_selection_dialog, XmDIALOG_HELP_BUTTON);
     XtVaSetValues(child,XmNfontList,fontlist1,NULL);
 
+    // Playback speed
+    frame = XtVaCreateManagedWidget("Read_File_Selection frame",
+                                    xmFrameWidgetClass,
+                                    read_selection_dialog,
+                                    XmNbackground, MY_BG_COLOR,
+                                    NULL);
+
+    XtVaCreateManagedWidget(langcode("WPUPRPL001"),xmLabelWidgetClass, frame,
+                            XmNchildType, XmFRAME_TITLE_CHILD,
+                            XmNbackground, MY_BG_COLOR,
+                            XmNfontList, fontlist1,
+                            NULL);
+
+    ac=0;
+    XtSetArg(al[ac], XmNbackground, MY_BG_COLOR);
+    ac++;
+
+    speed_box = XmCreateRadioBox(frame,"Read_File_Selection speed_box",al,ac);
+    XtVaSetValues(speed_box,XmNnumColumns,4,NULL);
+
+    speed_max = XtVaCreateManagedWidget(langcode("WPUPRPL002"),xmToggleButtonGadgetClass,
+                                        speed_box,
+                                        XmNbackground, MY_BG_COLOR,
+                                        XmNfontList, fontlist1,
+                                        NULL);
+    XtAddCallback(speed_max,XmNvalueChangedCallback,replay_speed_toggle,"0");
+
+    speed_1 = XtVaCreateManagedWidget(langcode("WPUPRPL003"),xmToggleButtonGadgetClass,
+                                      speed_box,
+                                      XmNbackground, MY_BG_COLOR,
+                                      XmNfontList, fontlist1,
+                                      NULL);
+    XtAddCallback(speed_1,XmNvalueChangedCallback,replay_speed_toggle,"1");
+
+    speed_10 = XtVaCreateManagedWidget(langcode("WPUPRPL004"),xmToggleButtonGadgetClass,
+                                       speed_box,
+                                       XmNbackground, MY_BG_COLOR,
+                                       XmNfontList, fontlist1,
+                                       NULL);
+    XtAddCallback(speed_10,XmNvalueChangedCallback,replay_speed_toggle,"10");
+
+    speed_60 = XtVaCreateManagedWidget(langcode("WPUPRPL005"),xmToggleButtonGadgetClass,
+                                       speed_box,
+                                       XmNbackground, MY_BG_COLOR,
+                                       XmNfontList, fontlist1,
+                                       NULL);
+    XtAddCallback(speed_60,XmNvalueChangedCallback,replay_speed_toggle,"60");
+
+    if (replay_log_speed >= 60)
+    {
+      XmToggleButtonSetState(speed_60,TRUE,FALSE);
+    }
+    else if (replay_log_speed >= 10)
+    {
+      XmToggleButtonSetState(speed_10,TRUE,FALSE);
+    }
+    else if (replay_log_speed > 0)
+    {
+      XmToggleButtonSetState(speed_1,TRUE,FALSE);
+    }
+    else
+    {
+      XmToggleButtonSetState(speed_max,TRUE,FALSE);
+    }
+
+    XtManageChild(speed_box);
+
     XtAddCallback(read_selection_dialog, XmNcancelCallback,read_file_selection_destroy_shell,read_selection_dialog);
     XtAddCallback(read_selection_dialog, XmNokCallback,read_file_selection_now,read_selection_dialog);
 
@@ -30547,6 +30866,28 @@ int main(int argc, char *argv[], char *envp[])
     }
   }
 
+  if (filethere(get_user_base_dir("shp_index", temp_base_dir, sizeof(temp_base_dir))) != 1)
+  {
+    fprintf(stderr,"Making shp_index dir\n");
+    if (mkdir(get_user_base_dir("shp_index", temp_base_dir, sizeof(temp_base_dir)),S_IRWXU) !=0 )
+    {
+      fprintf(stderr,"Fatal error making user dir '%s':\n\t%s \n",
+              get_user_base_dir("shp_index", temp_base_dir, sizeof(temp_base_dir)), strerror(errno) );
+      exit(errno);
+    }
+  }
+
+  if (filethere(get_user_base_dir("raster_pyramid", temp_base_dir, sizeof(temp_base_dir))) != 1)
+  {
+    fprintf(stderr,"Making raster_pyramid dir\n");
+    if (mkdir(get_user_base_dir("raster_pyramid", temp_base_dir, sizeof(temp_base_dir)),S_IRWXU) !=0 )
+    {
+      fprintf(stderr,"Fatal error making user dir '%s':\n\t%s \n",
+              get_user_base_dir("raster_pyramid", temp_base_dir, sizeof(temp_base_dir)), strerror(errno) );
+      exit(errno);
+    }
+  }
+
 
   /* done checking user dirs */
 
@@ -30569,7 +30910,7 @@ int main(int argc, char *argv[], char *envp[])
   // initialize interfaces
   init_critical_section(&port_data_lock);   // Protects the port_data[] array of structs
   init_critical_section(&output_data_lock); // Protects interface.c:channel_data() function only
-  init_critical_section(&data_lock);        // Protects global incoming_data_queue
+  init_critical_section(&data_lock);        // Protects incoming_queue[] pointers if no atomic builtins
   init_critical_section(&connect_lock);     // Protects port_data[].thread_status and port_data[].connect_status
 // We should probably protect redraw_on_new_data, alert_redraw_on_update, and
 // redraw_on_new_packet_data variables as well?
@@ -30650,8 +30991,7 @@ int main(int argc, char *argv[], char *envp[])
   // standard igating rules should apply from there.
   if (enable_server_port)
   {
-    tcp_server_pid = Fork_TCP_server(my_argc, my_argv, my_envp);
-    udp_server_pid = Fork_UDP_server(my_argc, my_argv, my_envp);
+    spider_server_pid = Fork_spider_server(my_argc, my_argv, my_envp);
   }
 
 
@@ -30846,6 +31186,11 @@ int main(int argc, char *argv[], char *envp[])
       reload_tactical_calls();
 
 
+      // Bring back the stations and messages we had when we
+      // last shut down.
+      load_station_snapshot();
+
+
 //fprintf(stderr,"***create_appshell\n");
 
 
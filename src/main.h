@@ -261,6 +261,7 @@ extern int current_trail_color;
 extern int english_units;
 extern int do_dbstatus;
 extern int redraw_on_new_data;
+extern int packet_drain_time;
 extern int redo_list;
 extern int operate_as_an_igate;
 
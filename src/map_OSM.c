@@ -73,8 +73,11 @@
 #include "map_cache.h"
 
 #include "tile_mgmnt.h"
+#include "track_gui.h"
 #include "dlm.h"
 #include "map_OSM.h"
+#include "cache_utils.h"
+#include "tile_cache.h"
 
 #ifdef HAVE_MAGICK
   #if HAVE_SYS_TIME_H
@@ -266,6 +269,12 @@ unsigned int osm_zoom_level(long scale_x)
 } // osm_zoom_level()
 
 
+// Megabytes of decoded tiles kept in memory, 0 to decode every time
+int osm_tile_cache_mb = 64;
+
+// Download tiles around the view in the background
+int osm_tile_prefetch = 1;
+
 static KeySym OptimizeKey = 0;
 static KeySym ReportScaleKey = 0;
 
@@ -298,6 +307,164 @@ void set_OSM_report_scale_key(KeySym key)
   return;
 }
 
+// Last known position and motion of the tracked station, for
+// prefetching tiles ahead of it.  Set by track_station().
+static struct
+{
+  int valid;
+  long coord_lat;
+  long coord_lon;
+  int course;                     // degrees true
+  int speed;                      // knots
+  time_t time;
+} OSM_track_hint;
+
+#define OSM_TRACK_HINT_AGE    600 // Seconds a track hint is good for
+#define OSM_TRACK_AHEAD_MIN    15 // Minutes to look ahead of a tracked station
+#define OSM_TRACK_AHEAD_STEPS  32 // Most points to prefetch around along the way
+
+void set_OSM_prefetch_track(long coord_lat, long coord_lon, int course, int speed)
+{
+  OSM_track_hint.valid = 1;
+  OSM_track_hint.coord_lat = coord_lat;
+  OSM_track_hint.coord_lon = coord_lon;
+  OSM_track_hint.course = course;
+  OSM_track_hint.speed = speed;
+  OSM_track_hint.time = sec_now();
+}
+
+#ifdef HAVE_MAGICK
+/**********************************************************
+ * OSM_prefetch_area() - queue the tiles x0..x1, y0..y1 at zoom
+ * level osm_zl for prefetch, clipped to the world and leaving
+ * out those inside "skip" (may be NULL).
+ **********************************************************/
+static void OSM_prefetch_area(char *serverURL, char *tileRootDir, char *tileExt,
+                              int osm_zl, long x0, long x1, long y0, long y1,
+                              tileArea_t *skip)
+{
+  long ntiles = 1L << osm_zl;
+  long x, y;
+
+  x0 = (x0 < 0) ? 0 : x0;
+  y0 = (y0 < 0) ? 0 : y0;
+  x1 = (x1 >= ntiles) ? ntiles - 1 : x1;
+  y1 = (y1 >= ntiles) ? ntiles - 1 : y1;
+  if (x1 < x0 || y1 < y0)
+  {
+    return;
+  }
+
+  mkOSMmapDirs(tileRootDir, x0, x1, osm_zl);
+  for (x = x0; x <= x1; x++)
+  {
+    for (y = y0; y <= y1; y++)
+    {
+      if (skip && x >= (long)skip->startx && x <= (long)skip->endx
+          && y >= (long)skip->starty && y <= (long)skip->endy)
+      {
+        continue;
+      }
+      DLM_queue_prefetch_tile(serverURL, x, y, osm_zl, tileRootDir, tileExt);
+    }
+  }
+}
+
+/**********************************************************
+ * OSM_prefetch_tiles() - queue tiles we'll probably want next
+ * for background download: the ring around the view, the view
+ * one zoom level in and out, and the way ahead of a tracked
+ * station.  Prefetches still waiting from the last view are
+ * dropped first.  Queued least likely first, as the download
+ * manager starts with the most recently queued.
+ **********************************************************/
+static void OSM_prefetch_tiles(char *serverURL, char *tileRootDir, char *tileExt,
+                               int osm_zl, tileArea_t *view)
+{
+  double center_lon, center_lat, half_lon, half_lat;
+  tileArea_t area;
+
+  DLM_queue_abort_prefetch();
+  if (!osm_tile_prefetch)
+  {
+    return;
+  }
+
+  center_lon = (f_NW_corner_longitude + f_SE_corner_longitude) / 2.0;
+  center_lat = (f_NW_corner_latitude + f_SE_corner_latitude) / 2.0;
+  half_lon = (f_SE_corner_longitude - f_NW_corner_longitude) / 2.0;
+  half_lat = (f_NW_corner_latitude - f_SE_corner_latitude) / 2.0;
+
+  // Zooming out shows twice the area around the center
+  if (osm_zl > 0)
+  {
+    calcTileArea(center_lon - 2.0 * half_lon, center_lat + 2.0 * half_lat,
+                 center_lon + 2.0 * half_lon, center_lat - 2.0 * half_lat,
+                 osm_zl - 1, &area);
+    OSM_prefetch_area(serverURL, tileRootDir, tileExt, osm_zl - 1,
+                      area.startx, area.endx, area.starty, area.endy, NULL);
+  }
+
+  // Zooming in shows the middle half
+  if (osm_zl < MAX_OSM_ZOOM_LEVEL)
+  {
+    calcTileArea(center_lon - half_lon / 2.0, center_lat + half_lat / 2.0,
+                 center_lon + half_lon / 2.0, center_lat - half_lat / 2.0,
+                 osm_zl + 1, &area);
+    OSM_prefetch_area(serverURL, tileRootDir, tileExt, osm_zl + 1,
+                      area.startx, area.endx, area.starty, area.endy, NULL);
+  }
+
+  // One tile all around the view, for panning
+  OSM_prefetch_area(serverURL, tileRootDir, tileExt, osm_zl,
+                    (long)view->startx - 1, (long)view->endx + 1,
+                    (long)view->starty - 1, (long)view->endy + 1, view);
+
+  // Where the tracked station is heading, farthest first
+  if (track_station_on && OSM_track_hint.valid && OSM_track_hint.speed > 0
+      && sec_now() - OSM_track_hint.time < OSM_TRACK_HINT_AGE)
+  {
+    float f_lon, f_lat;
+    double ahead, d_lat, d_lon, tile_deg;
+    tileNum_t tile;
+    int steps, i;
+
+    if (convert_from_xastir_coordinates(&f_lon, &f_lat,
+                                        OSM_track_hint.coord_lon, OSM_track_hint.coord_lat))
+    {
+      // Degrees of latitude covered, at most two views' worth
+      ahead = OSM_track_hint.speed * OSM_TRACK_AHEAD_MIN / 60.0 / 60.0;
+      if (ahead > 4.0 * half_lat)
+      {
+        ahead = 4.0 * half_lat;
+      }
+      d_lat = ahead * cos(OSM_track_hint.course * M_PI / 180.0);
+      d_lon = ahead * sin(OSM_track_hint.course * M_PI / 180.0)
+              / cos(f_lat * M_PI / 180.0);
+
+      // A point every half tile
+      tile_deg = 360.0 / (1L << osm_zl);
+      steps = (int)ceil(((fabs(d_lat) > fabs(d_lon)) ? fabs(d_lat) : fabs(d_lon))
+                        / (tile_deg / 2.0));
+      if (steps > OSM_TRACK_AHEAD_STEPS)
+      {
+        steps = OSM_TRACK_AHEAD_STEPS;
+      }
+      for (i = steps; i > 0; i--)
+      {
+        latLon2tileNum(f_lon + d_lon * i / steps, f_lat + d_lat * i / steps,
+                       osm_zl, &tile);
+        OSM_prefetch_area(serverURL, tileRootDir, tileExt, osm_zl,
+                          (long)tile.x - 1, (long)tile.x + 1,
+                          (long)tile.y - 1, (long)tile.y + 1, view);
+      }
+    }
+  }
+
+  DLM_do_transfers();
+}
+#endif  // HAVE_MAGICK
+
 #ifdef HAVE_MAGICK
 static void get_OSM_local_file(char * local_filename, char * fileimg)
 {
@@ -719,38 +886,22 @@ static void draw_image(
 
 
 /**********************************************************
- * render_OSM_image_pixels() - internal helper: write one decoded image's
- * pixels into a caller-supplied XImage buffer (no ownership, no XPutImage).
- * Called by both draw_OSM_image() (single image) and draw_OSM_tiles()
- * (shared buffer for all tiles) so that the X server round-trips for
- * XGetImage and XPutImage happen exactly once per redraw, not once per tile.
+ * OSM_image_to_tile() - internal helper: convert a decoded image to the
+ * X pixel value of each pixel, ready to be stored in the tile cache and
+ * drawn with render_OSM_tile_pixels().  Matte and transparent pixels
+ * are marked as not drawn.  Returns NULL if the pixels can't be had.
  **********************************************************/
-static void render_OSM_image_pixels(
+static tile_cache_tile *OSM_image_to_tile(
   Widget w,
   Image *image,
-  ExceptionInfo *except_ptr,
-  tiepoint *tpNW,
-  tiepoint *tpSE,
-  int osm_zl,
-  XImage *ximg)    // XImage to write into; may be NULL (fallback to X11 calls)
+  ExceptionInfo *except_ptr)
 {
   int l;
   XColor my_colors[256];
   PixelPacket *pixel_pack;
   PixelPacket temp_pack;
   IndexPacket *index_pack;
-  long map_image_row;
-  long map_image_col;
-  long map_x_min, map_x_max;      // map boundaries for in screen part of map
-  long map_y_min, map_y_max;
-  int map_seen = 0;
-  int map_act;
-  int map_done;
-
-  long scr_x,  scr_y;             // screen pixel plot positions
-  long scr_xp, scr_yp;            // previous screen plot positions
-  int  scr_dx, scr_dy;            // increments in screen plot positions
-  unsigned long fill_pixel = 0;   // pixel value accumulated before writing
+  tile_cache_tile *tile;
 
   //if (debug_level & 512)
   //    fprintf(stderr,"Color depth is %i \n", (int)image->depth);
@@ -786,7 +937,7 @@ static void render_OSM_image_pixels(
   if (!pixel_pack)
   {
     fprintf(stderr,"pixel_pack == NULL!!!");
-    return;
+    return(NULL);
   }
 
 #if defined(HAVE_GRAPHICSMAGICK)
@@ -801,7 +952,7 @@ static void render_OSM_image_pixels(
   if (image->storage_class == PseudoClass && !index_pack)
   {
     fprintf(stderr,"PseudoClass && index_pack == NULL!!!");
-    return;
+    return(NULL);
   }
 
 
@@ -858,6 +1009,94 @@ static void render_OSM_image_pixels(
     }
   }
 
+  tile = tile_cache_tile_new((int)image->columns, (int)image->rows);
+  if (!tile)
+  {
+    return(NULL);
+  }
+
+  for (l = 0; l < (int)(image->columns * image->rows); l++)
+  {
+    if (image->storage_class == PseudoClass)
+    {
+      // Make matte transparent by skipping pixels
+      if (xastirColorsMatch(pixel_pack[l],image->matte_color))
+      {
+        continue;
+      }
+      tile->pixel[l] = (uint32_t)my_colors[(int)index_pack[l]].pixel;
+    }
+    else
+    {
+      // Skip transparent pixels and make matte
+      // colored pixels transparent (by skipping)
+      if ((pixel_pack[l].opacity == TransparentOpacity)
+          || (xastirColorsMatch(pixel_pack[l], image->matte_color)))
+      {
+        continue;
+      }
+
+      // It is not safe to assume that the red/green/blue
+      // elements of pixel_pack of type Quantum are the
+      // same as the red/green/blue of an XColor!
+      if (QuantumDepth==16)
+      {
+        my_colors[0].red=pixel_pack[l].red;
+        my_colors[0].green=pixel_pack[l].green;
+        my_colors[0].blue=pixel_pack[l].blue;
+      }
+      else   // QuantumDepth=8
+      {
+        // shift the bits of the 8-bit quantity so that
+        // they become the high bigs of my_colors.*
+        my_colors[0].red=pixel_pack[l].red*256;
+        my_colors[0].green=pixel_pack[l].green*256;
+        my_colors[0].blue=pixel_pack[l].blue*256;
+      }
+      // NOW my_colors has the right r,g,b range for
+      // pack_pixel_bits
+      pack_pixel_bits(my_colors[0].red * raster_map_intensity,
+                      my_colors[0].green * raster_map_intensity,
+                      my_colors[0].blue * raster_map_intensity,
+                      &my_colors[0].pixel);
+      tile->pixel[l] = (uint32_t)my_colors[0].pixel;
+    }
+    tile->drawn[l] = 1;
+  }
+
+  return(tile);
+}  // end OSM_image_to_tile()
+
+
+/**********************************************************
+ * render_OSM_tile_pixels() - internal helper: write one converted image's
+ * pixels into a caller-supplied XImage buffer (no ownership, no XPutImage).
+ * Called by both draw_OSM_image() (single image) and draw_OSM_tiles()
+ * (shared buffer for all tiles) so that the X server round-trips for
+ * XGetImage and XPutImage happen exactly once per redraw, not once per tile.
+ **********************************************************/
+static void render_OSM_tile_pixels(
+  Widget w,
+  tile_cache_tile *tile,
+  tiepoint *tpNW,
+  tiepoint *tpSE,
+  int osm_zl,
+  XImage *ximg)    // XImage to write into; may be NULL (fallback to X11 calls)
+{
+  int l;
+  long map_image_row;
+  long map_image_col;
+  long map_x_min, map_x_max;      // map boundaries for in screen part of map
+  long map_y_min, map_y_max;
+  int map_seen = 0;
+  int map_act;
+  int map_done;
+
+  long scr_x,  scr_y;             // screen pixel plot positions
+  long scr_xp, scr_yp;            // previous screen plot positions
+  int  scr_dx, scr_dy;            // increments in screen plot positions
+  unsigned long fill_pixel = 0;   // pixel value accumulated before writing
+
   /*
   * Here are the corners of our viewport, using the Xastir
   * coordinate system.  Notice that Y is upside down:
@@ -882,7 +1121,7 @@ static void render_OSM_image_pixels(
 
   // calculate map pixel range in y direction that falls into screen area
   map_y_min = map_y_max = 0l;
-  for (map_image_row = 0; map_image_row < (long)image->rows; map_image_row++)
+  for (map_image_row = 0; map_image_row < (long)tile->height; map_image_row++)
   {
     scr_y = (pixelLat2xastirLat(map_image_row + tpNW->y_lat, osm_zl) - NW_corner_latitude) / scale_y;
     if (scr_y > 0)
@@ -904,7 +1143,7 @@ static void render_OSM_image_pixels(
 
   // Calculate the position of the map image relative to the screen
   map_x_min = map_x_max = 0l;
-  for (map_image_col = 0; map_image_col < (long)image->columns; map_image_col++)
+  for (map_image_col = 0; map_image_col < (long)tile->width; map_image_col++)
   {
     scr_x = (pixelLon2xastirLon(map_image_col + tpNW->x_long, osm_zl) - NW_corner_longitude) / scale_x;
     if (scr_x > 0)
@@ -986,51 +1225,13 @@ static void render_OSM_image_pixels(
             map_act = 1;   // detects blank screen rows (end of map)
 
             // now copy a pixel from the map image to the screen
-            l = map_image_col + map_image_row * image->columns;
-            if (image->storage_class == PseudoClass)
+            l = map_image_col + map_image_row * tile->width;
+            if (!tile->drawn[l])
             {
-              // Make matte transparent by skipping pixels
-              if (xastirColorsMatch(pixel_pack[l],image->matte_color))
-              {
-                continue;
-              }
-              fill_pixel = my_colors[(int)index_pack[l]].pixel;
+              continue;
             }
-            else
-            {
-              // Skip transparent pixels and make matte
-              // colored pixels transparent (by skipping)
-              if ((pixel_pack[l].opacity == TransparentOpacity)
-                  || (xastirColorsMatch(pixel_pack[l], image->matte_color)))
-              {
-                continue;
-              }
+            fill_pixel = tile->pixel[l];
 
-              // It is not safe to assume that the red/green/blue
-              // elements of pixel_pack of type Quantum are the
-              // same as the red/green/blue of an XColor!
-              if (QuantumDepth==16)
-              {
-                my_colors[0].red=pixel_pack[l].red;
-                my_colors[0].green=pixel_pack[l].green;
-                my_colors[0].blue=pixel_pack[l].blue;
-              }
-              else   // QuantumDepth=8
-              {
-                // shift the bits of the 8-bit quantity so that
-                // they become the high bigs of my_colors.*
-                my_colors[0].red=pixel_pack[l].red*256;
-                my_colors[0].green=pixel_pack[l].green*256;
-                my_colors[0].blue=pixel_pack[l].blue*256;
-              }
-              // NOW my_colors has the right r,g,b range for
-              // pack_pixel_bits
-              pack_pixel_bits(my_colors[0].red * raster_map_intensity,
-                              my_colors[0].green * raster_map_intensity,
-                              my_colors[0].blue * raster_map_intensity,
-                              &my_colors[0].pixel);
-              fill_pixel = my_colors[0].pixel;
-            }
             // Write pixel(s) to the screen. Use XImage bulk transfer when
             // available to avoid per-pixel X11 round-trips (major bottleneck
             // on Raspberry Pi and slow/remote displays).
@@ -1065,6 +1266,30 @@ static void render_OSM_image_pixels(
       (void)map_done; // map_done is never used, but this takes away the compile warning.
     } // don't do a screen row twice.
   } // loop over map pixel rows
+}  // end render_OSM_tile_pixels()
+
+
+/**********************************************************
+ * render_OSM_image_pixels() - convert a decoded image and write its
+ * pixels into a caller-supplied XImage buffer, see
+ * render_OSM_tile_pixels().
+ **********************************************************/
+static void render_OSM_image_pixels(
+  Widget w,
+  Image *image,
+  ExceptionInfo *except_ptr,
+  tiepoint *tpNW,
+  tiepoint *tpSE,
+  int osm_zl,
+  XImage *ximg)
+{
+  tile_cache_tile *tile = OSM_image_to_tile(w, image, except_ptr);
+
+  if (tile)
+  {
+    render_OSM_tile_pixels(w, tile, tpNW, tpSE, osm_zl, ximg);
+    tile_cache_tile_free(tile);
+  }
 }  // end render_OSM_image_pixels()
 
 
@@ -1148,6 +1373,11 @@ void draw_OSM_tiles (Widget w,
   char tmpString[MAX_TMPSTRING];
 
   char temp_file_path[MAX_VALUE];
+  struct stat tile_stat;
+  tile_cache_tile *cached;
+  uint32_t tile_variant;
+  int tiles_cached = 0;
+  int tiles_decoded = 0;
 
   // Check whether we're indexing or drawing the map
   if ( (destination_pixmap == INDEX_CHECK_TIMESTAMPS)
@@ -1286,6 +1516,12 @@ void draw_OSM_tiles (Widget w,
   {
     interrupted = 1;
   }
+  else
+  {
+    // Then whatever we'll probably want next, at low priority
+    OSM_prefetch_tiles(serverURL, tileRootDir,
+                       tileExt[0] != '\0' ? tileExt : "png", osm_zl, &tiles);
+  }
 
   if (interrupted != 1)
   {
@@ -1364,8 +1600,13 @@ void draw_OSM_tiles (Widget w,
 
     tile_info = CloneImageInfo((ImageInfo *)NULL);
 
+    // Cached tiles hold X pixel values, which depend on the intensity
+    tile_cache_set_budget((size_t)osm_tile_cache_mb * 1024 * 1024);
+    tile_variant = fnv1a_hash(FNV1A_INIT, &raster_map_intensity, sizeof(raster_map_intensity));
+
     // Decode and render each tile directly into the shared XImage.
     // One XGetImage + N render passes + one XPutImage = fast.
+    // Tiles decoded earlier in the session come from the tile cache.
     for (col = tiles.starty; col <= tiles.endy; col++)
     {
       for (row = tiles.startx; row <= tiles.endx; row++)
@@ -1385,43 +1626,86 @@ void draw_OSM_tiles (Widget w,
           xastir_snprintf(tmpString, sizeof(tmpString),
                           "%s/%d/%u/%u.%s", tileRootDir, osm_zl, row, col,
                           tileExt[0] != '\0' ? tileExt : "png");
-          strncpy(tile_info->filename, tmpString, MaxTextExtent);
+          if (stat(tmpString, &tile_stat) != 0)
+          {
+            continue;   // Not downloaded (yet)
+          }
 
-          tile = ReadImage(tile_info, &exception);
+          // Already decoded this session?
+          cached = NULL;
+          if (osm_tile_cache_mb > 0)
+          {
+            cached = tile_cache_get(serverURL, osm_zl, row, col,
+                                    tile_stat.st_mtime, tile_stat.st_size, tile_variant);
+          }
 
-          if (exception.severity != UndefinedException)
+          if (!cached)
           {
-            if (exception.severity == FileOpenError)
+            strncpy(tile_info->filename, tmpString, MaxTextExtent);
+
+            tile = ReadImage(tile_info, &exception);
+
+            if (exception.severity != UndefinedException)
             {
+              if (exception.severity == FileOpenError)
+              {
 #if !defined(HAVE_GRAPHICSMAGICK)
-              ClearMagickException(&exception);
+                ClearMagickException(&exception);
 #endif
-            }
-            else
-            {
-              if (debug_level & 512)
-              {
-                fprintf(stderr, "%s NOT removed.\n", tmpString);
               }
               else
               {
-                fprintf(stderr, "Removing %s\n", tmpString);
-                unlink(tmpString);
+                if (debug_level & 512)
+                {
+                  fprintf(stderr, "%s NOT removed.\n", tmpString);
+                }
+                else
+                {
+                  fprintf(stderr, "Removing %s\n", tmpString);
+                  unlink(tmpString);
+                }
+                CatchException(&exception);
+              }
+              GetExceptionInfo(&exception);
+            }
+
+            if (tile)
+            {
+              cached = OSM_image_to_tile(w, tile, &exception);
+              DestroyImage(tile);
+              tile = NULL;
+              tiles_decoded++;
+              if (cached && osm_tile_cache_mb > 0)
+              {
+                cached = tile_cache_add(serverURL, osm_zl, row, col,
+                                        tile_stat.st_mtime, tile_stat.st_size, tile_variant,
+                                        cached);
               }
-              CatchException(&exception);
             }
-            GetExceptionInfo(&exception);
+          }
+          else
+          {
+            tiles_cached++;
           }
 
-          if (tile)
+          if (cached)
           {
-            render_OSM_image_pixels(w, tile, &exception, &tpTileNW, &tpTileSE, osm_zl,
-                                    shared_ximg);
-            DestroyImage(tile);
+            render_OSM_tile_pixels(w, cached, &tpTileNW, &tpTileSE, osm_zl,
+                                   shared_ximg);
+            if (osm_tile_cache_mb <= 0)
+            {
+              tile_cache_tile_free(cached);
+            }
           }
         }
       }
 
+    if (debug_level & 512)
+    {
+      fprintf(stderr, "OSM tiles: %d cached, %d decoded, cache %lu KB\n",
+              tiles_cached, tiles_decoded, (unsigned long)(tile_cache_bytes() / 1024));
+    }
+
     // Flush all tiles to the pixmap in one bulk X11 transfer
     if (shared_ximg)
     {
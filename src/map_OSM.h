@@ -49,11 +49,15 @@ void draw_OSM_tiles(Widget w,
                     char *mapName,
                     char *tileExt);
 
+extern int osm_tile_cache_mb;
+extern int osm_tile_prefetch;
+
 unsigned int osm_zoom_level(long scale_x);
 void init_OSM_values(void);
 int OSM_optimize_key(KeySym key);
 void set_OSM_optimize_key(KeySym key);
 int OSM_report_scale_key(KeySym key);
 void set_OSM_report_scale_key(KeySym key);
+void set_OSM_prefetch_track(long coord_lat, long coord_lon, int course, int speed);
 
 #endif //OSM_H
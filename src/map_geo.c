@@ -61,6 +61,7 @@
 #include "globals.h"
 #include "maps.h"
 #include "map_cache.h"
+#include "cache_utils.h"
 #include "alert.h"
 #include "fetch_remote.h"
 #include "util.h"
@@ -283,6 +284,146 @@ int check_trans (XColor c, transparent_color_record *c_trans_color_head)
 
 
 
+#ifdef HAVE_MAGICK
+// What geo_pyramid_row() needs to copy an image into level 0 of its
+// pyramid.
+typedef struct
+{
+  Image *image;
+  PixelPacket *pixel_pack;
+  IndexPacket *index_pack;    // NULL unless PseudoClass
+} geo_pyramid_fill;
+
+
+
+
+
+// Fill one row of pyramid level 0 with the image pixels as 0xAARRGGBB,
+// after the gamma and other adjustments from the .geo file and before
+// raster_map_intensity.  Cropped pixels (non-zero opacity) become
+// transparent.
+//
+static int geo_pyramid_row(void *data, int row, uint8_t *pixels)
+{
+  geo_pyramid_fill *fill = (geo_pyramid_fill *)data;
+  PixelPacket color;
+  uint32_t value;
+  long l;
+  int x;
+
+
+  for (x = 0; x < (int)fill->image->columns; x++)
+  {
+    l = x + row * (long)fill->image->columns;
+
+    if (fill->pixel_pack[l].opacity != 0)
+    {
+      value = 0;
+    }
+    else
+    {
+      color = (fill->index_pack) ? fill->image->colormap[(int)fill->index_pack[l]] : fill->pixel_pack[l];
+      if (QuantumDepth == 16)
+      {
+        value = 0xff000000
+                | ((uint32_t)(color.red >> 8) << 16)
+                | ((uint32_t)(color.green >> 8) << 8)
+                | (uint32_t)(color.blue >> 8);
+      }
+      else    // QuantumDepth = 8
+      {
+        value = 0xff000000
+                | ((uint32_t)color.red << 16)
+                | ((uint32_t)color.green << 8)
+                | (uint32_t)color.blue;
+      }
+    }
+    memcpy(pixels + x * 4, &value, 4);
+  }
+  return(0);
+}
+
+
+
+
+
+// Whether a pyramid pixel is one of the transparent colors from the
+// .geo file, be it before or after raster_map_intensity is applied.
+//
+static int geo_pyramid_skip(void *data, uint32_t value)
+{
+  raster_pyramid_colors *colors = (raster_pyramid_colors *)data;
+  XColor color;
+
+
+  pack_pixel_bits(((value >> 16) & 0xff) * 256,
+                  ((value >> 8) & 0xff) * 256,
+                  (value & 0xff) * 256,
+                  &color.pixel);
+  if (check_trans(color, trans_color_head))
+  {
+    return(1);
+  }
+
+  color.pixel = colors->red_pixel[(value >> 16) & 0xff]
+                | colors->green_pixel[(value >> 8) & 0xff]
+                | colors->blue_pixel[value & 0xff];
+  return(check_trans(color, trans_color_head));
+}
+
+
+
+
+
+// Draw a .geo map from its raster pyramid, then free the pyramid.
+//
+static void draw_geo_pyramid(Widget w, char *file, raster_pyramid *pyramid, int built)
+{
+  raster_pyramid_colors colors;
+  int level;
+
+
+  memset(&colors, 0, sizeof(colors));
+  raster_pyramid_rgb_colors(&colors, raster_map_intensity);
+  if (trans_color_head)
+  {
+    colors.skip_rgb = geo_pyramid_skip;
+    colors.skip_data = &colors;
+  }
+
+  level = draw_raster_pyramid(w, gc, pyramid, &colors);
+
+  if (debug_level & 16)
+  {
+    fprintf(stderr,"draw_geo_pyramid: %s pyramid level %d%s\n",
+            file,
+            level,
+            (built) ? ", built" : "");
+  }
+
+  raster_pyramid_free(pyramid);
+
+  if (level < 0)
+  {
+    // Interrupted.  Update to screen
+    (void)XCopyArea(XtDisplay(da),
+                    pixmap,
+                    XtWindow(da),
+                    gc,
+                    0,
+                    0,
+                    (unsigned int)screen_width,
+                    (unsigned int)screen_height,
+                    0,
+                    0);
+  }
+}
+#endif  // HAVE_MAGICK
+
+
+
+
+
 // Regarding MAP CACHING for toporama maps:  Here we are only
 // snagging a .geo file for toporama from findu.com:  We send the
 // parameters off to findu.com, it computes the .geo file, we
@@ -676,8 +817,18 @@ void draw_geo_image_map (Widget w,
 #endif //FUZZYRASTER
   unsigned long temp_trans_color;    // what color to zap
   int trans_skip = 0;  // skip transparent pixel
+  unsigned long fill_pixel = 0;      // color of the current pixel
+  map_image map_ximage;              // screen image the pixels go into
   int crop_x1=0, crop_x2=0, crop_y1=0, crop_y2=0; // pixel crop box
   int do_crop = 0;     // do we crop pixels
+#ifdef HAVE_MAGICK
+  int use_pyramid = 0;            // Draw from a raster pyramid
+  raster_pyramid *pyramid;
+  char geo_file[MAX_FILENAME];
+  char pyramid_path[MAX_FILENAME];
+  uint32_t pyramid_variant = 0;
+  struct stat geo_stat, image_stat;
+#endif  // HAVE_MAGICK
   //#define TIMING_DEBUG
 #ifdef TIMING_DEBUG
   time_mark(1);
@@ -1980,6 +2131,39 @@ void draw_geo_image_map (Widget w,
   // getting the map in this thread and aren't redrawing?
 
 #ifdef HAVE_MAGICK
+  // Local maps are drawn from their raster pyramid, which is built
+  // from the image the first time.  Not for remote maps, which change,
+  // nor for the Transverse Mercator correction, which isn't north-up,
+  // nor for displays where each color has to be allocated.  The
+  // pyramid is named after the .geo file, as that has the tiepoints
+  // and the image adjustments.
+  xastir_snprintf(geo_file, sizeof(geo_file), "%s/%s", dir, filenm);
+  if (!terraserver_flag
+      && strncasecmp ("http", fileimg, 4) != 0
+      && strncasecmp ("ftp", fileimg, 3) != 0
+      && map_proj != 1
+      && visual_type != NOT_TRUE_NOR_DIRECT
+      && stat(geo_file, &geo_stat) == 0
+      && stat(file, &image_stat) == 0)
+  {
+    int64_t geo_mtime = geo_stat.st_mtime;
+    int64_t geo_size = geo_stat.st_size;
+
+    pyramid_variant = fnv1a_hash(FNV1A_INIT, &geo_mtime, sizeof(geo_mtime));
+    pyramid_variant = fnv1a_hash(pyramid_variant, &geo_size, sizeof(geo_size));
+    pyramid_variant = fnv1a_hash(pyramid_variant, &imagemagick_gamma_adjust,
+                      sizeof(imagemagick_gamma_adjust));
+
+    pyramid = get_raster_pyramid(geo_file, &image_stat, pyramid_variant,
+                                 pyramid_path, sizeof(pyramid_path));
+    if (pyramid)
+    {
+      draw_geo_pyramid(w, file, pyramid, 0);
+      return;
+    }
+    use_pyramid = (pyramid_path[0] != '\0');
+  }
+
   GetExceptionInfo(&exception);
   image_info=CloneImageInfo((ImageInfo *) NULL);
   xastir_snprintf(image_info->filename,
@@ -2477,6 +2661,40 @@ void draw_geo_image_map (Widget w,
     return;
   }
 
+  if (use_pyramid)
+  {
+    raster_pyramid_header geometry;
+    geo_pyramid_fill fill;
+
+    memset(&geometry, 0, sizeof(geometry));
+    geometry.variant = pyramid_variant;
+    geometry.width = image->columns;
+    geometry.height = image->rows;
+    geometry.bpp = 4;
+    geometry.x0 = (double)tp[0].x_long;
+    geometry.y0 = (double)tp[0].y_lat;
+    geometry.step_x = map_c_dx;
+    geometry.step_y = map_c_dy;
+
+    fill.image = image;
+    fill.pixel_pack = pixel_pack;
+    fill.index_pack = (image->storage_class == PseudoClass) ? index_pack : NULL;
+
+    pyramid = build_raster_pyramid(pyramid_path, &image_stat, &geometry, geo_pyramid_row, &fill);
+    if (pyramid)
+    {
+      DestroyImage(image);
+      if (image_info)
+      {
+        DestroyImageInfo(image_info);
+      }
+      DestroyExceptionInfo(&exception);
+
+      draw_geo_pyramid(w, file, pyramid, 1);
+      return;
+    }
+  }
+
 #ifdef TIMING_DEBUG
   time_mark(0);
 #endif  // TIMING_DEBUG
@@ -2711,6 +2929,24 @@ void draw_geo_image_map (Widget w,
   }
 
 
+  // Pixels go into an image of the part of the screen the map covers
+  // that's put back in one go at the end, rather than one
+  // XFillRectangle() each.  With the Transverse Mercator correction
+  // the map can bend out of its tiepoint rectangle, so that takes the
+  // whole screen.
+  if (map_proj == 1)
+  {
+    (void)get_map_ximage(w, &map_ximage, 0, 0, screen_width, screen_height);
+  }
+  else
+  {
+    (void)get_map_ximage(w, &map_ximage,
+                         (long)floor((double)map_c_L / scale_x) - 1,
+                         (long)floor((double)map_c_T / scale_y) - 1,
+                         (long)ceil((map_c_L + width * map_c_dx) / scale_x) + scr_dx + 1,
+                         (long)ceil((map_c_T + height * map_c_dy) / scale_y) + scr_dy + 1);
+  }
+
   // loop over map pixel rows
   for (map_y_0 = map_y_min, c_y = (double)c_y_min;
        (map_y_0 <= map_y_max) || (map_proj == 1 && !map_done && scr_y < screen_height);
@@ -2725,6 +2961,7 @@ void draw_geo_image_map (Widget w,
 #endif // HAVE_MAGICK
           &da, &pixmap, &gc, screen_width, screen_height))
     {
+      free_map_ximage(&map_ximage);
       return;
     }
 
@@ -2821,7 +3058,7 @@ void draw_geo_image_map (Widget w,
               }
               else
               {
-                XSetForeground(XtDisplay(w), gc, my_colors[(int)index_pack[l]].pixel);
+                fill_pixel = my_colors[(int)index_pack[l]].pixel;
                 trans_skip = 0; // draw it
               }
             }
@@ -2857,12 +3094,12 @@ void draw_geo_image_map (Widget w,
               }
               else
               {
-                XSetForeground(XtDisplay(w), gc, my_colors[0].pixel);
+                fill_pixel = my_colors[0].pixel;
                 trans_skip = 0; // draw it
               }
             }
 #else   // HAVE_MAGICK
-            (void)XSetForeground (XtDisplay (w), gc, XGetPixel (xi, map_x, map_y));
+            fill_pixel = XGetPixel (xi, map_x, map_y);
 #endif  // HAVE_MAGICK
 
 
@@ -2872,8 +3109,17 @@ void draw_geo_image_map (Widget w,
 #else   // HAVE_MAGICK
             if (!trans_skip)    // skip transparent
 #endif  // HAVE_MAGICK
-
-              (void)XFillRectangle (XtDisplay (w),pixmap,gc,scr_x,scr_y,scr_dx,scr_dy);
+            {
+              if (map_ximage.ximage)
+              {
+                map_ximage_fill(&map_ximage, scr_x, scr_y, scr_dx, scr_dy, fill_pixel, 0);
+              }
+              else
+              {
+                (void)XSetForeground (XtDisplay (w), gc, fill_pixel);
+                (void)XFillRectangle (XtDisplay (w),pixmap,gc,scr_x,scr_y,scr_dx,scr_dy);
+              }
+            }
           } // check map boundaries in y direction
         }
       } // loop over map pixel columns
@@ -2884,6 +3130,8 @@ void draw_geo_image_map (Widget w,
     }
   } // loop over map pixel rows
 
+  put_map_ximage(w, &map_ximage);
+
 #ifdef HAVE_MAGICK
   if (image)
   {
@@ -99,6 +99,7 @@
 
 #include <rtree/index.h>
 #include "shp_hash.h"
+#include "shp_prefetch.h"
 
 // Must be last include file
 #include "leak_detection.h"
@@ -126,6 +127,18 @@ static int *RTree_hitarray=NULL;
 int RTree_hitarray_size=0;
 int RTree_hitarray_index=0;
 
+// The shapes of the current draw that aren't cached, for the prefetch
+// threads
+static int *prefetch_list=NULL;
+static int prefetch_list_size=0;
+
+// At coarse zooms, the vertices of the shape being drawn that survive
+// simplification, from the shapefile index.  lod_object is the shape
+// they belong to, NULL to draw every vertex.
+static SHPObject *lod_object=NULL;
+static const uint32_t *lod_vertices=NULL;
+static int lod_vertex_count=0;
+
 
 //This trivial routine is used by the RTreeSearch as a callback when it finds
 // a match.
@@ -340,9 +353,9 @@ void create_shapefile_map(char *dir, char *shapefile_name, int type,
 
 // Function which creates a Shapefile map from an APRS trail.
 //
-// Navigate through the linked list of TrackRow structs to pick out
-// the lat/long and write them into arrays of floats.  We then pass
-// those arrays to create_shapefile_map().
+// Walk the station's trail points to pick out the lat/long and
+// write them into arrays of floats.  We then pass those arrays to
+// create_shapefile_map().
 //
 void create_map_from_trail(char *call_sign)
 {
@@ -358,7 +371,8 @@ void create_map_from_trail(char *call_sign)
   {
     int count;
     int ii;
-    TrackRow *ptr;
+    TrailCursor cursor;
+    TrackRow *ptr = &cursor.point;
     char temp[MAX_FILENAME];
     char temp2[MAX_FILENAME];
     double *x;
@@ -367,11 +381,9 @@ void create_map_from_trail(char *call_sign)
     char temp_base_dir[MAX_VALUE];
 
     count = 0;
-    ptr = p_station->oldest_trackpoint;
-    while (ptr != NULL)
+    if (p_station->trail != NULL)
     {
-      count++;
-      ptr = ptr->next;
+      count = p_station->trail->count;
     }
 
 //fprintf(stderr, "Quantity of points: %d\n", count);
@@ -383,7 +395,7 @@ void create_map_from_trail(char *call_sign)
       return;
     }
 
-    // We know how many points are in the linked list.  Allocate
+    // We know how many points are in the trail.  Allocate
     // arrays to hold the values.
     x = (double *) malloc( count * sizeof(double) );
     y = (double *) malloc( count * sizeof(double) );
@@ -394,9 +406,9 @@ void create_map_from_trail(char *call_sign)
 
     // Fill in the values.  We need to convert from Xastir
     // coordinate system to lat/long doubles as we go.
-    ptr = p_station->oldest_trackpoint;
+    (void)trail_first(p_station->trail, &cursor);
     ii = 0;
-    while ((ptr != NULL) && (ii < count) )
+    do
     {
 
       // Convert from Xastir coordinates to lat/long
@@ -431,9 +443,9 @@ void create_map_from_trail(char *call_sign)
 
       z[ii] = ptr->altitude;  // Altitude (meters), undefined=-99999
 
-      ptr = ptr->next;
       ii++;
     }
+    while ((ii < count) && trail_next(&cursor));
 
     // Create a Shapefile from the APRS trail.  Write it into
     // "~/.xastir/tracklogs" and add a date/timestamp to the end.
@@ -601,6 +613,8 @@ static awk_rule dbfawk_default_rules[] =
     0,
     "dbfinfo=\"\"; key=\"\"; lanes=1; color=8; fill_color=13; fill_stipple=0; name=\"\"; filled=0; fill_style=0; pattern=0; display_level=2147483647; min_display_level=0; label_level=0",
     0,
+    0,
+    NULL,
     0
   },
 };
@@ -656,6 +670,11 @@ void draw_shapefile_map (Widget w,
   struct Rect viewportRect;
   shpinfo *si;
   int nhits;
+  shp_prefetch *prefetch;
+  int prefetch_index, prefetch_count;
+  int fully_inside;
+  int cached;
+  int lod_level;
 
   // pull this out of the map_draw_flags
   draw_filled = mdf->draw_filled;
@@ -872,38 +891,44 @@ void draw_shapefile_map (Widget w,
   // We put this section AFTER the code that determines whether we're merely
   // indexing, so we don't bother to generate rtrees unless we're really
   // drawing the file.
-  si=NULL;
-
-  // Don't bother even looking at the hash if this shapefile is completely
-  // contained in the current viewport.  We'll have to read every shape
-  // in it anyway, and all we'd be doing is extra work searching the
-  // RTree
-  if (!map_inside_viewport_lat_lon(adfBndsMin[1],
-                                   adfBndsMax[1],
-                                   adfBndsMin[0],
-                                   adfBndsMax[0]))
-  {
-    // we keep a hash of all shapefiles encountered so far (and not purged
-    // due to inactivity).  Find the record of this shapefile in that
-    // hash if it's there.
-    si = get_shp_from_hash(file);
+  // Don't bother searching the index if this shapefile is completely
+  // contained in the current viewport.  We'll have to draw every shape
+  // in it anyway.
+  fully_inside = map_inside_viewport_lat_lon(adfBndsMin[1],
+                 adfBndsMax[1],
+                 adfBndsMin[0],
+                 adfBndsMax[0]);
+
+  // we keep a hash of all shapefiles encountered so far (and not purged
+  // due to inactivity).  Find the record of this shapefile in that
+  // hash if it's there.  We want it even if we won't search the index,
+  // as it also holds the cache of this file's shapes.
+  si = get_shp_from_hash(file);
+  if (!si)
+  {
+    // we don't have what we need, so generate the index and make
+    // the hashtable entry
+    add_shp_to_hash(file,hSHP); // this will index all the shapes
+    // and save the index in a
+    // shpinfo structure
+    si=get_shp_from_hash(file); // now get that structure
     if (!si)
     {
-      // we don't have what we need, so generate the index and make
-      // the hashtable entry
-      add_shp_to_hash(file,hSHP); // this will index all the shapes in
-                                  // an RTree and save the root in a
-                                  // shpinfo structure
-      si=get_shp_from_hash(file); // now get that structure
-      if (!si)
-      {
-        fprintf(stderr,
-                "Panic!  added %s, lost it already!\n",file);
-        exit(1);
-      }
+      fprintf(stderr,
+              "Panic!  added %s, lost it already!\n",file);
+      exit(1);
     }
   }
 
+  // The dbfawk results for this file are kept with it too, so
+  // records with the same field values as one already seen don't run
+  // the program again.
+  if (!si->memo)
+  {
+    si->memo = dbfawk_memo_new();
+  }
+  (void)dbfawk_memo_bind(si->memo, sig_info->prog, sig_info->file);
+
   // we need this for the rtree search
   getViewportRect(&viewportRect);
 
@@ -1065,17 +1090,16 @@ void draw_shapefile_map (Widget w,
   else    // Draw an entire Shapefile map
   {
     // if it isn't completely inside the viewport, select those shapes
-    // in the file that intersect the viewport.  si will be non null
-    // in this case.
-    if (si)
+    // in the file that intersect the viewport.
+    if (!fully_inside)
     {
       RTree_hitarray_index=0;
       // the callback will be executed every time the search finds a
       // shape whose bounding box overlaps the viewport.
       // RTree_hitarray will contain the shape numbers of every shape
       // found, nhits will be how many there are.
-      nhits = Xastir_RTreeSearch(si->root, &viewportRect,
-                                 (void *)RTreeSearchCallback, 0);
+      nhits = shp_index_search(si->index, &viewportRect,
+                               (void *)RTreeSearchCallback, 0);
     }
     else
     {
@@ -1084,6 +1108,41 @@ void draw_shapefile_map (Widget w,
     }
   }
 
+  // Have worker threads read and convert the shapes that aren't in
+  // the cache ahead of us.  prefetch stays NULL if the layer is too
+  // small to bother or the threads can't be started, in which case
+  // we read them here.
+  prefetch = NULL;
+  prefetch_count = 0;
+  prefetch_index = 0;
+  if (!weather_alert_flag
+      && nhits >= SHP_PREFETCH_MIN_SHAPES
+      && shp_prefetch_threads() > 0)
+  {
+    if (prefetch_list_size < nhits)
+    {
+      int *ptr;
+
+      ptr = realloc(prefetch_list, nhits * sizeof(int));
+      CHECKMALLOC(ptr);
+      prefetch_list = ptr;
+      prefetch_list_size = nhits;
+    }
+    for (i = 0; i < nhits; i++)
+    {
+      structure = (fully_inside) ? i : RTree_hitarray[i];
+      if (!shp_cache_has(si, structure))
+      {
+        prefetch_list[prefetch_count++] = structure;
+      }
+    }
+    prefetch = shp_prefetch_start(file, prefetch_list, prefetch_count);
+  }
+
+  // Pick the level of detail for the current pixel size.  scale_x and
+  // scale_y are in Xastir units of 1/100 second per pixel.
+  lod_level = shp_index_lod_level(((scale_x < scale_y) ? scale_x : scale_y) / 360000.0);
+
   // only iterate over the hits found by RTreeSearch, not all of them
   for (RTree_hitarray_index=0; RTree_hitarray_index<nhits;
        RTree_hitarray_index++)
@@ -1106,6 +1165,7 @@ void draw_shapefile_map (Widget w,
       HandlePendingEvents(app_context);
       if (interrupt_drawing_now)
       {
+        shp_prefetch_stop(prefetch);
         DBFClose( hDBF );   // Clean up open file descriptors
         SHPClose( hSHP );
         // Update to screen
@@ -1127,26 +1187,64 @@ void draw_shapefile_map (Widget w,
     // here's where we decide which shape number we're currently processing.
     // We're either going through all of those found by an rtree search,
     // the one that pertains to a weather alert, or all of them sequentially.
-    if (si)
+    if ((weather_alert_flag && found_shape!=-1))
     {
-      structure=RTree_hitarray[RTree_hitarray_index];
+      structure = RTree_hitarray[0];
     }
-    else if ((weather_alert_flag && found_shape!=-1))
+    else if (!fully_inside)
     {
-      structure = RTree_hitarray[0];
+      structure=RTree_hitarray[RTree_hitarray_index];
     }
     else
     {
       structure = RTree_hitarray_index;
     }
 
-    object = SHPReadObject( hSHP, structure );  // Note that each structure can have multiple rings
+    // Note that each structure can have multiple rings
+    object = shp_cache_get(si, structure);
+    cached = (object != NULL);
+    if (!cached)
+    {
+      unsigned long *xy = NULL;
+      char *xy_ok = NULL;
+
+      if (prefetch
+          && prefetch_index < prefetch_count
+          && prefetch_list[prefetch_index] == structure)
+      {
+        object = shp_prefetch_get(prefetch, prefetch_index++, &xy, &xy_ok);
+      }
+      else
+      {
+        object = SHPReadObject( hSHP, structure );
+      }
+
+      if (object != NULL)
+      {
+        cached = shp_cache_add(si, structure, object, xy, xy_ok);
+      }
+      else
+      {
+        free(xy);
+        free(xy_ok);
+      }
+    }
 
     if (object == NULL)
     {
       continue;  // Skip this iteration, go on to the next
     }
 
+    if (lod_level >= 0 && si != NULL)
+    {
+      lod_vertex_count = shp_index_lod_vertices(si->index, structure,
+                         lod_level, &lod_vertices);
+      if (lod_vertex_count > 0)
+      {
+        lod_object = object;
+      }
+    }
+
     // Fill in the boundary variables in the alert record.  We use
     // this info in load_alert_maps() to determine which alerts are
     // within our view, without having to open up the shapefiles to
@@ -1199,7 +1297,7 @@ void draw_shapefile_map (Widget w,
       }
       if (sig_info)
       {
-        dbfawk_parse_record(sig_info->prog,hDBF,fld_info,structure);
+        dbfawk_memo_parse_record(si->memo,sig_info->prog,hDBF,fld_info,structure);
         if (debug_level & 16)
         {
           fprintf(stderr,"------\n");
@@ -1652,9 +1750,15 @@ void draw_shapefile_map (Widget w,
 
       }   // End of switch
     }
-    SHPDestroyObject( object ); // Done with this structure
+    lod_object = NULL;
+    if (!cached)
+    {
+      SHPDestroyObject( object ); // Done with this structure
+    }
   }
 
+  shp_prefetch_stop(prefetch);
+
 
   // Free our hash of label strings, if any.  Each hash entry may
   // have a linked list attached below it.
@@ -1678,8 +1782,13 @@ void draw_shapefile_map (Widget w,
 
   if (debug_level & 16)
   {
+    unsigned long lookups, hits;
+
     fprintf(stderr,"High-Mark Index:%d\n",
             high_water_mark_index);
+    dbfawk_memo_stats(si->memo, &lookups, &hits);
+    fprintf(stderr,"dbfawk memo: %lu lookups, %lu hits\n",
+            lookups, hits);
   }
 
   // Set fill style back to defaults
@@ -2159,13 +2268,44 @@ int convert_ll_to_screen_coords(long *x, long *y, float lon, float lat)
 
 // This function extracts all of the vertices from a shapefile object
 // given a starting point and a number of vertices, and deposits them
-// into the provided XPoint array.
+// into the provided XPoint array.  If the shape has been simplified
+// for the current zoom, only the vertices kept are used.
 // Returns the number of points converted
 int get_vertices_screen_coords_XPoints(SHPObject *object, int partStart,
                                         int nVertices, XPoint *points,
                                         int *high_water_mark_index)
 {
   int index = 0;
+
+  if (object == lod_object)
+  {
+    int low = 0;
+    int high = lod_vertex_count;
+
+    // Find the first kept vertex of this part
+    while (low < high)
+    {
+      int middle = (low + high) / 2;
+
+      if ((int)lod_vertices[middle] < partStart)
+      {
+        low = middle + 1;
+      }
+      else
+      {
+        high = middle;
+      }
+    }
+    for ( ; low < lod_vertex_count
+          && (int)lod_vertices[low] < partStart + nVertices; low++)
+    {
+      index = get_vertex_screen_coords_XPoint(
+                                              object, lod_vertices[low], points,
+                                              index, high_water_mark_index);
+    }
+    return (index);
+  }
+
   for (int vertex = 0 ; vertex < nVertices; vertex++)
   {
     index = get_vertex_screen_coords_XPoint(
@@ -2219,6 +2359,22 @@ int get_vertex_screen_coords_XPoint(SHPObject *object, int vertex, XPoint *point
 // this function gets a vertex's screen coordinates into variables x and y
 int get_vertex_screen_coords(SHPObject *object, int vertex, long *x, long *y)
 {
+  unsigned long my_long, my_lat;
+  int ok;
+
+  // Cached shapes have their vertices in Xastir coordinates already,
+  // which leaves only the integer transform for the current view.
+  if (shp_cache_vertex(object, vertex, &my_long, &my_lat, &ok))
+  {
+    if (!ok)
+    {
+      *x = 0;
+      *y = 0;
+      return(0);
+    }
+    convert_xastir_to_screen_coordinates(my_long, my_lat, x, y);
+    return(1);
+  }
   return(convert_ll_to_screen_coords(x,y,
                                      object->padfX[vertex],
                                      object->padfY[vertex]));
@@ -69,6 +69,7 @@
 #include "rotated.h"
 #include "color.h"
 #include "xa_config.h"
+#include "cache_utils.h"
 
 #define DOS_HDR_LINES 8
 #define GRID_MORE 5000
@@ -327,6 +328,278 @@ int read_fgd_file ( char* tif_filename,
   return(1);    /* Successful */
 }
 
+
+
+
+
+// What geotiff_pyramid_row() needs to resample a geoTIFF onto level 0
+// of its pyramid.
+typedef struct
+{
+  u_char *image;              // The whole image, width x height
+  uint32_t width;
+  uint32_t height;
+  double map_x[4];            // Neat-line corners in Xastir coordinates,
+  double map_y[4];            //  NW NE SW SE
+  double pixel_x[4];          // and in pixels
+  double pixel_y[4];
+  raster_pyramid_header *geometry;
+  int have_fgd;
+} geotiff_pyramid_fill;
+
+// Fill one row of pyramid level 0.  Each pixel takes the image pixel
+// under its centre, found by locating the centre within the neat-line
+// quadrilateral and interpolating the same fractions across the pixel
+// corners.  Does what the drawing loop in draw_geotiff_image_map()
+// does for USGS maps: cut along the neat-line and turn the black
+// border white.
+//
+static int geotiff_pyramid_row(void *data, int row, uint8_t *pixels)
+{
+  geotiff_pyramid_fill *fill = (geotiff_pyramid_fill *)data;
+  raster_pyramid_header *geometry = fill->geometry;
+  double x, y, u, v, px, py;
+  int column, ix, iy;
+  uint8_t value;
+
+
+  y = geometry->y0 + (row + 0.5) * geometry->step_y;
+
+  for (column = 0; column < (int)geometry->width; column++)
+  {
+    pixels[column] = (uint8_t)geometry->transparent;
+
+    x = geometry->x0 + (column + 0.5) * geometry->step_x;
+
+    if (raster_pyramid_quad_uv(fill->map_x, fill->map_y, x, y, &u, &v) != 0
+        || u < 0.0 || u > 1.0 || v < 0.0 || v > 1.0)
+    {
+      continue;
+    }
+
+    if (fill->have_fgd
+        && (y > fill->map_y[2] || y < fill->map_y[0]))
+    {
+      continue;
+    }
+
+    px = (1.0 - v) * ((1.0 - u) * fill->pixel_x[0] + u * fill->pixel_x[1])
+         + v * ((1.0 - u) * fill->pixel_x[2] + u * fill->pixel_x[3]);
+    py = (1.0 - v) * ((1.0 - u) * fill->pixel_y[0] + u * fill->pixel_y[1])
+         + v * ((1.0 - u) * fill->pixel_y[2] + u * fill->pixel_y[3]);
+    ix = (int)(px + 0.5);
+    iy = (int)(py + 0.5);
+    if (ix < 0 || iy < 0 || ix >= (int)fill->width || iy >= (int)fill->height)
+    {
+      continue;
+    }
+
+    value = fill->image[(size_t)iy * fill->width + ix];
+
+    // Make the map pages join better, as in the drawing loop
+    if (fill->have_fgd && value == 0x00
+        && (y > fill->map_y[2] - 25
+            || y < fill->map_y[0] + 25
+            || x < fill->map_x[2] + 25
+            || x > fill->map_x[3] - 25))
+    {
+      value = 0x01;
+    }
+
+    pixels[column] = value;
+  }
+  return(0);
+}
+
+
+
+
+
+/**********************************************************
+ * draw_geotiff_pyramid()
+ *
+ * Draws a geoTIFF from its raster pyramid, building the
+ * pyramid first if there isn't a current one.  Building
+ * reads the whole image once.  After that redraws only
+ * touch the tiles on screen at about screen resolution,
+ * instead of reading and reprojecting the image on every
+ * redraw.
+ *
+ * Corners are in NW NE SW SE order.  Returns 1 if the map
+ * was drawn (or drawing was interrupted), 0 if the caller
+ * should draw it the old way.
+ **********************************************************/
+static int draw_geotiff_pyramid(Widget w,
+                                char *file,
+                                TIFF *tif,
+                                uint32_t width,
+                                uint32_t height,
+                                const unsigned long map_x[4],
+                                const unsigned long map_y[4],
+                                const int pixel_x[4],
+                                const int pixel_y[4],
+                                int have_fgd,
+                                XColor *my_colors,
+                                int usgs_drg)
+{
+  raster_pyramid *pyramid;
+  raster_pyramid_header geometry;
+  geotiff_pyramid_fill fill;
+  raster_pyramid_colors colors;
+  struct stat file_stat;
+  char path[MAX_FILENAME];
+  char used[256];
+  uint32_t variant, row;
+  size_t i;
+  double west, east, north, south, across, down;
+  int level, built = 0;
+
+
+  if (stat(file, &file_stat) != 0)
+  {
+    return(0);
+  }
+
+  memset(&fill, 0, sizeof(fill));
+  for (i = 0; i < 4; i++)
+  {
+    fill.map_x[i] = (double)map_x[i];
+    fill.map_y[i] = (double)map_y[i];
+    fill.pixel_x[i] = (double)pixel_x[i];
+    fill.pixel_y[i] = (double)pixel_y[i];
+  }
+  fill.have_fgd = have_fgd;
+
+  // The georeferencing comes from the .fgd file as well as the
+  // image, so it goes into the variant
+  variant = fnv1a_hash(FNV1A_INIT, fill.map_x, sizeof(fill.map_x));
+  variant = fnv1a_hash(variant, fill.map_y, sizeof(fill.map_y));
+  variant = fnv1a_hash(variant, fill.pixel_x, sizeof(fill.pixel_x));
+  variant = fnv1a_hash(variant, fill.pixel_y, sizeof(fill.pixel_y));
+  variant = fnv1a_hash(variant, &have_fgd, sizeof(have_fgd));
+
+  pyramid = get_raster_pyramid(file, &file_stat, variant, path, sizeof(path));
+  if (!pyramid)
+  {
+    if (path[0] == '\0')
+    {
+      return(0);  // Pyramids are turned off
+    }
+
+    across = ((pixel_x[1] - pixel_x[0]) + (pixel_x[3] - pixel_x[2])) / 2.0;
+    down = ((pixel_y[2] - pixel_y[0]) + (pixel_y[3] - pixel_y[1])) / 2.0;
+    if (across < 1.0 || down < 1.0
+        || (long)TIFFScanlineSize(tif) != (long)width)
+    {
+      return(0);
+    }
+
+    west = fill.map_x[0];
+    east = fill.map_x[0];
+    north = fill.map_y[0];
+    south = fill.map_y[0];
+    for (i = 1; i < 4; i++)
+    {
+      west = (fill.map_x[i] < west) ? fill.map_x[i] : west;
+      east = (fill.map_x[i] > east) ? fill.map_x[i] : east;
+      north = (fill.map_y[i] < north) ? fill.map_y[i] : north;
+      south = (fill.map_y[i] > south) ? fill.map_y[i] : south;
+    }
+
+    memset(&geometry, 0, sizeof(geometry));
+    geometry.variant = variant;
+    geometry.bpp = 1;
+    geometry.x0 = west;
+    geometry.y0 = north;
+    geometry.step_x = ((fill.map_x[1] - fill.map_x[0]) + (fill.map_x[3] - fill.map_x[2])) / 2.0 / across;
+    geometry.step_y = ((fill.map_y[2] - fill.map_y[0]) + (fill.map_y[3] - fill.map_y[1])) / 2.0 / down;
+    if (geometry.step_x <= 0.0 || geometry.step_y <= 0.0)
+    {
+      return(0);
+    }
+    geometry.width = (uint32_t)ceil((east - west) / geometry.step_x);
+    geometry.height = (uint32_t)ceil((south - north) / geometry.step_y);
+    fill.geometry = &geometry;
+    fill.width = width;
+    fill.height = height;
+
+    // Read the whole image once.  Not CHECKMALLOC(): a map too big
+    // for memory is still drawn a scanline at a time.
+    fill.image = (u_char *)malloc((size_t)width * height);
+    if (!fill.image)
+    {
+      return(0);
+    }
+    memset(used, 0, sizeof(used));
+    for (row = 0; row < height; row++)
+    {
+      if (TIFFReadScanline(tif, fill.image + (size_t)row * width, row, 0) < 0)
+      {
+        free(fill.image);
+        return(0);
+      }
+    }
+    for (i = 0; i < (size_t)width * height; i++)
+    {
+      used[fill.image[i]] = 1;
+    }
+
+    // Any index the image doesn't use will do for transparent
+    for (i = 0; i < 256 && used[i]; i++)
+      ;
+    if (i == 256)
+    {
+      free(fill.image);
+      return(0);
+    }
+    geometry.transparent = (uint32_t)i;
+
+    pyramid = build_raster_pyramid(path, &file_stat, &geometry, geotiff_pyramid_row, &fill);
+    free(fill.image);
+    if (!pyramid)
+    {
+      return(0);
+    }
+    built = 1;
+  }
+
+  // Palette lookup, leaving out the DRG colors that are turned off
+  memset(&colors, 0, sizeof(colors));
+  for (i = 0; i < 256; i++)
+  {
+    colors.index_pixel[i] = my_colors[i].pixel;
+    colors.index_draw[i] = !(usgs_drg == 1 && i < 13 && DRG_show_colors[i] != 1);
+  }
+  colors.xor = DRG_XOR_colors;
+
+  // Same XOR drawing as the scanline loop, for when there's no XImage
+  if (DRG_XOR_colors)
+  {
+    (void)XSetLineAttributes (XtDisplay (w), gc_tint, 1, LineSolid, CapButt,JoinMiter);
+    (void)XSetFunction (XtDisplay (da), gc_tint, GXxor);
+    level = draw_raster_pyramid(w, gc_tint, pyramid, &colors);
+  }
+  else
+  {
+    level = draw_raster_pyramid(w, gc, pyramid, &colors);
+  }
+
+  if (debug_level & 16)
+  {
+    fprintf(stderr,"draw_geotiff_pyramid: %s pyramid level %d%s\n",
+            file,
+            level,
+            (built) ? ", built" : "");
+  }
+
+  raster_pyramid_free(pyramid);
+  return(1);
+}
+
+
+
+
+
 /***********************************************************
  * draw_geotiff_image_map()
  *
@@ -444,6 +717,7 @@ void draw_geotiff_image_map (Widget w,
   float steph;
   float stepw;
   int stepwc, stephc;
+  int map_pixel_x;            // Width of a map pixel on screen, for map_ximage
   char map_it[MAX_FILENAME];           /* Used to hold filename for status line */
   int have_fgd;               /* Tells where we have an associated *.fgd file */
   //short datum;
@@ -499,6 +773,7 @@ void draw_geotiff_image_map (Widget w,
   short PCS;
   int usgs_drg;
   char *imagedesc;
+  map_image map_ximage;       // Screen image the pixels go into
 
   usgs_drg = mdf->usgs_drg;              // yes, no, or auto
 
@@ -2036,6 +2311,46 @@ void draw_geotiff_image_map (Widget w,
     return;
   }
 
+  // Draw from the map's raster pyramid if we can
+  if (photometric == PHOTOMETRIC_PALETTE
+      || photometric == PHOTOMETRIC_MINISBLACK
+      || photometric == PHOTOMETRIC_MINISWHITE)
+  {
+    unsigned long map_x[4], map_y[4];
+    int pixel_x[4], pixel_y[4];
+
+    map_x[0] = NW_x_bounding_wgs84;
+    map_y[0] = NW_y_bounding_wgs84;
+    map_x[1] = NE_x_bounding_wgs84;
+    map_y[1] = NE_y_bounding_wgs84;
+    map_x[2] = SW_x_bounding_wgs84;
+    map_y[2] = SW_y_bounding_wgs84;
+    map_x[3] = SE_x_bounding_wgs84;
+    map_y[3] = SE_y_bounding_wgs84;
+    pixel_x[0] = NW_x;
+    pixel_y[0] = NW_y;
+    pixel_x[1] = NE_x;
+    pixel_y[1] = NE_y;
+    pixel_x[2] = SW_x;
+    pixel_y[2] = SW_y;
+    pixel_x[3] = SE_x;
+    pixel_y[3] = SE_y;
+
+    if (draw_geotiff_pyramid(w, file, tif, width, height,
+                             map_x, map_y, pixel_x, pixel_y,
+                             have_fgd, my_colors, usgs_drg))
+    {
+      GTIFFree (gtif);
+      XTIFFClose (tif);
+      if (interrupt_drawing_now)
+      {
+        // Update to screen
+        (void)XCopyArea(XtDisplay(da),pixmap,XtWindow(da),gc,0,0,screen_width,screen_height,0,0);
+      }
+      return;
+    }
+  }
+
   // Each data value should be an 8-bit value, which is a
   // pointer into a color
   // table.  Later we perform a translation from the geoTIFF
@@ -2655,6 +2970,19 @@ void draw_geotiff_image_map (Widget w,
   }
 
 
+  // Pixels go into an image of the part of the screen the map covers
+  // that's put back in one go at the end, rather than one
+  // XFillRectangle() each.  Allow a map pixel either side for the
+  // rectangles drawn at the edges.
+  map_pixel_x = (int)((east_bounding_wgs84 - west_bounding_wgs84)
+                      / (1.0 * (right_crop - left_crop + 1)) / scale_x) + 2;
+  (void)get_map_ximage(w, &map_ximage,
+                       (long)floor(((double)west_bounding_wgs84 - NW_corner_longitude) / scale_x) - map_pixel_x,
+                       (long)floor(((double)north_bounding_wgs84 - NW_corner_latitude) / scale_y) - stephc,
+                       (long)ceil(((double)east_bounding_wgs84 - NW_corner_longitude) / scale_x) + map_pixel_x,
+                       (long)ceil(((double)south_bounding_wgs84 - NW_corner_latitude) / scale_y) + stephc);
+
+
   // Iterate over the rows of interest only.  Using the rectangular
   // top/bottom crop values for these is ok at this point.
   //
@@ -2675,6 +3003,7 @@ void draw_geotiff_image_map (Widget w,
       {
         free(imageMemory);
       }
+      free_map_ximage(&map_ximage);
       GTIFFree (gtif);
       XTIFFClose (tif);
       // Update to screen
@@ -2911,10 +3240,18 @@ void draw_geotiff_image_map (Widget w,
           {
 
 
+            if (map_ximage.ximage)
+            {
+              // XORed into the image if DRG_XOR_colors is set
+              map_ximage_fill(&map_ximage, sxx, syy, stepwc, stephc,
+                              my_colors[*(imageMemory + column)].pixel,
+                              DRG_XOR_colors);
+            }
+
             // If this is set, use gc_tint for drawing
             // with "GXxor" as the bit-blit operation.
             //
-            if (DRG_XOR_colors)
+            else if (DRG_XOR_colors)
             {
 
               // Draw the pixel using "gc_tint"
@@ -2940,6 +3277,8 @@ void draw_geotiff_image_map (Widget w,
   }
 
 
+  put_map_ximage(w, &map_ximage);
+
   /* Free up any malloc's that we did */
   if (imageMemory)
   {
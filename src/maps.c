@@ -39,6 +39,10 @@
 #include <pwd.h>
 #include <errno.h>
 
+#if HAVE_SYS_TIME_H
+  #include <sys/time.h>
+#endif // HAVE_SYS_TIME_H
+
 #ifdef HAVE_MAGICK
   #if HAVE_SYS_TIME_H
     #include <sys/time.h>
@@ -193,6 +197,7 @@ int npoints;    /* number of points in a line */
 
 float raster_map_intensity = 0.65;    // Raster map color intensity, set from Maps->Map Intensity
 float imagemagick_gamma_adjust = 0.0;  // Additional imagemagick map gamma correction, set from Maps->Adjust Gamma
+int raster_pyramid_max_mb = 1024;      // Disk space for raster pyramids, 0 turns them off
 
 // Storage for the index file timestamp
 time_t map_index_timestamp;
@@ -3689,6 +3694,682 @@ char *get_map_dir (char *fullpath)
 
 
 
+/**********************************************************
+ * get_raster_pyramid()
+ *
+ * Loads the pyramid of raster map "filename" if there's one
+ * that's still current for the map's "file_stat" and
+ * "variant".  Either way "path" gets where the pyramid
+ * lives, for build_raster_pyramid(), or is emptied if
+ * pyramids are turned off.
+ **********************************************************/
+raster_pyramid *get_raster_pyramid(char *filename, struct stat *file_stat, uint32_t variant, char *path, int path_size)
+{
+  char name[MAX_FILENAME];
+
+
+  path[0] = '\0';
+  if (raster_pyramid_max_mb <= 0)
+  {
+    return(NULL);
+  }
+
+  raster_pyramid_name(filename, name, sizeof(name));
+  get_user_base_dir(name, path, path_size);
+
+  return(raster_pyramid_load(path, file_stat->st_mtime, file_stat->st_size, variant));
+}
+
+
+
+
+
+/**********************************************************
+ * build_raster_pyramid()
+ *
+ * Builds the pyramid at "path" from get_raster_pyramid(),
+ * trims the pyramid directory back to
+ * raster_pyramid_max_mb and loads the new pyramid.
+ * Returns NULL if any of that fails, and the caller draws
+ * the map the slow way.
+ **********************************************************/
+raster_pyramid *build_raster_pyramid(char *path, struct stat *file_stat, raster_pyramid_header *geometry,
+                                     raster_pyramid_row_func fill, void *data)
+{
+  char dir[MAX_FILENAME];
+
+
+  if (path[0] == '\0')
+  {
+    return(NULL);
+  }
+
+  geometry->source_mtime = file_stat->st_mtime;
+  geometry->source_size = file_stat->st_size;
+  if (raster_pyramid_build(path, geometry, fill, data))
+  {
+    fprintf(stderr,"Couldn't write raster pyramid %s\n", path);
+    return(NULL);
+  }
+
+  (void)raster_pyramid_trim(get_user_base_dir("raster_pyramid", dir, sizeof(dir)),
+                            (off_t)raster_pyramid_max_mb * 1024 * 1024);
+
+  return(raster_pyramid_load(path, file_stat->st_mtime, file_stat->st_size, geometry->variant));
+}
+
+
+
+
+
+/**********************************************************
+ * raster_pyramid_rgb_colors()
+ *
+ * Fills in the X pixel bits of each 8-bit channel value of
+ * an RGB pyramid, scaled by "intensity".  The X pixel of a
+ * color is then the OR of its three channels, which holds
+ * for every visual pack_pixel_bits() handles.
+ **********************************************************/
+void raster_pyramid_rgb_colors(raster_pyramid_colors *colors, float intensity)
+{
+  int i;
+
+
+  for (i = 0; i < 256; i++)
+  {
+    unsigned short value = (unsigned short)(i * 256 * intensity);
+
+    pack_pixel_bits(value, 0, 0, &colors->red_pixel[i]);
+    pack_pixel_bits(0, value, 0, &colors->green_pixel[i]);
+    pack_pixel_bits(0, 0, value, &colors->blue_pixel[i]);
+  }
+}
+
+
+
+
+
+/**********************************************************
+ * ximage_native_bits()
+ *
+ * 32 or 16 if the pixels of a ZPixmap XImage are words of
+ * that size in our own byte order, which can be stored
+ * straight into ximage->data.  0 if they have to go
+ * through XPutPixel().
+ **********************************************************/
+static int ximage_native_bits(XImage *ximage)
+{
+  uint32_t one = 1;
+
+
+  if (ximage->format != ZPixmap
+      || ximage->byte_order != ((*(uint8_t *)&one) ? LSBFirst : MSBFirst))
+  {
+    return(0);
+  }
+  if (ximage->bits_per_pixel == 32 || ximage->bits_per_pixel == 16)
+  {
+    return(ximage->bits_per_pixel);
+  }
+  return(0);
+}
+
+
+
+
+
+/**********************************************************
+ * get_map_ximage()
+ *
+ * An XImage of the screen rectangle left,top to
+ * right,bottom (exclusive), clipped to the screen, holding
+ * what's in pixmap now.  Map drivers draw into it with
+ * map_ximage_fill() and flush it with put_map_ximage(),
+ * like the OSM tiles are.  Returns 0 with image->ximage
+ * NULL if the rectangle is off screen or the X server
+ * won't give us one, in which case draw with
+ * XFillRectangle() instead.
+ **********************************************************/
+int get_map_ximage(Widget w, map_image *image, long left, long top, long right, long bottom)
+{
+  if (left < 0)
+  {
+    left = 0;
+  }
+  if (top < 0)
+  {
+    top = 0;
+  }
+  if (right > screen_width)
+  {
+    right = screen_width;
+  }
+  if (bottom > screen_height)
+  {
+    bottom = screen_height;
+  }
+
+  image->ximage = NULL;
+  image->x = left;
+  image->y = top;
+  image->native_bits = 0;
+  if (left >= right || top >= bottom)
+  {
+    return(0);
+  }
+
+  image->ximage = XGetImage(XtDisplay(w), pixmap, (int)left, (int)top,
+                            (unsigned int)(right - left), (unsigned int)(bottom - top),
+                            AllPlanes, ZPixmap);
+  if (!image->ximage)
+  {
+    return(0);
+  }
+  image->native_bits = ximage_native_bits(image->ximage);
+  return(1);
+}
+
+
+
+
+
+/**********************************************************
+ * map_ximage_fill()
+ *
+ * Fills a rectangle, in screen coordinates, of a
+ * get_map_ximage() image, clipped to the image.  With
+ * "xor" set the pixel is XORed onto the image, the way a
+ * GXxor GC draws.
+ **********************************************************/
+void map_ximage_fill(map_image *image, long x, long y, int width, int height, unsigned long pixel, int xor)
+{
+  XImage *ximage = image->ximage;
+  long x_end, y_end;
+  long ix, iy;
+
+
+  x -= image->x;
+  y -= image->y;
+  x_end = x + width;
+  y_end = y + height;
+  if (x < 0)
+  {
+    x = 0;
+  }
+  if (y < 0)
+  {
+    y = 0;
+  }
+  if (x_end > ximage->width)
+  {
+    x_end = ximage->width;
+  }
+  if (y_end > ximage->height)
+  {
+    y_end = ximage->height;
+  }
+
+  for (iy = y; iy < y_end; iy++)
+  {
+    char *line = ximage->data + (size_t)iy * ximage->bytes_per_line;
+
+    if (image->native_bits == 32)
+    {
+      uint32_t *out = (uint32_t *)line;
+
+      if (xor)
+      {
+        for (ix = x; ix < x_end; ix++)
+        {
+          out[ix] ^= (uint32_t)pixel;
+        }
+      }
+      else
+      {
+        for (ix = x; ix < x_end; ix++)
+        {
+          out[ix] = (uint32_t)pixel;
+        }
+      }
+    }
+    else if (image->native_bits == 16)
+    {
+      uint16_t *out = (uint16_t *)line;
+
+      if (xor)
+      {
+        for (ix = x; ix < x_end; ix++)
+        {
+          out[ix] ^= (uint16_t)pixel;
+        }
+      }
+      else
+      {
+        for (ix = x; ix < x_end; ix++)
+        {
+          out[ix] = (uint16_t)pixel;
+        }
+      }
+    }
+    else
+    {
+      for (ix = x; ix < x_end; ix++)
+      {
+        XPutPixel(ximage, ix, iy, (xor) ? (XGetPixel(ximage, ix, iy) ^ pixel) : pixel);
+      }
+    }
+  }
+}
+
+
+
+
+
+/**********************************************************
+ * put_map_ximage()
+ *
+ * Copies a get_map_ximage() image back to where it came
+ * from in pixmap with a single XPutImage() and frees it.
+ **********************************************************/
+void put_map_ximage(Widget w, map_image *image)
+{
+  if (image->ximage)
+  {
+    (void)XPutImage(XtDisplay(w), pixmap, gc, image->ximage, 0, 0,
+                    (int)image->x, (int)image->y,
+                    (unsigned int)image->ximage->width, (unsigned int)image->ximage->height);
+  }
+  free_map_ximage(image);
+}
+
+
+
+
+
+/**********************************************************
+ * free_map_ximage()
+ *
+ * Frees a get_map_ximage() image without putting it back,
+ * e.g. when drawing is interrupted.
+ **********************************************************/
+void free_map_ximage(map_image *image)
+{
+  if (image->ximage)
+  {
+    XDestroyImage(image->ximage);
+    image->ximage = NULL;
+  }
+}
+
+
+
+
+
+// Make the colors an RGB pyramid line shouldn't draw transparent, so
+// the resampling leaves them out like any other transparent pixel.
+// Remembers the last color asked about, as runs of one color are the
+// rule.
+//
+static void skip_pyramid_colors(raster_pyramid_colors *colors, raster_pyramid_header *header,
+                                uint8_t *line, int count)
+{
+  uint32_t *pixel = (uint32_t *)line;
+  uint32_t last_value = 0;      // Never an opaque color
+  int i, last_skip = 0;
+
+
+  if (header->bpp != 4 || !colors->skip_rgb)
+  {
+    return;
+  }
+
+  for (i = 0; i < count; i++)
+  {
+    if ((pixel[i] >> 24) == 0)
+    {
+      continue;
+    }
+    if (pixel[i] != last_value)
+    {
+      last_value = pixel[i];
+      last_skip = colors->skip_rgb(colors->skip_data, pixel[i]);
+    }
+    if (last_skip)
+    {
+      pixel[i] = 0;
+    }
+  }
+}
+
+
+
+
+
+/**********************************************************
+ * draw_raster_pyramid()
+ *
+ * Draws a raster map from its pyramid into pixmap, using
+ * the coarsest level that is still at least screen
+ * resolution.
+ *
+ * The map is drawn a scanline at a time.  The pyramid
+ * rows needed are copied out of the tiles into one line,
+ * then each screen pixel is resampled from that line:
+ * nearest pixel for palette maps and when zoomed out,
+ * bilinear for RGB maps zoomed in past the map's own
+ * resolution.  Colors come from the lookup tables in
+ * "colors".  The scanlines go into an XImage of the part
+ * of the screen the map covers, which is put back with one
+ * XPutImage().  If the server won't give us the XImage,
+ * runs of one color are drawn with XFillRectangle() and
+ * gc_draw instead.
+ *
+ * Returns the level drawn, or -1 if drawing was
+ * interrupted.
+ **********************************************************/
+int draw_raster_pyramid(Widget w, GC gc_draw, raster_pyramid *pyramid, raster_pyramid_colors *colors)
+{
+  raster_pyramid_header *header = pyramid->header;
+  XImage *ximage;
+  uint8_t *line0 = NULL, *line1 = NULL;
+  uint32_t *rgb = NULL;
+  unsigned long *pixel = NULL;
+  char *drawn = NULL;
+  int *column = NULL, *column1 = NULL, *weight_x = NULL;
+  int level, level_width, level_height, bilinear, fast32;
+  int left, right, top, bottom, width;
+  int first, last, row0_got, row1_got;
+  int screen_y, rows, row, row1, weight_y, i, k;
+  double cell_x, cell_y, f;
+  int lines = 0, interrupted = 0;
+
+
+  level = raster_pyramid_level(pyramid, (double)scale_x, (double)scale_y);
+  raster_pyramid_level_size(pyramid, level, &level_width, &level_height);
+  cell_x = header->step_x * (double)(1 << level);
+  cell_y = header->step_y * (double)(1 << level);
+
+  // Bilinear only makes sense for colors, and only once screen
+  // pixels are smaller than map pixels
+  bilinear = (header->bpp == 4 && level == 0
+              && scale_x < cell_x && scale_y < cell_y);
+
+  // The part of the screen the map covers
+  left = (int)floor((header->x0 - NW_corner_longitude) / scale_x);
+  right = (int)ceil((header->x0 + header->width * header->step_x - NW_corner_longitude) / scale_x);
+  top = (int)floor((header->y0 - NW_corner_latitude) / scale_y);
+  bottom = (int)ceil((header->y0 + header->height * header->step_y - NW_corner_latitude) / scale_y);
+  if (left < 0)
+  {
+    left = 0;
+  }
+  if (right > screen_width)
+  {
+    right = screen_width;
+  }
+  if (top < 0)
+  {
+    top = 0;
+  }
+  if (bottom > screen_height)
+  {
+    bottom = screen_height;
+  }
+  if (left >= right || top >= bottom)
+  {
+    return(level);
+  }
+  width = right - left;
+
+  // Pyramid column under each screen column, and for bilinear the
+  // column to its right and how far along towards it we are (0-256)
+  column = (int *)malloc(width * sizeof(int));
+  CHECKMALLOC(column);
+  column1 = (int *)malloc(width * sizeof(int));
+  CHECKMALLOC(column1);
+  weight_x = (int *)malloc(width * sizeof(int));
+  CHECKMALLOC(weight_x);
+  first = level_width;
+  last = -1;
+  for (i = 0; i < width; i++)
+  {
+    f = (NW_corner_longitude + (left + i + 0.5) * scale_x - header->x0) / cell_x;
+    k = (int)floor(f);
+    column[i] = (k >= 0 && k < level_width) ? k : -1;
+    if (bilinear && column[i] >= 0)
+    {
+      k = (int)floor(f - 0.5);
+      weight_x[i] = (int)((f - 0.5 - k) * 256.0);
+      column1[i] = (k + 1 < level_width) ? k + 1 : level_width - 1;
+      column[i] = (k >= 0) ? k : 0;
+    }
+    if (column[i] >= 0)
+    {
+      first = (column[i] < first) ? column[i] : first;
+      k = (bilinear) ? column1[i] : column[i];
+      last = (k > last) ? k : last;
+    }
+  }
+  if (last < first)
+  {
+    free(column);
+    free(column1);
+    free(weight_x);
+    return(level);
+  }
+  for (i = 0; i < width; i++)
+  {
+    if (column[i] >= 0)
+    {
+      column[i] -= first;
+      column1[i] -= first;
+    }
+  }
+
+  line0 = (uint8_t *)malloc((last - first + 1) * 4);
+  CHECKMALLOC(line0);
+  line1 = (uint8_t *)malloc((last - first + 1) * 4);
+  CHECKMALLOC(line1);
+  pixel = (unsigned long *)malloc(width * sizeof(unsigned long));
+  CHECKMALLOC(pixel);
+  drawn = (char *)malloc(width);
+  CHECKMALLOC(drawn);
+  rgb = (uint32_t *)malloc(width * sizeof(uint32_t));
+  CHECKMALLOC(rgb);
+
+  ximage = XGetImage(XtDisplay(w), pixmap, left, top,
+                     (unsigned int)width, (unsigned int)(bottom - top),
+                     AllPlanes, ZPixmap);
+
+  // 32-bit pixels in our own byte order can be stored directly
+  fast32 = (ximage && ximage_native_bits(ximage) == 32);
+
+  row0_got = -1;
+  row1_got = -1;
+  for (screen_y = top; screen_y < bottom; screen_y += rows)
+  {
+    f = (NW_corner_latitude + (screen_y + 0.5) * scale_y - header->y0) / cell_y;
+    row = (int)floor(f);
+    rows = 1;
+
+    if (bilinear)
+    {
+      k = (int)floor(f - 0.5);
+      weight_y = (int)((f - 0.5 - k) * 256.0);
+      row = (k >= 0) ? k : 0;
+      row1 = (k + 1 < level_height) ? k + 1 : level_height - 1;
+      if (f < 0.0 || f >= level_height)
+      {
+        continue;
+      }
+    }
+    else
+    {
+      // All the screen rows that land on the same pyramid row
+      for ( ; screen_y + rows < bottom; rows++)
+      {
+        if ((int)floor((NW_corner_latitude + (screen_y + rows + 0.5) * scale_y - header->y0) / cell_y) != row)
+        {
+          break;
+        }
+      }
+      if (row < 0 || row >= level_height)
+      {
+        continue;
+      }
+      row1 = row;
+      weight_y = 0;
+    }
+
+    if (row != row0_got)
+    {
+      if (row == row1_got)
+      {
+        uint8_t *swap = line0;
+
+        line0 = line1;
+        line1 = swap;
+        row1_got = row0_got;
+      }
+      else
+      {
+        raster_pyramid_line(pyramid, level, row, first, last, line0);
+        skip_pyramid_colors(colors, header, line0, last - first + 1);
+      }
+      row0_got = row;
+    }
+    if (bilinear && row1 != row1_got)
+    {
+      raster_pyramid_line(pyramid, level, row1, first, last, line1);
+      skip_pyramid_colors(colors, header, line1, last - first + 1);
+      row1_got = row1;
+    }
+
+    // Resample the scanline
+    if (header->bpp == 1)
+    {
+      for (i = 0; i < width; i++)
+      {
+        k = (column[i] >= 0) ? line0[column[i]] : (int)header->transparent;
+        pixel[i] = colors->index_pixel[k];
+        drawn[i] = colors->index_draw[k] && k != (int)header->transparent;
+      }
+    }
+    else
+    {
+      const uint32_t *line = (const uint32_t *)line0;
+      uint32_t value;
+
+      if (bilinear)
+      {
+        raster_pyramid_bilinear((const uint32_t *)line0, (const uint32_t *)line1,
+                                column, column1, weight_x, weight_y, width, rgb);
+        line = rgb;
+      }
+      for (i = 0; i < width; i++)
+      {
+        value = (bilinear) ? line[i] : ((column[i] >= 0) ? line[column[i]] : 0);
+        drawn[i] = (value >> 24) != 0;
+        pixel[i] = colors->red_pixel[(value >> 16) & 0xff]
+                   | colors->green_pixel[(value >> 8) & 0xff]
+                   | colors->blue_pixel[value & 0xff];
+      }
+    }
+
+    // And store it
+    if (ximage)
+    {
+      for (k = screen_y - top; k < screen_y - top + rows; k++)
+      {
+        if (fast32)
+        {
+          uint32_t *out = (uint32_t *)(ximage->data + (size_t)k * ximage->bytes_per_line);
+
+          if (colors->xor)
+          {
+            for (i = 0; i < width; i++)
+            {
+              out[i] ^= (drawn[i]) ? (uint32_t)pixel[i] : 0;
+            }
+          }
+          else
+          {
+            for (i = 0; i < width; i++)
+            {
+              out[i] = (drawn[i]) ? (uint32_t)pixel[i] : out[i];
+            }
+          }
+        }
+        else
+        {
+          for (i = 0; i < width; i++)
+          {
+            if (drawn[i])
+            {
+              XPutPixel(ximage, i, k,
+                        (colors->xor) ? (XGetPixel(ximage, i, k) ^ pixel[i]) : pixel[i]);
+            }
+          }
+        }
+      }
+    }
+    else
+    {
+      int run_start = -1;
+
+      for (i = 0; i <= width; i++)
+      {
+        if (run_start >= 0 && (i == width || !drawn[i] || pixel[i] != pixel[run_start]))
+        {
+          (void)XSetForeground(XtDisplay(w), gc_draw, pixel[run_start]);
+          (void)XFillRectangle(XtDisplay(w), pixmap, gc_draw,
+                               left + run_start, screen_y, i - run_start, rows);
+          run_start = -1;
+        }
+        if (i < width && drawn[i] && run_start < 0)
+        {
+          run_start = i;
+        }
+      }
+    }
+
+    if ((++lines & 15) == 0)
+    {
+      HandlePendingEvents(app_context);
+      if (interrupt_drawing_now)
+      {
+        interrupted = 1;
+        break;
+      }
+    }
+  }
+
+  if (ximage)
+  {
+    if (!interrupted)
+    {
+      (void)XPutImage(XtDisplay(w), pixmap, gc, ximage, 0, 0, left, top,
+                      (unsigned int)width, (unsigned int)(bottom - top));
+    }
+    XDestroyImage(ximage);
+  }
+
+  free(column);
+  free(column1);
+  free(weight_x);
+  free(line0);
+  free(line1);
+  free(pixel);
+  free(drawn);
+  free(rgb);
+
+  return((interrupted) ? -1 : level);
+}
+
+
+
+
+
 /***********************************************************
  * map_visible()
  *
@@ -6455,6 +7136,9 @@ void draw_map (Widget w, char *dir, char *filenm, alert_entry *alert,
 
   if (map_driver_ptr->func)
   {
+    struct timeval layer_start, layer_end;
+
+    gettimeofday(&layer_start, NULL);
     map_driver_ptr->func(w,
                          dir,
                          filenm,
@@ -6462,6 +7146,16 @@ void draw_map (Widget w, char *dir, char *filenm, alert_entry *alert,
                          alert_color,
                          destination_pixmap,
                          draw_flags);
+    gettimeofday(&layer_end, NULL);
+
+    // Per-layer draw time, to find the layers that make redraws slow
+    if (debug_level & 16)
+    {
+      fprintf(stderr,"draw_map: %s took %.1f ms\n",
+              file,
+              (layer_end.tv_sec - layer_start.tv_sec) * 1000.0
+              + (layer_end.tv_usec - layer_start.tv_usec) / 1000.0);
+    }
   }
 
   XmUpdateDisplay (XtParent (da));
@@ -26,6 +26,9 @@
 
 #include <X11/Intrinsic.h>
 #include <Xm/Xm.h>
+#include <sys/stat.h>
+
+#include "raster_pyramid.h"
 
 #define MAX_OUTBOUND 900
 #define MAX_MAP_POINTS 500000
@@ -212,6 +215,41 @@ extern int grid_size;
 #endif  // NO_GRAPHICS
 
 extern float raster_map_intensity;
+extern int raster_pyramid_max_mb;
+
+// How draw_raster_pyramid() turns pyramid pixels into X pixels
+typedef struct
+{
+  unsigned long index_pixel[256];   // Palette pyramids: X pixel of each index
+  char index_draw[256];             //  and whether it's drawn at all
+  unsigned long red_pixel[256];     // RGB pyramids: X pixel bits of each
+  unsigned long green_pixel[256];   //  channel value, see
+  unsigned long blue_pixel[256];    //  raster_pyramid_rgb_colors()
+  int (*skip_rgb)(void *data, uint32_t value);  // RGB pyramids: colors not drawn, or NULL
+  void *skip_data;
+  int xor;                          // XOR onto what's below, like a GXxor GC
+} raster_pyramid_colors;
+
+extern void raster_pyramid_rgb_colors(raster_pyramid_colors *colors, float intensity);
+extern int draw_raster_pyramid(Widget w, GC gc_draw, raster_pyramid *pyramid, raster_pyramid_colors *colors);
+
+// The part of the screen a map covers, fetched from pixmap for the map
+// driver to draw into, see get_map_ximage()
+typedef struct
+{
+  XImage *ximage;                   // NULL if there isn't one
+  long x;                           // Screen position of its top left corner
+  long y;
+  int native_bits;                  // 32 or 16 if pixels can be stored directly
+} map_image;
+
+extern int get_map_ximage(Widget w, map_image *image, long left, long top, long right, long bottom);
+extern void map_ximage_fill(map_image *image, long x, long y, int width, int height, unsigned long pixel, int xor);
+extern void put_map_ximage(Widget w, map_image *image);
+extern void free_map_ximage(map_image *image);
+extern raster_pyramid *get_raster_pyramid(char *filename, struct stat *file_stat, uint32_t variant, char *path, int path_size);
+extern raster_pyramid *build_raster_pyramid(char *path, struct stat *file_stat, raster_pyramid_header *geometry,
+                                            raster_pyramid_row_func fill, void *data);
 
 extern void Print_Postscript(Widget widget, XtPointer clientData, XtPointer callData);
 
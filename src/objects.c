@@ -245,9 +245,9 @@ int Create_object_item_tx_string(DataRow *p_station, char *line, int line_length
     comment[0] = '\0';  // Empty string
   }
 
-  format_probability_ring_data(comment,sizeof(comment), p_station->probability_min, p_station->probability_max);
+  format_probability_ring_data(comment,sizeof(comment), OBJECT_DATA(p_station)->probability_min, OBJECT_DATA(p_station)->probability_max);
 
-  prepend_rng_phg(comment,sizeof(comment),p_station->power_gain);
+  prepend_rng_phg(comment,sizeof(comment),EXTRA_DATA(p_station)->power_gain);
 
   (void)remove_trailing_spaces(comment);
 
@@ -317,7 +317,7 @@ int Create_object_item_tx_string(DataRow *p_station, char *line, int line_length
   else if ( (p_station->aprs_symbol.aprs_type == '\\') // We have a signpost object
             && (p_station->aprs_symbol.aprs_symbol == 'm' ) )
   {
-    format_signpost(signpost,sizeof(signpost),p_station->signpost);
+    format_signpost(signpost,sizeof(signpost),OBJECT_DATA(p_station)->signpost);
 
     format_signpost_object_item_packet(line, line_length,
                                        p_station->call_sign,
@@ -332,29 +332,29 @@ int Create_object_item_tx_string(DataRow *p_station, char *line, int line_length
                                        transmit_compressed_objects_items);
   }
 
-  else if (p_station->signal_gain[0] != '\0')   // Must be an Omni-DF object/item
+  else if (EXTRA_DATA(p_station)->signal_gain[0] != '\0')   // Must be an Omni-DF object/item
   {
     format_omni_df_object_item_packet(line, line_length,
                                       p_station->call_sign,
                                       object_group, object_symbol,
                                       time,
                                       lat_str, lon_str,
-                                      p_station->signal_gain,
+                                      EXTRA_DATA(p_station)->signal_gain,
                                       speed_course,
                                       altitude,
                                       course, speed,
                                       (p_station->flag & ST_OBJECT),
                                       transmit_compressed_objects_items);
   }
-  else if (p_station->NRQ[0] != 0)    // It's a Beam Heading DFS object/item
+  else if (EXTRA_DATA(p_station)->NRQ[0] != 0)    // It's a Beam Heading DFS object/item
   {
     format_beam_df_object_item_packet(line, line_length,
                                       p_station->call_sign,
                                       object_group, object_symbol,
                                       time,
                                       lat_str, lon_str,
-                                      p_station->bearing,
-                                      p_station->NRQ,
+                                      EXTRA_DATA(p_station)->bearing,
+                                      EXTRA_DATA(p_station)->NRQ,
                                       speed_course,
                                       altitude,
                                       course,speed,
@@ -388,7 +388,7 @@ int Create_object_item_tx_string(DataRow *p_station, char *line, int line_length
     // Check whether we should decrement the object_retransmit
     // counter so that we will eventually stop sending this
     // object/item.
-    if (p_station->object_retransmit == 0)
+    if (OBJECT_DATA(p_station)->object_retransmit == 0)
     {
       // We shouldn't be transmitting this killed object/item
       // anymore.  We're already done transmitting it.
@@ -400,25 +400,25 @@ int Create_object_item_tx_string(DataRow *p_station, char *line, int line_length
     // object/item.  If not, change it from -1 (continuous
     // transmit of non-killed objects) to
     // MAX_KILLED_OBJECT_RETRANSMIT.
-    if (p_station->object_retransmit <= -1)
+    if (OBJECT_DATA(p_station)->object_retransmit <= -1)
     {
 
       if ((MAX_KILLED_OBJECT_RETRANSMIT - 1) < 0)
       {
-        p_station->object_retransmit = 0;
+        get_object_data(p_station)->object_retransmit = 0;
         return(0);  // No retransmits desired
       }
       else
       {
-        p_station->object_retransmit = MAX_KILLED_OBJECT_RETRANSMIT - 1;
+        get_object_data(p_station)->object_retransmit = MAX_KILLED_OBJECT_RETRANSMIT - 1;
       }
     }
     else
     {
       // Decrement the timeout if it is a positive number.
-      if (p_station->object_retransmit > 0)
+      if (OBJECT_DATA(p_station)->object_retransmit > 0)
       {
-        p_station->object_retransmit--;
+        get_object_data(p_station)->object_retransmit--;
       }
     }
   }
@@ -583,6 +583,7 @@ void check_and_transmit_objects_items(time_t time)
         // temporarily so that we can
         p_station->coord_lon = x_long;
         p_station->coord_lat = y_lat;
+        station_grid_update(p_station);
       }
 
       // Keep the timestamp current on my own
@@ -621,15 +622,15 @@ void check_and_transmit_objects_items(time_t time)
       // been reduced and the expire time is too long.
       // Reset it to the current max expire time so that
       // it'll get transmitted more quickly.
-      if (p_station->transmit_time_increment > OBJECT_rate)
+      if (OBJECT_DATA(p_station)->transmit_time_increment > OBJECT_rate)
       {
-        p_station->transmit_time_increment = OBJECT_rate;
+        get_object_data(p_station)->transmit_time_increment = OBJECT_rate;
       }
 
 
-      increment = p_station->transmit_time_increment;
+      increment = OBJECT_DATA(p_station)->transmit_time_increment;
 
-      if ( ( p_station->last_transmit_time + increment) <= time )
+      if ( ( OBJECT_DATA(p_station)->last_transmit_time + increment) <= time )
       {
         // We should transmit this object/item as it has
         // hit its transmit interval.
@@ -671,14 +672,14 @@ void check_and_transmit_objects_items(time_t time)
         // poor-man's rounding to turn the random number
         // into an int (so we get the full range).
         new_increment = increment - (int)(randomize + 0.5);
-        p_station->transmit_time_increment = (short)new_increment;
+        get_object_data(p_station)->transmit_time_increment = (short)new_increment;
 
         // Set the last transmit time into the object.
         // Keep this based off the time the object was
         // last created/modified/deleted, so that we
         // don't end up with a bunch of them transmitted
         // together.
-        p_station->last_transmit_time = p_station->last_transmit_time + new_increment;
+        get_object_data(p_station)->last_transmit_time += new_increment;
 
         // Here we need to re-assemble and re-transmit
         // the object or item
@@ -723,6 +724,7 @@ void check_and_transmit_objects_items(time_t time)
           //
           p_station->coord_lon = x_long_save;
           p_station->coord_lat = y_lat_save;
+          station_grid_update(p_station);
 
           // Attempt to transmit the object/item again
           if (object_tx_disable || transmit_disable)      // Send to loopback only
@@ -1171,14 +1173,14 @@ DataRow *construct_object_item_data_row(char *name,
     {
       if (prob_min && strlen(prob_min)>0)
       {
-        xastir_snprintf(theDataRow->probability_min,
-                        sizeof(theDataRow->probability_min),
+        xastir_snprintf(get_object_data(theDataRow)->probability_min,
+                        sizeof(theDataRow->object_data->probability_min),
                         "%s", prob_min);
       }
       if (prob_max && strlen(prob_max)>0)
       {
-        xastir_snprintf(theDataRow->probability_max,
-                        sizeof(theDataRow->probability_max),
+        xastir_snprintf(get_object_data(theDataRow)->probability_max,
+                        sizeof(theDataRow->object_data->probability_max),
                         "%s", prob_max);
       }
     }
@@ -1249,7 +1251,7 @@ DataRow *construct_object_item_data_row(char *name,
 
       if (signpost_str && strlen(signpost_str) >0 && strlen(signpost_str) <= 3)
       {
-        xastir_snprintf(theDataRow->signpost,sizeof(theDataRow->signpost),"%s",signpost_str);
+        xastir_snprintf(get_object_data(theDataRow)->signpost,sizeof(theDataRow->object_data->signpost),"%s",signpost_str);
       }
     }
     else if (df_object)
@@ -1262,7 +1264,7 @@ DataRow *construct_object_item_data_row(char *name,
       {
         if (df_shgd && strlen(df_shgd) == 4)
         {
-          xastir_snprintf(theDataRow->signal_gain,sizeof(theDataRow->signal_gain),"DFS%s",df_shgd);
+          xastir_snprintf(get_extra_data(theDataRow)->signal_gain,sizeof(theDataRow->extra_data->signal_gain),"DFS%s",df_shgd);
         }
       }
       else if (NRQ && strlen(NRQ) != 0)  // must be a beam df object
@@ -1274,8 +1276,8 @@ DataRow *construct_object_item_data_row(char *name,
         {
           bearing_value=360;
         }
-        xastir_snprintf(theDataRow->bearing,sizeof(theDataRow->bearing),"%03d",bearing_value);
-        xastir_snprintf(theDataRow->NRQ,sizeof(theDataRow->NRQ),"%3s",NRQ);
+        xastir_snprintf(get_extra_data(theDataRow)->bearing,sizeof(theDataRow->extra_data->bearing),"%03d",bearing_value);
+        xastir_snprintf(get_extra_data(theDataRow)->NRQ,sizeof(theDataRow->extra_data->NRQ),"%3s",NRQ);
       }
     }
     // and finally, make sure we set the time we created this record,
@@ -427,8 +427,8 @@ void Object_change_data_set(Widget widget, XtPointer clientData, XtPointer UNUSE
     // Set up the timer properly for the decaying algorithm
     if (p_station != NULL)
     {
-      p_station->transmit_time_increment = OBJECT_CHECK_RATE;
-      p_station->last_transmit_time = sec_now();
+      get_object_data(p_station)->transmit_time_increment = OBJECT_CHECK_RATE;
+      get_object_data(p_station)->last_transmit_time = sec_now();
 
       // Keep the time current for our own objects.
       p_station->sec_heard = sec_now();
@@ -492,8 +492,8 @@ void Item_change_data_set(Widget widget, XtPointer clientData, XtPointer UNUSED(
     // Set up the timer properly for the decaying algorithm
     if (p_station != NULL)
     {
-      p_station->transmit_time_increment = OBJECT_CHECK_RATE;
-      p_station->last_transmit_time = sec_now();
+      get_object_data(p_station)->transmit_time_increment = OBJECT_CHECK_RATE;
+      get_object_data(p_station)->last_transmit_time = sec_now();
 
       // Keep the time current for our own items.
       p_station->sec_heard = sec_now();
@@ -646,8 +646,8 @@ void Object_change_data_del(Widget widget, XtPointer clientData, XtPointer UNUSE
     // Set up the timer properly for the decaying algorithm
     if (p_station != NULL)
     {
-      p_station->transmit_time_increment = OBJECT_CHECK_RATE;
-      p_station->last_transmit_time = sec_now();
+      get_object_data(p_station)->transmit_time_increment = OBJECT_CHECK_RATE;
+      get_object_data(p_station)->last_transmit_time = sec_now();
 //            p_station->last_modified_time = sec_now(); // For dead-reckoning
 //fprintf(stderr,"Object_change_data_del(): Setting transmit increment to %d\n", OBJECT_CHECK_RATE);
     }
@@ -687,8 +687,8 @@ void Item_change_data_del(Widget widget, XtPointer clientData, XtPointer UNUSED(
     // Set up the timer properly for the decaying algorithm
     if (p_station != NULL)
     {
-      p_station->transmit_time_increment = OBJECT_CHECK_RATE;
-      p_station->last_transmit_time = sec_now();
+      get_object_data(p_station)->transmit_time_increment = OBJECT_CHECK_RATE;
+      get_object_data(p_station)->last_transmit_time = sec_now();
 //            p_station->last_modified_time = sec_now(); // For dead-reckoning
 //fprintf(stderr,"Item_change_data_del(): Setting transmit increment to %d\n", OBJECT_CHECK_RATE);
     }
@@ -2079,7 +2079,7 @@ void Create_SAR_Object(Widget UNUSED(w), XtPointer clientData, XtPointer UNUSED(
                 //   c) CANCEL request
 
 
-    fprintf(stderr, "Object with same name exists, owned by %s\n", p_station->origin);
+    fprintf(stderr, "Object with same name exists, owned by %s\n", OBJECT_DATA(p_station)->origin);
 
     // Pop up a new dialog with the various options on it.  Save our
     // state here so that we can create the object in the callbacks for
@@ -2342,23 +2342,23 @@ void Set_Del_Object( Widget w, XtPointer clientData, XtPointer calldata)
     }
     else if ( (p_station->aprs_symbol.aprs_symbol == '\\') // Found a DF object
               && (p_station->aprs_symbol.aprs_type == '/')
-              && ((strlen(p_station->signal_gain) == 7) // That has data associated with it
-                  || (strlen(p_station->bearing) == 3)
-                  || (strlen(p_station->NRQ) == 3) ) )
+              && ((strlen(EXTRA_DATA(p_station)->signal_gain) == 7) // That has data associated with it
+                  || (strlen(EXTRA_DATA(p_station)->bearing) == 3)
+                  || (strlen(EXTRA_DATA(p_station)->NRQ) == 3) ) )
     {
       DF_object_enabled = 1;
     }
     else if ( (p_station->aprs_symbol.aprs_symbol == 'E') // Found a Map View object
               && (p_station->aprs_symbol.aprs_type == '/')
-              && (strstr(p_station->power_gain,"RNG") != 0) )   // Has a range value
+              && (strstr(EXTRA_DATA(p_station)->power_gain,"RNG") != 0) )   // Has a range value
     {
 
       //fprintf(stderr,"Found a range\n");
       Map_View_object_enabled = 1;
     }
 
-    else if (p_station->probability_min[0] != '\0'      // Found some data
-             || p_station->probability_max[0] != '\0')   // Found some data
+    else if (OBJECT_DATA(p_station)->probability_min[0] != '\0'      // Found some data
+             || OBJECT_DATA(p_station)->probability_max[0] != '\0')   // Found some data
     {
       Probability_circles_enabled = 1;
     }
@@ -4678,7 +4678,7 @@ void Set_Del_Object( Widget w, XtPointer clientData, XtPointer calldata)
         XtAddCallback(ob_button_set, XmNactivateCallback, Item_change_data_set, object_dialog);
 
         // Check whether we own this item
-        if (strcasecmp(p_station->origin,my_callsign)==0)
+        if (strcasecmp(OBJECT_DATA(p_station)->origin,my_callsign)==0)
         {
 
           // We own this item, set up the "Delete"
@@ -4750,7 +4750,7 @@ void Set_Del_Object( Widget w, XtPointer clientData, XtPointer calldata)
         XtAddCallback(ob_button_set, XmNactivateCallback, Object_change_data_set, object_dialog);
 
         // Check whether we own this Object
-        if (strcasecmp(p_station->origin,my_callsign)==0)
+        if (strcasecmp(OBJECT_DATA(p_station)->origin,my_callsign)==0)
         {
 
           // We own this object, set up the "Delete"
@@ -4954,13 +4954,13 @@ void Set_Del_Object( Widget w, XtPointer clientData, XtPointer calldata)
           xastir_snprintf(temp,
                           sizeof(temp),
                           "%s%s",
-                          p_station->power_gain,
+                          EXTRA_DATA(p_station)->power_gain,
                           p_station->comment_data->text_ptr);
           XmTextFieldSetString(object_comment_data,temp);
         }
         else
         {
-          XmTextFieldSetString(object_comment_data,p_station->power_gain);
+          XmTextFieldSetString(object_comment_data,EXTRA_DATA(p_station)->power_gain);
         }
       }
 
@@ -5154,7 +5154,7 @@ void Set_Del_Object( Widget w, XtPointer clientData, XtPointer calldata)
         {
           XtSetSensitive(ob_frame,FALSE);
           XtSetSensitive(signpost_frame,TRUE);
-          XmTextFieldSetString( signpost_data, p_station->signpost);
+          XmTextFieldSetString( signpost_data, OBJECT_DATA(p_station)->signpost);
         }   // Done with filling in Signpost Objects
 
 
@@ -5162,8 +5162,8 @@ void Set_Del_Object( Widget w, XtPointer clientData, XtPointer calldata)
         {
           // Fetch the min/max fields from the object data and
           // write that data into the input fields.
-          XmTextFieldSetString( probability_data_min, p_station->probability_min );
-          XmTextFieldSetString( probability_data_max, p_station->probability_max );
+          XmTextFieldSetString( probability_data_min, OBJECT_DATA(p_station)->probability_min );
+          XmTextFieldSetString( probability_data_max, OBJECT_DATA(p_station)->probability_max );
         }
 
 
@@ -5175,7 +5175,7 @@ void Set_Del_Object( Widget w, XtPointer clientData, XtPointer calldata)
           //fprintf(stderr,"Found a DF object\n");
 
           // Decide if it was an omni-DF object or a beam heading object
-          if (p_station->NRQ[0] == '\0')      // Must be an omni-DF object
+          if (EXTRA_DATA(p_station)->NRQ[0] == '\0')      // Must be an omni-DF object
           {
             //fprintf(stderr,"omni-DF\n");
             //fprintf(stderr,"Signal_gain: %s\n", p_station->signal_gain);
@@ -5183,7 +5183,7 @@ void Set_Del_Object( Widget w, XtPointer clientData, XtPointer calldata)
             XmToggleButtonSetState(omni_antenna_toggle, TRUE, TRUE);
 
             // Set the received signal quality toggle
-            switch (p_station->signal_gain[3])
+            switch (EXTRA_DATA(p_station)->signal_gain[3])
             {
               case ('1'):   // 1
                 XmToggleButtonGadgetSetState(soption1, TRUE, TRUE);
@@ -5219,7 +5219,7 @@ void Set_Del_Object( Widget w, XtPointer clientData, XtPointer calldata)
             }
 
             // Set the HAAT toggle
-            switch (p_station->signal_gain[4])
+            switch (EXTRA_DATA(p_station)->signal_gain[4])
             {
               case ('1'):   // 20ft
                 XmToggleButtonGadgetSetState(hoption1, TRUE, TRUE);
@@ -5255,7 +5255,7 @@ void Set_Del_Object( Widget w, XtPointer clientData, XtPointer calldata)
             }
 
             // Set the antenna gain toggle
-            switch (p_station->signal_gain[5])
+            switch (EXTRA_DATA(p_station)->signal_gain[5])
             {
               case ('1'):   // 1dB
                 XmToggleButtonGadgetSetState(goption1, TRUE, TRUE);
@@ -5291,7 +5291,7 @@ void Set_Del_Object( Widget w, XtPointer clientData, XtPointer calldata)
             }
 
             // Set the antenna directivity toggle
-            switch (p_station->signal_gain[6])
+            switch (EXTRA_DATA(p_station)->signal_gain[6])
             {
               case ('1'):   // 45
                 XmToggleButtonGadgetSetState(doption1, TRUE, TRUE);
@@ -5329,9 +5329,9 @@ void Set_Del_Object( Widget w, XtPointer clientData, XtPointer calldata)
 
             XmToggleButtonSetState(beam_antenna_toggle, TRUE, TRUE);
 
-            XmTextFieldSetString(ob_bearing_data, p_station->bearing);
+            XmTextFieldSetString(ob_bearing_data, EXTRA_DATA(p_station)->bearing);
 
-            switch (p_station->NRQ[2])
+            switch (EXTRA_DATA(p_station)->NRQ[2])
             {
               case ('1'):   // 240°
                 XmToggleButtonGadgetSetState(woption1, TRUE, TRUE);
@@ -0,0 +1,857 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 2000-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+
+#ifdef HAVE_CONFIG_H
+  #include "config.h"
+#endif  // HAVE_CONFIG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <utime.h>
+#include <sys/stat.h>
+
+#ifdef HAVE_MMAP
+  #include <sys/mman.h>
+#endif  // HAVE_MMAP
+
+#include "cache_utils.h"
+#include "raster_pyramid.h"
+#include "snprintf.h"
+
+// Must be last include file
+#include "leak_detection.h"
+
+
+
+#define RASTER_PYRAMID_MAGIC   0x58525031   // "XRP1"
+#define RASTER_PYRAMID_VERSION 1
+
+#define TILE RASTER_PYRAMID_TILE
+#define TILE_BYTES(header) ((size_t)TILE * TILE * (header)->bpp)
+
+
+
+
+
+// Name of the pyramid of map file "source", relative to the user's
+// base directory.  Maps of the same name live in different
+// directories, so the hash of the full path goes into it too.
+//
+void raster_pyramid_name(const char *source, char *name, int name_size)
+{
+  const char *base;
+
+
+  base = strrchr(source, '/');
+  base = (base) ? base + 1 : source;
+  xastir_snprintf(name, name_size, "raster_pyramid/%s-%08x.xrp",
+                  base, fnv1a_string(FNV1A_INIT, source));
+}
+
+
+
+
+
+// Number of levels and tiles for a level 0 of width x height.
+//
+static void pyramid_shape(uint32_t width, uint32_t height,
+                          uint32_t *levels, uint32_t *tile_count)
+{
+  uint32_t l = 0;
+  uint32_t w = width, h = height;
+
+
+  *tile_count = 0;
+  while (1)
+  {
+    *tile_count += ((w + TILE - 1) / TILE) * ((h + TILE - 1) / TILE);
+    if (w <= TILE && h <= TILE)
+    {
+      break;
+    }
+    l++;
+    w = (width + (1U << l) - 1) >> l;
+    h = (height + (1U << l) - 1) >> l;
+  }
+  *levels = l + 1;
+}
+
+
+
+
+
+// Tiles across and down "level", and the number of its first tile.
+//
+static uint32_t level_tiles(const raster_pyramid_header *header, int level,
+                            uint32_t *tiles_x, uint32_t *tiles_y)
+{
+  uint32_t first = 0;
+  int l;
+
+
+  for (l = 0; ; l++)
+  {
+    uint32_t w = (header->width + (1U << l) - 1) >> l;
+    uint32_t h = (header->height + (1U << l) - 1) >> l;
+
+    *tiles_x = (w + TILE - 1) / TILE;
+    *tiles_y = (h + TILE - 1) / TILE;
+    if (l == level)
+    {
+      return(first);
+    }
+    first += *tiles_x * *tiles_y;
+  }
+}
+
+
+
+
+
+static void clear_pixels(const raster_pyramid_header *header, uint8_t *pixels, size_t count)
+{
+  if (header->bpp == 1)
+  {
+    memset(pixels, header->transparent, count);
+  }
+  else
+  {
+    memset(pixels, 0, count * 4);
+  }
+}
+
+
+
+
+
+static int tile_is_empty(const raster_pyramid_header *header, const uint8_t *tile)
+{
+  size_t i;
+
+
+  if (header->bpp == 1)
+  {
+    for (i = 0; i < (size_t)TILE * TILE; i++)
+    {
+      if (tile[i] != header->transparent)
+      {
+        return(0);
+      }
+    }
+  }
+  else
+  {
+    for (i = 0; i < (size_t)TILE * TILE; i++)
+    {
+      if (((const uint32_t *)tile)[i] >> 24)
+      {
+        return(0);
+      }
+    }
+  }
+  return(1);
+}
+
+
+
+
+
+// Halve "child" into the quadrant of "tile" at (ox,oy).  A palette
+// pixel gets the most common drawn index of the four, an RGB pixel the
+// average of the drawn ones.
+//
+static void reduce_tile(const raster_pyramid_header *header, const uint8_t *child,
+                        uint8_t *tile, int ox, int oy)
+{
+  int i, j, k, m;
+
+
+  for (j = 0; j < TILE / 2; j++)
+  {
+    for (i = 0; i < TILE / 2; i++)
+    {
+      size_t src[4];
+      size_t dst = (size_t)(oy + j) * TILE + ox + i;
+
+      src[0] = (size_t)(2 * j) * TILE + 2 * i;
+      src[1] = src[0] + 1;
+      src[2] = src[0] + TILE;
+      src[3] = src[2] + 1;
+
+      if (header->bpp == 1)
+      {
+        int best = header->transparent, best_count = 0;
+
+        for (k = 0; k < 4; k++)
+        {
+          int count = 0;
+
+          if (child[src[k]] == header->transparent)
+          {
+            continue;
+          }
+          for (m = k; m < 4; m++)
+          {
+            if (child[src[m]] == child[src[k]])
+            {
+              count++;
+            }
+          }
+          if (count > best_count)
+          {
+            best = child[src[k]];
+            best_count = count;
+          }
+        }
+        tile[dst] = (uint8_t)best;
+      }
+      else
+      {
+        const uint32_t *c = (const uint32_t *)child;
+        uint32_t r = 0, g = 0, b = 0, n = 0;
+
+        for (k = 0; k < 4; k++)
+        {
+          uint32_t p = c[src[k]];
+
+          if (p >> 24)
+          {
+            r += (p >> 16) & 0xff;
+            g += (p >> 8) & 0xff;
+            b += p & 0xff;
+            n++;
+          }
+        }
+        ((uint32_t *)tile)[dst] = (n == 0) ? 0
+                                  : 0xff000000U | ((r / n) << 16) | ((g / n) << 8) | (b / n);
+      }
+    }
+  }
+}
+
+
+
+
+
+static int write_at(int fd, const void *buf, size_t length, off_t position)
+{
+  return(pwrite(fd, buf, length, position) == (ssize_t)length ? 0 : -1);
+}
+
+
+
+
+
+// Build the pyramid of a map and write it to "path", by way of a
+// temporary file so a reader never maps a half-written one.
+// "geometry" gives the georeferencing, size and pixel format of level
+// 0, whose rows "fill" supplies in order.  The others are made from
+// the level below.  Returns 0 on success.
+//
+int raster_pyramid_build(const char *path, const raster_pyramid_header *geometry,
+                         raster_pyramid_row_func fill, void *data)
+{
+  raster_pyramid_header header;
+  char temp_path[4096];
+  uint64_t *offset = NULL;
+  uint8_t *band = NULL, *tile = NULL, *child = NULL;
+  size_t tile_bytes, row_bytes;
+  off_t end;
+  uint32_t tiles_x, tiles_y, child_x, child_y, first, child_first;
+  uint32_t tx, ty;
+  int fd, level, row, q;
+  int ok = 0;
+
+
+  header = *geometry;
+  if (header.width == 0 || header.height == 0
+      || (header.bpp != 1 && header.bpp != 4)
+      || header.transparent > 255)
+  {
+    return(-1);
+  }
+  header.magic = RASTER_PYRAMID_MAGIC;
+  header.version = RASTER_PYRAMID_VERSION;
+  header.reserved = 0;
+  pyramid_shape(header.width, header.height, &header.levels, &header.tile_count);
+
+  tile_bytes = TILE_BYTES(&header);
+  row_bytes = (size_t)header.width * header.bpp;
+
+  xastir_snprintf(temp_path, sizeof(temp_path), "%s.%ld", path, (long)getpid());
+  fd = open(temp_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+  {
+    return(-1);
+  }
+
+  offset = calloc(header.tile_count, sizeof(uint64_t));
+  band = malloc(row_bytes * TILE);
+  tile = malloc(tile_bytes);
+  child = malloc(tile_bytes);
+  if (offset == NULL || band == NULL || tile == NULL || child == NULL)
+  {
+    goto done;
+  }
+  end = sizeof(header) + (off_t)header.tile_count * sizeof(uint64_t);
+
+  // Level 0, a band of tiles at a time
+  level_tiles(&header, 0, &tiles_x, &tiles_y);
+  for (ty = 0; ty < tiles_y; ty++)
+  {
+    for (row = 0; row < TILE; row++)
+    {
+      uint8_t *dst = band + row * row_bytes;
+
+      if (ty * TILE + row < header.height)
+      {
+        if (fill(data, ty * TILE + row, dst) != 0)
+        {
+          goto done;
+        }
+      }
+      else
+      {
+        clear_pixels(&header, dst, header.width);
+      }
+    }
+    for (tx = 0; tx < tiles_x; tx++)
+    {
+      size_t left = (size_t)tx * TILE;
+      size_t count = (header.width - left < TILE) ? header.width - left : TILE;
+
+      for (row = 0; row < TILE; row++)
+      {
+        uint8_t *dst = tile + (size_t)row * TILE * header.bpp;
+
+        memcpy(dst, band + row * row_bytes + left * header.bpp, count * header.bpp);
+        if (count < TILE)
+        {
+          clear_pixels(&header, dst + count * header.bpp, TILE - count);
+        }
+      }
+      if (!tile_is_empty(&header, tile))
+      {
+        if (write_at(fd, tile, tile_bytes, end) != 0)
+        {
+          goto done;
+        }
+        offset[ty * tiles_x + tx] = end;
+        end += tile_bytes;
+      }
+    }
+  }
+
+  // Each tile of the others from the four below it
+  for (level = 1; level < (int)header.levels; level++)
+  {
+    child_first = level_tiles(&header, level - 1, &child_x, &child_y);
+    first = level_tiles(&header, level, &tiles_x, &tiles_y);
+    for (ty = 0; ty < tiles_y; ty++)
+    {
+      for (tx = 0; tx < tiles_x; tx++)
+      {
+        int any = 0;
+
+        clear_pixels(&header, tile, (size_t)TILE * TILE);
+        for (q = 0; q < 4; q++)
+        {
+          uint32_t cx = 2 * tx + (q & 1);
+          uint32_t cy = 2 * ty + (q >> 1);
+          uint64_t at;
+
+          if (cx >= child_x || cy >= child_y)
+          {
+            continue;
+          }
+          at = offset[child_first + cy * child_x + cx];
+          if (at == 0)
+          {
+            continue;
+          }
+          if (pread(fd, child, tile_bytes, (off_t)at) != (ssize_t)tile_bytes)
+          {
+            goto done;
+          }
+          reduce_tile(&header, child, tile, (q & 1) * TILE / 2, (q >> 1) * TILE / 2);
+          any = 1;
+        }
+        if (any && !tile_is_empty(&header, tile))
+        {
+          if (write_at(fd, tile, tile_bytes, end) != 0)
+          {
+            goto done;
+          }
+          offset[first + ty * tiles_x + tx] = end;
+          end += tile_bytes;
+        }
+      }
+    }
+  }
+
+  if (write_at(fd, &header, sizeof(header), 0) == 0
+      && write_at(fd, offset, header.tile_count * sizeof(uint64_t), sizeof(header)) == 0)
+  {
+    ok = 1;
+  }
+
+done:
+  free(offset);
+  free(band);
+  free(tile);
+  free(child);
+  if (close(fd) != 0)
+  {
+    ok = 0;
+  }
+  if (!ok || rename(temp_path, path) != 0)
+  {
+    (void)unlink(temp_path);
+    return(-1);
+  }
+  return(0);
+}
+
+
+
+
+
+// Map a pyramid written by raster_pyramid_build().  Returns NULL if
+// it's missing, damaged, or was built from a different version of the
+// map, in which case the caller should rebuild it.  Its mtime is
+// bumped so raster_pyramid_trim() knows it's in use.
+//
+raster_pyramid *raster_pyramid_load(const char *path, time_t source_mtime, off_t source_size,
+                                    uint32_t variant)
+{
+  raster_pyramid *pyramid;
+  raster_pyramid_header *header;
+  struct stat sb;
+  uint32_t levels, tile_count, i;
+  int fd;
+
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0)
+  {
+    return(NULL);
+  }
+  if (fstat(fd, &sb) != 0 || (size_t)sb.st_size < sizeof(raster_pyramid_header))
+  {
+    close(fd);
+    return(NULL);
+  }
+
+  pyramid = calloc(1, sizeof(raster_pyramid));
+  if (pyramid == NULL)
+  {
+    close(fd);
+    return(NULL);
+  }
+  pyramid->length = sb.st_size;
+
+#ifdef HAVE_MMAP
+  pyramid->block = mmap(NULL, pyramid->length, PROT_READ, MAP_SHARED, fd, 0);
+  if (pyramid->block == MAP_FAILED)
+  {
+    pyramid->block = NULL;
+  }
+  else
+  {
+    pyramid->mapped = 1;
+  }
+#else   // HAVE_MMAP
+  pyramid->block = malloc(pyramid->length);
+  if (pyramid->block != NULL
+      && read(fd, pyramid->block, pyramid->length) != (ssize_t)pyramid->length)
+  {
+    free(pyramid->block);
+    pyramid->block = NULL;
+  }
+#endif  // HAVE_MMAP
+  close(fd);
+
+  if (pyramid->block == NULL)
+  {
+    free(pyramid);
+    return(NULL);
+  }
+
+  header = (raster_pyramid_header *)pyramid->block;
+  if (header->magic != RASTER_PYRAMID_MAGIC
+      || header->version != RASTER_PYRAMID_VERSION
+      || header->source_mtime != (int64_t)source_mtime
+      || header->source_size != (int64_t)source_size
+      || header->variant != variant
+      || header->width == 0 || header->height == 0
+      || (header->bpp != 1 && header->bpp != 4))
+  {
+    raster_pyramid_free(pyramid);
+    return(NULL);
+  }
+  pyramid_shape(header->width, header->height, &levels, &tile_count);
+  if (header->levels != levels || header->tile_count != tile_count
+      || pyramid->length < sizeof(raster_pyramid_header) + (size_t)tile_count * sizeof(uint64_t))
+  {
+    raster_pyramid_free(pyramid);
+    return(NULL);
+  }
+
+  pyramid->header = header;
+  pyramid->offset = (uint64_t *)((char *)pyramid->block + sizeof(raster_pyramid_header));
+  for (i = 0; i < tile_count; i++)
+  {
+    if (pyramid->offset[i] != 0
+        && (pyramid->offset[i] < sizeof(raster_pyramid_header) + (size_t)tile_count * sizeof(uint64_t)
+            || pyramid->offset[i] + TILE_BYTES(header) > pyramid->length))
+    {
+      raster_pyramid_free(pyramid);
+      return(NULL);
+    }
+  }
+
+  (void)utime(path, NULL);
+  return(pyramid);
+}
+
+
+
+
+
+void raster_pyramid_free(raster_pyramid *pyramid)
+{
+  if (pyramid == NULL)
+  {
+    return;
+  }
+#ifdef HAVE_MMAP
+  if (pyramid->mapped)
+  {
+    (void)munmap(pyramid->block, pyramid->length);
+  }
+  else
+#endif  // HAVE_MMAP
+  {
+    free(pyramid->block);
+  }
+  free(pyramid);
+}
+
+
+
+
+
+// The coarsest level whose pixels are no bigger than a screen pixel
+// of "scale_x" by "scale_y" Xastir units.
+//
+int raster_pyramid_level(raster_pyramid *pyramid, double scale_x, double scale_y)
+{
+  double step_x, step_y;
+  int level = 0;
+
+
+  step_x = pyramid->header->step_x;
+  step_y = pyramid->header->step_y;
+  while (level + 1 < (int)pyramid->header->levels
+         && step_x * 2.0 <= scale_x
+         && step_y * 2.0 <= scale_y)
+  {
+    step_x *= 2.0;
+    step_y *= 2.0;
+    level++;
+  }
+  return(level);
+}
+
+
+
+
+
+void raster_pyramid_level_size(raster_pyramid *pyramid, int level, int *width, int *height)
+{
+  *width = (pyramid->header->width + (1U << level) - 1) >> level;
+  *height = (pyramid->header->height + (1U << level) - 1) >> level;
+}
+
+
+
+
+
+// Pixels of one tile, TILE rows of TILE, or NULL if the tile has
+// nothing to draw or is outside the level.
+//
+const uint8_t *raster_pyramid_tile(raster_pyramid *pyramid, int level, int tile_x, int tile_y)
+{
+  uint32_t tiles_x, tiles_y, first;
+  uint64_t at;
+
+
+  if (level < 0 || level >= (int)pyramid->header->levels || tile_x < 0 || tile_y < 0)
+  {
+    return(NULL);
+  }
+  first = level_tiles(pyramid->header, level, &tiles_x, &tiles_y);
+  if ((uint32_t)tile_x >= tiles_x || (uint32_t)tile_y >= tiles_y)
+  {
+    return(NULL);
+  }
+  at = pyramid->offset[first + tile_y * tiles_x + tile_x];
+  return((at == 0) ? NULL : (const uint8_t *)pyramid->block + at);
+}
+
+
+
+
+
+// Copy columns "first" to "last" of row "row" of a level into "line",
+// bpp bytes per pixel.  Pixels in tiles that aren't stored come out
+// transparent.
+//
+void raster_pyramid_line(raster_pyramid *pyramid, int level, int row,
+                         int first, int last, void *line)
+{
+  const uint8_t *tile;
+  uint8_t *out = (uint8_t *)line;
+  size_t bpp = pyramid->header->bpp;
+  int column, next;
+
+
+  for (column = first; column <= last; column = next)
+  {
+    next = (column / RASTER_PYRAMID_TILE + 1) * RASTER_PYRAMID_TILE;
+    if (next > last + 1)
+    {
+      next = last + 1;
+    }
+
+    tile = raster_pyramid_tile(pyramid, level, column / RASTER_PYRAMID_TILE,
+                               row / RASTER_PYRAMID_TILE);
+    if (tile)
+    {
+      memcpy(out + (column - first) * bpp,
+             tile + ((size_t)(row % RASTER_PYRAMID_TILE) * RASTER_PYRAMID_TILE
+                     + column % RASTER_PYRAMID_TILE) * bpp,
+             (next - column) * bpp);
+    }
+    else
+    {
+      memset(out + (column - first) * bpp,
+             (bpp == 1) ? (int)pyramid->header->transparent : 0,
+             (next - column) * bpp);
+    }
+  }
+}
+
+
+
+
+
+// Bilinear resampling of two 0xAARRGGBB lines into "count" output
+// pixels.  Output pixel i mixes columns column[i] and column1[i] of
+// both lines, weight_x[i] and weight_y (0-256) being how far towards
+// column1[i] and line1 it is.  Where any of the four is transparent
+// the nearest of them is used as is, so map edges stay sharp.  The
+// loop has no calls and only integer math, so compilers vectorize it.
+//
+void raster_pyramid_bilinear(const uint32_t *line0, const uint32_t *line1,
+                             const int *column, const int *column1,
+                             const int *weight_x, int weight_y,
+                             int count, uint32_t *out)
+{
+  uint32_t a, b, c, d, value;
+  int i, wx, shift, top, bottom;
+
+
+  for (i = 0; i < count; i++)
+  {
+    if (column[i] < 0)
+    {
+      out[i] = 0;
+      continue;
+    }
+    a = line0[column[i]];
+    b = line0[column1[i]];
+    c = line1[column[i]];
+    d = line1[column1[i]];
+    wx = weight_x[i];
+
+    if ((a >> 24) && (b >> 24) && (c >> 24) && (d >> 24))
+    {
+      value = 0xff000000;
+      for (shift = 0; shift < 24; shift += 8)
+      {
+        top = (int)((a >> shift) & 0xff) * (256 - wx) + (int)((b >> shift) & 0xff) * wx;
+        bottom = (int)((c >> shift) & 0xff) * (256 - wx) + (int)((d >> shift) & 0xff) * wx;
+        value |= (uint32_t)(((top * (256 - weight_y) + bottom * weight_y) >> 16) & 0xff) << shift;
+      }
+      out[i] = value;
+    }
+    else if (weight_y < 128)
+    {
+      out[i] = (wx < 128) ? a : b;
+    }
+    else
+    {
+      out[i] = (wx < 128) ? c : d;
+    }
+  }
+}
+
+
+
+
+
+// Where (x,y) lies within the quadrilateral with corners qx[],qy[]
+// (top left, top right, bottom left, bottom right), as the fractions
+// (u,v) across and down it, for maps that aren't north-up.  Solves the
+// bilinear mapping by Newton's method.  Returns 0 on success.
+//
+int raster_pyramid_quad_uv(const double qx[4], const double qy[4], double x, double y,
+                           double *u, double *v)
+{
+  double uu = 0.5, vv = 0.5;
+  int i;
+
+
+  for (i = 0; i < 20; i++)
+  {
+    double fx = (1 - uu) * (1 - vv) * qx[0] + uu * (1 - vv) * qx[1]
+                + (1 - uu) * vv * qx[2] + uu * vv * qx[3] - x;
+    double fy = (1 - uu) * (1 - vv) * qy[0] + uu * (1 - vv) * qy[1]
+                + (1 - uu) * vv * qy[2] + uu * vv * qy[3] - y;
+    double dxu = (1 - vv) * (qx[1] - qx[0]) + vv * (qx[3] - qx[2]);
+    double dyu = (1 - vv) * (qy[1] - qy[0]) + vv * (qy[3] - qy[2]);
+    double dxv = (1 - uu) * (qx[2] - qx[0]) + uu * (qx[3] - qx[1]);
+    double dyv = (1 - uu) * (qy[2] - qy[0]) + uu * (qy[3] - qy[1]);
+    double det = dxu * dyv - dxv * dyu;
+    double du, dv;
+
+    if (fabs(det) < 1e-12)
+    {
+      return(-1);
+    }
+    du = (fx * dyv - fy * dxv) / det;
+    dv = (fy * dxu - fx * dyu) / det;
+    uu -= du;
+    vv -= dv;
+    if (fabs(du) < 1e-10 && fabs(dv) < 1e-10)
+    {
+      *u = uu;
+      *v = vv;
+      return(0);
+    }
+  }
+  return(-1);
+}
+
+
+
+
+
+typedef struct
+{
+  char name[256];
+  off_t size;
+  time_t mtime;
+} pyramid_file;
+
+static int compare_mtime(const void *a, const void *b)
+{
+  const pyramid_file *fa = a, *fb = b;
+
+  return((fa->mtime > fb->mtime) - (fa->mtime < fb->mtime));
+}
+
+
+
+
+
+// Delete the least recently used pyramids in "dir" until the rest
+// take up no more than "max_bytes".  Returns the bytes left.
+//
+off_t raster_pyramid_trim(const char *dir, off_t max_bytes)
+{
+  DIR *d;
+  struct dirent *e;
+  struct stat sb;
+  pyramid_file *files = NULL, *more;
+  int count = 0, size = 0, i;
+  off_t total = 0;
+  char path[4096];
+
+
+  d = opendir(dir);
+  if (d == NULL)
+  {
+    return(0);
+  }
+  while ((e = readdir(d)) != NULL)
+  {
+    size_t len = strlen(e->d_name);
+
+    if (len < 5 || len >= sizeof(files->name) || strcmp(e->d_name + len - 4, ".xrp") != 0)
+    {
+      continue;
+    }
+    xastir_snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+    if (stat(path, &sb) != 0)
+    {
+      continue;
+    }
+    if (count == size)
+    {
+      size = (size) ? size * 2 : 64;
+      more = realloc(files, size * sizeof(pyramid_file));
+      if (more == NULL)
+      {
+        break;
+      }
+      files = more;
+    }
+    xastir_snprintf(files[count].name, sizeof(files[count].name), "%s", e->d_name);
+    files[count].size = sb.st_size;
+    files[count].mtime = sb.st_mtime;
+    total += sb.st_size;
+    count++;
+  }
+  closedir(d);
+
+  if (count > 0)
+  {
+    qsort(files, count, sizeof(pyramid_file), compare_mtime);
+  }
+  for (i = 0; i < count && total > max_bytes; i++)
+  {
+    xastir_snprintf(path, sizeof(path), "%s/%s", dir, files[i].name);
+    if (unlink(path) == 0)
+    {
+      total -= files[i].size;
+    }
+  }
+  free(files);
+  return(total);
+}
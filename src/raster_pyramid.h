@@ -0,0 +1,90 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 2000-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+#ifndef __XASTIR_RASTER_PYRAMID_H
+#define __XASTIR_RASTER_PYRAMID_H
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+
+// Pre-scaled copy of a raster map, kept on disk.  Level 0 is the map
+// resampled onto a north-up grid in Xastir coordinates, so drawing it
+// is a lookup per screen pixel instead of a reprojection per map
+// pixel.  Each following level halves the resolution, down to a level
+// that fits in one tile.  Every level is cut into square tiles, and
+// tiles with nothing to draw aren't stored at all.
+//
+// A pixel is either a palette index (1 byte, "transparent" is the one
+// that isn't drawn) or 0xAARRGGBB (4 bytes, drawn unless AA is 0).
+//
+// The file carries the size and mtime of the map it was built from and
+// a caller-supplied "variant" (a hash of whatever else went into the
+// pixels, e.g. crop and gamma settings), and is rejected on load if
+// any of them has changed.
+#define RASTER_PYRAMID_TILE 256
+
+typedef struct
+{
+  uint32_t magic;             // Also catches files from the other byte order
+  uint32_t version;
+  int64_t source_mtime;
+  int64_t source_size;
+  uint32_t variant;
+  uint32_t width;             // Level 0 size in pixels
+  uint32_t height;
+  uint32_t bpp;               // Bytes per pixel, 1 or 4
+  uint32_t transparent;       // Palette index that isn't drawn
+  uint32_t levels;
+  uint32_t tile_count;        // All levels
+  uint32_t reserved;
+  double x0;                  // Xastir coordinates of the top left
+  double y0;                  //  corner of level 0
+  double step_x;              // Size of a level 0 pixel in Xastir
+  double step_y;              //  coordinates
+} raster_pyramid_header;
+
+typedef struct
+{
+  raster_pyramid_header *header;
+  uint64_t *offset;           // Of each tile in block, 0 if empty
+  void *block;                // header, offset, tiles
+  size_t length;
+  int mapped;                 // block is mmap()ed rather than malloc()ed
+} raster_pyramid;
+
+// Fills row "row" of level 0, header->width pixels, for
+// raster_pyramid_build().  Returns 0, or -1 to give up.
+typedef int (*raster_pyramid_row_func)(void *data, int row, uint8_t *pixels);
+
+extern void raster_pyramid_name(const char *source, char *name, int name_size);
+extern int raster_pyramid_build(const char *path, const raster_pyramid_header *geometry, raster_pyramid_row_func fill, void *data);
+extern raster_pyramid *raster_pyramid_load(const char *path, time_t source_mtime, off_t source_size, uint32_t variant);
+extern void raster_pyramid_free(raster_pyramid *pyramid);
+extern int raster_pyramid_level(raster_pyramid *pyramid, double scale_x, double scale_y);
+extern void raster_pyramid_level_size(raster_pyramid *pyramid, int level, int *width, int *height);
+extern const uint8_t *raster_pyramid_tile(raster_pyramid *pyramid, int level, int tile_x, int tile_y);
+extern void raster_pyramid_line(raster_pyramid *pyramid, int level, int row, int first, int last, void *line);
+extern void raster_pyramid_bilinear(const uint32_t *line0, const uint32_t *line1, const int *column, const int *column1, const int *weight_x, int weight_y, int count, uint32_t *out);
+extern int raster_pyramid_quad_uv(const double qx[4], const double qy[4], double x, double y, double *u, double *v);
+extern off_t raster_pyramid_trim(const char *dir, off_t max_bytes);
+
+#endif
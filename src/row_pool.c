@@ -0,0 +1,216 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 1999,2000  Frank Giannandrea
+ * Copyright (C) 2000-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+#ifdef HAVE_CONFIG_H
+  #include "config.h"
+#endif  // HAVE_CONFIG_H
+
+#include <stdlib.h>
+
+#include "row_pool.h"
+
+// Must be last include file
+#include "leak_detection.h"
+
+
+
+#define ROW_POOL_SLAB_BYTES 65536       // Aim for slabs about this size
+#define ROW_POOL_MIN_ROWS   16
+
+// Slab header.  The union keeps the records after it aligned for
+// anything they might hold.
+typedef union _row_pool_slab
+{
+  union _row_pool_slab *next;
+  double d;
+  long l;
+  void *p;
+} row_pool_slab;
+
+
+
+
+
+static void row_pool_setup(row_pool *pool)
+{
+  size_t align = sizeof(row_pool_slab);
+
+
+  pool->stride = pool->row_size;
+  if (pool->stride < sizeof(void *))
+  {
+    pool->stride = sizeof(void *);  // room for the free list link
+  }
+  pool->stride = (pool->stride + align - 1) / align * align;
+
+  pool->rows_per_slab = ROW_POOL_SLAB_BYTES / pool->stride;
+  if (pool->rows_per_slab < ROW_POOL_MIN_ROWS)
+  {
+    pool->rows_per_slab = ROW_POOL_MIN_ROWS;
+  }
+}
+
+
+
+
+
+// Get an uninitialized record, like malloc().  Returns NULL if out of
+// memory.
+//
+void *row_pool_alloc(row_pool *pool)
+{
+  row_pool_slab *slab;
+  void *row;
+
+
+  if (pool->free_rows != NULL)
+  {
+    row = pool->free_rows;
+    pool->free_rows = *(void **)row;
+  }
+  else
+  {
+    if (pool->stride == 0)
+    {
+      row_pool_setup(pool);
+    }
+
+    if (pool->current_slab == NULL || pool->next_row == pool->rows_per_slab)
+    {
+      slab = (row_pool_slab *)pool->current_slab;
+
+      if (slab != NULL && slab->next != NULL)
+      {
+        // Reuse a slab kept by row_pool_reset()
+        slab = slab->next;
+      }
+      else
+      {
+        row_pool_slab *new_slab;
+
+        new_slab = (row_pool_slab *)malloc(sizeof(row_pool_slab)
+                                           + pool->stride * pool->rows_per_slab);
+        if (new_slab == NULL)
+        {
+          return(NULL);
+        }
+        new_slab->next = NULL;
+        if (slab == NULL)
+        {
+          pool->slabs = new_slab;
+        }
+        else
+        {
+          slab->next = new_slab;
+        }
+        slab = new_slab;
+        pool->slab_count++;
+      }
+      pool->current_slab = slab;
+      pool->next_row = 0;
+    }
+
+    row = (char *)pool->current_slab + sizeof(row_pool_slab)
+          + pool->stride * pool->next_row;
+    pool->next_row++;
+  }
+
+  pool->live++;
+  if (pool->live > pool->peak)
+  {
+    pool->peak = pool->live;
+  }
+  return(row);
+}
+
+
+
+
+
+// Hand a record back.  It must have come from this pool.
+//
+void row_pool_free(row_pool *pool, void *row)
+{
+  if (row == NULL)
+  {
+    return;
+  }
+  *(void **)row = pool->free_rows;
+  pool->free_rows = row;
+  pool->live--;
+}
+
+
+
+
+
+// Forget every record in the pool at once.  The slabs are kept and
+// reused, so this doesn't depend on how many records there were.
+// Nothing may use the old records afterwards.
+//
+void row_pool_reset(row_pool *pool)
+{
+  pool->free_rows = NULL;
+  pool->current_slab = NULL;
+  pool->next_row = 0;
+  pool->live = 0;
+
+  // Start carving again from the first slab
+  if (pool->slabs != NULL)
+  {
+    pool->current_slab = pool->slabs;
+  }
+}
+
+
+
+
+
+// Reset the pool and give its memory back to the system.
+//
+void row_pool_release(row_pool *pool)
+{
+  row_pool_slab *slab;
+  row_pool_slab *next;
+
+
+  for (slab = (row_pool_slab *)pool->slabs; slab != NULL; slab = next)
+  {
+    next = slab->next;
+    free(slab);
+  }
+  pool->slabs = NULL;
+  pool->slab_count = 0;
+  row_pool_reset(pool);
+}
+
+
+
+
+
+// Memory held by the pool, in use or not.
+//
+unsigned long row_pool_bytes(row_pool *pool)
+{
+  return(pool->slab_count
+         * (sizeof(row_pool_slab) + pool->stride * pool->rows_per_slab));
+}
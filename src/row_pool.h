@@ -0,0 +1,56 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 1999,2000  Frank Giannandrea
+ * Copyright (C) 2000-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+#ifndef __XASTIR_ROW_POOL_H
+#define __XASTIR_ROW_POOL_H
+
+#include <stddef.h>
+
+// Fixed-size record allocator for the small records hung off each
+// station (comments, multipoints).  Records are carved out of large
+// slabs and freed records go on a free list, so the heap doesn't see
+// one malloc/free per record.  row_pool_reset() drops every record
+// at once while keeping the slabs for reuse.
+typedef struct
+{
+  const char *name;           // For the statistics display
+  size_t row_size;            // Requested record size
+  size_t stride;              // Record size rounded up for alignment
+  int rows_per_slab;
+  void *slabs;                // All slabs, linked through their header
+  void *current_slab;         // Slab new records are carved from
+  int next_row;               // Next unused record in current_slab
+  void *free_rows;            // Freed records, linked through their first word
+  unsigned long live;         // Records handed out and not freed
+  unsigned long peak;         // Highest "live" seen
+  unsigned long slab_count;   // Slabs allocated
+} row_pool;
+
+#define ROW_POOL_INIT(name, size) { name, size, 0, 0, NULL, NULL, 0, NULL, 0, 0, 0 }
+
+extern void *row_pool_alloc(row_pool *pool);
+extern void row_pool_free(row_pool *pool, void *row);
+extern void row_pool_reset(row_pool *pool);
+extern void row_pool_release(row_pool *pool);
+extern unsigned long row_pool_bytes(row_pool *pool);
+
+#endif
@@ -30,6 +30,9 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 #if HAVE_SYS_TIME_H
   #include <sys/time.h>
@@ -54,9 +57,13 @@
 #include "util.h"
 #include "hashtable.h"
 #include "hashtable_itr.h"
+#include "awk.h"
+#include "dbfawk.h"
 /// THIS ONLY FOR DEBUGGING!
 //#include "hashtable_private.h"
 #include "shp_hash.h"
+#include "cache_utils.h"
+#include "xa_config.h"
 #include "snprintf.h"
 
 // Must be last include file
@@ -75,6 +82,30 @@ static time_t purge_time;
 
 #define SHP_HASH_SIZE 65535
 
+// Shapes decoded by draw_shapefile_map(), kept with their vertices in
+// Xastir coordinates so that a redraw at a new offset or zoom only
+// costs an integer transform per vertex.  Entries hang off their
+// shpinfo by shape number and are on one LRU list across all files,
+// evicted from the tail once SHP_CACHE_BUDGET is exceeded.
+typedef struct _shp_cache_entry
+{
+  lru_link lru;                     // Must be first
+  shpinfo *si;
+  int shape;
+  unsigned long bytes;
+  SHPObject *object;
+  unsigned long *xy;                // Xastir x,y for each vertex
+  char *ok;                         // Whether each vertex converted, NULL if all did
+} shp_cache_entry;
+
+static lru_list cache_lru={ NULL, NULL };
+static unsigned long cache_bytes=0;
+
+// The entry last handed out, for shp_cache_vertex()
+static shp_cache_entry *cache_current=NULL;
+
+static void shp_cache_remove(shp_cache_entry *entry);
+
 
 unsigned int shape_hash_from_key(void *key)
 {
@@ -160,10 +191,30 @@ void empty_shpinfo(shpinfo *si)
 {
   if (si)
   {
-    if (si->root)
+    if (si->index)
     {
-      Xastir_RTreeDestroyNode(si->root);
-      si->root=NULL;
+      shp_index_free(si->index);
+      si->index=NULL;
+    }
+    if (si->shapes)
+    {
+      int i;
+
+      for (i = 0; i < si->shape_count; i++)
+      {
+        if (si->shapes[i])
+        {
+          shp_cache_remove(si->shapes[i]);
+        }
+      }
+      free(si->shapes);
+      si->shapes=NULL;
+      cache_bytes -= si->shape_count * sizeof(shp_cache_entry *);
+    }
+    if (si->memo)
+    {
+      dbfawk_memo_free(si->memo);
+      si->memo=NULL;
     }
 
     // The hashtable functions free the
@@ -245,11 +296,21 @@ void add_shp_to_hash(char *filename, SHPHandle sHP)
   temp->filename[filenm_len]='\0';  // just to be safe
 //    xastir_snprintf(temp->filename,sizeof(shpinfo),"%s",filename);
 
-  temp->root = Xastir_RTreeNewIndex();
   temp->creation = sec_now();
   temp->last_access = temp->creation;
+  temp->num_accesses = 0;
+  temp->shapes = NULL;
+  temp->memo = NULL;
+  SHPGetInfo(sHP, &temp->shape_count, NULL, NULL, NULL);
 
-  build_rtree(&(temp->root),sHP);
+  temp->index = build_shp_index(filename,sHP);
+  if (!temp->index)
+  {
+    fprintf(stderr,"Couldn't index shapefile %s --- fatal\n",filename);
+    free(temp->filename);
+    free(temp);
+    exit(1);
+  }
 
   if (!hashtable_insert(shp_hash,temp->filename,temp))
   {
@@ -289,37 +350,312 @@ shpinfo *get_shp_from_hash(char *filename)
 
 
 
-//CAREFUL:  note how adding things to the tree can change the root
-// Must not ever use cache a value of the root pointer if there's any
-// chance that the tree needs to be expanded!
-void build_rtree (struct Node **root, SHPHandle sHP)
+static void shp_cache_remove(shp_cache_entry *entry)
+{
+  lru_unlink(&cache_lru, &entry->lru);
+  entry->si->shapes[entry->shape] = NULL;
+  cache_bytes -= entry->bytes;
+  if (cache_current == entry)
+  {
+    cache_current = NULL;
+  }
+  SHPDestroyObject(entry->object);
+  free(entry->xy);
+  free(entry->ok);
+  free(entry);
+}
+
+
+
+
+
+// Is this shape in the cache?  Doesn't count as a use.
+int shp_cache_has(shpinfo *si, int shape)
+{
+  return (si && si->shapes && shape >= 0 && shape < si->shape_count
+          && si->shapes[shape] != NULL);
+}
+
+
+
+
+
+// Get a cached shape, or NULL.  The cache keeps ownership; the shape
+// stays valid until the next shp_cache_add().
+SHPObject *shp_cache_get(shpinfo *si, int shape)
+{
+  shp_cache_entry *entry;
+
+  cache_current = NULL;
+  if (!shp_cache_has(si, shape))
+  {
+    return(NULL);
+  }
+
+  entry = si->shapes[shape];
+  lru_unlink(&cache_lru, &entry->lru);
+  lru_push(&cache_lru, &entry->lru);
+  cache_current = entry;
+  return(entry->object);
+}
+
+
+
+
+
+// Hand a shape just read to the cache, with its vertices in Xastir
+// coordinates if they were already converted ("xy" holds x,y pairs,
+// "ok" flags the vertices that converted, NULL if all did).  The
+// cache takes "xy" and "ok" either way.  Returns 1 if the cache took
+// "object" too, 0 if the caller still has to SHPDestroyObject() it.
+int shp_cache_add(shpinfo *si, int shape, SHPObject *object, unsigned long *xy, char *ok)
+{
+  shp_cache_entry *entry;
+  int vertex;
+  int all_ok = 1;
+
+  cache_current = NULL;
+  if (!si || shape < 0 || shape >= si->shape_count)
+  {
+    free(xy);
+    free(ok);
+    return(0);
+  }
+  if (!si->shapes)
+  {
+    si->shapes = calloc(si->shape_count, sizeof(shp_cache_entry *));
+    if (!si->shapes)
+    {
+      free(xy);
+      free(ok);
+      return(0);
+    }
+    cache_bytes += si->shape_count * sizeof(shp_cache_entry *);
+  }
+  if (si->shapes[shape])
+  {
+    shp_cache_remove(si->shapes[shape]);
+  }
+
+  if (!xy && object->nVertices > 0)
+  {
+    xy = malloc(2 * object->nVertices * sizeof(unsigned long));
+    ok = malloc(object->nVertices);
+    if (!xy || !ok)
+    {
+      free(xy);
+      free(ok);
+      return(0);
+    }
+    for (vertex = 0; vertex < object->nVertices; vertex++)
+    {
+      ok[vertex] = convert_to_xastir_coordinates(&xy[2*vertex],
+                   &xy[2*vertex+1],
+                   (float)object->padfX[vertex],
+                   (float)object->padfY[vertex]);
+      all_ok &= ok[vertex];
+    }
+    if (all_ok)
+    {
+      free(ok);
+      ok = NULL;
+    }
+  }
+
+  entry = (shp_cache_entry *)malloc(sizeof(shp_cache_entry));
+  if (!entry)
+  {
+    free(xy);
+    free(ok);
+    return(0);
+  }
+  entry->si = si;
+  entry->shape = shape;
+  entry->object = object;
+  entry->xy = xy;
+  entry->ok = ok;
+  entry->bytes = sizeof(shp_cache_entry) + sizeof(SHPObject)
+                 + object->nVertices * (4 * sizeof(double) + 2 * sizeof(unsigned long))
+                 + object->nParts * 2 * sizeof(int)
+                 + ((ok) ? object->nVertices : 0);
+
+  si->shapes[shape] = entry;
+  lru_push(&cache_lru, &entry->lru);
+  cache_bytes += entry->bytes;
+
+  // Make room, keeping the shape we were just given
+  while (cache_bytes > SHP_CACHE_BUDGET && cache_lru.tail && cache_lru.tail != &entry->lru)
+  {
+    shp_cache_remove((shp_cache_entry *)cache_lru.tail);
+  }
+
+  cache_current = entry;
+  return(1);
+}
+
+
+
+
+
+// If "object" is the shape last returned by shp_cache_get() or given
+// to shp_cache_add(), fill in the Xastir coordinates of "vertex" and
+// whether they converted, and return 1.
+int shp_cache_vertex(SHPObject *object, int vertex, unsigned long *x, unsigned long *y, int *ok)
+{
+  if (!cache_current || cache_current->object != object
+      || !cache_current->xy || vertex < 0 || vertex >= object->nVertices)
+  {
+    return(0);
+  }
+
+  *x = cache_current->xy[2*vertex];
+  *y = cache_current->xy[2*vertex+1];
+  *ok = (cache_current->ok) ? cache_current->ok[vertex] : 1;
+  return(1);
+}
+
+
+
+
+
+// Bytes held by the shape cache
+unsigned long shp_cache_bytes(void)
+{
+  return(cache_bytes);
+}
+
+
+
+
+
+// Find the .shp file behind "filename" (which may or may not carry
+// the extension, as SHPOpen() allows) and the name of its index in
+// the user's shp_index directory.  Returns 0 if the .shp can't be
+// found.
+static int shp_index_cache_path(char *filename, struct stat *sb,
+                                char *index_path, int index_path_size)
+{
+  char shp_path[MAX_FILENAME];
+  char index_name[MAX_FILENAME];
+  char *base;
+
+  xastir_snprintf(shp_path, sizeof(shp_path), "%s", filename);
+  if (stat(shp_path, sb) != 0)
+  {
+    xastir_snprintf(shp_path, sizeof(shp_path), "%s.shp", filename);
+    if (stat(shp_path, sb) != 0)
+    {
+      return(0);
+    }
+  }
+
+  // Maps of the same name live in different directories, so the hash
+  // of the full path goes into the index name too.
+  base = strrchr(shp_path, '/');
+  base = (base) ? base + 1 : shp_path;
+  xastir_snprintf(index_name, sizeof(index_name), "shp_index/%s-%08x.xri",
+                  base, shape_hash_from_key(shp_path));
+  get_user_base_dir(index_name, index_path, index_path_size);
+  return(1);
+}
+
+
+
+
+
+// Return the spatial index of a shapefile.  A previously saved index
+// is memory-mapped if it matches the .shp file's size and mtime, so a
+// cold draw only reads the shapes that intersect the viewport.
+// Otherwise we read every shape, bulk-load a packed index of their
+// bounding boxes, simplify the lines and polygons for coarse zooms,
+// and save it all for next time.
+shp_index *build_shp_index(char *filename, SHPHandle sHP)
 {
   int nEntities;
-  intptr_t i;
+  int nShapeType;
+  int i;
   SHPObject    *psCShape;
-  struct Rect bbox_shape;
-  SHPGetInfo(sHP, &nEntities, NULL, NULL, NULL);
+  shp_index_entry *entries;
+  shp_index *index;
+  shp_index_lod lod;
+  int use_lod;
+  int closed;
+  struct stat sb;
+  char index_path[MAX_FILENAME];
+  int have_path;
+
+  have_path = shp_index_cache_path(filename, &sb, index_path, sizeof(index_path));
+  if (have_path)
+  {
+    index = shp_index_load(index_path, sb.st_mtime, sb.st_size);
+    if (index)
+    {
+      return(index);
+    }
+  }
+
+  SHPGetInfo(sHP, &nEntities, &nShapeType, NULL, NULL);
+  entries = (shp_index_entry *)malloc((nEntities + 1) * sizeof(shp_index_entry));
+  CHECKMALLOC(entries);
+
+  closed = (nShapeType == SHPT_POLYGON || nShapeType == SHPT_POLYGONZ);
+  use_lod = (closed || nShapeType == SHPT_ARC || nShapeType == SHPT_ARCZ)
+            && shp_index_lod_init(&lod, nEntities);
   for( i = 0; i < nEntities; i++ )
   {
+    // Shapes shapelib can't read get an inverted box, which
+    // shp_index_build() leaves out
+    entries[i].rect.boundary[0]=1;
+    entries[i].rect.boundary[1]=1;
+    entries[i].rect.boundary[2]=0;
+    entries[i].rect.boundary[3]=0;
+    entries[i].id=i+1;    // The search callback subtracts one again
+
     psCShape = SHPReadObject ( sHP, i );
     if (psCShape != NULL)
     {
-      bbox_shape.boundary[0]=(RectReal) psCShape->dfXMin;
-      bbox_shape.boundary[1]=(RectReal) psCShape->dfYMin;
-      bbox_shape.boundary[2]=(RectReal) psCShape->dfXMax;
-      bbox_shape.boundary[3]=(RectReal) psCShape->dfYMax;
-      SHPDestroyObject ( psCShape );
-      // Only insert the rect if it will not fail the assertion in
-      // Xastir_RTreeInsertRect --- this will cause us to ignore any shapes that
-      // have invalid bboxes (or that return invalid bboxes from shapelib
-      // for whatever reason
-      if (bbox_shape.boundary[0] <= bbox_shape.boundary[2] &&
-          bbox_shape.boundary[1] <= bbox_shape.boundary[3])
+      entries[i].rect.boundary[0]=(RectReal) psCShape->dfXMin;
+      entries[i].rect.boundary[1]=(RectReal) psCShape->dfYMin;
+      entries[i].rect.boundary[2]=(RectReal) psCShape->dfXMax;
+      entries[i].rect.boundary[3]=(RectReal) psCShape->dfYMax;
+      if (use_lod)
       {
-        Xastir_RTreeInsertRect(&bbox_shape, (void *)(i+1), root, 0);
+        int first_part = 0;
+
+        use_lod = shp_index_lod_add_shape(&lod, i,
+                                          psCShape->padfX,
+                                          psCShape->padfY,
+                                          psCShape->nVertices,
+                                          (psCShape->nParts > 0) ? psCShape->panPartStart : &first_part,
+                                          (psCShape->nParts > 0) ? psCShape->nParts : 1,
+                                          closed);
+        if (!use_lod)
+        {
+          shp_index_lod_free(&lod);   // Out of memory, do without
+        }
       }
+      SHPDestroyObject ( psCShape );
+    }
+  }
+
+  index = shp_index_build(entries, nEntities,
+                          have_path ? sb.st_mtime : 0,
+                          have_path ? sb.st_size : 0,
+                          use_lod ? &lod : NULL);
+  free(entries);
+  if (use_lod)
+  {
+    shp_index_lod_free(&lod);
+  }
+
+  if (index && have_path)
+  {
+    if (shp_index_save(index, index_path) != 0 && (debug_level & 16))
+    {
+      fprintf(stderr,"Couldn't save shapefile index %s\n",index_path);
     }
   }
+  return(index);
 }
 
 
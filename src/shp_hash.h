@@ -16,22 +16,39 @@
   #endif  // HAVE_LIBSHP_SHAPEFIL_H
 #endif  // HAVE_SHAPEFIL_H
 
+#include "shp_index.h"
+
+struct _shp_cache_entry;
+struct dbfawk_memo_;
+
 typedef struct _shpinfo
 {
   char *filename;
-  struct Node* root;
+  shp_index *index;
   time_t creation;
   time_t last_access;
   int num_accesses;
+  int shape_count;                    // Shapes in the file
+  struct _shp_cache_entry **shapes;   // Cached geometry by shape number
+  struct dbfawk_memo_ *memo;          // dbfawk results by field values
 } shpinfo;
 
+// Budget for the decoded shapes kept across redraws, shared by all
+// shapefiles in the hash
+#define SHP_CACHE_BUDGET (64 * 1024 * 1024)
+
 void init_shp_hash(int clobber);
 void add_shp_to_hash(char *filename,SHPHandle sHP);
-void build_rtree(struct Node **root, SHPHandle sHP);
+shp_index *build_shp_index(char *filename, SHPHandle sHP);
 void destroy_shp_hash(void);
 void empty_shpinfo(shpinfo *si);
 void destroy_shpinfo(shpinfo *si);
 void purge_shp_hash(time_t secs_now);
 shpinfo *get_shp_from_hash(char *filename);
+int shp_cache_has(shpinfo *si, int shape);
+SHPObject *shp_cache_get(shpinfo *si, int shape);
+int shp_cache_add(shpinfo *si, int shape, SHPObject *object, unsigned long *xy, char *ok);
+int shp_cache_vertex(SHPObject *object, int vertex, unsigned long *x, unsigned long *y, int *ok);
+unsigned long shp_cache_bytes(void);
 
 #endif // __XASTIR_SHP_HASH_H
@@ -0,0 +1,792 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 1999,2000  Frank Giannandrea
+ * Copyright (C) 2000-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+
+#ifdef HAVE_CONFIG_H
+  #include "config.h"
+#endif  // HAVE_CONFIG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef HAVE_MMAP
+  #include <sys/mman.h>
+#endif  // HAVE_MMAP
+
+#include "shp_index.h"
+#include "snprintf.h"
+
+// Must be last include file
+#include "leak_detection.h"
+
+
+
+#define SHP_INDEX_MAGIC   0x58524931    // "XRI1"
+#define SHP_INDEX_VERSION 2
+
+// Douglas-Peucker tolerance of each level of detail, in degrees.  A
+// level is used once a screen pixel is at least this big, so the
+// error it introduces stays under a pixel.
+static const double lod_tolerance[SHP_INDEX_LOD_LEVELS] =
+{
+  0.0005,     // ~1.8 seconds
+  0.002,
+  0.008,
+  0.032       // ~2 minutes
+};
+
+// A level that keeps more than this share of a shape's vertices isn't
+// worth storing, the shape is drawn at full resolution instead.
+#define LOD_MIN_SAVING(count) ((count) - (count) / 4)
+
+
+
+
+
+static int compare_center_x(const void *a, const void *b)
+{
+  const struct Rect *ra = &((const shp_index_entry *)a)->rect;
+  const struct Rect *rb = &((const shp_index_entry *)b)->rect;
+  RectReal ca = ra->boundary[0] + ra->boundary[2];
+  RectReal cb = rb->boundary[0] + rb->boundary[2];
+
+  return (ca > cb) - (ca < cb);
+}
+
+
+
+
+
+static int compare_center_y(const void *a, const void *b)
+{
+  const struct Rect *ra = &((const shp_index_entry *)a)->rect;
+  const struct Rect *rb = &((const shp_index_entry *)b)->rect;
+  RectReal ca = ra->boundary[1] + ra->boundary[3];
+  RectReal cb = rb->boundary[1] + rb->boundary[3];
+
+  return (ca > cb) - (ca < cb);
+}
+
+
+
+
+
+// Sort-Tile-Recursive ordering: sort by x, cut into vertical slices
+// of slices*FANOUT entries, then sort each slice by y.  Consecutive
+// runs of FANOUT entries then make tight, roughly square nodes.
+//
+static void str_sort(shp_index_entry *items, int count)
+{
+  int nodes = (count + SHP_INDEX_FANOUT - 1) / SHP_INDEX_FANOUT;
+  int slices = 1;
+  int slice_size;
+  int start;
+
+
+  while (slices * slices < nodes)
+  {
+    slices++;
+  }
+  slice_size = slices * SHP_INDEX_FANOUT;
+
+  qsort(items, count, sizeof(shp_index_entry), compare_center_x);
+  for (start = 0; start < count; start += slice_size)
+  {
+    qsort(&items[start],
+          (count - start < slice_size) ? count - start : slice_size,
+          sizeof(shp_index_entry),
+          compare_center_y);
+  }
+}
+
+
+
+
+
+// Squared distance from (px,py) to the segment (ax,ay)-(bx,by)
+//
+static double segment_distance2(double px, double py,
+                                double ax, double ay, double bx, double by)
+{
+  double dx = bx - ax;
+  double dy = by - ay;
+  double length2 = dx * dx + dy * dy;
+  double t;
+
+  if (length2 > 0.0)
+  {
+    t = ((px - ax) * dx + (py - ay) * dy) / length2;
+    if (t > 1.0)
+    {
+      ax = bx;
+      ay = by;
+    }
+    else if (t > 0.0)
+    {
+      ax += t * dx;
+      ay += t * dy;
+    }
+  }
+  return (px - ax) * (px - ax) + (py - ay) * (py - ay);
+}
+
+
+
+
+
+// Douglas-Peucker over vertices first..last, marking the ones to keep
+// in "keep".  Iterative, as a long coastline would make the recursion
+// deep.  "stack" needs room for two ints per vertex.
+//
+static void simplify_run(const double *x, const double *y, int first, int last,
+                         double tolerance2, char *keep, int *stack)
+{
+  int top = 0;
+
+  keep[first] = 1;
+  keep[last] = 1;
+  stack[top++] = first;
+  stack[top++] = last;
+
+  while (top > 0)
+  {
+    int b = stack[--top];
+    int a = stack[--top];
+    double max_distance2 = 0.0;
+    int farthest = -1;
+    int ii;
+
+    for (ii = a + 1; ii < b; ii++)
+    {
+      double distance2 = segment_distance2(x[ii], y[ii], x[a], y[a], x[b], y[b]);
+
+      if (distance2 > max_distance2)
+      {
+        max_distance2 = distance2;
+        farthest = ii;
+      }
+    }
+    if (farthest >= 0 && max_distance2 > tolerance2)
+    {
+      keep[farthest] = 1;
+      stack[top++] = a;
+      stack[top++] = farthest;
+      stack[top++] = farthest;
+      stack[top++] = b;
+    }
+  }
+}
+
+
+
+
+
+int shp_index_lod_init(shp_index_lod *lod, int shape_count)
+{
+  memset(lod, 0, sizeof(shp_index_lod));
+  lod->shape_count = shape_count;
+  lod->start = calloc(shape_count * SHP_INDEX_LOD_LEVELS + 1, sizeof(uint32_t));
+  return(lod->start != NULL);
+}
+
+
+
+
+
+// Simplify shape number "shape" at every level and add the result.
+// x/y hold all "vertex_count" vertices of the shape, part_start the
+// first vertex of each part.  Polygon rings ("closed") are split at
+// their vertex farthest from the start, so they keep some area.
+// Shapes must be added in increasing order; any skipped are drawn at
+// full resolution.  Returns 0 if out of memory.
+//
+int shp_index_lod_add_shape(shp_index_lod *lod, int shape, const double *x, const double *y,
+                            int vertex_count, const int *part_start, int part_count, int closed)
+{
+  char *keep;
+  int *stack;
+  int level;
+  int part;
+  int ii;
+
+
+  if (shape < (int)lod->next_shape || shape >= (int)lod->shape_count)
+  {
+    return(1);
+  }
+
+  // Shapes skipped get empty lists
+  while ((int)lod->next_shape <= shape)
+  {
+    for (level = 0; level < SHP_INDEX_LOD_LEVELS; level++)
+    {
+      lod->start[lod->next_shape * SHP_INDEX_LOD_LEVELS + level] = lod->vertex_count;
+    }
+    lod->next_shape++;
+  }
+
+  if (vertex_count < 8)
+  {
+    return(1);    // Nothing to gain
+  }
+
+  keep = malloc(vertex_count);
+  stack = malloc(2 * vertex_count * sizeof(int));
+  if (keep == NULL || stack == NULL)
+  {
+    free(keep);
+    free(stack);
+    return(0);
+  }
+
+  for (level = 0; level < SHP_INDEX_LOD_LEVELS; level++)
+  {
+    double tolerance2 = lod_tolerance[level] * lod_tolerance[level];
+    int kept = 0;
+
+    lod->start[shape * SHP_INDEX_LOD_LEVELS + level] = lod->vertex_count;
+
+    memset(keep, 0, vertex_count);
+    for (part = 0; part < part_count; part++)
+    {
+      int first = part_start[part];
+      int last = (part + 1 < part_count) ? part_start[part + 1] - 1 : vertex_count - 1;
+
+      if (first < 0 || first > last || last >= vertex_count)
+      {
+        continue;
+      }
+      if (closed && last - first >= 3)
+      {
+        double max_distance2 = -1.0;
+        int farthest = first + 1;
+
+        for (ii = first + 1; ii < last; ii++)
+        {
+          double distance2 = (x[ii] - x[first]) * (x[ii] - x[first])
+                             + (y[ii] - y[first]) * (y[ii] - y[first]);
+
+          if (distance2 > max_distance2)
+          {
+            max_distance2 = distance2;
+            farthest = ii;
+          }
+        }
+        simplify_run(x, y, first, farthest, tolerance2, keep, stack);
+        simplify_run(x, y, farthest, last, tolerance2, keep, stack);
+      }
+      else
+      {
+        simplify_run(x, y, first, last, tolerance2, keep, stack);
+      }
+    }
+
+    for (ii = 0; ii < vertex_count; ii++)
+    {
+      kept += keep[ii];
+    }
+    if (kept > LOD_MIN_SAVING(vertex_count))
+    {
+      continue;   // Leave the list empty
+    }
+
+    if (lod->vertex_count + kept > lod->vertex_size)
+    {
+      uint32_t size = lod->vertex_size ? lod->vertex_size : 65536;
+      uint32_t *ptr;
+
+      while (size < lod->vertex_count + kept)
+      {
+        size *= 2;
+      }
+      ptr = realloc(lod->vertex, size * sizeof(uint32_t));
+      if (ptr == NULL)
+      {
+        free(keep);
+        free(stack);
+        return(0);
+      }
+      lod->vertex = ptr;
+      lod->vertex_size = size;
+    }
+    for (ii = 0; ii < vertex_count; ii++)
+    {
+      if (keep[ii])
+      {
+        lod->vertex[lod->vertex_count++] = ii;
+      }
+    }
+  }
+
+  free(keep);
+  free(stack);
+  return(1);
+}
+
+
+
+
+
+void shp_index_lod_free(shp_index_lod *lod)
+{
+  free(lod->start);
+  free(lod->vertex);
+  memset(lod, 0, sizeof(shp_index_lod));
+}
+
+
+
+
+
+// The coarsest level of detail that's good enough when a screen pixel
+// is "pixel_degrees" across, or -1 for full resolution.
+//
+int shp_index_lod_level(double pixel_degrees)
+{
+  int level;
+
+  for (level = SHP_INDEX_LOD_LEVELS - 1; level >= 0; level--)
+  {
+    if (pixel_degrees >= lod_tolerance[level])
+    {
+      return(level);
+    }
+  }
+  return(-1);
+}
+
+
+
+
+
+// Point "vertices" at the vertex numbers kept for "shape" at "level"
+// and return how many there are, or 0 if the shape should be drawn
+// at full resolution.
+//
+int shp_index_lod_vertices(shp_index *index, int shape, int level, const uint32_t **vertices)
+{
+  uint32_t first, last;
+
+  if (index == NULL || index->lod_start == NULL
+      || shape < 0 || shape >= (int)index->header->lod_shape_count
+      || level < 0 || level >= SHP_INDEX_LOD_LEVELS)
+  {
+    return(0);
+  }
+
+  first = index->lod_start[shape * SHP_INDEX_LOD_LEVELS + level];
+  last = index->lod_start[shape * SHP_INDEX_LOD_LEVELS + level + 1];
+  if (first >= last || last > index->header->lod_vertex_count)
+  {
+    return(0);
+  }
+  *vertices = &index->lod_vertex[first];
+  return(last - first);
+}
+
+
+
+
+
+// Build a packed index from "entries", which is reordered.  Entries
+// with an inverted bounding box are left out, as build_rtree() always
+// did.  The source mtime/size are recorded for shp_index_load().  The
+// simplified shapes in "lod" are copied in if it isn't NULL.
+//
+shp_index *shp_index_build(shp_index_entry *entries, int count, time_t source_mtime, off_t source_size,
+                           shp_index_lod *lod)
+{
+  uint32_t lod_shapes = 0;
+  uint32_t lod_vertices = 0;
+  size_t lod_length = 0;
+  shp_index *index;
+  shp_index_entry *parents;
+  shp_index_entry *items;
+  int node_total;
+  int valid = 0;
+  int level;
+  int n;
+  int ii;
+
+
+  for (ii = 0; ii < count; ii++)
+  {
+    if (entries[ii].rect.boundary[0] <= entries[ii].rect.boundary[2]
+        && entries[ii].rect.boundary[1] <= entries[ii].rect.boundary[3])
+    {
+      entries[valid++] = entries[ii];
+    }
+  }
+
+  // Count the nodes of every level, down to the single root
+  node_total = 0;
+  n = valid;
+  do
+  {
+    n = (n + SHP_INDEX_FANOUT - 1) / SHP_INDEX_FANOUT;
+    if (n == 0)
+    {
+      n = 1;    // An empty file still gets an (empty) root
+    }
+    node_total += n;
+  }
+  while (n > 1);
+
+  if (lod != NULL && lod->start != NULL)
+  {
+    // Shapes never added are drawn at full resolution
+    while (lod->next_shape < lod->shape_count)
+    {
+      for (ii = 0; ii <= SHP_INDEX_LOD_LEVELS; ii++)
+      {
+        lod->start[lod->next_shape * SHP_INDEX_LOD_LEVELS + ii] = lod->vertex_count;
+      }
+      lod->next_shape++;
+    }
+    lod->start[lod->shape_count * SHP_INDEX_LOD_LEVELS] = lod->vertex_count;
+
+    lod_shapes = lod->shape_count;
+    lod_vertices = lod->vertex_count;
+    lod_length = (lod_shapes * SHP_INDEX_LOD_LEVELS + 1 + lod_vertices) * sizeof(uint32_t);
+  }
+
+  index = calloc(1, sizeof(shp_index));
+  if (index == NULL)
+  {
+    return(NULL);
+  }
+  index->length = sizeof(shp_index_header) + node_total * sizeof(shp_index_node) + lod_length;
+  index->block = calloc(1, index->length);
+  parents = malloc(((valid + SHP_INDEX_FANOUT - 1) / SHP_INDEX_FANOUT + 1) * sizeof(shp_index_entry));
+  if (index->block == NULL || parents == NULL)
+  {
+    free(parents);
+    shp_index_free(index);
+    return(NULL);
+  }
+  index->header = (shp_index_header *)index->block;
+  index->nodes = (shp_index_node *)((char *)index->block + sizeof(shp_index_header));
+
+  index->header->magic = SHP_INDEX_MAGIC;
+  index->header->version = SHP_INDEX_VERSION;
+  index->header->source_mtime = (int64_t)source_mtime;
+  index->header->source_size = (int64_t)source_size;
+  index->header->entry_count = valid;
+  index->header->node_size = sizeof(shp_index_node);
+  index->header->lod_shape_count = lod_shapes;
+  index->header->lod_vertex_count = lod_vertices;
+
+  // Pack one level at a time, leaves first.  Each node's cover goes
+  // into "parents" as an item of the next level up.  Writing
+  // parents[k] only overwrites items already packed, so the upper
+  // levels are built in place.
+  items = entries;
+  n = valid;
+  level = 0;
+  while (1)
+  {
+    int next = 0;
+    int start = 0;
+
+    str_sort(items, n);
+    do
+    {
+      shp_index_node *node = &index->nodes[index->header->node_count];
+      struct Rect cover;
+      int jj;
+
+      memset(&cover, 0, sizeof(cover));
+      node->level = level;
+      node->count = (n - start < SHP_INDEX_FANOUT) ? n - start : SHP_INDEX_FANOUT;
+      for (jj = 0; jj < (int)node->count; jj++)
+      {
+        struct Rect *r = &items[start + jj].rect;
+
+        node->branch[jj].rect = *r;
+        node->branch[jj].child = items[start + jj].id;
+        if (jj == 0)
+        {
+          cover = *r;
+        }
+        else
+        {
+          if (r->boundary[0] < cover.boundary[0])
+          {
+            cover.boundary[0] = r->boundary[0];
+          }
+          if (r->boundary[1] < cover.boundary[1])
+          {
+            cover.boundary[1] = r->boundary[1];
+          }
+          if (r->boundary[2] > cover.boundary[2])
+          {
+            cover.boundary[2] = r->boundary[2];
+          }
+          if (r->boundary[3] > cover.boundary[3])
+          {
+            cover.boundary[3] = r->boundary[3];
+          }
+        }
+      }
+      if (node->count > 0)
+      {
+        parents[next].rect = cover;
+      }
+      parents[next].id = index->header->node_count++;
+      next++;
+      start += SHP_INDEX_FANOUT;
+    }
+    while (start < n);
+
+    if (next == 1)
+    {
+      break;
+    }
+    items = parents;
+    n = next;
+    level++;
+  }
+  index->header->root = index->header->node_count - 1;
+
+  if (lod_length > 0)
+  {
+    index->lod_start = (uint32_t *)&index->nodes[node_total];
+    index->lod_vertex = index->lod_start + lod_shapes * SHP_INDEX_LOD_LEVELS + 1;
+    memcpy(index->lod_start, lod->start, (lod_shapes * SHP_INDEX_LOD_LEVELS + 1) * sizeof(uint32_t));
+    if (lod_vertices > 0)
+    {
+      memcpy(index->lod_vertex, lod->vertex, lod_vertices * sizeof(uint32_t));
+    }
+  }
+
+  free(parents);
+  return(index);
+}
+
+
+
+
+
+// Write the index to "path" by way of a temporary file, so a reader
+// never maps a half-written index.  Returns 0 on success.
+//
+int shp_index_save(shp_index *index, const char *path)
+{
+  char temp_path[4096];
+  FILE *f;
+  size_t written;
+
+
+  xastir_snprintf(temp_path, sizeof(temp_path), "%s.%ld", path, (long)getpid());
+
+  f = fopen(temp_path, "wb");
+  if (f == NULL)
+  {
+    return(-1);
+  }
+  written = fwrite(index->block, 1, index->length, f);
+  if (fclose(f) != 0 || written != index->length
+      || rename(temp_path, path) != 0)
+  {
+    (void)unlink(temp_path);
+    return(-1);
+  }
+  return(0);
+}
+
+
+
+
+
+// Map an index written by shp_index_save().  Returns NULL if it's
+// missing, damaged, or was built from a different version of the
+// shapefile, in which case the caller should rebuild it.
+//
+shp_index *shp_index_load(const char *path, time_t source_mtime, off_t source_size)
+{
+  shp_index *index;
+  shp_index_header *header;
+  struct stat sb;
+  int fd;
+
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0)
+  {
+    return(NULL);
+  }
+  if (fstat(fd, &sb) != 0 || (size_t)sb.st_size < sizeof(shp_index_header))
+  {
+    close(fd);
+    return(NULL);
+  }
+
+  index = calloc(1, sizeof(shp_index));
+  if (index == NULL)
+  {
+    close(fd);
+    return(NULL);
+  }
+  index->length = sb.st_size;
+
+#ifdef HAVE_MMAP
+  index->block = mmap(NULL, index->length, PROT_READ, MAP_SHARED, fd, 0);
+  if (index->block == MAP_FAILED)
+  {
+    index->block = NULL;
+  }
+  else
+  {
+    index->mapped = 1;
+  }
+#else   // HAVE_MMAP
+  index->block = malloc(index->length);
+  if (index->block != NULL
+      && read(fd, index->block, index->length) != (ssize_t)index->length)
+  {
+    free(index->block);
+    index->block = NULL;
+  }
+#endif  // HAVE_MMAP
+  close(fd);
+
+  if (index->block == NULL)
+  {
+    free(index);
+    return(NULL);
+  }
+
+  header = (shp_index_header *)index->block;
+  if (header->magic != SHP_INDEX_MAGIC
+      || header->version != SHP_INDEX_VERSION
+      || header->node_size != sizeof(shp_index_node)
+      || header->source_mtime != (int64_t)source_mtime
+      || header->source_size != (int64_t)source_size
+      || header->node_count == 0
+      || header->root >= header->node_count
+      || index->length != sizeof(shp_index_header) + (size_t)header->node_count * sizeof(shp_index_node)
+      + ((header->lod_shape_count > 0)
+         ? ((size_t)header->lod_shape_count * SHP_INDEX_LOD_LEVELS + 1 + header->lod_vertex_count) * sizeof(uint32_t)
+         : 0))
+  {
+    shp_index_free(index);
+    return(NULL);
+  }
+
+  index->header = header;
+  index->nodes = (shp_index_node *)((char *)index->block + sizeof(shp_index_header));
+  if (header->lod_shape_count > 0)
+  {
+    index->lod_start = (uint32_t *)&index->nodes[header->node_count];
+    index->lod_vertex = index->lod_start + header->lod_shape_count * SHP_INDEX_LOD_LEVELS + 1;
+  }
+  return(index);
+}
+
+
+
+
+
+static int search_node(shp_index *index, uint32_t node_number, struct Rect *rect,
+                       SearchHitCallback callback, void *arg, int *stop)
+{
+  shp_index_node *node = &index->nodes[node_number];
+  int hits = 0;
+  uint32_t ii;
+
+
+  for (ii = 0; ii < node->count && ii < SHP_INDEX_FANOUT && !*stop; ii++)
+  {
+    struct Rect *r = &node->branch[ii].rect;
+
+    if (rect->boundary[0] > r->boundary[2] || r->boundary[0] > rect->boundary[2]
+        || rect->boundary[1] > r->boundary[3] || r->boundary[1] > rect->boundary[3])
+    {
+      continue;
+    }
+
+    if (node->level > 0)
+    {
+      // Children always come before their parent, which also keeps
+      // a damaged file from sending us round in circles.
+      if (node->branch[ii].child < node_number)
+      {
+        hits += search_node(index, node->branch[ii].child, rect, callback, arg, stop);
+      }
+    }
+    else
+    {
+      hits++;
+      if (callback != NULL
+          && !callback((void *)(intptr_t)node->branch[ii].child, arg))
+      {
+        *stop = 1;    // Callback wants to terminate the search early
+      }
+    }
+  }
+  return(hits);
+}
+
+
+
+
+
+// Same contract as Xastir_RTreeSearch(): calls "callback" with the id
+// of every entry whose rectangle overlaps "rect", and returns the
+// number of hits.
+//
+int shp_index_search(shp_index *index, struct Rect *rect, SearchHitCallback callback, void *arg)
+{
+  int stop = 0;
+
+  return(search_node(index, index->header->root, rect, callback, arg, &stop));
+}
+
+
+
+
+
+void shp_index_free(shp_index *index)
+{
+  if (index == NULL)
+  {
+    return;
+  }
+  if (index->block != NULL)
+  {
+#ifdef HAVE_MMAP
+    if (index->mapped)
+    {
+      (void)munmap(index->block, index->length);
+    }
+    else
+#endif  // HAVE_MMAP
+    {
+      free(index->block);
+    }
+  }
+  free(index);
+}
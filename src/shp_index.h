@@ -0,0 +1,113 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 1999,2000  Frank Giannandrea
+ * Copyright (C) 2000-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+#ifndef __XASTIR_SHP_INDEX_H
+#define __XASTIR_SHP_INDEX_H
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+
+#include <rtree/index.h>
+
+// Packed, read-only spatial index over the shapes of one shapefile.
+// It is bulk-loaded with Sort-Tile-Recursive packing into one flat
+// block of fixed-size nodes that refer to each other by index, so the
+// same bytes can be written to disk and memory-mapped back in.  The
+// file carries the size and mtime of the .shp it was built from and
+// is rejected on load if either has changed.
+//
+// The same file holds simplified versions of each shape for drawing
+// at coarse zooms: for each of SHP_INDEX_LOD_LEVELS tolerances, the
+// vertices Douglas-Peucker keeps.
+#define SHP_INDEX_FANOUT 16
+#define SHP_INDEX_LOD_LEVELS 4
+
+typedef struct
+{
+  struct Rect rect;
+  uint32_t id;                // Returned to the search callback, must be non-zero
+} shp_index_entry;
+
+typedef struct
+{
+  uint32_t count;             // Branches in use
+  uint32_t level;             // 0 is a leaf
+  struct
+  {
+    struct Rect rect;
+    uint32_t child;           // Node number, or entry id in a leaf
+  } branch[SHP_INDEX_FANOUT];
+} shp_index_node;
+
+typedef struct
+{
+  uint32_t magic;             // Also catches files from the other byte order
+  uint32_t version;
+  int64_t source_mtime;
+  int64_t source_size;
+  uint32_t entry_count;
+  uint32_t node_count;
+  uint32_t root;
+  uint32_t node_size;         // sizeof(shp_index_node) of the writer
+  uint32_t lod_shape_count;   // Shapes with simplified versions
+  uint32_t lod_vertex_count;  // Total kept vertices of all of them
+  uint32_t reserved;
+} shp_index_header;
+
+// Simplified versions of the shapes, added in shape order with
+// shp_index_lod_add_shape().  The vertices kept for shape s at level l
+// are vertex[start[s*SHP_INDEX_LOD_LEVELS+l]] up to the next start.
+// An empty list means the shape is drawn at full resolution.
+typedef struct
+{
+  uint32_t shape_count;
+  uint32_t next_shape;        // Shapes added so far
+  uint32_t *start;            // shape_count*SHP_INDEX_LOD_LEVELS+1 offsets
+  uint32_t *vertex;
+  uint32_t vertex_count;
+  uint32_t vertex_size;       // Allocated length of vertex
+} shp_index_lod;
+
+typedef struct
+{
+  shp_index_header *header;
+  shp_index_node *nodes;
+  uint32_t *lod_start;        // See shp_index_lod, NULL if none
+  uint32_t *lod_vertex;
+  void *block;                // header, nodes, lod_start, lod_vertex
+  size_t length;
+  int mapped;                 // block is mmap()ed rather than malloc()ed
+} shp_index;
+
+extern int shp_index_lod_init(shp_index_lod *lod, int shape_count);
+extern int shp_index_lod_add_shape(shp_index_lod *lod, int shape, const double *x, const double *y, int vertex_count, const int *part_start, int part_count, int closed);
+extern void shp_index_lod_free(shp_index_lod *lod);
+extern int shp_index_lod_level(double pixel_degrees);
+extern int shp_index_lod_vertices(shp_index *index, int shape, int level, const uint32_t **vertices);
+extern shp_index *shp_index_build(shp_index_entry *entries, int count, time_t source_mtime, off_t source_size, shp_index_lod *lod);
+extern int shp_index_save(shp_index *index, const char *path);
+extern shp_index *shp_index_load(const char *path, time_t source_mtime, off_t source_size);
+extern int shp_index_search(shp_index *index, struct Rect *rect, SearchHitCallback callback, void *arg);
+extern void shp_index_free(shp_index *index);
+
+#endif
@@ -0,0 +1,408 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 1999,2000  Frank Giannandrea
+ * Copyright (C) 2000-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+
+//
+// Parallel read-ahead for draw_shapefile_map().
+//
+// Reading a shape (SHPReadObject) and converting its vertices to
+// Xastir coordinates is most of the cost of drawing a big vector
+// layer, and neither needs X or the dbfawk interpreter.  The list of
+// shapes to draw is cut into jobs of PREFETCH_CHUNK shapes.  Worker
+// threads, each with its own SHPHandle, take jobs in order and fill
+// them with the shape and its converted vertices.  The main thread
+// picks both up in the original order with shp_prefetch_get(), so
+// layers and shapes are drawn exactly as before, and hands them to
+// the geometry cache in shp_hash.c.
+//
+// At most "window" jobs are in flight, so memory stays bounded on
+// huge layers.  Needs a shapelib that keeps its read buffers in the
+// SHPHandle (1.2.10 and later), which is any that's still around.
+//
+
+
+#ifdef HAVE_CONFIG_H
+  #include "config.h"
+#endif  // HAVE_CONFIG_H
+
+#ifdef HAVE_LIBSHP
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "xastir.h"
+#include "util.h"
+#include "shp_prefetch.h"
+
+// Must be last include file
+#include "leak_detection.h"
+
+
+
+#define PREFETCH_CHUNK        64    // Shapes per job
+#define PREFETCH_JOBS_AHEAD   4     // Jobs in flight per worker
+#define MAX_PREFETCH_THREADS  4
+
+typedef struct
+{
+  SHPObject *object;          // NULL once handed to the main thread
+  unsigned long *xy;          // Xastir x,y for each vertex
+  char *ok;                   // Whether each vertex converted, NULL if all did
+} prefetched_shape;
+
+typedef struct
+{
+  int job;                    // Job filled into this slot, -1 if none
+  prefetched_shape shape[PREFETCH_CHUNK];
+} prefetch_slot;
+
+typedef struct
+{
+  shp_prefetch *prefetch;
+  SHPHandle handle;
+  pthread_t thread;
+} prefetch_worker;
+
+struct _shp_prefetch
+{
+  int *shapes;                // Shape numbers, NULL for 0..count-1
+  int count;
+  int jobs;
+
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  int next_job;               // Next job for a worker to take
+  int consumer_job;           // Oldest job the main thread still needs
+  int stop;
+
+  int window;                 // Number of slots
+  prefetch_slot *slot;
+  int threads;
+  prefetch_worker worker[MAX_PREFETCH_THREADS];
+};
+
+
+
+
+
+// How many worker threads to use, 0 if it isn't worth it.
+//
+int shp_prefetch_threads(void)
+{
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+  if (cpus < 2)
+  {
+    return(0);
+  }
+  return((cpus > MAX_PREFETCH_THREADS) ? MAX_PREFETCH_THREADS : (int)cpus);
+}
+
+
+
+
+
+static void free_slot(prefetch_slot *slot)
+{
+  int ii;
+
+  for (ii = 0; ii < PREFETCH_CHUNK; ii++)
+  {
+    if (slot->shape[ii].object)
+    {
+      SHPDestroyObject(slot->shape[ii].object);
+    }
+    free(slot->shape[ii].xy);
+    free(slot->shape[ii].ok);
+  }
+  memset(slot->shape, 0, sizeof(slot->shape));
+  slot->job = -1;
+}
+
+
+
+
+
+static void fill_shape(SHPHandle handle, int structure, prefetched_shape *shape)
+{
+  int vertex;
+  int all_ok = 1;
+
+  shape->object = SHPReadObject(handle, structure);
+  if (shape->object == NULL || shape->object->nVertices == 0)
+  {
+    return;
+  }
+
+  // If these fail the main thread just converts the shape itself
+  shape->xy = malloc(2 * shape->object->nVertices * sizeof(unsigned long));
+  shape->ok = malloc(shape->object->nVertices);
+  if (shape->xy == NULL || shape->ok == NULL)
+  {
+    free(shape->xy);
+    free(shape->ok);
+    shape->xy = NULL;
+    shape->ok = NULL;
+    return;
+  }
+
+  for (vertex = 0; vertex < shape->object->nVertices; vertex++)
+  {
+    shape->ok[vertex] = convert_to_xastir_coordinates(&shape->xy[2*vertex],
+                        &shape->xy[2*vertex+1],
+                        (float)shape->object->padfX[vertex],
+                        (float)shape->object->padfY[vertex]);
+    all_ok &= shape->ok[vertex];
+  }
+  if (all_ok)
+  {
+    free(shape->ok);
+    shape->ok = NULL;
+  }
+}
+
+
+
+
+
+static void *prefetch_thread(void *arg)
+{
+  prefetch_worker *worker = (prefetch_worker *)arg;
+  shp_prefetch *prefetch = worker->prefetch;
+  prefetch_slot *slot;
+  int position;
+  int job;
+  int ii;
+
+
+  while (1)
+  {
+    pthread_mutex_lock(&prefetch->lock);
+    while (!prefetch->stop
+           && prefetch->next_job < prefetch->jobs
+           && prefetch->next_job >= prefetch->consumer_job + prefetch->window)
+    {
+      pthread_cond_wait(&prefetch->cond, &prefetch->lock);
+    }
+    if (prefetch->stop || prefetch->next_job >= prefetch->jobs)
+    {
+      pthread_mutex_unlock(&prefetch->lock);
+      break;
+    }
+    job = prefetch->next_job++;
+    pthread_mutex_unlock(&prefetch->lock);
+
+    // The job that used this slot before has been retired, see the
+    // window check above
+    slot = &prefetch->slot[job % prefetch->window];
+    for (ii = 0; ii < PREFETCH_CHUNK; ii++)
+    {
+      position = job * PREFETCH_CHUNK + ii;
+      if (position >= prefetch->count)
+      {
+        break;
+      }
+      fill_shape(worker->handle,
+                 prefetch->shapes ? prefetch->shapes[position] : position,
+                 &slot->shape[ii]);
+    }
+
+    pthread_mutex_lock(&prefetch->lock);
+    slot->job = job;
+    pthread_cond_broadcast(&prefetch->cond);
+    pthread_mutex_unlock(&prefetch->lock);
+  }
+
+  return(NULL);
+}
+
+
+
+
+
+// Start reading "count" shapes of "file", in the order given by
+// "shapes" (or 0..count-1 if that's NULL).  "shapes" must stay put
+// until shp_prefetch_stop().  Returns NULL if the threads can't be
+// started, in which case read the shapes as usual.
+//
+shp_prefetch *shp_prefetch_start(char *file, int *shapes, int count)
+{
+  shp_prefetch *prefetch;
+  int threads = shp_prefetch_threads();
+  int ii;
+
+
+  if (threads == 0 || count < SHP_PREFETCH_MIN_SHAPES)
+  {
+    return(NULL);
+  }
+
+  prefetch = calloc(1, sizeof(shp_prefetch));
+  if (prefetch == NULL)
+  {
+    return(NULL);
+  }
+  prefetch->shapes = shapes;
+  prefetch->count = count;
+  prefetch->jobs = (count + PREFETCH_CHUNK - 1) / PREFETCH_CHUNK;
+  prefetch->window = threads * PREFETCH_JOBS_AHEAD;
+  prefetch->slot = calloc(prefetch->window, sizeof(prefetch_slot));
+  if (prefetch->slot == NULL)
+  {
+    free(prefetch);
+    return(NULL);
+  }
+  for (ii = 0; ii < prefetch->window; ii++)
+  {
+    prefetch->slot[ii].job = -1;
+  }
+  pthread_mutex_init(&prefetch->lock, NULL);
+  pthread_cond_init(&prefetch->cond, NULL);
+
+  for (ii = 0; ii < threads; ii++)
+  {
+    prefetch_worker *worker = &prefetch->worker[prefetch->threads];
+
+    worker->prefetch = prefetch;
+    worker->handle = SHPOpen(file, "rb");
+    if (worker->handle == NULL)
+    {
+      break;
+    }
+    if (pthread_create(&worker->thread, NULL, prefetch_thread, worker))
+    {
+      SHPClose(worker->handle);
+      break;
+    }
+    prefetch->threads++;
+  }
+
+  if (prefetch->threads == 0)
+  {
+    shp_prefetch_stop(prefetch);
+    return(NULL);
+  }
+  return(prefetch);
+}
+
+
+
+
+
+// Get the shape at "position" in the list, waiting for it if need be.
+// The caller owns the result and frees it with SHPDestroyObject(), and
+// also gets the vertices in Xastir coordinates in "xy" and "ok" (see
+// shp_cache_add()) to free, or NULL if they weren't converted.
+// Positions must be asked for in increasing order.
+//
+SHPObject *shp_prefetch_get(shp_prefetch *prefetch, int position,
+                            unsigned long **xy, char **ok)
+{
+  prefetch_slot *slot;
+  prefetched_shape *shape;
+  SHPObject *object;
+  int job = position / PREFETCH_CHUNK;
+
+
+  *xy = NULL;
+  *ok = NULL;
+
+  if (position < 0 || position >= prefetch->count)
+  {
+    return(NULL);
+  }
+
+  pthread_mutex_lock(&prefetch->lock);
+
+  // Retire the jobs we're done with, which lets the workers reuse
+  // their slots
+  while (prefetch->consumer_job < job)
+  {
+    slot = &prefetch->slot[prefetch->consumer_job % prefetch->window];
+    while (slot->job != prefetch->consumer_job)
+    {
+      pthread_cond_wait(&prefetch->cond, &prefetch->lock);
+    }
+    free_slot(slot);
+    prefetch->consumer_job++;
+    pthread_cond_broadcast(&prefetch->cond);
+  }
+
+  slot = &prefetch->slot[job % prefetch->window];
+  while (slot->job != job)
+  {
+    pthread_cond_wait(&prefetch->cond, &prefetch->lock);
+  }
+  pthread_mutex_unlock(&prefetch->lock);
+
+  shape = &slot->shape[position % PREFETCH_CHUNK];
+  object = shape->object;
+  *xy = shape->xy;
+  *ok = shape->ok;
+  shape->object = NULL;
+  shape->xy = NULL;
+  shape->ok = NULL;
+
+  return(object);
+}
+
+
+
+
+
+// Stop the workers and free whatever they read that wasn't used.
+//
+void shp_prefetch_stop(shp_prefetch *prefetch)
+{
+  int ii;
+
+
+  if (prefetch == NULL)
+  {
+    return;
+  }
+
+  pthread_mutex_lock(&prefetch->lock);
+  prefetch->stop = 1;
+  pthread_cond_broadcast(&prefetch->cond);
+  pthread_mutex_unlock(&prefetch->lock);
+
+  for (ii = 0; ii < prefetch->threads; ii++)
+  {
+    (void)pthread_join(prefetch->worker[ii].thread, NULL);
+    SHPClose(prefetch->worker[ii].handle);
+  }
+
+  for (ii = 0; ii < prefetch->window; ii++)
+  {
+    free_slot(&prefetch->slot[ii]);
+  }
+  free(prefetch->slot);
+  pthread_mutex_destroy(&prefetch->lock);
+  pthread_cond_destroy(&prefetch->cond);
+  free(prefetch);
+}
+
+#endif  // HAVE_LIBSHP
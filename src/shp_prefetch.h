@@ -0,0 +1,49 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 1999,2000  Frank Giannandrea
+ * Copyright (C) 2000-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+#ifndef __XASTIR_SHP_PREFETCH_H
+#define __XASTIR_SHP_PREFETCH_H
+
+#ifdef HAVE_SHAPEFIL_H
+  #include <shapefil.h>
+#else
+  #ifdef HAVE_LIBSHP_SHAPEFIL_H
+    #include <libshp/shapefil.h>
+  #else
+    #error HAVE_LIBSHP defined but no corresponding include defined
+  #endif  // HAVE_LIBSHP_SHAPEFIL_H
+#endif  // HAVE_SHAPEFIL_H
+
+// Worker threads that read and convert the shapes of one shapefile
+// ahead of draw_shapefile_map(), which is left doing the dbfawk
+// lookups and X calls in shape order on the main thread.  Only worth
+// it for draws that touch many shapes.
+#define SHP_PREFETCH_MIN_SHAPES 512
+
+typedef struct _shp_prefetch shp_prefetch;
+
+extern int shp_prefetch_threads(void);
+extern shp_prefetch *shp_prefetch_start(char *file, int *shapes, int count);
+extern SHPObject *shp_prefetch_get(shp_prefetch *prefetch, int position, unsigned long **xy, char **ok);
+extern void shp_prefetch_stop(shp_prefetch *prefetch);
+
+#endif // __XASTIR_SHP_PREFETCH_H
@@ -0,0 +1,425 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 2000-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+
+#ifdef HAVE_CONFIG_H
+  #include "config.h"
+#endif  // HAVE_CONFIG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+
+#include "spider_filter.h"
+#include "snprintf.h"
+#include "util.h"
+
+// Must be last include file
+#include "leak_detection.h"
+
+
+
+static const char spider_filter_type_letters[] = "poimqstunw";
+
+#define TYPE_POSITION  0x001
+#define TYPE_OBJECT    0x002
+#define TYPE_ITEM      0x004
+#define TYPE_MESSAGE   0x008
+#define TYPE_QUERY     0x010
+#define TYPE_STATUS    0x020
+#define TYPE_TELEMETRY 0x040
+#define TYPE_USER      0x080
+#define TYPE_NWS       0x100
+#define TYPE_WEATHER   0x200
+
+
+
+
+
+// Parse a number in degrees or km, rejecting anything after it.
+//
+static int spider_filter_number(const char *text, double low, double high, double *value)
+{
+  char *end;
+
+
+  *value = strtod(text, &end);
+  if (end == text || *end != '\0' || *value < low || *value > high)
+  {
+    return(0);
+  }
+  return(1);
+}
+
+
+
+
+
+// Parse one rule, without its '-'.  "kind" is the letter before the
+// first '/', "part" the fields after it.
+//
+static int spider_filter_rule_parse(spider_filter_rule *rule, char kind, char **part, int parts)
+{
+  double lat, lat2, lon, lon2, km;
+  const char *letter;
+  int i;
+
+
+  rule->kind = kind;
+  rule->count = 0;
+  rule->types = 0;
+
+  switch (kind)
+  {
+    case 'r':
+      if (parts != 3
+          || !spider_filter_number(part[0], -90.0, 90.0, &lat)
+          || !spider_filter_number(part[1], -180.0, 180.0, &lon)
+          || !spider_filter_number(part[2], 0.0, 20038.0, &km))
+      {
+        return(0);
+      }
+      convert_to_xastir_coordinates(&rule->lon[0], &rule->lat[0], (float)lon, (float)lat);
+      rule->meters = km * 1000.0;
+      return(1);
+
+    case 'a':
+      if (parts != 4
+          || !spider_filter_number(part[0], -90.0, 90.0, &lat)
+          || !spider_filter_number(part[1], -180.0, 180.0, &lon)
+          || !spider_filter_number(part[2], -90.0, lat, &lat2)
+          || !spider_filter_number(part[3], lon, 180.0, &lon2))
+      {
+        return(0);
+      }
+      convert_to_xastir_coordinates(&rule->lon[0], &rule->lat[0], (float)lon, (float)lat);
+      convert_to_xastir_coordinates(&rule->lon[1], &rule->lat[1], (float)lon2, (float)lat2);
+      return(1);
+
+    case 'p':
+    case 'b':
+    case 'o':
+      if (parts < 1 || parts > SPIDER_FILTER_WORDS)
+      {
+        return(0);
+      }
+      for (i = 0; i < parts; i++)
+      {
+        if (part[i][0] == '\0' || strlen(part[i]) >= SPIDER_FILTER_WORD)
+        {
+          return(0);
+        }
+        xastir_snprintf(rule->word[i], SPIDER_FILTER_WORD, "%s", part[i]);
+      }
+      rule->count = parts;
+      return(1);
+
+    case 't':
+      if (parts != 1 || part[0][0] == '\0')
+      {
+        return(0);
+      }
+      for (i = 0; part[0][i]; i++)
+      {
+        letter = strchr(spider_filter_type_letters, tolower((int)part[0][i]));
+        if (letter == NULL)
+        {
+          return(0);
+        }
+        rule->types |= 1 << (letter - spider_filter_type_letters);
+      }
+      return(1);
+
+    default:
+      return(0);
+  }
+}
+
+
+
+
+
+// Parse a filter, replacing whatever the filter held.  Rules that
+// can't be parsed are left out.  Returns 0 if all of them could be,
+// -1 if not.
+//
+int spider_filter_parse(spider_filter *filter, const char *text)
+{
+  char copy[512];
+  char *saveptr;
+  char *token;
+  char *part[SPIDER_FILTER_WORDS + 1];
+  char *slash;
+  spider_filter_rule *rule;
+  int parts;
+  int exclude;
+  int status = 0;
+
+
+  filter->count = 0;
+  xastir_snprintf(copy, sizeof(copy), "%s", text);
+
+  for (token = strtok_r(copy, " \t\r\n", &saveptr);
+       token != NULL;
+       token = strtok_r(NULL, " \t\r\n", &saveptr))
+  {
+    exclude = (token[0] == '-');
+    if (exclude)
+    {
+      token++;
+    }
+    if (filter->count >= SPIDER_FILTER_RULES || token[0] == '\0' || token[1] != '/')
+    {
+      status = -1;
+      continue;
+    }
+
+    // Split "k/one/two/..." in place
+    parts = 1;
+    part[0] = token + 2;
+    while ((slash = strchr(part[parts - 1], '/')) != NULL && parts <= SPIDER_FILTER_WORDS)
+    {
+      *slash = '\0';
+      part[parts++] = slash + 1;
+    }
+
+    rule = &filter->rule[filter->count];
+    if (slash != NULL
+        || !spider_filter_rule_parse(rule, (char)tolower((int)token[0]), part, parts))
+    {
+      status = -1;
+      continue;
+    }
+    rule->exclude = exclude;
+    filter->count++;
+  }
+  return(status);
+}
+
+
+
+
+
+// Case-insensitive match of a call or name against a pattern in
+// which '*' matches any run of characters.
+//
+static int spider_filter_glob(const char *pattern, const char *text)
+{
+  while (*pattern)
+  {
+    if (*pattern == '*')
+    {
+      do
+      {
+        if (spider_filter_glob(pattern + 1, text))
+        {
+          return(1);
+        }
+      }
+      while (*text++);
+      return(0);
+    }
+    if (toupper((int)*pattern) != toupper((int)*text))
+    {
+      return(0);
+    }
+    pattern++;
+    text++;
+  }
+  return(*text == '\0');
+}
+
+
+
+
+
+// The type bits of a packet, from its data type byte and, for
+// messages and positions, what follows it.
+//
+static int spider_filter_types(const spider_packet *packet)
+{
+  const char *info = packet->info;
+  size_t length = strlen(info);
+
+
+  switch (info[0])
+  {
+    case '!':
+    case '=':
+      // Uncompressed position with the weather symbol
+      if (length > 19 && info[19] == '_')
+      {
+        return(TYPE_POSITION | TYPE_WEATHER);
+      }
+      return(TYPE_POSITION);
+
+    case '/':
+    case '@':
+      if (length > 26 && info[26] == '_')
+      {
+        return(TYPE_POSITION | TYPE_WEATHER);
+      }
+      return(TYPE_POSITION);
+
+    case 0x27:  // Mic-E
+    case 0x60:
+    case '[':   // Maidenhead grid locator
+    case '$':   // Raw GPS
+      return(TYPE_POSITION);
+
+    case ';':
+      return(TYPE_OBJECT);
+
+    case ')':
+      return(TYPE_ITEM);
+
+    case ':':
+      // ":ADDRESSEE:text"
+      if (strncasecmp(info + 1, "NWS", 3) == 0
+          || strncasecmp(info + 1, "SKY", 3) == 0
+          || strncasecmp(info + 1, "CWA", 3) == 0
+          || strncasecmp(info + 1, "BOM", 3) == 0)
+      {
+        return(TYPE_NWS);
+      }
+      if (length > 10 && info[10] == ':'
+          && (strncmp(info + 11, "PARM.", 5) == 0
+              || strncmp(info + 11, "UNIT.", 5) == 0
+              || strncmp(info + 11, "EQNS.", 5) == 0
+              || strncmp(info + 11, "BITS.", 5) == 0))
+      {
+        return(TYPE_TELEMETRY);
+      }
+      return(TYPE_MESSAGE);
+
+    case '?':
+      return(TYPE_QUERY);
+
+    case '>':
+      return(TYPE_STATUS);
+
+    case 'T':
+      return(TYPE_TELEMETRY);
+
+    case '{':
+      return(TYPE_USER);
+
+    case '_':   // Positionless weather
+    case '#':   // Peet Bros
+    case '*':
+      return(TYPE_WEATHER);
+
+    default:
+      return(0);
+  }
+}
+
+
+
+
+
+static int spider_filter_rule_match(const spider_filter_rule *rule, const spider_packet *packet)
+{
+  int i;
+
+
+  switch (rule->kind)
+  {
+    case 'r':
+      return(packet->has_position
+             && calc_distance((long)rule->lat[0], (long)rule->lon[0],
+                              packet->lat, packet->lon) <= rule->meters);
+
+    case 'a':
+      return(packet->has_position
+             && packet->lat >= (long)rule->lat[0] && packet->lat <= (long)rule->lat[1]
+             && packet->lon >= (long)rule->lon[0] && packet->lon <= (long)rule->lon[1]);
+
+    case 'p':
+      for (i = 0; i < rule->count; i++)
+      {
+        if (strncasecmp(packet->call, rule->word[i], strlen(rule->word[i])) == 0)
+        {
+          return(1);
+        }
+      }
+      return(0);
+
+    case 'b':
+    case 'o':
+      if (rule->kind == 'o' && packet->name == NULL)
+      {
+        return(0);
+      }
+      for (i = 0; i < rule->count; i++)
+      {
+        if (spider_filter_glob(rule->word[i],
+                               rule->kind == 'b' ? packet->call : packet->name))
+        {
+          return(1);
+        }
+      }
+      return(0);
+
+    case 't':
+      return((spider_filter_types(packet) & rule->types) != 0);
+
+    default:
+      return(0);
+  }
+}
+
+
+
+
+
+// Whether a packet passes the filter
+//
+int spider_filter_match(const spider_filter *filter, const spider_packet *packet)
+{
+  int matched = 0;
+  int i;
+
+
+  if (filter->count == 0)
+  {
+    return(1);
+  }
+  for (i = 0; i < filter->count; i++)
+  {
+    // Once a rule matched, only the excluding ones matter
+    if (matched && !filter->rule[i].exclude)
+    {
+      continue;
+    }
+    if (spider_filter_rule_match(&filter->rule[i], packet))
+    {
+      if (filter->rule[i].exclude)
+      {
+        return(0);
+      }
+      matched = 1;
+    }
+  }
+  return(matched);
+}
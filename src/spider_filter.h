@@ -0,0 +1,79 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 2000-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+#ifndef __XASTIR_SPIDER_FILTER_H
+#define __XASTIR_SPIDER_FILTER_H
+
+// Per-client packet filter of the x_spider server, in the APRS-IS
+// server filter syntax.  A filter is a list of rules separated by
+// spaces:
+//
+//   r/lat/lon/dist             Within dist km of lat/lon (degrees)
+//   a/latN/lonW/latS/lonE      Inside the box
+//   p/aa/bb/...                Sender starts with one of the prefixes
+//   b/call1/call2/...          Sender is one of the calls (* wildcards)
+//   o/name1/name2/...          Object or item is one of the names
+//   t/poimqstunw               Of one of the packet types:  position,
+//                              object, item, message, query, status,
+//                              telemetry, user-defined, NWS, weather
+//
+// A rule starting with '-' excludes the packets it matches.  A packet
+// is sent if it matches at least one rule and no excluding rule.  An
+// empty filter sends everything.
+#define SPIDER_FILTER_RULES 16
+#define SPIDER_FILTER_WORDS 9
+#define SPIDER_FILTER_WORD  16
+
+typedef struct
+{
+  char kind;                  // 'r', 'a', 'p', 'b', 'o' or 't'
+  int exclude;
+  int count;                  // Words used
+  char word[SPIDER_FILTER_WORDS][SPIDER_FILTER_WORD];
+  int types;                  // Type bits, for 't'
+  unsigned long lat[2];       // Xastir coordinates:  the point for
+  unsigned long lon[2];       //  'r', the corners for 'a'
+  double meters;              // Range, for 'r'
+} spider_filter_rule;
+
+typedef struct
+{
+  int count;
+  spider_filter_rule rule[SPIDER_FILTER_RULES];
+} spider_filter;
+
+// A packet as the filter sees it
+typedef struct
+{
+  const char *call;           // Sender
+  const char *name;           // Object or item name, NULL if neither
+  const char *info;           // Info field, from the data type byte on
+  int has_position;
+  long lat;                   // Xastir coordinates
+  long lon;
+} spider_packet;
+
+extern int spider_filter_parse(spider_filter *filter, const char *text);
+extern int spider_filter_match(const spider_filter *filter, const spider_packet *packet);
+
+#define spider_filter_active(filter) ((filter)->count > 0)
+
+#endif
@@ -0,0 +1,143 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 2000-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+
+#ifdef HAVE_CONFIG_H
+  #include "config.h"
+#endif  // HAVE_CONFIG_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "spider_ring.h"
+
+// Must be last include file
+#include "leak_detection.h"
+
+
+
+
+
+// Returns 0, or -1 if the buffer couldn't be allocated.
+//
+int spider_ring_init(spider_ring *ring, size_t size)
+{
+  ring->data = (char *)malloc(size);
+  ring->size = ring->data ? size : 0;
+  ring->head = 0;
+  ring->length = 0;
+  return(ring->data ? 0 : -1);
+}
+
+
+
+
+
+void spider_ring_free(spider_ring *ring)
+{
+  free(ring->data);
+  ring->data = NULL;
+  ring->size = 0;
+  ring->head = 0;
+  ring->length = 0;
+}
+
+
+
+
+
+// Queue "length" bytes.  Returns 0, or -1 if they don't all fit, in
+// which case nothing is queued.
+//
+int spider_ring_put(spider_ring *ring, const char *data, size_t length)
+{
+  size_t tail, first;
+
+
+  if (length > ring->size - ring->length)
+  {
+    return(-1);
+  }
+
+  tail = (ring->head + ring->length) % (ring->size ? ring->size : 1);
+  first = ring->size - tail;
+  if (first > length)
+  {
+    first = length;
+  }
+  memcpy(ring->data + tail, data, first);
+  memcpy(ring->data, data + first, length - first);
+  ring->length += length;
+  return(0);
+}
+
+
+
+
+
+// Write as much of the queue to "fd" as it takes, with one writev()
+// even when the queue wraps around the end of the buffer.  Returns the
+// bytes written, 0 if the queue is empty or the write would block, or
+// -1 on error with errno set.
+//
+ssize_t spider_ring_write(spider_ring *ring, int fd)
+{
+  struct iovec iov[2];
+  int count = 1;
+  ssize_t n;
+
+
+  if (ring->length == 0)
+  {
+    return(0);
+  }
+
+  iov[0].iov_base = ring->data + ring->head;
+  iov[0].iov_len = ring->length;
+  if (ring->head + ring->length > ring->size)
+  {
+    iov[0].iov_len = ring->size - ring->head;
+    iov[1].iov_base = ring->data;
+    iov[1].iov_len = ring->length - iov[0].iov_len;
+    count = 2;
+  }
+
+  n = writev(fd, iov, count);
+  if (n < 0)
+  {
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+    {
+      return(0);
+    }
+    return(-1);
+  }
+
+  ring->head = (ring->head + n) % ring->size;
+  ring->length -= n;
+  if (ring->length == 0)
+  {
+    ring->head = 0;
+  }
+  return(n);
+}
@@ -0,0 +1,48 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 2000-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+#ifndef __XASTIR_SPIDER_RING_H
+#define __XASTIR_SPIDER_RING_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+// Output queue of one x_spider client.  Lines that can't be written to
+// the client's socket right away are queued here and written out as
+// the socket drains.  The ring never grows: once a client is so far
+// behind that the next line doesn't fit, spider_ring_put() fails and
+// the server drops the client instead of buffering without bound.
+typedef struct
+{
+  char *data;
+  size_t size;
+  size_t head;                // Offset of the first queued byte
+  size_t length;              // Bytes queued
+} spider_ring;
+
+extern int spider_ring_init(spider_ring *ring, size_t size);
+extern void spider_ring_free(spider_ring *ring);
+extern int spider_ring_put(spider_ring *ring, const char *data, size_t length);
+extern ssize_t spider_ring_write(spider_ring *ring, int fd);
+
+#define spider_ring_length(ring) ((ring)->length)
+
+#endif
@@ -45,6 +45,7 @@
 
 #include <ctype.h>
 #include <sys/types.h>
+#include <sys/time.h>
 #include "awk.h"
 #include "dbfawk.h"
 
@@ -99,13 +100,13 @@ void print_symtbl(awk_symtab *this)
 
 awk_rule rules[] =
 {
-  { 0, BEGIN, NULL, NULL, 0, 0, "key=\"\"; lanes=1; color=8; name=\"\"; filled=0; pattern=1; display_level=8192; label_level=32",0,0 },
-  { 0, REGEXP, "^TLID=(.*)$", NULL, 0, 0, "key=\"$1\"",0,0  },
-  { 0, REGEXP, "^FENAME=United States Highway (.*)$", NULL, 0, 0, "name=\"US $1\"; next",0,0  },
-  { 0, REGEXP, "^FENAME=(.*)$", NULL, 0, 0, "name=\"$1\"; next",0,0  },
-  { 0, REGEXP, "^CFCC=A1", NULL, 0, 0, "lanes=4; color=4; next",0,0  },
-  { 0, REGEXP, "^CFCC=A3", NULL, 0, 0, "lanes=2; color=8",0,0  },
-  { 0, REGEXP, "^CFCC=A3[1-6]", NULL, 0, 0, "display_level=256; next",0,0  },
+  { 0, BEGIN, NULL, NULL, 0, 0, "key=\"\"; lanes=1; color=8; name=\"\"; filled=0; pattern=1; display_level=8192; label_level=32",0,0,NULL,0 },
+  { 0, REGEXP, "^TLID=(.*)$", NULL, 0, 0, "key=\"$1\"",0,0,NULL,0  },
+  { 0, REGEXP, "^FENAME=United States Highway (.*)$", NULL, 0, 0, "name=\"US $1\"; next",0,0,NULL,0  },
+  { 0, REGEXP, "^FENAME=(.*)$", NULL, 0, 0, "name=\"$1\"; next",0,0,NULL,0  },
+  { 0, REGEXP, "^CFCC=A1", NULL, 0, 0, "lanes=4; color=4; next",0,0,NULL,0  },
+  { 0, REGEXP, "^CFCC=A3", NULL, 0, 0, "lanes=2; color=8",0,0,NULL,0  },
+  { 0, REGEXP, "^CFCC=A3[1-6]", NULL, 0, 0, "display_level=256; next",0,0,NULL,0  },
 };
 
 
@@ -116,10 +117,12 @@ int nrules = sizeof(rules)/sizeof(rules[0]);
 
 void usage(void)
 {
-  fprintf(stderr,"Usage: testdbfawk [-f file.awk| -D dir] -d file.dbf\n");
+  fprintf(stderr,"Usage: testdbfawk [-f file.awk| -D dir] -d file.dbf [-b N] [-m]\n");
   fprintf(stderr," -D for dir containing *.dbfawk files.\n");
   fprintf(stderr," or -f for file containing awk rules.\n");
   fprintf(stderr," -d for dbf file to parse \n");
+  fprintf(stderr," -b to time parsing N records instead of printing them\n");
+  fprintf(stderr," -m to remember results by field values, as xastir does\n");
 }
 
 
@@ -140,9 +143,9 @@ int main(int argc, char *argv[])
   /* variables to bind to: */
   char dbfinfo[1024];        /* list of DBF field names */
   char dbffields[1024];    /* subset we want to read */
-  char name[128];
-  char key[128];
-  char symbol[4];
+  char name[128] = "";
+  char key[128] = "";
+  char symbol[4] = "";
   int color = 0;
   int lanes = 0;
   int filled = 5;
@@ -159,6 +162,8 @@ int main(int argc, char *argv[])
   double label_lat = 0.0;
 
   char *dir = NULL,*file = NULL,*dfile = NULL;
+  int bench = 0;
+  dbfawk_memo *memo = NULL;
   dbfawk_sig_info *si = NULL, *sigs = NULL;
 
 // Allocates new memory!
@@ -199,6 +204,19 @@ int main(int argc, char *argv[])
     argv++;
     argc -= 2;
   }
+  if (argc > 2 && strcmp(argv[1],"-b") == 0)
+  {
+    bench = atoi(argv[2]);
+    argv++;
+    argv++;
+    argc -= 2;
+  }
+  if (argc > 1 && strcmp(argv[1],"-m") == 0)
+  {
+    memo = dbfawk_memo_new();
+    argv++;
+    argc--;
+  }
 
   /* declare/bind these symbols */
 // Allocates new memory!
@@ -268,10 +286,32 @@ int main(int argc, char *argv[])
       fprintf(stderr,"DBF Signatures DON'T match\n");
     }
     fi = dbfawk_field_list(dbf, dbffields);
+    if (memo && !dbfawk_memo_bind(memo,rs,si ? si->file : file))
+    {
+      fprintf(stderr,"Results can't be remembered for this program\n");
+    }
+    if (bench > 0 && DBFGetRecordCount(dbf) > 0)
+    {
+      /* time N records, going round the file as often as needed */
+      struct timeval start, stop;
+      double elapsed;
+      int records = DBFGetRecordCount(dbf);
+
+      gettimeofday(&start, NULL);
+      for (i = 0; i < bench; i++)
+      {
+        dbfawk_memo_parse_record(memo,rs,dbf,fi,i % records);
+      }
+      gettimeofday(&stop, NULL);
+      elapsed = (stop.tv_sec - start.tv_sec)
+                + (stop.tv_usec - start.tv_usec) / 1000000.0;
+      fprintf(stderr,"%d records in %.3f seconds, %.3f usec/record\n",
+              bench, elapsed, elapsed * 1000000.0 / bench);
+    }
     /* now actually read the whole file */
-    for (i = 0; i < DBFGetRecordCount(dbf); i++ )
+    for (i = 0; bench <= 0 && i < DBFGetRecordCount(dbf); i++ )
     {
-      dbfawk_parse_record(rs,dbf,fi,i);
+      dbfawk_memo_parse_record(memo,rs,dbf,fi,i);
       fprintf(stderr,"name=%s, ",name);
       fprintf(stderr,"key=%s, ",key);
       fprintf(stderr,"symbol=%s, ",symbol);
@@ -292,6 +332,15 @@ int main(int argc, char *argv[])
       fprintf(stderr,"label_lat=%lf\n",label_lat);
       //    print_symtbl(symtbl);
     }
+    if (memo)
+    {
+      unsigned long lookups, hits;
+
+      dbfawk_memo_stats(memo,&lookups,&hits);
+      fprintf(stderr,"memo: %lu lookups, %lu hits\n",lookups,hits);
+      dbfawk_memo_free(memo);
+    }
+    dbfawk_free_info(fi);
     DBFClose(dbf);
   }
   else                /* use cmdline args */
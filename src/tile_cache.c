@@ -0,0 +1,291 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 2000-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+
+#ifdef HAVE_CONFIG_H
+  #include "config.h"
+#endif  // HAVE_CONFIG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cache_utils.h"
+#include "tile_cache.h"
+
+// Must be last include file
+#include "leak_detection.h"
+
+
+
+#define TILE_CACHE_BUCKETS 1024     // Must be a power of two
+
+typedef struct _tile_cache_entry
+{
+  lru_link lru;                     // Must be first
+  struct _tile_cache_entry *chain;  // Next in the same bucket
+  uint32_t hash;
+  char *server;
+  int zoom;
+  unsigned long x;
+  unsigned long y;
+  time_t mtime;
+  off_t size;
+  uint32_t variant;
+  size_t bytes;
+  tile_cache_tile *tile;
+} tile_cache_entry;
+
+static tile_cache_entry *bucket[TILE_CACHE_BUCKETS];
+static lru_list cache_lru = { NULL, NULL };
+static size_t cache_bytes = 0;
+static size_t cache_budget = 64 * 1024 * 1024;
+
+
+
+
+
+// FNV-1a over the key
+//
+static uint32_t tile_cache_hash(const char *server, int zoom, unsigned long x, unsigned long y)
+{
+  unsigned long value[3];
+
+
+  value[0] = (unsigned long)zoom;
+  value[1] = x;
+  value[2] = y;
+  return(fnv1a_hash(fnv1a_string(FNV1A_INIT, server), value, sizeof(value)));
+}
+
+
+
+
+
+// Allocate a tile of width x height pixels, all transparent.
+//
+tile_cache_tile *tile_cache_tile_new(int width, int height)
+{
+  tile_cache_tile *tile;
+
+
+  tile = (tile_cache_tile *)malloc(sizeof(tile_cache_tile));
+  if (!tile)
+  {
+    return(NULL);
+  }
+  tile->width = width;
+  tile->height = height;
+  tile->pixel = (uint32_t *)malloc((size_t)width * height * sizeof(uint32_t));
+  tile->drawn = (uint8_t *)calloc((size_t)width * height, 1);
+  if (!tile->pixel || !tile->drawn)
+  {
+    tile_cache_tile_free(tile);
+    return(NULL);
+  }
+  return(tile);
+}
+
+
+
+
+
+void tile_cache_tile_free(tile_cache_tile *tile)
+{
+  if (tile)
+  {
+    free(tile->pixel);
+    free(tile->drawn);
+    free(tile);
+  }
+}
+
+
+
+
+
+static void tile_cache_remove(tile_cache_entry *entry)
+{
+  tile_cache_entry **link;
+
+
+  for (link = &bucket[entry->hash & (TILE_CACHE_BUCKETS - 1)]; *link; link = &(*link)->chain)
+  {
+    if (*link == entry)
+    {
+      *link = entry->chain;
+      break;
+    }
+  }
+  lru_unlink(&cache_lru, &entry->lru);
+  cache_bytes -= entry->bytes;
+  tile_cache_tile_free(entry->tile);
+  free(entry->server);
+  free(entry);
+}
+
+
+
+
+
+static tile_cache_entry *tile_cache_find(uint32_t hash, const char *server, int zoom,
+    unsigned long x, unsigned long y)
+{
+  tile_cache_entry *entry;
+
+
+  for (entry = bucket[hash & (TILE_CACHE_BUCKETS - 1)]; entry; entry = entry->chain)
+  {
+    if (entry->hash == hash && entry->zoom == zoom && entry->x == x && entry->y == y
+        && strcmp(entry->server, server) == 0)
+    {
+      return(entry);
+    }
+  }
+  return(NULL);
+}
+
+
+
+
+
+// Get a cached tile, or NULL.  A tile cached from a file of another
+// mtime or size, or with another variant, is dropped.  The cache keeps
+// ownership; the tile stays valid until the next tile_cache_add().
+//
+tile_cache_tile *tile_cache_get(const char *server, int zoom, unsigned long x, unsigned long y,
+                                time_t mtime, off_t size, uint32_t variant)
+{
+  tile_cache_entry *entry;
+
+
+  entry = tile_cache_find(tile_cache_hash(server, zoom, x, y), server, zoom, x, y);
+  if (!entry)
+  {
+    return(NULL);
+  }
+  if (entry->mtime != mtime || entry->size != size || entry->variant != variant)
+  {
+    tile_cache_remove(entry);
+    return(NULL);
+  }
+
+  lru_unlink(&cache_lru, &entry->lru);
+  lru_push(&cache_lru, &entry->lru);
+  return(entry->tile);
+}
+
+
+
+
+
+// Hand a decoded tile to the cache, which takes it over either way.
+// Returns the tile, or NULL if it couldn't be kept (and was freed).
+// Less recently used tiles are dropped to stay within the budget, but
+// never the one just added.
+//
+tile_cache_tile *tile_cache_add(const char *server, int zoom, unsigned long x, unsigned long y,
+                                time_t mtime, off_t size, uint32_t variant, tile_cache_tile *tile)
+{
+  tile_cache_entry *entry;
+  uint32_t hash;
+
+
+  hash = tile_cache_hash(server, zoom, x, y);
+  entry = tile_cache_find(hash, server, zoom, x, y);
+  if (entry)
+  {
+    tile_cache_remove(entry);
+  }
+
+  entry = (tile_cache_entry *)malloc(sizeof(tile_cache_entry));
+  if (!entry)
+  {
+    tile_cache_tile_free(tile);
+    return(NULL);
+  }
+  entry->server = strdup(server);
+  if (!entry->server)
+  {
+    free(entry);
+    tile_cache_tile_free(tile);
+    return(NULL);
+  }
+  entry->hash = hash;
+  entry->zoom = zoom;
+  entry->x = x;
+  entry->y = y;
+  entry->mtime = mtime;
+  entry->size = size;
+  entry->variant = variant;
+  entry->tile = tile;
+  entry->bytes = sizeof(tile_cache_entry) + sizeof(tile_cache_tile) + strlen(server) + 1
+                 + (size_t)tile->width * tile->height * (sizeof(uint32_t) + 1);
+
+  entry->chain = bucket[hash & (TILE_CACHE_BUCKETS - 1)];
+  bucket[hash & (TILE_CACHE_BUCKETS - 1)] = entry;
+  lru_push(&cache_lru, &entry->lru);
+  cache_bytes += entry->bytes;
+
+  while (cache_bytes > cache_budget && cache_lru.tail && cache_lru.tail != &entry->lru)
+  {
+    tile_cache_remove((tile_cache_entry *)cache_lru.tail);
+  }
+  return(tile);
+}
+
+
+
+
+
+// Set the most the cache may hold, dropping tiles if it now holds more.
+//
+void tile_cache_set_budget(size_t bytes)
+{
+  cache_budget = bytes;
+  while (cache_bytes > cache_budget && cache_lru.tail)
+  {
+    tile_cache_remove((tile_cache_entry *)cache_lru.tail);
+  }
+}
+
+
+
+
+
+// Bytes held by the tile cache
+//
+size_t tile_cache_bytes(void)
+{
+  return(cache_bytes);
+}
+
+
+
+
+
+void tile_cache_clear(void)
+{
+  while (cache_lru.tail)
+  {
+    tile_cache_remove((tile_cache_entry *)cache_lru.tail);
+  }
+}
@@ -0,0 +1,58 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 2000-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+#ifndef __XASTIR_TILE_CACHE_H
+#define __XASTIR_TILE_CACHE_H
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+
+// Decoded map tiles kept in memory, so that a redraw doesn't decode
+// the same tile files again.  A tile holds the X pixel value of each
+// of its pixels, ready to store into an XImage.
+//
+// Tiles are keyed by server, zoom, x and y.  The size and mtime of the
+// tile file and a caller-supplied "variant" (a hash of whatever else
+// went into the pixel values, e.g. the map intensity) are checked on
+// lookup, and a tile that doesn't match is dropped.
+//
+// The least recently used tiles are freed once the cache holds more
+// than its budget.
+typedef struct
+{
+  int width;
+  int height;
+  uint32_t *pixel;            // X pixel value of each pixel
+  uint8_t *drawn;             // 0 where the tile is transparent
+} tile_cache_tile;
+
+extern tile_cache_tile *tile_cache_tile_new(int width, int height);
+extern void tile_cache_tile_free(tile_cache_tile *tile);
+extern tile_cache_tile *tile_cache_get(const char *server, int zoom, unsigned long x, unsigned long y,
+                                       time_t mtime, off_t size, uint32_t variant);
+extern tile_cache_tile *tile_cache_add(const char *server, int zoom, unsigned long x, unsigned long y,
+                                       time_t mtime, off_t size, uint32_t variant, tile_cache_tile *tile);
+extern void tile_cache_set_budget(size_t bytes);
+extern size_t tile_cache_bytes(void);
+extern void tile_cache_clear(void);
+
+#endif
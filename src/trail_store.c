@@ -0,0 +1,491 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 1999,2000  Frank Giannandrea
+ * Copyright (C) 2000-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+#ifdef HAVE_CONFIG_H
+  #include "config.h"
+#endif  // HAVE_CONFIG_H
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "trail_store.h"
+
+// Must be last include file
+#include "leak_detection.h"
+
+
+
+#define TRAIL_STORE_MIN_BYTES 64    // First allocation for the deltas
+
+// Six fields of up to ten bytes each, plus the flag and length bytes
+#define TRAIL_RECORD_MAX 62
+
+// Totals over all trails, for the statistics display
+static unsigned long trail_points = 0;
+static unsigned long trail_points_peak = 0;
+static unsigned long trail_bytes = 0;
+
+
+
+
+
+// Append "value" to "buf" as a zigzag-encoded variable-length
+// integer.  Returns the number of bytes written.
+//
+static int put_delta(unsigned char *buf, long value)
+{
+  unsigned long u;
+  int len = 0;
+
+
+  if (value < 0)
+  {
+    u = ~((unsigned long)value << 1);
+  }
+  else
+  {
+    u = (unsigned long)value << 1;
+  }
+
+  while (u >= 0x80)
+  {
+    buf[len++] = (unsigned char)(u | 0x80);
+    u >>= 7;
+  }
+  buf[len++] = (unsigned char)u;
+
+  return(len);
+}
+
+
+
+
+
+static long get_delta(const unsigned char **buf)
+{
+  unsigned long u = 0;
+  int shift = 0;
+  const unsigned char *ptr = *buf;
+
+
+  while (*ptr & 0x80)
+  {
+    u |= (unsigned long)(*ptr++ & 0x7f) << shift;
+    shift += 7;
+  }
+  u |= (unsigned long)(*ptr++) << shift;
+
+  *buf = ptr;
+
+  if (u & 1)
+  {
+    return(~(long)(u >> 1));
+  }
+  return((long)(u >> 1));
+}
+
+
+
+
+
+// Encode the step from "from" to "to".  Returns the record length.
+//
+static int encode_record(unsigned char *buf, const TrackRow *from, const TrackRow *to)
+{
+  int len = 0;
+
+
+  len += put_delta(buf + len, to->trail_long_pos - from->trail_long_pos);
+  len += put_delta(buf + len, to->trail_lat_pos - from->trail_lat_pos);
+  len += put_delta(buf + len, (long)(to->sec - from->sec));
+  len += put_delta(buf + len, to->speed - from->speed);
+  len += put_delta(buf + len, (long)(to->course - from->course));
+  len += put_delta(buf + len, to->altitude - from->altitude);
+  buf[len++] = (unsigned char)(to->flag ^ from->flag);
+  len++;
+  buf[len - 1] = (unsigned char)len;
+
+  return(len);
+}
+
+
+
+
+
+// Apply the record at "buf" to "point", forwards if "direction" is 1
+// or backwards if it is -1.  Returns the record length.
+//
+static int apply_record(const unsigned char *buf, TrackRow *point, int direction)
+{
+  const unsigned char *record = buf;
+
+
+  point->trail_long_pos += direction * get_delta(&buf);
+  point->trail_lat_pos  += direction * get_delta(&buf);
+  point->sec            += direction * get_delta(&buf);
+  point->speed          += direction * get_delta(&buf);
+  point->course         += (int)(direction * get_delta(&buf));
+  point->altitude       += direction * get_delta(&buf);
+  point->flag           ^= (char)*buf;
+
+  return((int)(buf - record) + 2);
+}
+
+
+
+
+
+static void trail_stats_points(long points)
+{
+  trail_points += points;
+  if (trail_points > trail_points_peak)
+  {
+    trail_points_peak = trail_points;
+  }
+}
+
+
+
+
+
+// Add a point at the newest end of the trail, creating the trail if
+// *trail is NULL.  Returns 0 if out of memory, in which case the
+// trail is left as it was.
+//
+int trail_store_append(TrailStore **trail, const TrackRow *point)
+{
+  TrailStore *ptr = *trail;
+  unsigned char record[TRAIL_RECORD_MAX];
+  int len;
+
+
+  if (ptr == NULL)
+  {
+    ptr = calloc(1, sizeof(TrailStore));
+    if (ptr == NULL)
+    {
+      return(0);
+    }
+    ptr->oldest = *point;
+    ptr->newest = *point;
+    ptr->count = 1;
+    *trail = ptr;
+
+    trail_bytes += sizeof(TrailStore);
+    trail_stats_points(1);
+    return(1);
+  }
+
+  len = encode_record(record, &ptr->newest, point);
+
+  if (ptr->length + len > ptr->size)
+  {
+    // Reclaim the space left by expired points first
+    if (ptr->start > 0)
+    {
+      memmove(ptr->data, ptr->data + ptr->start, ptr->length - ptr->start);
+      ptr->length -= ptr->start;
+      ptr->start = 0;
+    }
+
+    if (ptr->length + len > ptr->size)
+    {
+      size_t new_size = ptr->size ? ptr->size * 2 : TRAIL_STORE_MIN_BYTES;
+      unsigned char *new_data;
+
+
+      new_data = realloc(ptr->data, new_size);
+      if (new_data == NULL)
+      {
+        return(0);
+      }
+      trail_bytes += new_size - ptr->size;
+      ptr->data = new_data;
+      ptr->size = new_size;
+    }
+  }
+
+  memcpy(ptr->data + ptr->length, record, len);
+  ptr->length += len;
+  ptr->newest = *point;
+  ptr->count++;
+
+  trail_stats_points(1);
+  return(1);
+}
+
+
+
+
+
+// Drop the oldest point.  Frees the trail and sets *trail to NULL
+// when the last point goes.  Returns the number of points left.
+//
+int trail_store_drop_oldest(TrailStore **trail)
+{
+  TrailStore *ptr = *trail;
+
+
+  if (ptr == NULL)
+  {
+    return(0);
+  }
+
+  if (ptr->count == 1)
+  {
+    trail_store_free(trail);
+    return(0);
+  }
+
+  ptr->start += apply_record(ptr->data + ptr->start, &ptr->oldest, 1);
+  ptr->count--;
+  trail_points--;
+
+  if (ptr->start == ptr->length)
+  {
+    // Only the newest point is left
+    ptr->start = 0;
+    ptr->length = 0;
+  }
+
+  // Give memory back once most of the buffer is unused
+  if (ptr->size > TRAIL_STORE_MIN_BYTES
+      && (ptr->length - ptr->start) * 4 < ptr->size)
+  {
+    unsigned char *new_data;
+    size_t new_size = ptr->size / 2;
+
+
+    memmove(ptr->data, ptr->data + ptr->start, ptr->length - ptr->start);
+    ptr->length -= ptr->start;
+    ptr->start = 0;
+
+    new_data = realloc(ptr->data, new_size);
+    if (new_data != NULL)
+    {
+      trail_bytes -= ptr->size - new_size;
+      ptr->data = new_data;
+      ptr->size = new_size;
+    }
+  }
+
+  return(ptr->count);
+}
+
+
+
+
+
+// Rebuild a trail from its oldest and newest points and the delta
+// records between them, as found from trail->data + trail->start to
+// trail->length in the trail that was saved.  Used when loading a
+// station snapshot.  Returns 0 if out of memory or if the records
+// can't belong to "count" points, leaving *trail NULL.
+//
+int trail_store_restore(TrailStore **trail, const TrackRow *oldest, const TrackRow *newest,
+                        int count, const unsigned char *data, size_t length)
+{
+  TrailStore *ptr;
+
+
+  *trail = NULL;
+  if (count < 1 || (count == 1) != (length == 0)
+      || (length > 0 && data[length - 1] > length))
+  {
+    return(0);
+  }
+
+  ptr = calloc(1, sizeof(TrailStore));
+  if (ptr == NULL)
+  {
+    return(0);
+  }
+  if (length > 0)
+  {
+    ptr->data = malloc(length);
+    if (ptr->data == NULL)
+    {
+      free(ptr);
+      return(0);
+    }
+    memcpy(ptr->data, data, length);
+  }
+  ptr->oldest = *oldest;
+  ptr->newest = *newest;
+  ptr->count = count;
+  ptr->length = length;
+  ptr->size = length;
+  *trail = ptr;
+
+  trail_bytes += sizeof(TrailStore) + length;
+  trail_stats_points(count);
+  return(1);
+}
+
+
+
+
+
+void trail_store_free(TrailStore **trail)
+{
+  TrailStore *ptr = *trail;
+
+
+  if (ptr == NULL)
+  {
+    return;
+  }
+
+  trail_points -= ptr->count;
+  trail_bytes -= sizeof(TrailStore) + ptr->size;
+
+  if (ptr->data != NULL)
+  {
+    free(ptr->data);
+  }
+  free(ptr);
+  *trail = NULL;
+}
+
+
+
+
+
+// Memory held by one trail
+//
+size_t trail_store_bytes(const TrailStore *trail)
+{
+  if (trail == NULL)
+  {
+    return(0);
+  }
+  return(sizeof(TrailStore) + trail->size);
+}
+
+
+
+
+
+// Points and bytes held by all trails, for the statistics display
+//
+void trail_store_stats(unsigned long *points, unsigned long *peak, unsigned long *bytes)
+{
+  *points = trail_points;
+  *peak = trail_points_peak;
+  *bytes = trail_bytes;
+}
+
+
+
+
+
+// Start at the oldest point.  Returns 0 if the trail is empty.
+//
+int trail_first(const TrailStore *trail, TrailCursor *cursor)
+{
+  if (trail == NULL)
+  {
+    return(0);
+  }
+  cursor->trail = trail;
+  cursor->offset = trail->start;
+  cursor->point = trail->oldest;
+  return(1);
+}
+
+
+
+
+
+// Start at the newest point.  Returns 0 if the trail is empty.
+//
+int trail_last(const TrailStore *trail, TrailCursor *cursor)
+{
+  if (trail == NULL)
+  {
+    return(0);
+  }
+  cursor->trail = trail;
+  cursor->offset = trail->length;
+  cursor->point = trail->newest;
+  return(1);
+}
+
+
+
+
+
+// Step to the next newer point.  Returns 0 at the newest point.
+//
+int trail_next(TrailCursor *cursor)
+{
+  const TrailStore *trail = cursor->trail;
+
+
+  if (cursor->offset >= trail->length)
+  {
+    return(0);
+  }
+  cursor->offset += apply_record(trail->data + cursor->offset, &cursor->point, 1);
+  return(1);
+}
+
+
+
+
+
+// Step to the next older point.  Returns 0 at the oldest point.
+//
+int trail_prev(TrailCursor *cursor)
+{
+  const TrailStore *trail = cursor->trail;
+
+
+  if (cursor->offset <= trail->start)
+  {
+    return(0);
+  }
+  cursor->offset -= trail->data[cursor->offset - 1];
+  (void)apply_record(trail->data + cursor->offset, &cursor->point, -1);
+  return(1);
+}
+
+
+
+
+
+// Get the point before the newest one.  The newest point is usually
+// the station's current position, so this is where it was before.
+// Returns 0 if the trail has fewer than two points.
+//
+int trail_store_previous(const TrailStore *trail, TrackRow *point)
+{
+  TrailCursor cursor;
+
+
+  if (!trail_last(trail, &cursor) || !trail_prev(&cursor))
+  {
+    return(0);
+  }
+  *point = cursor.point;
+  return(1);
+}
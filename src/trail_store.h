@@ -0,0 +1,88 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 1999,2000  Frank Giannandrea
+ * Copyright (C) 2000-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+#ifndef __XASTIR_TRAIL_STORE_H
+#define __XASTIR_TRAIL_STORE_H
+
+#include <stddef.h>
+#include <time.h>
+
+// One track point, as handed out by the trail store.
+typedef struct _TrackRow
+{
+  long    trail_long_pos;     // coordinate of trail point
+  long    trail_lat_pos;      // coordinate of trail point
+  time_t  sec;                // date/time of position
+  long    speed;              // in 0.1 km/h   undefined: -1
+  int     course;             // in degrees    undefined: -1
+  long    altitude;           // in 0.1 m      undefined: -99999
+  char    flag;               // several flags, see below
+} TrackRow;
+
+
+
+// trail flag definitions
+#define TR_LOCAL        0x01    // heard direct (not via digis)
+#define TR_NEWTRK       0x02    // start new track
+
+
+
+// Track points of one station, oldest to newest.  The oldest and the
+// newest point are kept whole.  Every point after the oldest is
+// stored in "data" as the difference from the point before it, as a
+// run of variable-length integers followed by the length of the
+// record, so the trail can be walked from either end.  Expired
+// points are dropped off the front by moving "start" along.
+typedef struct _TrailStore
+{
+  TrackRow oldest;
+  TrackRow newest;
+  int count;                  // Points in the trail, always >= 1
+  unsigned char *data;        // Delta records
+  size_t start;               // Offset of the record for the 2nd point
+  size_t length;              // End of the last record
+  size_t size;                // Bytes allocated for data
+} TrailStore;
+
+// Position while walking a trail.  "point" is the current point.
+typedef struct
+{
+  const TrailStore *trail;
+  size_t offset;              // End of the record for "point"
+  TrackRow point;
+} TrailCursor;
+
+extern int trail_store_append(TrailStore **trail, const TrackRow *point);
+extern int trail_store_drop_oldest(TrailStore **trail);
+extern void trail_store_free(TrailStore **trail);
+extern int trail_store_restore(TrailStore **trail, const TrackRow *oldest, const TrackRow *newest,
+                               int count, const unsigned char *data, size_t length);
+extern size_t trail_store_bytes(const TrailStore *trail);
+extern void trail_store_stats(unsigned long *points, unsigned long *peak, unsigned long *bytes);
+
+extern int trail_first(const TrailStore *trail, TrailCursor *cursor);
+extern int trail_last(const TrailStore *trail, TrailCursor *cursor);
+extern int trail_next(TrailCursor *cursor);
+extern int trail_prev(TrailCursor *cursor);
+extern int trail_store_previous(const TrailStore *trail, TrackRow *point);
+
+#endif
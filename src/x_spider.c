@@ -67,17 +67,16 @@
 //
 // x_spider:
 //   Accepts client socket connections.
-//   Spawns a new process for each one.
-//   Each new process talks to the main x_spider via two pipes.
+//   Serves all of them, the UDP port and the pipes to Xastir from
+//     one process with a single event loop (epoll on Linux, poll()
+//     elsewhere).  It shouldn't use up much CPU as it'll be in the
+//     blocking wait until it has data to process.
 //   Authenticate each connecting client in the normal manner.
 //   Accept data from any socket, echo data out _all_ sockets.
-//   If the "master" Xastir sends a shutdown packet, all connections
-//     are dropped and x_spider and all it's children will exit.
-//   x_spider uses select() calls to multiplex all pipes and the
-//     listening socket.  It shouldn't use up much CPU as it'll be
-//     in the blocking select call until it has data to process.
-//   x_spider's children should also wait in blocking calls until
-//     there is data to process.
+//   Output a client can't take right away is queued per client, and
+//     a client that falls too far behind is dropped.
+//   If the "master" Xastir goes away, all connections are dropped
+//     and x_spider exits.
 //
 // This makes the design of the server rather simple:  It needs to
 // authenticate clients and it needs to parse the shutdown message
@@ -105,6 +104,8 @@
 #endif  // HAVE_CONFIG_H
 
 #include "x_spider.h"
+#include "spider_ring.h"
+#include "spider_filter.h"
 #include "snprintf.h"
 
 #include <stdarg.h>
@@ -127,6 +128,9 @@
 #include <string.h>
 
 #include <poll.h>
+#ifdef HAVE_SYS_EPOLL_H
+  #include <sys/epoll.h>
+#endif  // HAVE_SYS_EPOLL_H
 #include <netinet/in.h>     // Moved ahead of inet.h as reports of some *BSD's not
 // including this as they should.
 #include <arpa/inet.h>
@@ -152,6 +156,8 @@
 #endif  // SIGRET
 
 #include "xastir.h"
+#include "database.h"
+#include "db_funcs.h"
 
 // Must be last include file
 #include "leak_detection.h"
@@ -177,23 +183,7 @@ extern char my_callsign[];
 
 extern char *pname;
 
-typedef struct _pipe_object
-{
-  int to_child[2];
-  int to_parent[2];
-  char callsign[20];
-  int authenticated;
-  int active;        // Mark for deletion after every task is finished
-  struct _pipe_object *next;
-} pipe_object;
-
-
 pid_t parent_pid;
-pipe_object *pipe_head = NULL;
-//int master_fd = -1; // Start with an invalid value
-
-pipe_object *xastir_tcp_pipe = NULL;
-pipe_object *xastir_udp_pipe = NULL;
 
 // TCP server pipes to/from Xastir proper
 int pipe_xastir_to_tcp_server = -1;
@@ -348,539 +338,6 @@ void str_echo(int sockfd) {
 
 
 
-// Read a stream socket one line at a time, and write each line back
-// to the sender.  Return when the connection is terminated.  This
-// routine is from "Unix Network Programming".
-//
-void str_echo2(int sockfd, int pipe_from_parent, int pipe_to_parent)
-{
-  int n;
-  char line[MAXLINE];
-
-
-  // Set socket to be non-blocking.
-  //
-  if (fcntl(sockfd, F_SETFL, O_NONBLOCK) < 0)
-  {
-    fprintf(stderr,"str_echo2: Couldn't set socket non-blocking\n");
-  }
-
-  // Set read-end of pipe to be non-blocking.
-  //
-  if (fcntl(pipe_from_parent, F_SETFL, O_NONBLOCK) < 0)
-  {
-    fprintf(stderr,"str_echo2: Couldn't set read-end of pipe_from_parent non-blocking\n");
-  }
-
-
-  //Send our callsign to spider clients as "#callsign" much like APRS-IS sends "# javaAPRS"
-  // # xastir 1.5.1 callsign:<mycall>
-  sprintf(line,"# Welcome to Xastir's server port, callsign: %s\r\n",my_callsign);
-  writen(sockfd,line,strlen(line));
-
-  // Infinite loop
-  for ( ; ; )
-  {
-
-    //
-    // Read data from socket, write to pipe (parent)
-    //
-    if (!sockfd)    // Socket is closed
-    {
-      return;  // Connection terminated
-    }
-
-    n = readline(sockfd, line, MAXLINE);
-    if (n == 0)
-    {
-      return; // Connection terminated
-    }
-    if (n < 0)
-    {
-      //fprintf(stderr,"str_echo2: Readline error: %d\n",errno);
-      if (errno == EAGAIN || errno == EWOULDBLOCK)
-      {
-        // This is normal if we have no data to read
-        //fprintf(stderr,"EAGAIN or EWOULDBLOCK\n");
-      }
-      else    // Non-normal error.  Report it.
-      {
-        fprintf(stderr,"str_echo2: Readline error socket: %d\n",errno);
-        //close(sockfd);
-        return;
-      }
-    }
-    else    // We received some data.  Send it down the pipe.
-    {
-      //            fprintf(stderr,"str_echo2: %s\n",line);
-      if (writen(pipe_to_parent, line, n) != n)
-      {
-        fprintf(stderr,"str_echo2: Writen error socket: %d\n",errno);
-        //close(sockfd);
-        return;
-      }
-    }
-
-
-    //
-    // Read data from pipe (parent), write to socket
-    //
-    if (!pipe_from_parent)
-    {
-      exit(0);
-    }
-
-    n = readline(pipe_from_parent, line, MAXLINE);
-    if (n == 0)
-    {
-      exit(0);    // Connection terminated
-    }
-    if (n < 0)
-    {
-      //fprintf(stderr,"str_echo2: Readline error: %d\n",errno);
-      if (errno == EAGAIN || errno == EWOULDBLOCK)
-      {
-        // This is normal if we have no data to read
-        //fprintf(stderr,"EAGAIN or EWOULDBLOCK\n");
-      }
-      else    // Non-normal error.  Report it.
-      {
-        fprintf(stderr,"str_echo2: Readline error pipe: %d\n",errno);
-        //close(pipe_from_parent);
-        return;
-      }
-    }
-    else    // We received some data.  Send it down the socket.
-    {
-      //            fprintf(stderr,"str_echo2: %s\n",line);
-
-      if (writen(sockfd, line, n) != n)
-      {
-        fprintf(stderr,"str_echo2: Writen error pipe: %d\n",errno);
-        //close(pipe_from_parent);
-        return;
-      }
-    }
-
-    // Slow the loop down to prevent excessive CPU.
-
-    // NOTE:  We must be faster at processing packets than the
-    // main.c:UpdateTime() can send them to us through the pipe!  If
-    // we're not, we lose or corrupt packets.
-
-    usleep(1000); // 1ms
-  }
-}
-
-
-
-
-
-// Function which checks the incoming pipes to see if there's any
-// data.  If there is, checks to see if it is a control packet or a
-// registration packet from the master.  If not, echoes the data out
-// all outgoing pipes.
-//
-// If we get a shutdown from the verified master, send a "1" as the
-// return value, which will shut down the server.  Otherwise send a
-// "0" return value.
-//
-// Incoming registration data:  Record only the master socket.  All
-// others should be handled by the child processes, and they should
-// not pass the registration info down to us.  Same for control
-// packets.  Actually, the child process handling the master socket
-// could skip notifying us as well, and just pass down the control
-// packets if the master sent any (like the shutdown packet).  If we
-// lost the connection between Xastir and x_spider, we might not
-// have a clean way of shutting down the server in that case though.
-// Might be better to record it down here, and if the pipes ever
-// closed, we shut down x_spider and all the child processes.
-//
-int pipe_check(char *client_address)
-{
-  pipe_object *p = pipe_head;
-  int n;
-  char line[MAXLINE];
-
-
-  // Need a select here with a timeout?  Also need a method of
-  // revising the read bits we send to select.  Should we revise
-  // them every time through the loop, or set a variable in the
-  // main() routine whenever a new connect comes in.  What about
-  // connects that go away?  We need a way to free up the pipes
-  // and sockets in that case, and revise the select bits again.
-
-  //    select();
-
-  //fprintf(stderr,"pipe_check()\n");
-
-  // All of the read ends of the pipes have been set non-blocking
-  // by this point.
-
-  // Check all the pipes in the linked list looking for something
-  // to read.
-  while (p != NULL)
-  {
-    //        fprintf(stderr,"Running through pipes\n");
-
-    //
-    // Read data from pipe, write to all pipes except the one
-    // who sent it.
-    //
-    n = p->active ? readline(p->to_parent[0], line, MAXLINE): 0;
-    if (n == 0 && p->active)
-    {
-      char timestring[101];
-
-      get_timestamp(timestring);
-
-      if (p->authenticated)
-      {
-        fprintf(stderr,
-                "%s X_spider session terminated, callsign: %s, address: %s\n",
-                timestring,
-                p->callsign,
-                client_address);
-      }
-      else
-      {
-        fprintf(stderr,
-                "%s X_spider session terminated, unauthenticated user, address %s\n",
-                timestring,
-                client_address);
-      }
-
-      // Close the pipe
-      close(p->to_child[1]);
-      close(p->to_parent[0]);
-
-      p->active = 0;    // This task is ready to let go.
-
-      wait(NULL); // Reap the status of the dead process
-    }
-    else if (n < 0)
-    {
-      //fprintf(stderr,"pipe_check: Readline error: %d\n",errno);
-      if (errno == EAGAIN || errno == EWOULDBLOCK)
-      {
-        // This is normal if we have no data to read
-        //fprintf(stderr,"EAGAIN or EWOULDBLOCK\n");
-      }
-      else    // Non-normal error.  Report it.
-      {
-        fprintf(stderr,"pipe_check: Readline error: %d\n",errno);
-      }
-    }
-    else if (p->active)    // We received some data.  Send it down all of the
-    {
-      // pipes except the one that sent it.
-
-      pipe_object *q;
-
-
-      // Check for an authentication string.  If the pipe has not been
-      // authenticated, we don't allow it to send anything to the upstream
-      // server.  It's probably ok to send it to downstream connections
-      // though.
-
-      // Check for "user" "pass" string.
-      // "user WE7U-13 pass XXXX vers XASTIR 1.3.3"
-      if (strstr(line,"user") && strstr(line,"pass"))
-      {
-        char line2[MAXLINE];
-        char *callsign;
-        char *passcode_str;
-        short passcode;
-        char *space;
-
-        // We have a string with user/pass in it, but they
-        // can be anywhere along the line.  We'll have to
-        // search for each piece.
-
-        //fprintf(stderr,"x_spider:Found an authentication string\n");
-
-        // Copy the line
-        xastir_snprintf(line2, sizeof(line2), "%s", line);
-
-        // Add white space to the end.
-        strncat(line2,
-                "                                    ",
-                sizeof(line2) - 1 - strlen(line2));
-
-        // Find the "user" string position
-        callsign = strstr(line2,"user");
-
-        if (callsign == NULL)
-        {
-          continue;
-        }
-
-        // Fast-forward past the "user" word.
-        callsign += 4;
-
-        // Skip past any additional spaces that might be
-        // present between "user" and callsign.
-        while (callsign[0] == ' ' && callsign[0] != '\0')
-        {
-          callsign += 1;
-        }
-
-        if (callsign[0] == '\0')
-        {
-          continue;
-        }
-
-        // We should now be pointing at the beginning of the
-        // callsign.
-
-        // Find the space after the callsign
-        space = strstr(callsign," ");
-
-        if (space == NULL)
-        {
-          continue;
-        }
-
-        // Terminate the callsign string
-        space[0] = '\0';
-
-        // Snag the passcode string
-
-        // Find the "pass" string
-        passcode_str = strstr(&space[1],"pass");
-
-        if (passcode_str == NULL)
-        {
-          continue;
-        }
-
-        // Fast-forward past the "pass" word.
-        passcode_str = passcode_str + 4;
-
-        // Skip past any additional spaces that might be
-        // present between "pass" and the passcode.
-        while (passcode_str[0] == ' ' && passcode_str[0] != '\0')
-        {
-          passcode_str += 1;
-        }
-
-        if (passcode_str[0] == '\0')
-        {
-          continue;
-        }
-
-        // Find the space after the passcode
-        space = strstr(&passcode_str[0]," ");
-
-        if (space == NULL)
-        {
-          continue;
-        }
-
-        // Terminate the passcode string
-        space[0] = '\0';
-
-        passcode = atoi(passcode_str);
-
-        //fprintf(stderr,"x_spider: user:.%s., pass:%d\n", callsign, passcode);
-
-        if (checkHash(callsign, passcode))
-        {
-          // Authenticate the pipe.  It is now allowed to send
-          // to the upstream server.
-          //fprintf(stderr,
-          //    "x_spider: Authenticated user %s\n",
-          //    callsign);
-          p->authenticated = 1;
-          xastir_snprintf(p->callsign,
-                          sizeof(p->callsign),
-                          "%s",
-                          callsign);
-          p->callsign[19] = '\0';
-        }
-        else
-        {
-          fprintf(stderr,
-                  "X_spider: Bad authentication, user %s, pass %d\n",
-                  callsign,
-                  passcode);
-          fprintf(stderr,
-                  "Line: %s\n",
-                  line);
-        }
-      }
-
-      q = pipe_head;
-
-      while (q != NULL)
-      {
-        //                fprintf(stderr,"pipe_check: %s\n",line);
-
-        // Only send to active pipes
-        if (q != p && q->active)
-        {
-          if (writen(q->to_child[1], line, n) != n)
-          {
-            fprintf(stderr,"pipe_check: Writen error1: %d\n",errno);
-          }
-        }
-        q = q->next;
-      }
-
-      // Here we send it to Xastir itself.  We use a couple of
-      // global variables just like channel_data() does, but
-      // we don't have to protect them in the same manner as
-      // we only have one process on each end.
-      //
-
-      // Send it down the pipe to Xastir's main thread.  Knock off any
-      // carriage return that might be present.  We only want a linefeed
-      // on the end.
-      if (n > 0 && (line[n-1] == '\r' || line[n-1] == '\n'))
-      {
-        line[n-1] = '\0';
-        n--;
-      }
-      if (n > 0 && (line[n-1] == '\r' || line[n-1] == '\n'))
-      {
-        line[n-1] = '\0';
-        n--;
-      }
-      // Add the linefeed on the end
-      strncat(line,"\n",sizeof(line)-strlen(line)-1);
-      n++;
-
-      // Only send to upstream server if this client has authenticated.
-      if (p->authenticated)
-      {
-
-        //fprintf(stderr,"Data available, sending to server\n");
-        //fprintf(stderr,"\t%s\n",line);
-
-        if (writen(pipe_tcp_server_to_xastir, line, n) != n)
-        {
-          fprintf(stderr, "pipe_check: Writen error2: %d\n", errno);
-        }
-      }
-    }
-
-    if (p)
-    {
-      p = p->next;
-    }
-  }
-
-
-  // Check the pipe from Xastir's main thread to see if it is
-  // sending us any data
-  n = readline(pipe_xastir_to_tcp_server, line, MAXLINE);
-
-  if (n == 0)
-  {
-    exit(0); // Connection terminated
-  }
-
-  if (n < 0)
-  {
-    //fprintf(stderr,"pipe_check: Readline error: %d\n",errno);
-    if (errno == EAGAIN || errno == EWOULDBLOCK)
-    {
-      // This is normal if we have no data to read
-      //fprintf(stderr,"EAGAIN or EWOULDBLOCK\n");
-    }
-    else    // Non-normal error.  Report it.
-    {
-      fprintf(stderr,"pipe_check: Readline error: %d\n",errno);
-    }
-  }
-
-  else    // We received some data.  Send it down all of the
-  {
-    // pipes.
-    // Also send it down the socket.
-
-    // Check for disconnected clients and delete their records
-    // from the chain.
-    pipe_object *q = pipe_head;
-    pipe_object *r = pipe_head;
-    for (q = pipe_head; q != NULL; )
-    {
-
-      if (!q->active)   // Marked for deletion.
-      {
-
-        // Check for head of list, handle it in a special
-        // manner.  We don't have to fix up the "next"
-        // pointer on the previous object (it doesn't exist)
-        // but must fix up "pipe_head" pointer.
-        if (q == pipe_head)
-        {
-          pipe_head = q->next;  // New head of list
-          p = q; // Assign temporary pointer
-          q = q->next; // Keep pointer to next object
-          r = q;  // Keep 'r' and 'q' the same for now,
-          // later 'r' will lag 'q' by one object
-          free(p); // Free struct at temporary pointer
-        }
-        else   // Not the head object
-        {
-          r->next = q->next; // Bridge soon-to-be-made gap
-          p = q; // Assign temporary pointer
-          q = q->next; // Keep pointer to next connection.
-          free(p); // Free struct at temp pointer
-        }
-      }
-      else
-      {
-        r = q;  // Pointer to last object (so we can get to
-        // the "next" pointer)
-        q = q->next; // Pointer to next object
-      }
-    }
-    q = pipe_head; // Reset pointer to beginning of list
-
-    //fprintf(stderr,"n:%d\n",n);
-    // Terminate it
-    line[n] = '\0';
-    //fprintf(stderr,"sp %s\n", line);
-
-    // The internet protocol for sending lines is "\r\n".  Knock
-    // off any line-end characters that might be present, then
-    // add a "\r\n" combo on the end.
-    //
-    if (n >= 1 && (line[n-1] == '\r' || line[n-1] == '\n'))
-    {
-      line[n-1] = '\0';
-      n--;
-    }
-    if (n >= 1 && (line[n-1] == '\r' || line[n-1] == '\n'))
-    {
-      line[n-1] = '\0';
-      n--;
-    }
-    // Add carriage-return/linefeed onto the end
-    strncat(line, "\r\n", sizeof(line)-strlen(line)-1);
-    n += 2;
-
-    while (q != NULL && q->active)
-    {
-      //          fprintf(stderr,"pipe_check: %s\n",line);
-
-      if (writen(q->to_child[1], line, n) != n)
-      {
-        fprintf(stderr,"pipe_check: Writen error1: %d\n",errno);
-      }
-      q = q->next;
-    }
-  }
-
-  return(0);
-}
-
-
-
-
-
 // The below three functions init_set_proc_title() and
 // set_proc_title() are from:
 // http://lightconsulting.com/~thalakan/process-title-notes.html
@@ -1125,630 +582,986 @@ int open_spider_server_sockets(int socktype, int port, int **s_in)
 }
 
 
-// Create a poll structure from an array of sockets
-struct pollfd* setup_poll_array(int nsock, int* sockfds)
-{
-  int i;
-  struct pollfd* polls;
 
-  polls = calloc(nsock, sizeof(struct pollfd));
-  for(i=0; i<nsock; i++)
-  {
-    polls[i].fd = sockfds[i];
-    polls[i].events = POLLIN;
-  }
-  return polls;
-}
 
 
-// This TCP server provides a listening socket.  When a client
-// connects, the server forks off a separate process to handle it
-// and goes back to listening for new connects.  The initial code
-// framework here is from the book:  "Unix Network Programming".
+// What the server's event loop is watching.  Every socket and pipe
+// it serves is a spider_client, so the loop can tell from the event
+// alone what to do with it.
 //
-// Create two pipes between this server and each child process.
-// Identify and record which socket is the master socket connection
-// (back to the Xastir session that started up x_spider).  Set this
-// variable once, don't change it if another client connects and
-// claims to be the master.  If we get control commands from the
-// master, service them.
-//
-// If anything that comes in from a client that's not a registration
-// or a control packet, repeat it to all of the other connected
-// clients, including sending it to the controlling Xastir socket
-// (which is also a data channel).
-//
-// We need to make the "accept" call non-blocking so that we can
-// keep servicing all of the pipes from the children.  If any pipe
-// has data, check whether it's a registration from the master or a
-// control packet.  If not, send the data out each client
-// connection.  Each child will take care of normal APRS
-// authentication.  If the client doesn't authenticate, close the
-// socket and exit from the child process.  Notify the main process
-// as well?
-//
-#ifdef STANDALONE_PROGRAM
-int main(int argc, char *argv[])
+#define SPIDER_LISTEN 0     // TCP listening socket
+#define SPIDER_UDP    1     // UDP socket
+#define SPIDER_XASTIR 2     // Pipe from Xastir
+#define SPIDER_CLIENT 3     // Connected TCP client
+#define SPIDER_CLOSED 4     // Client closed, freed after this pass
+
+// Output a client may have queued before it's considered too slow
+// and dropped.  Roughly a thousand packets.
+#define SPIDER_CLIENT_QUEUE (256 * 1024)
+
+#define SPIDER_MAX_EVENTS 64
+
+typedef struct _spider_client
 {
-#else   // !STANDALONE_PROGRAM
-void TCP_Server(int argc, char *argv[], char *envp[])
+  int fd;
+  int kind;
+  int writing;        // Waiting for the socket to drain
+  char address[ADDR_STR_LEN+1];
+  char callsign[20];
+  int authenticated;
+  char line[MAXLINE]; // Partial line read so far
+  int line_length;
+  spider_ring out;    // Output that didn't fit in the socket
+  spider_filter filter; // What the client wants sent, APRS-IS syntax
+  struct _spider_client *prev;
+  struct _spider_client *next;
+} spider_client;
+
+typedef struct
 {
-#endif  // STANDALONE_PROGRAM
+  spider_client *client;
+  int readable;
+  int writable;
+} spider_event;
 
-  int sockfd, newsockfd, childpid;
-  int *sockfds;
-  int nsock;
-  int i, rc;
-  socklen_t clilen;
-  struct sockaddr_storage cli_addr;
-  struct pollfd *polls;
-  pipe_object *p;
-  int pipe_to_parent; /* symbolic names to reduce confusion */
-  int pipe_from_parent;
-  char timestring[101];
-  char addrstring[ADDR_STR_LEN+1];
+static spider_client *client_head = NULL;
+static spider_client *closed_head = NULL;
 
+#ifdef HAVE_SYS_EPOLL_H
+static int spider_epoll = -1;
+#else   // HAVE_SYS_EPOLL_H
+static struct pollfd *spider_polls = NULL;
+static spider_client **spider_poll_client = NULL;
+static int spider_poll_count = 0;
+static int spider_poll_size = 0;
+#endif  // HAVE_SYS_EPOLL_H
 
-  nsock = open_spider_server_sockets(SOCK_STREAM, SERV_TCP_PORT, &sockfds);
-  if(!nsock)
+
+
+
+
+#ifndef HAVE_SYS_EPOLL_H
+static int spider_poll_slot(spider_client *c)
+{
+  int i;
+
+
+  for (i = 0; i < spider_poll_count; i++)
   {
-    fprintf(stderr, "Unable to setup any x_spider server sockets.\n");
-    exit(1);
+    if (spider_poll_client[i] == c)
+    {
+      return(i);
+    }
   }
+  return(-1);
+}
+#endif  // !HAVE_SYS_EPOLL_H
 
-  // Setup socket polling array and free the socket array
-  // (since the FDs were copied into the poll array)
-  polls = setup_poll_array(nsock, sockfds);
-  free(sockfds);
 
-  memset((char *)&cli_addr, 0, sizeof(cli_addr));
 
-  // Infinite loop
-  //
-  for ( ; ; )
-  {
-    int flag;
 
 
-    // Look for a connection from a client process.  This is a
-    // concurrent server (allows multiple concurrent
-    // connections).
+// Start watching a client.  We always want to know when there's
+// something to read, and when its socket drains if we're holding
+// output for it.  Returns 0 or -1.
+//
+static int spider_watch(spider_client *c)
+{
+#ifdef HAVE_SYS_EPOLL_H
+  struct epoll_event ev;
 
-    clilen = (socklen_t)sizeof(cli_addr);
 
-    rc = poll(polls, nsock, 0);
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.ptr = c;
+  return(epoll_ctl(spider_epoll, EPOLL_CTL_ADD, c->fd, &ev));
+#else   // HAVE_SYS_EPOLL_H
 
-    if(rc==0)
-    {
-      // We returned from the non-blocking poll but with
-      // no incoming socket connection.  Check the pipe
-      // queues for incoming data.
-      //
-      if (pipe_check(addr_str((struct sockaddr*)&cli_addr, addrstring)) == -1)
-      {
+  if (spider_poll_count == spider_poll_size)
+  {
+    int size = spider_poll_size ? spider_poll_size * 2 : 32;
+    struct pollfd *polls;
+    spider_client **clients;
 
-        // We received a shutdown command from the
-        // master socket connection.
-        exit(0);
-      }
-      goto finis;
-    }
-    else if(rc==-1)
+    polls = realloc(spider_polls, size * sizeof(struct pollfd));
+    if (polls == NULL)
     {
-      // Some error with poll
-      fprintf(stderr, "x_spider: Error with TCP poll(): %d - %s\n", errno, strerror(errno));
-      goto finis;
+      return(-1);
     }
-
-    // A connection should be waiting. Scan the poll set for an FD that has one
-    // waiting and use that.
-    sockfd = -1;
-    for(i=0; i<nsock; i++)
+    spider_polls = polls;
+    clients = realloc(spider_poll_client, size * sizeof(spider_client *));
+    if (clients == NULL)
     {
-      if(polls[i].revents == POLLIN)
-      {
-        sockfd = polls[i].fd;
-      }
+      return(-1);
     }
+    spider_poll_client = clients;
+    spider_poll_size = size;
+  }
+  spider_polls[spider_poll_count].fd = c->fd;
+  spider_polls[spider_poll_count].events = POLLIN;
+  spider_polls[spider_poll_count].revents = 0;
+  spider_poll_client[spider_poll_count] = c;
+  spider_poll_count++;
+  return(0);
+#endif  // HAVE_SYS_EPOLL_H
+}
+
+
+
+
+
+// Update what we're watching a client for after c->writing changed.
+//
+static void spider_rewatch(spider_client *c)
+{
+#ifdef HAVE_SYS_EPOLL_H
+  struct epoll_event ev;
+
 
-    if(sockfd == -1)
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN | (c->writing ? EPOLLOUT : 0);
+  ev.data.ptr = c;
+  if (epoll_ctl(spider_epoll, EPOLL_CTL_MOD, c->fd, &ev) < 0)
+  {
+    fprintf(stderr, "x_spider: epoll_ctl() error: %d - %s\n", errno, strerror(errno));
+  }
+#else   // HAVE_SYS_EPOLL_H
+  int i = spider_poll_slot(c);
+
+
+  if (i >= 0)
+  {
+    spider_polls[i].events = POLLIN | (c->writing ? POLLOUT : 0);
+  }
+#endif  // HAVE_SYS_EPOLL_H
+}
+
+
+
+
+
+static void spider_unwatch(spider_client *c)
+{
+#ifdef HAVE_SYS_EPOLL_H
+  struct epoll_event ev;
+
+
+  // Older kernels want a non-NULL event even though it's ignored
+  (void)epoll_ctl(spider_epoll, EPOLL_CTL_DEL, c->fd, &ev);
+#else   // HAVE_SYS_EPOLL_H
+  int i = spider_poll_slot(c);
+
+
+  if (i >= 0)
+  {
+    spider_poll_count--;
+    spider_polls[i] = spider_polls[spider_poll_count];
+    spider_poll_client[i] = spider_poll_client[spider_poll_count];
+  }
+#endif  // HAVE_SYS_EPOLL_H
+}
+
+
+
+
+
+// Wait up to "timeout" ms for something to happen.  Returns the
+// number of events filled in, 0 on timeout, -1 on error.
+//
+static int spider_wait(spider_event *event, int max, int timeout)
+{
+  int i, n;
+#ifdef HAVE_SYS_EPOLL_H
+  struct epoll_event ev[SPIDER_MAX_EVENTS];
+
+
+  if (max > SPIDER_MAX_EVENTS)
+  {
+    max = SPIDER_MAX_EVENTS;
+  }
+  n = epoll_wait(spider_epoll, ev, max, timeout);
+  for (i = 0; i < n; i++)
+  {
+    event[i].client = (spider_client *)ev[i].data.ptr;
+    event[i].readable = (ev[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0;
+    event[i].writable = (ev[i].events & EPOLLOUT) != 0;
+  }
+  return(n);
+#else   // HAVE_SYS_EPOLL_H
+  int count = 0;
+
+
+  n = poll(spider_polls, spider_poll_count, timeout);
+  if (n <= 0)
+  {
+    return(n);
+  }
+  for (i = 0; i < spider_poll_count && count < max; i++)
+  {
+    if (spider_polls[i].revents)
     {
-      // Something unexpected is going on as we didn't find a socket with a
-      // connection waiting.
-      fprintf(stderr, "x_spider: Weird, poll() said connection waiting but none found.\n");
-      goto finis;
+      event[count].client = spider_poll_client[i];
+      event[count].readable = (spider_polls[i].revents & (POLLIN | POLLHUP | POLLERR)) != 0;
+      event[count].writable = (spider_polls[i].revents & POLLOUT) != 0;
+      count++;
     }
+  }
+  return(count);
+#endif  // HAVE_SYS_EPOLL_H
+}
+
+
+
+
+
+// Knock off any line-end characters that might be present, then add
+// "end" (at most two characters).  "line" must have room for it.
+// Returns the new length.
+//
+static int spider_line_end(char *line, int n, const char *end)
+{
+  if (n > 0 && (line[n-1] == '\r' || line[n-1] == '\n'))
+  {
+    n--;
+  }
+  if (n > 0 && (line[n-1] == '\r' || line[n-1] == '\n'))
+  {
+    n--;
+  }
+  line[n] = '\0';
+  strcat(line, end);
+  return(n + strlen(end));
+}
+
+
+
+
+
+// Drop a client.  It stays allocated until the end of the current
+// pass through the event loop, as there may still be events for it.
+//
+static void spider_close(spider_client *c)
+{
+  char timestring[101];
+
+
+  if (c->kind == SPIDER_CLOSED)
+  {
+    return;
+  }
+
+  get_timestamp(timestring);
+  if (c->authenticated)
+  {
+    fprintf(stderr,
+            "%s X_spider session terminated, callsign: %s, address: %s\n",
+            timestring,
+            c->callsign,
+            c->address);
+  }
+  else
+  {
+    fprintf(stderr,
+            "%s X_spider session terminated, unauthenticated user, address %s\n",
+            timestring,
+            c->address);
+  }
+
+  spider_unwatch(c);
+  close(c->fd);
+  c->fd = -1;
+  c->kind = SPIDER_CLOSED;
+
+  if (c->prev)
+  {
+    c->prev->next = c->next;
+  }
+  else
+  {
+    client_head = c->next;
+  }
+  if (c->next)
+  {
+    c->next->prev = c->prev;
+  }
+  c->prev = NULL;
+  c->next = closed_head;
+  closed_head = c;
+}
+
+
+
+
+
+// Free the clients closed during the last pass through the event
+// loop.
+//
+static void spider_reap(void)
+{
+  spider_client *c;
+
+
+  while (closed_head)
+  {
+    c = closed_head;
+    closed_head = c->next;
+    spider_ring_free(&c->out);
+    free(c);
+  }
+}
 
-    // "accept" is the call where we wait for a connection.  We
-    // made the socket non-blocking above so that we pop out of
-    // it with an EAGAIN if we don't have an incoming socket
-    // connection.  This lets us check all of our pipe
-    // connections for incoming data periodically.
-    //
-    newsockfd = accept(sockfd,
-                       (struct sockaddr *)&cli_addr,
-                       &clilen);
 
-    if (newsockfd == -1)
+
+
+
+// Send data to a client.  We write straight to the socket while
+// nothing is queued for it, and queue whatever the socket won't take.
+// A client that falls so far behind that its queue fills up is
+// dropped, so that one slow link can't hold up everyone else.
+//
+static void spider_send(spider_client *c, const char *data, int length)
+{
+  ssize_t n = 0;
+
+
+  if (c->kind != SPIDER_CLIENT)
+  {
+    return;
+  }
+
+  if (spider_ring_length(&c->out) == 0)
+  {
+    n = write(c->fd, data, length);
+    if (n < 0)
     {
-      if (errno == EAGAIN || errno == EWOULDBLOCK)
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
       {
-        // Something unexpected is going on as poll() had said that we had a
-        // connection waiting.
-        fprintf(stderr, "x_spider: Weird, poll() said connection waiting but accept() failed.\n");
-        goto finis;
-      }
-      else if (newsockfd < 0)
-      {
-
-        // Some error happened in accept().  Skip the rest
-        // of the loop.
-        //
-        fprintf(stderr,"x_spider: Accept error: %d\n", errno);
-        fprintf(stderr,"Could some processes still be running from a previous run of Xastir?\n");
-        goto finis;
+        spider_close(c);
+        return;
       }
+      n = 0;
     }
-
-    // Else we returned from the accept with an incoming
-    // connection.  Service it.
-    //
-    // Allocate a new pipe before we fork.
-    //
-    p = (pipe_object *)malloc(sizeof(pipe_object));
-    if (p == NULL)
+    if (n == length)
     {
-      fprintf(stderr,"x_spider: Couldn't malloc pipe_object\n");
-      close(newsockfd);
-      goto finis;
+      return;
     }
+  }
 
-    // We haven't authenticated this user client yet.
-    p->authenticated = 0;
-    p->callsign[0] = '\0';
+  if (spider_ring_put(&c->out, data + n, length - n) < 0)
+  {
+    char timestring[101];
 
     get_timestamp(timestring);
-
-    fprintf(stderr,"%s X_spider client connected from address %s\n",
+    fprintf(stderr,
+            "%s X_spider client %s isn't keeping up, %lu bytes queued.  Dropping it.\n",
             timestring,
-            addr_str((struct sockaddr*)&cli_addr, addrstring));
+            c->address,
+            (unsigned long)spider_ring_length(&c->out));
+    spider_close(c);
+    return;
+  }
+
+  if (!c->writing)
+  {
+    c->writing = 1;
+    spider_rewatch(c);
+  }
+}
+
+
+
+
+
+// A client's socket has drained.  Send it more of its queue.
+//
+static void spider_flush(spider_client *c)
+{
+  if (spider_ring_write(&c->out, c->fd) < 0)
+  {
+    spider_close(c);
+    return;
+  }
+  if (spider_ring_length(&c->out) == 0 && c->writing)
+  {
+    c->writing = 0;
+    spider_rewatch(c);
+  }
+}
+
+
+
+
+
+// Split up a line for the client filters.  "packet" points into
+// "ax25".  Lines that aren't packets have no sender and match no
+// filter.
+//
+static void spider_decode(const char *line, int length, ax25_packet *ax25, spider_packet *packet)
+{
+  char copy[MAXLINE];
+
 
-    if (pipe(p->to_child) < 0 || pipe(p->to_parent) < 0)
+  if (length >= (int)sizeof(copy))
+  {
+    length = sizeof(copy) - 1;
+  }
+  memcpy(copy, line, length);
+  copy[length] = '\0';
+
+  memset(packet, 0, sizeof(spider_packet));
+  packet->call = "";
+  packet->info = "";
+
+  predecode_ax25_line(copy, ax25);
+  if (!ax25->call_ok)
+  {
+    return;
+  }
+
+  packet->has_position = extract_packet_position(ax25,
+                         (char **)&packet->info,
+                         &packet->lat,
+                         &packet->lon);
+  if (ax25->ok && (packet->info[0] == ';' || packet->info[0] == ')'))
+  {
+    // extract_object() put the object name in "call", the sender
+    // is in "origin"
+    packet->call = ax25->origin;
+    packet->name = ax25->call;
+  }
+  else
+  {
+    packet->call = ax25->call;
+  }
+}
+
+
+
+
+
+// Send a line to every client except "from", and only to those whose
+// filter it passes.  The line is decoded once, on reaching the first
+// client with a filter.  Server comments ("# ...") go to everyone.
+//
+static void spider_broadcast(spider_client *from, const char *line, int length)
+{
+  static ax25_packet ax25;
+  spider_packet packet;
+  spider_client *c, *next;
+  int decoded = 0;
+
+
+  for (c = client_head; c != NULL; c = next)
+  {
+    next = c->next;
+    if (c == from)
+    {
+      continue;
+    }
+    if (spider_filter_active(&c->filter) && line[0] != '#')
     {
-      fprintf(stderr,"x_spider: Can't create pipes\n");
-      if (p->to_child[1])
+      if (!decoded)
       {
-        close(p->to_child[1]);
+        spider_decode(line, length, &ax25, &packet);
+        decoded = 1;
       }
-      if (p->to_child[0])
+      if (!spider_filter_match(&c->filter, &packet))
       {
-        close(p->to_child[0]);
+        continue;
       }
-      free(p);    // Free the malloc'd memory.
-      p = NULL;
-      close(newsockfd);
-      goto finis;
     }
+    spider_send(c, line, length);
+  }
+}
 
-    // Indicate active connection!
-    p->active = 1;
 
-    // Link it into the head of the chain.
-    //
-    p->next = pipe_head;
-    pipe_head = p;
 
-    flag = 1;
 
-    // Turn on the socket keepalive option
-    (void)setsockopt(newsockfd,  SOL_SOCKET, SO_KEEPALIVE, (char *) &flag, sizeof(int));
 
-    // Disable the Nagle algorithm (speeds things up)
-    (void)setsockopt(newsockfd, IPPROTO_TCP,  TCP_NODELAY, (char *) &flag, sizeof(int));
+// Read whatever is waiting on c->fd and pass each complete line,
+// newline included, to "handle".  Over-long lines are cut into
+// pieces, leaving room for the handler to add a "\r\n".  Returns 0
+// at end of file or on error, 1 otherwise.
+//
+static int spider_read_lines(spider_client *c, void (*handle)(spider_client *, char *, int))
+{
+  char buffer[4096];
+  ssize_t n;
+  int i;
 
-    if ( (childpid = fork()) < 0)
-    {
-      //
-      // Problem forking.  Clean up and continue loop.
-      //
 
-      fprintf(stderr,"x_spider: Fork error\n");
-      // Close pipes
-      close(p->to_child[0]);
-      close(p->to_child[1]);
-      close(p->to_parent[0]);
-      close(p->to_parent[1]);
-      pipe_head = p->next;
-      free(p);    // Free the malloc'd memory.
-      p = NULL;
-      close(newsockfd);
-      goto finis;
-    }
-    else if (childpid == 0)
+  n = read(c->fd, buffer, sizeof(buffer));
+  if (n == 0)
+  {
+    return(0);
+  }
+  if (n < 0)
+  {
+    return(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+  }
+
+  for (i = 0; i < n && c->kind != SPIDER_CLOSED; i++)
+  {
+    c->line[c->line_length++] = buffer[i];
+    if (buffer[i] == '\n' || c->line_length == MAXLINE - 3)
     {
-      //
-      // child process
-      //
+      c->line[c->line_length] = '\0';
+      handle(c, c->line, c->line_length);
+      c->line_length = 0;
+    }
+  }
+  return(1);
+}
 
 
-      // Go back to default signal handler instead of calling
-      // restart() on SIGHUP
-      (void) signal(SIGHUP,SIG_DFL);
 
 
-      /*
-        fprintf(stderr,
-        "Client address: %s\n",
-        inet_ntoa(cli_addr.sin_addr));
-      */
 
-      // Change the name of the new child process.  So far
-      // this only works for "ps" listings, not for "top".
-      // This code only works on Linux.  For BSD use
-      // setproctitle(3), NetBSD can use setprogname(2).
-#ifdef __linux__
-      init_set_proc_title(argc, argv, envp);
-      set_proc_title("%s%s %s",
-                     "x-spider client @",
-                     addr_str((struct sockaddr*)&cli_addr, addrstring),
-                     "(xastir)");
-      //fprintf(stderr,"DEBUG: %s\n", Argv[0]);
-      (void) signal(SIGHUP, exit);
-#endif  // __linux__
+// Check a "user" "pass" line from a client.  If the passcode is good
+// the client is allowed to send to the upstream server.  The pieces
+// can be anywhere along the line:
+//
+//   "user WE7U-13 pass XXXX vers XASTIR 1.3.3"
+//
+static void spider_login(spider_client *c, char *line)
+{
+  char line2[MAXLINE];
+  char *callsign;
+  char *passcode_str;
+  short passcode;
+  char *space;
 
-      // It'd be very cool here to include the IP address of the remote
-      // client on the "ps" line, and include the callsign of the
-      // connecting client once the client authenticates.  Both of these
-      // are do-able.
 
+  // Copy the line
+  xastir_snprintf(line2, sizeof(line2), "%s", line);
 
-      // New naming system so that we don't have to remember
-      // the longer name:
-      //
-      pipe_to_parent = p->to_parent[1];
-      pipe_from_parent = p->to_child[0];
+  // Add white space to the end.
+  strncat(line2,
+          "                                    ",
+          sizeof(line2) - 1 - strlen(line2));
 
-      close(sockfd);      // Close original socket.  Child
-      // doesn't need the listening
-      // socket.
-      close(p->to_child[1]);  // Close write end of pipe
-      close(p->to_parent[0]); // Close read end of pipe
+  // Find the "user" string position
+  callsign = strstr(line2,"user");
 
-      //            str_echo(newsockfd);    // Process the request
-      str_echo2(newsockfd,
-                pipe_from_parent,
-                pipe_to_parent);
+  if (callsign == NULL)
+  {
+    return;
+  }
 
+  // Fast-forward past the "user" word.
+  callsign += 4;
 
-      // Clean up and exit
-      //
-      close(pipe_to_parent);
-      close(pipe_from_parent);
-      exit(0);
+  // Skip past any additional spaces that might be
+  // present between "user" and callsign.
+  while (callsign[0] == ' ' && callsign[0] != '\0')
+  {
+    callsign += 1;
+  }
 
-    }
-    //
-    // Parent process
-    //
+  if (callsign[0] == '\0')
+  {
+    return;
+  }
 
-    close(newsockfd);
-    close(p->to_parent[1]); // Close write end of pipe
-    close(p->to_child[0]);  // Close read end of pipe
+  // We should now be pointing at the beginning of the
+  // callsign.
 
-    // Set read-end of pipe to be non-blocking.
-    //
-    if (fcntl(p->to_parent[0], F_SETFL, O_NONBLOCK) < 0)
-    {
-      fprintf(stderr,"x_spider: Couldn't set read-end of pipe_to_parent non-blocking\n");
-      fprintf(stderr,"Could some processes still be running from a previous run of Xastir?\n");
-    }
+  // Find the space after the callsign
+  space = strstr(callsign," ");
 
-finis:
-    // Need a delay so that we don't use too much CPU, at least
-    // for debug.  Put the delay into the select() call in the
-    // pipe_check() function once we get to that stage of
-    // coding.
-    //
+  if (space == NULL)
+  {
+    return;
+  }
+
+  // Terminate the callsign string
+  space[0] = '\0';
+
+  // Snag the passcode string
+
+  // Find the "pass" string
+  passcode_str = strstr(&space[1],"pass");
 
-    // NOTE:  We must be faster at processing packets than the
-    // main.c:UpdateTime() can send them to us through the pipe!  If
-    // we're not, we lose or corrupt packets.
+  if (passcode_str == NULL)
+  {
+    return;
+  }
+
+  // Fast-forward past the "pass" word.
+  passcode_str = passcode_str + 4;
+
+  // Skip past any additional spaces that might be
+  // present between "pass" and the passcode.
+  while (passcode_str[0] == ' ' && passcode_str[0] != '\0')
+  {
+    passcode_str += 1;
+  }
 
-    usleep(1000); // 1ms
+  if (passcode_str[0] == '\0')
+  {
+    return;
+  }
+
+  // Find the space after the passcode
+  space = strstr(&passcode_str[0]," ");
+
+  if (space == NULL)
+  {
+    return;
+  }
+
+  // Terminate the passcode string
+  space[0] = '\0';
+
+  passcode = atoi(passcode_str);
+
+  //fprintf(stderr,"x_spider: user:.%s., pass:%d\n", callsign, passcode);
+
+  if (checkHash(callsign, passcode))
+  {
+    // Authenticate the client.  It is now allowed to send
+    // to the upstream server.
+    c->authenticated = 1;
+    xastir_snprintf(c->callsign,
+                    sizeof(c->callsign),
+                    "%s",
+                    callsign);
+  }
+  else
+  {
+    fprintf(stderr,
+            "X_spider: Bad authentication, user %s, pass %d\n",
+            callsign,
+            passcode);
+    fprintf(stderr,
+            "Line: %s\n",
+            line);
   }
 }
 
 
 
 
-// Send a nack back to the xastir_udp_client program
-void send_udp_nack(int sock, struct sockaddr *from, int fromlen)
+
+// Set a client's filter from "text", which runs to the end of the
+// line, and tell the client how it went.
+//
+static void spider_set_filter(spider_client *c, const char *text)
 {
-  int n;
+  char filter[MAXLINE];
+  char reply[MAXLINE + 64];
 
-  n = sendto(sock,
-             "NACK", // Negative Acknowledgment
-             5,
-             0,
-             (struct sockaddr *)from,
-             fromlen);
-  if (n < 0)
+
+  while (*text == ' ')
   {
-    fprintf(stderr, "Error: sendto");
+    text++;
+  }
+  xastir_snprintf(filter, sizeof(filter), "%s", text);
+  (void)spider_line_end(filter, strlen(filter), "");
+
+  if (spider_filter_parse(&c->filter, filter) == 0)
+  {
+    xastir_snprintf(reply, sizeof(reply), "# filter %s active\r\n", filter);
+  }
+  else
+  {
+    xastir_snprintf(reply, sizeof(reply),
+                    "# filter %s has errors, %d rules active\r\n",
+                    filter,
+                    c->filter.count);
   }
+  spider_send(c, reply, strlen(reply));
 }
 
 
 
 
 
-// Create a UDP listening port.  This allows scripts and other
-// programs to inject packets into Xastir via UDP protocol.
+// A line from a TCP client.  Repeat it to all of the other clients,
+// and send it on to Xastir if the client has authenticated.  It's
+// probably ok to send it to downstream connections either way.
+//
+// A client chooses what it gets sent with an APRS-IS style filter,
+// either on its login line ("user CALL pass NNNN vers ... filter
+// r/47.6/-122.3/50") or with a "#filter ..." line later on.  The
+// latter is for the server only and isn't passed on.
 //
-void UDP_Server(int UNUSED(argc), char * UNUSED(argv[]), char * UNUSED(envp[]) )
+static void spider_client_line(spider_client *c, char *line, int n)
 {
-  int sock, n1, n2;
-  socklen_t fromlen;
-  struct sockaddr_storage from;
-  struct pollfd *polls;
-  char buf[1024];
-  char buf2[512];
-  char *callsign;
-  short passcode;
-  char *cptr[10];
-  char *message = NULL;
-  char message2[1024];
-  int send_to_inet;
-  int send_to_rf;
-  int *sockfds;
-  int nsock;
-  int i, rc;
-  char addrstring[ADDR_STR_LEN+1];
+  char *filter;
 
 
-  nsock = open_spider_server_sockets(SOCK_DGRAM, SERV_UDP_PORT, &sockfds);
-  if(!nsock)
+  if (strncmp(line, "#filter", 7) == 0)
   {
-    fprintf(stderr, "Unable to setup any x_spider UDP server sockets.\n");
-    fprintf(stderr,"Could some processes still be running from a previous run of Xastir?\n");
+    spider_set_filter(c, line + 7);
     return;
   }
 
-  // Setup socket polling array and free the socket array
-  // (since the FDs were copied into the poll array)
-  polls = setup_poll_array(nsock, sockfds);
-  free(sockfds);
-
-  while (1)
+  // Check for "user" "pass" string.
+  if (strstr(line,"user") && strstr(line,"pass"))
   {
-    rc = poll(polls, nsock, 5000); // Wait for data
-    if(rc == -1)
+    spider_login(c, line);
+
+    filter = strstr(line, " filter ");
+    if (filter != NULL)
     {
-      fprintf(stderr, "x_spider: UDP poll() returned error %d: %s.\n",
-              errno, strerror(errno));
-      continue;
+      spider_set_filter(c, filter + 8);
     }
-    else if (rc == 0)
+  }
+
+  spider_broadcast(c, line, n);
+
+  // Only send to upstream server if this client has authenticated.
+  if (c->authenticated)
+  {
+    // Xastir only wants a linefeed on the end.
+    n = spider_line_end(line, n, "\n");
+
+    if (writen(pipe_tcp_server_to_xastir, line, n) != n)
     {
-      // Timeout, check if parent is still alive
-      rc = kill(parent_pid, 0);
-      if(rc == -1 && errno == ESRCH)
-      {
-        // Parent died, exit
-        return;
-      }
-      continue;
+      fprintf(stderr, "x_spider: Writen error to Xastir: %d\n", errno);
     }
+  }
+}
+
+
+
+
+
+// A line from Xastir itself.  The internet protocol for sending lines
+// is "\r\n", so that's what it gets before going out to every client.
+//
+static void spider_xastir_line(spider_client * UNUSED(c), char *line, int n)
+{
+  n = spider_line_end(line, n, "\r\n");
+  spider_broadcast(NULL, line, n);
+}
+
+
 
-    // Data should be waiting. Scan the poll set for an FD that has one waiting and use that.
-    sock = -1;
-    for(i=0; i<nsock; i++)
+
+
+// Accept every connection waiting on a listening socket.
+//
+static void spider_accept(spider_client *listener)
+{
+  struct sockaddr_storage cli_addr;
+  socklen_t clilen;
+  spider_client *c;
+  char timestring[101];
+  char line[MAXLINE];
+  int newsockfd;
+  int flag;
+
+
+  for ( ; ; )
+  {
+    clilen = (socklen_t)sizeof(cli_addr);
+    newsockfd = accept(listener->fd, (struct sockaddr *)&cli_addr, &clilen);
+    if (newsockfd < 0)
     {
-      if(polls[i].revents == POLLIN)
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
       {
-        sock = polls[i].fd;
+        fprintf(stderr,"x_spider: Accept error: %d\n", errno);
       }
+      return;
     }
 
-    if(sock == -1)
+    // Set the new socket to be non-blocking.
+    if (fcntl(newsockfd, F_SETFL, O_NONBLOCK) < 0)
     {
-      // Something unexpected is going on as we didn't find a socket with data waiting.
-      fprintf(stderr, "x_spider: Weird, poll() said data waiting but none found.\n");
-      continue;
+      fprintf(stderr,"x_spider: Couldn't set socket non-blocking\n");
     }
 
-    fromlen = sizeof(struct sockaddr_storage);
-    n1 = recvfrom(sock,
-                  buf,
-                  1024,
-                  0,
-                  (struct sockaddr *)&from,
-                  &fromlen);
-    if (n1 < 0)
-    {
-      fprintf(stderr, "Error: recvfrom");
-    }
-    else if (n1 == 0)
+    flag = 1;
+
+    // Turn on the socket keepalive option
+    (void)setsockopt(newsockfd,  SOL_SOCKET, SO_KEEPALIVE, (char *) &flag, sizeof(int));
+
+    // Disable the Nagle algorithm (speeds things up)
+    (void)setsockopt(newsockfd, IPPROTO_TCP,  TCP_NODELAY, (char *) &flag, sizeof(int));
+
+    c = (spider_client *)calloc(1, sizeof(spider_client));
+    if (c == NULL || spider_ring_init(&c->out, SPIDER_CLIENT_QUEUE) < 0)
     {
+      fprintf(stderr,"x_spider: Couldn't malloc spider_client\n");
+      free(c);
+      close(newsockfd);
       continue;
     }
-    else
+    c->fd = newsockfd;
+    c->kind = SPIDER_CLIENT;
+    addr_str((struct sockaddr*)&cli_addr, c->address);
+
+    if (spider_watch(c) < 0)
     {
-      buf[n1] = '\0';    // Terminate the buffer
+      fprintf(stderr,"x_spider: Can't watch client socket: %d\n", errno);
+      spider_ring_free(&c->out);
+      free(c);
+      close(newsockfd);
+      continue;
     }
 
-    fprintf(stderr, "Received datagram from %s: %s",
-            addr_str((struct sockaddr*)&from, addrstring), buf);
-
-
-    send_to_inet = 0;
-    send_to_rf = 0;
-
+    get_timestamp(timestring);
+    fprintf(stderr,"%s X_spider client connected from address %s\n",
+            timestring,
+            c->address);
 
+    // Link it into the head of the chain.
     //
-    // Authenticate the packet.  First line should contain:
-    //
-    //      callsign,passcode,[TO_RF],[TO_INET]
-    //
-    // The second line should contain the APRS packet
-    //
-
-    // Copy the entire buffer so that we can modify it
-    memcpy(buf2, buf, sizeof(buf2));
-    buf2[sizeof(buf2)-1] = '\0';  // Terminate string
-    split_string(buf2, cptr, 10, ',');
-
-    if (cptr[0] == NULL || cptr[0][0] == '\0')      // callsign
+    c->next = client_head;
+    if (client_head)
     {
-      send_udp_nack(sock, (struct sockaddr *)&from, fromlen);
-      continue;
+      client_head->prev = c;
     }
+    client_head = c;
+
+    //Send our callsign to spider clients as "#callsign" much like APRS-IS sends "# javaAPRS"
+    // # xastir 1.5.1 callsign:<mycall>
+    xastir_snprintf(line, sizeof(line),
+                    "# Welcome to Xastir's server port, callsign: %s\r\n",
+                    my_callsign);
+    spider_send(c, line, strlen(line));
+  }
+}
 
-    callsign = cptr[0];
 
-    if (cptr[1] == NULL || cptr[1][0] == '\0')      // passcode
-    {
-      send_udp_nack(sock, (struct sockaddr *)&from, fromlen);
-      continue;
-    }
 
-    passcode = atoi(cptr[1]);
 
-    fprintf(stderr,"x_spider udp:  user:%s  pass:%d\n", callsign, passcode);
 
-    if (checkHash(callsign, passcode))
-    {
-      // Authenticate the pipe.  It is now allowed to send
-      // to the upstream server.
-      //fprintf(stderr,
-      //    "x_spider: Authenticated user %s\n",
-      //    callsign);
-    }
-    else
-    {
-      fprintf(stderr,
-              "X_spider: Bad authentication, user %s, pass %d\n",
-              callsign,
-              passcode);
-      fprintf(stderr,
-              "UDP Packet: %s\n",
-              buf);
-      send_udp_nack(sock, (struct sockaddr *)&from, fromlen);
-      continue;
-    }
+// Send a nack back to the xastir_udp_client program
+void send_udp_nack(int sock, struct sockaddr *from, int fromlen)
+{
+  int n;
+
+  n = sendto(sock,
+             "NACK", // Negative Acknowledgment
+             5,
+             0,
+             (struct sockaddr *)from,
+             fromlen);
+  if (n < 0)
+  {
+    fprintf(stderr, "Error: sendto");
+  }
+}
 
 
-    // Here's where we would look for the optional flags in the
-    // first line.  Here we implement these flags:
-    //      -identify
-    //      -to_rf
-    //      -to_inet
 
 
-    // Look for the "-identify" flag in the UDP packet
-    //
-    if (strstr(buf, "-identify"))
-    {
 
-      // Send the callsign back to the xastir_udp_client
-      // program
-      n1 = sendto(sock,
-                  my_callsign,
-                  strlen(my_callsign)+1,
-                  0,
-                  (struct sockaddr *)&from,
-                  fromlen);
-      if (n1 < 0)
-      {
-        fprintf(stderr, "Error: sendto");
-      }
-      continue;
-    }
+// A datagram on the UDP port.  This allows scripts and other
+// programs to inject packets into Xastir via UDP protocol.
+//
+static void spider_udp_datagram(int sock)
+{
+  int n1, n2;
+  socklen_t fromlen;
+  struct sockaddr_storage from;
+  char buf[1024];
+  char buf2[512];
+  char *callsign;
+  short passcode;
+  char *cptr[10];
+  char *message = NULL;
+  char message2[1024];
+  char line[MAXLINE];
+  int send_to_inet;
+  int send_to_rf;
+  char addrstring[ADDR_STR_LEN+1];
 
 
-    // Look for the "-to_inet" flag in the UDP packet
-    //
-    if (strstr(buf, "-to_inet"))
+  fromlen = sizeof(struct sockaddr_storage);
+  n1 = recvfrom(sock,
+                buf,
+                sizeof(buf) - 1,
+                0,
+                (struct sockaddr *)&from,
+                &fromlen);
+  if (n1 < 0)
+  {
+    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
     {
-      //fprintf(stderr,"Sending to INET\n");
-      send_to_inet++;
+      fprintf(stderr, "Error: recvfrom");
     }
+    return;
+  }
+  else if (n1 == 0)
+  {
+    return;
+  }
+  buf[n1] = '\0';    // Terminate the buffer
 
-
-    // Look for the "-to_rf" flag in the UDP packet
-    //
-    if (strstr(buf, "-to_rf"))
-    {
-      //fprintf(stderr,"Sending to local RF\n");
-      send_to_rf++;
-    }
+  fprintf(stderr, "Received datagram from %s: %s",
+          addr_str((struct sockaddr*)&from, addrstring), buf);
 
 
-    // Now snag the text message from the second line using the
-    // original buffer.  Look for the first '\n' character which
-    // is just before the text message itself.
-    message = strchr(buf, '\n');
-    message++;  // Point to the first char after the '\n'
+  send_to_inet = 0;
+  send_to_rf = 0;
 
-    if (message == NULL || message[0] == '\0')
-    {
-      //fprintf(stderr,"Empty message field\n");
-      send_udp_nack(sock, (struct sockaddr *)&from, fromlen);
-      continue;
-    }
 
-    //fprintf(stderr,"Message:  %s", message);
+  //
+  // Authenticate the packet.  First line should contain:
+  //
+  //      callsign,passcode,[TO_RF],[TO_INET]
+  //
+  // The second line should contain the APRS packet
+  //
 
-    xastir_snprintf(message2,
-                    sizeof(message2),
-                    "%s%s%s",
-                    (send_to_inet) ? "TO_INET," : "",
-                    (send_to_rf) ? "TO_RF," : "",
-                    message);
+  // Copy the entire buffer so that we can modify it
+  memcpy(buf2, buf, sizeof(buf2));
+  buf2[sizeof(buf2)-1] = '\0';  // Terminate string
+  split_string(buf2, cptr, 10, ',');
 
-    //fprintf(stderr,"Message2: %s", message2);
+  if (cptr[0] == NULL || cptr[0][0] == '\0')      // callsign
+  {
+    send_udp_nack(sock, (struct sockaddr *)&from, fromlen);
+    return;
+  }
 
+  callsign = cptr[0];
 
+  if (cptr[1] == NULL || cptr[1][0] == '\0')      // passcode
+  {
+    send_udp_nack(sock, (struct sockaddr *)&from, fromlen);
+    return;
+  }
 
-    //
-    //
-    // NOTE:
-    // Should we refuse to send the message on if "callsign" and the
-    // FROM callsign in the packet don't match?
-    //
-    // Should we change to third-party format if "my_callsign" and the
-    // FROM callsign in the packet don't match?
-    //
-    // Require all three callsigns to match?
-    //
-    //
+  passcode = atoi(cptr[1]);
 
+  fprintf(stderr,"x_spider udp:  user:%s  pass:%d\n", callsign, passcode);
 
+  if (!checkHash(callsign, passcode))
+  {
+    fprintf(stderr,
+            "X_spider: Bad authentication, user %s, pass %d\n",
+            callsign,
+            passcode);
+    fprintf(stderr,
+            "UDP Packet: %s\n",
+            buf);
+    send_udp_nack(sock, (struct sockaddr *)&from, fromlen);
+    return;
+  }
 
-    n1 = strlen(message);
-    n2 = strlen(message2);
 
+  // Here's where we would look for the optional flags in the
+  // first line.  Here we implement these flags:
+  //      -identify
+  //      -to_rf
+  //      -to_inet
 
-    // Send to Xastir udp pipe
-    //
-    //fprintf(stderr,"Sending to Xastir itself\n");
-    if (writen(pipe_udp_server_to_xastir, message2, n2) != n2)
-    {
-      fprintf(stderr,"UDP_Server: Writen error1: %d\n", errno);
-    }
 
-    // Send to the x_spider TCP server, so it can go to all
-    // connected TCP clients
-    //fprintf(stderr,"Sending to TCP clients\n");
-    if (writen(pipe_xastir_to_tcp_server, message, n1) != n1)
-    {
-      fprintf(stderr, "UDP_Server: Writen error2: %d\n", errno);
-    }
+  // Look for the "-identify" flag in the UDP packet
+  //
+  if (strstr(buf, "-identify"))
+  {
 
-    // Send an ACK back to the xastir_udp_client program
+    // Send the callsign back to the xastir_udp_client
+    // program
     n1 = sendto(sock,
-                "ACK",  // Acknowledgment.  Good UDP packet.
-                4,
+                my_callsign,
+                strlen(my_callsign)+1,
                 0,
                 (struct sockaddr *)&from,
                 fromlen);
@@ -1756,179 +1569,335 @@ void UDP_Server(int UNUSED(argc), char * UNUSED(argv[]), char * UNUSED(envp[]) )
     {
       fprintf(stderr, "Error: sendto");
     }
+    return;
   }
-}
 
 
+  // Look for the "-to_inet" flag in the UDP packet
+  //
+  if (strstr(buf, "-to_inet"))
+  {
+    //fprintf(stderr,"Sending to INET\n");
+    send_to_inet++;
+  }
 
 
+  // Look for the "-to_rf" flag in the UDP packet
+  //
+  if (strstr(buf, "-to_rf"))
+  {
+    //fprintf(stderr,"Sending to local RF\n");
+    send_to_rf++;
+  }
 
-// Function used to start a separate process for the server.  This
-// way the server can be running concurrently with the main part of
-// Xastir.
-//
-// Turns out that with a "fork", the memory image of the server was
-// too large.  Might try it with a thread instead before abandoning
-// that method altogether.  It would be nice to have this be more
-// integrated with Xastir, instead of having to have a socket to
-// communicate between Xastir and the server.
-//
-#ifndef STANDALONE_PROGRAM
-int Fork_TCP_server(int argc, char *argv[], char *envp[])
-{
-  int childpid;
 
+  // Now snag the text message from the second line using the
+  // original buffer.  Look for the first '\n' character which
+  // is just before the text message itself.
+  message = strchr(buf, '\n');
+
+  if (message == NULL || message[1] == '\0')
+  {
+    //fprintf(stderr,"Empty message field\n");
+    send_udp_nack(sock, (struct sockaddr *)&from, fromlen);
+    return;
+  }
+  message++;  // Point to the first char after the '\n'
+
+  xastir_snprintf(message2,
+                  sizeof(message2) - 2,
+                  "%s%s%s",
+                  (send_to_inet) ? "TO_INET," : "",
+                  (send_to_rf) ? "TO_RF," : "",
+                  message);
 
-  // Allocate a pipe before we fork.
   //
-  xastir_tcp_pipe = (pipe_object *)malloc(sizeof(pipe_object));
-  if (xastir_tcp_pipe == NULL)
+  //
+  // NOTE:
+  // Should we refuse to send the message on if "callsign" and the
+  // FROM callsign in the packet don't match?
+  //
+  // Should we change to third-party format if "my_callsign" and the
+  // FROM callsign in the packet don't match?
+  //
+  // Require all three callsigns to match?
+  //
+  //
+
+
+  // Send to Xastir udp pipe
+  //
+  n2 = spider_line_end(message2, strlen(message2), "\n");
+  if (writen(pipe_udp_server_to_xastir, message2, n2) != n2)
   {
-    fprintf(stderr,"x_spider: Couldn't malloc pipe_object\n");
-    return(0);
+    fprintf(stderr,"x_spider: UDP writen error to Xastir: %d\n", errno);
   }
 
-  if (pipe(xastir_tcp_pipe->to_child) < 0 || pipe(xastir_tcp_pipe->to_parent) < 0)
+  // Send to all connected TCP clients.  "message" can run to the
+  // end of "buf", so copy it where there's room for the "\r\n".
+  //
+  n1 = strlen(message);
+  if (n1 > MAXLINE - 3)
   {
-    fprintf(stderr,"x_spider: Can't create pipes\n");
-    free(xastir_tcp_pipe);    // Free the malloc'd memory.
-    xastir_tcp_pipe = NULL;
-    return(0);
+    n1 = MAXLINE - 3;
   }
+  memcpy(line, message, n1);
+  line[n1] = '\0';
+  n1 = spider_line_end(line, n1, "\r\n");
+  spider_broadcast(NULL, line, n1);
+
+  // Send an ACK back to the xastir_udp_client program
+  n1 = sendto(sock,
+              "ACK",  // Acknowledgment.  Good UDP packet.
+              4,
+              0,
+              (struct sockaddr *)&from,
+              fromlen);
+  if (n1 < 0)
+  {
+    fprintf(stderr, "Error: sendto");
+  }
+}
 
-  xastir_tcp_pipe->authenticated = 1;
-  xastir_tcp_pipe->callsign[0] = '\0';
 
-  if ( (childpid = fork()) < 0)
+
+
+
+// Set up a socket or pipe for the event loop to watch.
+//
+static spider_client *spider_source(int fd, int kind)
+{
+  spider_client *c;
+
+
+  c = (spider_client *)calloc(1, sizeof(spider_client));
+  if (c == NULL)
   {
-    fprintf(stderr,"Fork_TCP_server: Fork error\n");
+    fprintf(stderr,"x_spider: Couldn't malloc spider_client\n");
+    return(NULL);
+  }
+  c->fd = fd;
+  c->kind = kind;
 
-    // Close pipes
-    close(xastir_tcp_pipe->to_child[0]);
-    close(xastir_tcp_pipe->to_child[1]);
-    close(xastir_tcp_pipe->to_parent[0]);
-    close(xastir_tcp_pipe->to_parent[1]);
-    free(xastir_tcp_pipe);    // Free the malloc'd memory.
-    xastir_tcp_pipe = NULL;
-    return(0);
+  if (fcntl(fd, F_SETFL, O_NONBLOCK) < 0)
+  {
+    fprintf(stderr,"x_spider: Couldn't set descriptor non-blocking\n");
   }
-  else if (childpid == 0)
+  if (spider_watch(c) < 0)
   {
-    //
-    // Child process
-    //
+    fprintf(stderr,"x_spider: Can't watch descriptor: %d\n", errno);
+    free(c);
+    return(NULL);
+  }
+  return(c);
+}
 
 
-    // Go back to default signal handler instead of calling
-    // restart() on SIGHUP
-    (void) signal(SIGHUP,SIG_DFL);
 
 
-    // Change the name of the new child process.  So far this
-    // only works for "ps" listings, not for "top".  This code
-    // only works on Linux.  For BSD use setproctitle(3), NetBSD
-    // can use setprogname(2).
-#ifdef __linux__
-    init_set_proc_title(argc, argv, envp);
-    set_proc_title("%s", "x-spider TCP daemon (xastir)");
-    //fprintf(stderr,"DEBUG: %s\n", Argv[0]);
-    (void) signal(SIGHUP, exit);
-#endif  // __linux__
 
+// The server.  One process serves the TCP listening sockets, every
+// connected TCP client, the UDP sockets and the pipe from Xastir
+// from a single event loop (epoll where we have it, poll()
+// otherwise).  The initial code framework here is from the book:
+// "Unix Network Programming".
+//
+// Anything that comes in from a TCP client gets repeated to all of
+// the other connected clients, and to Xastir too once the client has
+// authenticated with a good passcode.  Anything Xastir sends us goes
+// out to every client.  UDP packets are authenticated per packet,
+// and go to Xastir and every TCP client.
+//
+// Output for each client goes straight to its socket.  What the
+// socket won't take is queued in the client's ring and written once
+// the socket drains.  A client whose ring fills up is dropped rather
+// than let it hold up the others or grow without bound.
+//
+#ifdef STANDALONE_PROGRAM
+int main(int argc, char *argv[])
+{
+#else   // !STANDALONE_PROGRAM
+void Spider_Server(int UNUSED(argc), char * UNUSED(argv[]), char * UNUSED(envp[]) )
+{
+#endif  // STANDALONE_PROGRAM
 
-    close(xastir_tcp_pipe->to_child[1]);  // Close write end of pipe
-    close(xastir_tcp_pipe->to_parent[0]); // Close read end of pipe
+  spider_event event[SPIDER_MAX_EVENTS];
+  spider_client *c;
+  int *sockfds;
+  int nsock;
+  int i, n;
 
-    // Assign the global variables
-    pipe_tcp_server_to_xastir = xastir_tcp_pipe->to_parent[1];
-    pipe_xastir_to_tcp_server = xastir_tcp_pipe->to_child[0];
 
-    // Set read-end of pipe to be non-blocking.
-    //
-    if (fcntl(pipe_xastir_to_tcp_server, F_SETFL, O_NONBLOCK) < 0)
-    {
-      fprintf(stderr,"x_spider: Couldn't set read-end of pipe_xastir_to_tcp_server non-blocking\n");
-      fprintf(stderr,"Could some processes still be running from a previous run of Xastir?\n");
-    }
+  // A client that goes away mid-write shouldn't take the server
+  // with it.
+  (void) signal(SIGPIPE, SIG_IGN);
 
-    TCP_Server(argc, argv, envp);
-    fprintf(stderr,"TCP_Server process died.\n");
+#ifdef HAVE_SYS_EPOLL_H
+  spider_epoll = epoll_create(SPIDER_MAX_EVENTS);
+  if (spider_epoll < 0)
+  {
+    fprintf(stderr, "x_spider: epoll_create() error: %d - %s\n", errno, strerror(errno));
     exit(1);
   }
-  //
-  // Parent process
-  //
+#endif  // HAVE_SYS_EPOLL_H
 
-  close(xastir_tcp_pipe->to_parent[1]); // Close write end of pipe
-  close(xastir_tcp_pipe->to_child[0]);  // Close read end of pipe
-
-  // Assign the global variables so that Xastir itself will know
-  // how to talk to the pipes
-  pipe_tcp_server_to_xastir = xastir_tcp_pipe->to_parent[0];
-  pipe_xastir_to_tcp_server = xastir_tcp_pipe->to_child[1];
+  nsock = open_spider_server_sockets(SOCK_STREAM, SERV_TCP_PORT, &sockfds);
+  if(!nsock)
+  {
+    fprintf(stderr, "Unable to setup any x_spider server sockets.\n");
+    exit(1);
+  }
+  for (i = 0; i < nsock; i++)
+  {
+    (void)spider_source(sockfds[i], SPIDER_LISTEN);
+  }
+  free(sockfds);
 
-  // Set read-end of pipe to be non-blocking.
-  //
-  if (fcntl(pipe_tcp_server_to_xastir, F_SETFL, O_NONBLOCK) < 0)
+  nsock = open_spider_server_sockets(SOCK_DGRAM, SERV_UDP_PORT, &sockfds);
+  if(!nsock)
   {
-    fprintf(stderr,"x_spider: Couldn't set read-end of pipe_tcp_server_to_xastir non-blocking\n");
+    fprintf(stderr, "Unable to setup any x_spider UDP server sockets.\n");
     fprintf(stderr,"Could some processes still be running from a previous run of Xastir?\n");
   }
+  for (i = 0; i < nsock; i++)
+  {
+    (void)spider_source(sockfds[i], SPIDER_UDP);
+  }
+  free(sockfds);
 
-  //    // Set write-end of pipe to be non-blocking.
-  //    //
-  //    if (fcntl(pipe_xastir_to_tcp_server, F_SETFL, O_NONBLOCK) < 0) {
-  //        fprintf(stderr,"x_spider: Couldn't set read-end of pipe_xastir_to_tcp_server non-blocking\n");
-  //    }
+  if (spider_source(pipe_xastir_to_tcp_server, SPIDER_XASTIR) == NULL)
+  {
+    exit(1);
+  }
 
-  // We don't need to do anything here except return back to the
-  // calling routine with the PID of the new server process, so
-  // that it can request the server and all it's children to quit
-  // when Xastir quits or segfaults.
-  return(childpid);   // Really the parent PID in this case
+  // Infinite loop
+  //
+  for ( ; ; )
+  {
+    n = spider_wait(event, SPIDER_MAX_EVENTS, 5000);
+    if (n < 0)
+    {
+      if (errno != EINTR)
+      {
+        fprintf(stderr, "x_spider: Error waiting for events: %d - %s\n", errno, strerror(errno));
+        sleep(1);
+      }
+      continue;
+    }
+    else if (n == 0)
+    {
+      // Timeout, check if parent is still alive
+      if (kill(parent_pid, 0) == -1 && errno == ESRCH)
+      {
+        // Parent died, exit
+        exit(0);
+      }
+      continue;
+    }
+
+    for (i = 0; i < n; i++)
+    {
+      c = event[i].client;
+
+      switch (c->kind)
+      {
+        case SPIDER_LISTEN:
+          spider_accept(c);
+          break;
+
+        case SPIDER_UDP:
+          spider_udp_datagram(c->fd);
+          break;
+
+        case SPIDER_XASTIR:
+          if (!spider_read_lines(c, spider_xastir_line))
+          {
+            exit(0); // Connection terminated
+          }
+          break;
+
+        case SPIDER_CLIENT:
+          if (event[i].writable)
+          {
+            spider_flush(c);
+          }
+          if (event[i].readable && c->kind == SPIDER_CLIENT
+              && !spider_read_lines(c, spider_client_line))
+          {
+            spider_close(c);
+          }
+          break;
+
+        default:    // Closed earlier in this pass
+          break;
+      }
+    }
+
+    spider_reap();
+  }
 }
-#endif  // STANDALONE_PROGRAM
 
 
 
 
 
-int Fork_UDP_server(int argc, char *argv[], char *envp[])
+// Function used to start a separate process for the server.  This
+// way the server can be running concurrently with the main part of
+// Xastir.
+//
+// Turns out that with a "fork", the memory image of the server was
+// too large.  Might try it with a thread instead before abandoning
+// that method altogether.  It would be nice to have this be more
+// integrated with Xastir, instead of having to have a socket to
+// communicate between Xastir and the server.
+//
+// Sets up the pipes to/from Xastir and returns the PID of the server
+// process, or 0 if it couldn't be started.
+//
+#ifndef STANDALONE_PROGRAM
+int Fork_spider_server(int argc, char *argv[], char *envp[])
 {
+  int to_server[2];
+  int tcp_to_xastir[2];
+  int udp_to_xastir[2];
   int childpid;
 
 
-  // Allocate a pipe before we fork.
+  // Allocate the pipes before we fork.
   //
-  xastir_udp_pipe = (pipe_object *)malloc(sizeof(pipe_object));
-  if (xastir_udp_pipe == NULL)
+  if (pipe(to_server) < 0)
   {
-    fprintf(stderr,"x_spider: Couldn't malloc pipe_object\n");
+    fprintf(stderr,"x_spider: Can't create pipes\n");
     return(0);
   }
-
-  if (pipe(xastir_udp_pipe->to_child) < 0 || pipe(xastir_udp_pipe->to_parent) < 0)
+  if (pipe(tcp_to_xastir) < 0)
   {
     fprintf(stderr,"x_spider: Can't create pipes\n");
-    free(xastir_udp_pipe);    // Free the malloc'd memory.
-    xastir_udp_pipe = NULL;
+    close(to_server[0]);
+    close(to_server[1]);
+    return(0);
+  }
+  if (pipe(udp_to_xastir) < 0)
+  {
+    fprintf(stderr,"x_spider: Can't create pipes\n");
+    close(to_server[0]);
+    close(to_server[1]);
+    close(tcp_to_xastir[0]);
+    close(tcp_to_xastir[1]);
     return(0);
   }
-
-  xastir_udp_pipe->authenticated = 1;
-  xastir_udp_pipe->callsign[0] = '\0';
 
   if ( (childpid = fork()) < 0)
   {
-    fprintf(stderr,"Fork_UDP_server: Fork error\n");
+    fprintf(stderr,"Fork_spider_server: Fork error\n");
 
     // Close pipes
-    close(xastir_udp_pipe->to_child[0]);
-    close(xastir_udp_pipe->to_child[1]);
-    close(xastir_udp_pipe->to_parent[0]);
-    close(xastir_udp_pipe->to_parent[1]);
-    free(xastir_udp_pipe);    // Free the malloc'd memory.
-    xastir_udp_pipe = NULL;
+    close(to_server[0]);
+    close(to_server[1]);
+    close(tcp_to_xastir[0]);
+    close(tcp_to_xastir[1]);
+    close(udp_to_xastir[0]);
+    close(udp_to_xastir[1]);
     return(0);
   }
   else if (childpid == 0)
@@ -1951,61 +1920,56 @@ int Fork_UDP_server(int argc, char *argv[], char *envp[])
     // can use setprogname(2).
 #ifdef __linux__
     init_set_proc_title(argc, argv, envp);
-    set_proc_title("%s", "x-spider UDP daemon (xastir)");
+    set_proc_title("%s", "x-spider daemon (xastir)");
     //fprintf(stderr,"DEBUG: %s\n", Argv[0]);
     (void) signal(SIGHUP, exit);
 #endif  // __linux__
 
 
-    close(xastir_udp_pipe->to_child[1]);  // Close write end of pipe
-    close(xastir_udp_pipe->to_parent[0]); // Close read end of pipe
+    close(to_server[1]);      // Close write end of pipe
+    close(tcp_to_xastir[0]);  // Close read ends of pipes
+    close(udp_to_xastir[0]);
 
     // Assign the global variables
-    pipe_udp_server_to_xastir = xastir_udp_pipe->to_parent[1];
-    pipe_xastir_to_udp_server = xastir_udp_pipe->to_child[0];
-
-    // Set read-end of pipe to be non-blocking.
-    //
-    //        if (fcntl(pipe_xastir_to_udp_server, F_SETFL, O_NONBLOCK) < 0) {
-    //            fprintf(stderr,
-    //                "x_spider: Couldn't set read-end of pipe_xastir_to_udp_server non-blocking\n");
-    //        }
+    pipe_xastir_to_tcp_server = to_server[0];
+    pipe_tcp_server_to_xastir = tcp_to_xastir[1];
+    pipe_udp_server_to_xastir = udp_to_xastir[1];
 
-    UDP_Server(argc, argv, envp);
-    fprintf(stderr,"UDP_Server process died.\n");
+    Spider_Server(argc, argv, envp);
+    fprintf(stderr,"Spider_Server process died.\n");
     exit(1);
   }
   //
   // Parent process
   //
 
-  close(xastir_udp_pipe->to_parent[1]); // Close write end of pipe
-  close(xastir_udp_pipe->to_child[0]);  // Close read end of pipe
+  close(to_server[0]);      // Close read end of pipe
+  close(tcp_to_xastir[1]);  // Close write ends of pipes
+  close(udp_to_xastir[1]);
 
   // Assign the global variables so that Xastir itself will know
   // how to talk to the pipes
-  pipe_udp_server_to_xastir = xastir_udp_pipe->to_parent[0];
-  pipe_xastir_to_udp_server = xastir_udp_pipe->to_child[1];
-
+  pipe_xastir_to_tcp_server = to_server[1];
+  pipe_tcp_server_to_xastir = tcp_to_xastir[0];
+  pipe_udp_server_to_xastir = udp_to_xastir[0];
 
-  // Set read-end of pipe to be non-blocking.
+  // Set read-ends of pipes to be non-blocking.
   //
+  if (fcntl(pipe_tcp_server_to_xastir, F_SETFL, O_NONBLOCK) < 0)
+  {
+    fprintf(stderr,"x_spider: Couldn't set read-end of pipe_tcp_server_to_xastir non-blocking\n");
+    fprintf(stderr,"Could some processes still be running from a previous run of Xastir?\n");
+  }
   if (fcntl(pipe_udp_server_to_xastir, F_SETFL, O_NONBLOCK) < 0)
   {
     fprintf(stderr,"x_spider: Couldn't set read-end of pipe_udp_server_to_xastir non-blocking\n");
     fprintf(stderr,"Could some processes still be running from a previous run of Xastir?\n");
   }
 
-  //    // Set write-end of pipe to be non-blocking.
-  //    //
-  //    if (fcntl(pipe_xastir_to_udp_server, F_SETFL, O_NONBLOCK) < 0) {
-  //        fprintf(stderr,"x_spider: Couldn't set read-end of pipe_xastir_to_udp_server non-blocking\n");
-  //    }
-
-
   // We don't need to do anything here except return back to the
   // calling routine with the PID of the new server process, so
-  // that it can request the server and all it's children to quit
-  // when Xastir quits or segfaults.
+  // that it can request the server to quit when Xastir quits or
+  // segfaults.
   return(childpid);   // Really the parent PID in this case
 }
+#endif  // STANDALONE_PROGRAM
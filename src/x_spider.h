@@ -39,8 +39,7 @@ extern int pipe_udp_server_to_xastir;
 
 extern int writen(int fd, char *ptr, int nbytes);
 extern int readline(int fd, char *ptr, int maxlen);
-extern int Fork_TCP_server(int argc, char *argv[], char *envp[]);
-extern int Fork_UDP_server(int argc, char *argv[], char *envp[]);
+extern int Fork_spider_server(int argc, char *argv[], char *envp[]);
 
 
 #endif /* XASTIR_SERVER_H */
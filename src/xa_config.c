@@ -46,6 +46,7 @@
 #include "messages.h"
 #include "draw_symbols.h"
 #include "maps.h"
+#include "map_OSM.h"
 #include "track_gui.h"
 #include "snprintf.h"
 #include "objects.h"
@@ -53,6 +54,7 @@
 #include "db_gis.h"
 #include "ambiguity_utils.h"
 #include "cad_objects.h"
+#include "decode_thread.h"
 
 // Must be last include file
 #include "leak_detection.h"
@@ -632,6 +634,9 @@ void save_data(void)
     store_float (fout, "IMAGEMAGICK_GAMMA_ADJUST", imagemagick_gamma_adjust);
 #endif  // HAVE_MAGICK
     store_float(fout, "RASTER_MAP_INTENSITY", raster_map_intensity);
+    store_int(fout, "RASTER_PYRAMID_MAX_MB", raster_pyramid_max_mb);
+    store_int(fout, "OSM_TILE_CACHE_MB", osm_tile_cache_mb);
+    store_int(fout, "OSM_TILE_PREFETCH", osm_tile_prefetch);
 #endif  // NO_GRAPHICS
 
     store_string(fout, "PRINT_PROGRAM", printer_program);
@@ -1040,6 +1045,9 @@ void save_data(void)
 
     store_int (fout, "NET_RUN_AS_IGATE", operate_as_an_igate);
     store_int (fout, "NETWORK_WAITTIME", NETWORK_WAITTIME);
+    store_int (fout, "PACKET_DRAIN_TIME", packet_drain_time);
+    store_int (fout, "STATION_SNAPSHOT_INTERVAL", station_snapshot_interval);
+    store_int (fout, "DECODE_THREAD", enable_decode_thread);
 
     // LOGGING
     store_int (fout, "LOG_IGATE", log_igate);
@@ -1545,6 +1553,9 @@ void load_data_or_default(void)
   imagemagick_gamma_adjust = get_float("IMAGEMAGICK_GAMMA_ADJUST", 0.0, 1.0, 0.0);
 #endif  // HAVE_MAGICK
   raster_map_intensity = get_float("RASTER_MAP_INTENSITY", 0.0, 1.0, 1.0);
+  raster_pyramid_max_mb = get_int("RASTER_PYRAMID_MAX_MB", 0, 65536, 1024);
+  osm_tile_cache_mb = get_int("OSM_TILE_CACHE_MB", 0, 4096, 64);
+  osm_tile_prefetch = get_int("OSM_TILE_PREFETCH", 0, 1, 1);
 #endif  // NO_GRAPHICS
 
   if (!get_string ("PRINT_PROGRAM", printer_program, sizeof(printer_program))
@@ -2309,6 +2320,13 @@ void load_data_or_default(void)
 
   NETWORK_WAITTIME = get_int ("NETWORK_WAITTIME", 10,120,10);
 
+  // Milliseconds per UpdateTime() tick spent decoding incoming packets
+  packet_drain_time = get_int ("PACKET_DRAIN_TIME", 1,500,25);
+  station_snapshot_interval = get_int ("STATION_SNAPSHOT_INTERVAL", 0,1440,15);
+
+  // Parse incoming packets on a separate thread.  Takes effect at startup.
+  enable_decode_thread = get_int ("DECODE_THREAD", 0,1,0);
+
   // LOGGING
   log_wx = get_int ("LOG_WX", 0,1,0);
   log_message_data = get_int ("LOG_MESSAGE", 0, 1, 0);
@@ -0,0 +1,496 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 2000-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+
+
+
+
+// Load test for the x_spider server port.  Connects a number of
+// TCP clients to the server, has one more client send a stream of
+// packets, and reports how many of them each client got back and
+// how long they took.  Optionally adds clients that never read, to
+// check that the server drops them instead of falling behind.
+//
+// The test packets are repeated to every other client but never
+// reach Xastir itself, as the sending client doesn't log in.
+
+#ifdef HAVE_CONFIG_H
+  #include "config.h"
+#endif  // HAVE_CONFIG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <string.h>
+#include <fcntl.h>
+
+#include <netinet/in.h>     // Moved ahead of inet.h as reports of some *BSD's not
+// including this as they should.
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+
+#include <netdb.h>
+
+#include <sys/types.h>
+#include <sys/time.h>
+#include <errno.h>
+#include <signal.h>
+
+#include <poll.h>
+
+#include "xastir.h"
+
+// Must be last include file
+#include "leak_detection.h"
+
+
+
+#define LOAD_LINE 512
+#define LOAD_WINDOW 256     // Packets in flight when flooding
+
+typedef struct
+{
+  int fd;
+  int closed;           // Server dropped us
+  int slow;             // Never reads until the end
+  char line[LOAD_LINE];
+  int line_length;
+  long received;
+  long out_of_order;
+  long last_seq;
+} load_client;
+
+static double latency_min = 1e9;
+static double latency_max = 0;
+static double latency_sum = 0;
+static long latency_count = 0;
+
+
+
+static double now(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return(tv.tv_sec + tv.tv_usec / 1e6);
+}
+
+
+
+// Connect to the server, trying each address it has.  Returns the
+// socket or -1.
+int connect_server(char *hostname, char *port)
+{
+  struct addrinfo hints, *res, *r;
+  int error;
+  int fd = -1;
+  int flag = 1;
+
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = PF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_ADDRCONFIG;
+
+  error = getaddrinfo(hostname, port, &hints, &res);
+  if (error)
+  {
+    fprintf(stderr, "Error: Unable to lookup addresses for host %s port %s\n",
+            hostname, port);
+    fprintf(stderr, "Getaddrinfo returned error: %s\n",gai_strerror(error));
+    return(-1);
+  }
+
+  for (r = res; r && fd < 0; r = r->ai_next)
+  {
+    fd = socket(r->ai_family, r->ai_socktype, r->ai_protocol);
+    if (fd < 0)
+    {
+      continue;
+    }
+    if (connect(fd, r->ai_addr, r->ai_addrlen) < 0)
+    {
+      close(fd);
+      fd = -1;
+    }
+  }
+  freeaddrinfo(res);
+
+  if (fd < 0)
+  {
+    fprintf(stderr, "Unable to connect to %s port %s: %s\n", hostname, port, strerror(errno));
+    return(-1);
+  }
+  (void)setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (char *)&flag, sizeof(int));
+  (void)fcntl(fd, F_SETFL, O_NONBLOCK);
+  return(fd);
+}
+
+
+
+// A line from the server.  Only our own test packets count.
+void load_line(load_client *c, char *line)
+{
+  char *p;
+  long seq;
+  double sent, latency;
+
+  p = strstr(line, ">spider load ");
+  if (c->slow || p == NULL || sscanf(p, ">spider load %ld %lf", &seq, &sent) != 2)
+  {
+    return;
+  }
+
+  latency = now() - sent;
+  if (latency < latency_min)
+  {
+    latency_min = latency;
+  }
+  if (latency > latency_max)
+  {
+    latency_max = latency;
+  }
+  latency_sum += latency;
+  latency_count++;
+
+  if (seq <= c->last_seq)
+  {
+    c->out_of_order++;
+  }
+  c->last_seq = seq;
+  c->received++;
+}
+
+
+
+// Read what the server has sent us.  Returns the bytes read, 0 if
+// nothing was waiting, -1 once the server has closed the connection.
+int load_read(load_client *c)
+{
+  char buffer[8192];
+  int n, i;
+
+  n = read(c->fd, buffer, sizeof(buffer));
+  if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+  {
+    c->closed = 1;
+    return(-1);
+  }
+  if (n < 0)
+  {
+    return(0);
+  }
+
+  for (i = 0; i < n; i++)
+  {
+    if (buffer[i] == '\n' || c->line_length == LOAD_LINE - 1)
+    {
+      c->line[c->line_length] = '\0';
+      load_line(c, c->line);
+      c->line_length = 0;
+    }
+    else
+    {
+      c->line[c->line_length++] = buffer[i];
+    }
+  }
+  return(n);
+}
+
+
+
+// Write all of "line", waiting for the socket if it must.  Returns 0
+// or -1.
+int load_write(int fd, char *line)
+{
+  int length = strlen(line);
+  int n;
+  struct pollfd polls;
+
+  while (length > 0)
+  {
+    n = write(fd, line, length);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+    {
+      polls.fd = fd;
+      polls.events = POLLOUT;
+      (void)poll(&polls, 1, 1000);
+      continue;
+    }
+    if (n <= 0)
+    {
+      return(-1);
+    }
+    line += n;
+    length -= n;
+  }
+  return(0);
+}
+
+
+
+// Inputs:
+//      hostname    (argv[1])
+//      port        (argv[2])
+//      optional flags:  -clients N   clients that read (default 50)
+//                       -slow N      clients that never read (default 0)
+//                       -packets N   packets to send (default 10000)
+//                       -rate N      packets per second, 0 for as
+//                                    fast as the clients keep up
+//                                    (default 0)
+//                       -login call passcode
+//                                    log the reading clients in
+// Returns:
+//      0: Every reading client got every packet, in order
+//      1: Error condition, lost or reordered packets
+//
+int main(int argc, char *argv[])
+{
+  int clients = 50;
+  int slow = 0;
+  long packets = 10000;
+  double rate = 0;
+  char *callsign = NULL;
+  char *passcode = NULL;
+  load_client *client;
+  struct pollfd *polls;
+  int sender;
+  char line[LOAD_LINE];
+  long sent = 0;
+  long behind;
+  long received = 0;
+  long reordered = 0;
+  int complete, dropped, slow_dropped;
+  double start, finish, last_data;
+  int ii, n;
+
+
+  if (argc < 3)
+  {
+    fprintf(stderr,
+            "\nUsage: xastir_spider_load server port [-clients N] [-slow N] [-packets N] [-rate N] [-login call passcode]\n");
+    fprintf(stderr,
+            "\nExample: xastir_spider_load localhost 2023 -clients 100 -slow 2 -packets 50000\n");
+    return(1);
+  }
+
+  for (ii = 3; ii < argc; ii++)
+  {
+    if (strcmp(argv[ii], "-clients") == 0 && ii + 1 < argc)
+    {
+      clients = atoi(argv[++ii]);
+    }
+    else if (strcmp(argv[ii], "-slow") == 0 && ii + 1 < argc)
+    {
+      slow = atoi(argv[++ii]);
+    }
+    else if (strcmp(argv[ii], "-packets") == 0 && ii + 1 < argc)
+    {
+      packets = atol(argv[++ii]);
+    }
+    else if (strcmp(argv[ii], "-rate") == 0 && ii + 1 < argc)
+    {
+      rate = atof(argv[++ii]);
+    }
+    else if (strcmp(argv[ii], "-login") == 0 && ii + 2 < argc)
+    {
+      callsign = argv[++ii];
+      passcode = argv[++ii];
+    }
+    else
+    {
+      fprintf(stderr, "Unknown option %s\n", argv[ii]);
+      return(1);
+    }
+  }
+  if (clients < 1 || slow < 0 || packets < 1)
+  {
+    fprintf(stderr, "Need at least one client and one packet\n");
+    return(1);
+  }
+
+  (void)signal(SIGPIPE, SIG_IGN);
+
+  client = calloc(clients + slow, sizeof(load_client));
+  polls = calloc(clients, sizeof(struct pollfd));
+  if (client == NULL || polls == NULL)
+  {
+    fprintf(stderr, "Out of memory\n");
+    return(1);
+  }
+
+  for (ii = 0; ii < clients + slow; ii++)
+  {
+    client[ii].fd = connect_server(argv[1], argv[2]);
+    client[ii].last_seq = -1;
+    client[ii].slow = (ii >= clients);
+    if (client[ii].fd < 0)
+    {
+      return(1);
+    }
+    if (callsign && ii < clients)
+    {
+      snprintf(line, sizeof(line), "user %s pass %s vers xastir_spider_load\r\n",
+               callsign, passcode);
+      if (load_write(client[ii].fd, line) < 0)
+      {
+        fprintf(stderr, "Login failed: %s\n", strerror(errno));
+        return(1);
+      }
+    }
+  }
+  sender = connect_server(argv[1], argv[2]);
+  if (sender < 0)
+  {
+    return(1);
+  }
+
+  // Let the server settle all the connects and logins
+  sleep(1);
+
+  fprintf(stdout, "%d clients, %d slow clients, sending %ld packets\n",
+          clients, slow, packets);
+
+  start = now();
+  last_data = start;
+  for ( ; ; )
+  {
+    // Send what's due.  Flooding, stay within a window of the
+    // slowest reader so that we measure the server rather than how
+    // fast this one process can read all of its sockets.
+    behind = sent;
+    for (ii = 0; ii < clients; ii++)
+    {
+      if (!client[ii].closed && client[ii].received < behind)
+      {
+        behind = client[ii].received;
+      }
+    }
+    while (sent < packets
+           && (rate <= 0 ? sent - behind < LOAD_WINDOW : sent < (now() - start) * rate))
+    {
+      snprintf(line, sizeof(line),
+               "LOAD>APRS,TCPIP*:>spider load %ld %.6f\r\n", sent, now());
+      if (load_write(sender, line) < 0)
+      {
+        fprintf(stderr, "Send failed after %ld packets: %s\n", sent, strerror(errno));
+        return(1);
+      }
+      sent++;
+    }
+
+    // Read what's arrived
+    for (ii = 0; ii < clients; ii++)
+    {
+      polls[ii].fd = client[ii].closed ? -1 : client[ii].fd;
+      polls[ii].events = POLLIN;
+      polls[ii].revents = 0;
+    }
+    n = poll(polls, clients, (sent < packets) ? (rate > 0 ? 1 : 0) : 100);
+    for (ii = 0; n > 0 && ii < clients; ii++)
+    {
+      if (polls[ii].revents && load_read(&client[ii]) != 0)
+      {
+        last_data = now();
+      }
+    }
+
+    if (sent == packets)
+    {
+      complete = 1;
+      for (ii = 0; ii < clients; ii++)
+      {
+        if (!client[ii].closed && client[ii].received < packets)
+        {
+          complete = 0;
+        }
+      }
+      if (complete || now() - last_data > 5.0)
+      {
+        break;
+      }
+    }
+  }
+  finish = now();
+
+  complete = 0;
+  dropped = 0;
+  for (ii = 0; ii < clients; ii++)
+  {
+    received += client[ii].received;
+    reordered += client[ii].out_of_order;
+    if (client[ii].received == packets)
+    {
+      complete++;
+    }
+    if (client[ii].closed)
+    {
+      dropped++;
+    }
+  }
+
+  // A slow client the server gave up on reads its queued data, then
+  // end of file.
+  slow_dropped = 0;
+  for (ii = clients; ii < clients + slow; ii++)
+  {
+    struct pollfd p;
+
+    p.fd = client[ii].fd;
+    p.events = POLLIN;
+    while (!client[ii].closed && poll(&p, 1, 2000) > 0)
+    {
+      (void)load_read(&client[ii]);
+    }
+    if (client[ii].closed)
+    {
+      slow_dropped++;
+    }
+  }
+
+  fprintf(stdout, "Sent %ld packets in %.2f s (%.0f packets/s)\n",
+          sent, finish - start, sent / (finish - start));
+  fprintf(stdout, "Received %ld of %ld (%ld lost), %d of %d clients got everything, %d dropped\n",
+          received, sent * clients, sent * clients - received, complete, clients, dropped);
+  if (reordered)
+  {
+    fprintf(stdout, "%ld packets arrived out of order\n", reordered);
+  }
+  if (latency_count)
+  {
+    fprintf(stdout, "Latency ms: min %.2f, avg %.2f, max %.2f\n",
+            latency_min * 1000, latency_sum / latency_count * 1000, latency_max * 1000);
+  }
+  if (slow)
+  {
+    fprintf(stdout, "Slow clients dropped by the server: %d of %d\n", slow_dropped, slow);
+  }
+
+  for (ii = 0; ii < clients + slow; ii++)
+  {
+    close(client[ii].fd);
+  }
+  close(sender);
+  free(client);
+  free(polls);
+
+  return(complete == clients && reordered == 0 ? 0 : 1);
+}
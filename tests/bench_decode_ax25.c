@@ -0,0 +1,239 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 2025-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+
+
+/*
+ * Benchmark for the decode thread.
+ *
+ * Replays an APRS-IS log (one TNC2-format packet per line, as written
+ * by log_data()) and measures how long the consumer thread spends per
+ * packet, from the raw line to the station database:  once with the
+ * consumer doing predecode_ax25_line() and decode_ax25_packet() itself
+ * as UpdateTime() does without the decode thread, and once with a
+ * worker thread doing predecode_ax25_line() (position, weather and
+ * Mic-E parsing included) and the consumer only copying ready-made
+ * records out of a ring, as pop_decoded_data() does, and adding them
+ * to the database.  Without a log file a synthetic hour of position,
+ * weather, Mic-E, third-party and object packets is generated.
+ *
+ * Station drawing and announcements are deferred as during a burst.
+ * A first untimed pass fills the database so that both timed passes
+ * update existing stations.
+ *
+ * Not part of the test suite.  Build with "make bench_decode_ax25"
+ * and run:
+ *
+ *   ./bench_decode_ax25 [aprs-is.log]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include "tests/test_framework.h"
+
+#include "database.h"
+
+void predecode_ax25_line(char *line, ax25_packet *packet);
+int decode_ax25_packet(ax25_packet *packet, char from, int port, int dbadd);
+
+extern int defer_station_drawing;
+
+// define from xastir.h
+#define MAX_LINE_SIZE 512
+
+#define SYNTHETIC_PACKETS 360000   // An hour of a busy feed at 100 packets/s
+#define RING_SIZE 256
+
+static char (*lines)[MAX_LINE_SIZE+1];
+static long line_count;
+
+static ax25_packet ring[RING_SIZE];
+static volatile unsigned int ring_write;
+static volatile unsigned int ring_read;
+
+static double elapsed(struct timeval *start)
+{
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+  return (now.tv_sec - start->tv_sec) + (now.tv_usec - start->tv_usec) / 1e6;
+}
+
+static void add_line(const char *line)
+{
+  static long allocated = 0;
+
+  if (line_count == allocated)
+  {
+    allocated = allocated ? allocated * 2 : 65536;
+    lines = realloc(lines, allocated * sizeof(*lines));
+    if (lines == NULL)
+    {
+      perror("realloc");
+      exit(1);
+    }
+  }
+  snprintf(lines[line_count++], MAX_LINE_SIZE+1, "%s", line);
+}
+
+static void *worker(void *arg)
+{
+  long ii;
+
+  (void)arg;
+  for (ii = 0; ii < line_count; ii++)
+  {
+    while (ring_write - __atomic_load_n(&ring_read, __ATOMIC_ACQUIRE) >= RING_SIZE)
+    {
+      sched_yield();
+    }
+    predecode_ax25_line(lines[ii], &ring[ring_write & (RING_SIZE - 1)]);
+    __atomic_store_n(&ring_write, ring_write + 1, __ATOMIC_RELEASE);
+  }
+  return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+  char line[MAX_LINE_SIZE+1];
+  ax25_packet packet;
+  struct timeval start;
+  pthread_t thread;
+  double busy, secs;
+  long valid = 0;
+  long ii;
+  char *ptr;
+  FILE *f;
+
+  if (argc > 1)
+  {
+    f = fopen(argv[1], "r");
+    if (f == NULL)
+    {
+      perror(argv[1]);
+      return 1;
+    }
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+      if ((ptr = strpbrk(line, "\r\n")) != NULL)
+      {
+        *ptr = '\0';
+      }
+      if (line[0] != '#' && line[0] != '\0')
+      {
+        add_line(line);
+      }
+    }
+    fclose(f);
+  }
+  else
+  {
+    srand(1);
+    for (ii = 0; ii < SYNTHETIC_PACKETS; ii++)
+    {
+      int station = rand() % 20000;
+
+      switch (ii % 8)
+      {
+        case 0:
+          snprintf(line, sizeof(line),
+                   "IGATE%d>APRS,TCPIP*,qAC,T2TEST:}KD%dA>APRS,TCPIP,IGATE%d*:!4903.50N/07201.75W-PHG2360",
+                   station % 100, station % 1000, station % 100);
+          break;
+        case 1:
+          snprintf(line, sizeof(line),
+                   "KC%dX>APRS,TCPIP*,qAC,T2TEST:;OBJ%-6d*111111z4903.50N/07201.75W-Object",
+                   station % 1000, station % 1000);
+          break;
+        case 2:
+          snprintf(line, sizeof(line),
+                   "WX%d>APRS,TCPIP*,qAC,T2TEST:@092345z4903.50N/07201.75W_%03d/%03dg005t077r000p000P000h50b09900wRSW",
+                   station % 1000, station % 360, station % 100);
+          break;
+        case 3:
+          snprintf(line, sizeof(line),
+                   "KB%dM-9>S32U6T,WIDE1-1,qAR,IGATE:`(_fn\"Oj/]Mic-E comment",
+                   station % 1000);
+          break;
+        default:
+          snprintf(line, sizeof(line),
+                   "N%dX-%d>APRS,WIDE1-1,WIDE2-1,qAR,IGATE:!4903.50N/07201.75W>%03d/%03d/A=001234 comment",
+                   station % 10000, station % 16, station % 360, station % 100);
+          break;
+      }
+      add_line(line);
+    }
+  }
+
+  // As during a burst:  no drawing or announcing each station
+  defer_station_drawing = 1;
+
+  for (ii = 0; ii < line_count; ii++)
+  {
+    predecode_ax25_line(lines[ii], &packet);
+    (void)decode_ax25_packet(&packet, 'F', -1, 1);
+  }
+
+  // Parse on the consumer thread, as without the decode thread
+  gettimeofday(&start, NULL);
+  for (ii = 0; ii < line_count; ii++)
+  {
+    predecode_ax25_line(lines[ii], &packet);
+    valid += decode_ax25_packet(&packet, 'F', -1, 1);
+  }
+  secs = elapsed(&start);
+  printf("%ld packets, %ld valid\n", line_count, valid);
+  printf("inline: %.3f us/packet on the consumer thread\n",
+         line_count ? secs * 1e6 / line_count : 0.0);
+
+  // Parse on a worker thread, consumer only copies records out and
+  // adds them.  Only that counts, not time spent waiting.
+  if (pthread_create(&thread, NULL, worker, NULL))
+  {
+    perror("pthread_create");
+    return 1;
+  }
+  busy = 0.0;
+  valid = 0;
+  for (ii = 0; ii < line_count; ii++)
+  {
+    while (__atomic_load_n(&ring_write, __ATOMIC_ACQUIRE) == ring_read)
+    {
+      sched_yield();
+    }
+    gettimeofday(&start, NULL);
+    memcpy(&packet, &ring[ring_read & (RING_SIZE - 1)], sizeof(packet));
+    __atomic_store_n(&ring_read, ring_read + 1, __ATOMIC_RELEASE);
+    valid += decode_ax25_packet(&packet, 'F', -1, 1);
+    busy += elapsed(&start);
+  }
+  pthread_join(thread, NULL);
+  printf("thread: %.3f us/packet on the consumer thread (%ld valid)\n",
+         line_count ? busy * 1e6 / line_count : 0.0, valid);
+
+  free(lines);
+  return 0;
+}
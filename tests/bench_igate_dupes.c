@@ -0,0 +1,175 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 2025-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+
+
+/*
+ * Microbenchmark for the igate dupe check.
+ *
+ * Feeds a stream of third-party packets through the old scheme (a
+ * time-ordered linked list of match strings, walked with strcmp()
+ * on every packet, as not_a_dupe() used to do) and through the
+ * dupe_set hash used now, at a given packet rate.  One in four
+ * packets repeats one heard a few seconds earlier.
+ *
+ * Not part of the test suite.  Build with "make bench_igate_dupes"
+ * and run:
+ *
+ *   ./bench_igate_dupes [packets-per-second]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "igate_utils.h"
+
+#define BENCH_SECONDS 300
+#define LINE_SIZE 128
+
+typedef struct _ListRecord
+{
+  char data[LINE_SIZE];
+  time_t time;
+  struct _ListRecord *next;
+} ListRecord;
+
+static ListRecord *list_head = NULL;
+static ListRecord *list_tail = NULL;
+
+static double elapsed(struct timeval *start)
+{
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+  return (now.tv_sec - start->tv_sec) + (now.tv_usec - start->tv_usec) / 1e6;
+}
+
+// Same normalization as the old not_a_dupe():  source/destination
+// plus info field, path removed.
+static void match_string(char *line, char *match, size_t size)
+{
+  char *c1 = strchr(line, ',');
+  char *c2 = strchr(line, ':');
+
+  snprintf(match, size, "%s", line);
+  if (c1 != NULL && c2 != NULL)
+  {
+    match[c1 - line] = '\0';
+    strncat(match, c2 + 1, size - 1 - strlen(match));
+  }
+}
+
+static int list_check(char *line, time_t now)
+{
+  char match[LINE_SIZE * 2];
+  ListRecord *ptr;
+  time_t cutoff = now - DUPE_WINDOW;
+
+  memset(match, 0, sizeof(match));
+  match_string(line, match, sizeof(match));
+
+  while (list_head != NULL && list_head->time < cutoff)
+  {
+    ptr = list_head;
+    list_head = ptr->next;
+    free(ptr);
+  }
+  if (list_head == NULL)
+  {
+    list_tail = NULL;
+  }
+
+  for (ptr = list_head; ptr != NULL; ptr = ptr->next)
+  {
+    if (strcmp(ptr->data, match) == 0)
+    {
+      return(1);
+    }
+  }
+
+  ptr = malloc(sizeof(ListRecord));
+  snprintf(ptr->data, sizeof(ptr->data), "%s", match);
+  ptr->time = now;
+  ptr->next = NULL;
+  if (list_tail != NULL)
+  {
+    list_tail->next = ptr;
+  }
+  else
+  {
+    list_head = ptr;
+  }
+  list_tail = ptr;
+  return(0);
+}
+
+static void make_line(char *line, long ii, int rate)
+{
+  // Every fourth packet repeats one from about five seconds back
+  long id = (ii % 4 == 3 && ii > 5 * rate) ? ii - 5 * rate - 1 : ii;
+
+  snprintf(line, LINE_SIZE, "}KD%ldA>APRS,TCPIP*,qAC,T2TEST:!4903.50N/07201.75W-%ld",
+           id % 1000, id);
+}
+
+int main(int argc, char *argv[])
+{
+  int rate = argc > 1 ? atoi(argv[1]) : 100;
+  long packets, ii, dupes;
+  char line[LINE_SIZE];
+  struct timeval start;
+  dupe_set set;
+  double secs;
+
+  if (rate <= 0)
+  {
+    rate = 100;
+  }
+  packets = (long)rate * BENCH_SECONDS;
+
+  dupes = 0;
+  gettimeofday(&start, NULL);
+  for (ii = 0; ii < packets; ii++)
+  {
+    make_line(line, ii, rate);
+    dupes += list_check(line, ii / rate);
+  }
+  secs = elapsed(&start);
+  printf("%ld packets at %d/s, %ld dupes\n", packets, rate, dupes);
+  printf("list: %.3f us/packet\n", secs * 1e6 / packets);
+
+  memset(&set, 0, sizeof(set));
+  dupes = 0;
+  gettimeofday(&start, NULL);
+  for (ii = 0; ii < packets; ii++)
+  {
+    make_line(line, ii, rate);
+    dupes += dupe_set_check(&set, dupe_digest(line), ii / rate, 1);
+  }
+  secs = elapsed(&start);
+  printf("hash: %.3f us/packet, %ld dupes, %lu hits, %lu misses\n",
+         secs * 1e6 / packets, dupes, set.hits, set.misses);
+  dupe_set_clear(&set);
+
+  return 0;
+}
@@ -0,0 +1,143 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 2025-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+
+/*
+ * Benchmark for the station database name lookups.
+ *
+ * Replays the source callsigns of an APRS-IS log (one TNC2-format
+ * packet per line, as written by log_data()) through the same
+ * search_station_name()/add_new_station() sequence data_add() uses
+ * for every decoded packet.  Without a log file a synthetic feed is
+ * generated with the callsign prefix skew of a full APRS-IS feed.
+ *
+ * Not part of the test suite.  Build with "make bench_station_index"
+ * and run:
+ *
+ *   ./bench_station_index [aprs-is.log]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "tests/test_framework.h"
+
+#include "database.h"
+
+int search_station_name(DataRow **p_name, char *call, int exact);
+DataRow *add_new_station(DataRow *p_name, DataRow *p_time, char *call);
+void delete_all_stations(void);
+
+extern int station_count;
+
+// define from xastir.h
+#define MAX_LINE_SIZE 512
+
+#define SYNTHETIC_STATIONS 40000
+#define SYNTHETIC_PACKETS  1000000
+
+static double elapsed(struct timeval *start)
+{
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+  return (now.tv_sec - start->tv_sec) + (now.tv_usec - start->tv_usec) / 1e6;
+}
+
+static void lookup_station(char *call, long *found)
+{
+  DataRow *p_name;
+
+  if (search_station_name(&p_name, call, 1))
+  {
+    (*found)++;
+  }
+  else
+  {
+    (void)add_new_station(p_name, NULL, call);
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  char line[MAX_LINE_SIZE+1];
+  char call[MAX_CALLSIGN+1];
+  struct timeval start;
+  long packets = 0;
+  long found = 0;
+  double secs;
+  char *ptr;
+  FILE *f;
+  long ii;
+
+  gettimeofday(&start, NULL);
+
+  if (argc > 1)
+  {
+    f = fopen(argv[1], "r");
+    if (f == NULL)
+    {
+      perror(argv[1]);
+      return 1;
+    }
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+      if (line[0] == '#' || (ptr = strchr(line, '>')) == NULL
+          || ptr == line || ptr - line > MAX_CALLSIGN)
+      {
+        continue;
+      }
+      *ptr = '\0';
+      lookup_station(line, &found);
+      packets++;
+    }
+    fclose(f);
+  }
+  else
+  {
+    // Most of the feed lands in a handful of two-character
+    // prefixes, which is what made the old prefix-table walk slow.
+    static const char *prefixes[] = { "KD", "KC", "N0", "KB", "KF", "W" };
+
+    srand(1);
+    for (ii = 0; ii < SYNTHETIC_PACKETS; ii++)
+    {
+      int station = rand() % SYNTHETIC_STATIONS;
+
+      snprintf(call, sizeof(call), "%s%d%c%c%c-%d",
+               prefixes[station % 6], station % 10,
+               'A' + (station / 10) % 26, 'A' + (station / 260) % 26,
+               'A' + (station / 6760) % 26, station % 16);
+      lookup_station(call, &found);
+      packets++;
+    }
+  }
+
+  secs = elapsed(&start);
+  printf("%ld packets, %d stations, %ld existing-station lookups\n",
+         packets, station_count, found);
+  printf("%.3f s, %.0f packets/s\n", secs, secs > 0 ? packets / secs : 0.0);
+
+  delete_all_stations();
+  return 0;
+}
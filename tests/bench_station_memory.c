@@ -0,0 +1,124 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 2025-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+
+/*
+ * Per-station memory report for the station database.
+ *
+ * Fills the database with a synthetic population of stations, a
+ * share of which are objects/items or carry PHG/DF extension data the
+ * way an APRS-IS feed does, and reports the bytes held per station
+ * by DataRow and its lazily allocated object/extension blocks.
+ *
+ * Not part of the test suite.  Build with "make bench_station_memory"
+ * and run:
+ *
+ *   ./bench_station_memory [stations] [object-percent] [extension-percent]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tests/test_framework.h"
+
+#include "database.h"
+#include "db_funcs.h"
+
+int search_station_name(DataRow **p_name, char *call, int exact);
+DataRow *add_new_station(DataRow *p_name, DataRow *p_time, char *call);
+void delete_all_stations(void);
+
+extern int station_count;
+
+#define DEFAULT_STATIONS 50000
+
+int main(int argc, char *argv[])
+{
+  char call[MAX_CALLSIGN+1];
+  long stations = DEFAULT_STATIONS;
+  int object_percent = 10;      // Objects and items
+  int extra_percent = 15;       // Stations sending PHG/DF/satellite data
+  long objects = 0;
+  long extras = 0;
+  double bytes;
+  DataRow *p_name;
+  long ii;
+
+  if (argc > 1)
+  {
+    stations = atol(argv[1]);
+  }
+  if (argc > 2)
+  {
+    object_percent = atoi(argv[2]);
+  }
+  if (argc > 3)
+  {
+    extra_percent = atoi(argv[3]);
+  }
+
+  srand(1);
+  for (ii = 0; ii < stations; ii++)
+  {
+    snprintf(call, sizeof(call), "N%ld%c%c%c-%ld",
+             ii % 10, 'A' + (int)((ii / 10) % 26),
+             'A' + (int)((ii / 260) % 26), 'A' + (int)((ii / 6760) % 26),
+             (ii / 175760) % 16);
+
+    if (search_station_name(&p_name, call, 1))
+    {
+      continue;
+    }
+    p_name = add_new_station(p_name, NULL, call);
+    if (p_name == NULL)
+    {
+      continue;
+    }
+
+    if (rand() % 100 < object_percent)
+    {
+      snprintf(get_object_data(p_name)->origin,
+               sizeof(p_name->object_data->origin), "%s", "N0CALL");
+      objects++;
+    }
+    if (rand() % 100 < extra_percent)
+    {
+      snprintf(get_extra_data(p_name)->power_gain,
+               sizeof(p_name->extra_data->power_gain), "%s", "PHG5132");
+      extras++;
+    }
+  }
+
+  bytes = (double)station_count * sizeof(DataRow)
+          + (double)objects * sizeof(ObjectRow)
+          + (double)extras * sizeof(ExtraRow);
+
+  printf("%d stations, %ld with object data, %ld with extension data\n",
+         station_count, objects, extras);
+  printf("DataRow %d bytes, ObjectRow %d bytes, ExtraRow %d bytes\n",
+         (int)sizeof(DataRow), (int)sizeof(ObjectRow), (int)sizeof(ExtraRow));
+  printf("%.0f bytes total, %.1f bytes/station\n",
+         bytes, station_count > 0 ? bytes / station_count : 0.0);
+
+  delete_all_stations();
+  return 0;
+}
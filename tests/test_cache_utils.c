@@ -0,0 +1,139 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 2000-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+
+
+
+
+
+/*
+/*
+ * Tests for the hash and LRU list helpers in cache_utils.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tests/test_framework.h"
+#include "cache_utils.h"
+
+typedef struct
+{
+  lru_link lru;
+  int id;
+} test_entry;
+
+static int lru_order(lru_list *list, const int *expected, int count)
+{
+  lru_link *link;
+  lru_link *prev = NULL;
+  int i = 0;
+
+  for (link = list->head; link; prev = link, link = link->next, i++)
+  {
+    if (i >= count || ((test_entry *)link)->id != expected[i] || link->prev != prev)
+    {
+      return 0;
+    }
+  }
+  return i == count && list->tail == prev;
+}
+
+int test_fnv1a(void)
+{
+  TEST_ASSERT(fnv1a_string(FNV1A_INIT, "") == 0x811c9dc5U, "Empty string");
+  TEST_ASSERT(fnv1a_string(FNV1A_INIT, "a") == 0xe40c292cU, "Reference value for \"a\"");
+  TEST_ASSERT(fnv1a_string(FNV1A_INIT, "foobar") == 0xbf9cf968U, "Reference value for \"foobar\"");
+  TEST_ASSERT(fnv1a_hash(FNV1A_INIT, "foobar", 6) == 0xbf9cf968U, "Bytes hash like the string");
+  TEST_ASSERT(fnv1a_hash(fnv1a_hash(FNV1A_INIT, "foo", 3), "bar", 3) == 0xbf9cf968U,
+              "Hash continues across calls");
+  TEST_ASSERT(fnv1a_hash(fnv1a_string(FNV1A_INIT, "foo"), "\0bar", 4) != 0xbf9cf968U,
+              "Embedded '\\0' counts");
+  TEST_PASS("FNV-1a matches the reference values");
+}
+
+int test_lru(void)
+{
+  lru_list list = { NULL, NULL };
+  test_entry entry[3];
+  int order_push[] = { 2, 1, 0 };
+  int order_use[] = { 0, 2, 1 };
+  int order_drop[] = { 0, 2 };
+  int i;
+
+  memset(entry, 0, sizeof(entry));
+  for (i = 0; i < 3; i++)
+  {
+    entry[i].id = i;
+    lru_push(&list, &entry[i].lru);
+  }
+  TEST_ASSERT(lru_order(&list, order_push, 3), "Newest pushed first");
+  TEST_ASSERT(((test_entry *)list.tail)->id == 0, "Oldest at the tail");
+
+  lru_unlink(&list, &entry[0].lru);
+  lru_push(&list, &entry[0].lru);
+  TEST_ASSERT(lru_order(&list, order_use, 3), "Used entry moves to the head");
+
+  lru_unlink(&list, list.tail);
+  TEST_ASSERT(lru_order(&list, order_drop, 2), "Tail unlinked");
+  TEST_ASSERT(((test_entry *)list.tail)->id == 2, "Tail moves up");
+  TEST_ASSERT(entry[1].lru.prev == NULL && entry[1].lru.next == NULL, "Unlinked entry cleared");
+
+  lru_unlink(&list, &entry[0].lru);
+  lru_unlink(&list, &entry[2].lru);
+  TEST_ASSERT(list.head == NULL && list.tail == NULL, "List empties");
+  TEST_PASS("LRU list keeps the most recently used first");
+}
+
+/* Test runner */
+typedef struct
+{
+  const char *name;
+  int (*func)(void);
+} test_case_t;
+
+int main(int argc, char *argv[])
+{
+  test_case_t tests[] =
+  {
+    {"fnv1a", test_fnv1a},
+    {"lru", test_lru},
+    {NULL, NULL}
+  };
+
+  if (argc < 2)
+  {
+    fprintf(stderr, "Usage: %s <test_name>\n", argv[0]);
+    return 1;
+  }
+
+  for (int i = 0; tests[i].name != NULL; i++)
+  {
+    if (strcmp(argv[1], tests[i].name) == 0)
+    {
+      return tests[i].func();
+    }
+  }
+
+  fprintf(stderr, "Unknown test: %s\n", argv[1]);
+  return 1;
+}
@@ -31,13 +31,49 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <math.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 #include "tests/test_framework.h"
 
+#include "database.h"
+
 /* Forward declarations of functions under test */
 void pad_callsign(char *callsignout, char *callsignin);
 int extract_speed_course(char *info, char *speed, char *course);
 int extract_signpost(char *info, char *signpost);
+int search_station_name(DataRow **p_name, char *call, int exact);
+DataRow *add_new_station(DataRow *p_name, DataRow *p_time, char *call);
+void delete_station_memory(DataRow *p_del);
+void move_station_name(DataRow *p_curr, DataRow *p_name);
+void move_station_time(DataRow *p_curr, DataRow *p_time);
+void delete_all_stations(void);
+void station_grid_update(DataRow *p_station);
+int station_grid_query(long min_lon, long max_lon, long min_lat, long max_lat, int order, DataRow ***list);
+int station_grid_nearest(long lon, long lat, int k, int (*filter)(DataRow *p_station), DataRow **result, double *dist);
+int write_station_snapshot(char *filename);
+int read_station_snapshot(char *filename);
+int store_trail_point(DataRow *p_station, long lon, long lat, time_t sec, char *alt, char *speed, char *course, short stn_flag);
+void add_comment(DataRow *p_station, char *comment_string);
+void add_status(DataRow *p_station, char *status_string);
+int get_weather_record(DataRow *fill);
+ObjectRow *get_object_data(DataRow *fill);
+ExtraRow *get_extra_data(DataRow *fill);
+void msg_input_database(Message *m_fill);
+void mdata_delete_type(const char msg_type, const time_t reference_time);
+long msg_find_data(Message *m_fill);
+void msg_get_data(Message *m_fill, long record_num);
+void mscan_file(char msg_type, void (*function)(Message *));
+
+#define STATION_GRID_ANY_ORDER  0
+#define STATION_GRID_TIME_ORDER 1
+#define STATION_GRID_NAME_ORDER 2
+
+extern DataRow *n_first;
+extern DataRow *t_oldest;
+extern int station_count;
 
 /* Local implementation of substr helper function */
 static void substr(char *dest, char *src, int size)
@@ -639,6 +675,710 @@ int test_extract_signpost_no_close_brace(void)
     TEST_PASS("extract_signpost with missing closing brace");
 }
 
+/* Test cases for the station name index used by search_station_name() */
+
+/* Add a station the same way data_add() does: search for it, then
+ * insert at the returned position if it isn't there yet. */
+static DataRow *add_station_sorted(char *call)
+{
+    DataRow *p_name;
+
+    if (search_station_name(&p_name, call, 1))
+    {
+        return p_name;
+    }
+    return add_new_station(p_name, NULL, call);
+}
+
+/* Lots of stations sharing the same two-character prefix, which is
+ * the case the index is there for. */
+static void make_call(char *call, size_t len, int ii)
+{
+    snprintf(call, len, "KD%d%c%c-%d", ii % 10,
+             'A' + (ii / 10) % 26, 'A' + (ii / 260) % 26, ii / 6760);
+}
+
+static int check_name_order(void)
+{
+    DataRow *p;
+
+    for (p = n_first; p != NULL && p->n_next != NULL; p = p->n_next)
+    {
+        if (strcmp(p->call_sign, p->n_next->call_sign) >= 0)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int test_station_index_exact_lookup(void)
+{
+    char call[MAX_CALLSIGN+1];
+    DataRow *p_name;
+    int ii;
+
+    delete_all_stations();
+    for (ii = 0; ii < 5000; ii++)
+    {
+        make_call(call, sizeof(call), ii);
+        TEST_ASSERT(add_station_sorted(call) != NULL, "Station should be added");
+    }
+    TEST_ASSERT(station_count == 5000, "All stations should be counted");
+    TEST_ASSERT(check_name_order(), "Name list should stay sorted");
+
+    for (ii = 0; ii < 5000; ii++)
+    {
+        make_call(call, sizeof(call), ii);
+        TEST_ASSERT(search_station_name(&p_name, call, 1) == 1, "Station should be found");
+        TEST_ASSERT_STR_EQ(call, p_name->call_sign, "Found station should match");
+    }
+
+    TEST_ASSERT(search_station_name(&p_name, "KD0AA", 1) == 0,
+        "Prefix of a callsign is not an exact match");
+    TEST_ASSERT(p_name != NULL && strcmp("KD0AA", p_name->call_sign) < 0,
+        "Miss should return the insertion point");
+    TEST_ASSERT(search_station_name(&p_name, "KD0AA", 0) == 1,
+        "Inexact search should match the prefix");
+
+    delete_all_stations();
+    TEST_PASS("search_station_name exact lookups through the index");
+}
+
+int test_station_index_delete(void)
+{
+    char call[MAX_CALLSIGN+1];
+    DataRow *p_name;
+    int ii;
+
+    delete_all_stations();
+    for (ii = 0; ii < 3000; ii++)
+    {
+        make_call(call, sizeof(call), ii);
+        add_station_sorted(call);
+    }
+
+    /* Remove every other station, including the ones at the start of
+     * each two-character shortcut segment. */
+    for (ii = 0; ii < 3000; ii += 2)
+    {
+        make_call(call, sizeof(call), ii);
+        TEST_ASSERT(search_station_name(&p_name, call, 1) == 1, "Station should be found before delete");
+        delete_station_memory(p_name);
+    }
+    TEST_ASSERT(station_count == 1500, "Half the stations should remain");
+    TEST_ASSERT(check_name_order(), "Name list should stay sorted");
+
+    for (ii = 0; ii < 3000; ii++)
+    {
+        make_call(call, sizeof(call), ii);
+        TEST_ASSERT(search_station_name(&p_name, call, 1) == (ii & 1),
+            "Only the remaining stations should be found");
+    }
+
+    TEST_ASSERT(search_station_name(&p_name, "KD", 0) == 1, "Prefix search should find a station");
+    TEST_ASSERT(p_name == n_first, "Prefix search should start at the first KD station");
+
+    /* Re-add the deleted ones at their proper positions */
+    for (ii = 0; ii < 3000; ii += 2)
+    {
+        make_call(call, sizeof(call), ii);
+        add_station_sorted(call);
+    }
+    TEST_ASSERT(station_count == 3000, "All stations should be back");
+    TEST_ASSERT(check_name_order(), "Name list should stay sorted");
+
+    delete_all_stations();
+    TEST_PASS("station index survives deletes and re-adds");
+}
+
+int test_station_index_move_name(void)
+{
+    DataRow *p_a, *p_b, *p_c, *p_name;
+
+    delete_all_stations();
+    p_a = add_station_sorted("N0AAA");
+    p_b = add_station_sorted("N0BBB");
+    p_c = add_station_sorted("N0CCC");
+
+    /* Moving a record within the name list doesn't change its key */
+    move_station_name(p_a, NULL);
+    TEST_ASSERT(n_first == p_b, "Moved record should no longer be first");
+    TEST_ASSERT(search_station_name(&p_name, "N0AAA", 1) == 1 && p_name == p_a,
+        "Moved station should still be found");
+    move_station_name(p_a, p_b);
+    TEST_ASSERT(n_first == p_a, "Record should be back at the front");
+    TEST_ASSERT(search_station_name(&p_name, "N0CCC", 1) == 1 && p_name == p_c,
+        "Other stations should still be found");
+
+    delete_all_stations();
+    TEST_ASSERT(search_station_name(&p_name, "N0BBB", 1) == 0,
+        "Nothing should be found after delete_all_stations");
+    TEST_ASSERT(station_count == 0, "Station count should be zero");
+
+    TEST_PASS("station index with move_station_name and delete_all_stations");
+}
+
+/* Test cases for the spatial index used by display_file() and
+ * Station_info() */
+
+/* Spread stations over a few degrees around 47N 122W, with some
+ * piled up on one spot. */
+static void place_station(DataRow *p, int ii, int seed)
+{
+    unsigned int r = (unsigned int)(ii * 2654435761u + seed * 40503u);
+
+    p->coord_lon = 20880000l + (long)(r % 1440000);
+    p->coord_lat = 15480000l + (long)((r >> 8) % 1080000);
+    if (ii % 50 == 0)
+    {
+        p->coord_lon = 21000000l;
+        p->coord_lat = 16000000l;
+    }
+    station_grid_update(p);
+}
+
+/* Compare a query against a walk of the whole name list */
+static int check_grid_query(long min_lon, long max_lon, long min_lat, long max_lat)
+{
+    DataRow **list;
+    DataRow *p;
+    int count, expected = 0, ii;
+
+    count = station_grid_query(min_lon, max_lon, min_lat, max_lat,
+                               STATION_GRID_NAME_ORDER, &list);
+    for (p = n_first; p != NULL; p = p->n_next)
+    {
+        if (p->coord_lon >= min_lon && p->coord_lon <= max_lon
+            && p->coord_lat >= min_lat && p->coord_lat <= max_lat
+            && !(p->coord_lat == 0 && p->coord_lon == 0))
+        {
+            if (expected >= count || list[expected] != p)
+            {
+                return 0;
+            }
+            expected++;
+        }
+    }
+    for (ii = 0; ii < count; ii++)
+    {
+        if (list[ii]->coord_lon < min_lon || list[ii]->coord_lon > max_lon
+            || list[ii]->coord_lat < min_lat || list[ii]->coord_lat > max_lat)
+        {
+            return 0;
+        }
+    }
+    return count == expected;
+}
+
+int test_station_grid_query(void)
+{
+    char call[MAX_CALLSIGN+1];
+    DataRow *p_name;
+    int ii;
+
+    delete_all_stations();
+    for (ii = 0; ii < 3000; ii++)
+    {
+        make_call(call, sizeof(call), ii);
+        place_station(add_station_sorted(call), ii, 1);
+    }
+    /* One at the undefined position, which is never returned */
+    add_station_sorted("N0POS");
+
+    TEST_ASSERT(check_grid_query(21000000l, 21000000l, 16000000l, 16000000l),
+        "Single point query should match a full scan");
+    TEST_ASSERT(check_grid_query(20900000l, 21100000l, 15900000l, 16100000l),
+        "Small area query should match a full scan");
+    TEST_ASSERT(check_grid_query(20000000l, 23000000l, 15000000l, 17000000l),
+        "Large area query should match a full scan");
+    TEST_ASSERT(check_grid_query(-100000l, 100000l, -100000l, 100000l),
+        "Query around the undefined position should match a full scan");
+
+    /* Move everybody, then delete every other station */
+    for (ii = 0; ii < 3000; ii++)
+    {
+        make_call(call, sizeof(call), ii);
+        search_station_name(&p_name, call, 1);
+        place_station(p_name, ii, 2);
+    }
+    TEST_ASSERT(check_grid_query(20900000l, 21100000l, 15900000l, 16100000l),
+        "Query after moves should match a full scan");
+    for (ii = 0; ii < 3000; ii += 2)
+    {
+        make_call(call, sizeof(call), ii);
+        search_station_name(&p_name, call, 1);
+        delete_station_memory(p_name);
+    }
+    TEST_ASSERT(check_grid_query(20900000l, 21100000l, 15900000l, 16100000l),
+        "Query after deletes should match a full scan");
+
+    delete_all_stations();
+    TEST_PASS("station_grid_query matches a full scan");
+}
+
+static int check_time_order(DataRow **list, int count)
+{
+    int ii;
+
+    for (ii = 1; ii < count; ii++)
+    {
+        if (list[ii-1]->sec_heard > list[ii]->sec_heard
+            || (list[ii-1]->sec_heard == list[ii]->sec_heard
+                && list[ii-1]->time_sn >= list[ii]->time_sn))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int test_station_grid_time_order(void)
+{
+    char call[MAX_CALLSIGN+1];
+    DataRow **list;
+    DataRow *p;
+    int count, ii;
+
+    delete_all_stations();
+    for (ii = 0; ii < 500; ii++)
+    {
+        make_call(call, sizeof(call), ii);
+        p = add_station_sorted(call);
+        /* Heard now: it becomes the newest, the way data_add() does it */
+        p->sec_heard = 1000 + ii / 3;
+        p->time_sn = ii % 3;
+        move_station_time(p, NULL);
+        place_station(p, ii, 3);
+    }
+
+    /* Covers more cells than there are stations, so walks the list */
+    count = station_grid_query(20880000l, 22320000l, 15480000l, 16560000l,
+                               STATION_GRID_TIME_ORDER, &list);
+    TEST_ASSERT(count == 500, "All stations should be in the large area");
+    TEST_ASSERT(check_time_order(list, count), "Large area should come back oldest first");
+
+    /* Uses the index and sorts the result */
+    count = station_grid_query(20950000l, 21050000l, 15950000l, 16050000l,
+                               STATION_GRID_TIME_ORDER, &list);
+    TEST_ASSERT(count >= 10, "The stations piled on one spot should be found");
+    TEST_ASSERT(check_time_order(list, count), "Small area should come back oldest first");
+
+    delete_all_stations();
+    count = station_grid_query(20880000l, 22320000l, 15480000l, 16560000l,
+                               STATION_GRID_TIME_ORDER, &list);
+    TEST_ASSERT(count == 0, "Nothing should be found after delete_all_stations");
+
+    TEST_PASS("station_grid_query returns stations in time order");
+}
+
+/* Brute force distance with the same flat-earth metric */
+static double grid_test_dist(DataRow *p, long lon, long lat)
+{
+    double scale = cos((90.0 - lat / 360000.0) * M_PI / 180.0);
+    double dx = (double)(p->coord_lon - lon) * scale;
+    double dy = (double)(p->coord_lat - lat);
+
+    return sqrt(dx*dx + dy*dy);
+}
+
+static int odd_station_filter(DataRow *p)
+{
+    return (p->call_sign[2] - '0') & 1;
+}
+
+/* Check the k nearest against sorting everything by distance */
+static int check_grid_nearest(long lon, long lat, int k, int (*filter)(DataRow *))
+{
+    DataRow *result[64];
+    double dist[64];
+    DataRow *p;
+    int found, total, closer, ii;
+
+    found = station_grid_nearest(lon, lat, k, filter, result, dist);
+    for (ii = 0; ii < found; ii++)
+    {
+        if (filter != NULL && !filter(result[ii]))
+        {
+            return 0;
+        }
+        if (ii > 0 && dist[ii] < dist[ii-1])
+        {
+            return 0;
+        }
+        if (fabs(dist[ii] - grid_test_dist(result[ii], lon, lat)) > 0.5)
+        {
+            return 0;
+        }
+    }
+
+    /* Nothing left out may be closer than the farthest found, and we
+     * must have found k if there are that many */
+    total = 0;
+    closer = 0;
+    for (p = n_first; p != NULL; p = p->n_next)
+    {
+        if ((p->coord_lat == 0 && p->coord_lon == 0) || (filter != NULL && !filter(p)))
+        {
+            continue;
+        }
+        total++;
+        if (found > 0 && grid_test_dist(p, lon, lat) < dist[found-1] - 0.5)
+        {
+            closer++;
+        }
+    }
+    return found == (total < k ? total : k) && (found == 0 || closer < found);
+}
+
+int test_station_grid_nearest(void)
+{
+    char call[MAX_CALLSIGN+1];
+    DataRow *result[4];
+    int ii;
+
+    delete_all_stations();
+    TEST_ASSERT(station_grid_nearest(21000000l, 16000000l, 4, NULL, result, NULL) == 0,
+        "Nothing should be found in an empty database");
+
+    for (ii = 0; ii < 3000; ii++)
+    {
+        make_call(call, sizeof(call), ii);
+        place_station(add_station_sorted(call), ii, 4);
+    }
+
+    TEST_ASSERT(check_grid_nearest(21000000l, 16000000l, 1, NULL),
+        "Nearest to the pile-up should match a full scan");
+    TEST_ASSERT(check_grid_nearest(21500000l, 15900000l, 10, NULL),
+        "10 nearest should match a full scan");
+    TEST_ASSERT(check_grid_nearest(21500000l, 15900000l, 64, odd_station_filter),
+        "64 nearest with a filter should match a full scan");
+    TEST_ASSERT(check_grid_nearest(40000000l, 30000000l, 5, NULL),
+        "Nearest to a far away spot should match a full scan");
+    TEST_ASSERT(check_grid_nearest(20880000l, 15480000l, 20, NULL),
+        "Nearest to a corner should match a full scan");
+
+    /* A handful of stations spread over the world */
+    delete_all_stations();
+    for (ii = 0; ii < 20; ii++)
+    {
+        make_call(call, sizeof(call), ii);
+        place_station(add_station_sorted(call), ii, 5);
+        search_station_name(&result[0], call, 1);
+        result[0]->coord_lon = 1000000l + ii * 6000000l;
+        result[0]->coord_lat = 3000000l + ii * 3000000l;
+        station_grid_update(result[0]);
+    }
+    TEST_ASSERT(check_grid_nearest(64800000l, 32400000l, 3, NULL),
+        "Nearest among sparse stations should match a full scan");
+    TEST_ASSERT(check_grid_nearest(64800000l, 32400000l, 40, NULL),
+        "Asking for more than there are should return them all");
+
+    delete_all_stations();
+    TEST_PASS("station_grid_nearest matches a full scan");
+}
+
+/* Test cases for the station snapshot written at shutdown and read
+ * back at startup */
+
+#define SNAPSHOT_TEST_FILE "/tmp/xastir_test_stations.snapshot"
+#define SNAPSHOT_TEST_COUNT 2000
+
+/* Give station ii a bit of everything a station can carry */
+static void fill_snapshot_station(DataRow *p, int ii)
+{
+    char text[64];
+    int jj;
+
+    place_station(p, ii, 6);
+    /* Heard in another order than the names sort in */
+    p->sec_heard = 100000 + (ii * 7919) % SNAPSHOT_TEST_COUNT;
+    p->time_sn = ii;
+    move_station_time(p, NULL);
+    p->flag = ST_ACTIVE;
+    snprintf(p->altitude, sizeof(p->altitude), "%d", ii);
+
+    snprintf(text, sizeof(text), "WIDE%d-%d", ii % 3, ii % 2);
+    p->node_path_ptr = strdup(text);
+    if (ii % 4 == 0)
+    {
+        p->tactical_call_sign = calloc(MAX_TACTICAL_CALL + 1, 1);
+        snprintf(p->tactical_call_sign, MAX_TACTICAL_CALL + 1, "TAC%d", ii);
+    }
+    if (ii % 5 == 0)
+    {
+        get_weather_record(p);
+        snprintf(p->weather_data->wx_temp, sizeof(p->weather_data->wx_temp), "%d", ii % 100);
+    }
+    if (ii % 6 == 0)
+    {
+        get_object_data(p)->signpost[0] = 'A' + ii % 26;
+        get_extra_data(p)->power_gain[0] = 'P';
+    }
+    if (ii % 3 == 0)
+    {
+        for (jj = 0; jj < ii % 50 + 1; jj++)
+        {
+            store_trail_point(p, p->coord_lon + jj * 100, p->coord_lat - jj * 37,
+                              100000 + jj, "", "", "", 0);
+        }
+    }
+    if (ii % 2 == 0)
+    {
+        snprintf(text, sizeof(text), "comment %d", ii);
+        add_comment(p, text);
+        snprintf(text, sizeof(text), "status %d", ii);
+        add_status(p, text);
+    }
+}
+
+static int check_snapshot_station(DataRow *p, int ii)
+{
+    char text[64];
+    TrailCursor cursor;
+    int jj = 0;
+
+    if (p->sec_heard != 100000 + (ii * 7919) % SNAPSHOT_TEST_COUNT || p->time_sn != ii)
+    {
+        return 0;
+    }
+    if (atoi(p->altitude) != ii)
+    {
+        return 0;
+    }
+    snprintf(text, sizeof(text), "WIDE%d-%d", ii % 3, ii % 2);
+    if (p->node_path_ptr == NULL || strcmp(p->node_path_ptr, text) != 0)
+    {
+        return 0;
+    }
+    snprintf(text, sizeof(text), "TAC%d", ii);
+    if ((ii % 4 == 0) != (p->tactical_call_sign != NULL)
+        || (p->tactical_call_sign != NULL && strcmp(p->tactical_call_sign, text) != 0))
+    {
+        return 0;
+    }
+    if ((ii % 5 == 0) != (p->weather_data != NULL)
+        || (p->weather_data != NULL && atoi(p->weather_data->wx_temp) != ii % 100))
+    {
+        return 0;
+    }
+    if ((ii % 6 == 0) != (p->object_data != NULL && p->extra_data != NULL)
+        || (p->object_data != NULL && p->object_data->signpost[0] != 'A' + ii % 26))
+    {
+        return 0;
+    }
+    if ((ii % 3 == 0) != (p->trail != NULL))
+    {
+        return 0;
+    }
+    if (p->trail != NULL)
+    {
+        if (p->trail->count != ii % 50 + 1)
+        {
+            return 0;
+        }
+        if (!trail_first(p->trail, &cursor))
+        {
+            return 0;
+        }
+        do
+        {
+            if (cursor.point.trail_long_pos != p->coord_lon + jj * 100
+                || cursor.point.trail_lat_pos != p->coord_lat - jj * 37
+                || cursor.point.sec != 100000 + jj)
+            {
+                return 0;
+            }
+            jj++;
+        } while (trail_next(&cursor));
+        if (jj != ii % 50 + 1)
+        {
+            return 0;
+        }
+    }
+    if ((ii % 2 == 0) != (p->comment_data != NULL && p->status_data != NULL))
+    {
+        return 0;
+    }
+    if (p->comment_data != NULL)
+    {
+        snprintf(text, sizeof(text), "comment %d", ii);
+        if (strcmp(p->comment_data->text_ptr, text) != 0 || p->comment_data->next != NULL)
+        {
+            return 0;
+        }
+        snprintf(text, sizeof(text), "status %d", ii);
+        if (strcmp(p->status_data->text_ptr, text) != 0)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* test_station_snapshot() adds station (ii * 7) % SNAPSHOT_TEST_COUNT
+ * as the ii'th newest */
+static int check_snapshot_time_order(void)
+{
+    char call[MAX_CALLSIGN+1];
+    DataRow *p;
+    int count = 0;
+
+    for (p = t_oldest; p != NULL; p = p->t_newer)
+    {
+        make_call(call, sizeof(call), (count * 7) % SNAPSHOT_TEST_COUNT);
+        if (strcmp(p->call_sign, call) != 0
+            || (p->t_newer != NULL && p->t_newer->t_older != p))
+        {
+            return 0;
+        }
+        count++;
+    }
+    return count == station_count;
+}
+
+static int message_count;
+static int message_order;
+static char message_last[MAX_CALLSIGN+1];
+
+/* Counts the active messages and checks they come in index order */
+static void count_message(Message *m)
+{
+    if (strcmp(message_last, m->call_sign) > 0)
+    {
+        message_order = 0;
+    }
+    snprintf(message_last, sizeof(message_last), "%s", m->call_sign);
+    message_count++;
+}
+
+static int active_messages(void)
+{
+    message_count = 0;
+    message_order = 1;
+    message_last[0] = '\0';
+    mscan_file('\0', count_message);
+    return message_order ? message_count : -1;
+}
+
+int test_station_snapshot(void)
+{
+    char call[MAX_CALLSIGN+1];
+    Message message;
+    DataRow *list[4];
+    DataRow *p_name;
+    long record;
+    int ii;
+
+    delete_all_stations();
+    unlink(SNAPSHOT_TEST_FILE);
+    for (ii = 0; ii < SNAPSHOT_TEST_COUNT; ii++)
+    {
+        make_call(call, sizeof(call), (ii * 7) % SNAPSHOT_TEST_COUNT);
+        p_name = add_station_sorted(call);
+        fill_snapshot_station(p_name, (ii * 7) % SNAPSHOT_TEST_COUNT);
+    }
+    for (ii = 0; ii < 30; ii++)
+    {
+        memset(&message, 0, sizeof(message));
+        message.active = RECORD_ACTIVE;
+        message.type = MESSAGE_MESSAGE;
+        message.sec_heard = 100000 + ii;
+        snprintf(message.call_sign, sizeof(message.call_sign), "KD%d", ii % 7);
+        snprintf(message.from_call_sign, sizeof(message.from_call_sign), "N0%d", ii);
+        snprintf(message.seq, sizeof(message.seq), "%d", ii);
+        snprintf(message.message_line, sizeof(message.message_line), "message %d", ii);
+        msg_input_database(&message);
+    }
+
+    TEST_ASSERT(check_snapshot_time_order(), "Time order should be as added");
+    TEST_ASSERT(write_station_snapshot(SNAPSHOT_TEST_FILE) == 1, "Snapshot should be written");
+    delete_all_stations();
+    mdata_delete_type('\0', 200000);
+    TEST_ASSERT(n_first == NULL && active_messages() == 0, "Database should be empty");
+
+    TEST_ASSERT(read_station_snapshot(SNAPSHOT_TEST_FILE) == SNAPSHOT_TEST_COUNT,
+        "All stations should be restored");
+    TEST_ASSERT(station_count == SNAPSHOT_TEST_COUNT, "Station count should be restored");
+    TEST_ASSERT(check_name_order(), "Name order should be restored");
+    TEST_ASSERT(check_snapshot_time_order(), "Time order should be restored");
+    for (ii = 0; ii < SNAPSHOT_TEST_COUNT; ii++)
+    {
+        make_call(call, sizeof(call), ii);
+        TEST_ASSERT(search_station_name(&p_name, call, 1), "Restored station should be found");
+        TEST_ASSERT(check_snapshot_station(p_name, ii), "Restored station should match");
+    }
+    TEST_ASSERT(check_grid_query(20900000l, 21100000l, 15900000l, 16100000l),
+        "Spatial index should be restored");
+    TEST_ASSERT(station_grid_nearest(21000000l, 16000000l, 4, NULL, list, NULL) == 4,
+        "Nearest stations should be found");
+
+    TEST_ASSERT(active_messages() == 30, "Messages should be restored in index order");
+    snprintf(message.call_sign, sizeof(message.call_sign), "KD%d", 12 % 7);
+    snprintf(message.from_call_sign, sizeof(message.from_call_sign), "N0%d", 12);
+    snprintf(message.seq, sizeof(message.seq), "%d", 12);
+    record = msg_find_data(&message);
+    TEST_ASSERT(record >= 0, "Restored message should be found");
+    msg_get_data(&message, record);
+    TEST_ASSERT(strcmp(message.message_line, "message 12") == 0 && message.sec_heard == 100012,
+        "Restored message should match");
+
+    TEST_ASSERT(read_station_snapshot(SNAPSHOT_TEST_FILE) == 0,
+        "Snapshot shouldn't be loaded over existing stations");
+    TEST_ASSERT(station_count == SNAPSHOT_TEST_COUNT, "Stations should be left alone");
+
+    delete_all_stations();
+    unlink(SNAPSHOT_TEST_FILE);
+    TEST_PASS("stations and messages are restored from a snapshot");
+}
+
+int test_station_snapshot_damaged(void)
+{
+    char call[MAX_CALLSIGN+1];
+    struct stat sb;
+    FILE *f;
+    uint32_t version = 9999;
+    int ii;
+
+    delete_all_stations();
+    TEST_ASSERT(read_station_snapshot(SNAPSHOT_TEST_FILE ".none") == 0,
+        "Missing snapshot should load nothing");
+
+    for (ii = 0; ii < 100; ii++)
+    {
+        make_call(call, sizeof(call), ii);
+        fill_snapshot_station(add_station_sorted(call), ii);
+    }
+    TEST_ASSERT(write_station_snapshot(SNAPSHOT_TEST_FILE) == 1, "Snapshot should be written");
+    delete_all_stations();
+
+    /* Cut short in the middle of the stations */
+    TEST_ASSERT(stat(SNAPSHOT_TEST_FILE, &sb) == 0, "Snapshot should exist");
+    TEST_ASSERT(truncate(SNAPSHOT_TEST_FILE, sb.st_size / 2) == 0, "Snapshot truncated");
+    TEST_ASSERT(read_station_snapshot(SNAPSHOT_TEST_FILE) == 0, "Truncated snapshot shouldn't load");
+    TEST_ASSERT(n_first == NULL && t_oldest == NULL && station_count == 0,
+        "Truncated snapshot should leave no stations");
+
+    /* From another version */
+    for (ii = 0; ii < 10; ii++)
+    {
+        make_call(call, sizeof(call), ii);
+        fill_snapshot_station(add_station_sorted(call), ii);
+    }
+    TEST_ASSERT(write_station_snapshot(SNAPSHOT_TEST_FILE) == 1, "Snapshot should be written");
+    delete_all_stations();
+    f = fopen(SNAPSHOT_TEST_FILE, "r+");
+    TEST_ASSERT(f != NULL, "Snapshot opened");
+    fseek(f, sizeof(uint32_t), SEEK_SET);
+    fwrite(&version, sizeof(version), 1, f);
+    fclose(f);
+    TEST_ASSERT(read_station_snapshot(SNAPSHOT_TEST_FILE) == 0, "Other version shouldn't load");
+    TEST_ASSERT(n_first == NULL && station_count == 0, "Other version should leave no stations");
+
+    unlink(SNAPSHOT_TEST_FILE);
+    TEST_PASS("a damaged snapshot is refused");
+}
+
 /* Test runner */
 typedef struct {
     const char *name;
@@ -691,6 +1431,16 @@ int main(int argc, char *argv[])
         {"extract_signpost_no_signpost", test_extract_signpost_no_signpost},
         {"extract_signpost_too_long", test_extract_signpost_too_long},
         {"extract_signpost_no_close_brace", test_extract_signpost_no_close_brace},
+        /* station index tests */
+        {"station_index_exact_lookup", test_station_index_exact_lookup},
+        {"station_index_delete", test_station_index_delete},
+        {"station_index_move_name", test_station_index_move_name},
+        /* spatial index tests */
+        {"station_grid_query", test_station_grid_query},
+        {"station_grid_time_order", test_station_grid_time_order},
+        {"station_grid_nearest", test_station_grid_nearest},
+        {"station_snapshot", test_station_snapshot},
+        {"station_snapshot_damaged", test_station_snapshot_damaged},
         {NULL, NULL}
     };
 
@@ -30,6 +30,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include "tests/test_framework.h"
 
@@ -98,7 +99,6 @@ STUB_IMPL(filecreate)
 STUB_IMPL(fill_in_new_alert_entries)
 STUB_IMPL(get_iso_datetime)
 STUB_IMPL(get_send_message_path)
-STUB_IMPL(get_tactical_from_hash)
 STUB_IMPL(get_time)
 STUB_IMPL(get_timestamp)
 STUB_IMPL(get_user_base_dir)
@@ -120,12 +120,9 @@ STUB_IMPL(popup_message)
 STUB_IMPL(popup_message_always)
 STUB_IMPL(port_write_string)
 STUB_IMPL(position_defined)
-STUB_IMPL(remove_leading_spaces)
 STUB_IMPL(remove_trailing_asterisk)
-STUB_IMPL(remove_trailing_spaces)
 STUB_IMPL(SayText)
 STUB_IMPL(spell_it_out)
-STUB_IMPL(sec_now)
 STUB_IMPL(send_agwpe_packet)
 STUB_IMPL(send_ax25_frame)
 STUB_IMPL(stations_types)
@@ -151,6 +148,39 @@ char *to_upper(char *data)
     return data;
 }
 
+time_t sec_now(void)
+{
+    return time(NULL);
+}
+
+char *remove_trailing_spaces(char *data)
+{
+    /* Used by add_comment() and add_status() */
+    int len = strlen(data);
+
+    while (len > 0 && data[len - 1] == ' ')
+    {
+        data[--len] = '\0';
+    }
+    return data;
+}
+
+char *remove_leading_spaces(char *data)
+{
+    /* Used by add_status() */
+    int skip = strspn(data, " ");
+
+    memmove(data, data + skip, strlen(data + skip) + 1);
+    return data;
+}
+
+char *get_tactical_from_hash(char *callsign)
+{
+    /* No tactical calls assigned in the unit tests */
+    (void)callsign;
+    return NULL;
+}
+
 
 /* Widget and display related globals */
 void *Display_ = NULL;
@@ -0,0 +1,289 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 2025-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+
+
+/*
+ * Tests for predecode_ax25_line(), the part of decode_ax25_line()
+ * that the decode thread runs off the main thread, and for
+ * decode_ax25_packet() giving the same stations with or without it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tests/test_framework.h"
+
+#include "database.h"
+
+/* Forward declarations of functions under test */
+void predecode_ax25_line(char *line, ax25_packet *packet);
+int decode_ax25_packet(ax25_packet *packet, char from, int port, int dbadd);
+int search_station_name(DataRow **p_name, char *call, int exact);
+
+extern int defer_station_drawing;
+
+/* Decode "<call><rest>" into the station database, with the info
+ * field parsed ahead as the decode thread does, or with the parse
+ * results thrown away so that data_add() parses it again. */
+static DataRow *decode_as(char *call, const char *rest, int parsed)
+{
+  char line[MAX_AX25_LINE];
+  ax25_packet packet;
+  DataRow *p_station = NULL;
+
+  snprintf(line, sizeof(line), "%s%s", call, rest);
+  predecode_ax25_line(line, &packet);
+  if (!parsed)
+  {
+    packet.parsed.mic_e = -1;
+    packet.parsed.position = -1;
+    packet.parsed.weather = -1;
+  }
+  defer_station_drawing = 1;
+  decode_ax25_packet(&packet, 'F', -1, 1);
+  if (!search_station_name(&p_station, call, 1))
+  {
+    return NULL;
+  }
+  return p_station;
+}
+
+/* Nonzero if the two records got the same position, symbol and
+ * weather, and the same text was left over for the comment. */
+static int same_station(DataRow *a, DataRow *b)
+{
+  if (a == NULL || b == NULL)
+  {
+    return 0;
+  }
+  if (a->coord_lat != b->coord_lat || a->coord_lon != b->coord_lon
+      || a->pos_amb != b->pos_amb
+      || a->aprs_symbol.aprs_type != b->aprs_symbol.aprs_type
+      || a->aprs_symbol.aprs_symbol != b->aprs_symbol.aprs_symbol
+      || a->aprs_symbol.special_overlay != b->aprs_symbol.special_overlay
+      || strcmp(a->speed, b->speed) != 0
+      || strcmp(a->course, b->course) != 0
+      || strcmp(a->altitude, b->altitude) != 0)
+  {
+    return 0;
+  }
+  if ((a->weather_data == NULL) != (b->weather_data == NULL))
+  {
+    return 0;
+  }
+  if (a->weather_data != NULL
+      && (strcmp(a->weather_data->wx_speed, b->weather_data->wx_speed) != 0
+          || strcmp(a->weather_data->wx_course, b->weather_data->wx_course) != 0
+          || strcmp(a->weather_data->wx_gust, b->weather_data->wx_gust) != 0
+          || strcmp(a->weather_data->wx_temp, b->weather_data->wx_temp) != 0
+          || strcmp(a->weather_data->wx_rain, b->weather_data->wx_rain) != 0
+          || strcmp(a->weather_data->wx_hum, b->weather_data->wx_hum) != 0
+          || strcmp(a->weather_data->wx_baro, b->weather_data->wx_baro) != 0))
+  {
+    return 0;
+  }
+  if ((a->comment_data == NULL) != (b->comment_data == NULL))
+  {
+    return 0;
+  }
+  if (a->comment_data != NULL
+      && strcmp(a->comment_data->text_ptr, b->comment_data->text_ptr) != 0)
+  {
+    return 0;
+  }
+  return 1;
+}
+
+/* Test cases */
+
+int test_predecode_position(void)
+{
+  char line[] = "N0CALL>APRS,WIDE1-1:!4903.50N/07201.75W-Test";
+  ax25_packet packet;
+
+  predecode_ax25_line(line, &packet);
+  TEST_ASSERT(packet.path_ok && packet.call_ok && packet.ok, "Packet should be valid");
+  TEST_ASSERT(!packet.third_party, "Not third-party");
+  TEST_ASSERT_STR_EQ("N0CALL", packet.call, "Station call");
+  TEST_ASSERT_STR_EQ("N0CALL", packet.call_sign, "Source call");
+  TEST_ASSERT_STR_EQ("APRS,WIDE1-1", packet.decode_path, "Path");
+  TEST_ASSERT_STR_EQ("!4903.50N/07201.75W-Test", packet.info, "Info field");
+  TEST_ASSERT_STR_EQ("!4903.50N/07201.75W-Test", packet.info_copy, "Info copy");
+  TEST_ASSERT_STR_EQ("N0CALL>APRS,WIDE1-1:!4903.50N/07201.75W-Test", line, "Line left alone");
+  TEST_PASS("predecode of a position packet");
+}
+
+int test_predecode_third_party(void)
+{
+  char line[] = "N0CALL>APRS:}W1AW>APRS,TCPIP,N0CALL*:>Status";
+  ax25_packet packet;
+
+  predecode_ax25_line(line, &packet);
+  TEST_ASSERT(packet.ok, "Packet should be valid");
+  TEST_ASSERT(packet.third_party, "Third-party");
+  TEST_ASSERT_STR_EQ("W1AW", packet.call, "Inner call");
+  TEST_ASSERT_STR_EQ("N0CALL", packet.call_sign, "Outer call");
+  TEST_ASSERT_STR_EQ("APRS", packet.path, "Outer path");
+  TEST_ASSERT_STR_EQ(">Status", packet.info, "Inner info field");
+  TEST_ASSERT_STR_EQ("}W1AW>APRS,TCPIP,N0CALL*:>Status", packet.info_copy, "Info copy");
+  TEST_PASS("predecode of third-party traffic");
+}
+
+int test_predecode_object(void)
+{
+  char line[] = "N0CALL>APRS:;OBJECT   *111111z4903.50N/07201.75W-";
+  ax25_packet packet;
+
+  predecode_ax25_line(line, &packet);
+  TEST_ASSERT(packet.ok, "Packet should be valid");
+  TEST_ASSERT_STR_EQ("OBJECT", packet.call, "Object name");
+  TEST_ASSERT_STR_EQ("N0CALL", packet.origin, "Object origin");
+  TEST_ASSERT_STR_EQ("*111111z4903.50N/07201.75W-", packet.info, "Object info field");
+  TEST_PASS("predecode of an object");
+}
+
+int test_predecode_parsed(void)
+{
+  char position[] = "N0CALL>APRS:!4903.50N/07201.75W-Test";
+  char weather[] = "N0CALL>APRS:_10090556c220s004g005t077r000p000P000h50b09900wRSW";
+  char mic_e[] = "N0CALL>S32U6T:`(_fn\"Oj/]Comment";
+  char status[] = "N0CALL>APRS:>Status";
+  ax25_packet packet;
+
+  predecode_ax25_line(position, &packet);
+  TEST_ASSERT(packet.parsed.position == 1, "Position parsed");
+  TEST_ASSERT(packet.parsed.aprs_type == '/' && packet.parsed.aprs_symbol == '-', "Symbol");
+  TEST_ASSERT(packet.parsed.skip == 19, "Position length");
+  TEST_ASSERT_STR_EQ("Test", packet.parsed.pos_after + packet.parsed.skip, "Text after the position");
+  TEST_ASSERT(packet.parsed.weather == 0, "No weather");
+
+  predecode_ax25_line(weather, &packet);
+  TEST_ASSERT(packet.parsed.position == -1, "Positionless");
+  TEST_ASSERT(packet.parsed.weather == 1, "Weather parsed");
+  TEST_ASSERT_STR_EQ("077", packet.parsed.wx.wx_temp, "Temperature");
+  TEST_ASSERT_STR_EQ("220", packet.parsed.wx.wx_course, "Wind direction");
+  TEST_ASSERT_STR_EQ("wRSW", packet.parsed.wx_after, "Text after the weather");
+
+  predecode_ax25_line(mic_e, &packet);
+  TEST_ASSERT(packet.parsed.mic_e == 1, "Mic-E expanded");
+  TEST_ASSERT(packet.parsed.position == 1, "Mic-E position parsed");
+  TEST_ASSERT(packet.parsed.aprs_symbol == 'j', "Mic-E symbol");
+
+  predecode_ax25_line(status, &packet);
+  TEST_ASSERT(packet.parsed.mic_e == -1 && packet.parsed.position == -1
+              && packet.parsed.weather == -1, "Nothing to parse in a status");
+
+  TEST_PASS("predecode parses positions and weather");
+}
+
+int test_predecode_same_station(void)
+{
+  static const char *infos[] =
+  {
+    ">APRS:!4903.50N/07201.75W-Test",
+    ">APRS:=49  .  N/072  .  W-Ambiguous",
+    ">APRS:!4903.50N/07201.75W-DAO !W52!",
+    ">APRS:!/5L!!<*e7>7P[Compressed",
+    ">APRS:@092345z4903.50N/07201.75W_220/004g005t077r000p000P000h50b09900wRSW",
+    ">APRS:=/5L!!<*e7_7P[g005t077r000p000P000h50b09900",
+    ">APRS:_10090556c220s004g005t077r000p000P000h50b09900wRSW",
+    ">S32U6T:`(_fn\"Oj/]Comment",
+    ">APRS:[FN42ab]Grid",
+    NULL
+  };
+  char inline_call[16];
+  char parsed_call[16];
+  int ii;
+
+  for (ii = 0; infos[ii] != NULL; ii++)
+  {
+    snprintf(inline_call, sizeof(inline_call), "N%dA", ii);
+    snprintf(parsed_call, sizeof(parsed_call), "N%dB", ii);
+    if (!same_station(decode_as(inline_call, infos[ii], 0),
+                      decode_as(parsed_call, infos[ii], 1)))
+    {
+      fprintf(stderr, "Different stations for %s\n", infos[ii]);
+      return 1;
+    }
+  }
+  TEST_PASS("same station with or without the parse ahead");
+}
+
+int test_predecode_invalid(void)
+{
+  char no_info[] = "N0CALL>APRS";
+  char bad_call[] = "N0CALL-TOOLONG>APRS:>Status";
+  char long_line[MAX_AX25_LINE + 20];
+  ax25_packet packet;
+
+  predecode_ax25_line(no_info, &packet);
+  TEST_ASSERT(!packet.path_ok && !packet.call_ok && !packet.ok, "Missing info field");
+
+  predecode_ax25_line(bad_call, &packet);
+  TEST_ASSERT(packet.path_ok && !packet.call_ok && !packet.ok, "Invalid callsign");
+
+  memset(long_line, 'A', sizeof(long_line) - 1);
+  long_line[sizeof(long_line) - 1] = '\0';
+  predecode_ax25_line(long_line, &packet);
+  TEST_ASSERT(!packet.path_ok && packet.backup[0] == '\0', "Overly long line");
+
+  TEST_PASS("predecode of invalid packets");
+}
+
+/* Test runner */
+typedef struct
+{
+  const char *name;
+  int (*func)(void);
+} test_case_t;
+
+int main(int argc, char *argv[])
+{
+  test_case_t tests[] =
+  {
+    {"predecode_position", test_predecode_position},
+    {"predecode_third_party", test_predecode_third_party},
+    {"predecode_object", test_predecode_object},
+    {"predecode_invalid", test_predecode_invalid},
+    {"predecode_parsed", test_predecode_parsed},
+    {"predecode_same_station", test_predecode_same_station},
+    {NULL, NULL}
+  };
+
+  if (argc < 2)
+  {
+    fprintf(stderr, "Usage: %s <test_name>\n", argv[0]);
+    return 1;
+  }
+
+  for (int i = 0; tests[i].name != NULL; i++)
+  {
+    if (strcmp(argv[1], tests[i].name) == 0)
+    {
+      return tests[i].func();
+    }
+  }
+
+  fprintf(stderr, "Unknown test: %s\n", argv[1]);
+  return 1;
+}
@@ -0,0 +1,130 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 2025-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+
+
+/*
+ * Tests for the igate dupe-checking sets in igate_utils.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "tests/test_framework.h"
+#include "igate_utils.h"
+
+/* Test cases */
+
+int test_digest_ignores_path(void)
+{
+  char via_rf[] = "}W1AW>APRS,WIDE1-1,WIDE2-1:!4903.50N/07201.75W-";
+  char via_net[] = "}W1AW>APRS,TCPIP*,qAC,T2TEST:!4903.50N/07201.75W-";
+  char other_info[] = "}W1AW>APRS,TCPIP*:!4903.51N/07201.75W-";
+  char other_dest[] = "}W1AW>APZ123,TCPIP*:!4903.50N/07201.75W-";
+
+  TEST_ASSERT(dupe_digest(via_rf) == dupe_digest(via_net), "Path should be ignored");
+  TEST_ASSERT(dupe_digest(via_rf) != dupe_digest(other_info), "Info field should count");
+  TEST_ASSERT(dupe_digest(via_rf) != dupe_digest(other_dest), "Destination should count");
+  TEST_PASS("dupe_digest ignores the path");
+}
+
+int test_dupe_within_window(void)
+{
+  dupe_set set;
+  time_t now = 1000000;
+  uint64_t digest = dupe_digest("W1AW>APRS,TCPIP*:>Status");
+
+  memset(&set, 0, sizeof(set));
+  TEST_ASSERT(dupe_set_check(&set, digest, now, 0) == 0, "Empty set has no dupes");
+  TEST_ASSERT(dupe_set_check(&set, digest, now, 0) == 0, "Lookup-only doesn't insert");
+  TEST_ASSERT(dupe_set_check(&set, digest, now, 1) == 0, "First insert isn't a dupe");
+  TEST_ASSERT(dupe_set_check(&set, digest, now + DUPE_WINDOW, 0) == 1, "Dupe at end of window");
+  TEST_ASSERT(dupe_set_check(&set, digest, now + DUPE_WINDOW + 1, 0) == 0, "Expired after window");
+  TEST_ASSERT(dupe_set_check(&set, digest, now + DUPE_WINDOW + 1, 1) == 0, "Reinsert after expiry");
+  TEST_ASSERT(dupe_set_check(&set, digest, now + DUPE_WINDOW + 2, 1) == 1, "Dupe again");
+  TEST_ASSERT(set.hits == 2 && set.misses == 5, "Hit and miss counters");
+  dupe_set_clear(&set);
+  TEST_PASS("dupe found within the window only");
+}
+
+int test_expired_entries_dropped(void)
+{
+  dupe_set set;
+  char line[64];
+  time_t now = 1000000;
+  int ii;
+
+  memset(&set, 0, sizeof(set));
+
+  // 100 packets per second for ten minutes.  The table should stay
+  // sized for one window's worth, not grow with the total.
+  for (ii = 0; ii < 60000; ii++)
+  {
+    snprintf(line, sizeof(line), "N%dX>APRS,WIDE2-1:>%d", ii % 5000, ii);
+    TEST_ASSERT(dupe_set_check(&set, dupe_digest(line), now + ii / 100, 1) == 0, "All unique");
+  }
+  TEST_ASSERT(set.size <= 16384, "Table bounded by the window");
+
+  // The most recent packets are still there
+  snprintf(line, sizeof(line), "N%dX>APRS,WIDE1-1:>%d", 59999 % 5000, 59999);
+  TEST_ASSERT(dupe_set_check(&set, dupe_digest(line), now + 599, 0) == 1, "Recent packet found");
+
+  dupe_set_clear(&set);
+  TEST_ASSERT(set.table == NULL && set.size == 0, "Cleared");
+  TEST_PASS("expired entries are dropped");
+}
+
+/* Test runner */
+typedef struct
+{
+  const char *name;
+  int (*func)(void);
+} test_case_t;
+
+int main(int argc, char *argv[])
+{
+  test_case_t tests[] =
+  {
+    {"digest_ignores_path", test_digest_ignores_path},
+    {"dupe_within_window", test_dupe_within_window},
+    {"expired_entries_dropped", test_expired_entries_dropped},
+    {NULL, NULL}
+  };
+
+  if (argc < 2)
+  {
+    fprintf(stderr, "Usage: %s <test_name>\n", argv[0]);
+    return 1;
+  }
+
+  for (int i = 0; tests[i].name != NULL; i++)
+  {
+    if (strcmp(argv[1], tests[i].name) == 0)
+    {
+      return tests[i].func();
+    }
+  }
+
+  fprintf(stderr, "Unknown test: %s\n", argv[1]);
+  return 1;
+}
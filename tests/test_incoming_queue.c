@@ -0,0 +1,223 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 2025-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+
+/*
+ * Test program for the incoming packet queue in interface.c
+ *
+ * push_incoming_data() is called by the port read threads and
+ * pop_incoming_data() by the main thread.  Links against interface.c
+ * with the same mocks as test_output_my_aprs_data.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "tests/test_framework.h"
+#include "interface.h"
+
+#define PRODUCERS 4
+#define PACKETS_PER_PRODUCER 20000
+
+typedef struct
+{
+  int port;
+  int count;
+} producer_args_t;
+
+static void *producer_thread(void *arg)
+{
+  producer_args_t *args = (producer_args_t *)arg;
+  unsigned char packet[MAX_LINE_SIZE];
+  int length;
+  int ii;
+
+  for (ii = 0; ii < args->count; ii++)
+  {
+    length = snprintf((char *)packet, sizeof(packet), "P%d>APRS:%d", args->port, ii) + 1;
+    while (push_incoming_data(packet, length, args->port))
+    {
+      sched_yield();
+    }
+  }
+  return NULL;
+}
+
+/* Test cases */
+
+int test_push_pop_single(void)
+{
+  unsigned char data[MAX_LINE_SIZE];
+  unsigned char binary[5] = { 0xc0, 0x00, 'A', 0x00, 0xc0 };
+  int port = -1;
+  int length;
+
+  TEST_ASSERT(pop_incoming_data(data, &port) == 0, "Empty queue should return 0");
+
+  TEST_ASSERT(push_incoming_data(binary, sizeof(binary), 3) == 0, "Push should succeed");
+  length = pop_incoming_data(data, &port);
+  TEST_ASSERT(length == (int)sizeof(binary), "Length should survive the queue");
+  TEST_ASSERT(port == 3, "Port should survive the queue");
+  TEST_ASSERT(memcmp(data, binary, sizeof(binary)) == 0, "Embedded zeros should survive the queue");
+  TEST_ASSERT(pop_incoming_data(data, &port) == 0, "Queue should be empty again");
+
+  TEST_PASS("push/pop of a binary record");
+}
+
+int test_queue_full(void)
+{
+  unsigned char data[MAX_LINE_SIZE] = "N0CALL>APRS:test";
+  int depth, high_water;
+  unsigned long pushed, popped, dropped;
+  int port;
+  int count = 0;
+
+  while (push_incoming_data(data, 17, 0) == 0)
+  {
+    count++;
+    TEST_ASSERT(count <= 100000, "Queue should fill up eventually");
+  }
+  TEST_ASSERT(count > 0, "Some records should fit");
+
+  /* Other ports have their own queues */
+  TEST_ASSERT(push_incoming_data(data, 17, 1) == 0, "Another port should still have room");
+
+  get_incoming_data_stats(&depth, &high_water, &pushed, &popped, &dropped);
+  TEST_ASSERT(depth == count + 1, "Depth should count both ports");
+  TEST_ASSERT(high_water == count, "High water should be the full queue");
+  TEST_ASSERT(pushed == (unsigned long)count + 1, "Pushed count should match");
+
+  /* Ports are served round-robin */
+  TEST_ASSERT(pop_incoming_data(data, &port) > 0 && port == 0, "First pop from port 0");
+  TEST_ASSERT(pop_incoming_data(data, &port) > 0 && port == 1, "Then port 1");
+  TEST_ASSERT(push_incoming_data(data, 17, 0) == 0, "Room after a pop");
+
+  TEST_PASS("full queue is reported and ports are independent");
+}
+
+int test_bad_port(void)
+{
+  unsigned char data[MAX_LINE_SIZE] = "N0CALL>APRS:test";
+  int port;
+
+  TEST_ASSERT(push_incoming_data(data, 17, -1) == 0, "Bad port should be dropped, not retried");
+  TEST_ASSERT(push_incoming_data(data, 17, MAX_IFACE_DEVICES) == 0, "Bad port should be dropped, not retried");
+  TEST_ASSERT(pop_incoming_data(data, &port) == 0, "Nothing should have been queued");
+
+  TEST_PASS("records for invalid ports are dropped");
+}
+
+int test_concurrent_producers(void)
+{
+  pthread_t threads[PRODUCERS];
+  producer_args_t args[PRODUCERS];
+  int next_seq[PRODUCERS];
+  unsigned char data[MAX_LINE_SIZE];
+  char expected[MAX_LINE_SIZE];
+  unsigned long popped;
+  int received = 0;
+  int port, length, ii;
+
+  for (ii = 0; ii < PRODUCERS; ii++)
+  {
+    args[ii].port = ii * 2;
+    args[ii].count = PACKETS_PER_PRODUCER;
+    next_seq[ii] = 0;
+    TEST_ASSERT(pthread_create(&threads[ii], NULL, producer_thread, &args[ii]) == 0,
+                "Thread should start");
+  }
+
+  while (received < PRODUCERS * PACKETS_PER_PRODUCER)
+  {
+    length = pop_incoming_data(data, &port);
+    if (length == 0)
+    {
+      sched_yield();
+      continue;
+    }
+    TEST_ASSERT(port >= 0 && port % 2 == 0 && port < PRODUCERS * 2, "Port should be a producer's");
+
+    /* Each port's records must arrive complete and in order */
+    snprintf(expected, sizeof(expected), "P%d>APRS:%d", port, next_seq[port / 2]);
+    TEST_ASSERT_STR_EQ(expected, (char *)data, "Record should be intact and in order");
+    TEST_ASSERT(length == (int)strlen(expected) + 1, "Length should match");
+    next_seq[port / 2]++;
+    received++;
+  }
+
+  for (ii = 0; ii < PRODUCERS; ii++)
+  {
+    pthread_join(threads[ii], NULL);
+  }
+  TEST_ASSERT(pop_incoming_data(data, &port) == 0, "Queue should be drained");
+
+  get_incoming_data_stats(NULL, NULL, NULL, &popped, NULL);
+  TEST_ASSERT(popped == (unsigned long)received, "Popped count should match");
+
+  TEST_PASS("concurrent producers on separate ports");
+}
+
+/* Test runner */
+typedef struct
+{
+  const char *name;
+  int (*func)(void);
+} test_case_t;
+
+int main(int argc, char *argv[])
+{
+  test_case_t tests[] =
+  {
+    {"push_pop_single", test_push_pop_single},
+    {"queue_full", test_queue_full},
+    {"bad_port", test_bad_port},
+    {"concurrent_producers", test_concurrent_producers},
+    {NULL, NULL}
+  };
+
+  if (argc < 2)
+  {
+    fprintf(stderr, "Usage: %s <test_name>\n", argv[0]);
+    fprintf(stderr, "Available tests:\n");
+    for (int i = 0; tests[i].name != NULL; i++)
+    {
+      fprintf(stderr, "  %s\n", tests[i].name);
+    }
+    return 1;
+  }
+
+  const char *test_name = argv[1];
+
+  /* Run the requested test */
+  for (int i = 0; tests[i].name != NULL; i++)
+  {
+    if (strcmp(test_name, tests[i].name) == 0)
+    {
+      return tests[i].func();
+    }
+  }
+
+  fprintf(stderr, "Unknown test: %s\n", test_name);
+  return 1;
+}
@@ -0,0 +1,185 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 2000-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+
+
+
+
+/*
+ * Tests for the log file playback in log_replay.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "tests/test_framework.h"
+#include "log_replay.h"
+
+static char log_path[] = "/tmp/test_log_replay_XXXXXX";
+
+static void write_log(const char *text)
+{
+  int fd = mkstemp(log_path);
+
+  if (fd >= 0)
+  {
+    if (write(fd, text, strlen(text)) != (ssize_t)strlen(text))
+    {
+      fprintf(stderr, "Short write\n");
+    }
+    close(fd);
+  }
+}
+
+int test_max_speed(void)
+{
+  log_replay *replay;
+  char line[256];
+
+  write_log("# 1157027319  Thu Aug 31 05:28:39 PDT 2006\n"
+            "N0CALL>APRS:>first\n"
+            "\n"
+            "# 1157030919  Thu Aug 31 06:28:39 PDT 2006\n"
+            "N0CALL>APRS:>second\r\n"
+            "N0CALL>APRS:>third<br>\n"
+            "N0CALL>APRS:>fourth");
+  replay = log_replay_open(log_path, 0);
+  unlink(log_path);
+  TEST_ASSERT(replay != NULL, "Log opened");
+  TEST_ASSERT(log_replay_percent(replay) == 0, "Nothing played yet");
+
+  TEST_ASSERT(log_replay_next(replay, 0, line, sizeof(line)) == 1, "First line ready");
+  TEST_ASSERT(strcmp(line, "N0CALL>APRS:>first") == 0, "Timestamp skipped");
+  TEST_ASSERT(replay->stamp == 1157027319, "Timestamp parsed");
+
+  TEST_ASSERT(log_replay_next(replay, 0, line, sizeof(line)) == 1, "Second line ready an hour early");
+  TEST_ASSERT(strcmp(line, "N0CALL>APRS:>second") == 0, "Blank line skipped, CR stripped");
+  TEST_ASSERT(replay->stamp == 1157030919, "Next timestamp parsed");
+
+  TEST_ASSERT(log_replay_next(replay, 0, line, sizeof(line)) == 1, "Third line ready");
+  TEST_ASSERT(strcmp(line, "N0CALL>APRS:>third") == 0, "<br> stripped");
+
+  TEST_ASSERT(log_replay_next(replay, 0, line, 10) == 1, "Last line without line end ready");
+  TEST_ASSERT(strcmp(line, "N0CALL>AP") == 0, "Long line cut to fit");
+
+  TEST_ASSERT(log_replay_next(replay, 0, line, sizeof(line)) == -1, "End of log");
+  TEST_ASSERT(log_replay_next(replay, 0, line, sizeof(line)) == -1, "Still at the end");
+  TEST_ASSERT(replay->packets == 4 && log_replay_percent(replay) == 100, "All played");
+
+  log_replay_close(replay);
+  TEST_PASS("lines are played back in order as fast as asked for");
+}
+
+int test_paced(void)
+{
+  log_replay *replay;
+  char line[256];
+
+  write_log("N0CALL>APRS:>untimed\n"
+            "# 1000000000  Sun Sep  9 01:46:40 UTC 2001\n"
+            "N0CALL>APRS:>first\n"
+            "# 1000000060  Sun Sep  9 01:47:40 UTC 2001\n"
+            "N0CALL>APRS:>second\n"
+            "# 1000000060  Sun Sep  9 01:47:40 UTC 2001\n"
+            "N0CALL>APRS:>third\n"
+            "#  not a timestamp\n"
+            "N0CALL>APRS:>fourth\n"
+            "# 1000000600  Sun Sep  9 01:56:40 UTC 2001\n"
+            "N0CALL>APRS:>fifth\n");
+  replay = log_replay_open(log_path, 10);
+  unlink(log_path);
+  TEST_ASSERT(replay != NULL, "Log opened");
+
+  TEST_ASSERT(log_replay_next(replay, 500, line, sizeof(line)) == 1, "Untimed line due right away");
+  TEST_ASSERT(strcmp(line, "N0CALL>APRS:>untimed") == 0, "Untimed line");
+  TEST_ASSERT(log_replay_next(replay, 500, line, sizeof(line)) == 1, "First timed line starts the clock");
+  TEST_ASSERT(strcmp(line, "N0CALL>APRS:>first") == 0, "First timed line");
+
+  /* A minute of log at 10x is 6 seconds */
+  TEST_ASSERT(log_replay_next(replay, 505.9, line, sizeof(line)) == 0, "Second line not due yet");
+  TEST_ASSERT(log_replay_next(replay, 506, line, sizeof(line)) == 1, "Second line due");
+  TEST_ASSERT(strcmp(line, "N0CALL>APRS:>second") == 0, "Second line");
+  TEST_ASSERT(log_replay_next(replay, 506, line, sizeof(line)) == 1, "Same second due too");
+  TEST_ASSERT(log_replay_next(replay, 506, line, sizeof(line)) == 1, "Bad timestamp keeps the last one");
+  TEST_ASSERT(strcmp(line, "N0CALL>APRS:>fourth") == 0, "Fourth line");
+
+  TEST_ASSERT(log_replay_next(replay, 559, line, sizeof(line)) == 0, "Fifth line not due yet");
+  TEST_ASSERT(log_replay_percent(replay) < 100, "Not done yet");
+  TEST_ASSERT(log_replay_next(replay, 560, line, sizeof(line)) == 1, "Fifth line due");
+  TEST_ASSERT(log_replay_next(replay, 560, line, sizeof(line)) == -1, "End of log");
+
+  log_replay_close(replay);
+  TEST_PASS("lines are paced by their timestamps");
+}
+
+int test_empty(void)
+{
+  log_replay *replay;
+  char line[256];
+
+  TEST_ASSERT(log_replay_open("/nonexistent/log", 0) == NULL, "Missing log refused");
+
+  write_log("");
+  replay = log_replay_open(log_path, 0);
+  unlink(log_path);
+  TEST_ASSERT(replay != NULL, "Empty log opened");
+  TEST_ASSERT(log_replay_next(replay, 0, line, sizeof(line)) == -1, "Empty log ends right away");
+  TEST_ASSERT(log_replay_percent(replay) == 100, "Empty log done");
+  log_replay_close(replay);
+  TEST_PASS("missing and empty logs are handled");
+}
+
+/* Test runner */
+typedef struct
+{
+  const char *name;
+  int (*func)(void);
+} test_case_t;
+
+int main(int argc, char *argv[])
+{
+  test_case_t tests[] =
+  {
+    {"max_speed", test_max_speed},
+    {"paced", test_paced},
+    {"empty", test_empty},
+    {NULL, NULL}
+  };
+
+  if (argc < 2)
+  {
+    fprintf(stderr, "Usage: %s <test_name>\n", argv[0]);
+    return 1;
+  }
+
+  for (int i = 0; tests[i].name != NULL; i++)
+  {
+    if (strcmp(argv[1], tests[i].name) == 0)
+    {
+      return tests[i].func();
+    }
+  }
+
+  fprintf(stderr, "Unknown test: %s\n", argv[1]);
+  return 1;
+}
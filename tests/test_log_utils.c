@@ -42,6 +42,10 @@
 // directly with a caller-supplied "now" and filename.
 extern void load_wx_alerts_from_log_working_sub(time_t time_now, char *filename);
 
+extern void log_data(char *file, char *line);
+extern void log_flush(void);
+extern void log_close_file(char *file);
+
 static void test_path(char *buf, size_t buf_size, const char *suffix)
 {
   snprintf(buf, buf_size, "/tmp/xastir_test_wxalert_%d_%s.log",
@@ -188,6 +192,124 @@ int test_prune_missing_file_is_a_noop(void)
   TEST_PASS("load_wx_alerts_from_log_working_sub: missing file handled gracefully");
 }
 
+static long count_lines(const char *path, const char *prefix)
+{
+  FILE *f;
+  char buf[2048];
+  long count = 0;
+
+  f = fopen(path, "r");
+  if (!f)
+  {
+    return(0);
+  }
+  while (fgets(buf, sizeof(buf), f))
+  {
+    if (strncmp(buf, prefix, strlen(prefix)) == 0)
+    {
+      count++;
+    }
+  }
+  fclose(f);
+  return(count);
+}
+
+int test_log_data_buffered(void)
+{
+  char path[256];
+  char content[256];
+  FILE *f;
+  size_t n;
+  long stamp;
+
+  test_path(path, sizeof(path), "buffered");
+  unlink(path);
+
+  log_data(path, "N0CALL>APRS:first");
+  log_data(path, "# Tickle");
+  log_data(path, "N0CALL>APRS:second");
+  log_flush();
+
+  f = fopen(path, "r");
+  TEST_ASSERT(f != NULL, "log file created");
+  n = fread(content, 1, sizeof(content) - 1, f);
+  content[n] = '\0';
+  fclose(f);
+
+  TEST_ASSERT(sscanf(content, "# %ld  ", &stamp) == 1 && stamp > 0, "timestamp line first");
+  TEST_ASSERT(strstr(content, "\nN0CALL>APRS:first\n# ") != NULL, "first line, then a timestamp");
+  TEST_ASSERT(strstr(content, "N0CALL>APRS:second\n") != NULL, "second line written");
+  TEST_ASSERT(strstr(content, "second") > strstr(content, "first"), "lines kept in order");
+  TEST_ASSERT(strstr(content, "Tickle") == NULL, "idle strings not logged");
+  TEST_ASSERT(count_lines(path, "# ") == 2, "one timestamp line per line");
+
+  unlink(path);
+  TEST_PASS("log_data: lines are buffered and written out in order");
+}
+
+int test_log_data_rotates(void)
+{
+  char path[256];
+  char rotated[300];
+  char line[1001];
+  struct stat status;
+  int i;
+
+  test_path(path, sizeof(path), "rotate");
+  snprintf(rotated, sizeof(rotated), "%s.1", path);
+  unlink(path);
+  unlink(rotated);
+
+  memset(line, 'x', sizeof(line) - 1);
+  line[sizeof(line) - 1] = '\0';
+  memcpy(line, "LINE", 4);
+
+  // 2.1 MB, past the 2 MB rotation size
+  for (i = 0; i < 2100; i++)
+  {
+    log_data(path, line);
+    if (i % 100 == 0)
+    {
+      log_flush();
+    }
+  }
+  log_flush();
+
+  TEST_ASSERT(stat(rotated, &status) == 0, "log rotated");
+  TEST_ASSERT(status.st_size <= 2048000, "rotated log within the size limit");
+  TEST_ASSERT(stat(path, &status) == 0 && status.st_size > 0, "new log started");
+  TEST_ASSERT(count_lines(path, "LINE") + count_lines(rotated, "LINE") == 2100, "no lines lost");
+
+  unlink(path);
+  unlink(rotated);
+  TEST_PASS("log_data: full logs are rotated");
+}
+
+int test_log_close_file(void)
+{
+  char path[256];
+  char moved[300];
+
+  test_path(path, sizeof(path), "close");
+  snprintf(moved, sizeof(moved), "%s.moved", path);
+  unlink(path);
+  unlink(moved);
+
+  log_data(path, "BEFORE");
+  log_close_file(path);
+  TEST_ASSERT(file_contains(path, "BEFORE"), "buffered line written on close");
+
+  TEST_ASSERT(rename(path, moved) == 0, "log moved away");
+  log_data(path, "AFTER");
+  log_flush();
+  TEST_ASSERT(file_contains(path, "AFTER") && !file_contains(path, "BEFORE"), "log reopened");
+  TEST_ASSERT(!file_contains(moved, "AFTER"), "moved log left alone");
+
+  unlink(path);
+  unlink(moved);
+  TEST_PASS("log_close_file: log is written and reopened");
+}
+
 typedef struct
 {
   const char *name;
@@ -203,6 +325,9 @@ int main(int argc, char *argv[])
     {"prune_keeps_all_fresh_entries", test_prune_keeps_all_fresh_entries},
     {"prune_preserves_full_packet_content", test_prune_preserves_full_packet_content},
     {"prune_missing_file_is_a_noop", test_prune_missing_file_is_a_noop},
+    {"log_data_buffered", test_log_data_buffered},
+    {"log_data_rotates", test_log_data_rotates},
+    {"log_close_file", test_log_close_file},
     {NULL, NULL}
   };
 
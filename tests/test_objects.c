@@ -1502,7 +1502,7 @@ int test_constructor_area_object_signpost_basic(void)
   TEST_ASSERT_STR_EQ("",theDataRow->course,"Course correct");
   TEST_ASSERT_STR_EQ("",theDataRow->speed,"Speed correct");
   TEST_ASSERT_STR_EQ("",theDataRow->altitude,"Altitude correct in meters");
-  TEST_ASSERT_STR_EQ("111",theDataRow->signpost,"Signpost data stored properly.");
+  TEST_ASSERT_STR_EQ("111",OBJECT_DATA(theDataRow)->signpost,"Signpost data stored properly.");
   Create_object_item_tx_string(theDataRow,line,sizeof(line));
 
   // clobber the time with our standard fake time, don't worry about termination
@@ -1561,7 +1561,7 @@ int test_constructor_area_item_signpost_basic(void)
   TEST_ASSERT_STR_EQ("",theDataRow->course,"Course correct");
   TEST_ASSERT_STR_EQ("",theDataRow->speed,"Speed correct");
   TEST_ASSERT_STR_EQ("",theDataRow->altitude,"Altitude correct in meters");
-  TEST_ASSERT_STR_EQ("111",theDataRow->signpost,"Signpost data stored properly.");
+  TEST_ASSERT_STR_EQ("111",OBJECT_DATA(theDataRow)->signpost,"Signpost data stored properly.");
 
   Create_object_item_tx_string(theDataRow,line,sizeof(line));
 
@@ -1618,7 +1618,7 @@ int test_constructor_area_object_signpost_speed(void)
   TEST_ASSERT_STR_EQ("090",theDataRow->course,"Course correct");
   TEST_ASSERT_STR_EQ("  5",theDataRow->speed,"Speed correct");
   TEST_ASSERT_STR_EQ("",theDataRow->altitude,"Altitude correct in meters");
-  TEST_ASSERT_STR_EQ("111",theDataRow->signpost,"Signpost data stored properly.");
+  TEST_ASSERT_STR_EQ("111",OBJECT_DATA(theDataRow)->signpost,"Signpost data stored properly.");
   Create_object_item_tx_string(theDataRow,line,sizeof(line));
 
   // clobber the time with our standard fake time, don't worry about termination
@@ -1677,7 +1677,7 @@ int test_constructor_area_item_signpost_speed(void)
   TEST_ASSERT_STR_EQ("090",theDataRow->course,"Course correct");
   TEST_ASSERT_STR_EQ("  5",theDataRow->speed,"Speed correct");
   TEST_ASSERT_STR_EQ("",theDataRow->altitude,"Altitude correct in meters");
-  TEST_ASSERT_STR_EQ("111",theDataRow->signpost,"Signpost data stored properly.");
+  TEST_ASSERT_STR_EQ("111",OBJECT_DATA(theDataRow)->signpost,"Signpost data stored properly.");
 
   Create_object_item_tx_string(theDataRow,line,sizeof(line));
 
@@ -1736,7 +1736,7 @@ int test_constructor_object_df_omni(void)
   TEST_ASSERT_STR_EQ("",theDataRow->course,"Course correct");
   TEST_ASSERT_STR_EQ("",theDataRow->speed,"Speed correct");
   TEST_ASSERT_STR_EQ("",theDataRow->altitude,"Altitude correct in meters");
-  TEST_ASSERT_STR_EQ("DFS4133",theDataRow->signal_gain, "signal/gain correct");
+  TEST_ASSERT_STR_EQ("DFS4133",EXTRA_DATA(theDataRow)->signal_gain, "signal/gain correct");
 
   Create_object_item_tx_string(theDataRow,line,sizeof(line));
 
@@ -1796,7 +1796,7 @@ int test_constructor_item_df_omni(void)
   TEST_ASSERT_STR_EQ("",theDataRow->course,"Course correct");
   TEST_ASSERT_STR_EQ("",theDataRow->speed,"Speed correct");
   TEST_ASSERT_STR_EQ("",theDataRow->altitude,"Altitude correct in meters");
-  TEST_ASSERT_STR_EQ("DFS4133",theDataRow->signal_gain, "signal/gain correct");
+  TEST_ASSERT_STR_EQ("DFS4133",EXTRA_DATA(theDataRow)->signal_gain, "signal/gain correct");
 
   Create_object_item_tx_string(theDataRow,line,sizeof(line));
 
@@ -1854,8 +1854,8 @@ int test_constructor_object_df_beam(void)
   TEST_ASSERT_STR_EQ("",theDataRow->course,"Course correct");
   TEST_ASSERT_STR_EQ("",theDataRow->speed,"Speed correct");
   TEST_ASSERT_STR_EQ("",theDataRow->altitude,"Altitude correct in meters");
-  TEST_ASSERT_STR_EQ("140",theDataRow->bearing, "bearing correct");
-  TEST_ASSERT_STR_EQ("965",theDataRow->NRQ, "NRQ correct");
+  TEST_ASSERT_STR_EQ("140",EXTRA_DATA(theDataRow)->bearing, "bearing correct");
+  TEST_ASSERT_STR_EQ("965",EXTRA_DATA(theDataRow)->NRQ, "NRQ correct");
 
   Create_object_item_tx_string(theDataRow,line,sizeof(line));
 
@@ -1915,8 +1915,8 @@ int test_constructor_item_df_beam(void)
   TEST_ASSERT_STR_EQ("",theDataRow->course,"Course correct");
   TEST_ASSERT_STR_EQ("",theDataRow->speed,"Speed correct");
   TEST_ASSERT_STR_EQ("",theDataRow->altitude,"Altitude correct in meters");
-  TEST_ASSERT_STR_EQ("140",theDataRow->bearing, "bearing correct");
-  TEST_ASSERT_STR_EQ("965",theDataRow->NRQ, "NRQ correct");
+  TEST_ASSERT_STR_EQ("140",EXTRA_DATA(theDataRow)->bearing, "bearing correct");
+  TEST_ASSERT_STR_EQ("965",EXTRA_DATA(theDataRow)->NRQ, "NRQ correct");
 
   Create_object_item_tx_string(theDataRow,line,sizeof(line));
 
@@ -1979,8 +1979,8 @@ int test_constructor_object_prob_circles_noring(void)
   TEST_ASSERT_STR_EQ("",theDataRow->course,"Course correct");
   TEST_ASSERT_STR_EQ("",theDataRow->speed,"Speed correct");
   TEST_ASSERT_STR_EQ("",theDataRow->altitude,"Altitude correct in meters");
-  TEST_ASSERT_STR_EQ("",theDataRow->probability_min,"Probability min correct");
-  TEST_ASSERT_STR_EQ("",theDataRow->probability_max,"Probability max correct");
+  TEST_ASSERT_STR_EQ("",OBJECT_DATA(theDataRow)->probability_min,"Probability min correct");
+  TEST_ASSERT_STR_EQ("",OBJECT_DATA(theDataRow)->probability_max,"Probability max correct");
 
   Create_object_item_tx_string(theDataRow,line,sizeof(line));
 
@@ -2040,8 +2040,8 @@ int test_constructor_item_prob_circles_noring(void)
   TEST_ASSERT_STR_EQ("",theDataRow->course,"Course correct");
   TEST_ASSERT_STR_EQ("",theDataRow->speed,"Speed correct");
   TEST_ASSERT_STR_EQ("",theDataRow->altitude,"Altitude correct in meters");
-  TEST_ASSERT_STR_EQ("",theDataRow->probability_min,"Probability min correct");
-  TEST_ASSERT_STR_EQ("",theDataRow->probability_max,"Probability max correct");
+  TEST_ASSERT_STR_EQ("",OBJECT_DATA(theDataRow)->probability_min,"Probability min correct");
+  TEST_ASSERT_STR_EQ("",OBJECT_DATA(theDataRow)->probability_max,"Probability max correct");
 
   Create_object_item_tx_string(theDataRow,line,sizeof(line));
 
@@ -2098,8 +2098,8 @@ int test_constructor_object_prob_circles_minring(void)
   TEST_ASSERT_STR_EQ("",theDataRow->course,"Course correct");
   TEST_ASSERT_STR_EQ("",theDataRow->speed,"Speed correct");
   TEST_ASSERT_STR_EQ("",theDataRow->altitude,"Altitude correct in meters");
-  TEST_ASSERT_STR_EQ("1",theDataRow->probability_min,"Probability min correct");
-  TEST_ASSERT_STR_EQ("",theDataRow->probability_max,"Probability max correct");
+  TEST_ASSERT_STR_EQ("1",OBJECT_DATA(theDataRow)->probability_min,"Probability min correct");
+  TEST_ASSERT_STR_EQ("",OBJECT_DATA(theDataRow)->probability_max,"Probability max correct");
 
   Create_object_item_tx_string(theDataRow,line,sizeof(line));
 
@@ -2159,8 +2159,8 @@ int test_constructor_item_prob_circles_minring(void)
   TEST_ASSERT_STR_EQ("",theDataRow->course,"Course correct");
   TEST_ASSERT_STR_EQ("",theDataRow->speed,"Speed correct");
   TEST_ASSERT_STR_EQ("",theDataRow->altitude,"Altitude correct in meters");
-  TEST_ASSERT_STR_EQ("1",theDataRow->probability_min,"Probability min correct");
-  TEST_ASSERT_STR_EQ("",theDataRow->probability_max,"Probability max correct");
+  TEST_ASSERT_STR_EQ("1",OBJECT_DATA(theDataRow)->probability_min,"Probability min correct");
+  TEST_ASSERT_STR_EQ("",OBJECT_DATA(theDataRow)->probability_max,"Probability max correct");
 
   Create_object_item_tx_string(theDataRow,line,sizeof(line));
 
@@ -2217,8 +2217,8 @@ int test_constructor_object_prob_circles_maxring(void)
   TEST_ASSERT_STR_EQ("",theDataRow->course,"Course correct");
   TEST_ASSERT_STR_EQ("",theDataRow->speed,"Speed correct");
   TEST_ASSERT_STR_EQ("",theDataRow->altitude,"Altitude correct in meters");
-  TEST_ASSERT_STR_EQ("",theDataRow->probability_min,"Probability min correct");
-  TEST_ASSERT_STR_EQ("5",theDataRow->probability_max,"Probability max correct");
+  TEST_ASSERT_STR_EQ("",OBJECT_DATA(theDataRow)->probability_min,"Probability min correct");
+  TEST_ASSERT_STR_EQ("5",OBJECT_DATA(theDataRow)->probability_max,"Probability max correct");
 
   Create_object_item_tx_string(theDataRow,line,sizeof(line));
 
@@ -2278,8 +2278,8 @@ int test_constructor_item_prob_circles_maxring(void)
   TEST_ASSERT_STR_EQ("",theDataRow->course,"Course correct");
   TEST_ASSERT_STR_EQ("",theDataRow->speed,"Speed correct");
   TEST_ASSERT_STR_EQ("",theDataRow->altitude,"Altitude correct in meters");
-  TEST_ASSERT_STR_EQ("",theDataRow->probability_min,"Probability min correct");
-  TEST_ASSERT_STR_EQ("5",theDataRow->probability_max,"Probability max correct");
+  TEST_ASSERT_STR_EQ("",OBJECT_DATA(theDataRow)->probability_min,"Probability min correct");
+  TEST_ASSERT_STR_EQ("5",OBJECT_DATA(theDataRow)->probability_max,"Probability max correct");
 
   Create_object_item_tx_string(theDataRow,line,sizeof(line));
 
@@ -2336,8 +2336,8 @@ int test_constructor_object_prob_circles_minmax(void)
   TEST_ASSERT_STR_EQ("",theDataRow->course,"Course correct");
   TEST_ASSERT_STR_EQ("",theDataRow->speed,"Speed correct");
   TEST_ASSERT_STR_EQ("",theDataRow->altitude,"Altitude correct in meters");
-  TEST_ASSERT_STR_EQ("1",theDataRow->probability_min,"Probability min correct");
-  TEST_ASSERT_STR_EQ("5",theDataRow->probability_max,"Probability max correct");
+  TEST_ASSERT_STR_EQ("1",OBJECT_DATA(theDataRow)->probability_min,"Probability min correct");
+  TEST_ASSERT_STR_EQ("5",OBJECT_DATA(theDataRow)->probability_max,"Probability max correct");
 
   Create_object_item_tx_string(theDataRow,line,sizeof(line));
 
@@ -2397,8 +2397,8 @@ int test_constructor_item_prob_circles_minmax(void)
   TEST_ASSERT_STR_EQ("",theDataRow->course,"Course correct");
   TEST_ASSERT_STR_EQ("",theDataRow->speed,"Speed correct");
   TEST_ASSERT_STR_EQ("",theDataRow->altitude,"Altitude correct in meters");
-  TEST_ASSERT_STR_EQ("1",theDataRow->probability_min,"Probability min correct");
-  TEST_ASSERT_STR_EQ("5",theDataRow->probability_max,"Probability max correct");
+  TEST_ASSERT_STR_EQ("1",OBJECT_DATA(theDataRow)->probability_min,"Probability min correct");
+  TEST_ASSERT_STR_EQ("5",OBJECT_DATA(theDataRow)->probability_max,"Probability max correct");
 
   Create_object_item_tx_string(theDataRow,line,sizeof(line));
 
@@ -199,7 +199,6 @@ double cvt_mi2len;  // from miles
 
 // stubs needed to get objects.c linked in:
 STUB_IMPL(output_my_data);
-STUB_IMPL(langcode);
 STUB_IMPL(get_user_base_dir);
 STUB_IMPL(statusline);
 STUB_IMPL(ll_to_utm_ups);
@@ -233,7 +232,6 @@ STUB_IMPL(draw_trail)
 STUB_IMPL(end_critical_section)
 STUB_IMPL(fill_in_new_alert_entries)
 STUB_IMPL(get_send_message_path)
-STUB_IMPL(get_tactical_from_hash)
 STUB_IMPL(insert_into_heard_queue)
 STUB_IMPL(is_local_interface)
 STUB_IMPL(is_network_interface)
@@ -261,3 +259,16 @@ void compute_current_DR_position(DataRow *p_station, long *x_long, long *y_lat)
   *x_long = p_station->coord_lon;
   *y_lat = p_station->coord_lat;
 }
+
+// The benchmarks run whole packets through data_add():  no tactical
+// calls, message labels untranslated.
+char *langcode(char *code)
+{
+  return code;
+}
+
+char *get_tactical_from_hash(char *callsign)
+{
+  (void)callsign;
+  return NULL;
+}
@@ -0,0 +1,435 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 2025-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+
+
+
+
+
+/*
+ * Tests for the on-disk raster map pyramids in raster_pyramid.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/stat.h>
+
+#include "tests/test_framework.h"
+#include "cache_utils.h"
+#include "raster_pyramid.h"
+
+#define TEST_WIDTH 700
+#define TEST_HEIGHT 300
+
+/* Palette test image: stripes of indices 0-15, with a hole of
+ * transparent (255) pixels covering the whole second tile across */
+static int palette_pixel(int x, int y)
+{
+  if (x >= 256 && x < 512)
+  {
+    return 255;
+  }
+  return ((x / 3) + (y / 5)) % 16;
+}
+
+static int fill_palette(void *data, int row, uint8_t *pixels)
+{
+  int x;
+
+  (*(int *)data)++;
+  for (x = 0; x < TEST_WIDTH; x++)
+  {
+    pixels[x] = (uint8_t)palette_pixel(x, row);
+  }
+  return 0;
+}
+
+static uint32_t rgb_pixel(int x, int y)
+{
+  if ((x + y) % 7 == 0)
+  {
+    return 0;                   /* not drawn */
+  }
+  return 0xff000000U | ((uint32_t)(x & 0xff) << 16) | ((uint32_t)(y & 0xff) << 8) | 0x40;
+}
+
+static int fill_rgb(void *data, int row, uint8_t *pixels)
+{
+  uint32_t *p = (uint32_t *)pixels;
+  int x;
+
+  (void)data;
+  for (x = 0; x < TEST_WIDTH; x++)
+  {
+    p[x] = rgb_pixel(x, row);
+  }
+  return 0;
+}
+
+static int fill_fail(void *data, int row, uint8_t *pixels)
+{
+  (void)data;
+  (void)pixels;
+  return (row == 100) ? -1 : 0;
+}
+
+static void make_geometry(raster_pyramid_header *geometry, int bpp)
+{
+  memset(geometry, 0, sizeof(*geometry));
+  geometry->source_mtime = 1234;
+  geometry->source_size = 5678;
+  geometry->variant = fnv1a_string(FNV1A_INIT, "gamma=1.0");
+  geometry->width = TEST_WIDTH;
+  geometry->height = TEST_HEIGHT;
+  geometry->bpp = bpp;
+  geometry->transparent = 255;
+  geometry->x0 = 64800000.0;
+  geometry->y0 = 32400000.0;
+  geometry->step_x = 10.0;
+  geometry->step_y = 8.0;
+}
+
+/* Pixel (x,y) of a level, or the transparent value if its tile is empty */
+static uint32_t get_pixel(raster_pyramid *pyramid, int level, int x, int y)
+{
+  const uint8_t *tile = raster_pyramid_tile(pyramid, level, x / RASTER_PYRAMID_TILE,
+                        y / RASTER_PYRAMID_TILE);
+  size_t i = (size_t)(y % RASTER_PYRAMID_TILE) * RASTER_PYRAMID_TILE + x % RASTER_PYRAMID_TILE;
+
+  if (pyramid->header->bpp == 1)
+  {
+    return tile ? tile[i] : pyramid->header->transparent;
+  }
+  return tile ? ((const uint32_t *)tile)[i] : 0;
+}
+
+int test_palette(void)
+{
+  raster_pyramid_header geometry;
+  raster_pyramid *pyramid;
+  char path[64];
+  int rows = 0;
+  int x, y, w, h, bad = 0;
+
+  snprintf(path, sizeof(path), "test_raster_pyramid.%ld.xrp", (long)getpid());
+  make_geometry(&geometry, 1);
+
+  TEST_ASSERT(raster_pyramid_build(path, &geometry, fill_palette, &rows) == 0, "Pyramid built");
+  TEST_ASSERT(rows == TEST_HEIGHT, "Each row filled once");
+
+  pyramid = raster_pyramid_load(path, 1234, 5678, geometry.variant);
+  TEST_ASSERT(pyramid != NULL, "Pyramid loaded");
+  TEST_ASSERT(pyramid->header->levels == 3, "700x300 has three levels");
+
+  for (y = 0; y < TEST_HEIGHT; y++)
+  {
+    for (x = 0; x < TEST_WIDTH; x++)
+    {
+      if (get_pixel(pyramid, 0, x, y) != (uint32_t)palette_pixel(x, y))
+      {
+        bad++;
+      }
+    }
+  }
+  TEST_ASSERT(bad == 0, "Level 0 holds the image");
+  TEST_ASSERT(raster_pyramid_tile(pyramid, 0, 1, 0) == NULL, "Empty tile isn't stored");
+  TEST_ASSERT(raster_pyramid_tile(pyramid, 0, 3, 0) == NULL, "Tile outside the level");
+
+  raster_pyramid_level_size(pyramid, 1, &w, &h);
+  TEST_ASSERT(w == 350 && h == 150, "Level 1 is half size");
+  for (y = 0; y < h; y++)
+  {
+    for (x = 0; x < w; x++)
+    {
+      int counts[256] = {0};
+      int best = 255, best_count = 0, k;
+
+      for (k = 0; k < 4; k++)
+      {
+        int sx = 2 * x + (k & 1), sy = 2 * y + (k >> 1);
+        int p = (sx < TEST_WIDTH && sy < TEST_HEIGHT) ? palette_pixel(sx, sy) : 255;
+
+        if (p != 255)
+        {
+          counts[p]++;
+        }
+      }
+      for (k = 0; k < 4; k++)
+      {
+        int sx = 2 * x + (k & 1), sy = 2 * y + (k >> 1);
+        int p = palette_pixel(sx, sy);
+
+        if (p != 255 && counts[p] > best_count)
+        {
+          best = p;
+          best_count = counts[p];
+        }
+      }
+      if (get_pixel(pyramid, 1, x, y) != (uint32_t)best)
+      {
+        bad++;
+      }
+    }
+  }
+  TEST_ASSERT(bad == 0, "Level 1 takes the most common index");
+  raster_pyramid_level_size(pyramid, 2, &w, &h);
+  TEST_ASSERT(w == 175 && h == 75, "Level 2 fits one tile");
+  TEST_ASSERT(raster_pyramid_tile(pyramid, 2, 0, 0) != NULL, "Level 2 stored");
+
+  TEST_ASSERT(raster_pyramid_level(pyramid, 4.0, 4.0) == 0, "Zoomed in uses level 0");
+  TEST_ASSERT(raster_pyramid_level(pyramid, 20.0, 16.0) == 1, "Two pixels per screen pixel uses level 1");
+  TEST_ASSERT(raster_pyramid_level(pyramid, 20.0, 8.0) == 0, "Both axes have to fit");
+  TEST_ASSERT(raster_pyramid_level(pyramid, 1000.0, 1000.0) == 2, "Zoomed out uses the last level");
+  raster_pyramid_free(pyramid);
+
+  TEST_ASSERT(raster_pyramid_load(path, 1235, 5678, geometry.variant) == NULL, "Changed mtime rejected");
+  TEST_ASSERT(raster_pyramid_load(path, 1234, 5679, geometry.variant) == NULL, "Changed size rejected");
+  TEST_ASSERT(raster_pyramid_load(path, 1234, 5678, geometry.variant + 1) == NULL, "Changed variant rejected");
+  TEST_ASSERT(truncate(path, 1000) == 0, "Truncated");
+  TEST_ASSERT(raster_pyramid_load(path, 1234, 5678, geometry.variant) == NULL, "Truncated pyramid rejected");
+
+  unlink(path);
+  TEST_ASSERT(raster_pyramid_load(path, 1234, 5678, geometry.variant) == NULL, "Missing pyramid");
+  TEST_ASSERT(raster_pyramid_build(path, &geometry, fill_fail, NULL) != 0, "Failed fill fails the build");
+  TEST_ASSERT(access(path, F_OK) != 0, "Failed build leaves no file");
+
+  TEST_PASS("palette pyramids hold each level and stale ones are rejected");
+}
+
+int test_rgb(void)
+{
+  raster_pyramid_header geometry;
+  raster_pyramid *pyramid;
+  char path[64];
+  int x, y, bad = 0;
+
+  snprintf(path, sizeof(path), "test_raster_pyramid_rgb.%ld.xrp", (long)getpid());
+  make_geometry(&geometry, 4);
+
+  TEST_ASSERT(raster_pyramid_build(path, &geometry, fill_rgb, NULL) == 0, "Pyramid built");
+  pyramid = raster_pyramid_load(path, 1234, 5678, geometry.variant);
+  TEST_ASSERT(pyramid != NULL, "Pyramid loaded");
+
+  for (y = 0; y < TEST_HEIGHT; y++)
+  {
+    for (x = 0; x < TEST_WIDTH; x++)
+    {
+      if (get_pixel(pyramid, 0, x, y) != rgb_pixel(x, y))
+      {
+        bad++;
+      }
+    }
+  }
+  TEST_ASSERT(bad == 0, "Level 0 holds the image");
+
+  for (y = 0; y < TEST_HEIGHT / 2; y++)
+  {
+    for (x = 0; x < TEST_WIDTH / 2; x++)
+    {
+      uint32_t r = 0, g = 0, b = 0, n = 0, want;
+      int k;
+
+      for (k = 0; k < 4; k++)
+      {
+        uint32_t p = rgb_pixel(2 * x + (k & 1), 2 * y + (k >> 1));
+
+        if (p)
+        {
+          r += (p >> 16) & 0xff;
+          g += (p >> 8) & 0xff;
+          b += p & 0xff;
+          n++;
+        }
+      }
+      want = n ? 0xff000000U | ((r / n) << 16) | ((g / n) << 8) | (b / n) : 0;
+      if (get_pixel(pyramid, 1, x, y) != want)
+      {
+        bad++;
+      }
+    }
+  }
+  TEST_ASSERT(bad == 0, "Level 1 averages the drawn pixels");
+
+  raster_pyramid_free(pyramid);
+  unlink(path);
+  TEST_PASS("RGB pyramids average each level");
+}
+
+int test_quad(void)
+{
+  /* A skewed, slightly non-parallel quadrilateral */
+  const double qx[4] = {100.0, 900.0, 140.0, 960.0};
+  const double qy[4] = {50.0, 80.0, 650.0, 700.0};
+  double u, v;
+  int i, bad = 0;
+
+  for (i = 0; i <= 20; i++)
+  {
+    double uu = i / 20.0, vv = 1.0 - i / 25.0;
+    double x = (1 - uu) * (1 - vv) * qx[0] + uu * (1 - vv) * qx[1]
+               + (1 - uu) * vv * qx[2] + uu * vv * qx[3];
+    double y = (1 - uu) * (1 - vv) * qy[0] + uu * (1 - vv) * qy[1]
+               + (1 - uu) * vv * qy[2] + uu * vv * qy[3];
+
+    if (raster_pyramid_quad_uv(qx, qy, x, y, &u, &v) != 0
+        || fabs(u - uu) > 1e-6 || fabs(v - vv) > 1e-6)
+    {
+      bad++;
+    }
+  }
+  TEST_ASSERT(bad == 0, "Points map back to where they came from");
+  TEST_ASSERT(raster_pyramid_quad_uv(qx, qy, 0.0, 0.0, &u, &v) == 0 && u < 0.0 && v < 0.0,
+              "Point outside is outside");
+
+  TEST_PASS("quadrilateral coordinates invert");
+}
+
+int test_trim(void)
+{
+  char dir[64], path[128];
+  struct utimbuf times;
+  FILE *f;
+  int i;
+
+  snprintf(dir, sizeof(dir), "test_raster_pyramid_dir.%ld", (long)getpid());
+  TEST_ASSERT(mkdir(dir, 0700) == 0, "Directory made");
+
+  /* Four 1000 byte pyramids, used in order, and a file that isn't one */
+  for (i = 0; i < 5; i++)
+  {
+    snprintf(path, sizeof(path), "%s/map%d.%s", dir, i, (i < 4) ? "xrp" : "txt");
+    f = fopen(path, "w");
+    TEST_ASSERT(f != NULL, "File made");
+    fseek(f, 999, SEEK_SET);
+    fputc(0, f);
+    fclose(f);
+    times.actime = times.modtime = 1000000 + i * 100;
+    utime(path, &times);
+  }
+
+  TEST_ASSERT(raster_pyramid_trim(dir, 5000) == 4000, "Under the limit keeps everything");
+  TEST_ASSERT(raster_pyramid_trim(dir, 2500) == 2000, "Over the limit trims to it");
+  snprintf(path, sizeof(path), "%s/map0.xrp", dir);
+  TEST_ASSERT(access(path, F_OK) != 0, "Oldest removed");
+  snprintf(path, sizeof(path), "%s/map1.xrp", dir);
+  TEST_ASSERT(access(path, F_OK) != 0, "Next oldest removed");
+  snprintf(path, sizeof(path), "%s/map3.xrp", dir);
+  TEST_ASSERT(access(path, F_OK) == 0, "Newest kept");
+  snprintf(path, sizeof(path), "%s/map4.txt", dir);
+  TEST_ASSERT(access(path, F_OK) == 0, "Other files left alone");
+
+  for (i = 0; i < 5; i++)
+  {
+    snprintf(path, sizeof(path), "%s/map%d.%s", dir, i, (i < 4) ? "xrp" : "txt");
+    unlink(path);
+  }
+  rmdir(dir);
+  TEST_PASS("least recently used pyramids are trimmed");
+}
+
+int test_resample(void)
+{
+  raster_pyramid_header geometry;
+  raster_pyramid *pyramid;
+  char path[64];
+  uint8_t line[TEST_WIDTH];
+  uint32_t line0[2], line1[2], out[5];
+  int column[5] = {0, 0, 0, 0, -1};
+  int column1[5] = {1, 1, 1, 1, 1};
+  int weight_x[5] = {0, 128, 128, 200, 0};
+  int calls = 0, x, bad = 0;
+
+  snprintf(path, sizeof(path), "test_raster_pyramid_line.%ld.xrp", (long)getpid());
+  make_geometry(&geometry, 1);
+  TEST_ASSERT(raster_pyramid_build(path, &geometry, fill_palette, &calls) == 0, "Pyramid built");
+  pyramid = raster_pyramid_load(path, 1234, 5678, geometry.variant);
+  TEST_ASSERT(pyramid != NULL, "Pyramid loaded");
+
+  /* Across all three tiles of row 260, the middle one empty */
+  raster_pyramid_line(pyramid, 0, 260, 10, 600, line);
+  for (x = 10; x <= 600; x++)
+  {
+    if (line[x - 10] != palette_pixel(x, 260))
+    {
+      bad++;
+    }
+  }
+  TEST_ASSERT(bad == 0, "Line gathered across tiles");
+  raster_pyramid_free(pyramid);
+  unlink(path);
+
+  line0[0] = 0xff000000;
+  line0[1] = 0xff804020;
+  line1[0] = 0xff00ff00;
+  line1[1] = 0x00000000;
+
+  raster_pyramid_bilinear(line0, line0, column, column1, weight_x, 0, 5, out);
+  TEST_ASSERT(out[0] == 0xff000000, "Zero weights give the first pixel");
+  TEST_ASSERT(out[1] == 0xff402010, "Half way is the average");
+  TEST_ASSERT(out[4] == 0, "Outside the map is transparent");
+
+  raster_pyramid_bilinear(line0, line1, column, column1, weight_x, 200, 4, out);
+  TEST_ASSERT(out[2] == 0x00000000, "Transparent neighbour gives the nearest");
+  TEST_ASSERT(out[0] == 0xff00ff00, "Nearest taken from the lower line");
+
+  TEST_PASS("lines are gathered and resampled");
+}
+
+/* Test runner */
+typedef struct
+{
+  const char *name;
+  int (*func)(void);
+} test_case_t;
+
+int main(int argc, char *argv[])
+{
+  test_case_t tests[] =
+  {
+    {"palette", test_palette},
+    {"rgb", test_rgb},
+    {"quad", test_quad},
+    {"trim", test_trim},
+    {"resample", test_resample},
+    {NULL, NULL}
+  };
+
+  if (argc < 2)
+  {
+    fprintf(stderr, "Usage: %s <test_name>\n", argv[0]);
+    return 1;
+  }
+
+  for (int i = 0; tests[i].name != NULL; i++)
+  {
+    if (strcmp(argv[1], tests[i].name) == 0)
+    {
+      return tests[i].func();
+    }
+  }
+
+  fprintf(stderr, "Unknown test: %s\n", argv[1]);
+  return 1;
+}
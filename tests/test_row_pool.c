@@ -0,0 +1,159 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 2025-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+
+
+
+/*
+ * Tests for the fixed-size record pools in row_pool.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tests/test_framework.h"
+#include "row_pool.h"
+
+typedef struct
+{
+  long a;
+  char text[20];
+  void *next;
+} test_row;
+
+/* Test cases */
+
+int test_alloc_and_reuse(void)
+{
+  row_pool pool = ROW_POOL_INIT("test_row", sizeof(test_row));
+  test_row *rows[1000];
+  test_row *again;
+  int ii;
+
+  for (ii = 0; ii < 1000; ii++)
+  {
+    rows[ii] = row_pool_alloc(&pool);
+    TEST_ASSERT(rows[ii] != NULL, "Allocation succeeds");
+    TEST_ASSERT(((size_t)rows[ii] % sizeof(long)) == 0, "Records are aligned");
+    rows[ii]->a = ii;
+    memset(rows[ii]->text, 'x', sizeof(rows[ii]->text));
+  }
+  for (ii = 0; ii < 1000; ii++)
+  {
+    TEST_ASSERT(rows[ii]->a == ii, "Records don't overlap");
+  }
+  TEST_ASSERT(pool.live == 1000 && pool.peak == 1000, "Live and peak counted");
+
+  row_pool_free(&pool, rows[500]);
+  TEST_ASSERT(pool.live == 999, "Free counted");
+  again = row_pool_alloc(&pool);
+  TEST_ASSERT(again == rows[500], "Freed record is reused first");
+  TEST_ASSERT(pool.live == 1000 && pool.peak == 1000, "Peak unchanged by reuse");
+
+  row_pool_release(&pool);
+  TEST_ASSERT(pool.slab_count == 0 && row_pool_bytes(&pool) == 0, "Released");
+  TEST_PASS("records are allocated and reused");
+}
+
+int test_reset_keeps_slabs(void)
+{
+  row_pool pool = ROW_POOL_INIT("test_row", sizeof(test_row));
+  unsigned long slabs, bytes;
+  void *first;
+  int ii;
+
+  first = row_pool_alloc(&pool);
+  for (ii = 1; ii < 20000; ii++)
+  {
+    TEST_ASSERT(row_pool_alloc(&pool) != NULL, "Allocation succeeds");
+  }
+  slabs = pool.slab_count;
+  bytes = row_pool_bytes(&pool);
+  TEST_ASSERT(slabs > 1, "More than one slab used");
+  TEST_ASSERT(bytes >= 20000 * sizeof(test_row), "Bytes cover the records");
+
+  row_pool_reset(&pool);
+  TEST_ASSERT(pool.live == 0 && pool.peak == 20000, "Reset drops live records");
+  TEST_ASSERT(row_pool_alloc(&pool) == first, "Carving restarts at the first slab");
+
+  for (ii = 1; ii < 20000; ii++)
+  {
+    row_pool_alloc(&pool);
+  }
+  TEST_ASSERT(pool.slab_count == slabs, "Kept slabs are reused, not reallocated");
+
+  row_pool_alloc(&pool);
+  row_pool_release(&pool);
+  TEST_PASS("reset keeps slabs for reuse");
+}
+
+int test_small_rows(void)
+{
+  row_pool pool = ROW_POOL_INIT("char", 1);
+  char *a, *b;
+
+  a = row_pool_alloc(&pool);
+  b = row_pool_alloc(&pool);
+  TEST_ASSERT(a != NULL && b != NULL, "Allocation succeeds");
+  TEST_ASSERT((size_t)(b - a) >= sizeof(void *), "Room for the free list link");
+  row_pool_free(&pool, a);
+  row_pool_free(&pool, b);
+  TEST_ASSERT(row_pool_alloc(&pool) == b, "Last freed comes back first");
+  TEST_ASSERT(row_pool_alloc(&pool) == a, "Then the one before");
+  row_pool_release(&pool);
+  TEST_PASS("records smaller than a pointer");
+}
+
+/* Test runner */
+typedef struct
+{
+  const char *name;
+  int (*func)(void);
+} test_case_t;
+
+int main(int argc, char *argv[])
+{
+  test_case_t tests[] =
+  {
+    {"alloc_and_reuse", test_alloc_and_reuse},
+    {"reset_keeps_slabs", test_reset_keeps_slabs},
+    {"small_rows", test_small_rows},
+    {NULL, NULL}
+  };
+
+  if (argc < 2)
+  {
+    fprintf(stderr, "Usage: %s <test_name>\n", argv[0]);
+    return 1;
+  }
+
+  for (int i = 0; tests[i].name != NULL; i++)
+  {
+    if (strcmp(argv[1], tests[i].name) == 0)
+    {
+      return tests[i].func();
+    }
+  }
+
+  fprintf(stderr, "Unknown test: %s\n", argv[1]);
+  return 1;
+}
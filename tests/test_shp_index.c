@@ -0,0 +1,360 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 2025-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+
+
+
+
+
+/*
+ * Tests for the packed shapefile spatial index in shp_index.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "tests/test_framework.h"
+#include "shp_index.h"
+
+#define TEST_SHAPES 5000
+
+/* Scattered boxes of assorted sizes, with some invalid ones */
+static void make_entries(shp_index_entry *entries, int count)
+{
+  int ii;
+
+  srand(7);
+  for (ii = 0; ii < count; ii++)
+  {
+    RectReal x = (RectReal)(rand() % 36000) / 100.0f - 180.0f;
+    RectReal y = (RectReal)(rand() % 18000) / 100.0f - 90.0f;
+    RectReal w = (RectReal)(rand() % 200) / 100.0f;
+    RectReal h = (RectReal)(rand() % 200) / 100.0f;
+
+    entries[ii].rect.boundary[0] = x;
+    entries[ii].rect.boundary[1] = y;
+    entries[ii].rect.boundary[2] = (ii % 97 == 0) ? x - 1.0f : x + w;
+    entries[ii].rect.boundary[3] = y + h;
+    entries[ii].id = ii + 1;
+  }
+}
+
+static int overlaps(struct Rect *a, struct Rect *b)
+{
+  return !(a->boundary[0] > b->boundary[2] || b->boundary[0] > a->boundary[2]
+           || a->boundary[1] > b->boundary[3] || b->boundary[1] > a->boundary[3]);
+}
+
+static int collect_hit(void *id, void *arg)
+{
+  char *seen = (char *)arg;
+
+  seen[(intptr_t)id]++;
+  return 1;
+}
+
+static int stop_after_one(void *id, void *arg)
+{
+  (void)id;
+  (*(int *)arg)++;
+  return 0;
+}
+
+/* Every search must return exactly the entries a linear scan finds */
+static int check_searches(shp_index *index, shp_index_entry *original, int count)
+{
+  char *seen = calloc(count + 1, 1);
+  struct Rect view;
+  int query;
+  int ii;
+
+  for (query = 0; query < 50; query++)
+  {
+    int expected = 0;
+    int hits;
+
+    view.boundary[0] = (RectReal)(query * 7 % 360) - 180.0f;
+    view.boundary[1] = (RectReal)(query * 3 % 180) - 90.0f;
+    view.boundary[2] = view.boundary[0] + 5.0f + query % 20;
+    view.boundary[3] = view.boundary[1] + 3.0f + query % 10;
+
+    memset(seen, 0, count + 1);
+    hits = shp_index_search(index, &view, collect_hit, seen);
+
+    for (ii = 0; ii < count; ii++)
+    {
+      int valid = original[ii].rect.boundary[0] <= original[ii].rect.boundary[2];
+      int want = valid && overlaps(&view, &original[ii].rect);
+
+      if (want != seen[original[ii].id])
+      {
+        free(seen);
+        return 0;
+      }
+      expected += want;
+    }
+    if (hits != expected)
+    {
+      free(seen);
+      return 0;
+    }
+  }
+  free(seen);
+  return 1;
+}
+
+int test_search(void)
+{
+  shp_index_entry *entries = malloc(TEST_SHAPES * sizeof(shp_index_entry));
+  shp_index_entry *original = malloc(TEST_SHAPES * sizeof(shp_index_entry));
+  shp_index *index;
+  struct Rect world = { { -180.0f, -90.0f, 180.0f, 90.0f } };
+  int stopped = 0;
+
+  make_entries(entries, TEST_SHAPES);
+  memcpy(original, entries, TEST_SHAPES * sizeof(shp_index_entry));
+
+  index = shp_index_build(entries, TEST_SHAPES, 1234, 5678, NULL);
+  TEST_ASSERT(index != NULL, "Index built");
+  TEST_ASSERT(index->header->entry_count == TEST_SHAPES - (TEST_SHAPES + 96) / 97,
+              "Invalid boxes left out");
+  TEST_ASSERT(check_searches(index, original, TEST_SHAPES), "Searches match a linear scan");
+
+  TEST_ASSERT(shp_index_search(index, &world, stop_after_one, &stopped) == 1
+              && stopped == 1, "Callback can stop the search");
+
+  shp_index_free(index);
+
+  // An empty shapefile still gets a searchable index
+  index = shp_index_build(entries, 0, 0, 0, NULL);
+  TEST_ASSERT(index != NULL && shp_index_search(index, &world, NULL, NULL) == 0,
+              "Empty index");
+  shp_index_free(index);
+
+  free(entries);
+  free(original);
+  TEST_PASS("index searches match a linear scan");
+}
+
+int test_save_load(void)
+{
+  shp_index_entry *entries = malloc(TEST_SHAPES * sizeof(shp_index_entry));
+  shp_index_entry *original = malloc(TEST_SHAPES * sizeof(shp_index_entry));
+  shp_index *index;
+  shp_index *loaded;
+  char path[64];
+
+  snprintf(path, sizeof(path), "test_shp_index.%ld.xri", (long)getpid());
+
+  make_entries(entries, TEST_SHAPES);
+  memcpy(original, entries, TEST_SHAPES * sizeof(shp_index_entry));
+
+  index = shp_index_build(entries, TEST_SHAPES, 1234, 5678, NULL);
+  TEST_ASSERT(index != NULL, "Index built");
+  TEST_ASSERT(shp_index_save(index, path) == 0, "Index saved");
+  shp_index_free(index);
+
+  loaded = shp_index_load(path, 1234, 5678);
+  TEST_ASSERT(loaded != NULL, "Index loaded");
+  TEST_ASSERT(check_searches(loaded, original, TEST_SHAPES), "Loaded index searches match");
+  shp_index_free(loaded);
+
+  TEST_ASSERT(shp_index_load(path, 1235, 5678) == NULL, "Changed mtime rejected");
+  TEST_ASSERT(shp_index_load(path, 1234, 5679) == NULL, "Changed size rejected");
+
+  // Truncated file
+  TEST_ASSERT(truncate(path, 100) == 0, "Truncated");
+  TEST_ASSERT(shp_index_load(path, 1234, 5678) == NULL, "Truncated index rejected");
+
+  unlink(path);
+  TEST_ASSERT(shp_index_load(path, 1234, 5678) == NULL, "Missing index");
+
+  free(entries);
+  free(original);
+  TEST_PASS("saved indexes load and stale ones are rejected");
+}
+
+/* Largest distance from any vertex of the run first..last to the
+ * simplified polyline through the kept vertices */
+static double simplified_error(const double *x, const double *y,
+                               const uint32_t *kept, int kept_count)
+{
+  double worst = 0.0;
+  int kk;
+
+  for (kk = 0; kk + 1 < kept_count; kk++)
+  {
+    int a = kept[kk];
+    int b = kept[kk + 1];
+    int ii;
+
+    for (ii = a + 1; ii < b; ii++)
+    {
+      double dx = x[b] - x[a];
+      double dy = y[b] - y[a];
+      double length = sqrt(dx * dx + dy * dy);
+      double distance = fabs(dy * (x[ii] - x[a]) - dx * (y[ii] - y[a])) / length;
+
+      if (distance > worst)
+      {
+        worst = distance;
+      }
+    }
+  }
+  return worst;
+}
+
+int test_lod(void)
+{
+  shp_index_entry entries[3];
+  shp_index_lod lod;
+  shp_index *index;
+  shp_index *loaded;
+  double line_x[1000], line_y[1000];
+  double ring_x[401], ring_y[401];
+  int line_parts[2] = { 0, 500 };
+  int ring_part = 0;
+  const uint32_t *kept;
+  int count, last_count;
+  int level;
+  int ii;
+  char path[64];
+
+  snprintf(path, sizeof(path), "test_shp_index.%ld.lod.xri", (long)getpid());
+
+  // A wiggly two part line, and a circle
+  for (ii = 0; ii < 1000; ii++)
+  {
+    line_x[ii] = -100.0 + ii * 0.001;
+    line_y[ii] = 40.0 + 0.0002 * sin(ii * 0.7) + 0.05 * sin(ii * 0.01);
+  }
+  for (ii = 0; ii < 400; ii++)
+  {
+    ring_x[ii] = -90.0 + 0.5 * cos(ii * 2.0 * M_PI / 400);
+    ring_y[ii] = 35.0 + 0.5 * sin(ii * 2.0 * M_PI / 400);
+  }
+  ring_x[400] = ring_x[0];
+  ring_y[400] = ring_y[0];
+
+  TEST_ASSERT(shp_index_lod_init(&lod, 3), "LOD initialized");
+  TEST_ASSERT(shp_index_lod_add_shape(&lod, 0, line_x, line_y, 1000, line_parts, 2, 0), "Line added");
+  // Shape 1 left out, drawn at full resolution
+  TEST_ASSERT(shp_index_lod_add_shape(&lod, 2, ring_x, ring_y, 401, &ring_part, 1, 1), "Ring added");
+
+  for (ii = 0; ii < 3; ii++)
+  {
+    entries[ii].rect.boundary[0] = -100.0f;
+    entries[ii].rect.boundary[1] = 30.0f;
+    entries[ii].rect.boundary[2] = -89.0f;
+    entries[ii].rect.boundary[3] = 41.0f;
+    entries[ii].id = ii + 1;
+  }
+  index = shp_index_build(entries, 3, 1234, 5678, &lod);
+  shp_index_lod_free(&lod);
+  TEST_ASSERT(index != NULL, "Index built");
+
+  last_count = 1000;
+  for (level = 0; level < SHP_INDEX_LOD_LEVELS; level++)
+  {
+    count = shp_index_lod_vertices(index, 0, level, &kept);
+    TEST_ASSERT(count > 0 && count <= last_count, "Line simplified");
+    TEST_ASSERT(kept[0] == 0 && kept[count - 1] == 999, "Line ends kept");
+    for (ii = 0; ii < count && kept[ii] != 499; ii++)
+      ;
+    TEST_ASSERT(ii < count && kept[ii + 1] == 500, "Part ends kept");
+    last_count = count;
+  }
+  count = shp_index_lod_vertices(index, 0, 0, &kept);
+  TEST_ASSERT(simplified_error(line_x, line_y, kept, count) <= 0.0005 + 1e-9,
+              "Finest level within its tolerance");
+
+  TEST_ASSERT(shp_index_lod_vertices(index, 1, 2, &kept) == 0, "Skipped shape at full resolution");
+  TEST_ASSERT(shp_index_lod_vertices(index, 0, -1, &kept) == 0, "Level -1 is full resolution");
+
+  count = shp_index_lod_vertices(index, 2, SHP_INDEX_LOD_LEVELS - 1, &kept);
+  TEST_ASSERT(count >= 4 && count < 401, "Ring simplified");
+  TEST_ASSERT(kept[0] == 0 && kept[count - 1] == 400, "Ring stays closed");
+
+  TEST_ASSERT(shp_index_save(index, path) == 0, "Index saved");
+  loaded = shp_index_load(path, 1234, 5678);
+  unlink(path);
+  TEST_ASSERT(loaded != NULL, "Index loaded");
+  for (level = 0; level < SHP_INDEX_LOD_LEVELS; level++)
+  {
+    const uint32_t *loaded_kept;
+
+    for (ii = 0; ii < 3; ii++)
+    {
+      count = shp_index_lod_vertices(index, ii, level, &kept);
+      TEST_ASSERT(shp_index_lod_vertices(loaded, ii, level, &loaded_kept) == count
+                  && (count == 0 || memcmp(kept, loaded_kept, count * sizeof(uint32_t)) == 0),
+                  "Loaded LOD matches");
+    }
+  }
+  shp_index_free(loaded);
+  shp_index_free(index);
+
+  // About 1.3 meters a pixel down at street level, a degree at world view
+  TEST_ASSERT(shp_index_lod_level(0.00001) == -1, "Full resolution zoomed in");
+  TEST_ASSERT(shp_index_lod_level(0.0005) == 0, "Finest level");
+  TEST_ASSERT(shp_index_lod_level(0.01) == 2, "Middle level");
+  TEST_ASSERT(shp_index_lod_level(1.0) == SHP_INDEX_LOD_LEVELS - 1, "Coarsest level");
+
+  TEST_PASS("shapes are simplified per level of detail");
+}
+
+/* Test runner */
+typedef struct
+{
+  const char *name;
+  int (*func)(void);
+} test_case_t;
+
+int main(int argc, char *argv[])
+{
+  test_case_t tests[] =
+  {
+    {"search", test_search},
+    {"save_load", test_save_load},
+    {"lod", test_lod},
+    {NULL, NULL}
+  };
+
+  if (argc < 2)
+  {
+    fprintf(stderr, "Usage: %s <test_name>\n", argv[0]);
+    return 1;
+  }
+
+  for (int i = 0; tests[i].name != NULL; i++)
+  {
+    if (strcmp(argv[1], tests[i].name) == 0)
+    {
+      return tests[i].func();
+    }
+  }
+
+  fprintf(stderr, "Unknown test: %s\n", argv[1]);
+  return 1;
+}
@@ -0,0 +1,215 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 2000-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+
+
+
+
+
+/*
+ * Tests for the x_spider client filters in spider_filter.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tests/test_framework.h"
+#include "spider_filter.h"
+#include "util.h"
+
+static spider_packet make_packet(const char *call, const char *name, const char *info,
+                                 float lat, float lon)
+{
+  spider_packet packet;
+  unsigned long x, y;
+
+  packet.call = call;
+  packet.name = name;
+  packet.info = info;
+  packet.has_position = (lat != 0.0 || lon != 0.0);
+  convert_to_xastir_coordinates(&x, &y, lon, lat);
+  packet.lat = (long)y;
+  packet.lon = (long)x;
+  return packet;
+}
+
+int test_parse(void)
+{
+  spider_filter filter;
+
+  TEST_ASSERT(spider_filter_parse(&filter, "") == 0 && filter.count == 0, "Empty filter");
+  TEST_ASSERT(spider_filter_parse(&filter, "r/47.6/-122.3/50 p/K7/W7 -b/N0CALL*\r\n") == 0,
+              "Three rules parsed");
+  TEST_ASSERT(filter.count == 3, "Three rules kept");
+  TEST_ASSERT(filter.rule[0].kind == 'r' && filter.rule[0].meters == 50000.0, "Range in meters");
+  TEST_ASSERT(filter.rule[1].kind == 'p' && filter.rule[1].count == 2
+              && strcmp(filter.rule[1].word[1], "W7") == 0, "Prefixes kept");
+  TEST_ASSERT(filter.rule[2].exclude && filter.rule[2].kind == 'b', "Exclusion kept");
+
+  TEST_ASSERT(spider_filter_parse(&filter, "a/48/-123/47/-122 T/pw") == 0, "Area and types parsed");
+  TEST_ASSERT(filter.rule[1].types == 0x201, "Type letters are bits");
+
+  TEST_ASSERT(spider_filter_parse(&filter, "r/47.6/-122.3 x/1 t/pz a/47/-123/48/-122 b/K7ABC") == -1,
+              "Bad rules reported");
+  TEST_ASSERT(filter.count == 1 && filter.rule[0].kind == 'b', "Good rules kept");
+
+  TEST_ASSERT(spider_filter_parse(&filter, "b/1/2/3/4/5/6/7/8/9/10") == -1, "Too many calls");
+  TEST_ASSERT(spider_filter_parse(&filter, "r/91/0/10") == -1, "Latitude out of range");
+  TEST_ASSERT(spider_filter_parse(&filter, "r/47/-122/10km") == -1, "Trailing junk");
+  TEST_PASS("filters are parsed and bad rules left out");
+}
+
+int test_position(void)
+{
+  spider_filter filter;
+  spider_packet tacoma = make_packet("K7AAA", NULL, "!4715.00N/12226.40W>", 47.25, -122.44);
+  spider_packet portland = make_packet("K7BBB", NULL, "!4531.20N/12240.80W>", 45.52, -122.68);
+  spider_packet status = make_packet("K7CCC", NULL, ">On the air", 0.0, 0.0);
+
+  spider_filter_parse(&filter, "r/47.6/-122.3/50");
+  TEST_ASSERT(spider_filter_match(&filter, &tacoma), "Inside the range");
+  TEST_ASSERT(!spider_filter_match(&filter, &portland), "Outside the range");
+  TEST_ASSERT(!spider_filter_match(&filter, &status), "No position, no range match");
+
+  spider_filter_parse(&filter, "a/46/-123/45/-122");
+  TEST_ASSERT(spider_filter_match(&filter, &portland), "Inside the box");
+  TEST_ASSERT(!spider_filter_match(&filter, &tacoma), "Outside the box");
+
+  spider_filter_parse(&filter, "");
+  TEST_ASSERT(spider_filter_match(&filter, &status), "Empty filter passes everything");
+  TEST_PASS("range and area rules match positions");
+}
+
+int test_calls(void)
+{
+  spider_filter filter;
+  spider_packet mobile = make_packet("WE7U-13", NULL, ">Status", 0.0, 0.0);
+  spider_packet object = make_packet("K7AAA", "SARBASE", ";SARBASE  *111111z4715.00N/12226.40W;", 0.0, 0.0);
+
+  spider_filter_parse(&filter, "p/WE");
+  TEST_ASSERT(spider_filter_match(&filter, &mobile), "Prefix matches");
+  TEST_ASSERT(!spider_filter_match(&filter, &object), "Prefix doesn't match");
+
+  spider_filter_parse(&filter, "b/we7u*");
+  TEST_ASSERT(spider_filter_match(&filter, &mobile), "Wildcard call matches, any case");
+  spider_filter_parse(&filter, "b/WE7U");
+  TEST_ASSERT(!spider_filter_match(&filter, &mobile), "SSID must match without a wildcard");
+  spider_filter_parse(&filter, "b/N0CALL/WE7U-13");
+  TEST_ASSERT(spider_filter_match(&filter, &mobile), "Second call matches");
+
+  spider_filter_parse(&filter, "o/SAR*");
+  TEST_ASSERT(spider_filter_match(&filter, &object), "Object name matches");
+  TEST_ASSERT(!spider_filter_match(&filter, &mobile), "Not an object");
+  spider_filter_parse(&filter, "b/K7AAA");
+  TEST_ASSERT(spider_filter_match(&filter, &object), "Object sender matches");
+  TEST_PASS("prefix, budlist and object rules match calls");
+}
+
+int test_types(void)
+{
+  spider_filter filter;
+  spider_packet position = make_packet("K7AAA", NULL, "=4715.00N/12226.40W-", 47.25, -122.44);
+  spider_packet weather = make_packet("K7AAA", NULL, "!4715.00N/12226.40W_090/005g010t050", 47.25, -122.44);
+  spider_packet object = make_packet("K7AAA", "SARBASE", ";SARBASE  *111111z4715.00N/12226.40W;", 47.25, -122.44);
+  spider_packet item = make_packet("K7AAA", "AID", ")AID!4715.00N/12226.40W;", 47.25, -122.44);
+  spider_packet message = make_packet("K7AAA", NULL, ":WE7U-13  :Hello{1", 0.0, 0.0);
+  spider_packet nws = make_packet("K7AAA", NULL, ":NWS-WARN :Warning", 0.0, 0.0);
+  spider_packet parm = make_packet("K7AAA", NULL, ":K7AAA    :PARM.Volts", 0.0, 0.0);
+  spider_packet status = make_packet("K7AAA", NULL, ">Status", 0.0, 0.0);
+
+  spider_filter_parse(&filter, "t/p");
+  TEST_ASSERT(spider_filter_match(&filter, &position), "Position");
+  TEST_ASSERT(spider_filter_match(&filter, &weather), "Weather station position");
+  TEST_ASSERT(!spider_filter_match(&filter, &object), "Object isn't a position");
+
+  spider_filter_parse(&filter, "t/w");
+  TEST_ASSERT(spider_filter_match(&filter, &weather), "Weather");
+  TEST_ASSERT(!spider_filter_match(&filter, &position), "Not weather");
+
+  spider_filter_parse(&filter, "t/oi");
+  TEST_ASSERT(spider_filter_match(&filter, &object) && spider_filter_match(&filter, &item),
+              "Objects and items");
+
+  spider_filter_parse(&filter, "t/m");
+  TEST_ASSERT(spider_filter_match(&filter, &message), "Message");
+  TEST_ASSERT(!spider_filter_match(&filter, &nws) && !spider_filter_match(&filter, &parm),
+              "Bulletins and telemetry aren't messages");
+  spider_filter_parse(&filter, "t/n");
+  TEST_ASSERT(spider_filter_match(&filter, &nws), "NWS");
+  spider_filter_parse(&filter, "t/t");
+  TEST_ASSERT(spider_filter_match(&filter, &parm), "Telemetry parameters");
+  spider_filter_parse(&filter, "t/s");
+  TEST_ASSERT(spider_filter_match(&filter, &status), "Status");
+  TEST_PASS("type rules match data types");
+}
+
+int test_exclude(void)
+{
+  spider_filter filter;
+  spider_packet near = make_packet("K7AAA", NULL, "!4715.00N/12226.40W>", 47.25, -122.44);
+  spider_packet noisy = make_packet("K7BOT", NULL, "!4715.00N/12226.40W>", 47.25, -122.44);
+
+  spider_filter_parse(&filter, "r/47.6/-122.3/50 -b/K7BOT");
+  TEST_ASSERT(spider_filter_match(&filter, &near), "Range matches");
+  TEST_ASSERT(!spider_filter_match(&filter, &noisy), "Excluded call dropped");
+
+  spider_filter_parse(&filter, "-b/K7BOT");
+  TEST_ASSERT(!spider_filter_match(&filter, &near), "Exclusions alone pass nothing");
+  TEST_PASS("excluding rules drop packets other rules match");
+}
+
+/* Test runner */
+typedef struct
+{
+  const char *name;
+  int (*func)(void);
+} test_case_t;
+
+int main(int argc, char *argv[])
+{
+  test_case_t tests[] =
+  {
+    {"parse", test_parse},
+    {"position", test_position},
+    {"calls", test_calls},
+    {"types", test_types},
+    {"exclude", test_exclude},
+    {NULL, NULL}
+  };
+
+  if (argc < 2)
+  {
+    fprintf(stderr, "Usage: %s <test_name>\n", argv[0]);
+    return 1;
+  }
+
+  for (int i = 0; tests[i].name != NULL; i++)
+  {
+    if (strcmp(argv[1], tests[i].name) == 0)
+    {
+      return tests[i].func();
+    }
+  }
+
+  fprintf(stderr, "Unknown test: %s\n", argv[1]);
+  return 1;
+}
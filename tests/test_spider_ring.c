@@ -0,0 +1,165 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 2000-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+
+
+
+
+
+/*
+ * Tests for the x_spider client output queue in spider_ring.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "tests/test_framework.h"
+#include "spider_ring.h"
+
+static int read_all(int fd, char *buffer, int size)
+{
+  int n = read(fd, buffer, size - 1);
+
+  buffer[n > 0 ? n : 0] = '\0';
+  return n;
+}
+
+int test_queue(void)
+{
+  spider_ring ring;
+  char buffer[64];
+  int fds[2];
+
+  TEST_ASSERT(spider_ring_init(&ring, 16) == 0, "Ring allocated");
+  TEST_ASSERT(pipe(fds) == 0, "Pipe created");
+  TEST_ASSERT(spider_ring_write(&ring, fds[1]) == 0, "Empty ring writes nothing");
+
+  TEST_ASSERT(spider_ring_put(&ring, "0123456789", 10) == 0, "Line queued");
+  TEST_ASSERT(spider_ring_put(&ring, "abcdefg", 7) == -1, "Line that doesn't fit refused");
+  TEST_ASSERT(spider_ring_length(&ring) == 10, "Refused line not queued");
+  TEST_ASSERT(spider_ring_put(&ring, "abcdef", 6) == 0, "Line that just fits queued");
+
+  TEST_ASSERT(spider_ring_write(&ring, fds[1]) == 16, "Whole ring written");
+  TEST_ASSERT(read_all(fds[0], buffer, sizeof(buffer)) == 16, "Pipe got it");
+  TEST_ASSERT(strcmp(buffer, "0123456789abcdef") == 0, "Order kept");
+  TEST_ASSERT(spider_ring_length(&ring) == 0, "Ring empty");
+
+  /* Wrap around the end of the buffer */
+  ring.head = 10;
+  TEST_ASSERT(spider_ring_put(&ring, "wxyz012345", 10) == 0, "Line queued across the end");
+  TEST_ASSERT(memcmp(ring.data + 10, "wxyz01", 6) == 0 && memcmp(ring.data, "2345", 4) == 0,
+              "Line split across the end");
+  TEST_ASSERT(spider_ring_write(&ring, fds[1]) == 10, "Wrapped ring written");
+  read_all(fds[0], buffer, sizeof(buffer));
+  TEST_ASSERT(strcmp(buffer, "wxyz012345") == 0, "Both halves written in order");
+  TEST_ASSERT(ring.head == 0 && spider_ring_length(&ring) == 0, "Ring empty");
+
+  close(fds[0]);
+  close(fds[1]);
+  spider_ring_free(&ring);
+  TEST_PASS("lines are queued and written in order");
+}
+
+int test_backpressure(void)
+{
+  spider_ring ring;
+  char line[100];
+  char buffer[4096];
+  int fds[2];
+  int queued = 0;
+  long total = 0;
+  long n;
+
+  memset(line, 'x', sizeof(line) - 1);
+  line[sizeof(line) - 1] = '\n';
+
+  TEST_ASSERT(spider_ring_init(&ring, 1000) == 0, "Ring allocated");
+  TEST_ASSERT(pipe(fds) == 0, "Pipe created");
+  fcntl(fds[1], F_SETFL, O_NONBLOCK);
+
+  /* Nobody reads the pipe: fill it, then the ring */
+  while (spider_ring_put(&ring, line, sizeof(line)) == 0)
+  {
+    queued++;
+    spider_ring_write(&ring, fds[1]);
+    TEST_ASSERT(queued < 100000, "Ring fills up");
+  }
+  TEST_ASSERT(spider_ring_length(&ring) > 1000 - sizeof(line), "Ring full");
+  TEST_ASSERT(spider_ring_write(&ring, fds[1]) == 0, "Full pipe would block");
+
+  /* The reader catches up and the ring drains */
+  fcntl(fds[0], F_SETFL, O_NONBLOCK);
+  while (spider_ring_length(&ring) > 0)
+  {
+    while ((n = read(fds[0], buffer, sizeof(buffer))) > 0)
+    {
+      total += n;
+    }
+    TEST_ASSERT(spider_ring_write(&ring, fds[1]) >= 0, "Write ok");
+  }
+  while ((n = read(fds[0], buffer, sizeof(buffer))) > 0)
+  {
+    total += n;
+  }
+  TEST_ASSERT(total == (long)queued * (long)sizeof(line), "Every queued byte arrived");
+
+  close(fds[0]);
+  close(fds[1]);
+  spider_ring_free(&ring);
+  TEST_PASS("a full ring refuses more lines");
+}
+
+/* Test runner */
+typedef struct
+{
+  const char *name;
+  int (*func)(void);
+} test_case_t;
+
+int main(int argc, char *argv[])
+{
+  test_case_t tests[] =
+  {
+    {"queue", test_queue},
+    {"backpressure", test_backpressure},
+    {NULL, NULL}
+  };
+
+  if (argc < 2)
+  {
+    fprintf(stderr, "Usage: %s <test_name>\n", argv[0]);
+    return 1;
+  }
+
+  for (int i = 0; tests[i].name != NULL; i++)
+  {
+    if (strcmp(argv[1], tests[i].name) == 0)
+    {
+      return tests[i].func();
+    }
+  }
+
+  fprintf(stderr, "Unknown test: %s\n", argv[1]);
+  return 1;
+}
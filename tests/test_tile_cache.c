@@ -0,0 +1,159 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 2000-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+
+
+
+
+
+/*
+ * Tests for the in-memory decoded tile cache in tile_cache.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tests/test_framework.h"
+#include "tile_cache.h"
+
+#define OSM "http://tile.openstreetmap.org"
+#define TOPO "http://tile.opentopomap.org"
+
+static tile_cache_tile *make_tile(uint32_t value)
+{
+  tile_cache_tile *tile = tile_cache_tile_new(256, 256);
+  int i;
+
+  for (i = 0; i < 256 * 256; i++)
+  {
+    tile->pixel[i] = value;
+    tile->drawn[i] = (i % 2);
+  }
+  return tile;
+}
+
+int test_lookup(void)
+{
+  tile_cache_tile *tile;
+
+  tile_cache_set_budget(64 * 1024 * 1024);
+  TEST_ASSERT(tile_cache_get(OSM, 12, 100, 200, 1000, 5000, 1) == NULL, "Empty cache misses");
+
+  tile = tile_cache_add(OSM, 12, 100, 200, 1000, 5000, 1, make_tile(42));
+  TEST_ASSERT(tile != NULL, "Tile added");
+  TEST_ASSERT(tile_cache_get(OSM, 12, 100, 200, 1000, 5000, 1) == tile, "Same key hits");
+  TEST_ASSERT(tile->pixel[7] == 42 && tile->drawn[7] == 1 && tile->drawn[8] == 0, "Pixels kept");
+
+  TEST_ASSERT(tile_cache_get(TOPO, 12, 100, 200, 1000, 5000, 1) == NULL, "Other server misses");
+  TEST_ASSERT(tile_cache_get(OSM, 13, 100, 200, 1000, 5000, 1) == NULL, "Other zoom misses");
+  TEST_ASSERT(tile_cache_get(OSM, 12, 101, 200, 1000, 5000, 1) == NULL, "Other x misses");
+  TEST_ASSERT(tile_cache_get(OSM, 12, 100, 201, 1000, 5000, 1) == NULL, "Other y misses");
+
+  tile_cache_add(TOPO, 12, 100, 200, 1000, 5000, 1, make_tile(7));
+  TEST_ASSERT(tile_cache_get(OSM, 12, 100, 200, 1000, 5000, 1)->pixel[0] == 42, "Servers kept apart");
+  TEST_ASSERT(tile_cache_get(TOPO, 12, 100, 200, 1000, 5000, 1)->pixel[0] == 7, "Servers kept apart");
+
+  TEST_ASSERT(tile_cache_get(OSM, 12, 100, 200, 1001, 5000, 1) == NULL, "Newer file misses");
+  TEST_ASSERT(tile_cache_get(OSM, 12, 100, 200, 1000, 5000, 1) == NULL, "Stale tile dropped");
+  TEST_ASSERT(tile_cache_get(TOPO, 12, 100, 200, 1000, 5001, 1) == NULL, "Changed size misses");
+  tile_cache_add(OSM, 12, 100, 200, 1000, 5000, 1, make_tile(42));
+  TEST_ASSERT(tile_cache_get(OSM, 12, 100, 200, 1000, 5000, 2) == NULL, "Changed variant misses");
+
+  tile_cache_add(OSM, 12, 100, 200, 1000, 5000, 1, make_tile(1));
+  tile_cache_add(OSM, 12, 100, 200, 1000, 5000, 1, make_tile(2));
+  TEST_ASSERT(tile_cache_get(OSM, 12, 100, 200, 1000, 5000, 1)->pixel[0] == 2, "Re-added tile replaces");
+
+  tile_cache_clear();
+  TEST_ASSERT(tile_cache_bytes() == 0, "Clear frees everything");
+  TEST_PASS("tiles are found by server, zoom, x and y");
+}
+
+int test_budget(void)
+{
+  size_t one;
+  unsigned long x;
+
+  tile_cache_set_budget(64 * 1024 * 1024);
+  tile_cache_add(OSM, 10, 0, 0, 1, 1, 0, make_tile(0));
+  one = tile_cache_bytes();
+  TEST_ASSERT(one > 256 * 256 * 5, "Tile size counted");
+
+  /* Room for four tiles */
+  tile_cache_set_budget(one * 4);
+  for (x = 1; x < 4; x++)
+  {
+    tile_cache_add(OSM, 10, x, 0, 1, 1, 0, make_tile(x));
+  }
+  TEST_ASSERT(tile_cache_bytes() == one * 4, "Four tiles fit");
+
+  /* Use tile 0 so tile 1 is the least recently used */
+  TEST_ASSERT(tile_cache_get(OSM, 10, 0, 0, 1, 1, 0) != NULL, "Tile 0 cached");
+  tile_cache_add(OSM, 10, 4, 0, 1, 1, 0, make_tile(4));
+  TEST_ASSERT(tile_cache_bytes() <= one * 4, "Within budget");
+  TEST_ASSERT(tile_cache_get(OSM, 10, 1, 0, 1, 1, 0) == NULL, "Least recently used dropped");
+  TEST_ASSERT(tile_cache_get(OSM, 10, 0, 0, 1, 1, 0) != NULL, "Recently used kept");
+  TEST_ASSERT(tile_cache_get(OSM, 10, 4, 0, 1, 1, 0) != NULL, "New tile kept");
+
+  /* A tile bigger than the budget is still kept until the next one */
+  tile_cache_set_budget(one / 2);
+  TEST_ASSERT(tile_cache_bytes() == 0, "Shrinking the budget drops tiles");
+  TEST_ASSERT(tile_cache_add(OSM, 10, 5, 0, 1, 1, 0, make_tile(5)) != NULL, "Oversized tile kept");
+  tile_cache_add(OSM, 10, 6, 0, 1, 1, 0, make_tile(6));
+  TEST_ASSERT(tile_cache_get(OSM, 10, 5, 0, 1, 1, 0) == NULL, "Oversized tile dropped for the next");
+
+  tile_cache_clear();
+  TEST_PASS("least recently used tiles are dropped to fit the budget");
+}
+
+/* Test runner */
+typedef struct
+{
+  const char *name;
+  int (*func)(void);
+} test_case_t;
+
+int main(int argc, char *argv[])
+{
+  test_case_t tests[] =
+  {
+    {"lookup", test_lookup},
+    {"budget", test_budget},
+    {NULL, NULL}
+  };
+
+  if (argc < 2)
+  {
+    fprintf(stderr, "Usage: %s <test_name>\n", argv[0]);
+    return 1;
+  }
+
+  for (int i = 0; tests[i].name != NULL; i++)
+  {
+    if (strcmp(argv[1], tests[i].name) == 0)
+    {
+      return tests[i].func();
+    }
+  }
+
+  fprintf(stderr, "Unknown test: %s\n", argv[1]);
+  return 1;
+}
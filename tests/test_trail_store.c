@@ -0,0 +1,282 @@
+/*
+ *
+ * XASTIR, Amateur Station Tracking and Information Reporting
+ * Copyright (C) 2025-2026 The Xastir Group
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * Look at the README for more information on the program.
+ */
+
+
+
+
+/*
+ * Tests for the delta-encoded trail store in trail_store.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tests/test_framework.h"
+#include "trail_store.h"
+
+#define TEST_POINTS 500
+
+/* A mobile moving about, with the odd jump and undefined field */
+static void make_point(TrackRow *point, int ii)
+{
+  point->trail_long_pos = 64800000L + ii * 1500L - (ii % 7) * 4000L;
+  point->trail_lat_pos  = 32400000L - ii * 900L + (ii % 5) * 3000L;
+  point->sec            = (time_t)1700000000L + ii * 30;
+  point->speed          = (ii % 11 == 0) ? -1 : 400 + (ii % 13) * 10;
+  point->course         = (ii % 17 == 0) ? -1 : (ii * 7) % 360;
+  point->altitude       = (ii % 19 == 0) ? -99999L : 1500 + ii;
+  point->flag           = (ii % 23 == 0) ? TR_NEWTRK : TR_LOCAL;
+
+  if (ii == 100)
+  {
+    // Wrap to the far side of the world
+    point->trail_long_pos = 100;
+    point->trail_lat_pos = 64799900L;
+  }
+}
+
+static int same_point(const TrackRow *a, const TrackRow *b)
+{
+  return a->trail_long_pos == b->trail_long_pos
+         && a->trail_lat_pos == b->trail_lat_pos
+         && a->sec == b->sec
+         && a->speed == b->speed
+         && a->course == b->course
+         && a->altitude == b->altitude
+         && a->flag == b->flag;
+}
+
+/* Check that "trail" holds points first..last in both directions */
+static int check_trail(const TrailStore *trail, int first, int last)
+{
+  TrailCursor cursor;
+  TrackRow expected;
+  int ii;
+
+  if (!trail_first(trail, &cursor))
+  {
+    return 0;
+  }
+  for (ii = first; ii <= last; ii++)
+  {
+    make_point(&expected, ii);
+    if (!same_point(&cursor.point, &expected))
+    {
+      return 0;
+    }
+    if (trail_next(&cursor) != (ii < last))
+    {
+      return 0;
+    }
+  }
+
+  if (!trail_last(trail, &cursor))
+  {
+    return 0;
+  }
+  for (ii = last; ii >= first; ii--)
+  {
+    make_point(&expected, ii);
+    if (!same_point(&cursor.point, &expected))
+    {
+      return 0;
+    }
+    if (trail_prev(&cursor) != (ii > first))
+    {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/* Test cases */
+
+int test_round_trip(void)
+{
+  TrailStore *trail = NULL;
+  TrackRow point, prev;
+  int ii;
+
+  TEST_ASSERT(!trail_store_previous(trail, &prev), "Empty trail has no points");
+
+  for (ii = 0; ii < TEST_POINTS; ii++)
+  {
+    make_point(&point, ii);
+    TEST_ASSERT(trail_store_append(&trail, &point), "Append succeeds");
+    if (ii == 0)
+    {
+      TEST_ASSERT(!trail_store_previous(trail, &prev), "One point has no previous");
+    }
+  }
+  TEST_ASSERT(trail->count == TEST_POINTS, "All points counted");
+  TEST_ASSERT(check_trail(trail, 0, TEST_POINTS - 1), "Walks match in both directions");
+
+  make_point(&point, TEST_POINTS - 2);
+  TEST_ASSERT(trail_store_previous(trail, &prev) && same_point(&prev, &point),
+              "Previous is the point before the newest");
+
+  trail_store_free(&trail);
+  TEST_ASSERT(trail == NULL, "Free clears the pointer");
+  TEST_PASS("points round trip in both directions");
+}
+
+int test_drop_oldest(void)
+{
+  TrailStore *trail = NULL;
+  TrackRow point;
+  unsigned long points, peak, bytes;
+  int ii;
+
+  for (ii = 0; ii < TEST_POINTS; ii++)
+  {
+    make_point(&point, ii);
+    trail_store_append(&trail, &point);
+  }
+
+  for (ii = 0; ii < TEST_POINTS - 1; ii++)
+  {
+    TEST_ASSERT(trail_store_drop_oldest(&trail) == TEST_POINTS - 1 - ii, "Count drops by one");
+    if (ii % 37 == 0)
+    {
+      TEST_ASSERT(check_trail(trail, ii + 1, TEST_POINTS - 1), "Remaining points intact");
+    }
+  }
+  TEST_ASSERT(check_trail(trail, TEST_POINTS - 1, TEST_POINTS - 1), "Newest point left");
+
+  // Appending after a long expiry reuses the reclaimed space
+  for (ii = TEST_POINTS; ii < TEST_POINTS + 50; ii++)
+  {
+    make_point(&point, ii);
+    trail_store_append(&trail, &point);
+    trail_store_drop_oldest(&trail);
+  }
+  TEST_ASSERT(check_trail(trail, TEST_POINTS + 49, TEST_POINTS + 49), "Append after drop");
+
+  TEST_ASSERT(trail_store_drop_oldest(&trail) == 0 && trail == NULL, "Last drop frees the trail");
+
+  trail_store_stats(&points, &peak, &bytes);
+  TEST_ASSERT(points == 0 && bytes == 0, "Totals back to zero");
+  TEST_ASSERT(peak == TEST_POINTS, "Peak kept");
+  TEST_PASS("oldest points are dropped");
+}
+
+int test_compact(void)
+{
+  TrailStore *trail = NULL;
+  TrackRow point;
+  int ii;
+
+  // A day of positions every two minutes
+  for (ii = 0; ii < 720; ii++)
+  {
+    make_point(&point, ii);
+    trail_store_append(&trail, &point);
+  }
+
+  // Well under the 72 bytes a linked list point took on 64-bit
+  TEST_ASSERT(trail_store_bytes(trail) < 720 * 24, "Trail is compact");
+
+  trail_store_free(&trail);
+  TEST_PASS("trails are stored compactly");
+}
+
+int test_restore(void)
+{
+  TrailStore *trail = NULL;
+  TrailStore *copy = NULL;
+  TrackRow point;
+  unsigned long points, peak, bytes;
+  int ii;
+
+  for (ii = 0; ii < TEST_POINTS; ii++)
+  {
+    make_point(&point, ii);
+    trail_store_append(&trail, &point);
+  }
+  for (ii = 0; ii < 10; ii++)
+  {
+    trail_store_drop_oldest(&trail);
+  }
+
+  TEST_ASSERT(trail_store_restore(&copy, &trail->oldest, &trail->newest, trail->count,
+                                  trail->data + trail->start, trail->length - trail->start),
+              "Restore succeeds");
+  TEST_ASSERT(check_trail(copy, 10, TEST_POINTS - 1), "Restored trail walks the same");
+
+  make_point(&point, TEST_POINTS);
+  TEST_ASSERT(trail_store_append(&copy, &point), "Append to a restored trail");
+  TEST_ASSERT(check_trail(copy, 10, TEST_POINTS), "Appended point walks");
+  TEST_ASSERT(trail_store_drop_oldest(&copy) == TEST_POINTS - 10, "Drop from a restored trail");
+  trail_store_free(&copy);
+
+  TEST_ASSERT(trail_store_restore(&copy, &trail->oldest, &trail->oldest, 1, NULL, 0)
+              && copy->count == 1, "Single point restored");
+  trail_store_free(&copy);
+
+  TEST_ASSERT(!trail_store_restore(&copy, &trail->oldest, &trail->newest, 1,
+                                   trail->data + trail->start, trail->length - trail->start)
+              && copy == NULL, "Records for a single point refused");
+  TEST_ASSERT(!trail_store_restore(&copy, &trail->oldest, &trail->newest, 2, NULL, 0)
+              && copy == NULL, "Missing records refused");
+
+  trail_store_free(&trail);
+  trail_store_stats(&points, &peak, &bytes);
+  TEST_ASSERT(points == 0 && bytes == 0, "Totals back to zero");
+  TEST_PASS("trails are restored from their saved records");
+}
+
+/* Test runner */
+typedef struct
+{
+  const char *name;
+  int (*func)(void);
+} test_case_t;
+
+int main(int argc, char *argv[])
+{
+  test_case_t tests[] =
+  {
+    {"round_trip", test_round_trip},
+    {"drop_oldest", test_drop_oldest},
+    {"compact", test_compact},
+    {"restore", test_restore},
+    {NULL, NULL}
+  };
+
+  if (argc < 2)
+  {
+    fprintf(stderr, "Usage: %s <test_name>\n", argv[0]);
+    return 1;
+  }
+
+  for (int i = 0; tests[i].name != NULL; i++)
+  {
+    if (strcmp(argv[1], tests[i].name) == 0)
+    {
+      return tests[i].func();
+    }
+  }
+
+  fprintf(stderr, "Unknown test: %s\n", argv[1]);
+  return 1;
+}